@@ -26,21 +26,103 @@
 #include "vtkMRMLRTPlanNode.h"
 
 // VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkMatrix4x4.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkSmartPointer.h>
 
+// STD includes
+#include <algorithm>
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerIECTransformLogic);
 
 //-----------------------------------------------------------------------------
 vtkSlicerIECTransformLogic::vtkSlicerIECTransformLogic()
 {
+  this->GantryToFixedReferenceTransform = vtkTransform::New();
+  this->CollimatorToGantryTransform = vtkTransform::New();
+  this->LeftImagingPanelTranslationTransform = vtkTransform::New();
+  this->LeftImagingPanelRotatedToGantryTransform = vtkTransform::New();
+  this->LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform = vtkTransform::New();
+  this->LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransform = vtkTransform::New();
+  this->RightImagingPanelTranslationTransform = vtkTransform::New();
+  this->RightImagingPanelRotatedToGantryTransform = vtkTransform::New();
+  this->RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform = vtkTransform::New();
+  this->RightImagingPanelToRightImagingPanelFixedReferenceIsocenterTransform = vtkTransform::New();
+  this->PatientSupportToFixedReferenceTransform = vtkTransform::New();
+  this->PatientSupportScaledTranslatedToTableTopVerticalTranslationTransform = vtkTransform::New();
+  this->PatientSupportScaledByTableTopVerticalMovementTransform = vtkTransform::New();
+  this->PatientSupportPositiveVerticalTranslationTransform = vtkTransform::New();
+  this->TableTopEccentricRotationToPatientSupportTransform = vtkTransform::New();
+  this->TableTopToTableTopEccentricRotationTransform = vtkTransform::New();
+
+  this->TransformModifiedCallbackCommand = vtkCallbackCommand::New();
+  this->TransformModifiedCallbackCommand->SetClientData(reinterpret_cast<void*>(this));
+  this->TransformModifiedCallbackCommand->SetCallback(vtkSlicerIECTransformLogic::OnTransformModified);
+
+  for (int frame=0; frame<LastCoordinateSystem; ++frame)
+  {
+    this->CoordinateSystemParents[frame] = FixedReference;
+    this->TransformsToParent[frame] = NULL;
+  }
+
+  // Set up the IEC hierarchy (see image in class description)
+  this->SetParentCoordinateSystem(GantryToFixedReference, FixedReference, this->GantryToFixedReferenceTransform);
+  this->SetParentCoordinateSystem(CollimatorToGantry, GantryToFixedReference, this->CollimatorToGantryTransform);
+
+  this->SetParentCoordinateSystem(LeftImagingPanelTranslation, GantryToFixedReference, this->LeftImagingPanelTranslationTransform);
+  this->SetParentCoordinateSystem(LeftImagingPanelRotatedToGantry, LeftImagingPanelTranslation, this->LeftImagingPanelRotatedToGantryTransform);
+  this->SetParentCoordinateSystem(LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotated, LeftImagingPanelRotatedToGantry,
+    this->LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform);
+  this->SetParentCoordinateSystem(LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenter, LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotated,
+    this->LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransform);
+
+  this->SetParentCoordinateSystem(RightImagingPanelTranslation, GantryToFixedReference, this->RightImagingPanelTranslationTransform);
+  this->SetParentCoordinateSystem(RightImagingPanelRotatedToGantry, RightImagingPanelTranslation, this->RightImagingPanelRotatedToGantryTransform);
+  this->SetParentCoordinateSystem(RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotated, RightImagingPanelRotatedToGantry,
+    this->RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform);
+  this->SetParentCoordinateSystem(RightImagingPanelToRightImagingPanelFixedReferenceIsocenter, RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotated,
+    this->RightImagingPanelToRightImagingPanelFixedReferenceIsocenterTransform);
+
+  this->SetParentCoordinateSystem(PatientSupportToFixedReference, FixedReference, this->PatientSupportToFixedReferenceTransform);
+  this->SetParentCoordinateSystem(PatientSupportScaledTranslatedToTableTopVerticalTranslation, PatientSupportToFixedReference,
+    this->PatientSupportScaledTranslatedToTableTopVerticalTranslationTransform);
+  this->SetParentCoordinateSystem(PatientSupportScaledByTableTopVerticalMovement, PatientSupportScaledTranslatedToTableTopVerticalTranslation,
+    this->PatientSupportScaledByTableTopVerticalMovementTransform);
+  this->SetParentCoordinateSystem(PatientSupportPositiveVerticalTranslation, PatientSupportScaledByTableTopVerticalMovement,
+    this->PatientSupportPositiveVerticalTranslationTransform);
+
+  this->SetParentCoordinateSystem(TableTopEccentricRotationToPatientSupport, PatientSupportToFixedReference, this->TableTopEccentricRotationToPatientSupportTransform);
+  this->SetParentCoordinateSystem(TableTopToTableEccentricRotation, TableTopEccentricRotationToPatientSupport, this->TableTopToTableTopEccentricRotationTransform);
+
+  // All cached matrices are computed on first query
+  for (int frame=0; frame<LastCoordinateSystem; ++frame)
+  {
+    this->MatrixToFixedReferenceDirty[frame] = true;
+    this->MatrixToFixedReferenceMTime[frame] = 0;
+  }
+  for (int pair=0; pair<LastCoordinateSystem*LastCoordinateSystem; ++pair)
+  {
+    this->MatrixBetweenDirty[pair] = true;
+    this->MatrixBetweenMTime[pair] = 0;
+  }
 }
 
 //-----------------------------------------------------------------------------
 vtkSlicerIECTransformLogic::~vtkSlicerIECTransformLogic()
 {
+  for (int frame=0; frame<LastCoordinateSystem; ++frame)
+  {
+    if (this->TransformsToParent[frame])
+    {
+      this->TransformsToParent[frame]->RemoveObservers(vtkCommand::ModifiedEvent, this->TransformModifiedCallbackCommand);
+      this->TransformsToParent[frame]->Delete();
+      this->TransformsToParent[frame] = NULL;
+    }
+  }
+  this->TransformModifiedCallbackCommand->Delete();
 }
 
 //----------------------------------------------------------------------------
@@ -75,640 +157,153 @@ bool vtkSlicerIECTransformLogic::GetTransformBetween(CoordinateSystemIdentifier
     return false;
   }
 
-  outputTransform->PreMultiply();
-  //TODO: ???
-
-  if (fromFrame == GantryToFixedReference && toFrame == FixedReference)
-  {
-    outputTransform = this->GantryToFixedReferenceTransform;
-  }
-
-  else if (fromFrame == CollimatorToGantry && toFrame == FixedReference)
-  {
-    outputTransform = this->CollimatorToGantryTransform;
-    outputTransform->Concatenate(this->GantryToFixedReferenceTransform);
-  }
-
-  else if (fromFrame == CollimatorToGantry && toFrame == GantryToFixedReference )
-  {
-    outputTransform = this->CollimatorToGantryTransform;
-  }
-
-  // Left Imaging Panel
-  else if (fromFrame == LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenter && toFrame == FixedReference)
-  {
-    outputTransform = this->LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransform;
-    outputTransform->Concatenate(this->LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform);
-    outputTransform->Concatenate(this->LeftImagingPanelRotatedToGantryTransform);
-    outputTransform->Concatenate(this->LeftImagingPanelTranslationTransform);
-    outputTransform->Concatenate(this->GantryToFixedReferenceTransform);
-  }
-
-  else if (fromFrame == LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenter && toFrame == GantryToFixedReference )
-  {
-    outputTransform = this->LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransform;
-    outputTransform->Concatenate(this->LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform);
-    outputTransform->Concatenate(this->LeftImagingPanelRotatedToGantryTransform);
-    outputTransform->Concatenate(this->LeftImagingPanelTranslationTransform);
-  }
-
-  else if (fromFrame == LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenter && toFrame == LeftImagingPanelTranslation)
-  {
-    outputTransform = this->LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransform;
-    outputTransform->Concatenate(this->LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform);
-    outputTransform->Concatenate(this->LeftImagingPanelRotatedToGantryTransform);
-  }
-
-  else if (fromFrame == LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenter && toFrame == LeftImagingPanelRotatedToGantry)
-  {
-    outputTransform = this->LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransform;
-    outputTransform->Concatenate(this->LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform);
-  }
-
-  else if (fromFrame == LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenter && toFrame == LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotated)
-  {
-    outputTransform = this->LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransform;
-  }
-
-  else if (fromFrame == LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotated && toFrame == FixedReference)
-  {
-    outputTransform = this->LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform;
-    outputTransform->Concatenate(this->LeftImagingPanelRotatedToGantryTransform);
-    outputTransform->Concatenate(this->LeftImagingPanelTranslationTransform);
-    outputTransform->Concatenate(this->GantryToFixedReferenceTransform);
-  }
-
-  else if (fromFrame == LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotated && toFrame == GantryToFixedReference)
-  {
-    outputTransform = this->LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform;
-    outputTransform->Concatenate(this->LeftImagingPanelRotatedToGantryTransform);
-    outputTransform->Concatenate(this->LeftImagingPanelTranslationTransform);
-  }
-
-  else if (fromFrame == LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotated && toFrame == LeftImagingPanelTranslation)
-  {
-    outputTransform = this->LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform;
-    outputTransform->Concatenate(this->LeftImagingPanelRotatedToGantryTransform);
-  }
-
-  else if (fromFrame == LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotated && toFrame == LeftImagingPanelRotatedToGantry)
-  {
-    outputTransform = this->LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform;
-  }
-
-  else if (fromFrame == LeftImagingPanelRotatedToGantry && toFrame == FixedReference)
-  {
-    outputTransform = this->LeftImagingPanelRotatedToGantryTransform;
-    outputTransform->Concatenate(this->LeftImagingPanelTranslationTransform);
-    outputTransform->Concatenate(this->GantryToFixedReferenceTransform);
-  }
-
-  else if (fromFrame == LeftImagingPanelRotatedToGantry && toFrame == GantryToFixedReference)
-  {
-    outputTransform = this->LeftImagingPanelRotatedToGantryTransform;
-    outputTransform->Concatenate(this->LeftImagingPanelTranslationTransform);
-  }
-
-  else if (fromFrame == LeftImagingPanelRotatedToGantry && toFrame == LeftImagingPanelTranslation)
-  {
-    outputTransform = this->LeftImagingPanelRotatedToGantryTransform;
-  }
-
-  else if (fromFrame == LeftImagingPanelTranslation && toFrame == FixedReference)
-  {
-    outputTransform = this->LeftImagingPanelTranslationTransform;
-    outputTransform->Concatenate(this->GantryToFixedReferenceTransform);
-  }
-
-  else if (fromFrame == LeftImagingPanelTranslation && toFrame == GantryToFixedReference)
-  {
-    outputTransform = this->LeftImagingPanelTranslationTransform;
-  }
-
-  // Right Imaging Panel:
-  else if (fromFrame == RightImagingPanelToRightImagingPanelFixedReferenceIsocenter && toFrame == FixedReference)
-  {
-    outputTransform = this->RightImagingPanelToRightImagingPanelFixedReferenceIsocenterTransform;
-    outputTransform->Concatenate(this->RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform);
-    outputTransform->Concatenate(this->RightImagingPanelRotatedToGantryTransform);
-    outputTransform->Concatenate(this->RightImagingPanelTranslationTransform);
-    outputTransform->Concatenate(this->GantryToFixedReferenceTransform);
-  }
-
-  else if (fromFrame == RightImagingPanelToRightImagingPanelFixedReferenceIsocenter && toFrame == GantryToFixedReference)
-  {
-    outputTransform = this->RightImagingPanelToRightImagingPanelFixedReferenceIsocenterTransform;
-    outputTransform->Concatenate(this->RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform);
-    outputTransform->Concatenate(this->RightImagingPanelRotatedToGantryTransform);
-    outputTransform->Concatenate(this->RightImagingPanelTranslationTransform);
-  }
-
-  else if (fromFrame == RightImagingPanelToRightImagingPanelFixedReferenceIsocenter && toFrame == RightImagingPanelTranslation)
-  {
-    outputTransform = this->RightImagingPanelToRightImagingPanelFixedReferenceIsocenterTransform;
-    outputTransform->Concatenate(this->RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform);
-    outputTransform->Concatenate(this->RightImagingPanelRotatedToGantryTransform);
-  }
-
-  else if (fromFrame == RightImagingPanelToRightImagingPanelFixedReferenceIsocenter && toFrame == RightImagingPanelRotatedToGantry)
-  {
-    outputTransform = this->RightImagingPanelToRightImagingPanelFixedReferenceIsocenterTransform;
-    outputTransform->Concatenate(this->RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform);
-  }
-
-  else if (fromFrame == RightImagingPanelToRightImagingPanelFixedReferenceIsocenter && toFrame == RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotated)
-  {
-    outputTransform = this->RightImagingPanelToRightImagingPanelFixedReferenceIsocenterTransform;
-  }
-
-  else if (fromFrame == RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotated && toFrame == FixedReference)
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  if (!this->GetMatrixBetween(fromFrame, toFrame, matrix))
   {
-    outputTransform = this->RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform;
-    outputTransform->Concatenate(this->RightImagingPanelRotatedToGantryTransform);
-    outputTransform->Concatenate(this->RightImagingPanelTranslationTransform);
-    outputTransform->Concatenate(this->GantryToFixedReferenceTransform);
-  }
-
-  else if (fromFrame == RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotated && toFrame == GantryToFixedReference)
-  {
-    outputTransform = this->RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform;
-    outputTransform->Concatenate(this->RightImagingPanelRotatedToGantryTransform);
-    outputTransform->Concatenate(this->RightImagingPanelTranslationTransform);
-  }
-
-  else if (fromFrame == RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotated && toFrame == RightImagingPanelTranslation)
-  {
-    outputTransform = this->RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform;
-    outputTransform->Concatenate(this->RightImagingPanelRotatedToGantryTransform);
-  }
-
-  else if (fromFrame == RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotated && toFrame == RightImagingPanelRotatedToGantry)
-  {
-
-    outputTransform = this->RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform;
-  }
-
-  else if (fromFrame == RightImagingPanelRotatedToGantry && toFrame == FixedReference)
-  {
-    outputTransform = this->RightImagingPanelRotatedToGantryTransform;
-    outputTransform->Concatenate(this->RightImagingPanelTranslationTransform);
-    outputTransform->Concatenate(this->GantryToFixedReferenceTransform);
-  }
-
-  else if (fromFrame == RightImagingPanelRotatedToGantry && toFrame == GantryToFixedReference)
-  {
-    outputTransform = this->RightImagingPanelRotatedToGantryTransform;
-    outputTransform->Concatenate(this->RightImagingPanelTranslationTransform);
-  }
-
-  else if (fromFrame == RightImagingPanelRotatedToGantry && toFrame == RightImagingPanelTranslation)
-  {
-    outputTransform = this->RightImagingPanelRotatedToGantryTransform;
-  }
-
-  else if (fromFrame == RightImagingPanelTranslation && toFrame == FixedReference)
-  {
-    outputTransform = this->RightImagingPanelTranslationTransform;
-    outputTransform->Concatenate(this->GantryToFixedReferenceTransform);
-  }
-
-  else if (fromFrame == RightImagingPanelTranslation && toFrame == GantryToFixedReference)
-  {
-    outputTransform = this->RightImagingPanelTranslationTransform;
-  }
-
-  // Patient Support
-  else if (fromFrame == PatientSupportToFixedReference && toFrame == FixedReference)
-  {
-    outputTransform = this->PatientSupportToFixedReferenceTransform;
-  }
-
-  else if (fromFrame == PatientSupportPositiveVerticalTranslation && toFrame == FixedReference)
-  {
-    outputTransform = this->PatientSupportPositiveVerticalTranslationTransform;
-    outputTransform->Concatenate(this->PatientSupportScaledByTableTopVerticalMovementTransform);
-    outputTransform->Concatenate(this->PatientSupportScaledTranslatedToTableTopVerticalTranslationTransform);
-    outputTransform->Concatenate(this->PatientSupportToFixedReferenceTransform);
-  }
-
-  else if (fromFrame == PatientSupportPositiveVerticalTranslation && toFrame == PatientSupportToFixedReference)
-  {
-    outputTransform = this->PatientSupportPositiveVerticalTranslationTransform;
-    outputTransform->Concatenate(this->PatientSupportScaledByTableTopVerticalMovementTransform);
-    outputTransform->Concatenate(this->PatientSupportScaledTranslatedToTableTopVerticalTranslationTransform);
-  }
-
-  else if (fromFrame == PatientSupportPositiveVerticalTranslation && toFrame == PatientSupportScaledTranslatedToTableTopVerticalTranslation)
-  {
-    outputTransform = this->PatientSupportPositiveVerticalTranslationTransform;
-    outputTransform->Concatenate(this->PatientSupportScaledByTableTopVerticalMovementTransform);
-   
-  }
-
-  else if (fromFrame == PatientSupportPositiveVerticalTranslation && toFrame == PatientSupportScaledByTableTopVerticalMovement)
-  {
-    outputTransform = this->PatientSupportPositiveVerticalTranslationTransform;
-  }
-
-  else if (fromFrame == PatientSupportScaledByTableTopVerticalMovement && toFrame == FixedReference)
-  {
-    outputTransform = this->PatientSupportScaledByTableTopVerticalMovementTransform;
-    outputTransform->Concatenate(this->PatientSupportScaledTranslatedToTableTopVerticalTranslationTransform);
-    outputTransform->Concatenate(this->PatientSupportToFixedReferenceTransform);
-  }
-
-  else if (fromFrame == PatientSupportScaledByTableTopVerticalMovement && toFrame == PatientSupportToFixedReference)
-  {
-    outputTransform = this->PatientSupportScaledByTableTopVerticalMovementTransform;
-    outputTransform->Concatenate(this->PatientSupportScaledTranslatedToTableTopVerticalTranslationTransform);
-  }
-
-  else if (fromFrame == PatientSupportScaledByTableTopVerticalMovement && toFrame == PatientSupportScaledTranslatedToTableTopVerticalTranslation)
-  {
-    outputTransform = this->PatientSupportScaledByTableTopVerticalMovementTransform;
-  }
-
-  else if (fromFrame == PatientSupportScaledTranslatedToTableTopVerticalTranslation && toFrame == FixedReference)
-  {
-    outputTransform = this->PatientSupportScaledTranslatedToTableTopVerticalTranslationTransform;
-    outputTransform->Concatenate(this->PatientSupportToFixedReferenceTransform);
-  }
-
-  else if (fromFrame == PatientSupportScaledTranslatedToTableTopVerticalTranslation && toFrame == PatientSupportToFixedReference)
-  {
-    outputTransform = this->PatientSupportScaledTranslatedToTableTopVerticalTranslationTransform;
-  }
-
-  // Table Top
-  else if (fromFrame == TableTopToTableEccentricRotation && toFrame == FixedReference)
-  {
-    outputTransform = this->TableTopToTableTopEccentricRotationTransform;
-    outputTransform->Concatenate(TableTopEccentricRotationToPatientSupportTransform);
-    outputTransform->Concatenate(PatientSupportToFixedReferenceTransform);
-  }
-
-  else if (fromFrame == TableTopEccentricRotationToPatientSupport && toFrame == FixedReference)
-  {
-    outputTransform = this->TableTopEccentricRotationToPatientSupportTransform;
-    outputTransform->Concatenate(PatientSupportToFixedReferenceTransform);
-  }
-
-  else if (fromFrame == TableTopToTableEccentricRotation && toFrame == PatientSupportToFixedReference)
-  {
-    outputTransform = this->TableTopToTableTopEccentricRotationTransform;
-    outputTransform->Concatenate(TableTopEccentricRotationToPatientSupportTransform);
-  }
-
-  else if (fromFrame == TableTopEccentricRotationToPatientSupport && toFrame == PatientSupportToFixedReference)
-  {
-    outputTransform = this->TableTopEccentricRotationToPatientSupportTransform;
-  }
-
-  else if (fromFrame == TableTopToTableEccentricRotation && toFrame == TableTopEccentricRotationToPatientSupport)
-  {
-    outputTransform = this->TableTopToTableTopEccentricRotationTransform;
-  }
-
-  // Inverse
-  if (fromFrame == FixedReference && toFrame == GantryToFixedReference)
-  {
-    
-    outputTransform = this->GantryToFixedReferenceTransform;
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == FixedReference && toFrame == CollimatorToGantry )
-  {
-    outputTransform = this->CollimatorToGantryTransform;
-    outputTransform->Concatenate(this->GantryToFixedReferenceTransform);
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == GantryToFixedReference && toFrame == CollimatorToGantry)
-  {
-    outputTransform = this->CollimatorToGantryTransform;
-    outputTransform->Inverse();
-  }
-  
-  // Left Imaging Panel
-  else if (fromFrame == FixedReference && toFrame == LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenter)
-  {
-    outputTransform = this->LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransform;
-    outputTransform->Concatenate(this->LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform);
-    outputTransform->Concatenate(this->LeftImagingPanelRotatedToGantryTransform);
-    outputTransform->Concatenate(this->LeftImagingPanelTranslationTransform);
-    outputTransform->Concatenate(this->GantryToFixedReferenceTransform);
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == GantryToFixedReference && toFrame == LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenter)
-  {
-    outputTransform = this->LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransform;
-    outputTransform->Concatenate(this->LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform);
-    outputTransform->Concatenate(this->LeftImagingPanelRotatedToGantryTransform);
-    outputTransform->Concatenate(this->LeftImagingPanelTranslationTransform);
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == LeftImagingPanelTranslation && toFrame == LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenter)
-  {
-    outputTransform = this->LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransform;
-    outputTransform->Concatenate(this->LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform);
-    outputTransform->Concatenate(this->LeftImagingPanelRotatedToGantryTransform);
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == LeftImagingPanelRotatedToGantry && toFrame == LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenter)
-  {
-    outputTransform = this->LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransform;
-    outputTransform->Concatenate(this->LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform);
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenter && toFrame == LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotated)
-  {
-    outputTransform = this->LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransform;
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == FixedReference && toFrame == LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotated)
-  {
-    outputTransform = this->LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform;
-    outputTransform->Concatenate(this->LeftImagingPanelRotatedToGantryTransform);
-    outputTransform->Concatenate(this->LeftImagingPanelTranslationTransform);
-    outputTransform->Concatenate(this->GantryToFixedReferenceTransform);
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == GantryToFixedReference && toFrame == LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotated)
-  {
-    outputTransform = this->LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform;
-    outputTransform->Concatenate(this->LeftImagingPanelRotatedToGantryTransform);
-    outputTransform->Concatenate(this->LeftImagingPanelTranslationTransform);
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == LeftImagingPanelTranslation && toFrame == LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotated)
-  {
-    outputTransform = this->LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform;
-    outputTransform->Concatenate(this->LeftImagingPanelRotatedToGantryTransform);
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotated && toFrame == LeftImagingPanelRotatedToGantry)
-  {
-
-    outputTransform = this->LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform;
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == FixedReference && toFrame == LeftImagingPanelRotatedToGantry)
-  {
-    outputTransform = this->LeftImagingPanelRotatedToGantryTransform;
-    outputTransform->Concatenate(this->LeftImagingPanelTranslationTransform);
-    outputTransform->Concatenate(this->GantryToFixedReferenceTransform);
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == GantryToFixedReference && toFrame == LeftImagingPanelRotatedToGantry)
-  {
-    outputTransform = this->LeftImagingPanelRotatedToGantryTransform;
-    outputTransform->Concatenate(this->LeftImagingPanelTranslationTransform);
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == LeftImagingPanelTranslation && toFrame == LeftImagingPanelRotatedToGantry)
-  {
-    outputTransform = this->LeftImagingPanelRotatedToGantryTransform;
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == FixedReference && toFrame == LeftImagingPanelTranslation)
-  {
-    outputTransform = this->LeftImagingPanelTranslationTransform;
-    outputTransform->Concatenate(this->GantryToFixedReferenceTransform);
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == GantryToFixedReference && toFrame == LeftImagingPanelTranslation)
-  {
-    outputTransform = this->LeftImagingPanelTranslationTransform;
-    outputTransform->Inverse();
-  }
-
-  // Right Imaging Panel:
-  else if (fromFrame == FixedReference && toFrame == RightImagingPanelToRightImagingPanelFixedReferenceIsocenter)
-  {
-    outputTransform = this->RightImagingPanelToRightImagingPanelFixedReferenceIsocenterTransform;
-    outputTransform->Concatenate(this->RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform);
-    outputTransform->Concatenate(this->RightImagingPanelRotatedToGantryTransform);
-    outputTransform->Concatenate(this->RightImagingPanelTranslationTransform);
-    outputTransform->Concatenate(this->GantryToFixedReferenceTransform);
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == GantryToFixedReference && toFrame == RightImagingPanelToRightImagingPanelFixedReferenceIsocenter)
-  {
-    outputTransform = this->RightImagingPanelToRightImagingPanelFixedReferenceIsocenterTransform;
-    outputTransform->Concatenate(this->RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform);
-    outputTransform->Concatenate(this->RightImagingPanelRotatedToGantryTransform);
-    outputTransform->Concatenate(this->RightImagingPanelTranslationTransform);
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == RightImagingPanelTranslation && toFrame == RightImagingPanelToRightImagingPanelFixedReferenceIsocenter)
-  {
-    outputTransform = this->RightImagingPanelToRightImagingPanelFixedReferenceIsocenterTransform;
-    outputTransform->Concatenate(this->RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform);
-    outputTransform->Concatenate(this->RightImagingPanelRotatedToGantryTransform);
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == RightImagingPanelRotatedToGantry && toFrame == RightImagingPanelToRightImagingPanelFixedReferenceIsocenter)
-  {
-    outputTransform = this->RightImagingPanelToRightImagingPanelFixedReferenceIsocenterTransform;
-    outputTransform->Concatenate(this->RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform);
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == RightImagingPanelToRightImagingPanelFixedReferenceIsocenter && toFrame == RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotated)
-  {
-    outputTransform = this->RightImagingPanelToRightImagingPanelFixedReferenceIsocenterTransform;
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == FixedReference && toFrame == RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotated)
-  {
-    outputTransform = this->RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform;
-    outputTransform->Concatenate(this->RightImagingPanelRotatedToGantryTransform);
-    outputTransform->Concatenate(this->RightImagingPanelTranslationTransform);
-    outputTransform->Concatenate(this->GantryToFixedReferenceTransform);
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == GantryToFixedReference && toFrame == RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotated)
-  {
-    outputTransform = this->RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform;
-    outputTransform->Concatenate(this->RightImagingPanelRotatedToGantryTransform);
-    outputTransform->Concatenate(this->RightImagingPanelTranslationTransform);
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == RightImagingPanelTranslation && toFrame == RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotated)
-  {
-    outputTransform = this->RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform;
-    outputTransform->Concatenate(this->RightImagingPanelRotatedToGantryTransform);
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotated && toFrame == RightImagingPanelRotatedToGantry)
-  {
-
-    outputTransform = this->RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform;
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == FixedReference && toFrame == RightImagingPanelRotatedToGantry)
-  {
-    outputTransform = this->RightImagingPanelRotatedToGantryTransform;
-    outputTransform->Concatenate(this->RightImagingPanelTranslationTransform);
-    outputTransform->Concatenate(this->GantryToFixedReferenceTransform);
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == GantryToFixedReference && toFrame == RightImagingPanelRotatedToGantry)
-  {
-    outputTransform = this->RightImagingPanelRotatedToGantryTransform;
-    outputTransform->Concatenate(this->RightImagingPanelTranslationTransform);
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == RightImagingPanelTranslation && toFrame == RightImagingPanelRotatedToGantry)
-  {
-    outputTransform = this->RightImagingPanelRotatedToGantryTransform;
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == FixedReference && toFrame == RightImagingPanelTranslation)
-  {
-    outputTransform = this->RightImagingPanelTranslationTransform;
-    outputTransform->Concatenate(this->GantryToFixedReferenceTransform);
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == GantryToFixedReference && toFrame == RightImagingPanelTranslation)
-  {
-    outputTransform = this->RightImagingPanelTranslationTransform;
-    outputTransform->Inverse();
-  }
-
-  // Patient Support
-  else if (fromFrame == FixedReference && toFrame == PatientSupportToFixedReference)
-  {
-    outputTransform = this->PatientSupportToFixedReferenceTransform;
-    outputTransform->Inverse();
-  }
-
-  else if (fromFrame == FixedReference && toFrame == PatientSupportPositiveVerticalTranslation)
-  {
-    outputTransform = this->PatientSupportPositiveVerticalTranslationTransform;
-    outputTransform->Concatenate(this->PatientSupportScaledByTableTopVerticalMovementTransform);
-    outputTransform->Concatenate(this->PatientSupportScaledTranslatedToTableTopVerticalTranslationTransform);
-    outputTransform->Concatenate(this->PatientSupportToFixedReferenceTransform);
-    outputTransform->Inverse();
+    return false;
   }
 
-  else if (fromFrame == PatientSupportToFixedReference  && toFrame == PatientSupportPositiveVerticalTranslation)
-  {
-    outputTransform = this->PatientSupportPositiveVerticalTranslationTransform;
-    outputTransform->Concatenate(this->PatientSupportScaledByTableTopVerticalMovementTransform);
-    outputTransform->Concatenate(this->PatientSupportScaledTranslatedToTableTopVerticalTranslationTransform);
-    outputTransform->Inverse();
-  }
+  outputTransform->SetMatrix(matrix);
+  return true;
+}
 
-  else if (fromFrame == PatientSupportScaledTranslatedToTableTopVerticalTranslation  && toFrame == PatientSupportPositiveVerticalTranslation)
+//-----------------------------------------------------------------------------
+bool vtkSlicerIECTransformLogic::GetMatrixBetween(CoordinateSystemIdentifier fromFrame, CoordinateSystemIdentifier toFrame, vtkMatrix4x4* outputMatrix)
+{
+  if (!outputMatrix)
   {
-    outputTransform = this->PatientSupportPositiveVerticalTranslationTransform;
-    outputTransform->Concatenate(this->PatientSupportScaledByTableTopVerticalMovementTransform);
-    outputTransform->Inverse();
+    vtkErrorMacro("GetMatrixBetween: Invalid output matrix!");
+    return false;
   }
-
-  else if (fromFrame == PatientSupportScaledByTableTopVerticalMovement  && toFrame == PatientSupportPositiveVerticalTranslation)
+  if (fromFrame < 0 || fromFrame >= LastCoordinateSystem || toFrame < 0 || toFrame >= LastCoordinateSystem)
   {
-    outputTransform = this->PatientSupportPositiveVerticalTranslationTransform;
-    outputTransform->Inverse();
+    vtkErrorMacro("GetMatrixBetween: Invalid coordinate frame!");
+    return false;
   }
 
-  else if (fromFrame == FixedReference  && toFrame == PatientSupportScaledByTableTopVerticalMovement)
+  int pair = fromFrame * LastCoordinateSystem + toFrame;
+  if ( this->MatrixBetweenDirty[pair]
+    || std::max(this->GetPathMTime(fromFrame), this->GetPathMTime(toFrame)) > this->MatrixBetweenMTime[pair] )
   {
-    outputTransform = this->PatientSupportScaledByTableTopVerticalMovementTransform;
-    outputTransform->Concatenate(this->PatientSupportScaledTranslatedToTableTopVerticalTranslationTransform);
-    outputTransform->Concatenate(this->PatientSupportToFixedReferenceTransform);
-    outputTransform->Inverse();
+    // From frame to fixed reference, then fixed reference to the to frame
+    double fixedReferenceToToFrame[16];
+    vtkMatrix4x4::Invert(this->GetMatrixToFixedReference(toFrame), fixedReferenceToToFrame);
+    vtkMatrix4x4::Multiply4x4(fixedReferenceToToFrame, this->GetMatrixToFixedReference(fromFrame), this->MatricesBetween[pair]);
+    this->MatrixBetweenDirty[pair] = false;
+    this->MatrixBetweenMTime[pair] = std::max(this->MatrixToFixedReferenceMTime[fromFrame], this->MatrixToFixedReferenceMTime[toFrame]);
   }
 
-  else if (fromFrame == PatientSupportToFixedReference  && toFrame == PatientSupportScaledByTableTopVerticalMovement)
-  {
-    outputTransform = this->PatientSupportScaledByTableTopVerticalMovementTransform;
-    outputTransform->Concatenate(this->PatientSupportScaledTranslatedToTableTopVerticalTranslationTransform);
-    outputTransform->Inverse();
-  }
+  outputMatrix->DeepCopy(this->MatricesBetween[pair]);
+  return true;
+}
 
-  else if (fromFrame == PatientSupportScaledTranslatedToTableTopVerticalTranslation && toFrame == PatientSupportScaledByTableTopVerticalMovement)
+//-----------------------------------------------------------------------------
+vtkSlicerIECTransformLogic::CoordinateSystemIdentifier vtkSlicerIECTransformLogic::GetParentCoordinateSystem(CoordinateSystemIdentifier frame)
+{
+  if (frame < 0 || frame >= LastCoordinateSystem)
   {
-    outputTransform = this->PatientSupportScaledByTableTopVerticalMovementTransform;
-    outputTransform->Inverse();
+    vtkErrorMacro("GetParentCoordinateSystem: Invalid coordinate frame!");
+    return FixedReference;
   }
+  return this->CoordinateSystemParents[frame];
+}
 
-  else if (fromFrame == FixedReference  && toFrame == PatientSupportScaledTranslatedToTableTopVerticalTranslation)
+//-----------------------------------------------------------------------------
+vtkTransform* vtkSlicerIECTransformLogic::GetTransformToParent(CoordinateSystemIdentifier frame)
+{
+  if (frame < 0 || frame >= LastCoordinateSystem)
   {
-    outputTransform = this->PatientSupportScaledTranslatedToTableTopVerticalTranslationTransform;
-    outputTransform->Concatenate(this->PatientSupportToFixedReferenceTransform);
-    outputTransform->Inverse();
+    vtkErrorMacro("GetTransformToParent: Invalid coordinate frame!");
+    return NULL;
   }
+  return this->TransformsToParent[frame];
+}
 
-  else if (fromFrame == PatientSupportToFixedReference  && toFrame == PatientSupportScaledTranslatedToTableTopVerticalTranslation)
-  {
-    outputTransform = this->PatientSupportScaledTranslatedToTableTopVerticalTranslationTransform;
-    outputTransform->Inverse();
-  }
+//-----------------------------------------------------------------------------
+void vtkSlicerIECTransformLogic::SetParentCoordinateSystem(CoordinateSystemIdentifier frame, CoordinateSystemIdentifier parentFrame, vtkTransform* transformToParent)
+{
+  this->CoordinateSystemParents[frame] = parentFrame;
+  this->TransformsToParent[frame] = transformToParent;
+  transformToParent->AddObserver(vtkCommand::ModifiedEvent, this->TransformModifiedCallbackCommand);
+}
 
-  // Table Top
-  else if (fromFrame == FixedReference && toFrame == TableTopToTableEccentricRotation)
-  {
-    outputTransform = this->TableTopToTableTopEccentricRotationTransform;
-    outputTransform->Concatenate(TableTopEccentricRotationToPatientSupportTransform);
-    outputTransform->Concatenate(PatientSupportToFixedReferenceTransform);
-    outputTransform->Inverse();
-  }
+//-----------------------------------------------------------------------------
+const double* vtkSlicerIECTransformLogic::GetMatrixToFixedReference(CoordinateSystemIdentifier frame)
+{
+  if (this->MatrixToFixedReferenceDirty[frame] || this->GetPathMTime(frame) > this->MatrixToFixedReferenceMTime[frame])
+  {
+    if (frame == FixedReference)
+    {
+      vtkMatrix4x4::Identity(this->MatricesToFixedReference[frame]);
+    }
+    else
+    {
+      // Parent to fixed reference after frame to parent
+      vtkMatrix4x4::Multiply4x4(this->GetMatrixToFixedReference(this->CoordinateSystemParents[frame]),
+        *this->TransformsToParent[frame]->GetMatrix()->Element, this->MatricesToFixedReference[frame]);
+    }
+    this->MatrixToFixedReferenceDirty[frame] = false;
+    // Read after the matrices of the transforms were updated above
+    this->MatrixToFixedReferenceMTime[frame] = this->GetPathMTime(frame);
+  }
+  return this->MatricesToFixedReference[frame];
+}
 
-  else if (fromFrame == FixedReference && toFrame == TableTopEccentricRotationToPatientSupport)
+//-----------------------------------------------------------------------------
+vtkMTimeType vtkSlicerIECTransformLogic::GetPathMTime(CoordinateSystemIdentifier frame)
+{
+  vtkMTimeType pathMTime = 0;
+  for (int pathFrame = frame; pathFrame != FixedReference; pathFrame = this->CoordinateSystemParents[pathFrame])
   {
-    outputTransform = this->TableTopEccentricRotationToPatientSupportTransform;
-    outputTransform->Concatenate(PatientSupportToFixedReferenceTransform);
-    outputTransform->Inverse();
+    pathMTime = std::max(pathMTime, this->TransformsToParent[pathFrame]->GetMTime());
   }
+  return pathMTime;
+}
 
-  else if (fromFrame == PatientSupportToFixedReference && toFrame == TableTopToTableEccentricRotation)
-  {
-    outputTransform = this->TableTopToTableTopEccentricRotationTransform;
-    outputTransform->Concatenate(TableTopEccentricRotationToPatientSupportTransform);
-    outputTransform->Inverse();
+//-----------------------------------------------------------------------------
+void vtkSlicerIECTransformLogic::InvalidateCoordinateSystem(CoordinateSystemIdentifier frame)
+{
+  for (int descendant=0; descendant<LastCoordinateSystem; ++descendant)
+  {
+    // Only the frames having the modified frame on their path to the fixed reference are affected
+    int pathFrame = descendant;
+    while (pathFrame != frame && pathFrame != FixedReference)
+    {
+      pathFrame = this->CoordinateSystemParents[pathFrame];
+    }
+    if (pathFrame != frame)
+    {
+      continue;
+    }
+
+    this->MatrixToFixedReferenceDirty[descendant] = true;
+    for (int other=0; other<LastCoordinateSystem; ++other)
+    {
+      this->MatrixBetweenDirty[descendant * LastCoordinateSystem + other] = true;
+      this->MatrixBetweenDirty[other * LastCoordinateSystem + descendant] = true;
+    }
   }
+}
 
-  else if (fromFrame == PatientSupportToFixedReference  && toFrame == TableTopEccentricRotationToPatientSupport)
+//-----------------------------------------------------------------------------
+void vtkSlicerIECTransformLogic::OnTransformModified(vtkObject* caller,
+                                                     unsigned long vtkNotUsed(eid),
+                                                     void* clientData,
+                                                     void* vtkNotUsed(callData))
+{
+  vtkSlicerIECTransformLogic* self = reinterpret_cast<vtkSlicerIECTransformLogic*>(clientData);
+  if (!self || !caller)
   {
-    outputTransform = this->TableTopEccentricRotationToPatientSupportTransform;
-    outputTransform->Inverse();
+    return;
   }
 
-  else if (fromFrame == TableTopEccentricRotationToPatientSupport && toFrame == TableTopToTableEccentricRotation)
+  for (int frame=0; frame<LastCoordinateSystem; ++frame)
   {
-    outputTransform = this->TableTopToTableTopEccentricRotationTransform;
-    outputTransform->Inverse();
+    if (self->TransformsToParent[frame] == caller)
+    {
+      self->InvalidateCoordinateSystem((CoordinateSystemIdentifier)frame);
+    }
   }
-
-  return true;
 }
 
 //-----------------------------------------------------------------------------
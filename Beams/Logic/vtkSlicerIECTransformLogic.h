@@ -28,6 +28,8 @@
 #include <vtkObject.h>
 #include <vtkTransform.h>
 
+class vtkCallbackCommand;
+class vtkMatrix4x4;
 class vtkMRMLRTBeamNode;
 
 /// \ingroup SlicerRt_QtModules_Beams
@@ -41,6 +43,13 @@ class vtkMRMLRTBeamNode;
 /// Image describing these coordinate frames:
 /// http://perk.cs.queensu.ca/sites/perkd7.cs.queensu.ca/files/Project/IEC_Transformations.PNG
 ///
+/// The coordinate systems form a tree rooted at the fixed reference system, each one storing only
+/// its transform to the parent. The matrices from each coordinate system to the fixed reference and
+/// between pairs of coordinate systems are cached together with the latest modification time of the
+/// transforms on their path, so repeated queries are simple matrix lookups. Not all transform operations
+/// invoke modified events (e.g. vtkTransform::Translate), so the cache is validated by modification time,
+/// and the observed modified events only flag the matrices dirty without walking the path.
+///
 class VTK_SLICER_BEAMS_LOGIC_EXPORT vtkSlicerIECTransformLogic : public vtkObject
 {
 public:
@@ -68,6 +77,8 @@ public:
 
 
     //TODO: Add all others (in order of chain)
+
+    LastCoordinateSystem // Number of coordinate systems, must be the last
   };
 
 public:
@@ -78,10 +89,23 @@ public:
   /// Set and observe beam node. If a geometry-related parameter changes in the beam node, the transforms are updated
   void SetAndObserveBeamNode(vtkMRMLRTBeamNode* beamNode);
 
-  /// Get transform from one coordinate frame to another
+  /// Get transform from one coordinate frame to another. The transform maps coordinates in the
+  /// from frame to coordinates in the to frame. The output transform is set to the cached matrix,
+  /// which is only recomputed if a transform along the path was modified since the last query.
   /// \return Success flag (false on any error)
   bool GetTransformBetween(CoordinateSystemIdentifier fromFrame, CoordinateSystemIdentifier toFrame, vtkTransform* outputTransform);
 
+  /// Get matrix of the transform from one coordinate frame to another. See \sa GetTransformBetween
+  /// \return Success flag (false on any error)
+  bool GetMatrixBetween(CoordinateSystemIdentifier fromFrame, CoordinateSystemIdentifier toFrame, vtkMatrix4x4* outputMatrix);
+
+  /// Get parent of a coordinate frame in the IEC hierarchy. The fixed reference frame is its own parent
+  CoordinateSystemIdentifier GetParentCoordinateSystem(CoordinateSystemIdentifier frame);
+
+  /// Get transform from a coordinate frame to its parent frame (NULL for the fixed reference frame).
+  /// Modifying the returned transform invalidates the cached matrices of all paths through it
+  vtkTransform* GetTransformToParent(CoordinateSystemIdentifier frame);
+
 public:
   /// Get gantry to fixed reference transform
   vtkGetObjectMacro(GantryToFixedReferenceTransform, vtkTransform);
@@ -106,23 +130,20 @@ protected:
   void UpdateTransformsFromBeamGeometry(vtkMRMLRTBeamNode* beamNode);
 
 protected:
-  /// Set gantry to fixed reference transform
-  vtkSetObjectMacro(GantryToFixedReferenceTransform, vtkTransform);
-  vtkSetObjectMacro(CollimatorToGantryTransform, vtkTransform);
-  vtkSetObjectMacro(LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransform, vtkTransform);
-  vtkSetObjectMacro(LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform, vtkTransform);
-  vtkSetObjectMacro(LeftImagingPanelRotatedToGantryTransform, vtkTransform);
-  vtkSetObjectMacro(LeftImagingPanelTranslationTransform, vtkTransform);
-  vtkSetObjectMacro(RightImagingPanelToRightImagingPanelFixedReferenceIsocenterTransform, vtkTransform);
-  vtkSetObjectMacro(RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform, vtkTransform);
-  vtkSetObjectMacro(RightImagingPanelRotatedToGantryTransform, vtkTransform);
-  vtkSetObjectMacro(RightImagingPanelTranslationTransform, vtkTransform);
-  vtkSetObjectMacro(PatientSupportToFixedReferenceTransform, vtkTransform);
-  vtkSetObjectMacro(PatientSupportScaledTranslatedToTableTopVerticalTranslationTransform, vtkTransform);
-  vtkSetObjectMacro(PatientSupportScaledByTableTopVerticalMovementTransform, vtkTransform);
-  vtkSetObjectMacro(PatientSupportPositiveVerticalTranslationTransform, vtkTransform);
-  vtkSetObjectMacro(TableTopEccentricRotationToPatientSupportTransform, vtkTransform);
-  vtkSetObjectMacro(TableTopToTableTopEccentricRotationTransform, vtkTransform);
+  /// Set parent of a coordinate frame and its transform to the parent, and observe the transform
+  void SetParentCoordinateSystem(CoordinateSystemIdentifier frame, CoordinateSystemIdentifier parentFrame, vtkTransform* transformToParent);
+
+  /// Get matrix from a coordinate frame to the fixed reference frame, recomputing the outdated matrices along the path
+  const double* GetMatrixToFixedReference(CoordinateSystemIdentifier frame);
+
+  /// Get latest modification time of the transforms on the path from a coordinate frame to the fixed reference frame
+  vtkMTimeType GetPathMTime(CoordinateSystemIdentifier frame);
+
+  /// Flag the cached matrices of a coordinate frame and of all frames below it in the hierarchy dirty
+  void InvalidateCoordinateSystem(CoordinateSystemIdentifier frame);
+
+  /// Callback function invalidating the cached matrices when a transform is modified
+  static void OnTransformModified(vtkObject* caller, unsigned long eid, void* clientData, void* callData);
 
 protected:
   /// Gantry to fixed reference transform
@@ -144,6 +165,27 @@ protected:
   vtkTransform* TableTopToTableTopEccentricRotationTransform;
 
   //TODO: All transforms (please include X-ray image receptor too)
+
+  /// Parent of each coordinate frame
+  CoordinateSystemIdentifier CoordinateSystemParents[LastCoordinateSystem];
+  /// Transform from each coordinate frame to its parent (NULL for the fixed reference frame)
+  vtkTransform* TransformsToParent[LastCoordinateSystem];
+
+  /// Cached matrices from each coordinate frame to the fixed reference frame
+  double MatricesToFixedReference[LastCoordinateSystem][16];
+  /// Dirty flags of the matrices to the fixed reference frame
+  bool MatrixToFixedReferenceDirty[LastCoordinateSystem];
+  /// Latest modification time of the transforms on the path when the matrices to the fixed reference frame were computed
+  vtkMTimeType MatrixToFixedReferenceMTime[LastCoordinateSystem];
+  /// Cached matrices between pairs of coordinate frames, indexed by fromFrame*LastCoordinateSystem+toFrame
+  double MatricesBetween[LastCoordinateSystem*LastCoordinateSystem][16];
+  /// Dirty flags of the matrices between pairs of coordinate frames
+  bool MatrixBetweenDirty[LastCoordinateSystem*LastCoordinateSystem];
+  /// Latest modification time of the transforms on the paths when the matrices between pairs of coordinate frames were computed
+  vtkMTimeType MatrixBetweenMTime[LastCoordinateSystem*LastCoordinateSystem];
+
+  /// Command observing the modified events of the transforms
+  vtkCallbackCommand* TransformModifiedCallbackCommand;
                                              
 protected:
   vtkSlicerIECTransformLogic();
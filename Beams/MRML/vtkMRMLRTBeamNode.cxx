@@ -40,10 +40,15 @@
 #include <vtkTransformPolyDataFilter.h>
 #include <vtkDoubleArray.h>
 #include <vtkCellArray.h>
+#include <vtkPoints.h>
 
 // SlicerRt includes
 #include "PlmCommon.h"
 
+// STD includes
+#include <algorithm>
+#include <sstream>
+
 //------------------------------------------------------------------------------
 const char* vtkMRMLRTBeamNode::NEW_BEAM_NODE_NAME_PREFIX = "NewBeam_";
 
@@ -51,6 +56,38 @@ const char* vtkMRMLRTBeamNode::NEW_BEAM_NODE_NAME_PREFIX = "NewBeam_";
 static const char* MLCPOSITION_REFERENCE_ROLE = "MLCPositionRef";
 static const char* DRR_REFERENCE_ROLE = "DRRRef";
 static const char* CONTOUR_BEV_REFERENCE_ROLE = "contourBEVRef";
+static const char* WED_REFERENCE_ROLE = "WEDRef";
+
+//------------------------------------------------------------------------------
+/// Write values separated by spaces (for the control point arrays)
+static void WriteDoubleVector(ostream& of, const std::vector<double>& values)
+{
+  for (std::vector<double>::const_iterator valueIt = values.begin(); valueIt != values.end(); ++valueIt)
+  {
+    of << (valueIt == values.begin() ? "" : " ") << (*valueIt);
+  }
+}
+
+//------------------------------------------------------------------------------
+/// Read values separated by spaces (for the control point arrays)
+static void ReadDoubleVector(const char* valuesString, std::vector<double>& values)
+{
+  values.clear();
+  std::stringstream ss(valuesString);
+  double value = 0.0;
+  while (ss >> value)
+  {
+    values.push_back(value);
+  }
+}
+
+//------------------------------------------------------------------------------
+/// Insert point of the aperture outline into the beam model.
+/// The aperture is defined at the isocenter, and the outline is placed at SAD distance beyond it
+static void InsertAperturePoint(vtkPoints* points, double x, double y, double sad)
+{
+  points->InsertNextPoint(-2.0*y, -2.0*x, -sad);
+}
 
 //------------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLRTBeamNode);
@@ -72,6 +109,9 @@ vtkMRMLRTBeamNode::vtkMRMLRTBeamNode()
   this->CouchAngle = 0.0;
 
   this->SAD = 2000.0;
+
+  this->LeafTravelAlongX = true;
+  this->CurrentControlPoint = -1;
 }
 
 //----------------------------------------------------------------------------
@@ -101,6 +141,24 @@ void vtkMRMLRTBeamNode::WriteXML(ostream& of, int nIndent)
   of << indent << " GantryAngle=\"" << this->GantryAngle << "\"";
   of << indent << " CollimatorAngle=\"" << this->CollimatorAngle << "\"";
   of << indent << " CouchAngle=\"" << this->CouchAngle << "\"";
+
+  of << indent << " LeafTravelAlongX=\"" << (this->LeafTravelAlongX ? "true" : "false") << "\"";
+  of << indent << " LeafPositionBoundaries=\"";
+  WriteDoubleVector(of, this->LeafPositionBoundaries);
+  of << "\"";
+  of << indent << " ControlPointGantryAngles=\"";
+  WriteDoubleVector(of, this->ControlPointGantryAngles);
+  of << "\"";
+  of << indent << " ControlPointCumulativeMetersetWeights=\"";
+  WriteDoubleVector(of, this->ControlPointCumulativeMetersetWeights);
+  of << "\"";
+  of << indent << " ControlPointJawPositions=\"";
+  WriteDoubleVector(of, this->ControlPointJawPositions);
+  of << "\"";
+  of << indent << " ControlPointLeafPositions=\"";
+  WriteDoubleVector(of, this->ControlPointLeafPositions);
+  of << "\"";
+  of << indent << " CurrentControlPoint=\"" << this->CurrentControlPoint << "\"";
 }
 
 //----------------------------------------------------------------------------
@@ -161,6 +219,52 @@ void vtkMRMLRTBeamNode::ReadXMLAttributes(const char** atts)
     {
       this->CouchAngle = vtkVariant(attValue).ToDouble();
     }
+    else if (!strcmp(attName, "LeafTravelAlongX")) 
+    {
+      this->LeafTravelAlongX = (strcmp(attValue, "true") ? false : true);
+    }
+    else if (!strcmp(attName, "LeafPositionBoundaries")) 
+    {
+      ReadDoubleVector(attValue, this->LeafPositionBoundaries);
+    }
+    else if (!strcmp(attName, "ControlPointGantryAngles")) 
+    {
+      ReadDoubleVector(attValue, this->ControlPointGantryAngles);
+    }
+    else if (!strcmp(attName, "ControlPointCumulativeMetersetWeights")) 
+    {
+      ReadDoubleVector(attValue, this->ControlPointCumulativeMetersetWeights);
+    }
+    else if (!strcmp(attName, "ControlPointJawPositions")) 
+    {
+      ReadDoubleVector(attValue, this->ControlPointJawPositions);
+    }
+    else if (!strcmp(attName, "ControlPointLeafPositions")) 
+    {
+      ReadDoubleVector(attValue, this->ControlPointLeafPositions);
+    }
+    else if (!strcmp(attName, "CurrentControlPoint")) 
+    {
+      this->CurrentControlPoint = vtkVariant(attValue).ToInt();
+    }
+  }
+
+  // Make sure the control point arrays are consistent
+  int numberOfControlPoints = this->GetNumberOfControlPoints();
+  if ( (int)this->ControlPointCumulativeMetersetWeights.size() != numberOfControlPoints
+    || (int)this->ControlPointJawPositions.size() != 4*numberOfControlPoints
+    || (int)this->ControlPointLeafPositions.size() != 2*this->GetNumberOfLeafPairs()*numberOfControlPoints )
+  {
+    vtkErrorMacro("ReadXMLAttributes: Inconsistent control point arrays in beam " << (this->Name ? this->Name : "") << ", control points are discarded");
+    this->ControlPointGantryAngles.clear();
+    this->ControlPointCumulativeMetersetWeights.clear();
+    this->ControlPointJawPositions.clear();
+    this->ControlPointLeafPositions.clear();
+    this->LeafPositionBoundaries.clear();
+  }
+  if (this->CurrentControlPoint >= numberOfControlPoints)
+  {
+    this->CurrentControlPoint = -1;
   }
 }
 
@@ -204,6 +308,19 @@ void vtkMRMLRTBeamNode::Copy(vtkMRMLNode *anode)
   this->SetGantryAngle(node->GetGantryAngle());
   this->SetCollimatorAngle(node->GetCollimatorAngle());
   this->SetCouchAngle(node->GetCouchAngle());
+
+  // Copy control points. The beam parameters above are already those of the current control point
+  this->LeafPositionBoundaries = node->LeafPositionBoundaries;
+  this->LeafTravelAlongX = node->LeafTravelAlongX;
+  this->ControlPointGantryAngles = node->ControlPointGantryAngles;
+  this->ControlPointCumulativeMetersetWeights = node->ControlPointCumulativeMetersetWeights;
+  this->ControlPointJawPositions = node->ControlPointJawPositions;
+  this->ControlPointLeafPositions = node->ControlPointLeafPositions;
+  this->CurrentControlPoint = node->CurrentControlPoint;
+  if (this->CurrentControlPoint >= 0)
+  {
+    this->InvokeCustomModifiedEvent(vtkMRMLRTBeamNode::BeamGeometryModified);
+  }
   
   this->DisableModifiedEventOff();
   this->InvokePendingModifiedEvent();
@@ -241,6 +358,11 @@ void vtkMRMLRTBeamNode::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << " GantryAngle:   " << this->GantryAngle << "\n";
   os << indent << " CollimatorAngle:   " << this->CollimatorAngle << "\n";
   os << indent << " CouchAngle:   " << this->CouchAngle << "\n";
+
+  os << indent << " NumberOfLeafPairs:   " << this->GetNumberOfLeafPairs() << "\n";
+  os << indent << " LeafTravelAlongX:   " << (this->LeafTravelAlongX ? "true" : "false") << "\n";
+  os << indent << " NumberOfControlPoints:   " << this->GetNumberOfControlPoints() << "\n";
+  os << indent << " CurrentControlPoint:   " << this->CurrentControlPoint << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -328,6 +450,18 @@ void vtkMRMLRTBeamNode::SetAndObserveContourBEVVolumeNode(vtkMRMLScalarVolumeNod
   this->SetNodeReferenceID(CONTOUR_BEV_REFERENCE_ROLE, (node ? node->GetID() : NULL));
 }
 
+//----------------------------------------------------------------------------
+vtkMRMLScalarVolumeNode* vtkMRMLRTBeamNode::GetWEDVolumeNode()
+{
+  return vtkMRMLScalarVolumeNode::SafeDownCast( this->GetNodeReference(WED_REFERENCE_ROLE) );
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLRTBeamNode::SetAndObserveWEDVolumeNode(vtkMRMLScalarVolumeNode* node)
+{
+  this->SetNodeReferenceID(WED_REFERENCE_ROLE, (node ? node->GetID() : NULL));
+}
+
 //----------------------------------------------------------------------------
 vtkMRMLRTPlanNode* vtkMRMLRTBeamNode::GetParentPlanNode()
 {
@@ -390,6 +524,10 @@ bool vtkMRMLRTBeamNode::CalculateSourcePosition(double source[3])
 //----------------------------------------------------------------------------
 void vtkMRMLRTBeamNode::SetX1Jaw(double x1Jaw)
 {
+  if (this->X1Jaw == x1Jaw)
+  {
+    return;
+  }
   this->X1Jaw = x1Jaw;
   this->Modified();
   this->InvokeCustomModifiedEvent(vtkMRMLRTBeamNode::BeamGeometryModified);
@@ -398,6 +536,10 @@ void vtkMRMLRTBeamNode::SetX1Jaw(double x1Jaw)
 //----------------------------------------------------------------------------
 void vtkMRMLRTBeamNode::SetX2Jaw(double x2Jaw)
 {
+  if (this->X2Jaw == x2Jaw)
+  {
+    return;
+  }
   this->X2Jaw = x2Jaw;
   this->Modified();
   this->InvokeCustomModifiedEvent(vtkMRMLRTBeamNode::BeamGeometryModified);
@@ -406,6 +548,10 @@ void vtkMRMLRTBeamNode::SetX2Jaw(double x2Jaw)
 //----------------------------------------------------------------------------
 void vtkMRMLRTBeamNode::SetY1Jaw(double y1Jaw)
 {
+  if (this->Y1Jaw == y1Jaw)
+  {
+    return;
+  }
   this->Y1Jaw = y1Jaw;
   this->Modified();
   this->InvokeCustomModifiedEvent(vtkMRMLRTBeamNode::BeamGeometryModified);
@@ -414,6 +560,10 @@ void vtkMRMLRTBeamNode::SetY1Jaw(double y1Jaw)
 //----------------------------------------------------------------------------
 void vtkMRMLRTBeamNode::SetY2Jaw(double y2Jaw)
 {
+  if (this->Y2Jaw == y2Jaw)
+  {
+    return;
+  }
   this->Y2Jaw = y2Jaw;
   this->Modified();
   this->InvokeCustomModifiedEvent(vtkMRMLRTBeamNode::BeamGeometryModified);
@@ -422,6 +572,10 @@ void vtkMRMLRTBeamNode::SetY2Jaw(double y2Jaw)
 //----------------------------------------------------------------------------
 void vtkMRMLRTBeamNode::SetGantryAngle(double angle)
 {
+  if (this->GantryAngle == angle)
+  {
+    return;
+  }
   this->GantryAngle = angle;
   this->Modified();
   this->InvokeCustomModifiedEvent(vtkMRMLRTBeamNode::BeamTransformModified);
@@ -430,6 +584,10 @@ void vtkMRMLRTBeamNode::SetGantryAngle(double angle)
 //----------------------------------------------------------------------------
 void vtkMRMLRTBeamNode::SetCollimatorAngle(double angle)
 {
+  if (this->CollimatorAngle == angle)
+  {
+    return;
+  }
   this->CollimatorAngle = angle;
   this->Modified();
   this->InvokeCustomModifiedEvent(vtkMRMLRTBeamNode::BeamTransformModified);
@@ -438,6 +596,10 @@ void vtkMRMLRTBeamNode::SetCollimatorAngle(double angle)
 //----------------------------------------------------------------------------
 void vtkMRMLRTBeamNode::SetCouchAngle(double angle)
 {
+  if (this->CouchAngle == angle)
+  {
+    return;
+  }
   this->CouchAngle = angle;
   this->Modified();
   this->InvokeCustomModifiedEvent(vtkMRMLRTBeamNode::BeamTransformModified);
@@ -446,45 +608,317 @@ void vtkMRMLRTBeamNode::SetCouchAngle(double angle)
 //----------------------------------------------------------------------------
 void vtkMRMLRTBeamNode::SetSAD(double sad)
 {
+  if (this->SAD == sad)
+  {
+    return;
+  }
   this->SAD = sad;
   this->Modified();
   this->InvokeCustomModifiedEvent(vtkMRMLRTBeamNode::BeamGeometryModified);
 }
 
 //----------------------------------------------------------------------------
-void vtkMRMLRTBeamNode::UpdateTransform()
+void vtkMRMLRTBeamNode::SetLeafPositionBoundaries(int numberOfLeafPairs, const double* boundaries, bool leafTravelAlongX)
 {
-  if (!this->GetScene())
+  if (numberOfLeafPairs < 0 || (numberOfLeafPairs > 0 && !boundaries))
   {
-    vtkErrorMacro("UpdateTransform: Invalid MRML scene");
+    vtkErrorMacro("SetLeafPositionBoundaries: Invalid leaf pair boundaries");
     return;
   }
 
-  // Make sure transform node exists
-  this->CreateDefaultTransformNode();
+  if (numberOfLeafPairs > 0)
+  {
+    this->LeafPositionBoundaries.assign(boundaries, boundaries + numberOfLeafPairs + 1);
+  }
+  else
+  {
+    this->LeafPositionBoundaries.clear();
+  }
+  this->LeafTravelAlongX = leafTravelAlongX;
+
+  // Leaf positions of the control points are reset for the new leaves
+  this->ControlPointLeafPositions.assign(2 * numberOfLeafPairs * this->ControlPointGantryAngles.size(), 0.0);
+
+  this->Modified();
+  this->InvokeCustomModifiedEvent(vtkMRMLRTBeamNode::BeamGeometryModified);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLRTBeamNode::SetNumberOfControlPoints(int numberOfControlPoints)
+{
+  if (numberOfControlPoints < 0)
+  {
+    vtkErrorMacro("SetNumberOfControlPoints: Invalid number of control points " << numberOfControlPoints);
+    return;
+  }
+
+  int oldNumberOfControlPoints = this->GetNumberOfControlPoints();
+  if (numberOfControlPoints == oldNumberOfControlPoints)
+  {
+    return;
+  }
+
+  this->ControlPointGantryAngles.resize(numberOfControlPoints, this->GantryAngle);
+  this->ControlPointCumulativeMetersetWeights.resize(numberOfControlPoints, 0.0);
+  this->ControlPointJawPositions.resize(4 * numberOfControlPoints);
+  for (int controlPointIndex = oldNumberOfControlPoints; controlPointIndex < numberOfControlPoints; ++controlPointIndex)
+  {
+    this->ControlPointJawPositions[4*controlPointIndex] = this->X1Jaw;
+    this->ControlPointJawPositions[4*controlPointIndex+1] = this->X2Jaw;
+    this->ControlPointJawPositions[4*controlPointIndex+2] = this->Y1Jaw;
+    this->ControlPointJawPositions[4*controlPointIndex+3] = this->Y2Jaw;
+  }
+  this->ControlPointLeafPositions.resize(2 * this->GetNumberOfLeafPairs() * numberOfControlPoints, 0.0);
+
+  if (this->CurrentControlPoint >= numberOfControlPoints)
+  {
+    // The beam parameters stay those of the removed control point
+    this->CurrentControlPoint = -1;
+  }
+
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLRTBeamNode::IsValidControlPoint(int controlPointIndex, const char* methodName)
+{
+  if (controlPointIndex < 0 || controlPointIndex >= this->GetNumberOfControlPoints())
+  {
+    vtkErrorMacro(methodName << ": Invalid control point index " << controlPointIndex
+      << " (number of control points: " << this->GetNumberOfControlPoints() << ")");
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLRTBeamNode::SetControlPoint(int controlPointIndex, double gantryAngle, double cumulativeMetersetWeight,
+  const double jawPositions[4], const double* leafPositions)
+{
+  if (!this->IsValidControlPoint(controlPointIndex, "SetControlPoint"))
+  {
+    return;
+  }
+  if (!jawPositions)
+  {
+    vtkErrorMacro("SetControlPoint: Invalid jaw positions");
+    return;
+  }
+
+  this->ControlPointGantryAngles[controlPointIndex] = gantryAngle;
+  this->ControlPointCumulativeMetersetWeights[controlPointIndex] = cumulativeMetersetWeight;
+  std::copy(jawPositions, jawPositions + 4, this->ControlPointJawPositions.begin() + 4*controlPointIndex);
+
+  int numberOfLeafPositions = 2 * this->GetNumberOfLeafPairs();
+  if (leafPositions && numberOfLeafPositions > 0)
+  {
+    std::copy(leafPositions, leafPositions + numberOfLeafPositions,
+      this->ControlPointLeafPositions.begin() + numberOfLeafPositions*controlPointIndex);
+  }
+
+  this->Modified();
+
+  if (controlPointIndex == this->CurrentControlPoint)
+  {
+    this->ApplyCurrentControlPoint();
+  }
+}
+
+//----------------------------------------------------------------------------
+double vtkMRMLRTBeamNode::GetControlPointGantryAngle(int controlPointIndex)
+{
+  if (!this->IsValidControlPoint(controlPointIndex, "GetControlPointGantryAngle"))
+  {
+    return 0.0;
+  }
+  return this->ControlPointGantryAngles[controlPointIndex];
+}
+
+//----------------------------------------------------------------------------
+double vtkMRMLRTBeamNode::GetControlPointCumulativeMetersetWeight(int controlPointIndex)
+{
+  if (!this->IsValidControlPoint(controlPointIndex, "GetControlPointCumulativeMetersetWeight"))
+  {
+    return 0.0;
+  }
+  return this->ControlPointCumulativeMetersetWeights[controlPointIndex];
+}
+
+//----------------------------------------------------------------------------
+double vtkMRMLRTBeamNode::GetControlPointMetersetFraction(int controlPointIndex)
+{
+  if (!this->IsValidControlPoint(controlPointIndex, "GetControlPointMetersetFraction"))
+  {
+    return 0.0;
+  }
+
+  // The final cumulative meterset weight corresponds to the whole beam meterset
+  double finalCumulativeMetersetWeight = this->ControlPointCumulativeMetersetWeights.back();
+  if (controlPointIndex == this->GetNumberOfControlPoints() - 1 || finalCumulativeMetersetWeight <= 0.0)
+  {
+    return 0.0;
+  }
+  return ( this->ControlPointCumulativeMetersetWeights[controlPointIndex+1]
+    - this->ControlPointCumulativeMetersetWeights[controlPointIndex] ) / finalCumulativeMetersetWeight;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLRTBeamNode::GetControlPointJawPositions(int controlPointIndex, double jawPositions[4])
+{
+  if (!this->IsValidControlPoint(controlPointIndex, "GetControlPointJawPositions"))
+  {
+    return false;
+  }
+  std::copy(this->ControlPointJawPositions.begin() + 4*controlPointIndex,
+    this->ControlPointJawPositions.begin() + 4*controlPointIndex + 4, jawPositions);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+const double* vtkMRMLRTBeamNode::GetControlPointLeafPositions(int controlPointIndex)
+{
+  if (!this->IsValidControlPoint(controlPointIndex, "GetControlPointLeafPositions"))
+  {
+    return NULL;
+  }
+  int numberOfLeafPositions = 2 * this->GetNumberOfLeafPairs();
+  if (numberOfLeafPositions == 0)
+  {
+    return NULL;
+  }
+  return &this->ControlPointLeafPositions[numberOfLeafPositions*controlPointIndex];
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLRTBeamNode::SetCurrentControlPoint(int controlPointIndex)
+{
+  if (controlPointIndex != -1 && !this->IsValidControlPoint(controlPointIndex, "SetCurrentControlPoint"))
+  {
+    return;
+  }
+  if (this->CurrentControlPoint == controlPointIndex)
+  {
+    return;
+  }
+
+  this->CurrentControlPoint = controlPointIndex;
+  this->Modified();
+
+  if (controlPointIndex == -1)
+  {
+    // The leaves are not taken from the control point any more
+    this->InvokeCustomModifiedEvent(vtkMRMLRTBeamNode::BeamGeometryModified);
+    return;
+  }
+  this->ApplyCurrentControlPoint();
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLRTBeamNode::ApplyCurrentControlPoint()
+{
+  int controlPointIndex = this->CurrentControlPoint;
+  if (controlPointIndex < 0 || controlPointIndex >= this->GetNumberOfControlPoints())
+  {
+    return;
+  }
+
+  // Compress the events so that the transform and the model are regenerated only once
+  int disabledModify = this->StartModify();
+
+  const double* jawPositions = &this->ControlPointJawPositions[4*controlPointIndex];
+  this->SetX1Jaw(jawPositions[0]);
+  this->SetX2Jaw(jawPositions[1]);
+  this->SetY1Jaw(jawPositions[2]);
+  this->SetY2Jaw(jawPositions[3]);
+  this->SetGantryAngle(this->ControlPointGantryAngles[controlPointIndex]);
+
+  // Leaf positions are not beam parameters, so the model update is requested explicitly
+  this->InvokeCustomModifiedEvent(vtkMRMLRTBeamNode::BeamGeometryModified);
+
+  this->EndModify(disabledModify);
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLRTBeamNode::CreateControlPointBeamPolyData(int controlPointIndex, vtkPolyData* beamModelPolyData)
+{
+  if (!this->IsValidControlPoint(controlPointIndex, "CreateControlPointBeamPolyData"))
+  {
+    return false;
+  }
+  if (!beamModelPolyData)
+  {
+    vtkErrorMacro("CreateControlPointBeamPolyData: Invalid beam model poly data");
+    return false;
+  }
+
+  this->CreateAperturePolyData( &this->ControlPointJawPositions[4*controlPointIndex], this->GetNumberOfLeafPairs(),
+    this->GetLeafPositionBoundaries(), this->GetControlPointLeafPositions(controlPointIndex),
+    this->LeafTravelAlongX, beamModelPolyData );
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLRTBeamNode::GetControlPointBeamTransform(int controlPointIndex, vtkTransform* beamTransform)
+{
+  if (!this->IsValidControlPoint(controlPointIndex, "GetControlPointBeamTransform"))
+  {
+    return false;
+  }
+
+  return this->CalculateBeamTransform(this->ControlPointGantryAngles[controlPointIndex], this->CollimatorAngle, beamTransform);
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLRTBeamNode::CalculateBeamTransform(double gantryAngle, double collimatorAngle, vtkTransform* beamTransform)
+{
+  if (!beamTransform)
+  {
+    vtkErrorMacro("CalculateBeamTransform: Invalid output transform");
+    return false;
+  }
 
   // Get isocenter
   double isocenterPosition[3] = {0.0,0.0,0.0};
   if (!this->GetPlanIsocenterPosition(isocenterPosition))
   {
-    vtkErrorMacro("UpdateTransform: Failed to get isocenter position");
-    return;
+    vtkErrorMacro("CalculateBeamTransform: Failed to get isocenter position");
+    return false;
   }
 
-  //TODO: Awful names for transforms. They should be barToFooTransform
   //TODO: Use IEC logic
-  vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
-  transform->Identity();
-  transform->RotateZ(this->GantryAngle);
-  transform->RotateY(this->CollimatorAngle);
-  transform->RotateX(-90);
+  beamTransform->Identity();
+  beamTransform->PreMultiply();
+  beamTransform->RotateZ(gantryAngle);
+  beamTransform->RotateY(collimatorAngle);
+  beamTransform->RotateX(-90);
+
+  vtkSmartPointer<vtkTransform> isocenterTranslation = vtkSmartPointer<vtkTransform>::New();
+  isocenterTranslation->Identity();
+  isocenterTranslation->Translate(isocenterPosition[0], isocenterPosition[1], isocenterPosition[2]);
+
+  beamTransform->PostMultiply();
+  beamTransform->Concatenate(isocenterTranslation->GetMatrix());
+  return true;
+}
 
-  vtkSmartPointer<vtkTransform> transform2 = vtkSmartPointer<vtkTransform>::New();
-  transform2->Identity();
-  transform2->Translate(isocenterPosition[0], isocenterPosition[1], isocenterPosition[2]);
+//----------------------------------------------------------------------------
+void vtkMRMLRTBeamNode::UpdateTransform()
+{
+  if (!this->GetScene())
+  {
+    vtkErrorMacro("UpdateTransform: Invalid MRML scene");
+    return;
+  }
+
+  // Make sure transform node exists
+  this->CreateDefaultTransformNode();
 
-  transform->PostMultiply();
-  transform->Concatenate(transform2->GetMatrix());
+  vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
+  if (!this->CalculateBeamTransform(this->GantryAngle, this->CollimatorAngle, transform))
+  {
+    vtkErrorMacro("UpdateTransform: Failed to calculate beam transform");
+    return;
+  }
 
   // Get transform node
   vtkMRMLLinearTransformNode* transformNode = vtkMRMLLinearTransformNode::SafeDownCast(
@@ -520,136 +954,144 @@ void vtkMRMLRTBeamNode::CreateBeamPolyData(vtkPolyData* beamModelPolyData)
     return;
   }
 
-  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
-  vtkSmartPointer<vtkCellArray> cellArray = vtkSmartPointer<vtkCellArray>::New();
+  // The jaws of the current control point are already applied to the beam parameters
+  double jawPositions[4] = { this->X1Jaw, this->X2Jaw, this->Y1Jaw, this->Y2Jaw };
 
-  vtkMRMLDoubleArrayNode* mlcArrayNode = this->GetMLCPositionDoubleArrayNode();
-  if (mlcArrayNode)
+  // Leaves of the current control point
+  int numberOfLeafPairs = this->GetNumberOfLeafPairs();
+  if ( numberOfLeafPairs > 0 && this->CurrentControlPoint >= 0
+    && this->CurrentControlPoint < this->GetNumberOfControlPoints() )
   {
-    // First we extract the shape of the MLC
-    int x1count = this->X1Jaw/10.0;
-    int x2count = this->X2Jaw/10.0;
-    int numLeavesVisible = x2count - x1count; // Calculate the number of leaves visible
-    int numPointsEachSide = numLeavesVisible *2;
-
-    double y2LeafPosition[40];
-    double y1LeafPosition[40];
+    this->CreateAperturePolyData( jawPositions, numberOfLeafPairs, this->GetLeafPositionBoundaries(),
+      this->GetControlPointLeafPositions(this->CurrentControlPoint), this->LeafTravelAlongX, beamModelPolyData );
+    return;
+  }
 
-    // Calculate Y2 first
-    for (int i = x2count; i >= x1count; i--)
+  // Leaves of the MLC position array: 10mm wide leaf pairs centered on the beam axis, travelling along Y.
+  // The first and second components contain the positions of the Y1 and Y2 side leaves
+  vtkMRMLDoubleArrayNode* mlcArrayNode = this->GetMLCPositionDoubleArrayNode();
+  if (mlcArrayNode && mlcArrayNode->GetArray() && mlcArrayNode->GetArray()->GetNumberOfTuples() > 0)
+  {
+    vtkDoubleArray* mlcArray = mlcArrayNode->GetArray();
+    int numberOfArrayLeafPairs = (int)mlcArray->GetNumberOfTuples();
+    std::vector<double> boundaries(numberOfArrayLeafPairs + 1, 0.0);
+    for (int boundaryIndex = 0; boundaryIndex <= numberOfArrayLeafPairs; ++boundaryIndex)
     {
-      double leafPosition = mlcArrayNode->GetArray()->GetComponent(-(i-20), 1);
-      if (leafPosition < this->Y2Jaw)
-      {
-        y2LeafPosition[-(i-20)] = leafPosition;
-      }
-      else
-      {
-        y2LeafPosition[-(i-20)] = this->Y2Jaw;
-      }
+      boundaries[boundaryIndex] = 10.0 * boundaryIndex - 5.0 * numberOfArrayLeafPairs;
     }
-    // Calculate Y1 next
-    for (int i = x2count; i >= x1count; i--)
+    std::vector<double> leafPositions(2 * numberOfArrayLeafPairs, 0.0);
+    for (int leafPairIndex = 0; leafPairIndex < numberOfArrayLeafPairs; ++leafPairIndex)
     {
-      double leafPosition = mlcArrayNode->GetArray()->GetComponent(-(i-20), 0);
-      if (leafPosition < this->Y1Jaw)
-      {
-        y1LeafPosition[-(i-20)] = leafPosition;
-      }
-      else
-      {
-        y1LeafPosition[-(i-20)] = this->Y1Jaw;
-      }
+      leafPositions[leafPairIndex] = mlcArray->GetComponent(leafPairIndex, 0);
+      leafPositions[numberOfArrayLeafPairs + leafPairIndex] = mlcArray->GetComponent(leafPairIndex, 1);
     }
 
-    // Create beam model
-    points->InsertPoint(0,0,0,this->SAD);
+    this->CreateAperturePolyData( jawPositions, numberOfArrayLeafPairs, &boundaries[0], &leafPositions[0], false,
+      beamModelPolyData );
+    return;
+  }
 
-    int count = 1;
-    for (int i = x2count; i > x1count; i--)
+  // Jaws only
+  this->CreateAperturePolyData(jawPositions, 0, NULL, NULL, false, beamModelPolyData);
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLRTBeamNode::CreateAperturePolyData( const double jawPositions[4], int numberOfLeafPairs,
+  const double* boundaries, const double* leafPositions, bool leafTravelAlongX, vtkPolyData* beamModelPolyData )
+{
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  vtkSmartPointer<vtkCellArray> cellArray = vtkSmartPointer<vtkCellArray>::New();
+
+  // Source
+  points->InsertNextPoint(0, 0, this->SAD);
+
+  if (numberOfLeafPairs > 0 && boundaries && leafPositions)
+  {
+    // Jaw limits along and across the leaf travel direction
+    double travelMin = (leafTravelAlongX ? jawPositions[0] : jawPositions[2]);
+    double travelMax = (leafTravelAlongX ? jawPositions[1] : jawPositions[3]);
+    double acrossMin = (leafTravelAlongX ? jawPositions[2] : jawPositions[0]);
+    double acrossMax = (leafTravelAlongX ? jawPositions[3] : jawPositions[1]);
+
+    // Collect the leaf pairs between the jaws (lower and upper boundary, first and second leaf position),
+    // with the leaf positions clipped by the jaws
+    std::vector<double> visibleLeafPairs;
+    for (int leafPairIndex = 0; leafPairIndex < numberOfLeafPairs; ++leafPairIndex)
     {
-      points->InsertPoint(count,-y2LeafPosition[-(i-20)]*2, i*10*2, -this->SAD );
-      count ++;
-      points->InsertPoint(count,-y2LeafPosition[-(i-20)]*2, (i-1)*10*2, -this->SAD );
-      count ++;
+      double lowerBoundary = std::max(boundaries[leafPairIndex], acrossMin);
+      double upperBoundary = std::min(boundaries[leafPairIndex+1], acrossMax);
+      if (upperBoundary <= lowerBoundary)
+      {
+        continue;
+      }
+      double firstLeafPosition = std::min(std::max(leafPositions[leafPairIndex], travelMin), travelMax);
+      double secondLeafPosition = std::min(std::max(leafPositions[numberOfLeafPairs+leafPairIndex], firstLeafPosition), travelMax);
+      visibleLeafPairs.push_back(lowerBoundary);
+      visibleLeafPairs.push_back(upperBoundary);
+      visibleLeafPairs.push_back(firstLeafPosition);
+      visibleLeafPairs.push_back(secondLeafPosition);
     }
 
-    for (int i = x1count; i < x2count; i++)
+    // Aperture outline: second leaf bank along the leaf pairs, then first leaf bank back
+    int numberOfVisibleLeafPairs = (int)visibleLeafPairs.size() / 4;
+    for (int visibleIndex = 0; visibleIndex < numberOfVisibleLeafPairs; ++visibleIndex)
     {
-      points->InsertPoint(count,y1LeafPosition[-(i-20)]*2, i*10*2, -this->SAD );
-      count ++;
-      points->InsertPoint(count,y1LeafPosition[-(i-20)]*2, (i+1)*10*2, -this->SAD );
-      count ++;
+      const double* leafPair = &visibleLeafPairs[4*visibleIndex];
+      for (int boundaryIndex = 0; boundaryIndex < 2; ++boundaryIndex)
+      {
+        if (leafTravelAlongX)
+        {
+          InsertAperturePoint(points, leafPair[3], leafPair[boundaryIndex], this->SAD);
+        }
+        else
+        {
+          InsertAperturePoint(points, leafPair[boundaryIndex], leafPair[3], this->SAD);
+        }
+      }
     }
-
-    for (int i = 1; i <numPointsEachSide; i++)
+    for (int visibleIndex = numberOfVisibleLeafPairs - 1; visibleIndex >= 0; --visibleIndex)
     {
-      cellArray->InsertNextCell(3);
-      cellArray->InsertCellPoint(0);
-      cellArray->InsertCellPoint(i);
-      cellArray->InsertCellPoint(i+1);
+      const double* leafPair = &visibleLeafPairs[4*visibleIndex];
+      for (int boundaryIndex = 1; boundaryIndex >= 0; --boundaryIndex)
+      {
+        if (leafTravelAlongX)
+        {
+          InsertAperturePoint(points, leafPair[2], leafPair[boundaryIndex], this->SAD);
+        }
+        else
+        {
+          InsertAperturePoint(points, leafPair[boundaryIndex], leafPair[2], this->SAD);
+        }
+      }
     }
-    // Add connection between Y2 and Y1
-    cellArray->InsertNextCell(3);
-    cellArray->InsertCellPoint(0);
-    cellArray->InsertCellPoint(numPointsEachSide);
-    cellArray->InsertCellPoint(numPointsEachSide+1);
-    for (int i = numPointsEachSide+1; i <2*numPointsEachSide; i++)
+  }
+  else
+  {
+    InsertAperturePoint(points, jawPositions[1], jawPositions[3], this->SAD);
+    InsertAperturePoint(points, jawPositions[0], jawPositions[3], this->SAD);
+    InsertAperturePoint(points, jawPositions[0], jawPositions[2], this->SAD);
+    InsertAperturePoint(points, jawPositions[1], jawPositions[2], this->SAD);
+  }
+
+  // Sides connecting the source with the aperture outline
+  int numberOfOutlinePoints = points->GetNumberOfPoints() - 1;
+  if (numberOfOutlinePoints > 0)
+  {
+    for (int outlineIndex = 1; outlineIndex <= numberOfOutlinePoints; ++outlineIndex)
     {
       cellArray->InsertNextCell(3);
       cellArray->InsertCellPoint(0);
-      cellArray->InsertCellPoint(i);
-      cellArray->InsertCellPoint(i+1);
+      cellArray->InsertCellPoint(outlineIndex);
+      cellArray->InsertCellPoint(outlineIndex % numberOfOutlinePoints + 1);
     }
 
-    // Add connection between Y2 and Y1
-    cellArray->InsertNextCell(3);
-    cellArray->InsertCellPoint(0);
-    cellArray->InsertCellPoint(2*numPointsEachSide);
-    cellArray->InsertCellPoint(1);
-
     // Add the cap to the bottom
-    cellArray->InsertNextCell(2*numPointsEachSide);
-    for (int i = 1; i <= 2*numPointsEachSide; i++)
+    cellArray->InsertNextCell(numberOfOutlinePoints);
+    for (int outlineIndex = 1; outlineIndex <= numberOfOutlinePoints; ++outlineIndex)
     {
-      cellArray->InsertCellPoint(i);
+      cellArray->InsertCellPoint(outlineIndex);
     }
   }
-  else
-  {
-    points->InsertPoint(0,0,0,this->SAD);
-    points->InsertPoint(1, -2*this->Y2Jaw, -2*this->X2Jaw, -this->SAD );
-    points->InsertPoint(2, -2*this->Y2Jaw, -2*this->X1Jaw, -this->SAD );
-    points->InsertPoint(3, -2*this->Y1Jaw, -2*this->X1Jaw, -this->SAD );
-    points->InsertPoint(4, -2*this->Y1Jaw, -2*this->X2Jaw, -this->SAD );
-
-    cellArray->InsertNextCell(3);
-    cellArray->InsertCellPoint(0);
-    cellArray->InsertCellPoint(1);
-    cellArray->InsertCellPoint(2);
-
-    cellArray->InsertNextCell(3);
-    cellArray->InsertCellPoint(0);
-    cellArray->InsertCellPoint(2);
-    cellArray->InsertCellPoint(3);
-
-    cellArray->InsertNextCell(3);
-    cellArray->InsertCellPoint(0);
-    cellArray->InsertCellPoint(3);
-    cellArray->InsertCellPoint(4);
-
-    cellArray->InsertNextCell(3);
-    cellArray->InsertCellPoint(0);
-    cellArray->InsertCellPoint(4);
-    cellArray->InsertCellPoint(1);
-
-    // Add the cap to the bottom
-    cellArray->InsertNextCell(4);
-    cellArray->InsertCellPoint(1);
-    cellArray->InsertCellPoint(2);
-    cellArray->InsertCellPoint(3);
-    cellArray->InsertCellPoint(4);
-  }
 
   beamModelPolyData->SetPoints(points);
   beamModelPolyData->SetPolys(cellArray);
@@ -666,3 +1108,12 @@ void vtkMRMLRTBeamNode::RequestCloning()
     this->GetDisplayNode()->Modified();
   }
 }
+
+//---------------------------------------------------------------------------
+std::string vtkMRMLRTBeamNode::RequestDRRUpdate()
+{
+  // Kept if no logic processes the event
+  std::string errorMessage("DRR update is not available (External Beam Planning module not loaded)");
+  this->InvokeEvent(vtkMRMLRTBeamNode::DRRUpdateRequested, &errorMessage);
+  return errorMessage;
+}
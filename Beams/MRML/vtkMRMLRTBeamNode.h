@@ -28,7 +28,12 @@
 // MRML includes
 #include <vtkMRMLModelNode.h>
 
+// STD includes
+#include <string>
+#include <vector>
+
 class vtkPolyData;
+class vtkTransform;
 class vtkMRMLScene;
 class vtkMRMLDoubleArrayNode;
 class vtkMRMLRTPlanNode;
@@ -36,6 +41,13 @@ class vtkMRMLScalarVolumeNode;
 class vtkMRMLSegmentationNode;
 
 /// \ingroup SlicerRt_QtModules_Beams
+/// \brief RT beam node. The beam model is generated from the jaw and MLC parameters and placed by the beam transform.
+///
+/// Dynamic beams (e.g. VMAT arcs) store their control points in contiguous arrays: gantry angle, cumulative
+/// meterset weight, jaw positions and MLC leaf positions of each control point. The beam model and transform
+/// are only generated for the current control point (\sa SetCurrentControlPoint), and for any other control point
+/// on request (\sa CreateControlPointBeamPolyData, \sa GetControlPointBeamTransform), so the memory used by the
+/// geometry does not depend on the number of control points.
 class VTK_SLICER_BEAMS_MODULE_MRML_EXPORT vtkMRMLRTBeamNode : public vtkMRMLModelNode
 {
 public:
@@ -49,7 +61,10 @@ public:
     BeamTransformModified,
     /// Invoke if the beam is to be cloned.
     /// External Beam Planning logic processes the event if exists
-    CloningRequested
+    CloningRequested,
+    /// Invoke if the DRR of the beam is to be updated. The call data is a pointer to the std::string
+    /// error message, which External Beam Planning logic clears on success if exists
+    DRRUpdateRequested
   };
 
 public:
@@ -96,6 +111,11 @@ public:
   /// clones the beam if exists
   void RequestCloning();
 
+  /// Invoke DRR update requested event. External Beam Planning logic processes the event and
+  /// updates the DRR volume of the beam if exists
+  /// \return Error message, empty string on success
+  std::string RequestDRRUpdate();
+
 public:
   /// Get parent plan node
   vtkMRMLRTPlanNode* GetParentPlanNode();
@@ -116,6 +136,11 @@ public:
   /// Set and observe contour BEV node
   void SetAndObserveContourBEVVolumeNode(vtkMRMLScalarVolumeNode* node);
 
+  /// Get water equivalent depth (WED) volume node
+  vtkMRMLScalarVolumeNode* GetWEDVolumeNode();
+  /// Set and observe water equivalent depth (WED) volume node
+  void SetAndObserveWEDVolumeNode(vtkMRMLScalarVolumeNode* node);
+
   /// Get isocenter position from parent plan
   /// \return Success flag
   bool GetPlanIsocenterPosition(double isocenter[3]);
@@ -126,6 +151,10 @@ public:
 
 // Beam parameters
 public:
+  // The geometry setters only invoke the events if the value changes. The events are compressed between
+  // StartModify and EndModify, so setting several parameters regenerates the beam transform and model once.
+  // To modify multiple beams of a plan in a batch, use vtkMRMLRTPlanNode::StartBeamsModify
+
   /// Get beam number
   vtkGetMacro(BeamNumber, int);
   /// Set beam number
@@ -181,10 +210,78 @@ public:
   /// Set beam weight
   vtkSetMacro(BeamWeight, double);
 
+// Control points
+public:
+  /// Set MLC leaf pairs and clear the leaf positions of the control points
+  /// \param numberOfLeafPairs Number of leaf pairs (0 if there is no MLC)
+  /// \param boundaries Leaf pair boundaries in ascending order perpendicular to the leaf travel direction
+  ///   (numberOfLeafPairs+1 values, mm at isocenter)
+  /// \param leafTravelAlongX True if the leaves travel along the X jaws (DICOM MLCX), false if along Y (MLCY)
+  void SetLeafPositionBoundaries(int numberOfLeafPairs, const double* boundaries, bool leafTravelAlongX);
+  /// Get number of MLC leaf pairs
+  int GetNumberOfLeafPairs() { return this->LeafPositionBoundaries.empty() ? 0 : (int)this->LeafPositionBoundaries.size()-1; };
+  /// Get MLC leaf pair boundaries (number of leaf pairs + 1 values), NULL if there is no MLC
+  const double* GetLeafPositionBoundaries() { return this->LeafPositionBoundaries.empty() ? NULL : &this->LeafPositionBoundaries[0]; };
+  /// Get leaf travel direction flag (true if along X)
+  vtkGetMacro(LeafTravelAlongX, bool);
+
+  /// Set number of control points. New control points are initialized from the current beam parameters
+  void SetNumberOfControlPoints(int numberOfControlPoints);
+  /// Get number of control points (0 for beams defined only by the beam parameters)
+  int GetNumberOfControlPoints() { return (int)this->ControlPointGantryAngles.size(); };
+
+  /// Set parameters of a control point. Updates the beam if it is the current control point
+  /// \param jawPositions X1, X2, Y1, Y2 jaw positions
+  /// \param leafPositions Positions of the first then the second leaf bank (2 * number of leaf pairs values),
+  ///   ignored if NULL or there is no MLC
+  void SetControlPoint(int controlPointIndex, double gantryAngle, double cumulativeMetersetWeight,
+    const double jawPositions[4], const double* leafPositions);
+  /// Get gantry angle of a control point
+  double GetControlPointGantryAngle(int controlPointIndex);
+  /// Get cumulative meterset weight of a control point
+  double GetControlPointCumulativeMetersetWeight(int controlPointIndex);
+  /// Get fraction of the beam meterset delivered between a control point and the next one
+  double GetControlPointMetersetFraction(int controlPointIndex);
+  /// Get jaw positions (X1, X2, Y1, Y2) of a control point
+  /// \return Success flag
+  bool GetControlPointJawPositions(int controlPointIndex, double jawPositions[4]);
+  /// Get leaf positions of a control point (first then second leaf bank), NULL if there is no MLC
+  const double* GetControlPointLeafPositions(int controlPointIndex);
+
+  /// Set control point the beam model and transform are generated for. The gantry angle and jaw positions
+  /// of the control point are applied to the beam parameters. -1 means the beam parameters are used as they are
+  void SetCurrentControlPoint(int controlPointIndex);
+  /// Get control point the beam model and transform are generated for (-1 if none)
+  vtkGetMacro(CurrentControlPoint, int);
+
+  /// Create beam model of a control point without changing the current control point (e.g. for dose engines)
+  /// \return Success flag
+  bool CreateControlPointBeamPolyData(int controlPointIndex, vtkPolyData* beamModelPolyData);
+  /// Get beam transform (beam to RAS) of a control point without changing the current control point
+  /// \return Success flag
+  bool GetControlPointBeamTransform(int controlPointIndex, vtkTransform* beamTransform);
+
 protected:
-  /// Create beam model from beam parameters, supporting MLC leaves
+  /// Create beam model from beam parameters, supporting MLC leaves.
+  /// The leaf positions are taken from the current control point, or from the MLC position double array node
   void CreateBeamPolyData(vtkPolyData* beamModelPolyData);
 
+  /// Create beam model of a jaw and MLC aperture
+  /// \param jawPositions X1, X2, Y1, Y2 jaw positions
+  /// \param leafPositions Positions of the first then the second leaf bank, NULL if there is no MLC
+  void CreateAperturePolyData(const double jawPositions[4], int numberOfLeafPairs, const double* boundaries,
+    const double* leafPositions, bool leafTravelAlongX, vtkPolyData* beamModelPolyData);
+
+  /// Calculate beam transform (beam to RAS) from gantry and collimator angles and the plan isocenter
+  /// \return Success flag
+  bool CalculateBeamTransform(double gantryAngle, double collimatorAngle, vtkTransform* beamTransform);
+
+  /// Apply gantry angle and jaw positions of the current control point to the beam parameters
+  void ApplyCurrentControlPoint();
+
+  /// Check control point index and print error if invalid
+  bool IsValidControlPoint(int controlPointIndex, const char* methodName);
+
 protected:
   vtkMRMLRTBeamNode();
   ~vtkMRMLRTBeamNode();
@@ -217,6 +314,21 @@ protected:
   double CollimatorAngle;
   /// Couch angle
   double CouchAngle;
+
+  /// MLC leaf pair boundaries (number of leaf pairs + 1 values)
+  std::vector<double> LeafPositionBoundaries;
+  /// Flag indicating whether the leaves travel along X (or Y)
+  bool LeafTravelAlongX;
+  /// Gantry angle of each control point
+  std::vector<double> ControlPointGantryAngles;
+  /// Cumulative meterset weight of each control point
+  std::vector<double> ControlPointCumulativeMetersetWeights;
+  /// Jaw positions of the control points (X1, X2, Y1, Y2 per control point)
+  std::vector<double> ControlPointJawPositions;
+  /// Leaf positions of the control points (2 * number of leaf pairs values per control point)
+  std::vector<double> ControlPointLeafPositions;
+  /// Control point the beam model and transform are generated for (-1 if none)
+  int CurrentControlPoint;
 };
 
 #endif // __vtkMRMLRTBeamNode_h
@@ -75,6 +75,9 @@ vtkMRMLRTPlanNode::vtkMRMLRTPlanNode()
   this->DoseGrid[0] = 0;
   this->DoseGrid[1] = 0;
   this->DoseGrid[2] = 0;
+
+  this->BeamsModifyDepth = 0;
+  this->PreviousModifyState = 0;
 }
 
 //----------------------------------------------------------------------------
@@ -550,10 +553,19 @@ void vtkMRMLRTPlanNode::AddBeam(vtkMRMLRTBeamNode* beamNode)
   vtkMRMLSubjectHierarchyNode::CreateSubjectHierarchyNode(
     this->GetScene(), planShNode, vtkMRMLSubjectHierarchyConstants::GetDICOMLevelSubseries(), beamNode->GetName(), beamNode );
 
-  // Calculate transform from beam parameters and isocenter from plan
-  beamNode->UpdateTransform();
-  // Make sure display is set up
-  beamNode->UpdateGeometry();
+  if (this->BeamsModifyDepth > 0)
+  {
+    // Set up beam when the batch ends, after all its parameters are set
+    this->StartBeamModify(beamNode);
+    this->BeamsAddedInBatch.push_back(beamNode->GetID());
+  }
+  else
+  {
+    // Calculate transform from beam parameters and isocenter from plan
+    beamNode->UpdateTransform();
+    // Make sure display is set up
+    beamNode->UpdateGeometry();
+  }
 
   // Fire beam added event
   this->InvokeEvent(vtkMRMLRTPlanNode::BeamAdded, (void*)beamNode->GetID());
@@ -596,6 +608,83 @@ void vtkMRMLRTPlanNode::RemoveAllBeams()
   this->InvokePendingModifiedEvent();
 }
 
+//---------------------------------------------------------------------------
+void vtkMRMLRTPlanNode::StartBeamsModify()
+{
+  if (this->BeamsModifyDepth++ > 0)
+  {
+    // Nested batch
+    return;
+  }
+
+  this->PreviousModifyState = this->StartModify();
+
+  std::vector<vtkMRMLRTBeamNode*> beams;
+  this->GetBeams(beams);
+  for (std::vector<vtkMRMLRTBeamNode*>::iterator beamIt = beams.begin(); beamIt != beams.end(); ++beamIt)
+  {
+    this->StartBeamModify(*beamIt);
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLRTPlanNode::StartBeamModify(vtkMRMLRTBeamNode* beamNode)
+{
+  if (!beamNode || !beamNode->GetID())
+  {
+    return;
+  }
+  if (this->BeamsPreviousModifyStates.find(beamNode->GetID()) == this->BeamsPreviousModifyStates.end())
+  {
+    this->BeamsPreviousModifyStates[beamNode->GetID()] = beamNode->StartModify();
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLRTPlanNode::EndBeamsModify()
+{
+  if (this->BeamsModifyDepth == 0)
+  {
+    vtkErrorMacro("EndBeamsModify: No batch beam modification in progress!");
+    return;
+  }
+  if (--this->BeamsModifyDepth > 0)
+  {
+    // Nested batch
+    return;
+  }
+
+  std::map<std::string, int> beamsPreviousModifyStates;
+  beamsPreviousModifyStates.swap(this->BeamsPreviousModifyStates);
+  std::vector<std::string> beamsAddedInBatch;
+  beamsAddedInBatch.swap(this->BeamsAddedInBatch);
+
+  // Set up the beams added in the batch (beams removed in the meantime are not found in the scene)
+  for (std::vector<std::string>::iterator beamIdIt = beamsAddedInBatch.begin(); beamIdIt != beamsAddedInBatch.end(); ++beamIdIt)
+  {
+    vtkMRMLRTBeamNode* beamNode = vtkMRMLRTBeamNode::SafeDownCast(
+      this->GetScene() ? this->GetScene()->GetNodeByID(beamIdIt->c_str()) : NULL );
+    if (beamNode)
+    {
+      beamNode->UpdateTransform();
+      beamNode->UpdateGeometry();
+    }
+  }
+
+  // Invoke the compressed events of the beams, each regenerating the beam transform or model once
+  for (std::map<std::string, int>::iterator beamIt = beamsPreviousModifyStates.begin(); beamIt != beamsPreviousModifyStates.end(); ++beamIt)
+  {
+    vtkMRMLRTBeamNode* beamNode = vtkMRMLRTBeamNode::SafeDownCast(
+      this->GetScene() ? this->GetScene()->GetNodeByID(beamIt->first.c_str()) : NULL );
+    if (beamNode)
+    {
+      beamNode->EndModify(beamIt->second);
+    }
+  }
+
+  this->EndModify(this->PreviousModifyState);
+}
+
 //---------------------------------------------------------------------------
 vtkMRMLSubjectHierarchyNode* vtkMRMLRTPlanNode::GetPlanSubjectHierarchyNode()
 {
@@ -32,6 +32,11 @@
 // SegmentationCore includes
 #include "vtkOrientedImageData.h"
 
+// STD includes
+#include <map>
+#include <string>
+#include <vector>
+
 class vtkCollection;
 class vtkMRMLMarkupsFiducialNode;
 class vtkMRMLRTBeamNode;
@@ -101,6 +106,18 @@ public:
   /// Remove all beam nodes from plan
   void RemoveAllBeams();
 
+  /// Start modifying the plan and its beams in a batch (e.g. when importing a plan or editing many beams).
+  /// Until the matching \sa EndBeamsModify call, the modified events of the plan and its beams are compressed,
+  /// so changing beam parameters does not regenerate the beam transforms and models every time, and beams
+  /// added to the plan are not set up until the batch ends. Batches can be nested.
+  void StartBeamsModify();
+  /// End modifying the plan and its beams in a batch. When the outermost batch ends, the beams added during
+  /// the batch are set up, and the compressed events of the other beams are invoked, so that the transform
+  /// and model of each modified beam is regenerated once
+  void EndBeamsModify();
+  /// Determine whether the beams of the plan are being modified in a batch
+  bool IsBeamsModifying() { return this->BeamsModifyDepth > 0; };
+
   /// Generate new beam name from new beam name prefix and next beam number
   std::string GenerateNewBeamName();
 
@@ -188,6 +205,9 @@ protected:
   /// Create default plan POIs markups node
   vtkMRMLMarkupsFiducialNode* CreateMarkupsFiducialNode();
 
+  /// Disable the modified events of a beam until the current batch ends (see \sa StartBeamsModify)
+  void StartBeamModify(vtkMRMLRTBeamNode* beamNode);
+
 protected:
   vtkMRMLRTPlanNode();
   ~vtkMRMLRTPlanNode();
@@ -214,6 +234,15 @@ protected:
   ///TODO: Allow user to specify dose volume resolution different from reference volume
   /// (currently output dose volume has the same spacing as the reference anatomy)
   double DoseGrid[3];
+
+  /// Depth of nested batch beam modifications
+  int BeamsModifyDepth;
+  /// Modify state of the plan before the current batch
+  int PreviousModifyState;
+  /// Modify states of the beams before the current batch, keyed by beam node ID
+  std::map<std::string, int> BeamsPreviousModifyStates;
+  /// IDs of the beam nodes added during the current batch
+  std::vector<std::string> BeamsAddedInBatch;
 };
 
 #endif // __vtkMRMLRTPlanNode_h
@@ -0,0 +1,318 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Beams includes
+#include "vtkMRMLRTBeamNode.h"
+
+// VTK includes
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  static const double TOLERANCE = 1.0e-6;
+
+  static const int NUMBER_OF_LEAF_PAIRS = 3;
+  static const double LEAF_POSITION_BOUNDARIES[NUMBER_OF_LEAF_PAIRS+1] = {-15.0, -5.0, 5.0, 15.0};
+  static const int NUMBER_OF_CONTROL_POINTS = 3;
+  static const double GANTRY_ANGLES[NUMBER_OF_CONTROL_POINTS] = {181.5, 270.25, 359.0};
+  static const double CUMULATIVE_METERSET_WEIGHTS[NUMBER_OF_CONTROL_POINTS] = {0.0, 0.5, 1.0};
+  static const double JAW_POSITIONS[NUMBER_OF_CONTROL_POINTS][4] = {
+    {-50.0, 50.0, -40.0, 40.0}, {-45.5, 30.0, -20.0, 35.25}, {-10.0, 10.0, -10.0, 10.0} };
+  static const double LEAF_POSITIONS[NUMBER_OF_CONTROL_POINTS][2*NUMBER_OF_LEAF_PAIRS] = {
+    {-10.0, -20.0, -30.0, 10.0, 20.0, 30.0}, {-5.5, -2.25, 0.0, 5.5, 12.75, 0.0}, {-1.0, -1.0, -1.0, 1.0, 1.0, 1.0} };
+
+  //----------------------------------------------------------------------------
+  /// Split the attributes written by WriteXML into names and values
+  void ParseXMLAttributes(const std::string& xml, std::vector<std::string>& namesAndValues)
+  {
+    namesAndValues.clear();
+    size_t position = 0;
+    while ((position = xml.find("=\"", position)) != std::string::npos)
+    {
+      size_t nameStart = xml.find_last_of(" \t\n", position);
+      nameStart = (nameStart == std::string::npos ? 0 : nameStart + 1);
+      size_t valueEnd = xml.find('"', position + 2);
+      if (valueEnd == std::string::npos)
+      {
+        break;
+      }
+      namesAndValues.push_back(xml.substr(nameStart, position - nameStart));
+      namesAndValues.push_back(xml.substr(position + 2, valueEnd - position - 2));
+      position = valueEnd + 1;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Read attributes into the beam node (given as an array of names and values, like the XML parser does)
+  void ReadXMLAttributes(vtkMRMLRTBeamNode* beamNode, const std::vector<std::string>& namesAndValues)
+  {
+    std::vector<const char*> atts;
+    for (std::vector<std::string>::const_iterator it = namesAndValues.begin(); it != namesAndValues.end(); ++it)
+    {
+      atts.push_back(it->c_str());
+    }
+    atts.push_back(NULL);
+    beamNode->ReadXMLAttributes(&atts[0]);
+  }
+
+  //----------------------------------------------------------------------------
+  bool AreEqual(const double* values, const double* expectedValues, int numberOfValues)
+  {
+    if (!values)
+    {
+      return false;
+    }
+    for (int index=0; index<numberOfValues; ++index)
+    {
+      if (fabs(values[index] - expectedValues[index]) > TOLERANCE)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestControlPointRoundTrip()
+  {
+    vtkSmartPointer<vtkMRMLRTBeamNode> beamNode = vtkSmartPointer<vtkMRMLRTBeamNode>::New();
+    beamNode->SetName("Arc");
+    beamNode->SetLeafPositionBoundaries(NUMBER_OF_LEAF_PAIRS, LEAF_POSITION_BOUNDARIES, false);
+    beamNode->SetNumberOfControlPoints(NUMBER_OF_CONTROL_POINTS);
+    for (int controlPointIndex=0; controlPointIndex<NUMBER_OF_CONTROL_POINTS; ++controlPointIndex)
+    {
+      beamNode->SetControlPoint( controlPointIndex, GANTRY_ANGLES[controlPointIndex],
+        CUMULATIVE_METERSET_WEIGHTS[controlPointIndex], JAW_POSITIONS[controlPointIndex],
+        LEAF_POSITIONS[controlPointIndex] );
+    }
+    beamNode->SetCurrentControlPoint(1);
+
+    std::stringstream xml;
+    beamNode->WriteXML(xml, 0);
+    std::vector<std::string> namesAndValues;
+    ParseXMLAttributes(xml.str(), namesAndValues);
+
+    vtkSmartPointer<vtkMRMLRTBeamNode> readBeamNode = vtkSmartPointer<vtkMRMLRTBeamNode>::New();
+    ReadXMLAttributes(readBeamNode, namesAndValues);
+
+    if ( readBeamNode->GetNumberOfLeafPairs() != NUMBER_OF_LEAF_PAIRS
+      || !AreEqual(readBeamNode->GetLeafPositionBoundaries(), LEAF_POSITION_BOUNDARIES, NUMBER_OF_LEAF_PAIRS+1)
+      || readBeamNode->GetLeafTravelAlongX() )
+    {
+      std::cerr << __LINE__ << ": Leaf pairs differ after reading the written beam: " << xml.str() << std::endl;
+      return EXIT_FAILURE;
+    }
+    if ( readBeamNode->GetNumberOfControlPoints() != NUMBER_OF_CONTROL_POINTS
+      || readBeamNode->GetCurrentControlPoint() != 1 )
+    {
+      std::cerr << __LINE__ << ": Read " << readBeamNode->GetNumberOfControlPoints() << " control points, current "
+        << readBeamNode->GetCurrentControlPoint() << " (expected " << NUMBER_OF_CONTROL_POINTS << ", current 1)" << std::endl;
+      return EXIT_FAILURE;
+    }
+    for (int controlPointIndex=0; controlPointIndex<NUMBER_OF_CONTROL_POINTS; ++controlPointIndex)
+    {
+      double jawPositions[4] = {0.0, 0.0, 0.0, 0.0};
+      if ( fabs(readBeamNode->GetControlPointGantryAngle(controlPointIndex) - GANTRY_ANGLES[controlPointIndex]) > TOLERANCE
+        || fabs( readBeamNode->GetControlPointCumulativeMetersetWeight(controlPointIndex)
+          - CUMULATIVE_METERSET_WEIGHTS[controlPointIndex] ) > TOLERANCE
+        || !readBeamNode->GetControlPointJawPositions(controlPointIndex, jawPositions)
+        || !AreEqual(jawPositions, JAW_POSITIONS[controlPointIndex], 4)
+        || !AreEqual( readBeamNode->GetControlPointLeafPositions(controlPointIndex), LEAF_POSITIONS[controlPointIndex],
+          2*NUMBER_OF_LEAF_PAIRS ) )
+      {
+        std::cerr << __LINE__ << ": Control point " << controlPointIndex << " differs after reading the written beam: "
+          << xml.str() << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+
+    // The beam parameters are those of the current control point
+    if ( fabs(readBeamNode->GetGantryAngle() - GANTRY_ANGLES[1]) > TOLERANCE
+      || fabs(readBeamNode->GetX1Jaw() - JAW_POSITIONS[1][0]) > TOLERANCE
+      || fabs(readBeamNode->GetY2Jaw() - JAW_POSITIONS[1][3]) > TOLERANCE
+      || fabs(readBeamNode->GetControlPointMetersetFraction(0) - 0.5) > TOLERANCE )
+    {
+      std::cerr << __LINE__ << ": Beam parameters differ from the current control point after reading the written beam" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestInconsistentControlPoints()
+  {
+    // Jaw positions of only one of the two control points
+    std::vector<std::string> namesAndValues;
+    namesAndValues.push_back("name");
+    namesAndValues.push_back("Inconsistent");
+    namesAndValues.push_back("LeafTravelAlongX");
+    namesAndValues.push_back("true");
+    namesAndValues.push_back("LeafPositionBoundaries");
+    namesAndValues.push_back("-5 0 5");
+    namesAndValues.push_back("ControlPointGantryAngles");
+    namesAndValues.push_back("0 90");
+    namesAndValues.push_back("ControlPointCumulativeMetersetWeights");
+    namesAndValues.push_back("0 1");
+    namesAndValues.push_back("ControlPointJawPositions");
+    namesAndValues.push_back("-10 10 -10 10");
+    namesAndValues.push_back("ControlPointLeafPositions");
+    namesAndValues.push_back("-1 -1 1 1 -2 -2 2 2");
+    namesAndValues.push_back("CurrentControlPoint");
+    namesAndValues.push_back("1");
+
+    vtkSmartPointer<vtkMRMLRTBeamNode> beamNode = vtkSmartPointer<vtkMRMLRTBeamNode>::New();
+    std::cout << "Expecting error about inconsistent control point arrays:" << std::endl;
+    ReadXMLAttributes(beamNode, namesAndValues);
+    if ( beamNode->GetNumberOfControlPoints() != 0 || beamNode->GetNumberOfLeafPairs() != 0
+      || beamNode->GetCurrentControlPoint() != -1 )
+    {
+      std::cerr << __LINE__ << ": Inconsistent control point arrays are not discarded: "
+        << beamNode->GetNumberOfControlPoints() << " control points, " << beamNode->GetNumberOfLeafPairs()
+        << " leaf pairs, current control point " << beamNode->GetCurrentControlPoint() << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // The same arrays with the jaw positions of both control points are accepted
+    namesAndValues[11] = "-10 10 -10 10 -20 20 -20 20";
+    vtkSmartPointer<vtkMRMLRTBeamNode> consistentBeamNode = vtkSmartPointer<vtkMRMLRTBeamNode>::New();
+    ReadXMLAttributes(consistentBeamNode, namesAndValues);
+    if ( consistentBeamNode->GetNumberOfControlPoints() != 2 || consistentBeamNode->GetNumberOfLeafPairs() != 2
+      || consistentBeamNode->GetCurrentControlPoint() != 1 )
+    {
+      std::cerr << __LINE__ << ": Consistent control point arrays are not read" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestApertureClippedByJaws()
+  {
+    // Leaf pairs of different widths, the outermost ones outside the Y jaws, some leaves behind the X jaws
+    const int numberOfLeafPairs = 6;
+    double boundaries[numberOfLeafPairs+1] = {-25.0, -20.0, -10.0, 0.0, 5.0, 15.0, 25.0};
+    double leafPositions[2*numberOfLeafPairs] = {
+      0.0, -50.0, -10.0, -5.0, -40.0, 0.0, // First leaf bank
+      0.0, 50.0, 10.0, 25.0, 20.0, 0.0 }; // Second leaf bank
+    double jawPositions[4] = {-30.0, 30.0, -15.0, 12.0};
+
+    vtkSmartPointer<vtkMRMLRTBeamNode> beamNode = vtkSmartPointer<vtkMRMLRTBeamNode>::New();
+    beamNode->SetLeafPositionBoundaries(numberOfLeafPairs, boundaries, true);
+    beamNode->SetNumberOfControlPoints(1);
+    beamNode->SetControlPoint(0, 0.0, 1.0, jawPositions, leafPositions);
+
+    vtkSmartPointer<vtkPolyData> beamModelPolyData = vtkSmartPointer<vtkPolyData>::New();
+    if (!beamNode->CreateControlPointBeamPolyData(0, beamModelPolyData))
+    {
+      std::cerr << __LINE__ << ": Failed to create control point beam model" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // Source and two outline points at both ends of the four leaf pairs between the Y jaws
+    const int expectedNumberOfOutlinePoints = 4 * 4;
+    vtkPoints* points = beamModelPolyData->GetPoints();
+    if (!points || points->GetNumberOfPoints() != expectedNumberOfOutlinePoints + 1)
+    {
+      std::cerr << __LINE__ << ": Aperture outline has " << (points ? points->GetNumberOfPoints() - 1 : 0)
+        << " points (expected " << expectedNumberOfOutlinePoints << ")" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (beamModelPolyData->GetNumberOfPolys() != expectedNumberOfOutlinePoints + 1)
+    {
+      std::cerr << __LINE__ << ": Beam model has " << beamModelPolyData->GetNumberOfPolys()
+        << " polygons (expected " << expectedNumberOfOutlinePoints + 1 << ")" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // The aperture at isocenter is projected to the outline at SAD beyond the isocenter, with the
+    // beam X axis pointing along -Y and the beam Y axis pointing along -X
+    double sad = beamNode->GetSAD();
+    double outlineBounds[6] = {VTK_DOUBLE_MAX, VTK_DOUBLE_MIN, VTK_DOUBLE_MAX, VTK_DOUBLE_MIN, VTK_DOUBLE_MAX, VTK_DOUBLE_MIN};
+    for (int pointIndex=1; pointIndex<=expectedNumberOfOutlinePoints; ++pointIndex)
+    {
+      double* point = points->GetPoint(pointIndex);
+      for (int axis=0; axis<3; ++axis)
+      {
+        outlineBounds[2*axis] = std::min(outlineBounds[2*axis], point[axis]);
+        outlineBounds[2*axis+1] = std::max(outlineBounds[2*axis+1], point[axis]);
+      }
+    }
+    // Across the leaves: clipped by the Y jaws. Along the leaves: first leaf bank clipped by X1 (-50 and
+    // -40 to -30), second leaf bank clipped by X2 (50 to 30)
+    double expectedOutlineBounds[6] = {-2.0*12.0, 2.0*15.0, -2.0*30.0, 2.0*30.0, -sad, -sad};
+    if (!AreEqual(outlineBounds, expectedOutlineBounds, 6))
+    {
+      std::cerr << __LINE__ << ": Aperture outline extents (" << outlineBounds[0] << ", " << outlineBounds[1] << ", "
+        << outlineBounds[2] << ", " << outlineBounds[3] << ", " << outlineBounds[4] << ", " << outlineBounds[5]
+        << ") differ from the expected (" << expectedOutlineBounds[0] << ", " << expectedOutlineBounds[1] << ", "
+        << expectedOutlineBounds[2] << ", " << expectedOutlineBounds[3] << ", " << expectedOutlineBounds[4] << ", "
+        << expectedOutlineBounds[5] << ")" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // Narrowing the X jaws inside all leaf tips makes the outline follow the jaws
+    double narrowJawPositions[4] = {-2.0, 3.0, -15.0, 12.0};
+    beamNode->SetControlPoint(0, 0.0, 1.0, narrowJawPositions, leafPositions);
+    beamNode->CreateControlPointBeamPolyData(0, beamModelPolyData);
+    double narrowBounds[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    vtkSmartPointer<vtkPoints> outlinePoints = vtkSmartPointer<vtkPoints>::New();
+    for (int pointIndex=1; pointIndex<beamModelPolyData->GetNumberOfPoints(); ++pointIndex)
+    {
+      outlinePoints->InsertNextPoint(beamModelPolyData->GetPoint(pointIndex));
+    }
+    outlinePoints->GetBounds(narrowBounds);
+    double expectedNarrowBounds[6] = {-2.0*12.0, 2.0*15.0, -2.0*3.0, 2.0*2.0, -sad, -sad};
+    if ( outlinePoints->GetNumberOfPoints() != expectedNumberOfOutlinePoints
+      || !AreEqual(narrowBounds, expectedNarrowBounds, 6) )
+    {
+      std::cerr << __LINE__ << ": Aperture outline does not follow the narrowed X jaws" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLRTBeamNodeTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  if (TestControlPointRoundTrip() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (TestInconsistentControlPoints() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (TestApertureClippedByJaws() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "RT beam node test passed" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,264 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Beams includes
+#include "vtkSlicerBeamsModuleLogic.h"
+#include "vtkMRMLRTBeamNode.h"
+#include "vtkMRMLRTPlanNode.h"
+
+// Subject Hierarchy includes
+#include "vtkSlicerSubjectHierarchyModuleLogic.h"
+
+// MRML includes
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /// Number of beam events that make the Beams logic regenerate the beam transform or model
+  struct BeamEventCounter
+  {
+    int TransformModifiedCount;
+    int GeometryModifiedCount;
+    /// Generic modified events, observed by the other nodes and widgets
+    int ModifiedCount;
+  };
+
+  //----------------------------------------------------------------------------
+  void CountBeamEvent(vtkObject* vtkNotUsed(caller), unsigned long eid, void* clientData, void* vtkNotUsed(callData))
+  {
+    BeamEventCounter* counter = reinterpret_cast<BeamEventCounter*>(clientData);
+    if (eid == vtkMRMLRTBeamNode::BeamTransformModified)
+    {
+      counter->TransformModifiedCount++;
+    }
+    else if (eid == vtkMRMLRTBeamNode::BeamGeometryModified)
+    {
+      counter->GeometryModifiedCount++;
+    }
+    else if (eid == vtkCommand::ModifiedEvent)
+    {
+      counter->ModifiedCount++;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  bool CheckEventCounts(BeamEventCounter counters[], int numberOfBeams, const char* stepName,
+    int expectedTransformModifiedCount, int expectedGeometryModifiedCount)
+  {
+    bool success = true;
+    for (int beamIndex=0; beamIndex<numberOfBeams; ++beamIndex)
+    {
+      if ( counters[beamIndex].TransformModifiedCount != expectedTransformModifiedCount
+        || counters[beamIndex].GeometryModifiedCount != expectedGeometryModifiedCount )
+      {
+        std::cerr << "Beam " << beamIndex << " regenerated " << counters[beamIndex].TransformModifiedCount
+          << " transforms and " << counters[beamIndex].GeometryModifiedCount << " models " << stepName
+          << " (expected " << expectedTransformModifiedCount << " and " << expectedGeometryModifiedCount << ")" << std::endl;
+        success = false;
+      }
+      counters[beamIndex].TransformModifiedCount = 0;
+      counters[beamIndex].GeometryModifiedCount = 0;
+      counters[beamIndex].ModifiedCount = 0;
+    }
+    return success;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLRTPlanNodeTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkSmartPointer<vtkMRMLScene> mrmlScene = vtkSmartPointer<vtkMRMLScene>::New();
+
+  vtkNew<vtkSlicerSubjectHierarchyModuleLogic> subjectHierarchyLogic;
+  subjectHierarchyLogic->SetMRMLScene(mrmlScene);
+  vtkNew<vtkSlicerBeamsModuleLogic> beamsLogic;
+  beamsLogic->SetMRMLScene(mrmlScene);
+
+  vtkSmartPointer<vtkMRMLRTPlanNode> planNode = vtkSmartPointer<vtkMRMLRTPlanNode>::New();
+  planNode->SetName("TestPlan");
+  mrmlScene->AddNode(planNode);
+  planNode->SetIsocenterSpecification(vtkMRMLRTPlanNode::ArbitraryPoint);
+  double isocenter[3] = {10.0, -20.0, 30.0};
+  if (!planNode->SetIsocenterPosition(isocenter))
+  {
+    std::cerr << __LINE__ << ": Failed to set plan isocenter" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Add beams and count the events the Beams logic regenerates the beams on
+  const int numberOfBeams = 3;
+  BeamEventCounter counters[numberOfBeams];
+  vtkSmartPointer<vtkCallbackCommand> callbacks[numberOfBeams];
+  vtkMRMLRTBeamNode* beamNodes[numberOfBeams];
+  for (int beamIndex=0; beamIndex<numberOfBeams; ++beamIndex)
+  {
+    vtkSmartPointer<vtkMRMLRTBeamNode> beamNode = vtkSmartPointer<vtkMRMLRTBeamNode>::New();
+    beamNode->SetName(planNode->GenerateNewBeamName().c_str());
+    mrmlScene->AddNode(beamNode);
+    planNode->AddBeam(beamNode);
+    beamNodes[beamIndex] = beamNode;
+
+    counters[beamIndex].TransformModifiedCount = 0;
+    counters[beamIndex].GeometryModifiedCount = 0;
+    counters[beamIndex].ModifiedCount = 0;
+    callbacks[beamIndex] = vtkSmartPointer<vtkCallbackCommand>::New();
+    callbacks[beamIndex]->SetClientData(&counters[beamIndex]);
+    callbacks[beamIndex]->SetCallback(CountBeamEvent);
+    beamNode->AddObserver(vtkMRMLRTBeamNode::BeamTransformModified, callbacks[beamIndex]);
+    beamNode->AddObserver(vtkMRMLRTBeamNode::BeamGeometryModified, callbacks[beamIndex]);
+    beamNode->AddObserver(vtkCommand::ModifiedEvent, callbacks[beamIndex]);
+  }
+
+  // Without a batch every parameter change regenerates the beam
+  for (int beamIndex=0; beamIndex<numberOfBeams; ++beamIndex)
+  {
+    beamNodes[beamIndex]->SetGantryAngle(90.0);
+    beamNodes[beamIndex]->SetCollimatorAngle(45.0);
+    beamNodes[beamIndex]->SetX1Jaw(-50.0);
+    beamNodes[beamIndex]->SetX2Jaw(50.0);
+    beamNodes[beamIndex]->SetSAD(1100.0);
+  }
+  if (!CheckEventCounts(counters, numberOfBeams, "without batch", 2, 3))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Setting the current values does not regenerate the beams. The geometry setters return early for
+  // unchanged values, so not even the generic modified event is invoked
+  for (int beamIndex=0; beamIndex<numberOfBeams; ++beamIndex)
+  {
+    beamNodes[beamIndex]->SetGantryAngle(beamNodes[beamIndex]->GetGantryAngle());
+    beamNodes[beamIndex]->SetCollimatorAngle(beamNodes[beamIndex]->GetCollimatorAngle());
+    beamNodes[beamIndex]->SetCouchAngle(beamNodes[beamIndex]->GetCouchAngle());
+    beamNodes[beamIndex]->SetX1Jaw(beamNodes[beamIndex]->GetX1Jaw());
+    beamNodes[beamIndex]->SetX2Jaw(beamNodes[beamIndex]->GetX2Jaw());
+    beamNodes[beamIndex]->SetY1Jaw(beamNodes[beamIndex]->GetY1Jaw());
+    beamNodes[beamIndex]->SetY2Jaw(beamNodes[beamIndex]->GetY2Jaw());
+    beamNodes[beamIndex]->SetSAD(beamNodes[beamIndex]->GetSAD());
+  }
+  for (int beamIndex=0; beamIndex<numberOfBeams; ++beamIndex)
+  {
+    if (counters[beamIndex].ModifiedCount != 0)
+    {
+      std::cerr << __LINE__ << ": Beam " << beamIndex << " invoked " << counters[beamIndex].ModifiedCount
+        << " modified events when setting unchanged values (expected 0)" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  if (!CheckEventCounts(counters, numberOfBeams, "when setting unchanged values", 0, 0))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Changed values still invoke the generic modified event for the other observers
+  beamNodes[0]->SetCouchAngle(5.0);
+  if (counters[0].ModifiedCount == 0 || counters[0].TransformModifiedCount != 1 || counters[0].GeometryModifiedCount != 0)
+  {
+    std::cerr << __LINE__ << ": Beam invoked " << counters[0].ModifiedCount << " modified and "
+      << counters[0].TransformModifiedCount << " transform modified events when changing the couch angle (expected 1)" << std::endl;
+    return EXIT_FAILURE;
+  }
+  counters[0].TransformModifiedCount = 0;
+  counters[0].ModifiedCount = 0;
+
+  // In a batch each beam is regenerated once when the batch ends
+  planNode->StartBeamsModify();
+  for (int beamIndex=0; beamIndex<numberOfBeams; ++beamIndex)
+  {
+    beamNodes[beamIndex]->SetGantryAngle(180.0);
+    beamNodes[beamIndex]->SetCollimatorAngle(90.0);
+    beamNodes[beamIndex]->SetCouchAngle(10.0);
+    beamNodes[beamIndex]->SetX1Jaw(-40.0);
+    beamNodes[beamIndex]->SetX2Jaw(40.0);
+    beamNodes[beamIndex]->SetY1Jaw(-30.0);
+    beamNodes[beamIndex]->SetY2Jaw(30.0);
+    beamNodes[beamIndex]->SetSAD(1000.0);
+  }
+  if (!planNode->IsBeamsModifying() || !CheckEventCounts(counters, numberOfBeams, "during batch", 0, 0))
+  {
+    std::cerr << __LINE__ << ": Beams regenerated during batch" << std::endl;
+    return EXIT_FAILURE;
+  }
+  planNode->EndBeamsModify();
+  if (planNode->IsBeamsModifying() || !CheckEventCounts(counters, numberOfBeams, "after batch", 1, 1))
+  {
+    std::cerr << __LINE__ << ": Beams not regenerated once after batch" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Nested batches regenerate the beams when the outermost batch ends, and only the modified beams
+  planNode->StartBeamsModify();
+  beamNodes[0]->SetGantryAngle(270.0);
+  planNode->StartBeamsModify();
+  beamNodes[0]->SetX1Jaw(-20.0);
+  beamNodes[1]->SetX1Jaw(-20.0);
+  beamNodes[0]->SetX2Jaw(20.0);
+  planNode->EndBeamsModify();
+  if (!CheckEventCounts(counters, numberOfBeams, "after nested batch", 0, 0))
+  {
+    std::cerr << __LINE__ << ": Beams regenerated before the outermost batch ended" << std::endl;
+    return EXIT_FAILURE;
+  }
+  planNode->EndBeamsModify();
+  if ( counters[0].TransformModifiedCount != 1 || counters[0].GeometryModifiedCount != 1
+    || counters[1].TransformModifiedCount != 0 || counters[1].GeometryModifiedCount != 1
+    || counters[2].TransformModifiedCount != 0 || counters[2].GeometryModifiedCount != 0 )
+  {
+    std::cerr << __LINE__ << ": Beams not regenerated once after the outermost batch: ("
+      << counters[0].TransformModifiedCount << ", " << counters[0].GeometryModifiedCount << "), ("
+      << counters[1].TransformModifiedCount << ", " << counters[1].GeometryModifiedCount << "), ("
+      << counters[2].TransformModifiedCount << ", " << counters[2].GeometryModifiedCount << ")" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Beams added in a batch, as in the DICOM RT plan import, are set up when the batch ends
+  planNode->StartBeamsModify();
+  vtkSmartPointer<vtkMRMLRTBeamNode> addedBeamNode = vtkSmartPointer<vtkMRMLRTBeamNode>::New();
+  addedBeamNode->SetName(planNode->GenerateNewBeamName().c_str());
+  addedBeamNode->SetGantryAngle(30.0);
+  addedBeamNode->SetX1Jaw(-60.0);
+  mrmlScene->AddNode(addedBeamNode);
+  planNode->AddBeam(addedBeamNode);
+  if (addedBeamNode->GetParentTransformNode() || addedBeamNode->GetDisplayNode())
+  {
+    std::cerr << __LINE__ << ": Beam added in a batch is set up before the batch ended" << std::endl;
+    return EXIT_FAILURE;
+  }
+  planNode->EndBeamsModify();
+  if (!addedBeamNode->GetParentTransformNode() || !addedBeamNode->GetDisplayNode())
+  {
+    std::cerr << __LINE__ << ": Beam added in a batch is not set up after the batch ended" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!CheckEventCounts(counters, numberOfBeams, "when adding a beam in a batch", 0, 0))
+  {
+    return EXIT_FAILURE;
+  }
+
+  for (int beamIndex=0; beamIndex<numberOfBeams; ++beamIndex)
+  {
+    beamNodes[beamIndex]->RemoveObserver(callbacks[beamIndex]);
+  }
+
+  std::cout << "RT plan node test passed" << std::endl;
+  return EXIT_SUCCESS;
+}
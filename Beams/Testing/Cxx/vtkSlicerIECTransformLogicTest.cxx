@@ -0,0 +1,263 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Beams includes
+#include "vtkSlicerIECTransformLogic.h"
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTransform.h>
+
+// STD includes
+#include <cmath>
+
+namespace
+{
+  static const double TOLERANCE = 1.0e-6;
+
+  //----------------------------------------------------------------------------
+  /// Multiply the matrices of the transforms in the given order (the last one is applied first)
+  void Concatenate(vtkTransform* transforms[], int numberOfTransforms, vtkMatrix4x4* matrix)
+  {
+    matrix->Identity();
+    for (int index=0; index<numberOfTransforms; ++index)
+    {
+      vtkMatrix4x4::Multiply4x4(matrix, transforms[index]->GetMatrix(), matrix);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Compare the matrix between two coordinate frames to the expected matrix, and the matrix
+  /// of the reverse direction to its inverse
+  bool CheckMatrixBetween(vtkSlicerIECTransformLogic* iecLogic, const char* stepName,
+    vtkSlicerIECTransformLogic::CoordinateSystemIdentifier fromFrame,
+    vtkSlicerIECTransformLogic::CoordinateSystemIdentifier toFrame, vtkMatrix4x4* expectedMatrix)
+  {
+    vtkSmartPointer<vtkMatrix4x4> expectedInverseMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkMatrix4x4::Invert(expectedMatrix, expectedInverseMatrix);
+
+    for (int reverse=0; reverse<2; ++reverse)
+    {
+      vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+      bool success = (reverse
+        ? iecLogic->GetMatrixBetween(toFrame, fromFrame, matrix)
+        : iecLogic->GetMatrixBetween(fromFrame, toFrame, matrix) );
+      if (!success)
+      {
+        std::cerr << __LINE__ << ": Failed to get matrix between frames " << fromFrame << " and " << toFrame
+          << " after " << stepName << std::endl;
+        return false;
+      }
+      vtkMatrix4x4* expected = (reverse ? expectedInverseMatrix.GetPointer() : expectedMatrix);
+      for (int row=0; row<4; ++row)
+      {
+        for (int column=0; column<4; ++column)
+        {
+          if (fabs(matrix->GetElement(row, column) - expected->GetElement(row, column)) > TOLERANCE)
+          {
+            std::cerr << __LINE__ << ": Matrix from frame " << (reverse ? toFrame : fromFrame) << " to frame "
+              << (reverse ? fromFrame : toFrame) << " after " << stepName << " differs in element (" << row << ", "
+              << column << "): " << matrix->GetElement(row, column) << " (expected "
+              << expected->GetElement(row, column) << ")" << std::endl;
+            return false;
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Compare the matrices between frames on different branches of the hierarchy to the explicitly
+  /// concatenated transforms. The matrices are queried twice, so that the second query is served
+  /// from the cache filled by the first one
+  bool CheckMatrices(vtkSlicerIECTransformLogic* iecLogic, const char* stepName)
+  {
+    vtkTransform* gantry = iecLogic->GetGantryToFixedReferenceTransform();
+    vtkTransform* collimator = iecLogic->GetCollimatorToGantryTransform();
+    vtkTransform* leftPanelTranslation = iecLogic->GetLeftImagingPanelTranslationTransform();
+    vtkTransform* leftPanelRotated = iecLogic->GetLeftImagingPanelRotatedToGantryTransform();
+    vtkTransform* leftPanelIsocenter = iecLogic->GetLeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform();
+    vtkTransform* leftPanel = iecLogic->GetLeftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransform();
+    vtkTransform* patientSupport = iecLogic->GetPatientSupportToFixedReferenceTransform();
+    vtkTransform* patientSupportVerticalTranslation = iecLogic->GetPatientSupportScaledTranslatedToTableTopVerticalTranslationTransform();
+    vtkTransform* patientSupportScaled = iecLogic->GetPatientSupportScaledByTableTopVerticalMovementTransform();
+    vtkTransform* patientSupportPositive = iecLogic->GetPatientSupportPositiveVerticalTranslationTransform();
+    vtkTransform* tableTopEccentric = iecLogic->GetTableTopEccentricRotationToPatientSupportTransform();
+    vtkTransform* tableTop = iecLogic->GetTableTopToTableTopEccentricRotationTransform();
+
+    // Collimator to fixed reference
+    vtkSmartPointer<vtkMatrix4x4> collimatorToFixedReference = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkTransform* collimatorChain[2] = { gantry, collimator };
+    Concatenate(collimatorChain, 2, collimatorToFixedReference);
+
+    // Table top to fixed reference
+    vtkSmartPointer<vtkMatrix4x4> tableTopToFixedReference = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkTransform* tableTopChain[3] = { patientSupport, tableTopEccentric, tableTop };
+    Concatenate(tableTopChain, 3, tableTopToFixedReference);
+
+    // Collimator to table top, across the gantry and patient support branches
+    vtkSmartPointer<vtkMatrix4x4> fixedReferenceToTableTop = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkMatrix4x4::Invert(tableTopToFixedReference, fixedReferenceToTableTop);
+    vtkSmartPointer<vtkMatrix4x4> collimatorToTableTop = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkMatrix4x4::Multiply4x4(fixedReferenceToTableTop, collimatorToFixedReference, collimatorToTableTop);
+
+    // Left imaging panel to gantry
+    vtkSmartPointer<vtkMatrix4x4> leftPanelToGantry = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkTransform* leftPanelChain[4] = { leftPanelTranslation, leftPanelRotated, leftPanelIsocenter, leftPanel };
+    Concatenate(leftPanelChain, 4, leftPanelToGantry);
+
+    // Patient support positive vertical translation to table top eccentric rotation, across sibling branches
+    vtkSmartPointer<vtkMatrix4x4> patientSupportPositiveToPatientSupport = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkTransform* patientSupportChain[3] = { patientSupportVerticalTranslation, patientSupportScaled, patientSupportPositive };
+    Concatenate(patientSupportChain, 3, patientSupportPositiveToPatientSupport);
+    vtkSmartPointer<vtkMatrix4x4> patientSupportToTableTopEccentric = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkMatrix4x4::Invert(tableTopEccentric->GetMatrix(), patientSupportToTableTopEccentric);
+    vtkSmartPointer<vtkMatrix4x4> patientSupportPositiveToTableTopEccentric = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkMatrix4x4::Multiply4x4(patientSupportToTableTopEccentric, patientSupportPositiveToPatientSupport,
+      patientSupportPositiveToTableTopEccentric);
+
+    vtkSmartPointer<vtkMatrix4x4> identity = vtkSmartPointer<vtkMatrix4x4>::New();
+
+    for (int query=0; query<2; ++query)
+    {
+      if ( !CheckMatrixBetween(iecLogic, stepName, vtkSlicerIECTransformLogic::CollimatorToGantry,
+             vtkSlicerIECTransformLogic::FixedReference, collimatorToFixedReference)
+        || !CheckMatrixBetween(iecLogic, stepName, vtkSlicerIECTransformLogic::TableTopToTableEccentricRotation,
+             vtkSlicerIECTransformLogic::FixedReference, tableTopToFixedReference)
+        || !CheckMatrixBetween(iecLogic, stepName, vtkSlicerIECTransformLogic::CollimatorToGantry,
+             vtkSlicerIECTransformLogic::TableTopToTableEccentricRotation, collimatorToTableTop)
+        || !CheckMatrixBetween(iecLogic, stepName, vtkSlicerIECTransformLogic::LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenter,
+             vtkSlicerIECTransformLogic::GantryToFixedReference, leftPanelToGantry)
+        || !CheckMatrixBetween(iecLogic, stepName, vtkSlicerIECTransformLogic::PatientSupportPositiveVerticalTranslation,
+             vtkSlicerIECTransformLogic::TableTopEccentricRotationToPatientSupport, patientSupportPositiveToTableTopEccentric)
+        || !CheckMatrixBetween(iecLogic, stepName, vtkSlicerIECTransformLogic::GantryToFixedReference,
+             vtkSlicerIECTransformLogic::GantryToFixedReference, identity) )
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIECTransformLogicTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkNew<vtkSlicerIECTransformLogic> iecLogic;
+
+  // Hierarchy
+  if ( iecLogic->GetParentCoordinateSystem(vtkSlicerIECTransformLogic::CollimatorToGantry) != vtkSlicerIECTransformLogic::GantryToFixedReference
+    || iecLogic->GetParentCoordinateSystem(vtkSlicerIECTransformLogic::TableTopToTableEccentricRotation)
+      != vtkSlicerIECTransformLogic::TableTopEccentricRotationToPatientSupport
+    || iecLogic->GetTransformToParent(vtkSlicerIECTransformLogic::CollimatorToGantry) != iecLogic->GetCollimatorToGantryTransform()
+    || iecLogic->GetTransformToParent(vtkSlicerIECTransformLogic::FixedReference) != NULL )
+  {
+    std::cerr << __LINE__ << ": Invalid IEC coordinate system hierarchy" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Identity transforms, fills the cache
+  if (!CheckMatrices(iecLogic.GetPointer(), "initialization"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Static offsets of the imaging panels and the patient support, as set up by Room's Eye View
+  iecLogic->GetLeftImagingPanelTranslationTransform()->Translate(0.0, 0.0, -68.5);
+  iecLogic->GetLeftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransform()->Translate(-256.0, 0.0, 680.0);
+  iecLogic->GetPatientSupportScaledTranslatedToTableTopVerticalTranslationTransform()->Translate(0.0, 0.0, -1359.47);
+  iecLogic->GetPatientSupportPositiveVerticalTranslationTransform()->Translate(0.0, 0.0, 1359.47);
+  if (!CheckMatrices(iecLogic.GetPointer(), "setting the static offsets"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Change one angle or displacement at a time. Each change has to invalidate the cached matrices of all
+  // the paths through the modified transform, and only those
+  iecLogic->GetGantryToFixedReferenceTransform()->RotateY(30.0);
+  if (!CheckMatrices(iecLogic.GetPointer(), "gantry rotation"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  iecLogic->GetCollimatorToGantryTransform()->Translate(-3.7, -8.4, 0.0);
+  iecLogic->GetCollimatorToGantryTransform()->RotateZ(45.0);
+  iecLogic->GetCollimatorToGantryTransform()->Translate(-3.7, -8.4, 0.0);
+  if (!CheckMatrices(iecLogic.GetPointer(), "collimator rotation"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  iecLogic->GetPatientSupportToFixedReferenceTransform()->RotateZ(90.0);
+  if (!CheckMatrices(iecLogic.GetPointer(), "patient support rotation"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  iecLogic->GetTableTopEccentricRotationToPatientSupportTransform()->Translate(20.0, -150.0, 100.0);
+  if (!CheckMatrices(iecLogic.GetPointer(), "table top displacement"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  iecLogic->GetPatientSupportScaledByTableTopVerticalMovementTransform()->Scale(1.0, 1.0, 1.1);
+  iecLogic->GetLeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform()->RotateX(-68.5);
+  if (!CheckMatrices(iecLogic.GetPointer(), "patient support scaling and imaging panel rotation"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Replacing the whole transform (not only concatenating to it) needs to invalidate the cache too
+  iecLogic->GetGantryToFixedReferenceTransform()->Identity();
+  iecLogic->GetGantryToFixedReferenceTransform()->RotateY(270.0);
+  iecLogic->GetPatientSupportToFixedReferenceTransform()->Identity();
+  if (!CheckMatrices(iecLogic.GetPointer(), "resetting gantry and patient support"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkMatrix4x4> rotationMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  rotationMatrix->SetElement(0, 0, 0.0);
+  rotationMatrix->SetElement(0, 1, -1.0);
+  rotationMatrix->SetElement(1, 0, 1.0);
+  rotationMatrix->SetElement(1, 1, 0.0);
+  iecLogic->GetTableTopToTableTopEccentricRotationTransform()->SetMatrix(rotationMatrix);
+  if (!CheckMatrices(iecLogic.GetPointer(), "setting the table top matrix"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Setting and concatenating matrix elements do not invoke modified events, only update the modification time
+  const double collimatorElements[16] = { 0.0, 1.0, 0.0, 5.0,  -1.0, 0.0, 0.0, -2.0,  0.0, 0.0, 1.0, 0.0,  0.0, 0.0, 0.0, 1.0 };
+  iecLogic->GetCollimatorToGantryTransform()->SetMatrix(collimatorElements);
+  if (!CheckMatrices(iecLogic.GetPointer(), "setting the collimator matrix elements"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  const double scalingElements[16] = { 1.0, 0.0, 0.0, 0.0,  0.0, 1.0, 0.0, 0.0,  0.0, 0.0, 0.9, 0.0,  0.0, 0.0, 0.0, 1.0 };
+  iecLogic->GetPatientSupportScaledByTableTopVerticalMovementTransform()->Concatenate(scalingElements);
+  if (!CheckMatrices(iecLogic.GetPointer(), "concatenating the patient support scaling elements"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "IEC transform logic test passed" << std::endl;
+  return EXIT_SUCCESS;
+}
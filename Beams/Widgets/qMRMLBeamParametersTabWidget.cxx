@@ -32,7 +32,9 @@ Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
 #include <vtkWeakPointer.h>
 
 // Qt includes
+#include <QApplication>
 #include <QDebug>
+#include <QMessageBox>
 
 //----------------------------------------------------------------------------
 const char* qMRMLBeamParametersTabWidget::BEAM_PARAMETER_NODE_ATTRIBUTE_PROPERTY = "BeamParameterNodeAttribute";
@@ -749,7 +751,13 @@ void qMRMLBeamParametersTabWidget::updateDRRClicked()
     return;
   }
 
-  //TODO: Fix DRR code (it is in EBP logic and it is commented out)
-  //d->logic()->UpdateDRR(beamNode->GetName());
-  qCritical() << Q_FUNC_INFO << ": Not implemented!";
+  // The DRR is computed by the External Beam Planning logic
+  QApplication::setOverrideCursor(QCursor(Qt::BusyCursor));
+  std::string errorMessage = d->BeamNode->RequestDRRUpdate();
+  QApplication::restoreOverrideCursor();
+  if (!errorMessage.empty())
+  {
+    qCritical() << Q_FUNC_INFO << ": " << errorMessage.c_str();
+    QMessageBox::critical(this, tr("DRR update failed"), QString(errorMessage.c_str()));
+  }
 }
@@ -897,7 +897,8 @@ bool vtkSlicerDicomRtImportExportModuleLogic::LoadRtPlan(vtkSlicerDicomRtReader*
       referencedSopInstanceUids.c_str() );
   }
 
-  // Load beams in plan
+  // Load beams in plan. The beams are set up once all of them are added
+  planNode->StartBeamsModify();
   int numberOfBeams = rtReader->GetNumberOfBeams();
   for (int beamIndex = 0; beamIndex < numberOfBeams; beamIndex++) // DICOM starts indexing from 1
   {
@@ -922,6 +923,25 @@ bool vtkSlicerDicomRtImportExportModuleLogic::LoadRtPlan(vtkSlicerDicomRtReader*
 
     beamNode->SetSAD(rtReader->GetBeamSourceAxisDistance(dicomBeamNumber));
 
+    // Set control points (e.g. VMAT arcs). Beam model and transform are only generated for the current control point
+    int numberOfControlPoints = rtReader->GetBeamNumberOfControlPoints(dicomBeamNumber);
+    if (numberOfControlPoints > 0)
+    {
+      beamNode->SetLeafPositionBoundaries( rtReader->GetBeamNumberOfLeafPairs(dicomBeamNumber),
+        rtReader->GetBeamLeafPositionBoundaries(dicomBeamNumber), rtReader->GetBeamLeafTravelAlongX(dicomBeamNumber) );
+      beamNode->SetNumberOfControlPoints(numberOfControlPoints);
+      for (int controlPointIndex = 0; controlPointIndex < numberOfControlPoints; ++controlPointIndex)
+      {
+        double controlPointJawPositions[4] = {0.0, 0.0, 0.0, 0.0};
+        rtReader->GetBeamControlPointJawPositions(dicomBeamNumber, controlPointIndex, controlPointJawPositions);
+        beamNode->SetControlPoint( controlPointIndex,
+          rtReader->GetBeamControlPointGantryAngle(dicomBeamNumber, controlPointIndex),
+          rtReader->GetBeamControlPointCumulativeMetersetWeight(dicomBeamNumber, controlPointIndex),
+          controlPointJawPositions, rtReader->GetBeamControlPointLeafPositions(dicomBeamNumber, controlPointIndex) );
+      }
+      beamNode->SetCurrentControlPoint(0);
+    }
+
     // Set isocenter to parent plan
     double* isocenter = rtReader->GetBeamIsocenterPositionRas(dicomBeamNumber);
     planNode->SetIsocenterSpecification(vtkMRMLRTPlanNode::ArbitraryPoint);
@@ -930,6 +950,7 @@ bool vtkSlicerDicomRtImportExportModuleLogic::LoadRtPlan(vtkSlicerDicomRtReader*
       if (!planNode->SetIsocenterPosition(isocenter))
       {
         vtkErrorMacro("LoadRtPlan: Failed to set isocenter position");
+        planNode->EndBeamsModify();
         return false;
       }
     }
@@ -939,6 +960,7 @@ bool vtkSlicerDicomRtImportExportModuleLogic::LoadRtPlan(vtkSlicerDicomRtReader*
       if (!planNode->GetIsocenterPosition(planIsocenter))
       {
         vtkErrorMacro("LoadRtPlan: Failed to get plan isocenter position");
+        planNode->EndBeamsModify();
         return false;
       }
       //TODO: Multiple isocenters per plan is not yet supported. Will be part of the beams group nodes developed later
@@ -991,6 +1013,7 @@ bool vtkSlicerDicomRtImportExportModuleLogic::LoadRtPlan(vtkSlicerDicomRtReader*
     this->GetMRMLScene()->AddNode(beamModelHierarchyDisplayNode);
     beamModelHierarchyNode->SetAndObserveDisplayNodeID( beamModelHierarchyDisplayNode->GetID() );
   }
+  planNode->EndBeamsModify();
 
   // Insert plan isocenter series in subject hierarchy
   this->InsertSeriesInSubjectHierarchy(rtReader);
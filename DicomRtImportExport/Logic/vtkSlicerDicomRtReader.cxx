@@ -566,33 +566,85 @@ void vtkSlicerDicomRtReader::LoadRTPlan(DcmDataset* dataset)
       currentBeamSequenceObject.getSourceAxisDistance(sourceAxisDistance);
       beamEntry.SourceAxisDistance = sourceAxisDistance;
 
+      // MLC leaf pair boundaries
+      DRTBeamLimitingDeviceSequenceInRTBeamsModule &rtBeamLimitingDeviceSequenceObject =
+        currentBeamSequenceObject.getBeamLimitingDeviceSequence();
+      if (rtBeamLimitingDeviceSequenceObject.gotoFirstItem().good())
+      {
+        do
+        {
+          DRTBeamLimitingDeviceSequenceInRTBeamsModule::Item &beamLimitingDeviceItem =
+            rtBeamLimitingDeviceSequenceObject.getCurrentItem();
+          if (!beamLimitingDeviceItem.isValid())
+          {
+            continue;
+          }
+
+          OFString rtBeamLimitingDeviceType("");
+          beamLimitingDeviceItem.getRTBeamLimitingDeviceType(rtBeamLimitingDeviceType);
+          if ( !rtBeamLimitingDeviceType.compare("MLCX") || !rtBeamLimitingDeviceType.compare("MLCY") )
+          {
+            OFVector<vtkTypeFloat64> leafPositionBoundaries;
+            if (beamLimitingDeviceItem.getLeafPositionBoundaries(leafPositionBoundaries).good() && leafPositionBoundaries.size() > 1)
+            {
+              beamEntry.LeafPositionBoundaries.assign(leafPositionBoundaries.begin(), leafPositionBoundaries.end());
+              beamEntry.LeafTravelAlongX = !rtBeamLimitingDeviceType.compare("MLCX");
+            }
+            else
+            {
+              vtkWarningMacro("LoadRTPlan: No leaf position boundaries found in multi-leaf collimator entry of beam " << beamEntry.Name);
+            }
+          }
+        }
+        while (rtBeamLimitingDeviceSequenceObject.gotoNextItem().good());
+      }
+      unsigned int numberOfLeafPairs = (beamEntry.LeafPositionBoundaries.empty() ? 0 : beamEntry.LeafPositionBoundaries.size()-1);
+
+      // Control points. The first control point defines the static beam parameters. The parameters missing from the
+      // subsequent control points are unchanged since the previous control point
+      double gantryAngle = 0.0;
+      double cumulativeMetersetWeight = 0.0;
+      double leafJawPositions[2][2] = {{0.0, 0.0},{0.0, 0.0}};
+      std::vector<double> leafPositions(2*numberOfLeafPairs, 0.0);
       DRTControlPointSequence &rtControlPointSequenceObject = currentBeamSequenceObject.getControlPointSequence();
       if (rtControlPointSequenceObject.gotoFirstItem().good())
       {
-        // do // TODO: comment out for now since only first control point is loaded (as isocenter)
+        do
         {
           DRTControlPointSequence::Item &controlPointItem = rtControlPointSequenceObject.getCurrentItem();
           if (controlPointItem.isValid())
           {
-            OFVector<vtkTypeFloat64> isocenterPositionDataLps;
-            controlPointItem.getIsocenterPosition(isocenterPositionDataLps);
+            bool firstControlPoint = beamEntry.ControlPointGantryAngles.empty();
+            if (firstControlPoint)
+            {
+              OFVector<vtkTypeFloat64> isocenterPositionDataLps;
+              controlPointItem.getIsocenterPosition(isocenterPositionDataLps);
 
-            // Convert from DICOM LPS -> Slicer RAS
-            beamEntry.IsocenterPositionRas[0] = -isocenterPositionDataLps[0];
-            beamEntry.IsocenterPositionRas[1] = -isocenterPositionDataLps[1];
-            beamEntry.IsocenterPositionRas[2] = isocenterPositionDataLps[2];
+              // Convert from DICOM LPS -> Slicer RAS
+              beamEntry.IsocenterPositionRas[0] = -isocenterPositionDataLps[0];
+              beamEntry.IsocenterPositionRas[1] = -isocenterPositionDataLps[1];
+              beamEntry.IsocenterPositionRas[2] = isocenterPositionDataLps[2];
 
-            vtkTypeFloat64 gantryAngle = 0.0;
-            controlPointItem.getGantryAngle(gantryAngle);
-            beamEntry.GantryAngle = gantryAngle;
+              vtkTypeFloat64 patientSupportAngle = 0.0;
+              controlPointItem.getPatientSupportAngle(patientSupportAngle);
+              beamEntry.PatientSupportAngle = patientSupportAngle;
 
-            vtkTypeFloat64 patientSupportAngle = 0.0;
-            controlPointItem.getPatientSupportAngle(patientSupportAngle);
-            beamEntry.PatientSupportAngle = patientSupportAngle;
+              vtkTypeFloat64 beamLimitingDeviceAngle = 0.0;
+              controlPointItem.getBeamLimitingDeviceAngle(beamLimitingDeviceAngle);
+              beamEntry.BeamLimitingDeviceAngle = beamLimitingDeviceAngle;
+            }
 
-            vtkTypeFloat64 beamLimitingDeviceAngle = 0.0;
-            controlPointItem.getBeamLimitingDeviceAngle(beamLimitingDeviceAngle);
-            beamEntry.BeamLimitingDeviceAngle = beamLimitingDeviceAngle;
+            vtkTypeFloat64 controlPointGantryAngle = 0.0;
+            if (controlPointItem.getGantryAngle(controlPointGantryAngle).good())
+            {
+              gantryAngle = controlPointGantryAngle;
+            }
+
+            vtkTypeFloat64 controlPointCumulativeMetersetWeight = 0.0;
+            if (controlPointItem.getCumulativeMetersetWeight(controlPointCumulativeMetersetWeight).good())
+            {
+              cumulativeMetersetWeight = controlPointCumulativeMetersetWeight;
+            }
 
             DRTBeamLimitingDevicePositionSequence &currentCollimatorPositionSequenceObject =
               controlPointItem.getBeamLimitingDevicePositionSequence();
@@ -607,15 +659,15 @@ void vtkSlicerDicomRtReader::LoadRTPlan(DcmDataset* dataset)
                   OFString rtBeamLimitingDeviceType("");
                   collimatorPositionItem.getRTBeamLimitingDeviceType(rtBeamLimitingDeviceType);
 
-                  OFVector<vtkTypeFloat64> leafJawPositions;
-                  OFCondition getJawPositionsCondition = collimatorPositionItem.getLeafJawPositions(leafJawPositions);
+                  OFVector<vtkTypeFloat64> leafJawPositionsData;
+                  OFCondition getJawPositionsCondition = collimatorPositionItem.getLeafJawPositions(leafJawPositionsData);
 
                   if ( !rtBeamLimitingDeviceType.compare("ASYMX") || !rtBeamLimitingDeviceType.compare("X") )
                   {
                     if (getJawPositionsCondition.good())
                     {
-                      beamEntry.LeafJawPositions[0][0] = leafJawPositions[0];
-                      beamEntry.LeafJawPositions[0][1] = leafJawPositions[1];
+                      leafJawPositions[0][0] = leafJawPositionsData[0];
+                      leafJawPositions[0][1] = leafJawPositionsData[1];
                     }
                     else
                     {
@@ -626,8 +678,8 @@ void vtkSlicerDicomRtReader::LoadRTPlan(DcmDataset* dataset)
                   {
                     if (getJawPositionsCondition.good())
                     {
-                      beamEntry.LeafJawPositions[1][0] = leafJawPositions[0];
-                      beamEntry.LeafJawPositions[1][1] = leafJawPositions[1];
+                      leafJawPositions[1][0] = leafJawPositionsData[0];
+                      leafJawPositions[1][1] = leafJawPositionsData[1];
                     }
                     else
                     {
@@ -636,7 +688,14 @@ void vtkSlicerDicomRtReader::LoadRTPlan(DcmDataset* dataset)
                   }
                   else if ( !rtBeamLimitingDeviceType.compare("MLCX") || !rtBeamLimitingDeviceType.compare("MLCY") )
                   {
-                    vtkWarningMacro("LoadRTPlan: Multi-leaf collimator entry found. This collimator type is not yet supported!");
+                    if (getJawPositionsCondition.good() && leafJawPositionsData.size() == 2*numberOfLeafPairs)
+                    {
+                      leafPositions.assign(leafJawPositionsData.begin(), leafJawPositionsData.end());
+                    }
+                    else if (numberOfLeafPairs > 0)
+                    {
+                      vtkWarningMacro("LoadRTPlan: Leaf positions do not match the leaf pair boundaries in multi-leaf collimator entry of beam " << beamEntry.Name);
+                    }
                   }
                   else
                   {
@@ -646,9 +705,27 @@ void vtkSlicerDicomRtReader::LoadRTPlan(DcmDataset* dataset)
               }
               while (currentCollimatorPositionSequenceObject.gotoNextItem().good());
             }
+
+            if (firstControlPoint)
+            {
+              beamEntry.GantryAngle = gantryAngle;
+              beamEntry.LeafJawPositions[0][0] = leafJawPositions[0][0];
+              beamEntry.LeafJawPositions[0][1] = leafJawPositions[0][1];
+              beamEntry.LeafJawPositions[1][0] = leafJawPositions[1][0];
+              beamEntry.LeafJawPositions[1][1] = leafJawPositions[1][1];
+            }
+
+            // Store control point in the contiguous arrays of the beam
+            beamEntry.ControlPointGantryAngles.push_back(gantryAngle);
+            beamEntry.ControlPointCumulativeMetersetWeights.push_back(cumulativeMetersetWeight);
+            beamEntry.ControlPointJawPositions.push_back(leafJawPositions[0][0]);
+            beamEntry.ControlPointJawPositions.push_back(leafJawPositions[0][1]);
+            beamEntry.ControlPointJawPositions.push_back(leafJawPositions[1][0]);
+            beamEntry.ControlPointJawPositions.push_back(leafJawPositions[1][1]);
+            beamEntry.ControlPointLeafPositions.insert(beamEntry.ControlPointLeafPositions.end(), leafPositions.begin(), leafPositions.end());
           } // endif controlPointItem.isValid()
         }
-        // while (rtControlPointSequenceObject.gotoNextItem().good());
+        while (rtControlPointSequenceObject.gotoNextItem().good());
       }
 
       this->BeamSequenceVector.push_back(beamEntry);
@@ -1204,6 +1281,118 @@ void vtkSlicerDicomRtReader::GetBeamLeafJawPositions(unsigned int beamNumber, do
   jawPositions[1][1]=beam->LeafJawPositions[1][1];
 }
 
+//----------------------------------------------------------------------------
+int vtkSlicerDicomRtReader::GetBeamNumberOfControlPoints(unsigned int beamNumber)
+{
+  BeamEntry* beam=this->FindBeamByNumber(beamNumber);
+  if (beam==NULL)
+  {
+    vtkErrorMacro("GetBeamNumberOfControlPoints: Unable to find beam of number" << beamNumber);
+    return 0;
+  }
+  return (int)beam->ControlPointGantryAngles.size();
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerDicomRtReader::GetBeamNumberOfLeafPairs(unsigned int beamNumber)
+{
+  BeamEntry* beam=this->FindBeamByNumber(beamNumber);
+  if (beam==NULL)
+  {
+    vtkErrorMacro("GetBeamNumberOfLeafPairs: Unable to find beam of number" << beamNumber);
+    return 0;
+  }
+  return (beam->LeafPositionBoundaries.empty() ? 0 : (int)beam->LeafPositionBoundaries.size()-1);
+}
+
+//----------------------------------------------------------------------------
+const double* vtkSlicerDicomRtReader::GetBeamLeafPositionBoundaries(unsigned int beamNumber)
+{
+  BeamEntry* beam=this->FindBeamByNumber(beamNumber);
+  if (beam==NULL || beam->LeafPositionBoundaries.empty())
+  {
+    return NULL;
+  }
+  return &beam->LeafPositionBoundaries[0];
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDicomRtReader::GetBeamLeafTravelAlongX(unsigned int beamNumber)
+{
+  BeamEntry* beam=this->FindBeamByNumber(beamNumber);
+  if (beam==NULL)
+  {
+    vtkErrorMacro("GetBeamLeafTravelAlongX: Unable to find beam of number" << beamNumber);
+    return true;
+  }
+  return beam->LeafTravelAlongX;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDicomRtReader::BeamEntry* vtkSlicerDicomRtReader::FindBeamControlPoint(unsigned int beamNumber, int controlPointIndex)
+{
+  BeamEntry* beam=this->FindBeamByNumber(beamNumber);
+  if (beam==NULL)
+  {
+    return NULL;
+  }
+  if (controlPointIndex < 0 || controlPointIndex >= (int)beam->ControlPointGantryAngles.size())
+  {
+    vtkErrorMacro("FindBeamControlPoint: Control point " << controlPointIndex << " cannot be found in beam of number " << beamNumber);
+    return NULL;
+  }
+  return beam;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerDicomRtReader::GetBeamControlPointGantryAngle(unsigned int beamNumber, int controlPointIndex)
+{
+  BeamEntry* beam=this->FindBeamControlPoint(beamNumber, controlPointIndex);
+  if (beam==NULL)
+  {
+    return 0.0;
+  }
+  return beam->ControlPointGantryAngles[controlPointIndex];
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerDicomRtReader::GetBeamControlPointCumulativeMetersetWeight(unsigned int beamNumber, int controlPointIndex)
+{
+  BeamEntry* beam=this->FindBeamControlPoint(beamNumber, controlPointIndex);
+  if (beam==NULL)
+  {
+    return 0.0;
+  }
+  return beam->ControlPointCumulativeMetersetWeights[controlPointIndex];
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDicomRtReader::GetBeamControlPointJawPositions(unsigned int beamNumber, int controlPointIndex, double jawPositions[4])
+{
+  BeamEntry* beam=this->FindBeamControlPoint(beamNumber, controlPointIndex);
+  if (beam==NULL)
+  {
+    return false;
+  }
+  for (int i=0; i<4; ++i)
+  {
+    jawPositions[i] = beam->ControlPointJawPositions[4*controlPointIndex + i];
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+const double* vtkSlicerDicomRtReader::GetBeamControlPointLeafPositions(unsigned int beamNumber, int controlPointIndex)
+{
+  BeamEntry* beam=this->FindBeamControlPoint(beamNumber, controlPointIndex);
+  if (beam==NULL || beam->LeafPositionBoundaries.empty())
+  {
+    return NULL;
+  }
+  unsigned int numberOfLeafPositions = 2 * (beam->LeafPositionBoundaries.size()-1);
+  return &beam->ControlPointLeafPositions[numberOfLeafPositions*controlPointIndex];
+}
+
 //----------------------------------------------------------------------------
 void vtkSlicerDicomRtReader::LoadRTDose(DcmDataset* dataset)
 {
@@ -118,6 +118,32 @@ public:
   /// \param jawPositions Array in which the jaw positions are copied
   void GetBeamLeafJawPositions(unsigned int beamNumber, double jawPositions[2][2]);
 
+  /// Get number of control points for a given beam
+  int GetBeamNumberOfControlPoints(unsigned int beamNumber);
+
+  /// Get number of MLC leaf pairs for a given beam (0 if the beam has no MLC)
+  int GetBeamNumberOfLeafPairs(unsigned int beamNumber);
+
+  /// Get MLC leaf pair boundaries (number of leaf pairs + 1 values) for a given beam, NULL if the beam has no MLC
+  const double* GetBeamLeafPositionBoundaries(unsigned int beamNumber);
+
+  /// Get whether the MLC leaves of a given beam travel along X (MLCX) or Y (MLCY)
+  bool GetBeamLeafTravelAlongX(unsigned int beamNumber);
+
+  /// Get gantry angle of a control point of a given beam
+  double GetBeamControlPointGantryAngle(unsigned int beamNumber, int controlPointIndex);
+
+  /// Get cumulative meterset weight of a control point of a given beam
+  double GetBeamControlPointCumulativeMetersetWeight(unsigned int beamNumber, int controlPointIndex);
+
+  /// Get jaw positions of a control point of a given beam
+  /// \param jawPositions Array in which the X1, X2, Y1, Y2 jaw positions are copied
+  /// \return Success flag
+  bool GetBeamControlPointJawPositions(unsigned int beamNumber, int controlPointIndex, double jawPositions[4]);
+
+  /// Get MLC leaf positions of a control point of a given beam (first then second leaf bank), NULL if the beam has no MLC
+  const double* GetBeamControlPointLeafPositions(unsigned int beamNumber, int controlPointIndex);
+
   /// Set input file name
   vtkSetStringMacro(FileName);
 
@@ -301,6 +327,7 @@ protected:
       LeafJawPositions[0][1]=0.0;
       LeafJawPositions[1][0]=0.0;
       LeafJawPositions[1][1]=0.0;
+      LeafTravelAlongX=true;
     }
     unsigned int Number;
     std::string Name;
@@ -308,18 +335,27 @@ protected:
     std::string Description;
     double IsocenterPositionRas[3];
 
-    // TODO: 
-    // In case of VMAT the following parameters can change by each control point
-    //   (this is not supported yet!)
-    // In case of IMRT, these are fixed (for Slicer visualization, in reality there is
-    //   a second control point that defines the CumulativeMetersetWeight to know when
-    //   to end irradiation.
+    // Parameters of the first control point. In case of VMAT the gantry angle, the jaw and the leaf
+    // positions change by each control point, these are stored in the control point arrays below
     double SourceAxisDistance;
     double GantryAngle;
     double PatientSupportAngle;
     double BeamLimitingDeviceAngle;
     /// Jaw positions: X and Y positions with isocenter as origin (e.g. {{-50,50}{-50,50}} )
     double LeafJawPositions[2][2];
+
+    /// MLC leaf pair boundaries (number of leaf pairs + 1 values), empty if the beam has no MLC
+    std::vector<double> LeafPositionBoundaries;
+    /// Flag indicating whether the MLC leaves travel along X (MLCX) or Y (MLCY)
+    bool LeafTravelAlongX;
+    /// Gantry angle of each control point
+    std::vector<double> ControlPointGantryAngles;
+    /// Cumulative meterset weight of each control point
+    std::vector<double> ControlPointCumulativeMetersetWeights;
+    /// Jaw positions of each control point (X1, X2, Y1, Y2 per control point)
+    std::vector<double> ControlPointJawPositions;
+    /// MLC leaf positions of each control point (first then second leaf bank per control point)
+    std::vector<double> ControlPointLeafPositions;
   };
 
 protected:
@@ -375,6 +411,9 @@ protected:
   /// Find and return a beam entry according to its beam number
   BeamEntry* FindBeamByNumber(unsigned int beamNumber);
 
+  /// Find and return a beam entry according to its beam number if it contains a control point
+  BeamEntry* FindBeamControlPoint(unsigned int beamNumber, int controlPointIndex);
+
   /// Find and return a ROI entry according to its ROI number
   RoiEntry* FindRoiByNumber(unsigned int roiNumber);
 
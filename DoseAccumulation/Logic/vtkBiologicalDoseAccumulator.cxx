@@ -0,0 +1,232 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkBiologicalDoseAccumulator.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMultiThreader.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+
+// STD includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkBiologicalDoseAccumulator);
+
+vtkCxxSetObjectMacro(vtkBiologicalDoseAccumulator, PhysicalDoseImageData, vtkImageData);
+vtkCxxSetObjectMacro(vtkBiologicalDoseAccumulator, AlphaBetaImageData, vtkImageData);
+vtkCxxSetObjectMacro(vtkBiologicalDoseAccumulator, AccumulatedImageData, vtkImageData);
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /// Add a*D + b*D^2 to the accumulated voxels (constant alpha/beta ratio folded into the coefficients)
+  template <class T> void AccumulateConstantAlphaBeta(const float* dosePtr, T* accumulatedPtr, vtkIdType numberOfVoxels,
+    float linearCoefficient, float quadraticCoefficient)
+  {
+    for (vtkIdType index=0; index<numberOfVoxels; ++index)
+    {
+      float dose = dosePtr[index];
+      accumulatedPtr[index] = static_cast<T>(accumulatedPtr[index] + dose * (linearCoefficient + quadraticCoefficient * dose));
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Add BED difference c1*D + c2*D^2/(alpha/beta) to the accumulated voxels
+  template <class T> void AccumulateBed(const float* dosePtr, const float* alphaBetaPtr, T* accumulatedPtr, vtkIdType numberOfVoxels,
+    float weightDifference, float squaredWeightDifferencePerFraction)
+  {
+    for (vtkIdType index=0; index<numberOfVoxels; ++index)
+    {
+      float dose = dosePtr[index];
+      accumulatedPtr[index] = static_cast<T>( accumulatedPtr[index]
+        + dose * (weightDifference + squaredWeightDifferencePerFraction * dose / alphaBetaPtr[index]) );
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Add EQD2 difference (c1*D*alpha/beta + c2*D^2)/(alpha/beta + 2) to the accumulated voxels
+  template <class T> void AccumulateEqd2(const float* dosePtr, const float* alphaBetaPtr, T* accumulatedPtr, vtkIdType numberOfVoxels,
+    float weightDifference, float squaredWeightDifferencePerFraction)
+  {
+    for (vtkIdType index=0; index<numberOfVoxels; ++index)
+    {
+      float dose = dosePtr[index];
+      float alphaBeta = alphaBetaPtr[index];
+      accumulatedPtr[index] = static_cast<T>( accumulatedPtr[index]
+        + dose * (weightDifference * alphaBeta + squaredWeightDifferencePerFraction * dose) / (alphaBeta + 2.0f) );
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T> void AccumulateRange(vtkBiologicalDoseAccumulator* self, T* accumulatedPtr, vtkIdType startIndex, vtkIdType endIndex)
+  {
+    const float* dosePtr = static_cast<const float*>(self->GetPhysicalDoseImageData()->GetScalarPointer()) + startIndex;
+    accumulatedPtr += startIndex;
+    vtkIdType numberOfVoxels = endIndex - startIndex;
+
+    double newWeight = self->GetNewWeight();
+    double oldWeight = self->GetOldWeight();
+    float weightDifference = static_cast<float>(newWeight - oldWeight);
+    float squaredWeightDifferencePerFraction = static_cast<float>(
+      (newWeight * newWeight - oldWeight * oldWeight) / self->GetNumberOfFractions() );
+    bool eqd2 = self->GetEquivalentDoseIn2GyFractions();
+
+    if (!self->GetAlphaBetaImageData())
+    {
+      float alphaBeta = static_cast<float>(self->GetAlphaBetaRatio());
+      float linearCoefficient = (eqd2 ? weightDifference * alphaBeta / (alphaBeta + 2.0f) : weightDifference);
+      float quadraticCoefficient = (eqd2 ? squaredWeightDifferencePerFraction / (alphaBeta + 2.0f) : squaredWeightDifferencePerFraction / alphaBeta);
+      AccumulateConstantAlphaBeta(dosePtr, accumulatedPtr, numberOfVoxels, linearCoefficient, quadraticCoefficient);
+      return;
+    }
+
+    const float* alphaBetaPtr = static_cast<const float*>(self->GetAlphaBetaImageData()->GetScalarPointer()) + startIndex;
+    if (eqd2)
+    {
+      AccumulateEqd2(dosePtr, alphaBetaPtr, accumulatedPtr, numberOfVoxels, weightDifference, squaredWeightDifferencePerFraction);
+    }
+    else
+    {
+      AccumulateBed(dosePtr, alphaBetaPtr, accumulatedPtr, numberOfVoxels, weightDifference, squaredWeightDifferencePerFraction);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE AccumulateThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    vtkBiologicalDoseAccumulator* self = static_cast<vtkBiologicalDoseAccumulator*>(threadInfo->UserData);
+
+    vtkIdType numberOfVoxels = self->GetAccumulatedImageData()->GetNumberOfPoints();
+    vtkIdType voxelsPerThread = (numberOfVoxels + threadInfo->NumberOfThreads - 1) / threadInfo->NumberOfThreads;
+    vtkIdType startIndex = threadInfo->ThreadID * voxelsPerThread;
+    vtkIdType endIndex = std::min(startIndex + voxelsPerThread, numberOfVoxels);
+    if (startIndex < endIndex)
+    {
+      self->ThreadedAccumulate(startIndex, endIndex);
+    }
+
+    return VTK_THREAD_RETURN_VALUE;
+  }
+
+  //----------------------------------------------------------------------------
+  bool DoExtentsMatch(vtkImageData* image1, vtkImageData* image2)
+  {
+    int extent1[6] = {0, -1, 0, -1, 0, -1};
+    int extent2[6] = {0, -1, 0, -1, 0, -1};
+    image1->GetExtent(extent1);
+    image2->GetExtent(extent2);
+    return std::equal(extent1, extent1 + 6, extent2);
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkBiologicalDoseAccumulator::vtkBiologicalDoseAccumulator()
+{
+  this->PhysicalDoseImageData = NULL;
+  this->AlphaBetaImageData = NULL;
+  this->AccumulatedImageData = NULL;
+  this->AlphaBetaRatio = 3.0;
+  this->NumberOfFractions = 1;
+  this->NewWeight = 1.0;
+  this->OldWeight = 0.0;
+  this->EquivalentDoseIn2GyFractions = true;
+  this->Threader = vtkMultiThreader::New();
+  this->NumberOfThreads = this->Threader->GetNumberOfThreads();
+}
+
+//----------------------------------------------------------------------------
+vtkBiologicalDoseAccumulator::~vtkBiologicalDoseAccumulator()
+{
+  this->SetPhysicalDoseImageData(NULL);
+  this->SetAlphaBetaImageData(NULL);
+  this->SetAccumulatedImageData(NULL);
+  if (this->Threader)
+  {
+    this->Threader->Delete();
+    this->Threader = NULL;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkBiologicalDoseAccumulator::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "AlphaBetaRatio: " << this->AlphaBetaRatio << "\n";
+  os << indent << "NumberOfFractions: " << this->NumberOfFractions << "\n";
+  os << indent << "NewWeight: " << this->NewWeight << "\n";
+  os << indent << "OldWeight: " << this->OldWeight << "\n";
+  os << indent << "EquivalentDoseIn2GyFractions: " << (this->EquivalentDoseIn2GyFractions ? "true" : "false") << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+}
+
+//----------------------------------------------------------------------------
+bool vtkBiologicalDoseAccumulator::Update()
+{
+  if (!this->PhysicalDoseImageData || !this->AccumulatedImageData)
+  {
+    vtkErrorMacro("Update: Physical dose and accumulated image need to be set!");
+    return false;
+  }
+  if ( this->PhysicalDoseImageData->GetScalarType() != VTK_FLOAT || this->PhysicalDoseImageData->GetNumberOfScalarComponents() != 1
+    || (this->AlphaBetaImageData && this->AlphaBetaImageData->GetScalarType() != VTK_FLOAT) )
+  {
+    vtkErrorMacro("Update: Physical dose and alpha/beta images need to be of single component float type!");
+    return false;
+  }
+  if ( !this->AccumulatedImageData->GetPointData()->GetScalars() || this->AccumulatedImageData->GetNumberOfScalarComponents() != 1 )
+  {
+    vtkErrorMacro("Update: Accumulated image is not allocated!");
+    return false;
+  }
+  if ( !DoExtentsMatch(this->PhysicalDoseImageData, this->AccumulatedImageData)
+    || (this->AlphaBetaImageData && !DoExtentsMatch(this->AlphaBetaImageData, this->AccumulatedImageData)) )
+  {
+    vtkErrorMacro("Update: Physical dose, alpha/beta and accumulated images need to be on the same lattice!");
+    return false;
+  }
+  if (this->NewWeight == this->OldWeight)
+  {
+    return true; // Nothing to do
+  }
+
+  this->Threader->SetNumberOfThreads(this->NumberOfThreads);
+  this->Threader->SetSingleMethod(AccumulateThreadFunction, this);
+  this->Threader->SingleMethodExecute();
+
+  this->AccumulatedImageData->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkBiologicalDoseAccumulator::ThreadedAccumulate(vtkIdType startIndex, vtkIdType endIndex)
+{
+  void* accumulatedPtr = this->AccumulatedImageData->GetScalarPointer();
+  switch (this->AccumulatedImageData->GetScalarType())
+  {
+    vtkTemplateMacro( AccumulateRange(this, static_cast<VTK_TT*>(accumulatedPtr), startIndex, endIndex) );
+    default:
+      vtkErrorMacro("ThreadedAccumulate: Unsupported accumulated image scalar type!");
+  }
+}
@@ -0,0 +1,130 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#ifndef __vtkBiologicalDoseAccumulator_h
+#define __vtkBiologicalDoseAccumulator_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkMultiThreader.h>
+
+#include "vtkSlicerDoseAccumulationModuleLogicExport.h"
+
+class vtkImageData;
+
+/// \ingroup SlicerRt_QtModules_DoseAccumulation
+/// \class vtkBiologicalDoseAccumulator
+/// \brief Convert a physical dose to BED or EQD2 voxelwise and add it to an accumulated image in place.
+///
+/// The linear-quadratic model is used. For a course delivering total physical dose D in n fractions
+/// BED = D * (1 + D/(n*alpha/beta)) and EQD2 = BED * alpha/beta / (alpha/beta + 2).
+///
+/// As the conversion is not linear, reweighting an already accumulated dose cannot be done by adding
+/// the weight difference times the dose. Instead the difference of the converted doses f(NewWeight*D) - f(OldWeight*D)
+/// is added, which allows adding (OldWeight=0), removing (NewWeight=0) and reweighting a course in one pass.
+///
+/// The physical dose, the alpha/beta ratio and the accumulated images need to have the same extent (the reference
+/// lattice). The voxels are processed in parallel ranges, and the inner loops are free of branches so that they can be vectorized.
+class VTK_SLICER_DOSEACCUMULATION_LOGIC_EXPORT vtkBiologicalDoseAccumulator : public vtkObject
+{
+public:
+  static vtkBiologicalDoseAccumulator *New();
+  vtkTypeMacro(vtkBiologicalDoseAccumulator, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Set physical dose image (float, reference lattice)
+  void SetPhysicalDoseImageData(vtkImageData* imageData);
+  vtkGetObjectMacro(PhysicalDoseImageData, vtkImageData);
+
+  /// Set alpha/beta ratio image (float, reference lattice, values in Gy). If not set, then the
+  /// constant \sa AlphaBetaRatio is used for all voxels
+  void SetAlphaBetaImageData(vtkImageData* imageData);
+  vtkGetObjectMacro(AlphaBetaImageData, vtkImageData);
+
+  /// Set accumulated image the converted dose is added to
+  void SetAccumulatedImageData(vtkImageData* imageData);
+  vtkGetObjectMacro(AccumulatedImageData, vtkImageData);
+
+  /// Alpha/beta ratio (Gy) used if there is no alpha/beta ratio image
+  vtkSetClampMacro(AlphaBetaRatio, double, 0.01, VTK_DOUBLE_MAX);
+  vtkGetMacro(AlphaBetaRatio, double);
+
+  /// Number of fractions in which the physical dose was delivered
+  vtkSetClampMacro(NumberOfFractions, int, 1, VTK_INT_MAX);
+  vtkGetMacro(NumberOfFractions, int);
+
+  /// Weight of the physical dose after the update (0 if the dose is removed from the accumulated image)
+  vtkSetMacro(NewWeight, double);
+  vtkGetMacro(NewWeight, double);
+
+  /// Weight of the physical dose currently contained in the accumulated image (0 if not yet added)
+  vtkSetMacro(OldWeight, double);
+  vtkGetMacro(OldWeight, double);
+
+  /// Compute EQD2 if enabled, BED otherwise
+  vtkSetMacro(EquivalentDoseIn2GyFractions, bool);
+  vtkGetMacro(EquivalentDoseIn2GyFractions, bool);
+  vtkBooleanMacro(EquivalentDoseIn2GyFractions, bool);
+
+  /// Number of threads used for the computation. By default the number of processors is used
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_MAX_THREADS);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Convert the physical dose and add it to the accumulated image
+  /// \return Success flag
+  bool Update();
+
+  /// Process a range of voxels (flat index range, end exclusive). Called from the worker threads
+  void ThreadedAccumulate(vtkIdType startIndex, vtkIdType endIndex);
+
+protected:
+  vtkBiologicalDoseAccumulator();
+  virtual ~vtkBiologicalDoseAccumulator();
+
+protected:
+  /// Physical dose image
+  vtkImageData* PhysicalDoseImageData;
+  /// Alpha/beta ratio image
+  vtkImageData* AlphaBetaImageData;
+  /// Accumulated image (running total)
+  vtkImageData* AccumulatedImageData;
+
+  /// Constant alpha/beta ratio
+  double AlphaBetaRatio;
+  /// Number of fractions
+  int NumberOfFractions;
+  /// Weight of the physical dose after the update
+  double NewWeight;
+  /// Weight of the physical dose before the update
+  double OldWeight;
+  /// Flag whether EQD2 (or BED) is computed
+  bool EquivalentDoseIn2GyFractions;
+  /// Number of threads
+  int NumberOfThreads;
+
+  /// Multithreader executing the voxel ranges
+  vtkMultiThreader* Threader;
+
+private:
+  vtkBiologicalDoseAccumulator(const vtkBiologicalDoseAccumulator&); // Not implemented
+  void operator=(const vtkBiologicalDoseAccumulator&);               // Not implemented
+};
+
+#endif
@@ -0,0 +1,296 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkDeformableDoseAccumulator.h"
+
+// VTK includes
+#include <vtkAbstractTransform.h>
+#include <vtkImageData.h>
+#include <vtkMultiThreader.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkDeformableDoseAccumulator);
+
+vtkCxxSetObjectMacro(vtkDeformableDoseAccumulator, InputDoseImageData, vtkImageData);
+vtkCxxSetObjectMacro(vtkDeformableDoseAccumulator, InputDensityImageData, vtkImageData);
+vtkCxxSetObjectMacro(vtkDeformableDoseAccumulator, ReferenceToInputTransform, vtkAbstractTransform);
+vtkCxxSetObjectMacro(vtkDeformableDoseAccumulator, AccumulatedImageData, vtkImageData);
+
+namespace
+{
+  /// Tolerance for deciding whether a continuous index is inside the image
+  static const double EPSILON_INDEX = 1.0e-6;
+
+  //----------------------------------------------------------------------------
+  /// Trilinear interpolation in a float image at continuous index position
+  /// \return False if the position is outside the image
+  bool InterpolateTrilinear(const float* data, const int dims[3], const double position[3], float& value)
+  {
+    int baseIndex[3] = {0, 0, 0};
+    double fraction[3] = {0.0, 0.0, 0.0};
+    int increment[3] = {0, 0, 0};
+    for (int axis=0; axis<3; ++axis)
+    {
+      if (position[axis] < -EPSILON_INDEX || position[axis] > dims[axis] - 1 + EPSILON_INDEX)
+      {
+        return false;
+      }
+      if (dims[axis] == 1)
+      {
+        continue;
+      }
+      baseIndex[axis] = std::min(std::max(static_cast<int>(floor(position[axis])), 0), dims[axis] - 2);
+      fraction[axis] = std::min(std::max(position[axis] - baseIndex[axis], 0.0), 1.0);
+      increment[axis] = 1;
+    }
+
+    vtkIdType sliceSize = static_cast<vtkIdType>(dims[0]) * dims[1];
+    const float* p000 = data + baseIndex[0] + baseIndex[1] * static_cast<vtkIdType>(dims[0]) + baseIndex[2] * sliceSize;
+    vtkIdType offsetI = increment[0];
+    vtkIdType offsetJ = increment[1] * static_cast<vtkIdType>(dims[0]);
+    vtkIdType offsetK = increment[2] * sliceSize;
+
+    double v00 = p000[0] + fraction[0] * (p000[offsetI] - p000[0]);
+    double v10 = p000[offsetJ] + fraction[0] * (p000[offsetJ+offsetI] - p000[offsetJ]);
+    double v01 = p000[offsetK] + fraction[0] * (p000[offsetK+offsetI] - p000[offsetK]);
+    double v11 = p000[offsetK+offsetJ] + fraction[0] * (p000[offsetK+offsetJ+offsetI] - p000[offsetK+offsetJ]);
+    double v0 = v00 + fraction[1] * (v10 - v00);
+    double v1 = v01 + fraction[1] * (v11 - v01);
+    value = static_cast<float>(v0 + fraction[2] * (v1 - v0));
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T> void AccumulateSlab(vtkDeformableDoseAccumulator* self, T* accumulatedPtr, int kStart, int kEnd)
+  {
+    vtkImageData* doseImage = self->GetInputDoseImageData();
+    vtkImageData* densityImage = self->GetInputDensityImageData();
+    vtkAbstractTransform* transform = self->GetReferenceToInputTransform();
+    bool energyMassMapping = self->GetEnergyMassMapping() && densityImage;
+    int subdivisions = (energyMassMapping ? self->GetNumberOfSubdivisions() : 1);
+    double weight = self->GetWeight();
+
+    int accumulatedExtent[6] = {0, -1, 0, -1, 0, -1};
+    self->GetAccumulatedImageData()->GetExtent(accumulatedExtent);
+    int doseExtent[6] = {0, -1, 0, -1, 0, -1};
+    doseImage->GetExtent(doseExtent);
+    int doseDimensions[3] = {0, 0, 0};
+    doseImage->GetDimensions(doseDimensions);
+    const float* dosePtr = static_cast<const float*>(doseImage->GetScalarPointer());
+    const float* densityPtr = (energyMassMapping ? static_cast<const float*>(densityImage->GetScalarPointer()) : NULL);
+
+    vtkIdType rowSize = accumulatedExtent[1] - accumulatedExtent[0] + 1;
+    vtkIdType sliceSize = rowSize * (accumulatedExtent[3] - accumulatedExtent[2] + 1);
+
+    double referencePosition[3] = {0.0, 0.0, 0.0};
+    double inputPosition[3] = {0.0, 0.0, 0.0};
+    for (int k=kStart; k<=kEnd; ++k)
+    {
+      T* rowPtr = accumulatedPtr + (k - accumulatedExtent[4]) * sliceSize;
+      for (int j=accumulatedExtent[2]; j<=accumulatedExtent[3]; ++j, rowPtr += rowSize)
+      {
+        for (int i=accumulatedExtent[0]; i<=accumulatedExtent[1]; ++i)
+        {
+          double dose = 0.0;
+          if (!energyMassMapping)
+          {
+            referencePosition[0] = i;
+            referencePosition[1] = j;
+            referencePosition[2] = k;
+            transform->InternalTransformPoint(referencePosition, inputPosition);
+            inputPosition[0] -= doseExtent[0];
+            inputPosition[1] -= doseExtent[2];
+            inputPosition[2] -= doseExtent[4];
+            float value = 0.0f;
+            if (InterpolateTrilinear(dosePtr, doseDimensions, inputPosition, value))
+            {
+              dose = value;
+            }
+          }
+          else
+          {
+            // Energy/mass mapping: dose = sum(dose*density) / sum(density) over the sub-voxels
+            double energy = 0.0;
+            double mass = 0.0;
+            double doseSum = 0.0;
+            int numberOfSamples = 0;
+            for (int sk=0; sk<subdivisions; ++sk)
+            {
+              for (int sj=0; sj<subdivisions; ++sj)
+              {
+                for (int si=0; si<subdivisions; ++si)
+                {
+                  referencePosition[0] = i - 0.5 + (si + 0.5) / subdivisions;
+                  referencePosition[1] = j - 0.5 + (sj + 0.5) / subdivisions;
+                  referencePosition[2] = k - 0.5 + (sk + 0.5) / subdivisions;
+                  transform->InternalTransformPoint(referencePosition, inputPosition);
+                  inputPosition[0] -= doseExtent[0];
+                  inputPosition[1] -= doseExtent[2];
+                  inputPosition[2] -= doseExtent[4];
+                  float doseValue = 0.0f;
+                  float densityValue = 0.0f;
+                  if ( InterpolateTrilinear(dosePtr, doseDimensions, inputPosition, doseValue)
+                    && InterpolateTrilinear(densityPtr, doseDimensions, inputPosition, densityValue) )
+                  {
+                    densityValue = std::max(densityValue, 0.0f);
+                    energy += doseValue * densityValue;
+                    mass += densityValue;
+                    doseSum += doseValue;
+                  }
+                  ++numberOfSamples;
+                }
+              }
+            }
+            // Fall back to volume averaging where there is no mass (e.g. in air)
+            dose = (mass > 0.0 ? energy / mass : doseSum / numberOfSamples);
+          }
+
+          // Round instead of truncating if the accumulated image has integer type
+          double sum = rowPtr[i - accumulatedExtent[0]] + weight * dose;
+          rowPtr[i - accumulatedExtent[0]] = static_cast<T>(std::numeric_limits<T>::is_integer ? floor(sum + 0.5) : sum);
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE AccumulateThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    vtkDeformableDoseAccumulator* self = static_cast<vtkDeformableDoseAccumulator*>(threadInfo->UserData);
+
+    int extent[6] = {0, -1, 0, -1, 0, -1};
+    self->GetAccumulatedImageData()->GetExtent(extent);
+    int numberOfSlices = extent[5] - extent[4] + 1;
+    int slicesPerThread = (numberOfSlices + threadInfo->NumberOfThreads - 1) / threadInfo->NumberOfThreads;
+    int kStart = extent[4] + threadInfo->ThreadID * slicesPerThread;
+    int kEnd = std::min(kStart + slicesPerThread - 1, extent[5]);
+    if (kStart <= kEnd)
+    {
+      self->ThreadedAccumulate(kStart, kEnd);
+    }
+
+    return VTK_THREAD_RETURN_VALUE;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkDeformableDoseAccumulator::vtkDeformableDoseAccumulator()
+{
+  this->InputDoseImageData = NULL;
+  this->InputDensityImageData = NULL;
+  this->ReferenceToInputTransform = NULL;
+  this->AccumulatedImageData = NULL;
+  this->Weight = 1.0;
+  this->EnergyMassMapping = false;
+  this->NumberOfSubdivisions = 2;
+  this->Threader = vtkMultiThreader::New();
+  this->NumberOfThreads = this->Threader->GetNumberOfThreads();
+}
+
+//----------------------------------------------------------------------------
+vtkDeformableDoseAccumulator::~vtkDeformableDoseAccumulator()
+{
+  this->SetInputDoseImageData(NULL);
+  this->SetInputDensityImageData(NULL);
+  this->SetReferenceToInputTransform(NULL);
+  this->SetAccumulatedImageData(NULL);
+  if (this->Threader)
+  {
+    this->Threader->Delete();
+    this->Threader = NULL;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkDeformableDoseAccumulator::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "Weight: " << this->Weight << "\n";
+  os << indent << "EnergyMassMapping: " << (this->EnergyMassMapping ? "true" : "false") << "\n";
+  os << indent << "NumberOfSubdivisions: " << this->NumberOfSubdivisions << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+}
+
+//----------------------------------------------------------------------------
+bool vtkDeformableDoseAccumulator::Update()
+{
+  if (!this->InputDoseImageData || !this->ReferenceToInputTransform || !this->AccumulatedImageData)
+  {
+    vtkErrorMacro("Update: Input dose, transform and accumulated image need to be set!");
+    return false;
+  }
+  if (this->InputDoseImageData->GetScalarType() != VTK_FLOAT || this->InputDoseImageData->GetNumberOfScalarComponents() != 1)
+  {
+    vtkErrorMacro("Update: Input dose image needs to be of single component float type!");
+    return false;
+  }
+  if (!this->AccumulatedImageData->GetPointData()->GetScalars())
+  {
+    vtkErrorMacro("Update: Accumulated image is not allocated!");
+    return false;
+  }
+  if (this->EnergyMassMapping)
+  {
+    int doseDimensions[3] = {0, 0, 0};
+    int densityDimensions[3] = {0, 0, 0};
+    this->InputDoseImageData->GetDimensions(doseDimensions);
+    if (this->InputDensityImageData)
+    {
+      this->InputDensityImageData->GetDimensions(densityDimensions);
+    }
+    if ( !this->InputDensityImageData || this->InputDensityImageData->GetScalarType() != VTK_FLOAT
+      || doseDimensions[0] != densityDimensions[0] || doseDimensions[1] != densityDimensions[1] || doseDimensions[2] != densityDimensions[2] )
+    {
+      vtkErrorMacro("Update: Energy/mass mapping requires a float density image on the input dose lattice!");
+      return false;
+    }
+  }
+
+  // Transforms need to be up to date before using them from multiple threads without locking
+  this->ReferenceToInputTransform->Update();
+
+  this->Threader->SetNumberOfThreads(this->NumberOfThreads);
+  this->Threader->SetSingleMethod(AccumulateThreadFunction, this);
+  this->Threader->SingleMethodExecute();
+
+  this->AccumulatedImageData->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkDeformableDoseAccumulator::ThreadedAccumulate(int kStart, int kEnd)
+{
+  void* accumulatedPtr = this->AccumulatedImageData->GetScalarPointer();
+  switch (this->AccumulatedImageData->GetScalarType())
+  {
+    vtkTemplateMacro( AccumulateSlab(this, static_cast<VTK_TT*>(accumulatedPtr), kStart, kEnd) );
+    default:
+      vtkErrorMacro("ThreadedAccumulate: Unsupported accumulated image scalar type!");
+  }
+}
@@ -0,0 +1,128 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#ifndef __vtkDeformableDoseAccumulator_h
+#define __vtkDeformableDoseAccumulator_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkMultiThreader.h>
+
+#include "vtkSlicerDoseAccumulationModuleLogicExport.h"
+
+class vtkAbstractTransform;
+class vtkImageData;
+
+/// \ingroup SlicerRt_QtModules_DoseAccumulation
+/// \class vtkDeformableDoseAccumulator
+/// \brief Warp a dose volume through a deformation and add it to an accumulated dose image in place.
+///
+/// For each voxel of the accumulated (reference) image the corresponding position in the input dose
+/// is computed using the reference to input transform, the input dose is sampled there with trilinear
+/// interpolation, and the weighted value is added to the voxel. No intermediate warped image is created,
+/// so memory use does not depend on the number of accumulated doses. The voxels are processed in parallel
+/// slabs along the K axis.
+///
+/// If energy/mass mapping is enabled, each reference voxel is subdivided, and the dose is computed as
+/// the ratio of the deposited energy and the mass of the corresponding input regions (the sum of dose
+/// times density over the sum of density), which conserves the integral dose where the mapping compresses
+/// or expands tissue.
+///
+/// Input dose and density images need to be in float type. Both images use the IJK coordinates of the
+/// input dose, and the reference to input transform maps reference IJK to input dose IJK coordinates.
+class VTK_SLICER_DOSEACCUMULATION_LOGIC_EXPORT vtkDeformableDoseAccumulator : public vtkObject
+{
+public:
+  static vtkDeformableDoseAccumulator *New();
+  vtkTypeMacro(vtkDeformableDoseAccumulator, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Set input dose image (float, IJK geometry)
+  void SetInputDoseImageData(vtkImageData* imageData);
+  vtkGetObjectMacro(InputDoseImageData, vtkImageData);
+
+  /// Set input density image (float, same lattice as input dose). Only used for energy/mass mapping
+  void SetInputDensityImageData(vtkImageData* imageData);
+  vtkGetObjectMacro(InputDensityImageData, vtkImageData);
+
+  /// Set transform mapping reference IJK coordinates to input dose IJK coordinates
+  void SetReferenceToInputTransform(vtkAbstractTransform* transform);
+  vtkGetObjectMacro(ReferenceToInputTransform, vtkAbstractTransform);
+
+  /// Set accumulated image the warped dose is added to. Its extent defines the reference lattice
+  void SetAccumulatedImageData(vtkImageData* imageData);
+  vtkGetObjectMacro(AccumulatedImageData, vtkImageData);
+
+  /// Weight the warped dose is multiplied with before adding it to the accumulated image
+  vtkSetMacro(Weight, double);
+  vtkGetMacro(Weight, double);
+
+  /// Enable/disable energy/mass mapping. Requires input density image
+  vtkSetMacro(EnergyMassMapping, bool);
+  vtkGetMacro(EnergyMassMapping, bool);
+  vtkBooleanMacro(EnergyMassMapping, bool);
+
+  /// Number of subdivisions of a reference voxel along each axis for energy/mass mapping
+  vtkSetClampMacro(NumberOfSubdivisions, int, 1, 8);
+  vtkGetMacro(NumberOfSubdivisions, int);
+
+  /// Number of threads used for the computation. By default the number of processors is used
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_MAX_THREADS);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Warp the input dose and add it to the accumulated image
+  /// \return Success flag
+  bool Update();
+
+  /// Process a slab of the accumulated image (K index range). Called from the worker threads
+  void ThreadedAccumulate(int kStart, int kEnd);
+
+protected:
+  vtkDeformableDoseAccumulator();
+  virtual ~vtkDeformableDoseAccumulator();
+
+protected:
+  /// Input dose image
+  vtkImageData* InputDoseImageData;
+  /// Input density image for energy/mass mapping
+  vtkImageData* InputDensityImageData;
+  /// Transform from reference IJK to input dose IJK
+  vtkAbstractTransform* ReferenceToInputTransform;
+  /// Accumulated image (running total) on the reference lattice
+  vtkImageData* AccumulatedImageData;
+
+  /// Weight of the input dose
+  double Weight;
+  /// Flag whether energy/mass mapping is performed
+  bool EnergyMassMapping;
+  /// Number of subdivisions per axis for energy/mass mapping
+  int NumberOfSubdivisions;
+  /// Number of threads
+  int NumberOfThreads;
+
+  /// Multithreader executing the slabs
+  vtkMultiThreader* Threader;
+
+private:
+  vtkDeformableDoseAccumulator(const vtkDeformableDoseAccumulator&); // Not implemented
+  void operator=(const vtkDeformableDoseAccumulator&);               // Not implemented
+};
+
+#endif
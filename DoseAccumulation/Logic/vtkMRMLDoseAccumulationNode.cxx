@@ -24,6 +24,8 @@
 // MRML includes
 #include <vtkMRMLScene.h>
 #include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLSegmentationNode.h>
+#include <vtkMRMLTransformNode.h>
 
 // VTK includes
 #include <vtkObjectFactory.h>
@@ -36,15 +38,86 @@
 static const char* REFERENCE_DOSE_VOLUME_REFERENCE_ROLE = "referenceDoseVolumeRef";
 static const char* ACCUMULATED_DOSE_VOLUME_REFERENCE_ROLE = "accumulatedDoseVolumeRef";
 static const char* SELECTED_INPUT_VOLUME_REFERENCE_ROLE = "selectedInputVolumeRef";
+static const char* ALPHA_BETA_SEGMENTATION_REFERENCE_ROLE = "alphaBetaSegmentationRef";
 
 //------------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLDoseAccumulationNode);
 
+namespace
+{
+  //----------------------------------------------------------------------------
+  /// Write node ID to node ID map in the form of "key:value|key:value|"
+  void WriteNodeIdMap(ostream& of, std::map<std::string,std::string>& nodeIdMap)
+  {
+    for (std::map<std::string,std::string>::iterator it = nodeIdMap.begin(); it != nodeIdMap.end(); ++it)
+    {
+      of << it->first << ":" << it->second << "|";
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Read node ID to node ID map written by \sa WriteNodeIdMap
+  void ReadNodeIdMap(const char* attValue, std::map<std::string,std::string>& nodeIdMap)
+  {
+    nodeIdMap.clear();
+    std::stringstream ss;
+    ss << attValue;
+    std::string mapPairStr;
+    while (std::getline(ss, mapPairStr, '|'))
+    {
+      size_t colonPosition = mapPairStr.find( ":" );
+      if (colonPosition == std::string::npos)
+      {
+        continue;
+      }
+      nodeIdMap[mapPairStr.substr(0, colonPosition)] = mapPairStr.substr(colonPosition+1);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Write map of numbers in the form of "key:value|key:value|"
+  template <class T> void WriteNumberMap(ostream& of, std::map<std::string,T>& numberMap)
+  {
+    for (typename std::map<std::string,T>::iterator it = numberMap.begin(); it != numberMap.end(); ++it)
+    {
+      of << it->first << ":" << it->second << "|";
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Read map of numbers written by \sa WriteNumberMap. The last colon is used as separator,
+  /// so that keys containing colons (e.g. segment IDs) are supported
+  template <class T> void ReadNumberMap(const char* attValue, std::map<std::string,T>& numberMap)
+  {
+    numberMap.clear();
+    std::stringstream ss;
+    ss << attValue;
+    std::string mapPairStr;
+    while (std::getline(ss, mapPairStr, '|'))
+    {
+      size_t colonPosition = mapPairStr.rfind( ":" );
+      if (colonPosition == std::string::npos)
+      {
+        continue;
+      }
+      std::stringstream valueStream(mapPairStr.substr(colonPosition+1));
+      T value = T();
+      valueStream >> value;
+      numberMap[mapPairStr.substr(0, colonPosition)] = value;
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 vtkMRMLDoseAccumulationNode::vtkMRMLDoseAccumulationNode()
 {
   this->ShowDoseVolumesOnly = true;
+  this->DeformableAccumulation = false;
+  this->EnergyMassMapping = false;
+  this->DoseModel = PhysicalDose;
+  this->DefaultAlphaBetaRatio = 3.0;
   this->VolumeNodeIdsToWeightsMap.clear();
+  this->AppliedContributionsMap.clear();
 
   this->HideFromEditors = false;
 }
@@ -53,6 +126,7 @@ vtkMRMLDoseAccumulationNode::vtkMRMLDoseAccumulationNode()
 vtkMRMLDoseAccumulationNode::~vtkMRMLDoseAccumulationNode()
 {
   this->VolumeNodeIdsToWeightsMap.clear();
+  this->AppliedContributionsMap.clear();
 }
 
 //----------------------------------------------------------------------------
@@ -64,6 +138,10 @@ void vtkMRMLDoseAccumulationNode::WriteXML(ostream& of, int nIndent)
   vtkIndent indent(nIndent);
 
   of << indent << " ShowDoseVolumesOnly=\"" << (this->ShowDoseVolumesOnly ? "true" : "false") << "\"";
+  of << indent << " DeformableAccumulation=\"" << (this->DeformableAccumulation ? "true" : "false") << "\"";
+  of << indent << " EnergyMassMapping=\"" << (this->EnergyMassMapping ? "true" : "false") << "\"";
+  of << indent << " DoseModel=\"" << this->DoseModel << "\"";
+  of << indent << " DefaultAlphaBetaRatio=\"" << this->DefaultAlphaBetaRatio << "\"";
 
   {
     of << indent << " VolumeNodeIdsToWeightsMap=\"";
@@ -73,6 +151,31 @@ void vtkMRMLDoseAccumulationNode::WriteXML(ostream& of, int nIndent)
       }
     of << "\"";
   }
+
+  of << indent << " VolumeNodeIdsToDeformationTransformNodeIdsMap=\"";
+  WriteNodeIdMap(of, this->VolumeNodeIdsToDeformationTransformNodeIdsMap);
+  of << "\"";
+
+  of << indent << " VolumeNodeIdsToDensityVolumeNodeIdsMap=\"";
+  WriteNodeIdMap(of, this->VolumeNodeIdsToDensityVolumeNodeIdsMap);
+  of << "\"";
+
+  of << indent << " SegmentIdsToAlphaBetaRatiosMap=\"";
+  WriteNumberMap(of, this->SegmentIdsToAlphaBetaRatiosMap);
+  of << "\"";
+
+  of << indent << " VolumeNodeIdsToNumberOfFractionsMap=\"";
+  WriteNumberMap(of, this->VolumeNodeIdsToNumberOfFractionsMap);
+  of << "\"";
+
+  {
+    of << indent << " AppliedContributionsMap=\"";
+    for (std::map<std::string,AppliedContribution>::iterator it = this->AppliedContributionsMap.begin(); it != this->AppliedContributionsMap.end(); ++it)
+      {
+      of << it->first << ":" << it->second.Weight << ":" << it->second.Checksum << "|";
+      }
+    of << "\"";
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -92,6 +195,40 @@ void vtkMRMLDoseAccumulationNode::ReadXMLAttributes(const char** atts)
       this->ShowDoseVolumesOnly = 
         (strcmp(attValue,"true") ? false : true);
       }
+    else if (!strcmp(attName, "DeformableAccumulation")) 
+      {
+      this->DeformableAccumulation = 
+        (strcmp(attValue,"true") ? false : true);
+      }
+    else if (!strcmp(attName, "EnergyMassMapping")) 
+      {
+      this->EnergyMassMapping = 
+        (strcmp(attValue,"true") ? false : true);
+      }
+    else if (!strcmp(attName, "DoseModel")) 
+      {
+      this->DoseModel = vtkVariant(attValue).ToInt();
+      }
+    else if (!strcmp(attName, "DefaultAlphaBetaRatio")) 
+      {
+      this->DefaultAlphaBetaRatio = vtkVariant(attValue).ToDouble();
+      }
+    else if (!strcmp(attName, "SegmentIdsToAlphaBetaRatiosMap")) 
+      {
+      ReadNumberMap(attValue, this->SegmentIdsToAlphaBetaRatiosMap);
+      }
+    else if (!strcmp(attName, "VolumeNodeIdsToNumberOfFractionsMap")) 
+      {
+      ReadNumberMap(attValue, this->VolumeNodeIdsToNumberOfFractionsMap);
+      }
+    else if (!strcmp(attName, "VolumeNodeIdsToDeformationTransformNodeIdsMap")) 
+      {
+      ReadNodeIdMap(attValue, this->VolumeNodeIdsToDeformationTransformNodeIdsMap);
+      }
+    else if (!strcmp(attName, "VolumeNodeIdsToDensityVolumeNodeIdsMap")) 
+      {
+      ReadNodeIdMap(attValue, this->VolumeNodeIdsToDensityVolumeNodeIdsMap);
+      }
     else if (!strcmp(attName, "VolumeNodeIdsToWeightsMap")) 
       {
       std::string valueStr(attValue);
@@ -123,6 +260,27 @@ void vtkMRMLDoseAccumulationNode::ReadXMLAttributes(const char** atts)
           }
         }
       }
+    else if (!strcmp(attName, "AppliedContributionsMap")) 
+      {
+      // Entries are in the form of "volumeNodeId:weight:checksum|"
+      std::stringstream ss;
+      ss << attValue;
+      std::string entryStr;
+      this->AppliedContributionsMap.clear();
+      while (std::getline(ss, entryStr, '|'))
+        {
+        size_t firstColonPosition = entryStr.find( ":" );
+        size_t secondColonPosition = entryStr.rfind( ":" );
+        if (firstColonPosition == std::string::npos || firstColonPosition == secondColonPosition)
+          {
+          continue;
+          }
+        std::string volumeNodeId = entryStr.substr(0, firstColonPosition);
+        double weight = vtkVariant(entryStr.substr(firstColonPosition+1, secondColonPosition-firstColonPosition-1)).ToDouble();
+        unsigned long checksum = vtkVariant(entryStr.substr(secondColonPosition+1)).ToUnsignedLong();
+        this->AppliedContributionsMap[volumeNodeId] = AppliedContribution(weight, checksum);
+        }
+      }
     }
 }
 
@@ -137,8 +295,17 @@ void vtkMRMLDoseAccumulationNode::Copy(vtkMRMLNode *anode)
   vtkMRMLDoseAccumulationNode *node = (vtkMRMLDoseAccumulationNode *) anode;
 
   this->SetShowDoseVolumesOnly(node->ShowDoseVolumesOnly);
+  this->SetDeformableAccumulation(node->DeformableAccumulation);
+  this->SetEnergyMassMapping(node->EnergyMassMapping);
+  this->SetDoseModel(node->DoseModel);
+  this->SetDefaultAlphaBetaRatio(node->DefaultAlphaBetaRatio);
 
   this->VolumeNodeIdsToWeightsMap = node->VolumeNodeIdsToWeightsMap;
+  this->VolumeNodeIdsToDeformationTransformNodeIdsMap = node->VolumeNodeIdsToDeformationTransformNodeIdsMap;
+  this->VolumeNodeIdsToDensityVolumeNodeIdsMap = node->VolumeNodeIdsToDensityVolumeNodeIdsMap;
+  this->SegmentIdsToAlphaBetaRatiosMap = node->SegmentIdsToAlphaBetaRatiosMap;
+  this->VolumeNodeIdsToNumberOfFractionsMap = node->VolumeNodeIdsToNumberOfFractionsMap;
+  this->AppliedContributionsMap = node->AppliedContributionsMap;
 
   this->DisableModifiedEventOff();
   this->InvokePendingModifiedEvent();
@@ -150,6 +317,10 @@ void vtkMRMLDoseAccumulationNode::PrintSelf(ostream& os, vtkIndent indent)
   Superclass::PrintSelf(os,indent);
 
   os << indent << "ShowDoseVolumesOnly:   " << (this->ShowDoseVolumesOnly ? "true" : "false") << "\n";
+  os << indent << "DeformableAccumulation:   " << (this->DeformableAccumulation ? "true" : "false") << "\n";
+  os << indent << "EnergyMassMapping:   " << (this->EnergyMassMapping ? "true" : "false") << "\n";
+  os << indent << "DoseModel:   " << this->DoseModel << "\n";
+  os << indent << "DefaultAlphaBetaRatio:   " << this->DefaultAlphaBetaRatio << "\n";
 
   {
     os << indent << "VolumeNodeIdsToWeightsMap:   ";
@@ -159,6 +330,31 @@ void vtkMRMLDoseAccumulationNode::PrintSelf(ostream& os, vtkIndent indent)
       }
     os << "\n";
   }
+
+  os << indent << "VolumeNodeIdsToDeformationTransformNodeIdsMap:   ";
+  WriteNodeIdMap(os, this->VolumeNodeIdsToDeformationTransformNodeIdsMap);
+  os << "\n";
+
+  os << indent << "VolumeNodeIdsToDensityVolumeNodeIdsMap:   ";
+  WriteNodeIdMap(os, this->VolumeNodeIdsToDensityVolumeNodeIdsMap);
+  os << "\n";
+
+  os << indent << "SegmentIdsToAlphaBetaRatiosMap:   ";
+  WriteNumberMap(os, this->SegmentIdsToAlphaBetaRatiosMap);
+  os << "\n";
+
+  os << indent << "VolumeNodeIdsToNumberOfFractionsMap:   ";
+  WriteNumberMap(os, this->VolumeNodeIdsToNumberOfFractionsMap);
+  os << "\n";
+
+  {
+    os << indent << "AppliedContributionsMap:   ";
+    for (std::map<std::string,AppliedContribution>::iterator it = this->AppliedContributionsMap.begin(); it != this->AppliedContributionsMap.end(); ++it)
+      {
+      os << it->first << ":" << it->second.Weight << ":" << it->second.Checksum << "|";
+      }
+    os << "\n";
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -182,6 +378,13 @@ vtkMRMLScalarVolumeNode* vtkMRMLDoseAccumulationNode::GetAccumulatedDoseVolumeNo
 //----------------------------------------------------------------------------
 void vtkMRMLDoseAccumulationNode::SetAndObserveAccumulatedDoseVolumeNode(vtkMRMLScalarVolumeNode* node)
 {
+  // Applied contributions refer to the running total stored in the previous output volume
+  if (node != this->GetAccumulatedDoseVolumeNode())
+  {
+    this->AppliedContributionsMap.clear();
+    this->Modified();
+  }
+
   this->SetNodeReferenceID(ACCUMULATED_DOSE_VOLUME_REFERENCE_ROLE, (node ? node->GetID() : NULL));
 }
 
@@ -260,3 +463,188 @@ double vtkMRMLDoseAccumulationNode::GetWeightForDoseVolume(vtkMRMLScalarVolumeNo
 
   return weightIt->second;
 }
+
+//----------------------------------------------------------------------------
+void vtkMRMLDoseAccumulationNode::ClearAppliedContributions()
+{
+  if (this->AppliedContributionsMap.empty())
+  {
+    return;
+  }
+
+  this->AppliedContributionsMap.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLDoseAccumulationNode::SetDeformationTransformForDoseVolume(vtkMRMLScalarVolumeNode* node, vtkMRMLTransformNode* transformNode)
+{
+  if (!node)
+  {
+    vtkErrorMacro("SetDeformationTransformForDoseVolume: Invalid dose volume node given");
+    return;
+  }
+
+  if (transformNode)
+  {
+    this->VolumeNodeIdsToDeformationTransformNodeIdsMap[node->GetID()] = transformNode->GetID();
+  }
+  else
+  {
+    this->VolumeNodeIdsToDeformationTransformNodeIdsMap.erase(node->GetID());
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLTransformNode* vtkMRMLDoseAccumulationNode::GetDeformationTransformForDoseVolume(vtkMRMLScalarVolumeNode* node)
+{
+  if (!node || !this->Scene)
+  {
+    return NULL;
+  }
+
+  std::map<std::string, std::string>::iterator transformIt = this->VolumeNodeIdsToDeformationTransformNodeIdsMap.find(node->GetID());
+  if (transformIt == this->VolumeNodeIdsToDeformationTransformNodeIdsMap.end())
+  {
+    return NULL;
+  }
+
+  return vtkMRMLTransformNode::SafeDownCast(this->Scene->GetNodeByID(transformIt->second.c_str()));
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLDoseAccumulationNode::SetDensityVolumeForDoseVolume(vtkMRMLScalarVolumeNode* node, vtkMRMLScalarVolumeNode* densityVolumeNode)
+{
+  if (!node)
+  {
+    vtkErrorMacro("SetDensityVolumeForDoseVolume: Invalid dose volume node given");
+    return;
+  }
+
+  if (densityVolumeNode)
+  {
+    this->VolumeNodeIdsToDensityVolumeNodeIdsMap[node->GetID()] = densityVolumeNode->GetID();
+  }
+  else
+  {
+    this->VolumeNodeIdsToDensityVolumeNodeIdsMap.erase(node->GetID());
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLScalarVolumeNode* vtkMRMLDoseAccumulationNode::GetDensityVolumeForDoseVolume(vtkMRMLScalarVolumeNode* node)
+{
+  if (!node || !this->Scene)
+  {
+    return NULL;
+  }
+
+  std::map<std::string, std::string>::iterator densityIt = this->VolumeNodeIdsToDensityVolumeNodeIdsMap.find(node->GetID());
+  if (densityIt == this->VolumeNodeIdsToDensityVolumeNodeIdsMap.end())
+  {
+    return NULL;
+  }
+
+  return vtkMRMLScalarVolumeNode::SafeDownCast(this->Scene->GetNodeByID(densityIt->second.c_str()));
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLDoseAccumulationNode::SetDoseModel(int doseModel)
+{
+  if (doseModel < PhysicalDose || doseModel > EquivalentDoseIn2GyFractions)
+  {
+    vtkErrorMacro("SetDoseModel: Invalid dose model " << doseModel);
+    return;
+  }
+  if (this->DoseModel != doseModel)
+  {
+    this->DoseModel = doseModel;
+    this->Modified();
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLSegmentationNode* vtkMRMLDoseAccumulationNode::GetAlphaBetaSegmentationNode()
+{
+  return vtkMRMLSegmentationNode::SafeDownCast( this->GetNodeReference(ALPHA_BETA_SEGMENTATION_REFERENCE_ROLE) );
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLDoseAccumulationNode::SetAndObserveAlphaBetaSegmentationNode(vtkMRMLSegmentationNode* node)
+{
+  this->SetNodeReferenceID(ALPHA_BETA_SEGMENTATION_REFERENCE_ROLE, (node ? node->GetID() : NULL));
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLDoseAccumulationNode::SetAlphaBetaRatioForSegment(const char* segmentID, double alphaBetaRatio)
+{
+  if (!segmentID)
+  {
+    vtkErrorMacro("SetAlphaBetaRatioForSegment: Invalid segment ID given");
+    return;
+  }
+
+  if (alphaBetaRatio > 0.0)
+  {
+    this->SegmentIdsToAlphaBetaRatiosMap[segmentID] = alphaBetaRatio;
+  }
+  else
+  {
+    this->SegmentIdsToAlphaBetaRatiosMap.erase(segmentID);
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+double vtkMRMLDoseAccumulationNode::GetAlphaBetaRatioForSegment(const char* segmentID)
+{
+  if (!segmentID)
+  {
+    return this->DefaultAlphaBetaRatio;
+  }
+
+  std::map<std::string, double>::iterator alphaBetaIt = this->SegmentIdsToAlphaBetaRatiosMap.find(segmentID);
+  if (alphaBetaIt == this->SegmentIdsToAlphaBetaRatiosMap.end())
+  {
+    return this->DefaultAlphaBetaRatio;
+  }
+
+  return alphaBetaIt->second;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLDoseAccumulationNode::SetNumberOfFractionsForDoseVolume(vtkMRMLScalarVolumeNode* node, int numberOfFractions)
+{
+  if (!node)
+  {
+    vtkErrorMacro("SetNumberOfFractionsForDoseVolume: Invalid dose volume node given");
+    return;
+  }
+  if (numberOfFractions < 1)
+  {
+    vtkErrorMacro("SetNumberOfFractionsForDoseVolume: Invalid number of fractions " << numberOfFractions << " for dose volume '" << node->GetName() << "'");
+    return;
+  }
+
+  this->VolumeNodeIdsToNumberOfFractionsMap[node->GetID()] = numberOfFractions;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLDoseAccumulationNode::GetNumberOfFractionsForDoseVolume(vtkMRMLScalarVolumeNode* node)
+{
+  if (!node)
+  {
+    return 1;
+  }
+
+  std::map<std::string, int>::iterator fractionsIt = this->VolumeNodeIdsToNumberOfFractionsMap.find(node->GetID());
+  if (fractionsIt == this->VolumeNodeIdsToNumberOfFractionsMap.end() || fractionsIt->second < 1)
+  {
+    return 1;
+  }
+
+  return fractionsIt->second;
+}
@@ -31,10 +31,21 @@
 #include "vtkSlicerDoseAccumulationModuleLogicExport.h"
 
 class vtkMRMLScalarVolumeNode;
+class vtkMRMLSegmentationNode;
+class vtkMRMLTransformNode;
 
 /// \ingroup SlicerRt_QtModules_DoseAccumulation
 class VTK_SLICER_DOSEACCUMULATION_LOGIC_EXPORT vtkMRMLDoseAccumulationNode : public vtkMRMLNode
 {
+public:
+  /// Dose quantity that is accumulated
+  enum DoseModelType
+  {
+    PhysicalDose = 0,
+    BiologicallyEffectiveDose,
+    EquivalentDoseIn2GyFractions
+  };
+
 public:
   static vtkMRMLDoseAccumulationNode *New();
   vtkTypeMacro(vtkMRMLDoseAccumulationNode,vtkMRMLNode);
@@ -91,6 +102,101 @@ public:
     return &this->VolumeNodeIdsToWeightsMap;
   }
 
+  /// Enable/Disable deformable accumulation. If enabled, input dose volumes that have a
+  /// deformation transform are warped to the reference through the transform
+  vtkBooleanMacro(DeformableAccumulation, bool);
+  vtkGetMacro(DeformableAccumulation, bool);
+  vtkSetMacro(DeformableAccumulation, bool);
+
+  /// Enable/Disable energy/mass mapping in deformable accumulation.
+  /// Only used for input dose volumes that have a density volume
+  vtkBooleanMacro(EnergyMassMapping, bool);
+  vtkGetMacro(EnergyMassMapping, bool);
+  vtkSetMacro(EnergyMassMapping, bool);
+
+  /// Set deformation transform for an input dose volume node. The transform maps the reference
+  /// (planning) frame to the frame of the input dose, i.e. its transform from parent is used for warping
+  /// (this is the case if the registration was done with the input dose frame as moving image)
+  void SetDeformationTransformForDoseVolume(vtkMRMLScalarVolumeNode* node, vtkMRMLTransformNode* transformNode);
+  /// Get deformation transform for an input dose volume node
+  /// \return The transform node if set, NULL otherwise
+  vtkMRMLTransformNode* GetDeformationTransformForDoseVolume(vtkMRMLScalarVolumeNode* node);
+  /// Get volume node IDs to deformation transform node IDs map
+  std::map<std::string,std::string>* GetVolumeNodeIdsToDeformationTransformNodeIdsMap()
+  {
+    return &this->VolumeNodeIdsToDeformationTransformNodeIdsMap;
+  }
+
+  /// Set density volume (CT in Hounsfield units, e.g. the CT of the fraction) for an input dose volume node.
+  /// Used for energy/mass mapping in deformable accumulation
+  void SetDensityVolumeForDoseVolume(vtkMRMLScalarVolumeNode* node, vtkMRMLScalarVolumeNode* densityVolumeNode);
+  /// Get density volume for an input dose volume node
+  /// \return The density volume node if set, NULL otherwise
+  vtkMRMLScalarVolumeNode* GetDensityVolumeForDoseVolume(vtkMRMLScalarVolumeNode* node);
+  /// Get volume node IDs to density volume node IDs map
+  std::map<std::string,std::string>* GetVolumeNodeIdsToDensityVolumeNodeIdsMap()
+  {
+    return &this->VolumeNodeIdsToDensityVolumeNodeIdsMap;
+  }
+
+  /// Set dose model (\sa DoseModelType). If a biological model (BED or EQD2) is selected, then each input dose
+  /// is converted voxelwise using its number of fractions and the alpha/beta ratio of the tissue before summing
+  void SetDoseModel(int doseModel);
+  vtkGetMacro(DoseModel, int);
+
+  /// Default alpha/beta ratio (Gy). Used for voxels that are not in any segment with specified alpha/beta ratio
+  vtkSetClampMacro(DefaultAlphaBetaRatio, double, 0.01, VTK_DOUBLE_MAX);
+  vtkGetMacro(DefaultAlphaBetaRatio, double);
+
+  /// Get segmentation node defining the structures with specific alpha/beta ratios
+  vtkMRMLSegmentationNode* GetAlphaBetaSegmentationNode();
+  /// Set and observe segmentation node defining the structures with specific alpha/beta ratios
+  void SetAndObserveAlphaBetaSegmentationNode(vtkMRMLSegmentationNode* node);
+
+  /// Set alpha/beta ratio (Gy) for a segment of the alpha/beta segmentation. Non-positive value removes the entry,
+  /// in which case the default alpha/beta ratio is used for the segment
+  void SetAlphaBetaRatioForSegment(const char* segmentID, double alphaBetaRatio);
+  /// Get alpha/beta ratio for a segment of the alpha/beta segmentation
+  /// \return Alpha/beta ratio if set for the segment, the default alpha/beta ratio otherwise
+  double GetAlphaBetaRatioForSegment(const char* segmentID);
+  /// Get segment IDs to alpha/beta ratios map
+  std::map<std::string,double>* GetSegmentIdsToAlphaBetaRatiosMap()
+  {
+    return &this->SegmentIdsToAlphaBetaRatiosMap;
+  }
+
+  /// Set number of fractions in which an input dose volume was delivered. Used by the biological dose models
+  void SetNumberOfFractionsForDoseVolume(vtkMRMLScalarVolumeNode* node, int numberOfFractions);
+  /// Get number of fractions for an input dose volume node
+  /// \return Number of fractions if set, 1 otherwise
+  int GetNumberOfFractionsForDoseVolume(vtkMRMLScalarVolumeNode* node);
+  /// Get volume node IDs to number of fractions map
+  std::map<std::string,int>* GetVolumeNodeIdsToNumberOfFractionsMap()
+  {
+    return &this->VolumeNodeIdsToNumberOfFractionsMap;
+  }
+
+public:
+  /// Record of a dose volume that has been added to the accumulated dose volume (running total).
+  /// Used for incremental accumulation: only inputs whose weight or content changed need to be re-applied.
+  struct AppliedContribution
+  {
+    AppliedContribution() : Weight(0.0), Checksum(0) { }
+    AppliedContribution(double weight, unsigned long checksum) : Weight(weight), Checksum(checksum) { }
+    /// Weight with which the dose volume was added to the running total
+    double Weight;
+    /// Checksum of the dose volume (voxels and geometry) at the time it was added
+    unsigned long Checksum;
+  };
+
+  /// Get map assigning the applied contribution records to the volume node IDs
+  std::map<std::string,AppliedContribution>* GetAppliedContributionsMap()
+  {
+    return &this->AppliedContributionsMap;
+  }
+  /// Forget all applied contributions (the accumulated volume will be fully recomputed at next update)
+  void ClearAppliedContributions();
+
 protected:
   vtkMRMLDoseAccumulationNode();
   ~vtkMRMLDoseAccumulationNode();
@@ -101,9 +207,37 @@ protected:
   /// State of Show dose volumes only checkbox
   bool ShowDoseVolumesOnly;
 
+  /// Flag indicating whether input dose volumes are warped through their deformation transforms
+  bool DeformableAccumulation;
+
+  /// Flag indicating whether energy/mass mapping is used in deformable accumulation
+  bool EnergyMassMapping;
+
   /// Map assigning a weight to the available input volume nodes
   /// (as the user set it on the module GUI)
   std::map<std::string, double> VolumeNodeIdsToWeightsMap;
+
+  /// Map assigning deformation transform node IDs to the input volume node IDs
+  std::map<std::string, std::string> VolumeNodeIdsToDeformationTransformNodeIdsMap;
+
+  /// Map assigning density volume node IDs to the input volume node IDs
+  std::map<std::string, std::string> VolumeNodeIdsToDensityVolumeNodeIdsMap;
+
+  /// Dose model (physical dose, BED or EQD2)
+  int DoseModel;
+
+  /// Alpha/beta ratio used outside the segments with specified alpha/beta ratio
+  double DefaultAlphaBetaRatio;
+
+  /// Map assigning alpha/beta ratios to the segment IDs in the alpha/beta segmentation
+  std::map<std::string, double> SegmentIdsToAlphaBetaRatiosMap;
+
+  /// Map assigning number of fractions to the input volume node IDs
+  std::map<std::string, int> VolumeNodeIdsToNumberOfFractionsMap;
+
+  /// Map assigning the applied contribution records to the volume node IDs
+  /// that are currently contained in the accumulated dose volume
+  std::map<std::string, AppliedContribution> AppliedContributionsMap;
 };
 
 #endif
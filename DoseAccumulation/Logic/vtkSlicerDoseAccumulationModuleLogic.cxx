@@ -22,6 +22,16 @@
 // DoseAccumulation includes
 #include "vtkSlicerDoseAccumulationModuleLogic.h"
 #include "vtkMRMLDoseAccumulationNode.h"
+#include "vtkDeformableDoseAccumulator.h"
+#include "vtkBiologicalDoseAccumulator.h"
+
+// Segmentations includes
+#include "vtkMRMLSegmentationNode.h"
+#include "vtkSlicerSegmentationsModuleLogic.h"
+
+// SegmentationCore includes
+#include "vtkOrientedImageData.h"
+#include "vtkOrientedImageDataResample.h"
 
 // Subject Hierarchy includes
 #include "vtkMRMLSubjectHierarchyConstants.h"
@@ -47,12 +57,23 @@
 // VTK includes
 #include <vtkNew.h>
 #include <vtkImageMathematics.h>
+#include <vtkImageCast.h>
 #include <vtkImageData.h>
+#include <vtkPointData.h>
 #include <vtkSmartPointer.h>
 #include <vtkImageReslice.h>
 #include <vtkGeneralTransform.h>
+#include <vtkMatrix4x4.h>
 #include <vtkObjectFactory.h>
 
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <set>
+#include <vector>
+
 //----------------------------------------------------------------------------
 const std::string vtkSlicerDoseAccumulationModuleLogic::DOSEACCUMULATION_ATTRIBUTE_PREFIX = "DoseAccumulation.";
 const std::string vtkSlicerDoseAccumulationModuleLogic::DOSEACCUMULATION_DOSE_VOLUME_NODE_NAME_ATTRIBUTE_NAME = vtkSlicerDoseAccumulationModuleLogic::DOSEACCUMULATION_ATTRIBUTE_PREFIX + "DoseVolumeNodeName";
@@ -61,6 +82,86 @@ const std::string vtkSlicerDoseAccumulationModuleLogic::DOSEACCUMULATION_OUTPUT_
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerDoseAccumulationModuleLogic);
 
+namespace
+{
+  /// Change of a dose volume contribution that needs to be applied to the running total
+  struct DoseContributionChange
+  {
+    vtkMRMLScalarVolumeNode* DoseVolumeNode;
+    /// Weight of the dose volume after applying the change (0 if removed)
+    double NewWeight;
+    /// Weight of the dose volume currently contained in the running total (0 if not yet added)
+    double OldWeight;
+    unsigned long Checksum;
+  };
+
+  //----------------------------------------------------------------------------
+  /// Add weighted input scalars to the accumulated scalars. The sum is computed in double precision,
+  /// and rounded to the nearest value if the accumulated volume has integer type (truncation would
+  /// introduce a systematic drift when contributions are repeatedly added and subtracted)
+  template <class T> void AddWeightedScalars(T* inputPtr, T* accumulatedPtr, vtkIdType numberOfScalars, double weight)
+  {
+    const bool isInteger = std::numeric_limits<T>::is_integer;
+    for (vtkIdType index=0; index<numberOfScalars; ++index)
+    {
+      double sum = static_cast<double>(accumulatedPtr[index]) + weight * static_cast<double>(inputPtr[index]);
+      accumulatedPtr[index] = static_cast<T>(isInteger ? floor(sum + 0.5) : sum);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Update Adler-32 checksum with a buffer
+  void UpdateAdler32(const unsigned char* buffer, size_t length, unsigned long& a, unsigned long& b)
+  {
+    static const unsigned long ADLER_MODULO = 65521;
+    // Largest number of bytes that can be summed without overflowing 32 bits before taking modulo
+    static const size_t ADLER_BLOCK_SIZE = 5552;
+    while (length > 0)
+    {
+      size_t blockLength = std::min(length, ADLER_BLOCK_SIZE);
+      length -= blockLength;
+      while (blockLength--)
+      {
+        a += *(buffer++);
+        b += a;
+      }
+      a %= ADLER_MODULO;
+      b %= ADLER_MODULO;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Set alpha/beta ratio in the voxels of the alpha/beta image where the segment labelmap is non-zero
+  template <class T> void PaintAlphaBetaInSegment(T* labelmapPtr, const int labelmapExtent[6], float* alphaBetaPtr, const int alphaBetaExtent[6], float alphaBetaRatio)
+  {
+    int paintExtent[6] = {0, -1, 0, -1, 0, -1};
+    for (int axis=0; axis<3; ++axis)
+    {
+      paintExtent[2*axis] = std::max(labelmapExtent[2*axis], alphaBetaExtent[2*axis]);
+      paintExtent[2*axis+1] = std::min(labelmapExtent[2*axis+1], alphaBetaExtent[2*axis+1]);
+    }
+    vtkIdType labelmapRowSize = labelmapExtent[1] - labelmapExtent[0] + 1;
+    vtkIdType labelmapSliceSize = labelmapRowSize * (labelmapExtent[3] - labelmapExtent[2] + 1);
+    vtkIdType alphaBetaRowSize = alphaBetaExtent[1] - alphaBetaExtent[0] + 1;
+    vtkIdType alphaBetaSliceSize = alphaBetaRowSize * (alphaBetaExtent[3] - alphaBetaExtent[2] + 1);
+    for (int k=paintExtent[4]; k<=paintExtent[5]; ++k)
+    {
+      for (int j=paintExtent[2]; j<=paintExtent[3]; ++j)
+      {
+        T* labelmapRowPtr = labelmapPtr + (k-labelmapExtent[4]) * labelmapSliceSize + (j-labelmapExtent[2]) * labelmapRowSize - labelmapExtent[0];
+        float* alphaBetaRowPtr = alphaBetaPtr + (k-alphaBetaExtent[4]) * alphaBetaSliceSize + (j-alphaBetaExtent[2]) * alphaBetaRowSize - alphaBetaExtent[0];
+        for (int i=paintExtent[0]; i<=paintExtent[1]; ++i)
+        {
+          if (labelmapRowPtr[i] != 0)
+          {
+            alphaBetaRowPtr[i] = alphaBetaRatio;
+          }
+        }
+      }
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 vtkSlicerDoseAccumulationModuleLogic::vtkSlicerDoseAccumulationModuleLogic()
 {
@@ -147,6 +248,9 @@ void vtkSlicerDoseAccumulationModuleLogic::OnMRMLSceneNodeRemoved(vtkMRMLNode* n
       vtkMRMLDoseAccumulationNode* doseAccumulationNode = vtkMRMLDoseAccumulationNode::SafeDownCast(currentNode);
       doseAccumulationNode->RemoveSelectedInputVolumeNode(volumeNode);
       doseAccumulationNode->GetVolumeNodeIdsToWeightsMap()->erase(volumeNode->GetID());
+      doseAccumulationNode->GetVolumeNodeIdsToDeformationTransformNodeIdsMap()->erase(volumeNode->GetID());
+      doseAccumulationNode->GetVolumeNodeIdsToDensityVolumeNodeIdsMap()->erase(volumeNode->GetID());
+      doseAccumulationNode->GetVolumeNodeIdsToNumberOfFractionsMap()->erase(volumeNode->GetID());
       currentNode = this->GetMRMLScene()->GetNextNodeByClass("vtkMRMLDoseAccumulationNode");
     }
   }
@@ -204,12 +308,20 @@ const char* vtkSlicerDoseAccumulationModuleLogic::AccumulateDoseVolumes(vtkMRMLD
     return errorMessage;
   }
 
-  // Get reference image info
-  int referenceDimensions[3] = {0, 0, 0};
-  referenceDoseVolumeNode->GetImageData()->GetDimensions(referenceDimensions);
+  // Alpha/beta ratios for converting to biological dose
+  vtkSmartPointer<vtkImageData> alphaBetaImageData = vtkSmartPointer<vtkImageData>::New();
+  if ( parameterNode->GetDoseModel() != vtkMRMLDoseAccumulationNode::PhysicalDose
+    && !this->CreateAlphaBetaImage(parameterNode, alphaBetaImageData) )
+  {
+    const char* errorMessage = "Failed to create alpha/beta ratio image";
+    vtkErrorMacro("AccumulateDoseVolumes: " << errorMessage);
+    return errorMessage;
+  }
 
   // Apply weight and accumulate input dose volumes
   vtkSmartPointer<vtkImageData> accumulatedImageData = vtkSmartPointer<vtkImageData>::New();
+  std::map<std::string,double>* volumeNodeIdsToWeightsMap = parameterNode->GetVolumeNodeIdsToWeightsMap();
+  std::map<std::string,vtkMRMLDoseAccumulationNode::AppliedContribution> appliedContributions;
   for (int inputVolumeIndex = 0; inputVolumeIndex<numberOfInputDoseVolumes; inputVolumeIndex++)
   {
     vtkMRMLScalarVolumeNode* currentInputDoseVolumeNode = parameterNode->GetNthSelectedInputVolumeNode(inputVolumeIndex);
@@ -220,39 +332,41 @@ const char* vtkSlicerDoseAccumulationModuleLogic::AccumulateDoseVolumes(vtkMRMLD
       vtkErrorMacro("AccumulateDoseVolumes: " << errorMessage.str());
       return errorMessage.str().c_str();
     }
-    std::map<std::string,double>* volumeNodeIdsToWeightsMap = parameterNode->GetVolumeNodeIdsToWeightsMap();
     double currentWeight = (*volumeNodeIdsToWeightsMap)[currentInputDoseVolumeNode->GetID()];
 
-    vtkMRMLScalarVolumeNode* resampledInputDoseVolumeNode = 
-      vtkSlicerVolumesLogic::ResampleVolumeToReferenceVolume(currentInputDoseVolumeNode, referenceDoseVolumeNode);
+    // Add (accumulate) current weighted input volume to the intermediate accumulated volume
+    if (!this->AddDoseContribution(parameterNode, currentInputDoseVolumeNode, currentWeight, 0.0, alphaBetaImageData, accumulatedImageData))
+    {
+      const char* errorMessage = "Failed to add input dose volume to accumulated dose";
+      vtkErrorMacro("AccumulateDoseVolumes: " << errorMessage << " (input volume: " << currentInputDoseVolumeNode->GetName() << ")");
+      return errorMessage;
+    }
 
-    // Apply weight
-    vtkSmartPointer<vtkImageMathematics> multiplyFilter = vtkSmartPointer<vtkImageMathematics>::New();
-    multiplyFilter->SetInputConnection(resampledInputDoseVolumeNode->GetImageDataConnection());
-    multiplyFilter->SetConstantK(currentWeight);
-    multiplyFilter->SetOperationToMultiplyByK();
-    multiplyFilter->Update();
+    appliedContributions[currentInputDoseVolumeNode->GetID()] = vtkMRMLDoseAccumulationNode::AppliedContribution(
+      currentWeight, this->GetDoseContributionChecksum(parameterNode, currentInputDoseVolumeNode) );
+  }
 
-    // Add (accumulate) current input volume to the intermediate accumulated volume
-    if (inputVolumeIndex > 0)
-    {
-      vtkSmartPointer<vtkImageMathematics> addFilter = vtkSmartPointer<vtkImageMathematics>::New(); 
-      addFilter->SetInput1Data(accumulatedImageData);
-      addFilter->SetInput2Data(multiplyFilter->GetOutput());
-      addFilter->SetOperationToAdd();
-      addFilter->Update();
+  // Set output accumulated dose image info
+  outputAccumulatedDoseVolumeNode->CopyOrientation(referenceDoseVolumeNode);
+  outputAccumulatedDoseVolumeNode->SetAndObserveImageData(accumulatedImageData);
 
-      accumulatedImageData->DeepCopy(addFilter->GetOutput());
-    }
-    // If intermediate accumulated volume is empty (first iteration)
-    // then just copy the weighted input dose volume in it
-    else
-    {
-      accumulatedImageData->DeepCopy(multiplyFilter->GetOutput());
-    }
+  // Store the contributions so that later changes can be applied incrementally
+  (*parameterNode->GetAppliedContributionsMap()) = appliedContributions;
+  parameterNode->Modified();
 
-    // Remove the resample dose currentNode from scene and release the memory
-    this->GetMRMLScene()->RemoveNode(resampledInputDoseVolumeNode);
+  return this->SetupAccumulatedDoseVolumeNode(parameterNode);
+}
+
+//---------------------------------------------------------------------------
+const char* vtkSlicerDoseAccumulationModuleLogic::SetupAccumulatedDoseVolumeNode(vtkMRMLDoseAccumulationNode* parameterNode)
+{
+  vtkMRMLScalarVolumeNode* outputAccumulatedDoseVolumeNode = parameterNode->GetAccumulatedDoseVolumeNode();
+  vtkMRMLScalarVolumeNode* referenceDoseVolumeNode = parameterNode->GetReferenceDoseVolumeNode();
+  if (!outputAccumulatedDoseVolumeNode || !referenceDoseVolumeNode)
+  {
+    const char* errorMessage = "Invalid reference or output volume!";
+    vtkErrorMacro("SetupAccumulatedDoseVolumeNode: " << errorMessage);
+    return errorMessage;
   }
 
   // Create display currentNode for the accumulated volume
@@ -268,12 +382,10 @@ const char* vtkSlicerDoseAccumulationModuleLogic::AccumulateDoseVolumes(vtkMRMLD
   else
   {
     outputAccumulatedDoseVolumeDisplayNode->SetAndObserveColorNodeID("vtkMRMLColorTableNodeRainbow");
-    vtkErrorMacro("AccumulateDoseVolumes: Failed to get default dose color table!");
+    vtkErrorMacro("SetupAccumulatedDoseVolumeNode: Failed to get default dose color table!");
   }
 
-  // Set output accumulated dose image info
-  outputAccumulatedDoseVolumeNode->CopyOrientation(referenceDoseVolumeNode);
-  outputAccumulatedDoseVolumeNode->SetAndObserveImageData(accumulatedImageData);
+  // Set output accumulated dose display info
   outputAccumulatedDoseVolumeNode->SetAndObserveDisplayNodeID( outputAccumulatedDoseVolumeDisplayNode->GetID() );
   outputAccumulatedDoseVolumeNode->SetAttribute(SlicerRtCommon::DICOMRTIMPORT_DOSE_VOLUME_IDENTIFIER_ATTRIBUTE_NAME.c_str(), "1");
 
@@ -293,7 +405,7 @@ const char* vtkSlicerDoseAccumulationModuleLogic::AccumulateDoseVolumes(vtkMRMLD
   if (!referenceDoseVolumeSubjectHierarchyNode)
   {
     const char* errorMessage = "No subject hierarchy currentNode found for reference dose!";
-    vtkErrorMacro("AccumulateDoseVolumes: " << errorMessage);
+    vtkErrorMacro("SetupAccumulatedDoseVolumeNode: " << errorMessage);
     return errorMessage;
   }
   vtkMRMLSubjectHierarchyNode* studyNode = referenceDoseVolumeSubjectHierarchyNode->GetAncestorAtLevel(
@@ -301,7 +413,7 @@ const char* vtkSlicerDoseAccumulationModuleLogic::AccumulateDoseVolumes(vtkMRMLD
   if (!studyNode)
   {
     const char* errorMessage = "No study currentNode found for reference dose!";
-    vtkErrorMacro("AccumulateDoseVolumes: " << errorMessage);
+    vtkErrorMacro("SetupAccumulatedDoseVolumeNode: " << errorMessage);
     return errorMessage;
   }
 
@@ -315,7 +427,7 @@ const char* vtkSlicerDoseAccumulationModuleLogic::AccumulateDoseVolumes(vtkMRMLD
     if (!childSubjectHierarchyNode)
     {
       const char* errorMessage = "Failed to create subject hierarchy currentNode!";
-      vtkErrorMacro("AccumulateDoseVolumes: " << errorMessage);
+      vtkErrorMacro("SetupAccumulatedDoseVolumeNode: " << errorMessage);
       return errorMessage;
     }
   }
@@ -337,3 +449,597 @@ const char* vtkSlicerDoseAccumulationModuleLogic::AccumulateDoseVolumes(vtkMRMLD
 
   return NULL;
 }
+
+//---------------------------------------------------------------------------
+const char* vtkSlicerDoseAccumulationModuleLogic::UpdateAccumulatedDoseVolume(vtkMRMLDoseAccumulationNode* parameterNode)
+{
+  if (!parameterNode)
+  {
+    const char* errorMessage = "No parameter set node";
+    vtkErrorMacro("UpdateAccumulatedDoseVolume: " << errorMessage);
+    return errorMessage;
+  }
+
+  // Perform full accumulation if there is no valid running total
+  vtkMRMLScalarVolumeNode* outputAccumulatedDoseVolumeNode = parameterNode->GetAccumulatedDoseVolumeNode();
+  vtkMRMLScalarVolumeNode* referenceDoseVolumeNode = parameterNode->GetReferenceDoseVolumeNode();
+  std::map<std::string,vtkMRMLDoseAccumulationNode::AppliedContribution>* appliedContributions = parameterNode->GetAppliedContributionsMap();
+  if ( !outputAccumulatedDoseVolumeNode || !referenceDoseVolumeNode || appliedContributions->empty()
+    || !outputAccumulatedDoseVolumeNode->GetImageData() || !outputAccumulatedDoseVolumeNode->GetImageData()->GetPointData()->GetScalars()
+    || !SlicerRtCommon::DoVolumeLatticesMatch(outputAccumulatedDoseVolumeNode, referenceDoseVolumeNode) )
+  {
+    return this->AccumulateDoseVolumes(parameterNode);
+  }
+  if (parameterNode->GetNumberOfSelectedInputVolumeNodes() == 0)
+  {
+    const char* errorMessage = "No dose volume selected";
+    vtkErrorMacro("UpdateAccumulatedDoseVolume: " << errorMessage);
+    return errorMessage;
+  }
+
+  // Collect the changes since the last accumulation
+  std::vector<DoseContributionChange> changes;
+  std::set<std::string> selectedVolumeNodeIds;
+  std::map<std::string,double>* volumeNodeIdsToWeightsMap = parameterNode->GetVolumeNodeIdsToWeightsMap();
+  for (unsigned int inputVolumeIndex=0; inputVolumeIndex<parameterNode->GetNumberOfSelectedInputVolumeNodes(); ++inputVolumeIndex)
+  {
+    vtkMRMLScalarVolumeNode* currentInputDoseVolumeNode = parameterNode->GetNthSelectedInputVolumeNode(inputVolumeIndex);
+    if (!currentInputDoseVolumeNode || !currentInputDoseVolumeNode->GetImageData())
+    {
+      const char* errorMessage = "No image data in input volume";
+      vtkErrorMacro("UpdateAccumulatedDoseVolume: " << errorMessage << " #" << inputVolumeIndex);
+      return errorMessage;
+    }
+    std::string currentId(currentInputDoseVolumeNode->GetID());
+    selectedVolumeNodeIds.insert(currentId);
+
+    DoseContributionChange change;
+    change.DoseVolumeNode = currentInputDoseVolumeNode;
+    change.NewWeight = (*volumeNodeIdsToWeightsMap)[currentId];
+    change.OldWeight = 0.0;
+    change.Checksum = this->GetDoseContributionChecksum(parameterNode, currentInputDoseVolumeNode);
+
+    std::map<std::string,vtkMRMLDoseAccumulationNode::AppliedContribution>::iterator appliedIt = appliedContributions->find(currentId);
+    if (appliedIt != appliedContributions->end())
+    {
+      if (appliedIt->second.Checksum != change.Checksum)
+      {
+        // Dose volume changed underneath since it was added, so its old contribution cannot be removed from the running total
+        vtkDebugMacro("UpdateAccumulatedDoseVolume: Dose volume '" << currentInputDoseVolumeNode->GetName() << "' changed since it was accumulated. Recomputing accumulated dose");
+        return this->AccumulateDoseVolumes(parameterNode);
+      }
+      if (SlicerRtCommon::AreEqualWithTolerance(appliedIt->second.Weight, change.NewWeight))
+      {
+        continue; // No change
+      }
+      change.OldWeight = appliedIt->second.Weight;
+    }
+    changes.push_back(change);
+  }
+
+  // Collect the applied contributions that have been deselected since
+  for (std::map<std::string,vtkMRMLDoseAccumulationNode::AppliedContribution>::iterator appliedIt = appliedContributions->begin();
+    appliedIt != appliedContributions->end(); ++appliedIt)
+  {
+    if (selectedVolumeNodeIds.count(appliedIt->first))
+    {
+      continue;
+    }
+
+    vtkMRMLScalarVolumeNode* removedDoseVolumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(
+      this->GetMRMLScene()->GetNodeByID(appliedIt->first.c_str()) );
+    if ( !removedDoseVolumeNode || !removedDoseVolumeNode->GetImageData()
+      || this->GetDoseContributionChecksum(parameterNode, removedDoseVolumeNode) != appliedIt->second.Checksum )
+    {
+      // Removed dose volume is not available any more in its original form, so it cannot be subtracted
+      return this->AccumulateDoseVolumes(parameterNode);
+    }
+
+    DoseContributionChange change;
+    change.DoseVolumeNode = removedDoseVolumeNode;
+    change.NewWeight = 0.0;
+    change.OldWeight = appliedIt->second.Weight;
+    change.Checksum = appliedIt->second.Checksum;
+    changes.push_back(change);
+  }
+
+  // Alpha/beta ratios for converting to biological dose
+  vtkSmartPointer<vtkImageData> alphaBetaImageData = vtkSmartPointer<vtkImageData>::New();
+  if ( !changes.empty() && parameterNode->GetDoseModel() != vtkMRMLDoseAccumulationNode::PhysicalDose
+    && !this->CreateAlphaBetaImage(parameterNode, alphaBetaImageData) )
+  {
+    const char* errorMessage = "Failed to create alpha/beta ratio image";
+    vtkErrorMacro("UpdateAccumulatedDoseVolume: " << errorMessage);
+    return errorMessage;
+  }
+
+  // Apply changes to the running total
+  vtkImageData* accumulatedImageData = outputAccumulatedDoseVolumeNode->GetImageData();
+  for (std::vector<DoseContributionChange>::iterator changeIt = changes.begin(); changeIt != changes.end(); ++changeIt)
+  {
+    if (!this->AddDoseContribution(parameterNode, changeIt->DoseVolumeNode, changeIt->NewWeight, changeIt->OldWeight, alphaBetaImageData, accumulatedImageData))
+    {
+      // Running total is in an undefined state, so make sure it is fully recomputed next time
+      parameterNode->ClearAppliedContributions();
+
+      const char* errorMessage = "Failed to apply dose volume change to accumulated dose";
+      vtkErrorMacro("UpdateAccumulatedDoseVolume: " << errorMessage << " (input volume: " << changeIt->DoseVolumeNode->GetName() << ")");
+      return errorMessage;
+    }
+
+    if (changeIt->NewWeight == 0.0 && !selectedVolumeNodeIds.count(changeIt->DoseVolumeNode->GetID()))
+    {
+      appliedContributions->erase(changeIt->DoseVolumeNode->GetID());
+    }
+    else
+    {
+      (*appliedContributions)[changeIt->DoseVolumeNode->GetID()] =
+        vtkMRMLDoseAccumulationNode::AppliedContribution(changeIt->NewWeight, changeIt->Checksum);
+    }
+  }
+
+  if (!changes.empty())
+  {
+    parameterNode->Modified();
+  }
+
+  return NULL;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDoseAccumulationModuleLogic::AddDoseContribution(vtkMRMLDoseAccumulationNode* parameterNode, vtkMRMLScalarVolumeNode* inputDoseVolumeNode, double newWeight, double oldWeight, vtkImageData* alphaBetaImageData, vtkImageData* accumulatedImageData)
+{
+  if (!parameterNode)
+  {
+    vtkErrorMacro("AddDoseContribution: Invalid parameter set node!");
+    return false;
+  }
+
+  if (parameterNode->GetDoseModel() == vtkMRMLDoseAccumulationNode::PhysicalDose)
+  {
+    return this->AddWeightedDoseVolume(parameterNode, inputDoseVolumeNode, newWeight - oldWeight, accumulatedImageData);
+  }
+
+  return this->AddBiologicalDoseVolume(parameterNode, inputDoseVolumeNode, newWeight, oldWeight, alphaBetaImageData, accumulatedImageData);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDoseAccumulationModuleLogic::AddWeightedDoseVolume(vtkMRMLDoseAccumulationNode* parameterNode, vtkMRMLScalarVolumeNode* inputDoseVolumeNode, double weight, vtkImageData* accumulatedImageData)
+{
+  vtkMRMLScalarVolumeNode* referenceDoseVolumeNode = (parameterNode ? parameterNode->GetReferenceDoseVolumeNode() : NULL);
+  if (!inputDoseVolumeNode || !inputDoseVolumeNode->GetImageData() || !referenceDoseVolumeNode || !accumulatedImageData)
+  {
+    vtkErrorMacro("AddWeightedDoseVolume: Invalid input arguments!");
+    return false;
+  }
+
+  // Warp dose through its deformation if requested
+  if (parameterNode->GetDeformableAccumulation())
+  {
+    vtkMRMLTransformNode* deformationTransformNode = parameterNode->GetDeformationTransformForDoseVolume(inputDoseVolumeNode);
+    if (deformationTransformNode)
+    {
+      return this->AddDeformedWeightedDoseVolume(parameterNode, inputDoseVolumeNode, deformationTransformNode, weight, accumulatedImageData);
+    }
+  }
+
+  vtkMRMLScalarVolumeNode* resampledInputDoseVolumeNode = 
+    vtkSlicerVolumesLogic::ResampleVolumeToReferenceVolume(inputDoseVolumeNode, referenceDoseVolumeNode);
+  if (!resampledInputDoseVolumeNode || !resampledInputDoseVolumeNode->GetImageData())
+  {
+    vtkErrorMacro("AddWeightedDoseVolume: Failed to resample dose volume '" << inputDoseVolumeNode->GetName() << "' to reference geometry!");
+    return false;
+  }
+
+  bool success = true;
+  if (!accumulatedImageData->GetPointData()->GetScalars())
+  {
+    // If accumulated image is empty then just copy the weighted input dose volume in it
+    vtkSmartPointer<vtkImageMathematics> multiplyFilter = vtkSmartPointer<vtkImageMathematics>::New();
+    multiplyFilter->SetInputConnection(resampledInputDoseVolumeNode->GetImageDataConnection());
+    multiplyFilter->SetConstantK(weight);
+    multiplyFilter->SetOperationToMultiplyByK();
+    multiplyFilter->Update();
+
+    accumulatedImageData->DeepCopy(multiplyFilter->GetOutput());
+  }
+  else
+  {
+    // Add weighted input in place to the accumulated image, in one pass over the voxels
+    vtkSmartPointer<vtkImageData> inputImageData = resampledInputDoseVolumeNode->GetImageData();
+    if (inputImageData->GetScalarType() != accumulatedImageData->GetScalarType())
+    {
+      vtkSmartPointer<vtkImageCast> castFilter = vtkSmartPointer<vtkImageCast>::New();
+      castFilter->SetInputData(inputImageData);
+      castFilter->SetOutputScalarType(accumulatedImageData->GetScalarType());
+      castFilter->Update();
+      inputImageData = castFilter->GetOutput();
+    }
+
+    vtkIdType numberOfScalars = accumulatedImageData->GetNumberOfPoints() * accumulatedImageData->GetNumberOfScalarComponents();
+    if ( inputImageData->GetNumberOfPoints() * inputImageData->GetNumberOfScalarComponents() != numberOfScalars )
+    {
+      vtkErrorMacro("AddWeightedDoseVolume: Resampled dose volume '" << inputDoseVolumeNode->GetName() << "' does not match accumulated dose geometry!");
+      success = false;
+    }
+    else
+    {
+      switch (accumulatedImageData->GetScalarType())
+      {
+        vtkTemplateMacro( AddWeightedScalars( static_cast<VTK_TT*>(inputImageData->GetScalarPointer()),
+          static_cast<VTK_TT*>(accumulatedImageData->GetScalarPointer()), numberOfScalars, weight ) );
+        default:
+          vtkErrorMacro("AddWeightedDoseVolume: Unsupported accumulated dose scalar type!");
+          success = false;
+      }
+      accumulatedImageData->Modified();
+    }
+  }
+
+  // Remove the resampled dose node from scene and release the memory
+  this->GetMRMLScene()->RemoveNode(resampledInputDoseVolumeNode);
+
+  return success;
+}
+
+//---------------------------------------------------------------------------
+unsigned long vtkSlicerDoseAccumulationModuleLogic::ComputeVolumeChecksum(vtkMRMLScalarVolumeNode* volumeNode)
+{
+  if (!volumeNode || !volumeNode->GetImageData() || !volumeNode->GetImageData()->GetPointData()->GetScalars())
+  {
+    return 0;
+  }
+  vtkImageData* imageData = volumeNode->GetImageData();
+  unsigned long a = 1;
+  unsigned long b = 0;
+
+  // Geometry
+  vtkSmartPointer<vtkMatrix4x4> ijkToRasMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  volumeNode->GetIJKToRASMatrix(ijkToRasMatrix);
+  UpdateAdler32(reinterpret_cast<const unsigned char*>(ijkToRasMatrix->Element), sizeof(ijkToRasMatrix->Element), a, b);
+  int extent[6] = {0, -1, 0, -1, 0, -1};
+  imageData->GetExtent(extent);
+  UpdateAdler32(reinterpret_cast<const unsigned char*>(extent), sizeof(extent), a, b);
+
+  // Voxels
+  vtkDataArray* scalars = imageData->GetPointData()->GetScalars();
+  size_t numberOfBytes = static_cast<size_t>(scalars->GetNumberOfTuples()) * scalars->GetNumberOfComponents() * scalars->GetDataTypeSize();
+  UpdateAdler32(static_cast<const unsigned char*>(scalars->GetVoidPointer(0)), numberOfBytes, a, b);
+
+  return (b << 16) | a;
+}
+
+//---------------------------------------------------------------------------
+unsigned long vtkSlicerDoseAccumulationModuleLogic::GetVolumeChecksum(vtkMRMLScalarVolumeNode* volumeNode)
+{
+  if (!volumeNode || !volumeNode->GetImageData())
+  {
+    return 0;
+  }
+
+  unsigned long modifiedTime = std::max(volumeNode->GetMTime(), volumeNode->GetImageData()->GetMTime());
+  std::map<std::string, std::pair<unsigned long, unsigned long> >::iterator cacheIt = this->VolumeChecksumCache.find(volumeNode->GetID());
+  if (cacheIt != this->VolumeChecksumCache.end() && cacheIt->second.first == modifiedTime)
+  {
+    return cacheIt->second.second;
+  }
+
+  unsigned long checksum = vtkSlicerDoseAccumulationModuleLogic::ComputeVolumeChecksum(volumeNode);
+  this->VolumeChecksumCache[volumeNode->GetID()] = std::make_pair(modifiedTime, checksum);
+  return checksum;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDoseAccumulationModuleLogic::AddDeformedWeightedDoseVolume(vtkMRMLDoseAccumulationNode* parameterNode, vtkMRMLScalarVolumeNode* inputDoseVolumeNode, vtkMRMLTransformNode* deformationTransformNode, double weight, vtkImageData* accumulatedImageData)
+{
+  vtkMRMLScalarVolumeNode* referenceDoseVolumeNode = (parameterNode ? parameterNode->GetReferenceDoseVolumeNode() : NULL);
+  if ( !inputDoseVolumeNode || !inputDoseVolumeNode->GetImageData() || !deformationTransformNode
+    || !referenceDoseVolumeNode || !referenceDoseVolumeNode->GetImageData() || !accumulatedImageData )
+  {
+    vtkErrorMacro("AddDeformedWeightedDoseVolume: Invalid input arguments!");
+    return false;
+  }
+
+  // Allocate accumulated image on the reference lattice if empty
+  if (!accumulatedImageData->GetPointData()->GetScalars())
+  {
+    accumulatedImageData->SetExtent(referenceDoseVolumeNode->GetImageData()->GetExtent());
+    accumulatedImageData->AllocateScalars(inputDoseVolumeNode->GetImageData()->GetScalarType(), 1);
+    vtkDataArray* scalars = accumulatedImageData->GetPointData()->GetScalars();
+    memset(scalars->GetVoidPointer(0), 0, scalars->GetNumberOfTuples() * scalars->GetDataTypeSize());
+  }
+
+  // The accumulator samples the input dose in float type
+  vtkSmartPointer<vtkImageData> inputDoseImageData = inputDoseVolumeNode->GetImageData();
+  if (inputDoseImageData->GetScalarType() != VTK_FLOAT)
+  {
+    vtkSmartPointer<vtkImageCast> castFilter = vtkSmartPointer<vtkImageCast>::New();
+    castFilter->SetInputData(inputDoseImageData);
+    castFilter->SetOutputScalarTypeToFloat();
+    castFilter->Update();
+    inputDoseImageData = castFilter->GetOutput();
+  }
+
+  // Density image on the input dose lattice for energy/mass mapping
+  vtkSmartPointer<vtkImageData> densityImageData;
+  vtkMRMLScalarVolumeNode* densityVolumeNode = parameterNode->GetDensityVolumeForDoseVolume(inputDoseVolumeNode);
+  if (parameterNode->GetEnergyMassMapping() && densityVolumeNode && densityVolumeNode->GetImageData())
+  {
+    vtkMRMLScalarVolumeNode* resampledDensityVolumeNode =
+      vtkSlicerVolumesLogic::ResampleVolumeToReferenceVolume(densityVolumeNode, inputDoseVolumeNode);
+    if (!resampledDensityVolumeNode || !resampledDensityVolumeNode->GetImageData())
+    {
+      vtkErrorMacro("AddDeformedWeightedDoseVolume: Failed to resample density volume '" << densityVolumeNode->GetName() << "' to dose geometry!");
+      return false;
+    }
+    vtkSmartPointer<vtkImageCast> castFilter = vtkSmartPointer<vtkImageCast>::New();
+    castFilter->SetInputData(resampledDensityVolumeNode->GetImageData());
+    castFilter->SetOutputScalarTypeToFloat();
+    castFilter->Update();
+    densityImageData = castFilter->GetOutput();
+    this->GetMRMLScene()->RemoveNode(resampledDensityVolumeNode);
+
+    // Convert Hounsfield units to relative mass density
+    float* densityPtr = static_cast<float*>(densityImageData->GetScalarPointer());
+    vtkIdType numberOfVoxels = densityImageData->GetNumberOfPoints();
+    for (vtkIdType index=0; index<numberOfVoxels; ++index)
+    {
+      densityPtr[index] = std::max(0.0f, 1.0f + densityPtr[index] / 1000.0f);
+    }
+  }
+
+  // Assemble transform from reference IJK to input IJK through the deformation
+  vtkSmartPointer<vtkGeneralTransform> referenceIjkToInputIjkTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+  referenceIjkToInputIjkTransform->PostMultiply();
+
+  vtkSmartPointer<vtkMatrix4x4> referenceIjkToRasMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  referenceDoseVolumeNode->GetIJKToRASMatrix(referenceIjkToRasMatrix);
+  referenceIjkToInputIjkTransform->Concatenate(referenceIjkToRasMatrix);
+  if (referenceDoseVolumeNode->GetParentTransformNode())
+  {
+    vtkSmartPointer<vtkGeneralTransform> referenceToWorldTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+    referenceDoseVolumeNode->GetParentTransformNode()->GetTransformToWorld(referenceToWorldTransform);
+    referenceIjkToInputIjkTransform->Concatenate(referenceToWorldTransform);
+  }
+
+  referenceIjkToInputIjkTransform->Concatenate(deformationTransformNode->GetTransformFromParent());
+
+  if (inputDoseVolumeNode->GetParentTransformNode())
+  {
+    vtkSmartPointer<vtkGeneralTransform> worldToInputTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+    inputDoseVolumeNode->GetParentTransformNode()->GetTransformFromWorld(worldToInputTransform);
+    referenceIjkToInputIjkTransform->Concatenate(worldToInputTransform);
+  }
+  vtkSmartPointer<vtkMatrix4x4> inputRasToIjkMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  inputDoseVolumeNode->GetRASToIJKMatrix(inputRasToIjkMatrix);
+  referenceIjkToInputIjkTransform->Concatenate(inputRasToIjkMatrix);
+
+  // Warp and accumulate (one input in memory at a time)
+  vtkSmartPointer<vtkDeformableDoseAccumulator> accumulator = vtkSmartPointer<vtkDeformableDoseAccumulator>::New();
+  accumulator->SetInputDoseImageData(inputDoseImageData);
+  accumulator->SetInputDensityImageData(densityImageData);
+  accumulator->SetReferenceToInputTransform(referenceIjkToInputIjkTransform);
+  accumulator->SetAccumulatedImageData(accumulatedImageData);
+  accumulator->SetWeight(weight);
+  accumulator->SetEnergyMassMapping(densityImageData.GetPointer() != NULL);
+  if (!accumulator->Update())
+  {
+    vtkErrorMacro("AddDeformedWeightedDoseVolume: Failed to warp dose volume '" << inputDoseVolumeNode->GetName() << "'!");
+    return false;
+  }
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+unsigned long vtkSlicerDoseAccumulationModuleLogic::GetDoseContributionChecksum(vtkMRMLDoseAccumulationNode* parameterNode, vtkMRMLScalarVolumeNode* doseVolumeNode)
+{
+  unsigned long checksum = this->GetVolumeChecksum(doseVolumeNode);
+  if (!parameterNode)
+  {
+    return checksum;
+  }
+
+  // Mix in the deformation settings. Modified time is not persistent, so after scene reload
+  // the contributions of deformed doses are considered changed, which triggers full accumulation
+  std::stringstream settingsStream;
+  vtkMRMLTransformNode* deformationTransformNode = (parameterNode->GetDeformableAccumulation()
+    ? parameterNode->GetDeformationTransformForDoseVolume(doseVolumeNode) : NULL);
+  if (deformationTransformNode)
+  {
+    settingsStream << "Deformable:" << deformationTransformNode->GetID() << ":" << deformationTransformNode->GetMTime();
+    vtkMRMLScalarVolumeNode* densityVolumeNode = parameterNode->GetDensityVolumeForDoseVolume(doseVolumeNode);
+    if (parameterNode->GetEnergyMassMapping() && densityVolumeNode)
+    {
+      settingsStream << ":EnergyMassMapping:" << this->GetVolumeChecksum(densityVolumeNode);
+    }
+  }
+
+  // Mix in the biological dose model settings, as the conversion depends on them
+  if (parameterNode->GetDoseModel() != vtkMRMLDoseAccumulationNode::PhysicalDose)
+  {
+    settingsStream << ":DoseModel:" << parameterNode->GetDoseModel()
+      << ":Fractions:" << parameterNode->GetNumberOfFractionsForDoseVolume(doseVolumeNode)
+      << ":AlphaBeta:" << parameterNode->GetDefaultAlphaBetaRatio();
+    vtkMRMLSegmentationNode* alphaBetaSegmentationNode = parameterNode->GetAlphaBetaSegmentationNode();
+    std::map<std::string,double>* alphaBetaRatiosMap = parameterNode->GetSegmentIdsToAlphaBetaRatiosMap();
+    if (alphaBetaSegmentationNode && !alphaBetaRatiosMap->empty())
+    {
+      settingsStream << ":" << alphaBetaSegmentationNode->GetID() << ":" << alphaBetaSegmentationNode->GetMTime()
+        << ":" << (alphaBetaSegmentationNode->GetSegmentation() ? alphaBetaSegmentationNode->GetSegmentation()->GetMTime() : 0);
+      for (std::map<std::string,double>::iterator alphaBetaIt = alphaBetaRatiosMap->begin(); alphaBetaIt != alphaBetaRatiosMap->end(); ++alphaBetaIt)
+      {
+        settingsStream << ":" << alphaBetaIt->first << "=" << alphaBetaIt->second;
+      }
+    }
+  }
+
+  std::string settingsString = settingsStream.str();
+  if (settingsString.empty())
+  {
+    return checksum;
+  }
+
+  unsigned long a = checksum & 0xffff;
+  unsigned long b = (checksum >> 16) & 0xffff;
+  UpdateAdler32(reinterpret_cast<const unsigned char*>(settingsString.c_str()), settingsString.size(), a, b);
+  return (b << 16) | a;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDoseAccumulationModuleLogic::AddBiologicalDoseVolume(vtkMRMLDoseAccumulationNode* parameterNode, vtkMRMLScalarVolumeNode* inputDoseVolumeNode, double newWeight, double oldWeight, vtkImageData* alphaBetaImageData, vtkImageData* accumulatedImageData)
+{
+  vtkMRMLScalarVolumeNode* referenceDoseVolumeNode = (parameterNode ? parameterNode->GetReferenceDoseVolumeNode() : NULL);
+  if ( !inputDoseVolumeNode || !inputDoseVolumeNode->GetImageData()
+    || !referenceDoseVolumeNode || !referenceDoseVolumeNode->GetImageData() || !accumulatedImageData )
+  {
+    vtkErrorMacro("AddBiologicalDoseVolume: Invalid input arguments!");
+    return false;
+  }
+  vtkImageData* referenceImageData = referenceDoseVolumeNode->GetImageData();
+
+  // Get physical dose of the input on the reference lattice in float type (one input in memory at a time)
+  vtkSmartPointer<vtkImageData> physicalDoseImageData;
+  vtkMRMLTransformNode* deformationTransformNode = (parameterNode->GetDeformableAccumulation()
+    ? parameterNode->GetDeformationTransformForDoseVolume(inputDoseVolumeNode) : NULL);
+  if (deformationTransformNode)
+  {
+    physicalDoseImageData = vtkSmartPointer<vtkImageData>::New();
+    physicalDoseImageData->SetExtent(referenceImageData->GetExtent());
+    physicalDoseImageData->AllocateScalars(VTK_FLOAT, 1);
+    vtkDataArray* scalars = physicalDoseImageData->GetPointData()->GetScalars();
+    memset(scalars->GetVoidPointer(0), 0, scalars->GetNumberOfTuples() * scalars->GetDataTypeSize());
+    if (!this->AddDeformedWeightedDoseVolume(parameterNode, inputDoseVolumeNode, deformationTransformNode, 1.0, physicalDoseImageData))
+    {
+      return false;
+    }
+  }
+  else
+  {
+    vtkMRMLScalarVolumeNode* resampledInputDoseVolumeNode =
+      vtkSlicerVolumesLogic::ResampleVolumeToReferenceVolume(inputDoseVolumeNode, referenceDoseVolumeNode);
+    if (!resampledInputDoseVolumeNode || !resampledInputDoseVolumeNode->GetImageData())
+    {
+      vtkErrorMacro("AddBiologicalDoseVolume: Failed to resample dose volume '" << inputDoseVolumeNode->GetName() << "' to reference geometry!");
+      return false;
+    }
+    physicalDoseImageData = resampledInputDoseVolumeNode->GetImageData();
+    if (physicalDoseImageData->GetScalarType() != VTK_FLOAT)
+    {
+      vtkSmartPointer<vtkImageCast> castFilter = vtkSmartPointer<vtkImageCast>::New();
+      castFilter->SetInputData(physicalDoseImageData);
+      castFilter->SetOutputScalarTypeToFloat();
+      castFilter->Update();
+      physicalDoseImageData = castFilter->GetOutput();
+    }
+    this->GetMRMLScene()->RemoveNode(resampledInputDoseVolumeNode);
+  }
+
+  // Allocate accumulated image on the reference lattice if empty. Biological doses are accumulated in float type
+  if (!accumulatedImageData->GetPointData()->GetScalars())
+  {
+    accumulatedImageData->SetExtent(referenceImageData->GetExtent());
+    accumulatedImageData->AllocateScalars(VTK_FLOAT, 1);
+    vtkDataArray* scalars = accumulatedImageData->GetPointData()->GetScalars();
+    memset(scalars->GetVoidPointer(0), 0, scalars->GetNumberOfTuples() * scalars->GetDataTypeSize());
+  }
+
+  // Convert and accumulate
+  vtkSmartPointer<vtkBiologicalDoseAccumulator> accumulator = vtkSmartPointer<vtkBiologicalDoseAccumulator>::New();
+  accumulator->SetPhysicalDoseImageData(physicalDoseImageData);
+  if (alphaBetaImageData && alphaBetaImageData->GetPointData()->GetScalars())
+  {
+    accumulator->SetAlphaBetaImageData(alphaBetaImageData);
+  }
+  accumulator->SetAlphaBetaRatio(parameterNode->GetDefaultAlphaBetaRatio());
+  accumulator->SetAccumulatedImageData(accumulatedImageData);
+  accumulator->SetNumberOfFractions(parameterNode->GetNumberOfFractionsForDoseVolume(inputDoseVolumeNode));
+  accumulator->SetNewWeight(newWeight);
+  accumulator->SetOldWeight(oldWeight);
+  accumulator->SetEquivalentDoseIn2GyFractions(parameterNode->GetDoseModel() == vtkMRMLDoseAccumulationNode::EquivalentDoseIn2GyFractions);
+  if (!accumulator->Update())
+  {
+    vtkErrorMacro("AddBiologicalDoseVolume: Failed to convert dose volume '" << inputDoseVolumeNode->GetName() << "' to biological dose!");
+    return false;
+  }
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDoseAccumulationModuleLogic::CreateAlphaBetaImage(vtkMRMLDoseAccumulationNode* parameterNode, vtkImageData* alphaBetaImageData)
+{
+  vtkMRMLScalarVolumeNode* referenceDoseVolumeNode = (parameterNode ? parameterNode->GetReferenceDoseVolumeNode() : NULL);
+  if (!referenceDoseVolumeNode || !referenceDoseVolumeNode->GetImageData() || !alphaBetaImageData)
+  {
+    vtkErrorMacro("CreateAlphaBetaImage: Invalid input arguments!");
+    return false;
+  }
+
+  // Default alpha/beta ratio is used everywhere if there are no segment-specific values
+  vtkMRMLSegmentationNode* segmentationNode = parameterNode->GetAlphaBetaSegmentationNode();
+  std::map<std::string,double>* alphaBetaRatiosMap = parameterNode->GetSegmentIdsToAlphaBetaRatiosMap();
+  if (!segmentationNode || !segmentationNode->GetSegmentation() || alphaBetaRatiosMap->empty())
+  {
+    return true;
+  }
+
+  // Order segments by decreasing alpha/beta ratio, so that in overlapping regions the lowest ratio is painted last.
+  // The lowest ratio is the conservative choice for late-responding normal tissue
+  std::vector<std::pair<double,std::string> > alphaBetaSegments;
+  for (std::map<std::string,double>::iterator alphaBetaIt = alphaBetaRatiosMap->begin(); alphaBetaIt != alphaBetaRatiosMap->end(); ++alphaBetaIt)
+  {
+    if (segmentationNode->GetSegmentation()->GetSegment(alphaBetaIt->first))
+    {
+      alphaBetaSegments.push_back(std::make_pair(alphaBetaIt->second, alphaBetaIt->first));
+    }
+  }
+  std::sort(alphaBetaSegments.rbegin(), alphaBetaSegments.rend());
+
+  int alphaBetaExtent[6] = {0, -1, 0, -1, 0, -1};
+  referenceDoseVolumeNode->GetImageData()->GetExtent(alphaBetaExtent);
+  alphaBetaImageData->SetExtent(alphaBetaExtent);
+  alphaBetaImageData->AllocateScalars(VTK_FLOAT, 1);
+  float* alphaBetaPtr = static_cast<float*>(alphaBetaImageData->GetScalarPointer());
+  std::fill(alphaBetaPtr, alphaBetaPtr + alphaBetaImageData->GetNumberOfPoints(), static_cast<float>(parameterNode->GetDefaultAlphaBetaRatio()));
+
+  // Geometry the segment labelmaps are resampled to
+  vtkSmartPointer<vtkOrientedImageData> referenceGeometryImageData = vtkSmartPointer<vtkOrientedImageData>::New();
+  if (!SlicerRtCommon::ConvertVolumeNodeToVtkOrientedImageData(referenceDoseVolumeNode, referenceGeometryImageData))
+  {
+    vtkErrorMacro("CreateAlphaBetaImage: Failed to get reference geometry from volume '" << referenceDoseVolumeNode->GetName() << "'!");
+    return false;
+  }
+
+  for (std::vector<std::pair<double,std::string> >::iterator segmentIt = alphaBetaSegments.begin(); segmentIt != alphaBetaSegments.end(); ++segmentIt)
+  {
+    vtkSmartPointer<vtkOrientedImageData> segmentLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+    if (!vtkSlicerSegmentationsModuleLogic::GetSegmentBinaryLabelmapRepresentation(segmentationNode, segmentIt->second, segmentLabelmap))
+    {
+      vtkErrorMacro("CreateAlphaBetaImage: Failed to get binary labelmap from segment '" << segmentIt->second << "'!");
+      return false;
+    }
+    if (!vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(segmentLabelmap, referenceGeometryImageData, segmentLabelmap))
+    {
+      vtkErrorMacro("CreateAlphaBetaImage: Failed to resample segment '" << segmentIt->second << "' to reference geometry!");
+      return false;
+    }
+    if (!segmentLabelmap->GetPointData()->GetScalars())
+    {
+      continue; // Empty segment
+    }
+
+    int labelmapExtent[6] = {0, -1, 0, -1, 0, -1};
+    segmentLabelmap->GetExtent(labelmapExtent);
+    switch (segmentLabelmap->GetScalarType())
+    {
+      vtkTemplateMacro( PaintAlphaBetaInSegment( static_cast<VTK_TT*>(segmentLabelmap->GetScalarPointer()), labelmapExtent,
+        alphaBetaPtr, alphaBetaExtent, static_cast<float>(segmentIt->first) ) );
+      default:
+        vtkErrorMacro("CreateAlphaBetaImage: Unsupported labelmap scalar type in segment '" << segmentIt->second << "'!");
+        return false;
+    }
+  }
+
+  return true;
+}
@@ -33,7 +33,13 @@
 
 #include "vtkSlicerDoseAccumulationModuleLogicExport.h"
 
+// STD includes
+#include <map>
+
+class vtkImageData;
 class vtkMRMLDoseAccumulationNode;
+class vtkMRMLScalarVolumeNode;
+class vtkMRMLTransformNode;
 
 /// \ingroup SlicerRt_QtModules_DoseAccumulation
 class VTK_SLICER_DOSEACCUMULATION_LOGIC_EXPORT vtkSlicerDoseAccumulationModuleLogic :
@@ -54,6 +60,61 @@ public:
   /// \return Error message on failure, NULL otherwise
   const char* AccumulateDoseVolumes(vtkMRMLDoseAccumulationNode* parameterNode);
 
+  /// Update the accumulated dose volume (running total) incrementally. Only the input dose volumes that were
+  /// added, removed or reweighted since the last accumulation are applied, each in one pass over its voxels.
+  /// Falls back to full accumulation if there is no valid running total, or if an already applied input
+  /// dose volume changed since it was added (detected by checksum).
+  /// \return Error message on failure, NULL otherwise
+  const char* UpdateAccumulatedDoseVolume(vtkMRMLDoseAccumulationNode* parameterNode);
+
+  /// Compute checksum (Adler-32) of the voxels and geometry of a volume node.
+  /// Used to detect if a dose volume has changed since it was added to the running total.
+  static unsigned long ComputeVolumeChecksum(vtkMRMLScalarVolumeNode* volumeNode);
+
+protected:
+  /// Bring input dose volume to the reference geometry and add it with the given weight to the accumulated image.
+  /// If deformable accumulation is enabled and the input has a deformation transform, then the dose is warped
+  /// through the deformation (\sa AddDeformedWeightedDoseVolume), otherwise it is resampled to the reference.
+  /// If the accumulated image is empty, then it is allocated with the geometry of the reference and the scalar type of the input.
+  /// \return Success flag
+  bool AddWeightedDoseVolume(vtkMRMLDoseAccumulationNode* parameterNode, vtkMRMLScalarVolumeNode* inputDoseVolumeNode, double weight, vtkImageData* accumulatedImageData);
+
+  /// Apply the change of the contribution of an input dose volume to the accumulated image. The contribution with the
+  /// old weight is replaced by the contribution with the new weight (an input is added if the old weight is 0, and removed
+  /// if the new weight is 0). Physical doses are added linearly (\sa AddWeightedDoseVolume), biological doses
+  /// are converted voxelwise (\sa AddBiologicalDoseVolume)
+  /// \param alphaBetaImageData Alpha/beta ratio image on the reference lattice (\sa CreateAlphaBetaImage). Only used by biological dose models
+  /// \return Success flag
+  bool AddDoseContribution(vtkMRMLDoseAccumulationNode* parameterNode, vtkMRMLScalarVolumeNode* inputDoseVolumeNode, double newWeight, double oldWeight, vtkImageData* alphaBetaImageData, vtkImageData* accumulatedImageData);
+
+  /// Bring input dose volume to the reference geometry (resample or warp), convert it to BED or EQD2 according to
+  /// the dose model, and replace its contribution with the old weight by the one with the new weight in the accumulated image.
+  /// If the accumulated image is empty, then it is allocated with the geometry of the reference in float type.
+  /// \return Success flag
+  bool AddBiologicalDoseVolume(vtkMRMLDoseAccumulationNode* parameterNode, vtkMRMLScalarVolumeNode* inputDoseVolumeNode, double newWeight, double oldWeight, vtkImageData* alphaBetaImageData, vtkImageData* accumulatedImageData);
+
+  /// Create alpha/beta ratio image on the reference lattice from the segments with specified alpha/beta ratios.
+  /// Voxels outside these segments get the default alpha/beta ratio. Where segments overlap the lowest ratio is used.
+  /// The image is left empty (no scalars) if there is no segment-specific alpha/beta ratio, in which case the default is used everywhere.
+  /// \return Success flag
+  bool CreateAlphaBetaImage(vtkMRMLDoseAccumulationNode* parameterNode, vtkImageData* alphaBetaImageData);
+
+  /// Warp input dose volume to the reference through a deformation transform and add it with the given weight
+  /// to the accumulated image in place. Energy/mass mapping is performed if enabled and a density volume is set for the input.
+  /// \return Success flag
+  bool AddDeformedWeightedDoseVolume(vtkMRMLDoseAccumulationNode* parameterNode, vtkMRMLScalarVolumeNode* inputDoseVolumeNode, vtkMRMLTransformNode* deformationTransformNode, double weight, vtkImageData* accumulatedImageData);
+
+  /// Get checksum identifying the contribution of an input dose volume to the accumulated dose.
+  /// Combines the checksum of the dose volume with the settings that determine how it is mapped to the reference
+  unsigned long GetDoseContributionChecksum(vtkMRMLDoseAccumulationNode* parameterNode, vtkMRMLScalarVolumeNode* doseVolumeNode);
+
+  /// Get checksum of a volume node. Checksum is only recomputed if the image data changed since the last call
+  unsigned long GetVolumeChecksum(vtkMRMLScalarVolumeNode* volumeNode);
+
+  /// Set up display, selection and subject hierarchy of the output accumulated dose volume
+  /// \return Error message on failure, NULL otherwise
+  const char* SetupAccumulatedDoseVolumeNode(vtkMRMLDoseAccumulationNode* parameterNode);
+
 protected:
   vtkSlicerDoseAccumulationModuleLogic();
   virtual ~vtkSlicerDoseAccumulationModuleLogic();
@@ -68,6 +129,11 @@ protected:
   virtual void OnMRMLSceneNodeRemoved(vtkMRMLNode* node);
   virtual void OnMRMLSceneEndClose();
 
+protected:
+  /// Cache of volume checksums. Maps volume node IDs to pairs of the modified time of the volume
+  /// at the time the checksum was computed, and the checksum itself
+  std::map<std::string, std::pair<unsigned long, unsigned long> > VolumeChecksumCache;
+
 private:
   vtkSlicerDoseAccumulationModuleLogic(const vtkSlicerDoseAccumulationModuleLogic&); // Not implemented
   void operator=(const vtkSlicerDoseAccumulationModuleLogic&);               // Not implemented
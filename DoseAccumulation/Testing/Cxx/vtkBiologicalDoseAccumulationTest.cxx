@@ -0,0 +1,312 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+// DoseAccumulation includes
+#include "vtkSlicerDoseAccumulationModuleLogic.h"
+#include "vtkMRMLDoseAccumulationNode.h"
+
+// Segmentations includes
+#include "vtkMRMLSegmentationNode.h"
+#include "vtkSegment.h"
+
+// SegmentationCore includes
+#include "vtkOrientedImageData.h"
+#include "vtkSegmentationConverter.h"
+
+// Subject Hierarchy includes
+#include "vtkMRMLSubjectHierarchyConstants.h"
+#include "vtkMRMLSubjectHierarchyNode.h"
+#include "vtkSlicerSubjectHierarchyModuleLogic.h"
+
+// MRML includes
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cmath>
+
+namespace
+{
+  static const int DOSE_DIMENSIONS[3] = {10, 10, 4};
+  static const double DEFAULT_ALPHA_BETA_RATIO = 10.0;
+  static const double RECTUM_ALPHA_BETA_RATIO = 3.0;
+  static const double PROSTATE_ALPHA_BETA_RATIO = 1.5;
+  static const int NUMBER_OF_FRACTIONS_1 = 5;
+  static const int NUMBER_OF_FRACTIONS_2 = 3;
+  static const double TOLERANCE = 1.0e-4;
+
+  //----------------------------------------------------------------------------
+  /// Physical dose of the first course (Gy)
+  double PhysicalDose1(int i, int j, int vtkNotUsed(k))
+  {
+    return 2.0 + 0.5 * i + 0.25 * j;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Physical dose of the second course (Gy)
+  double PhysicalDose2(int i, int vtkNotUsed(j), int k)
+  {
+    return 3.0 - 0.2 * i + 0.1 * k;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Rectum covers I=0..5 and prostate covers I=4..9 in rows J=0..4. In their overlap the lowest alpha/beta ratio
+  /// (prostate) is expected, and the default ratio in the rows without segments
+  double ExpectedAlphaBetaRatio(int i, int j)
+  {
+    if (j > 4)
+    {
+      return DEFAULT_ALPHA_BETA_RATIO;
+    }
+    return (i >= 4 ? PROSTATE_ALPHA_BETA_RATIO : RECTUM_ALPHA_BETA_RATIO);
+  }
+
+  //----------------------------------------------------------------------------
+  /// Biologically effective dose of a course delivering the given total physical dose in the given number of fractions
+  double Bed(double dose, int numberOfFractions, double alphaBetaRatio)
+  {
+    return dose * (1.0 + dose / (numberOfFractions * alphaBetaRatio));
+  }
+
+  //----------------------------------------------------------------------------
+  double Eqd2(double dose, int numberOfFractions, double alphaBetaRatio)
+  {
+    return Bed(dose, numberOfFractions, alphaBetaRatio) * alphaBetaRatio / (alphaBetaRatio + 2.0);
+  }
+
+  //----------------------------------------------------------------------------
+  vtkMRMLScalarVolumeNode* AddDoseVolume(vtkMRMLScene* scene, const char* name, double (*doseFunction)(int, int, int))
+  {
+    vtkSmartPointer<vtkImageData> doseImageData = vtkSmartPointer<vtkImageData>::New();
+    doseImageData->SetDimensions(DOSE_DIMENSIONS[0], DOSE_DIMENSIONS[1], DOSE_DIMENSIONS[2]);
+    doseImageData->AllocateScalars(VTK_FLOAT, 1);
+    float* dosePtr = static_cast<float*>(doseImageData->GetScalarPointer());
+    for (int k=0; k<DOSE_DIMENSIONS[2]; ++k)
+    {
+      for (int j=0; j<DOSE_DIMENSIONS[1]; ++j)
+      {
+        for (int i=0; i<DOSE_DIMENSIONS[0]; ++i)
+        {
+          *(dosePtr++) = static_cast<float>(doseFunction(i, j, k));
+        }
+      }
+    }
+
+    vtkSmartPointer<vtkMRMLScalarVolumeNode> doseVolumeNode = vtkSmartPointer<vtkMRMLScalarVolumeNode>::New();
+    doseVolumeNode->SetName(name);
+    doseVolumeNode->SetSpacing(1.0, 1.0, 1.0);
+    doseVolumeNode->SetOrigin(0.0, 0.0, 0.0);
+    doseVolumeNode->SetAndObserveImageData(doseImageData);
+    scene->AddNode(doseVolumeNode);
+    return doseVolumeNode;
+  }
+
+  //----------------------------------------------------------------------------
+  void AddBoxSegment(vtkMRMLSegmentationNode* segmentationNode, const char* segmentId, int extent[6])
+  {
+    vtkSmartPointer<vtkOrientedImageData> labelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+    labelmap->SetExtent(extent);
+    labelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    labelmap->GetPointData()->GetScalars()->FillComponent(0, 1.0);
+
+    vtkSmartPointer<vtkSegment> segment = vtkSmartPointer<vtkSegment>::New();
+    segment->SetName(segmentId);
+    segment->AddRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(), labelmap);
+    segmentationNode->GetSegmentation()->AddSegment(segment, segmentId);
+  }
+
+  //----------------------------------------------------------------------------
+  /// Compare the accumulated dose voxelwise to the sum of the converted weighted doses of the courses
+  bool CheckAccumulatedDose(vtkMRMLDoseAccumulationNode* parameterNode, double weight1, double weight2, const char* caseName)
+  {
+    bool eqd2 = (parameterNode->GetDoseModel() == vtkMRMLDoseAccumulationNode::EquivalentDoseIn2GyFractions);
+    vtkImageData* accumulatedImageData = parameterNode->GetAccumulatedDoseVolumeNode()->GetImageData();
+    if (!accumulatedImageData || accumulatedImageData->GetNumberOfPoints() != DOSE_DIMENSIONS[0] * DOSE_DIMENSIONS[1] * DOSE_DIMENSIONS[2])
+    {
+      std::cerr << __LINE__ << ": Accumulated dose " << caseName << " does not match the reference lattice" << std::endl;
+      return false;
+    }
+    vtkDataArray* accumulatedScalars = accumulatedImageData->GetPointData()->GetScalars();
+    vtkIdType index = 0;
+    for (int k=0; k<DOSE_DIMENSIONS[2]; ++k)
+    {
+      for (int j=0; j<DOSE_DIMENSIONS[1]; ++j)
+      {
+        for (int i=0; i<DOSE_DIMENSIONS[0]; ++i, ++index)
+        {
+          double alphaBetaRatio = ExpectedAlphaBetaRatio(i, j);
+          double dose1 = weight1 * PhysicalDose1(i, j, k);
+          double dose2 = weight2 * PhysicalDose2(i, j, k);
+          double expectedDose = ( eqd2
+            ? Eqd2(dose1, NUMBER_OF_FRACTIONS_1, alphaBetaRatio) + Eqd2(dose2, NUMBER_OF_FRACTIONS_2, alphaBetaRatio)
+            : Bed(dose1, NUMBER_OF_FRACTIONS_1, alphaBetaRatio) + Bed(dose2, NUMBER_OF_FRACTIONS_2, alphaBetaRatio) );
+          double dose = accumulatedScalars->GetTuple1(index);
+          if (fabs(dose - expectedDose) > TOLERANCE * (1.0 + fabs(expectedDose)))
+          {
+            std::cerr << __LINE__ << ": Accumulated " << (eqd2 ? "EQD2 " : "BED ") << caseName << " at (" << i << ", " << j << ", " << k
+              << ") is " << dose << " Gy (expected " << expectedDose << " Gy)" << std::endl;
+            return false;
+          }
+        }
+      }
+    }
+    return true;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkBiologicalDoseAccumulationTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkSmartPointer<vtkMRMLScene> mrmlScene = vtkSmartPointer<vtkMRMLScene>::New();
+  vtkSmartPointer<vtkSlicerSubjectHierarchyModuleLogic> subjectHierarchyLogic = vtkSmartPointer<vtkSlicerSubjectHierarchyModuleLogic>::New();
+  subjectHierarchyLogic->SetMRMLScene(mrmlScene);
+  vtkSmartPointer<vtkSlicerDoseAccumulationModuleLogic> doseAccumulationLogic = vtkSmartPointer<vtkSlicerDoseAccumulationModuleLogic>::New();
+  doseAccumulationLogic->SetMRMLScene(mrmlScene);
+
+  // Dose volumes of two courses on the same lattice. The accumulated dose is put in the study of the reference dose
+  vtkMRMLScalarVolumeNode* doseVolumeNode1 = AddDoseVolume(mrmlScene, "Dose1", PhysicalDose1);
+  vtkMRMLScalarVolumeNode* doseVolumeNode2 = AddDoseVolume(mrmlScene, "Dose2", PhysicalDose2);
+  vtkMRMLSubjectHierarchyNode* patientNode = vtkMRMLSubjectHierarchyNode::CreateSubjectHierarchyNode(
+    mrmlScene, NULL, vtkMRMLSubjectHierarchyConstants::GetDICOMLevelPatient(), "Patient");
+  vtkMRMLSubjectHierarchyNode* studyNode = vtkMRMLSubjectHierarchyNode::CreateSubjectHierarchyNode(
+    mrmlScene, patientNode, vtkMRMLSubjectHierarchyConstants::GetDICOMLevelStudy(), "Study");
+  vtkMRMLSubjectHierarchyNode::CreateSubjectHierarchyNode(
+    mrmlScene, studyNode, vtkMRMLSubjectHierarchyConstants::GetDICOMLevelSeries(), "Dose1", doseVolumeNode1);
+
+  vtkSmartPointer<vtkMRMLScalarVolumeNode> accumulatedDoseVolumeNode = vtkSmartPointer<vtkMRMLScalarVolumeNode>::New();
+  accumulatedDoseVolumeNode->SetName("AccumulatedDose");
+  mrmlScene->AddNode(accumulatedDoseVolumeNode);
+
+  // Overlapping segments with different alpha/beta ratios on the dose lattice
+  vtkSmartPointer<vtkMRMLSegmentationNode> segmentationNode = vtkSmartPointer<vtkMRMLSegmentationNode>::New();
+  mrmlScene->AddNode(segmentationNode);
+  segmentationNode->GetSegmentation()->SetMasterRepresentationName(
+    vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName() );
+  int rectumExtent[6] = {0, 5, 0, 4, 0, DOSE_DIMENSIONS[2]-1};
+  AddBoxSegment(segmentationNode, "Rectum", rectumExtent);
+  int prostateExtent[6] = {4, DOSE_DIMENSIONS[0]-1, 0, 4, 0, DOSE_DIMENSIONS[2]-1};
+  AddBoxSegment(segmentationNode, "Prostate", prostateExtent);
+
+  vtkSmartPointer<vtkMRMLDoseAccumulationNode> parameterNode = vtkSmartPointer<vtkMRMLDoseAccumulationNode>::New();
+  mrmlScene->AddNode(parameterNode);
+  parameterNode->SetAndObserveReferenceDoseVolumeNode(doseVolumeNode1);
+  parameterNode->SetAndObserveAccumulatedDoseVolumeNode(accumulatedDoseVolumeNode);
+  parameterNode->SetDoseModel(vtkMRMLDoseAccumulationNode::EquivalentDoseIn2GyFractions);
+  parameterNode->SetDefaultAlphaBetaRatio(DEFAULT_ALPHA_BETA_RATIO);
+  parameterNode->SetAndObserveAlphaBetaSegmentationNode(segmentationNode);
+  parameterNode->SetAlphaBetaRatioForSegment("Rectum", RECTUM_ALPHA_BETA_RATIO);
+  parameterNode->SetAlphaBetaRatioForSegment("Prostate", PROSTATE_ALPHA_BETA_RATIO);
+  parameterNode->SetNumberOfFractionsForDoseVolume(doseVolumeNode1, NUMBER_OF_FRACTIONS_1);
+  parameterNode->SetNumberOfFractionsForDoseVolume(doseVolumeNode2, NUMBER_OF_FRACTIONS_2);
+
+  // Full accumulation of the EQD2 of the first course
+  parameterNode->AddSelectedInputVolumeNode(doseVolumeNode1, 1.0);
+  const char* errorMessage = doseAccumulationLogic->AccumulateDoseVolumes(parameterNode);
+  if (errorMessage)
+  {
+    std::cerr << __LINE__ << ": Failed to accumulate EQD2: " << errorMessage << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!CheckAccumulatedDose(parameterNode, 1.0, 0.0, "of the first course"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Reweight the first course and add the second one incrementally. The running total is updated in place
+  // by f(w_new*D) - f(w_old*D) for each changed course
+  vtkImageData* runningTotalImageData = accumulatedDoseVolumeNode->GetImageData();
+  parameterNode->SetWeightForDoseVolume(doseVolumeNode1, 2.0);
+  parameterNode->AddSelectedInputVolumeNode(doseVolumeNode2, 0.5);
+  errorMessage = doseAccumulationLogic->UpdateAccumulatedDoseVolume(parameterNode);
+  if (errorMessage)
+  {
+    std::cerr << __LINE__ << ": Failed to update EQD2: " << errorMessage << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (accumulatedDoseVolumeNode->GetImageData() != runningTotalImageData)
+  {
+    std::cerr << __LINE__ << ": EQD2 was fully recomputed instead of being updated incrementally" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!CheckAccumulatedDose(parameterNode, 2.0, 0.5, "after reweighting and adding a course"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Remove the second course incrementally
+  parameterNode->RemoveSelectedInputVolumeNode(doseVolumeNode2);
+  errorMessage = doseAccumulationLogic->UpdateAccumulatedDoseVolume(parameterNode);
+  if (errorMessage)
+  {
+    std::cerr << __LINE__ << ": Failed to update EQD2: " << errorMessage << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (accumulatedDoseVolumeNode->GetImageData() != runningTotalImageData)
+  {
+    std::cerr << __LINE__ << ": EQD2 was fully recomputed instead of being updated incrementally" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!CheckAccumulatedDose(parameterNode, 2.0, 0.0, "after removing a course"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Full accumulation of BED of both courses
+  parameterNode->SetDoseModel(vtkMRMLDoseAccumulationNode::BiologicallyEffectiveDose);
+  parameterNode->AddSelectedInputVolumeNode(doseVolumeNode2, 1.0);
+  errorMessage = doseAccumulationLogic->AccumulateDoseVolumes(parameterNode);
+  if (errorMessage)
+  {
+    std::cerr << __LINE__ << ": Failed to accumulate BED: " << errorMessage << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!CheckAccumulatedDose(parameterNode, 2.0, 1.0, "of both courses"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Reweight the second course incrementally
+  runningTotalImageData = accumulatedDoseVolumeNode->GetImageData();
+  parameterNode->SetWeightForDoseVolume(doseVolumeNode2, 0.5);
+  errorMessage = doseAccumulationLogic->UpdateAccumulatedDoseVolume(parameterNode);
+  if (errorMessage)
+  {
+    std::cerr << __LINE__ << ": Failed to update BED: " << errorMessage << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (accumulatedDoseVolumeNode->GetImageData() != runningTotalImageData)
+  {
+    std::cerr << __LINE__ << ": BED was fully recomputed instead of being updated incrementally" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!CheckAccumulatedDose(parameterNode, 2.0, 0.5, "after reweighting a course"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Biological dose accumulation test passed" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,207 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DoseAccumulation includes
+#include "vtkDeformableDoseAccumulator.h"
+
+// VTK includes
+#include <vtkNew.h>
+#include <vtkImageData.h>
+#include <vtkTransform.h>
+
+// STD includes
+#include <cmath>
+
+namespace
+{
+  static const int DOSE_DIMENSIONS[3] = {20, 16, 10};
+  static const double TRANSLATION[3] = {2.5, -1.0, 0.0};
+  static const double WEIGHT = 2.0;
+  static const double INITIAL_ACCUMULATED_DOSE = 1.0;
+  static const double TOLERANCE = 1.0e-4;
+
+  //----------------------------------------------------------------------------
+  /// Linear dose phantom. Trilinear interpolation reproduces it exactly
+  double PhantomDose(double i, double j, double k)
+  {
+    return 1.0 + 0.5 * i + 0.25 * j + 0.1 * k;
+  }
+
+  //----------------------------------------------------------------------------
+  void CreateFloatImage(vtkImageData* imageData)
+  {
+    imageData->SetDimensions(DOSE_DIMENSIONS[0], DOSE_DIMENSIONS[1], DOSE_DIMENSIONS[2]);
+    imageData->AllocateScalars(VTK_FLOAT, 1);
+  }
+
+  //----------------------------------------------------------------------------
+  void FillAccumulatedImage(vtkImageData* imageData)
+  {
+    float* accumulatedPtr = static_cast<float*>(imageData->GetScalarPointer());
+    vtkIdType numberOfVoxels = imageData->GetNumberOfPoints();
+    for (vtkIdType index=0; index<numberOfVoxels; ++index)
+    {
+      accumulatedPtr[index] = INITIAL_ACCUMULATED_DOSE;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Check whether a continuous index is inside the phantom by at least the given margin
+  bool IsInsidePhantom(const double position[3], double margin)
+  {
+    for (int axis=0; axis<3; ++axis)
+    {
+      if (position[axis] - margin < 0.0 || position[axis] + margin > DOSE_DIMENSIONS[axis] - 1)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkDeformableDoseAccumulatorTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  // Create dose and density phantoms on the same lattice
+  vtkNew<vtkImageData> doseImageData;
+  CreateFloatImage(doseImageData.GetPointer());
+  vtkNew<vtkImageData> densityImageData;
+  CreateFloatImage(densityImageData.GetPointer());
+  float* dosePtr = static_cast<float*>(doseImageData->GetScalarPointer());
+  float* densityPtr = static_cast<float*>(densityImageData->GetScalarPointer());
+  for (int k=0; k<DOSE_DIMENSIONS[2]; ++k)
+  {
+    for (int j=0; j<DOSE_DIMENSIONS[1]; ++j)
+    {
+      for (int i=0; i<DOSE_DIMENSIONS[0]; ++i)
+      {
+        *(dosePtr++) = static_cast<float>(PhantomDose(i, j, k));
+        *(densityPtr++) = 1.0f;
+      }
+    }
+  }
+
+  // Reference IJK to input IJK transform is a known translation, so the accumulated dose
+  // is expected to be the input dose shifted by the translation
+  vtkNew<vtkTransform> referenceToInputTransform;
+  referenceToInputTransform->Translate(TRANSLATION[0], TRANSLATION[1], TRANSLATION[2]);
+
+  vtkNew<vtkImageData> accumulatedImageData;
+  CreateFloatImage(accumulatedImageData.GetPointer());
+
+  vtkNew<vtkDeformableDoseAccumulator> accumulator;
+  accumulator->SetInputDoseImageData(doseImageData.GetPointer());
+  accumulator->SetInputDensityImageData(densityImageData.GetPointer());
+  accumulator->SetReferenceToInputTransform(referenceToInputTransform.GetPointer());
+  accumulator->SetAccumulatedImageData(accumulatedImageData.GetPointer());
+  accumulator->SetWeight(WEIGHT);
+
+  for (int energyMassMapping=0; energyMassMapping<2; ++energyMassMapping)
+  {
+    FillAccumulatedImage(accumulatedImageData.GetPointer());
+    accumulator->SetEnergyMassMapping(energyMassMapping != 0);
+    if (!accumulator->Update())
+    {
+      std::cerr << __LINE__ << ": Failed to accumulate dose (energy/mass mapping: " << energyMassMapping << ")" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // Energy/mass mapping averages over the sub-voxels, which is only exact if all of them are inside the input
+    double margin = (energyMassMapping ? 0.5 : 0.0);
+    int numberOfCheckedVoxels = 0;
+    float* accumulatedPtr = static_cast<float*>(accumulatedImageData->GetScalarPointer());
+    for (int k=0; k<DOSE_DIMENSIONS[2]; ++k)
+    {
+      for (int j=0; j<DOSE_DIMENSIONS[1]; ++j)
+      {
+        for (int i=0; i<DOSE_DIMENSIONS[0]; ++i, ++accumulatedPtr)
+        {
+          double inputPosition[3] = {i + TRANSLATION[0], j + TRANSLATION[1], k + TRANSLATION[2]};
+          double expectedDose = INITIAL_ACCUMULATED_DOSE;
+          if (IsInsidePhantom(inputPosition, margin))
+          {
+            expectedDose += WEIGHT * PhantomDose(inputPosition[0], inputPosition[1], inputPosition[2]);
+          }
+          else if (IsInsidePhantom(inputPosition, -margin))
+          {
+            // Voxel is partially covered by the input, skip it
+            continue;
+          }
+
+          if (fabs(*accumulatedPtr - expectedDose) > TOLERANCE * expectedDose)
+          {
+            std::cerr << __LINE__ << ": Accumulated dose at voxel (" << i << ", " << j << ", " << k << ") is " << *accumulatedPtr
+              << " instead of " << expectedDose << " (energy/mass mapping: " << energyMassMapping << ")" << std::endl;
+            return EXIT_FAILURE;
+          }
+          ++numberOfCheckedVoxels;
+        }
+      }
+    }
+    if (numberOfCheckedVoxels == 0)
+    {
+      std::cerr << __LINE__ << ": No voxels were checked" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Energy/mass mapping of a uniform dose needs to conserve the dose regardless of the density distribution
+  const float uniformDose = 3.0f;
+  dosePtr = static_cast<float*>(doseImageData->GetScalarPointer());
+  densityPtr = static_cast<float*>(densityImageData->GetScalarPointer());
+  vtkIdType numberOfVoxels = doseImageData->GetNumberOfPoints();
+  for (vtkIdType index=0; index<numberOfVoxels; ++index)
+  {
+    dosePtr[index] = uniformDose;
+    densityPtr[index] = 0.2f + static_cast<float>(index % 7);
+  }
+  doseImageData->Modified();
+  densityImageData->Modified();
+
+  FillAccumulatedImage(accumulatedImageData.GetPointer());
+  accumulator->EnergyMassMappingOn();
+  if (!accumulator->Update())
+  {
+    std::cerr << __LINE__ << ": Failed to accumulate uniform dose with energy/mass mapping" << std::endl;
+    return EXIT_FAILURE;
+  }
+  float* accumulatedPtr = static_cast<float*>(accumulatedImageData->GetScalarPointer());
+  for (int k=0; k<DOSE_DIMENSIONS[2]; ++k)
+  {
+    for (int j=0; j<DOSE_DIMENSIONS[1]; ++j)
+    {
+      for (int i=0; i<DOSE_DIMENSIONS[0]; ++i, ++accumulatedPtr)
+      {
+        double inputPosition[3] = {i + TRANSLATION[0], j + TRANSLATION[1], k + TRANSLATION[2]};
+        if (!IsInsidePhantom(inputPosition, 0.5))
+        {
+          continue;
+        }
+        double expectedDose = INITIAL_ACCUMULATED_DOSE + WEIGHT * uniformDose;
+        if (fabs(*accumulatedPtr - expectedDose) > TOLERANCE * expectedDose)
+        {
+          std::cerr << __LINE__ << ": Energy/mass mapped uniform dose at voxel (" << i << ", " << j << ", " << k << ") is "
+            << *accumulatedPtr << " instead of " << expectedDose << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+    }
+  }
+
+  std::cout << "Deformable dose accumulator test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
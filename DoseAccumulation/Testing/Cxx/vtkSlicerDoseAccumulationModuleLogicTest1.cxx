@@ -42,6 +42,7 @@
 #include <vtkImageAccumulate.h>
 #include <vtkMatrix4x4.h>
 #include <vtkImageMathematics.h>
+#include <vtkPointData.h>
 
 // ITK includes
 #if ITK_VERSION_MAJOR > 3
@@ -227,6 +228,66 @@ int vtkSlicerDoseAccumulationModuleLogicTest1( int argc, char * argv[] )
     return EXIT_FAILURE;
   }
 
+  // Update accumulated dose incrementally: remove second dose and reweight the first one
+  // The running total needs to be the original dose volume again
+  paramNode->RemoveSelectedInputVolumeNode(doseScalarVolumeNode2);
+  paramNode->SetWeightForDoseVolume(doseScalarVolumeNode, 1.0);
+  errorMessage = doseAccumulationLogic->UpdateAccumulatedDoseVolume(paramNode);
+  if (errorMessage)
+  {
+    std::cerr << "ERROR: " << errorMessage << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (paramNode->GetAppliedContributionsMap()->size() != 1)
+  {
+    std::cerr << "ERROR: Invalid number of applied contributions after incremental update: " << paramNode->GetAppliedContributionsMap()->size() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  math->SetInput2Data(paramNode->GetAccumulatedDoseVolumeNode()->GetImageData());
+  math->Modified();
+  histogram->Update();
+  maxDiff = histogram->GetMax()[0];
+  minDiff = histogram->GetMin()[0];
+
+  if (maxDiff > doseDifferenceCriterion || minDiff < -doseDifferenceCriterion)
+  {
+    std::cerr << "ERROR: Difference between baseline and incrementally accumulated dose exceeds threshold" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Accumulate biologically effective dose and compare it voxelwise to the linear-quadratic model
+  const int numberOfFractions = 5;
+  const double alphaBetaRatio = 3.0;
+  paramNode->SetDoseModel(vtkMRMLDoseAccumulationNode::BiologicallyEffectiveDose);
+  paramNode->SetDefaultAlphaBetaRatio(alphaBetaRatio);
+  paramNode->SetNumberOfFractionsForDoseVolume(doseScalarVolumeNode, numberOfFractions);
+  errorMessage = doseAccumulationLogic->UpdateAccumulatedDoseVolume(paramNode);
+  if (errorMessage)
+  {
+    std::cerr << "ERROR: " << errorMessage << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkDataArray* physicalDoseScalars = doseScalarVolumeNode->GetImageData()->GetPointData()->GetScalars();
+  vtkDataArray* biologicalDoseScalars = paramNode->GetAccumulatedDoseVolumeNode()->GetImageData()->GetPointData()->GetScalars();
+  if (!biologicalDoseScalars || biologicalDoseScalars->GetNumberOfTuples() != physicalDoseScalars->GetNumberOfTuples())
+  {
+    std::cerr << "ERROR: Biologically effective dose does not match the geometry of the reference dose" << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (vtkIdType index=0; index<physicalDoseScalars->GetNumberOfTuples(); ++index)
+  {
+    double physicalDose = physicalDoseScalars->GetTuple1(index);
+    double expectedBed = physicalDose * (1.0 + physicalDose / (numberOfFractions * alphaBetaRatio));
+    if (fabs(biologicalDoseScalars->GetTuple1(index) - expectedBed) > doseDifferenceCriterion + 1.0e-5 * fabs(expectedBed))
+    {
+      std::cerr << "ERROR: Biologically effective dose differs from the expected value at voxel " << index
+        << " (" << biologicalDoseScalars->GetTuple1(index) << " instead of " << expectedBed << ")" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
   return EXIT_SUCCESS;
 }
 
@@ -488,7 +488,8 @@ void qSlicerDoseAccumulationModuleWidget::applyClicked()
 
   QApplication::setOverrideCursor(QCursor(Qt::BusyCursor));
 
-  const char* errorMessage = d->logic()->AccumulateDoseVolumes(paramNode);
+  // Only the changes since the last accumulation are applied if possible
+  const char* errorMessage = d->logic()->UpdateAccumulatedDoseVolume(paramNode);
 
   d->label_Error->setVisible( errorMessage );
   if (errorMessage)
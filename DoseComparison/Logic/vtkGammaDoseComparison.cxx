@@ -0,0 +1,746 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkGammaDoseComparison.h"
+
+// VTK includes
+#include <vtkCommand.h>
+#include <vtkImageData.h>
+#include <vtkMultiThreader.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkGammaDoseComparison);
+
+vtkCxxSetObjectMacro(vtkGammaDoseComparison, ReferenceDoseImageData, vtkImageData);
+vtkCxxSetObjectMacro(vtkGammaDoseComparison, CompareDoseImageData, vtkImageData);
+vtkCxxSetObjectMacro(vtkGammaDoseComparison, MaskImageData, vtkImageData);
+
+namespace
+{
+  /// Inverse squared dose tolerance used for zero local dose tolerance. Finite so that zero dose difference gives
+  /// zero dose difference term (instead of NaN), while any other difference exceeds the maximum gamma
+  static const float ZERO_DOSE_TOLERANCE_INVERSE_SQUARED = VTK_FLOAT_MAX;
+
+  /// Margin of the block gamma bounds around 1 that accounts for floating point rounding in the voxel computation
+  static const float GAMMA_BOUND_TOLERANCE = 1.0e-3f;
+
+  /// Offset between blocks of the downsampled lattice with the minimum normalized squared distance of their voxels
+  struct BlockSearchOffset
+  {
+    int Offset[3];
+    double MinimumNormalizedSquaredDistance;
+  };
+
+  //----------------------------------------------------------------------------
+  bool CompareSearchOffsets(const vtkGammaDoseComparison::GammaSearchOffset& a, const vtkGammaDoseComparison::GammaSearchOffset& b)
+  {
+    return a.NormalizedSquaredDistance < b.NormalizedSquaredDistance;
+  }
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE ComputeGammaThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    vtkGammaDoseComparison* self = static_cast<vtkGammaDoseComparison*>(threadInfo->UserData);
+
+    int extent[6] = {0, -1, 0, -1, 0, -1};
+    self->GetReferenceDoseImageData()->GetExtent(extent);
+    int numberOfSlices = extent[5] - extent[4] + 1;
+    int slicesPerThread = (numberOfSlices + threadInfo->NumberOfThreads - 1) / threadInfo->NumberOfThreads;
+    int kStart = extent[4] + threadInfo->ThreadID * slicesPerThread;
+    int kEnd = std::min(kStart + slicesPerThread - 1, extent[5]);
+    if (kStart <= kEnd)
+    {
+      self->ThreadedComputeGamma(kStart, kEnd, threadInfo->ThreadID);
+    }
+
+    return VTK_THREAD_RETURN_VALUE;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Sample float image at continuous IJK position (with zero-based indices), clamped to the image
+  float InterpolateTrilinear(const float* imagePtr, const int dimensions[3], const double position[3])
+  {
+    int lowerIndex[3] = {0, 0, 0};
+    int upperIndex[3] = {0, 0, 0};
+    float fraction[3] = {0.0f, 0.0f, 0.0f};
+    for (int axis=0; axis<3; ++axis)
+    {
+      double clampedPosition = std::max(0.0, std::min(position[axis], static_cast<double>(dimensions[axis]-1)));
+      lowerIndex[axis] = std::min(static_cast<int>(clampedPosition), std::max(dimensions[axis]-2, 0));
+      upperIndex[axis] = std::min(lowerIndex[axis]+1, dimensions[axis]-1);
+      fraction[axis] = static_cast<float>(clampedPosition - lowerIndex[axis]);
+    }
+
+    vtkIdType rowSize = dimensions[0];
+    vtkIdType sliceSize = rowSize * dimensions[1];
+    const float* lowerSlicePtr = imagePtr + lowerIndex[2] * sliceSize;
+    const float* upperSlicePtr = imagePtr + upperIndex[2] * sliceSize;
+    float value00 = lowerSlicePtr[lowerIndex[1]*rowSize + lowerIndex[0]] * (1.0f-fraction[0]) + lowerSlicePtr[lowerIndex[1]*rowSize + upperIndex[0]] * fraction[0];
+    float value10 = lowerSlicePtr[upperIndex[1]*rowSize + lowerIndex[0]] * (1.0f-fraction[0]) + lowerSlicePtr[upperIndex[1]*rowSize + upperIndex[0]] * fraction[0];
+    float value01 = upperSlicePtr[lowerIndex[1]*rowSize + lowerIndex[0]] * (1.0f-fraction[0]) + upperSlicePtr[lowerIndex[1]*rowSize + upperIndex[0]] * fraction[0];
+    float value11 = upperSlicePtr[upperIndex[1]*rowSize + lowerIndex[0]] * (1.0f-fraction[0]) + upperSlicePtr[upperIndex[1]*rowSize + upperIndex[0]] * fraction[0];
+    float value0 = value00 * (1.0f-fraction[1]) + value10 * fraction[1];
+    float value1 = value01 * (1.0f-fraction[1]) + value11 * fraction[1];
+    return value0 * (1.0f-fraction[2]) + value1 * fraction[2];
+  }
+
+  //----------------------------------------------------------------------------
+  /// Compute gamma of a reference voxel searching on a sub-voxel grid, interpolating the compare dose
+  float ComputeSubvoxelGamma(const std::vector<vtkGammaDoseComparison::GammaSearchOffset>& searchOffsets, int subdivisions,
+    const float* comparePtr, const int dimensions[3], int i, int j, int k,
+    float referenceDose, float inverseSquaredDoseTolerance, float maximumSquaredGamma)
+  {
+    double step = 1.0 / subdivisions;
+    float bestSquaredGamma = maximumSquaredGamma;
+    for (std::vector<vtkGammaDoseComparison::GammaSearchOffset>::const_iterator offsetIt = searchOffsets.begin();
+      offsetIt != searchOffsets.end(); ++offsetIt)
+    {
+      if (offsetIt->NormalizedSquaredDistance >= bestSquaredGamma)
+      {
+        break;
+      }
+      double position[3] = { i + offsetIt->Offset[0] * step, j + offsetIt->Offset[1] * step, k + offsetIt->Offset[2] * step };
+      if ( position[0] < 0.0 || position[0] > dimensions[0]-1 || position[1] < 0.0 || position[1] > dimensions[1]-1
+        || position[2] < 0.0 || position[2] > dimensions[2]-1 )
+      {
+        continue;
+      }
+      float doseDifference = InterpolateTrilinear(comparePtr, dimensions, position) - referenceDose;
+      float squaredGamma = offsetIt->NormalizedSquaredDistance + doseDifference * doseDifference * inverseSquaredDoseTolerance;
+      if (squaredGamma < bestSquaredGamma)
+      {
+        bestSquaredGamma = squaredGamma;
+      }
+    }
+    return sqrt(bestSquaredGamma);
+  }
+
+  //----------------------------------------------------------------------------
+  /// Average float image in blocks of factor^3 voxels (partial blocks at the end of the axes)
+  void DownsampleImage(vtkImageData* image, int factor, vtkImageData* coarseImage)
+  {
+    int dimensions[3] = {0, 0, 0};
+    image->GetDimensions(dimensions);
+    int coarseDimensions[3] = {0, 0, 0};
+    for (int axis=0; axis<3; ++axis)
+    {
+      coarseDimensions[axis] = (dimensions[axis] + factor - 1) / factor;
+    }
+    coarseImage->Initialize();
+    coarseImage->SetExtent(0, coarseDimensions[0]-1, 0, coarseDimensions[1]-1, 0, coarseDimensions[2]-1);
+    coarseImage->AllocateScalars(VTK_FLOAT, 1);
+
+    const float* imagePtr = static_cast<const float*>(image->GetScalarPointer());
+    float* coarsePtr = static_cast<float*>(coarseImage->GetScalarPointer());
+    vtkIdType coarseRowSize = coarseDimensions[0];
+    vtkIdType coarseSliceSize = coarseRowSize * coarseDimensions[1];
+    std::fill(coarsePtr, coarsePtr + coarseSliceSize * coarseDimensions[2], 0.0f);
+
+    for (int k=0; k<dimensions[2]; ++k)
+    {
+      for (int j=0; j<dimensions[1]; ++j)
+      {
+        float* coarseRowPtr = coarsePtr + (k/factor) * coarseSliceSize + (j/factor) * coarseRowSize;
+        for (int i=0; i<dimensions[0]; ++i)
+        {
+          coarseRowPtr[i/factor] += *(imagePtr++);
+        }
+      }
+    }
+
+    for (int k=0; k<coarseDimensions[2]; ++k)
+    {
+      int blockSizeK = std::min(factor, dimensions[2] - k*factor);
+      for (int j=0; j<coarseDimensions[1]; ++j)
+      {
+        int blockSizeJ = std::min(factor, dimensions[1] - j*factor);
+        for (int i=0; i<coarseDimensions[0]; ++i)
+        {
+          int blockSizeI = std::min(factor, dimensions[0] - i*factor);
+          *(coarsePtr++) /= static_cast<float>(blockSizeI * blockSizeJ * blockSizeK);
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  bool DoDimensionsMatch(vtkImageData* image1, vtkImageData* image2)
+  {
+    int dimensions1[3] = {0, 0, 0};
+    int dimensions2[3] = {0, 0, 0};
+    image1->GetDimensions(dimensions1);
+    image2->GetDimensions(dimensions2);
+    return std::equal(dimensions1, dimensions1 + 3, dimensions2);
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkGammaDoseComparison::vtkGammaDoseComparison()
+{
+  this->ReferenceDoseImageData = NULL;
+  this->CompareDoseImageData = NULL;
+  this->MaskImageData = NULL;
+  this->OutputGammaImageData = vtkImageData::New();
+  this->CoarseGammaImageData = vtkImageData::New();
+
+  this->Spacing[0] = this->Spacing[1] = this->Spacing[2] = 1.0;
+  this->DtaDistanceToleranceMm = 3.0;
+  this->DoseDifferenceTolerance = 0.03;
+  this->ReferenceDose = 0.0;
+  this->AnalysisThreshold = 0.1;
+  this->MaximumGamma = 2.0;
+  this->LocalDoseDifference = false;
+  this->DoseThresholdOnReferenceOnly = false;
+  this->MultiResolution = false;
+  this->DownsamplingFactor = 4;
+  this->GammaEstimateTolerance = 0.1;
+  this->RefinementSubdivisions = 1;
+
+  this->UsedReferenceDose = 0.0;
+  this->NumberOfAnalyzedVoxels = 0;
+  this->NumberOfPassingVoxels = 0;
+  this->NumberOfRefinedVoxels = 0;
+
+  this->Threader = vtkMultiThreader::New();
+  this->NumberOfThreads = this->Threader->GetNumberOfThreads();
+}
+
+//----------------------------------------------------------------------------
+vtkGammaDoseComparison::~vtkGammaDoseComparison()
+{
+  this->SetReferenceDoseImageData(NULL);
+  this->SetCompareDoseImageData(NULL);
+  this->SetMaskImageData(NULL);
+  if (this->OutputGammaImageData)
+  {
+    this->OutputGammaImageData->Delete();
+    this->OutputGammaImageData = NULL;
+  }
+  if (this->CoarseGammaImageData)
+  {
+    this->CoarseGammaImageData->Delete();
+    this->CoarseGammaImageData = NULL;
+  }
+  if (this->Threader)
+  {
+    this->Threader->Delete();
+    this->Threader = NULL;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkGammaDoseComparison::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "Spacing: " << this->Spacing[0] << ", " << this->Spacing[1] << ", " << this->Spacing[2] << "\n";
+  os << indent << "DtaDistanceToleranceMm: " << this->DtaDistanceToleranceMm << "\n";
+  os << indent << "DoseDifferenceTolerance: " << this->DoseDifferenceTolerance << "\n";
+  os << indent << "ReferenceDose: " << this->ReferenceDose << "\n";
+  os << indent << "AnalysisThreshold: " << this->AnalysisThreshold << "\n";
+  os << indent << "MaximumGamma: " << this->MaximumGamma << "\n";
+  os << indent << "LocalDoseDifference: " << (this->LocalDoseDifference ? "true" : "false") << "\n";
+  os << indent << "DoseThresholdOnReferenceOnly: " << (this->DoseThresholdOnReferenceOnly ? "true" : "false") << "\n";
+  os << indent << "MultiResolution: " << (this->MultiResolution ? "true" : "false") << "\n";
+  os << indent << "DownsamplingFactor: " << this->DownsamplingFactor << "\n";
+  os << indent << "GammaEstimateTolerance: " << this->GammaEstimateTolerance << "\n";
+  os << indent << "RefinementSubdivisions: " << this->RefinementSubdivisions << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+}
+
+//----------------------------------------------------------------------------
+double vtkGammaDoseComparison::GetPassFraction()
+{
+  if (this->NumberOfAnalyzedVoxels == 0)
+  {
+    return 0.0;
+  }
+  return static_cast<double>(this->NumberOfPassingVoxels) / this->NumberOfAnalyzedVoxels;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkGammaDoseComparison::GetReportString()
+{
+  std::stringstream reportStream;
+  reportStream << "Reference dose = " << this->UsedReferenceDose << "\n"
+    << "Dose difference tolerance = " << this->DoseDifferenceTolerance * 100.0 << " % (" << (this->LocalDoseDifference ? "local" : "global") << ")\n"
+    << "Distance to agreement tolerance = " << this->DtaDistanceToleranceMm << " mm\n"
+    << "Analysis threshold = " << this->AnalysisThreshold * 100.0 << " %" << (this->DoseThresholdOnReferenceOnly ? " (reference only)" : "") << "\n"
+    << "Number of voxels analyzed = " << this->NumberOfAnalyzedVoxels << "\n"
+    << "Number of voxels passed = " << this->NumberOfPassingVoxels << "\n"
+    << "Number of voxels failed = " << this->NumberOfAnalyzedVoxels - this->NumberOfPassingVoxels << "\n";
+  if (this->MultiResolution)
+  {
+    reportStream << "Number of voxels refined at full resolution = " << this->NumberOfRefinedVoxels << "\n"
+      << "Gamma estimate tolerance = " << this->GammaEstimateTolerance << "\n";
+  }
+  reportStream    << "Pass rate = " << this->GetPassFraction() * 100.0 << " %\n";
+  return reportStream.str();
+}
+
+//----------------------------------------------------------------------------
+void vtkGammaDoseComparison::BuildSearchOffsetTable(int subdivisions, std::vector<GammaSearchOffset>& searchOffsets)
+{
+  searchOffsets.clear();
+
+  double searchRadiusMm = this->MaximumGamma * this->DtaDistanceToleranceMm;
+  double stepMm[3] = {0.0, 0.0, 0.0};
+  int searchRadius[3] = {0, 0, 0};
+  for (int axis=0; axis<3; ++axis)
+  {
+    stepMm[axis] = this->Spacing[axis] / subdivisions;
+    searchRadius[axis] = static_cast<int>(floor(searchRadiusMm / stepMm[axis]));
+  }
+
+  double inverseSquaredDta = 1.0 / (this->DtaDistanceToleranceMm * this->DtaDistanceToleranceMm);
+  double squaredSearchRadiusMm = searchRadiusMm * searchRadiusMm;
+  for (int k=-searchRadius[2]; k<=searchRadius[2]; ++k)
+  {
+    for (int j=-searchRadius[1]; j<=searchRadius[1]; ++j)
+    {
+      for (int i=-searchRadius[0]; i<=searchRadius[0]; ++i)
+      {
+        double squaredDistanceMm = i*i*stepMm[0]*stepMm[0] + j*j*stepMm[1]*stepMm[1] + k*k*stepMm[2]*stepMm[2];
+        if (squaredDistanceMm > squaredSearchRadiusMm)
+        {
+          continue;
+        }
+        GammaSearchOffset offset;
+        offset.Offset[0] = i;
+        offset.Offset[1] = j;
+        offset.Offset[2] = k;
+        offset.NormalizedSquaredDistance = static_cast<float>(squaredDistanceMm * inverseSquaredDta);
+        searchOffsets.push_back(offset);
+      }
+    }
+  }
+
+  std::stable_sort(searchOffsets.begin(), searchOffsets.end(), CompareSearchOffsets);
+}
+
+//----------------------------------------------------------------------------
+bool vtkGammaDoseComparison::ComputeCoarseGamma()
+{
+  int factor = this->DownsamplingFactor;
+  vtkSmartPointer<vtkImageData> coarseReferenceDoseImageData = vtkSmartPointer<vtkImageData>::New();
+  DownsampleImage(this->ReferenceDoseImageData, factor, coarseReferenceDoseImageData);
+  vtkSmartPointer<vtkImageData> coarseCompareDoseImageData = vtkSmartPointer<vtkImageData>::New();
+  DownsampleImage(this->CompareDoseImageData, factor, coarseCompareDoseImageData);
+
+  // Compute coarse gamma everywhere, thresholding and masking is performed on the full resolution lattice
+  vtkSmartPointer<vtkGammaDoseComparison> coarseGamma = vtkSmartPointer<vtkGammaDoseComparison>::New();
+  coarseGamma->SetReferenceDoseImageData(coarseReferenceDoseImageData);
+  coarseGamma->SetCompareDoseImageData(coarseCompareDoseImageData);
+  coarseGamma->SetSpacing(this->Spacing[0] * factor, this->Spacing[1] * factor, this->Spacing[2] * factor);
+  coarseGamma->SetDtaDistanceToleranceMm(this->DtaDistanceToleranceMm);
+  coarseGamma->SetDoseDifferenceTolerance(this->DoseDifferenceTolerance);
+  coarseGamma->SetLocalDoseDifference(this->LocalDoseDifference);
+  coarseGamma->SetReferenceDose(this->UsedReferenceDose);
+  coarseGamma->SetAnalysisThreshold(0.0);
+  coarseGamma->SetDoseThresholdOnReferenceOnly(true);
+  coarseGamma->SetMaximumGamma(this->MaximumGamma);
+  coarseGamma->SetNumberOfThreads(this->NumberOfThreads);
+  if (!coarseGamma->Update())
+  {
+    vtkErrorMacro("ComputeCoarseGamma: Failed to compute gamma on the downsampled lattice!");
+    return false;
+  }
+
+  this->CoarseGammaImageData->ShallowCopy(coarseGamma->GetOutputGammaImageData());
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkGammaDoseComparison::ComputeBlockGammaBounds()
+{
+  int factor = this->DownsamplingFactor;
+  int dimensions[3] = {0, 0, 0};
+  this->ReferenceDoseImageData->GetDimensions(dimensions);
+  int blockDimensions[3] = {0, 0, 0};
+  for (int axis=0; axis<3; ++axis)
+  {
+    blockDimensions[axis] = (dimensions[axis] + factor - 1) / factor;
+  }
+  vtkIdType blockRowSize = blockDimensions[0];
+  vtkIdType blockSliceSize = blockRowSize * blockDimensions[1];
+  vtkIdType numberOfBlocks = blockSliceSize * blockDimensions[2];
+
+  // Dose ranges of the blocks
+  std::vector<float> referenceMinimum(numberOfBlocks, VTK_FLOAT_MAX);
+  std::vector<float> referenceMaximum(numberOfBlocks, -VTK_FLOAT_MAX);
+  std::vector<float> compareMinimum(numberOfBlocks, VTK_FLOAT_MAX);
+  std::vector<float> compareMaximum(numberOfBlocks, -VTK_FLOAT_MAX);
+  std::vector<float> maximumVoxelDoseDifference(numberOfBlocks, 0.0f);
+  const float* referencePtr = static_cast<const float*>(this->ReferenceDoseImageData->GetScalarPointer());
+  const float* comparePtr = static_cast<const float*>(this->CompareDoseImageData->GetScalarPointer());
+  for (int k=0; k<dimensions[2]; ++k)
+  {
+    for (int j=0; j<dimensions[1]; ++j)
+    {
+      vtkIdType blockRowIndex = (k/factor) * blockSliceSize + (j/factor) * blockRowSize;
+      for (int i=0; i<dimensions[0]; ++i, ++referencePtr, ++comparePtr)
+      {
+        vtkIdType blockIndex = blockRowIndex + i/factor;
+        referenceMinimum[blockIndex] = std::min(referenceMinimum[blockIndex], *referencePtr);
+        referenceMaximum[blockIndex] = std::max(referenceMaximum[blockIndex], *referencePtr);
+        compareMinimum[blockIndex] = std::min(compareMinimum[blockIndex], *comparePtr);
+        compareMaximum[blockIndex] = std::max(compareMaximum[blockIndex], *comparePtr);
+        maximumVoxelDoseDifference[blockIndex] = std::max(maximumVoxelDoseDifference[blockIndex], static_cast<float>(fabs(*comparePtr - *referencePtr)));
+      }
+    }
+  }
+
+  // Block offsets that have voxels within the search radius. The minimum distance is computed for full blocks,
+  // which is not greater than the minimum distance of the partial blocks at the end of the axes
+  double inverseSquaredDta = 1.0 / (this->DtaDistanceToleranceMm * this->DtaDistanceToleranceMm);
+  double maximumSquaredGamma = this->MaximumGamma * this->MaximumGamma;
+  double searchRadiusMm = this->MaximumGamma * this->DtaDistanceToleranceMm;
+  int blockSearchRadius[3] = {0, 0, 0};
+  for (int axis=0; axis<3; ++axis)
+  {
+    blockSearchRadius[axis] = static_cast<int>(floor((searchRadiusMm / this->Spacing[axis] + factor - 1) / factor));
+  }
+  std::vector<BlockSearchOffset> blockSearchOffsets;
+  for (int k=-blockSearchRadius[2]; k<=blockSearchRadius[2]; ++k)
+  {
+    for (int j=-blockSearchRadius[1]; j<=blockSearchRadius[1]; ++j)
+    {
+      for (int i=-blockSearchRadius[0]; i<=blockSearchRadius[0]; ++i)
+      {
+        BlockSearchOffset blockOffset;
+        blockOffset.Offset[0] = i;
+        blockOffset.Offset[1] = j;
+        blockOffset.Offset[2] = k;
+        double minimumSquaredDistanceMm = 0.0;
+        for (int axis=0; axis<3; ++axis)
+        {
+          double minimumDistanceMm = std::max(std::abs(blockOffset.Offset[axis]) * factor - (factor - 1), 0) * this->Spacing[axis];
+          minimumSquaredDistanceMm += minimumDistanceMm * minimumDistanceMm;
+        }
+        blockOffset.MinimumNormalizedSquaredDistance = minimumSquaredDistanceMm * inverseSquaredDta;
+        if (blockOffset.MinimumNormalizedSquaredDistance <= maximumSquaredGamma)
+        {
+          blockSearchOffsets.push_back(blockOffset);
+        }
+      }
+    }
+  }
+
+  // Lower bound: closest voxel pairs of the neighbor blocks with the smallest possible dose difference, evaluated
+  // with the largest dose tolerance. Upper bound: gamma of a voxel is not greater than the dose difference term
+  // at zero distance, evaluated with the largest dose difference in the block and the smallest dose tolerance.
+  // Both are limited to the maximum gamma, which the voxel search never exceeds.
+  double globalDoseTolerance = this->DoseDifferenceTolerance * this->UsedReferenceDose;
+  this->BlockGammaLowerBounds.assign(numberOfBlocks, 0.0f);
+  this->BlockGammaUpperBounds.assign(numberOfBlocks, 0.0f);
+  for (int k=0; k<blockDimensions[2]; ++k)
+  {
+    for (int j=0; j<blockDimensions[1]; ++j)
+    {
+      for (int i=0; i<blockDimensions[0]; ++i)
+      {
+        vtkIdType blockIndex = k * blockSliceSize + j * blockRowSize + i;
+        double largestDoseTolerance = globalDoseTolerance;
+        double smallestDoseTolerance = globalDoseTolerance;
+        if (this->LocalDoseDifference)
+        {
+          largestDoseTolerance = this->DoseDifferenceTolerance * referenceMaximum[blockIndex];
+          smallestDoseTolerance = this->DoseDifferenceTolerance * referenceMinimum[blockIndex];
+        }
+        double inverseSquaredLargestDoseTolerance = ( largestDoseTolerance > 0.0
+          ? 1.0 / (largestDoseTolerance * largestDoseTolerance) : ZERO_DOSE_TOLERANCE_INVERSE_SQUARED );
+        double inverseSquaredSmallestDoseTolerance = ( smallestDoseTolerance > 0.0
+          ? 1.0 / (smallestDoseTolerance * smallestDoseTolerance) : ZERO_DOSE_TOLERANCE_INVERSE_SQUARED );
+
+        double lowerSquaredGamma = maximumSquaredGamma;
+        double upperSquaredGamma = std::min( maximumSquaredGamma, maximumVoxelDoseDifference[blockIndex]
+          * maximumVoxelDoseDifference[blockIndex] * inverseSquaredSmallestDoseTolerance );
+        for (std::vector<BlockSearchOffset>::iterator offsetIt = blockSearchOffsets.begin(); offsetIt != blockSearchOffsets.end(); ++offsetIt)
+        {
+          int neighborI = i + offsetIt->Offset[0];
+          int neighborJ = j + offsetIt->Offset[1];
+          int neighborK = k + offsetIt->Offset[2];
+          if ( neighborI < 0 || neighborI >= blockDimensions[0] || neighborJ < 0 || neighborJ >= blockDimensions[1]
+            || neighborK < 0 || neighborK >= blockDimensions[2] )
+          {
+            continue;
+          }
+          vtkIdType neighborIndex = neighborK * blockSliceSize + neighborJ * blockRowSize + neighborI;
+          double minimumDoseDifference = std::max( 0.0, static_cast<double>( std::max( compareMinimum[neighborIndex] - referenceMaximum[blockIndex],
+            referenceMinimum[blockIndex] - compareMaximum[neighborIndex] ) ) );
+          lowerSquaredGamma = std::min( lowerSquaredGamma, offsetIt->MinimumNormalizedSquaredDistance
+            + minimumDoseDifference * minimumDoseDifference * inverseSquaredLargestDoseTolerance );
+        }
+        this->BlockGammaLowerBounds[blockIndex] = static_cast<float>(sqrt(lowerSquaredGamma));
+        this->BlockGammaUpperBounds[blockIndex] = static_cast<float>(sqrt(upperSquaredGamma));
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkGammaDoseComparison::Update()
+{
+  if (!this->ReferenceDoseImageData || !this->CompareDoseImageData)
+  {
+    vtkErrorMacro("Update: Reference and compare dose images need to be set!");
+    return false;
+  }
+  if ( this->ReferenceDoseImageData->GetScalarType() != VTK_FLOAT || this->CompareDoseImageData->GetScalarType() != VTK_FLOAT
+    || this->ReferenceDoseImageData->GetNumberOfScalarComponents() != 1 || this->CompareDoseImageData->GetNumberOfScalarComponents() != 1 )
+  {
+    vtkErrorMacro("Update: Reference and compare dose images need to be of single component float type!");
+    return false;
+  }
+  if ( !DoDimensionsMatch(this->ReferenceDoseImageData, this->CompareDoseImageData)
+    || (this->MaskImageData && !DoDimensionsMatch(this->ReferenceDoseImageData, this->MaskImageData)) )
+  {
+    vtkErrorMacro("Update: Compare dose and mask images need to be resampled to the reference lattice!");
+    return false;
+  }
+  if (this->MaskImageData && this->MaskImageData->GetScalarType() != VTK_UNSIGNED_CHAR)
+  {
+    vtkErrorMacro("Update: Mask image needs to be of unsigned char type!");
+    return false;
+  }
+  if ( this->DtaDistanceToleranceMm <= 0.0 || this->DoseDifferenceTolerance <= 0.0 || this->MaximumGamma <= 0.0
+    || this->Spacing[0] <= 0.0 || this->Spacing[1] <= 0.0 || this->Spacing[2] <= 0.0 )
+  {
+    vtkErrorMacro("Update: DTA, dose difference tolerance, maximum gamma and spacing need to be positive!");
+    return false;
+  }
+
+  // Determine reference dose
+  this->UsedReferenceDose = this->ReferenceDose;
+  if (this->UsedReferenceDose <= 0.0)
+  {
+    double range[2] = {0.0, 0.0};
+    this->ReferenceDoseImageData->GetPointData()->GetScalars()->GetRange(range);
+    this->UsedReferenceDose = range[1];
+  }
+  if (this->UsedReferenceDose <= 0.0)
+  {
+    vtkErrorMacro("Update: Reference dose needs to be positive!");
+    return false;
+  }
+
+  // Allocate output
+  this->OutputGammaImageData->Initialize();
+  this->OutputGammaImageData->SetExtent(this->ReferenceDoseImageData->GetExtent());
+  this->OutputGammaImageData->AllocateScalars(VTK_FLOAT, 1);
+
+  this->BuildSearchOffsetTable(1, this->SearchOffsets);
+  if (this->MultiResolution)
+  {
+    this->BuildSearchOffsetTable(this->RefinementSubdivisions, this->RefinementSearchOffsets);
+    if (!this->ComputeCoarseGamma())
+    {
+      return false;
+    }
+    this->ComputeBlockGammaBounds();
+  }
+  else
+  {
+    this->RefinementSearchOffsets.clear();
+    this->CoarseGammaImageData->Initialize();
+    this->BlockGammaLowerBounds.clear();
+    this->BlockGammaUpperBounds.clear();
+  }
+
+  // Compute gamma in parallel slabs
+  int numberOfThreads = this->NumberOfThreads;
+  std::fill(this->ThreadAnalyzedVoxels, this->ThreadAnalyzedVoxels + VTK_MAX_THREADS, 0);
+  std::fill(this->ThreadPassingVoxels, this->ThreadPassingVoxels + VTK_MAX_THREADS, 0);
+  std::fill(this->ThreadRefinedVoxels, this->ThreadRefinedVoxels + VTK_MAX_THREADS, 0);
+  this->Threader->SetNumberOfThreads(numberOfThreads);
+  this->Threader->SetSingleMethod(ComputeGammaThreadFunction, this);
+  this->Threader->SingleMethodExecute();
+
+  this->NumberOfAnalyzedVoxels = 0;
+  this->NumberOfPassingVoxels = 0;
+  this->NumberOfRefinedVoxels = 0;
+  for (int threadId=0; threadId<numberOfThreads; ++threadId)
+  {
+    this->NumberOfAnalyzedVoxels += this->ThreadAnalyzedVoxels[threadId];
+    this->NumberOfPassingVoxels += this->ThreadPassingVoxels[threadId];
+    this->NumberOfRefinedVoxels += this->ThreadRefinedVoxels[threadId];
+  }
+
+  this->OutputGammaImageData->Modified();
+
+  double progress = 1.0;
+  this->InvokeEvent(vtkCommand::ProgressEvent, &progress);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkGammaDoseComparison::ThreadedComputeGamma(int kStart, int kEnd, int threadId)
+{
+  int extent[6] = {0, -1, 0, -1, 0, -1};
+  this->ReferenceDoseImageData->GetExtent(extent);
+  int dimensions[3] = {0, 0, 0};
+  this->ReferenceDoseImageData->GetDimensions(dimensions);
+  vtkIdType rowSize = dimensions[0];
+  vtkIdType sliceSize = rowSize * dimensions[1];
+
+  const float* referencePtr = static_cast<const float*>(this->ReferenceDoseImageData->GetScalarPointer());
+  const float* comparePtr = static_cast<const float*>(this->CompareDoseImageData->GetScalarPointer());
+  const unsigned char* maskPtr = (this->MaskImageData ? static_cast<const unsigned char*>(this->MaskImageData->GetScalarPointer()) : NULL);
+  float* gammaPtr = static_cast<float*>(this->OutputGammaImageData->GetScalarPointer());
+
+  float analysisThresholdDose = static_cast<float>(this->AnalysisThreshold * this->UsedReferenceDose);
+  float globalDoseTolerance = static_cast<float>(this->DoseDifferenceTolerance * this->UsedReferenceDose);
+  float maximumSquaredGamma = static_cast<float>(this->MaximumGamma * this->MaximumGamma);
+  float doseDifferenceTolerance = static_cast<float>(this->DoseDifferenceTolerance);
+  bool localDoseDifference = this->LocalDoseDifference;
+  bool thresholdOnReferenceOnly = this->DoseThresholdOnReferenceOnly;
+
+  // Coarse gamma and block gamma bounds for multi-resolution mode. Coarse voxel (block) c contains the full resolution
+  // indices from c*factor to c*factor+factor-1, and it is centered at full resolution index c*factor+(factor-1)/2
+  const float* coarseGammaPtr = (this->MultiResolution ? static_cast<const float*>(this->CoarseGammaImageData->GetScalarPointer()) : NULL);
+  int coarseDimensions[3] = {0, 0, 0};
+  this->CoarseGammaImageData->GetDimensions(coarseDimensions);
+  vtkIdType coarseRowSize = coarseDimensions[0];
+  vtkIdType coarseSliceSize = coarseRowSize * coarseDimensions[1];
+  int factor = this->DownsamplingFactor;
+  double inverseFactor = 1.0 / factor;
+  double coarseCenterOffset = (factor - 1) * 0.5;
+  const float* blockLowerBoundPtr = (coarseGammaPtr ? &(this->BlockGammaLowerBounds[0]) : NULL);
+  const float* blockUpperBoundPtr = (coarseGammaPtr ? &(this->BlockGammaUpperBounds[0]) : NULL);
+  bool subvoxelRefinement = (this->RefinementSubdivisions > 1);
+  float gammaEstimateTolerance = static_cast<float>(this->GammaEstimateTolerance);
+
+  // Flat index offsets corresponding to the search offsets
+  std::vector<vtkIdType> flatOffsets(this->SearchOffsets.size(), 0);
+  for (size_t offsetIndex=0; offsetIndex<this->SearchOffsets.size(); ++offsetIndex)
+  {
+    const int* offset = this->SearchOffsets[offsetIndex].Offset;
+    flatOffsets[offsetIndex] = offset[0] + offset[1] * rowSize + offset[2] * sliceSize;
+  }
+  const GammaSearchOffset* searchOffsets = (this->SearchOffsets.empty() ? NULL : &(this->SearchOffsets[0]));
+  size_t numberOfSearchOffsets = this->SearchOffsets.size();
+
+  vtkIdType numberOfAnalyzedVoxels = 0;
+  vtkIdType numberOfPassingVoxels = 0;
+  vtkIdType numberOfRefinedVoxels = 0;
+  for (int k=kStart-extent[4]; k<=kEnd-extent[4]; ++k)
+  {
+    for (int j=0; j<dimensions[1]; ++j)
+    {
+      vtkIdType index = k * sliceSize + j * rowSize;
+      for (int i=0; i<dimensions[0]; ++i, ++index)
+      {
+        gammaPtr[index] = 0.0f;
+
+        // Skip voxels that are not analyzed
+        float referenceDose = referencePtr[index];
+        if (maskPtr && maskPtr[index] == 0)
+        {
+          continue;
+        }
+        if ( referenceDose < analysisThresholdDose
+          && (thresholdOnReferenceOnly || comparePtr[index] < analysisThresholdDose) )
+        {
+          continue;
+        }
+
+        float doseTolerance = (localDoseDifference ? doseDifferenceTolerance * referenceDose : globalDoseTolerance);
+        float inverseSquaredDoseTolerance = ( doseTolerance > 0.0f
+          ? 1.0f / (doseTolerance * doseTolerance) : ZERO_DOSE_TOLERANCE_INVERSE_SQUARED );
+
+        float gamma = 0.0f;
+        vtkIdType blockIndex = (coarseGammaPtr ? (k/factor) * coarseSliceSize + (j/factor) * coarseRowSize + i/factor : 0);
+        bool classified = ( coarseGammaPtr && ( blockUpperBoundPtr[blockIndex] < 1.0f - GAMMA_BOUND_TOLERANCE
+          || blockLowerBoundPtr[blockIndex] > 1.0f + GAMMA_BOUND_TOLERANCE ) );
+        if (classified && blockUpperBoundPtr[blockIndex] - blockLowerBoundPtr[blockIndex] <= gammaEstimateTolerance)
+        {
+          // Passing or failing for sure, and the bounds are tight enough to estimate the value from the coarse gamma
+          double coarsePosition[3] = { (i-coarseCenterOffset) * inverseFactor, (j-coarseCenterOffset) * inverseFactor, (k-coarseCenterOffset) * inverseFactor };
+          float coarseGamma = InterpolateTrilinear(coarseGammaPtr, coarseDimensions, coarsePosition);
+          gamma = std::min(std::max(coarseGamma, blockLowerBoundPtr[blockIndex]), blockUpperBoundPtr[blockIndex]);
+        }
+        else if (coarseGammaPtr && !classified && subvoxelRefinement)
+        {
+          // Not classified by the block bounds, search on the sub-voxel grid
+          gamma = ComputeSubvoxelGamma( this->RefinementSearchOffsets, this->RefinementSubdivisions, comparePtr, dimensions,
+            i, j, k, referenceDose, inverseSquaredDoseTolerance, maximumSquaredGamma );
+          ++numberOfRefinedVoxels;
+        }
+        else
+        {
+          // Search in increasing distance, stop when the distance term alone exceeds the best gamma
+          numberOfRefinedVoxels += (coarseGammaPtr ? 1 : 0);
+          float bestSquaredGamma = maximumSquaredGamma;
+          for (size_t offsetIndex=0; offsetIndex<numberOfSearchOffsets; ++offsetIndex)
+          {
+            const GammaSearchOffset& offset = searchOffsets[offsetIndex];
+            if (offset.NormalizedSquaredDistance >= bestSquaredGamma)
+            {
+              break;
+            }
+            int searchI = i + offset.Offset[0];
+            int searchJ = j + offset.Offset[1];
+            int searchK = k + offset.Offset[2];
+            if ( searchI < 0 || searchI >= dimensions[0] || searchJ < 0 || searchJ >= dimensions[1]
+              || searchK < 0 || searchK >= dimensions[2] )
+            {
+              continue;
+            }
+            float doseDifference = comparePtr[index + flatOffsets[offsetIndex]] - referenceDose;
+            float squaredGamma = offset.NormalizedSquaredDistance + doseDifference * doseDifference * inverseSquaredDoseTolerance;
+            if (squaredGamma < bestSquaredGamma)
+            {
+              bestSquaredGamma = squaredGamma;
+            }
+          }
+          gamma = sqrt(bestSquaredGamma);
+        }
+
+        gammaPtr[index] = gamma;
+        ++numberOfAnalyzedVoxels;
+        if (gamma <= 1.0f)
+        {
+          ++numberOfPassingVoxels;
+        }
+      }
+    }
+
+    // Report progress from the first thread, which runs in the calling thread
+    if (threadId == 0)
+    {
+      double progress = static_cast<double>(k - (kStart-extent[4]) + 1) / (kEnd - kStart + 1);
+      this->InvokeEvent(vtkCommand::ProgressEvent, &progress);
+    }
+  }
+
+  this->ThreadAnalyzedVoxels[threadId] = numberOfAnalyzedVoxels;
+  this->ThreadPassingVoxels[threadId] = numberOfPassingVoxels;
+  this->ThreadRefinedVoxels[threadId] = numberOfRefinedVoxels;
+}
@@ -0,0 +1,261 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#ifndef __vtkGammaDoseComparison_h
+#define __vtkGammaDoseComparison_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkMultiThreader.h>
+
+// STD includes
+#include <string>
+#include <vector>
+
+#include "vtkSlicerDoseComparisonModuleLogicExport.h"
+
+class vtkImageData;
+
+/// \ingroup SlicerRt_QtModules_DoseComparison
+/// \class vtkGammaDoseComparison
+/// \brief Compute gamma dose difference of two dose images on the same lattice.
+///
+/// Native implementation of the gamma analysis performed by plastimatch's Gamma_dose_comparison, with the same
+/// parameters (DTA, dose difference tolerance, local/global dose difference, analysis threshold, maximum gamma, threshold
+/// on the reference only). The compare dose needs to be resampled to the reference lattice beforehand.
+///
+/// The search neighborhood (all voxel offsets within maximum gamma times DTA) is precomputed as a table sorted by distance.
+/// As the distance term alone is a lower bound of gamma, the search for a reference voxel is terminated as soon as the
+/// distance of the next offset exceeds the best gamma found so far. The reference lattice is processed in parallel slabs along the K axis.
+///
+/// In multi-resolution mode the lattice is divided into blocks of DownsamplingFactor^3 voxels, and conservative bounds
+/// of gamma are computed for each block: the lower bound from the dose ranges of the neighboring blocks and their
+/// minimum distance, the upper bound from the largest voxelwise dose difference in the block. Voxels in blocks whose
+/// upper bound is below 1 pass and voxels in blocks whose lower bound is above 1 fail without a search. Only the other
+/// voxels (e.g. in steep gradients) are computed at full resolution, so the pass/fail classification is identical to
+/// the full computation.
+/// The gamma value of the classified voxels is estimated from a coarse gamma pass on block-averaged doses, clamped to
+/// the bounds of the block. As the exact value is within the same bounds, the estimate differs from it by at most the
+/// width of the bounds. The estimate is only used in blocks where this width is not greater than GammaEstimateTolerance,
+/// the classified voxels of the other blocks are computed at full resolution. So the gamma image (and its histogram)
+/// matches the full computation within GammaEstimateTolerance, and the pass rate matches exactly.
+/// If RefinementSubdivisions is greater than 1, the unclassified voxels are searched on a sub-voxel grid with trilinear
+/// interpolation of the compare dose, so their gamma can only decrease compared to the full computation.
+///
+/// Voxels that are not analyzed (below the threshold, or outside the mask) get gamma value 0.
+/// Progress is reported by ProgressEvent events with the progress (double, between 0 and 1) as call data.
+class VTK_SLICER_DOSECOMPARISON_LOGIC_EXPORT vtkGammaDoseComparison : public vtkObject
+{
+public:
+  /// Entry of the offset table
+  struct GammaSearchOffset
+  {
+    /// Offset along each axis in search steps (voxel size divided by the number of subdivisions)
+    int Offset[3];
+    /// Squared distance of the offset divided by the squared DTA
+    float NormalizedSquaredDistance;
+  };
+
+public:
+  static vtkGammaDoseComparison *New();
+  vtkTypeMacro(vtkGammaDoseComparison, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Set reference dose image (float)
+  void SetReferenceDoseImageData(vtkImageData* imageData);
+  vtkGetObjectMacro(ReferenceDoseImageData, vtkImageData);
+
+  /// Set compare dose image (float, resampled to the reference lattice)
+  void SetCompareDoseImageData(vtkImageData* imageData);
+  vtkGetObjectMacro(CompareDoseImageData, vtkImageData);
+
+  /// Set mask image (unsigned char, reference lattice). Optional, only non-zero voxels are analyzed if set
+  void SetMaskImageData(vtkImageData* imageData);
+  vtkGetObjectMacro(MaskImageData, vtkImageData);
+
+  /// Get output gamma image (float, reference lattice)
+  vtkGetObjectMacro(OutputGammaImageData, vtkImageData);
+
+  /// Voxel spacing of the reference lattice in mm
+  vtkSetVector3Macro(Spacing, double);
+  vtkGetVector3Macro(Spacing, double);
+
+  /// Distance to agreement (DTA) tolerance in mm
+  vtkSetMacro(DtaDistanceToleranceMm, double);
+  vtkGetMacro(DtaDistanceToleranceMm, double);
+
+  /// Dose difference tolerance as fraction of the reference dose (e.g. 0.03 for 3%)
+  vtkSetMacro(DoseDifferenceTolerance, double);
+  vtkGetMacro(DoseDifferenceTolerance, double);
+
+  /// Reference (prescription) dose. If not positive, the maximum of the reference dose image is used
+  vtkSetMacro(ReferenceDose, double);
+  vtkGetMacro(ReferenceDose, double);
+
+  /// Analysis threshold as fraction of the reference dose. Voxels with lower dose are not analyzed
+  vtkSetMacro(AnalysisThreshold, double);
+  vtkGetMacro(AnalysisThreshold, double);
+
+  /// Maximum gamma. Limits the search neighborhood to MaximumGamma*DTA
+  vtkSetMacro(MaximumGamma, double);
+  vtkGetMacro(MaximumGamma, double);
+
+  /// Use local dose difference (dose tolerance relative to the dose in the reference voxel) instead of global.
+  /// Where the reference dose is zero only zero dose difference is tolerated (gamma is the maximum gamma otherwise)
+  vtkSetMacro(LocalDoseDifference, bool);
+  vtkGetMacro(LocalDoseDifference, bool);
+  vtkBooleanMacro(LocalDoseDifference, bool);
+
+  /// Apply the analysis threshold on the reference dose only (otherwise on both doses)
+  vtkSetMacro(DoseThresholdOnReferenceOnly, bool);
+  vtkGetMacro(DoseThresholdOnReferenceOnly, bool);
+  vtkBooleanMacro(DoseThresholdOnReferenceOnly, bool);
+
+  /// Enable/disable coarse-to-fine computation
+  vtkSetMacro(MultiResolution, bool);
+  vtkGetMacro(MultiResolution, bool);
+  vtkBooleanMacro(MultiResolution, bool);
+
+  /// Downsampling factor of the coarse lattice along each axis in multi-resolution mode
+  vtkSetClampMacro(DownsamplingFactor, int, 2, 8);
+  vtkGetMacro(DownsamplingFactor, int);
+
+  /// Maximum difference of the estimated gamma values from the exact ones in multi-resolution mode. Zero gives the
+  /// same gamma image as the full computation (only the pass/fail classification of the voxels is sped up)
+  vtkSetClampMacro(GammaEstimateTolerance, double, 0.0, VTK_DOUBLE_MAX);
+  vtkGetMacro(GammaEstimateTolerance, double);
+
+  /// Number of search steps per voxel along each axis when computing unclassified voxels in multi-resolution mode.
+  /// The default 1 gives the same result as the full computation for these voxels
+  vtkSetClampMacro(RefinementSubdivisions, int, 1, 4);
+  vtkGetMacro(RefinementSubdivisions, int);
+
+  /// Number of threads used for the computation. By default the number of processors is used
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_MAX_THREADS);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Get fraction of analyzed voxels with gamma not greater than 1
+  double GetPassFraction();
+  /// Get number of analyzed voxels
+  vtkGetMacro(NumberOfAnalyzedVoxels, vtkIdType);
+  /// Get number of analyzed voxels with gamma not greater than 1
+  vtkGetMacro(NumberOfPassingVoxels, vtkIdType);
+  /// Get number of voxels whose gamma is computed (not estimated) in multi-resolution mode
+  vtkGetMacro(NumberOfRefinedVoxels, vtkIdType);
+  /// Get reference dose actually used in the last computation (prescription or maximum dose)
+  vtkGetMacro(UsedReferenceDose, double);
+
+  /// Get human readable report of the last computation
+  std::string GetReportString();
+
+  /// Compute gamma image and statistics
+  /// \return Success flag
+  bool Update();
+
+  /// Process a slab of the reference lattice (K index range, inclusive). Called from the worker threads
+  void ThreadedComputeGamma(int kStart, int kEnd, int threadId);
+
+protected:
+  /// Build table of search offsets sorted by distance, with the given number of search steps per voxel
+  void BuildSearchOffsetTable(int subdivisions, std::vector<GammaSearchOffset>& searchOffsets);
+
+  /// Compute gamma on the downsampled lattice for multi-resolution mode
+  /// \return Success flag
+  bool ComputeCoarseGamma();
+
+  /// Compute conservative lower and upper bounds of gamma for each block of the downsampled lattice
+  void ComputeBlockGammaBounds();
+
+protected:
+  vtkGammaDoseComparison();
+  virtual ~vtkGammaDoseComparison();
+
+protected:
+  /// Reference dose image
+  vtkImageData* ReferenceDoseImageData;
+  /// Compare dose image
+  vtkImageData* CompareDoseImageData;
+  /// Mask image
+  vtkImageData* MaskImageData;
+  /// Output gamma image
+  vtkImageData* OutputGammaImageData;
+
+  /// Voxel spacing
+  double Spacing[3];
+  /// DTA tolerance
+  double DtaDistanceToleranceMm;
+  /// Dose difference tolerance
+  double DoseDifferenceTolerance;
+  /// Reference dose set by the user
+  double ReferenceDose;
+  /// Analysis threshold
+  double AnalysisThreshold;
+  /// Maximum gamma
+  double MaximumGamma;
+  /// Local dose difference flag
+  bool LocalDoseDifference;
+  /// Threshold on reference only flag
+  bool DoseThresholdOnReferenceOnly;
+  /// Multi-resolution flag
+  bool MultiResolution;
+  /// Downsampling factor of the coarse lattice
+  int DownsamplingFactor;
+  /// Maximum error of estimated gamma values
+  double GammaEstimateTolerance;
+  /// Search steps per voxel for refinement
+  int RefinementSubdivisions;
+  /// Number of threads
+  int NumberOfThreads;
+
+  /// Reference dose used in the last computation
+  double UsedReferenceDose;
+  /// Number of analyzed voxels in the last computation
+  vtkIdType NumberOfAnalyzedVoxels;
+  /// Number of passing voxels in the last computation
+  vtkIdType NumberOfPassingVoxels;
+  /// Number of refined voxels in the last computation
+  vtkIdType NumberOfRefinedVoxels;
+
+  /// Search offsets sorted by increasing distance
+  std::vector<GammaSearchOffset> SearchOffsets;
+  /// Sub-voxel search offsets sorted by increasing distance for refinement
+  std::vector<GammaSearchOffset> RefinementSearchOffsets;
+  /// Gamma on the downsampled lattice in multi-resolution mode
+  vtkImageData* CoarseGammaImageData;
+  /// Lower bound of gamma for each block in multi-resolution mode
+  std::vector<float> BlockGammaLowerBounds;
+  /// Upper bound of gamma for each block in multi-resolution mode
+  std::vector<float> BlockGammaUpperBounds;
+  /// Number of analyzed voxels per thread
+  vtkIdType ThreadAnalyzedVoxels[VTK_MAX_THREADS];
+  /// Number of passing voxels per thread
+  vtkIdType ThreadPassingVoxels[VTK_MAX_THREADS];
+  /// Number of refined voxels per thread
+  vtkIdType ThreadRefinedVoxels[VTK_MAX_THREADS];
+
+  /// Multithreader executing the slabs
+  vtkMultiThreader* Threader;
+
+private:
+  vtkGammaDoseComparison(const vtkGammaDoseComparison&); // Not implemented
+  void operator=(const vtkGammaDoseComparison&);         // Not implemented
+};
+
+#endif
@@ -58,6 +58,8 @@ vtkMRMLDoseComparisonNode::vtkMRMLDoseComparisonNode()
   this->ResultsValid = false;
   this->ReportString = NULL;
   this->LocalDoseDifference = false;
+  this->UseNativeGammaEngine = false;
+  this->UseMultiResolutionGamma = false;
 
   this->HideFromEditors = false;
 }
@@ -86,6 +88,8 @@ void vtkMRMLDoseComparisonNode::WriteXML(ostream& of, int nIndent)
   of << indent << " UseLinearInterpolation=\"" << (this->UseLinearInterpolation ? "true" : "false") << "\"";
   of << indent << " LocalDoseDifference=\"" << (this->LocalDoseDifference ? "true" : "false") << "\"";
   of << indent << " DoseThresholdOnReferenceOnly=\"" << (this->DoseThresholdOnReferenceOnly ? "true" : "false") << "\"";
+  of << indent << " UseNativeGammaEngine=\"" << (this->UseNativeGammaEngine ? "true" : "false") << "\"";
+  of << indent << " UseMultiResolutionGamma=\"" << (this->UseMultiResolutionGamma ? "true" : "false") << "\"";
   of << indent << " PassFractionPercent=\"" << this->PassFractionPercent << "\"";
   of << indent << " ResultsValid=\"" << (this->ResultsValid ? "true" : "false") << "\"";
   of << indent << " ReportString=\"" << (this->ReportString ? this->ReportString : "") << "\"";
@@ -145,6 +149,14 @@ void vtkMRMLDoseComparisonNode::ReadXMLAttributes(const char** atts)
       {
       this->DoseThresholdOnReferenceOnly = (strcmp(attValue,"true") ? false : true);
       }
+    else if (!strcmp(attName, "UseNativeGammaEngine")) 
+      {
+      this->UseNativeGammaEngine = (strcmp(attValue,"true") ? false : true);
+      }
+    else if (!strcmp(attName, "UseMultiResolutionGamma")) 
+      {
+      this->UseMultiResolutionGamma = (strcmp(attValue,"true") ? false : true);
+      }
     else if (!strcmp(attName, "PassFractionPercent")) 
       {
       this->PassFractionPercent = vtkVariant(attValue).ToDouble();
@@ -179,6 +191,8 @@ void vtkMRMLDoseComparisonNode::Copy(vtkMRMLNode *anode)
   this->UseLinearInterpolation = node->UseLinearInterpolation;
   this->LocalDoseDifference = node->LocalDoseDifference;
   this->DoseThresholdOnReferenceOnly = node->DoseThresholdOnReferenceOnly;
+  this->UseNativeGammaEngine = node->UseNativeGammaEngine;
+  this->UseMultiResolutionGamma = node->UseMultiResolutionGamma;
   this->ResultsValid = node->ResultsValid;
   this->ReportString = node->ReportString;
 
@@ -201,6 +215,8 @@ void vtkMRMLDoseComparisonNode::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "UseLinearInterpolation:   " << (this->UseLinearInterpolation ? "true" : "false") << "\n";
   os << indent << "LocalDoseDifference:   " << (this->LocalDoseDifference ? "true" : "false") << "\n";
   os << indent << "DoseThresholdOnReferenceOnly:   " << (this->DoseThresholdOnReferenceOnly ? "true" : "false") << "\n";
+  os << indent << "UseNativeGammaEngine:   " << (this->UseNativeGammaEngine ? "true" : "false") << "\n";
+  os << indent << "UseMultiResolutionGamma:   " << (this->UseMultiResolutionGamma ? "true" : "false") << "\n";
   os << indent << "PassFractionPercent:   " << this->PassFractionPercent << "\n";
   os << indent << "ResultsValid:   " << (this->ResultsValid ? "true" : "false") << "\n";
   os << indent << "ReportString:   " << (this->ReportString ? this->ReportString : "") << "\n";
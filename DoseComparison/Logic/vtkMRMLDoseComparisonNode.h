@@ -136,6 +136,21 @@ public:
   /// Set local dose difference flag
   vtkBooleanMacro(LocalDoseDifference, bool);
 
+  /// Get use native gamma engine flag. Off by default (plastimatch is used), and scenes saved without
+  /// the flag keep using plastimatch
+  vtkGetMacro(UseNativeGammaEngine, bool);
+  /// Set use native gamma engine flag
+  vtkSetMacro(UseNativeGammaEngine, bool);
+  /// Set use native gamma engine flag
+  vtkBooleanMacro(UseNativeGammaEngine, bool);
+
+  /// Get coarse-to-fine gamma flag
+  vtkGetMacro(UseMultiResolutionGamma, bool);
+  /// Set coarse-to-fine gamma flag
+  vtkSetMacro(UseMultiResolutionGamma, bool);
+  /// Set coarse-to-fine gamma flag
+  vtkBooleanMacro(UseMultiResolutionGamma, bool);
+
   /// Get valid flag
   vtkGetMacro(ResultsValid, bool);
   /// Set valid flag
@@ -197,6 +212,14 @@ protected:
   /// Flag determining whether dose thresholding should be performed using only the reference image
   /// Default value is false, meaning that both images will be used
   bool DoseThresholdOnReferenceOnly;
+
+  /// Flag determining whether the native multithreaded gamma engine (\sa vtkGammaDoseComparison) is used.
+  /// Plastimatch's gamma implementation is used if false. Default value is true.
+  bool UseNativeGammaEngine;
+
+  /// Flag determining whether gamma is computed coarse-to-fine: only the voxels that are ambiguous on a downsampled
+  /// lattice are computed at full resolution. Only supported by the native gamma engine. Default value is false.
+  bool UseMultiResolutionGamma;
   
   /// Percentage of voxels that passed (output)
   double PassFractionPercent;
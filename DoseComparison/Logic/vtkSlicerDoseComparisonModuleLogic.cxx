@@ -21,6 +21,7 @@
 // DoseComparison includes
 #include "vtkSlicerDoseComparisonModuleLogic.h"
 #include "vtkMRMLDoseComparisonNode.h"
+#include "vtkGammaDoseComparison.h"
 
 // SlicerRT includes
 #include "SlicerRtCommon.h"
@@ -52,6 +53,12 @@
 
 // VTK includes
 #include <vtkNew.h>
+#include <vtkCallbackCommand.h>
+#include <vtkGeneralTransform.h>
+#include <vtkImageCast.h>
+#include <vtkImageData.h>
+#include <vtkImageReslice.h>
+#include <vtkMatrix4x4.h>
 #include <vtkTimerLog.h>
 #include <vtkLookupTable.h>
 #include <vtkImageConstantPad.h>
@@ -78,6 +85,63 @@ void GammaProgressCallback(float progress)
   }
 }
 
+namespace
+{
+  //---------------------------------------------------------------------------
+  /// Forward progress of the native gamma engine to the logic
+  void GammaProgressEventCallback(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(eid), void* clientData, void* callData)
+  {
+    vtkSlicerDoseComparisonModuleLogic* logic = reinterpret_cast<vtkSlicerDoseComparisonModuleLogic*>(clientData);
+    double* progress = reinterpret_cast<double*>(callData);
+    if (logic && progress)
+    {
+      logic->GammaProgressUpdated(static_cast<float>(*progress));
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  /// Assemble transform from the IJK coordinate system of a reference volume to world
+  void GetIjkToWorldTransform(vtkMRMLScalarVolumeNode* volumeNode, vtkGeneralTransform* ijkToWorldTransform)
+  {
+    ijkToWorldTransform->PostMultiply();
+    vtkSmartPointer<vtkMatrix4x4> ijkToRasMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    volumeNode->GetIJKToRASMatrix(ijkToRasMatrix);
+    ijkToWorldTransform->Concatenate(ijkToRasMatrix);
+    if (volumeNode->GetParentTransformNode())
+    {
+      vtkSmartPointer<vtkGeneralTransform> rasToWorldTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+      volumeNode->GetParentTransformNode()->GetTransformToWorld(rasToWorldTransform);
+      ijkToWorldTransform->Concatenate(rasToWorldTransform);
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  /// Resample image (with unit spacing and zero origin, as in volume nodes) to the reference lattice
+  /// using the given transform from reference IJK to image IJK coordinates
+  void ResampleImageToReferenceLattice(vtkImageData* imageData, vtkAbstractTransform* referenceIjkToImageIjkTransform,
+    vtkImageData* referenceImageData, int outputScalarType, bool linearInterpolation, vtkImageData* outputImageData)
+  {
+    vtkSmartPointer<vtkImageReslice> reslice = vtkSmartPointer<vtkImageReslice>::New();
+    reslice->SetInputData(imageData);
+    reslice->SetResliceTransform(referenceIjkToImageIjkTransform);
+    reslice->SetOutputExtent(referenceImageData->GetExtent());
+    reslice->SetOutputOrigin(0.0, 0.0, 0.0);
+    reslice->SetOutputSpacing(1.0, 1.0, 1.0);
+    reslice->SetOutputScalarType(outputScalarType);
+    reslice->SetBackgroundLevel(0.0);
+    if (linearInterpolation)
+    {
+      reslice->SetInterpolationModeToLinear();
+    }
+    else
+    {
+      reslice->SetInterpolationModeToNearestNeighbor();
+    }
+    reslice->Update();
+    outputImageData->ShallowCopy(reslice->GetOutput());
+  }
+}
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerDoseComparisonModuleLogic);
 
@@ -196,91 +260,12 @@ std::string vtkSlicerDoseComparisonModuleLogic::ComputeGammaDoseDifference(vtkMR
 
   parameterNode->ResultsValidOff();
 
-  double checkpointConvertStart = timer->GetUniversalTime();
-  vtkMRMLScalarVolumeNode* referenceDoseVolumeNode = parameterNode->GetReferenceDoseVolumeNode();
-  Plm_image::Pointer referenceDose = PlmCommon::ConvertVolumeNodeToPlmImage(referenceDoseVolumeNode);
-  Plm_image::Pointer compareDose = PlmCommon::ConvertVolumeNodeToPlmImage(parameterNode->GetCompareDoseVolumeNode());
-
-  Plm_image::Pointer maskVolume;
-  vtkMRMLSegmentationNode* maskSegmentationNode = parameterNode->GetMaskSegmentationNode();
-  const char* maskSegmentID = parameterNode->GetMaskSegmentID();
-  if (maskSegmentationNode && maskSegmentID)
+  if (!parameterNode->GetReferenceDoseVolumeNode() || !parameterNode->GetCompareDoseVolumeNode())
   {
-    // Extract a labelmap for the dose comparison to use it as a mask
-    vtkSegmentation* maskSegmentation = maskSegmentationNode->GetSegmentation();
-    vtkSegment* maskSegment = maskSegmentation->GetSegment(maskSegmentID);
-    if (!maskSegment)
-    {
-      std::string errorMessage("Failed to get mask segment");
-      vtkErrorMacro("ComputeGammaDoseDifference: " << errorMessage);
-      return errorMessage;
-    }
-
-    // Temporarily duplicate selected segments to contain binary labelmap of a different geometry (tied to dose volume)
-    vtkSmartPointer<vtkSegmentation> segmentationCopy = vtkSmartPointer<vtkSegmentation>::New();
-    segmentationCopy->SetMasterRepresentationName(maskSegmentation->GetMasterRepresentationName());
-    segmentationCopy->CopyConversionParameters(maskSegmentation);
-    segmentationCopy->CopySegmentFromSegmentation(maskSegmentation, maskSegmentID);
-    if (!segmentationCopy->CreateRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()))
-    {
-      std::string errorMessage("Failed to create binary labelmap representation for mask segment");
-      vtkErrorMacro("ComputeGammaDoseDifference: " << errorMessage);
-      return errorMessage;
-    }
-    // Get segment binary labelmap
-    vtkOrientedImageData* maskSegmentLabelmap = vtkOrientedImageData::SafeDownCast( segmentationCopy->GetSegment(maskSegmentID)->GetRepresentation(
-      vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName() ) );
-
-    // Apply parent transformation nodes if necessary
-    if ( maskSegmentationNode->GetParentTransformNode()
-      && (!vtkSlicerSegmentationsModuleLogic::ApplyParentTransformToOrientedImageData(maskSegmentationNode, maskSegmentLabelmap)) )
-    {
-      std::string errorMessage("Failed to apply parent transform on mask segment");
-      vtkErrorMacro("ComputeGammaDoseDifference: " << errorMessage);
-      return errorMessage;
-    }
-
-    // Convert mask to Plm image
-    maskVolume = PlmCommon::ConvertVtkOrientedImageDataToPlmImage(maskSegmentLabelmap);
-    if (!maskVolume)
-    {
-      std::string errorMessage("Failed to convert mask segment labelmap into Plm_image");
-      vtkErrorMacro("ComputeGammaDoseDifference: " << errorMessage);
-      return errorMessage;
-    }
-  }
-
-  // Compute gamma dose volume
-  double checkpointGammaStart = timer->GetUniversalTime();
-  Gamma_dose_comparison gamma;
-  gamma.set_reference_image(referenceDose->itk_float());
-  gamma.set_compare_image(compareDose->itk_float());
-  if (maskSegmentationNode && maskSegmentID)
-  {
-    gamma.set_mask_image(maskVolume->itk_uchar());
-  }
-  gamma.set_spatial_tolerance(parameterNode->GetDtaDistanceToleranceMm());
-  gamma.set_dose_difference_tolerance(parameterNode->GetDoseDifferenceTolerancePercent() / 100.0);
-  gamma.set_resample_nn(!parameterNode->GetUseLinearInterpolation());
-  gamma.set_local_gamma(parameterNode->GetLocalDoseDifference());
-  if (!parameterNode->GetUseMaximumDose())
-  {
-    gamma.set_reference_dose(parameterNode->GetReferenceDoseGy());
+    std::string errorMessage("Invalid input dose volume nodes in parameter set node");
+    vtkErrorMacro("ComputeGammaDoseDifference: " << errorMessage);
+    return errorMessage;
   }
-  gamma.set_analysis_threshold(parameterNode->GetAnalysisThresholdPercent() / 100.0 );
-  gamma.set_gamma_max(parameterNode->GetMaximumGamma());
-  gamma.set_ref_only_threshold(parameterNode->GetDoseThresholdOnReferenceOnly());
-  gamma.set_progress_callback(&GammaProgressCallback);
-
-  gamma.run();
-
-  itk::Image<float, 3>::Pointer gammaVolumeItk = gamma.get_gamma_image_itk();
-  parameterNode->SetPassFractionPercent( gamma.get_pass_fraction() * 100.0 );
-  parameterNode->SetReportString(gamma.get_report_string().c_str());
-
-  // Convert output to VTK
-  double checkpointVtkConvertStart = timer->GetUniversalTime();
-
   vtkMRMLScalarVolumeNode* gammaVolumeNode = parameterNode->GetGammaVolumeNode();
   if (gammaVolumeNode == NULL)
   {
@@ -289,7 +274,15 @@ std::string vtkSlicerDoseComparisonModuleLogic::ComputeGammaDoseDifference(vtkMR
     return errorMessage;
   }
 
-  SlicerRtCommon::ConvertItkImageToVolumeNode<float>(gammaVolumeItk, gammaVolumeNode, VTK_FLOAT);
+  // Compute gamma volume
+  std::string errorMessage = ( parameterNode->GetUseNativeGammaEngine()
+    ? this->ComputeGammaNative(parameterNode, gammaVolumeNode)
+    : this->ComputeGammaPlastimatch(parameterNode, gammaVolumeNode) );
+  if (!errorMessage.empty())
+  {
+    return errorMessage;
+  }
+
   gammaVolumeNode->SetAttribute(vtkSlicerDoseComparisonModuleLogic::DOSECOMPARISON_GAMMA_VOLUME_IDENTIFIER_ATTRIBUTE_NAME, "1");
 
   // Set default colormap to red
@@ -359,9 +352,247 @@ std::string vtkSlicerDoseComparisonModuleLogic::ComputeGammaDoseDifference(vtkMR
   if (this->LogSpeedMeasurements)
   {
     double checkpointEnd = timer->GetUniversalTime();
-    std::cout << "Total gamma computation time: " << checkpointEnd-checkpointStart << " s" << std::endl
-              << "\tApplying transforms: " << checkpointConvertStart-checkpointStart << " s" << std::endl
-              << "\tConverting from VTK to ITK: " << checkpointGammaStart-checkpointConvertStart << " s" << std::endl
+    std::cout << "Total gamma computation time: " << checkpointEnd-checkpointStart << " s" << std::endl;
+  }
+
+  return "";
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerDoseComparisonModuleLogic::GetMaskSegmentLabelmap(vtkMRMLDoseComparisonNode* parameterNode, vtkOrientedImageData* maskLabelmap)
+{
+  vtkMRMLSegmentationNode* maskSegmentationNode = parameterNode->GetMaskSegmentationNode();
+  const char* maskSegmentID = parameterNode->GetMaskSegmentID();
+  if (!maskSegmentationNode || !maskSegmentID || !maskLabelmap)
+  {
+    std::string errorMessage("Invalid mask segment selection");
+    vtkErrorMacro("GetMaskSegmentLabelmap: " << errorMessage);
+    return errorMessage;
+  }
+
+  // Extract a labelmap for the dose comparison to use it as a mask
+  vtkSegmentation* maskSegmentation = maskSegmentationNode->GetSegmentation();
+  vtkSegment* maskSegment = maskSegmentation->GetSegment(maskSegmentID);
+  if (!maskSegment)
+  {
+    std::string errorMessage("Failed to get mask segment");
+    vtkErrorMacro("GetMaskSegmentLabelmap: " << errorMessage);
+    return errorMessage;
+  }
+
+  // Temporarily duplicate selected segments to contain binary labelmap of a different geometry (tied to dose volume)
+  vtkSmartPointer<vtkSegmentation> segmentationCopy = vtkSmartPointer<vtkSegmentation>::New();
+  segmentationCopy->SetMasterRepresentationName(maskSegmentation->GetMasterRepresentationName());
+  segmentationCopy->CopyConversionParameters(maskSegmentation);
+  segmentationCopy->CopySegmentFromSegmentation(maskSegmentation, maskSegmentID);
+  if (!segmentationCopy->CreateRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()))
+  {
+    std::string errorMessage("Failed to create binary labelmap representation for mask segment");
+    vtkErrorMacro("GetMaskSegmentLabelmap: " << errorMessage);
+    return errorMessage;
+  }
+  // Get segment binary labelmap
+  maskLabelmap->DeepCopy( vtkOrientedImageData::SafeDownCast( segmentationCopy->GetSegment(maskSegmentID)->GetRepresentation(
+    vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName() ) ) );
+
+  // Apply parent transformation nodes if necessary
+  if ( maskSegmentationNode->GetParentTransformNode()
+    && (!vtkSlicerSegmentationsModuleLogic::ApplyParentTransformToOrientedImageData(maskSegmentationNode, maskLabelmap)) )
+  {
+    std::string errorMessage("Failed to apply parent transform on mask segment");
+    vtkErrorMacro("GetMaskSegmentLabelmap: " << errorMessage);
+    return errorMessage;
+  }
+
+  return "";
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerDoseComparisonModuleLogic::ComputeGammaNative(vtkMRMLDoseComparisonNode* parameterNode, vtkMRMLScalarVolumeNode* gammaVolumeNode)
+{
+  vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
+  double checkpointResampleStart = timer->GetUniversalTime();
+
+  vtkMRMLScalarVolumeNode* referenceDoseVolumeNode = parameterNode->GetReferenceDoseVolumeNode();
+  vtkMRMLScalarVolumeNode* compareDoseVolumeNode = parameterNode->GetCompareDoseVolumeNode();
+  if (!referenceDoseVolumeNode->GetImageData() || !compareDoseVolumeNode->GetImageData())
+  {
+    std::string errorMessage("Input dose volumes contain no image data");
+    vtkErrorMacro("ComputeGammaNative: " << errorMessage);
+    return errorMessage;
+  }
+
+  // Reference dose in float type
+  vtkSmartPointer<vtkImageData> referenceDoseImageData = referenceDoseVolumeNode->GetImageData();
+  if (referenceDoseImageData->GetScalarType() != VTK_FLOAT)
+  {
+    vtkSmartPointer<vtkImageCast> castFilter = vtkSmartPointer<vtkImageCast>::New();
+    castFilter->SetInputData(referenceDoseImageData);
+    castFilter->SetOutputScalarTypeToFloat();
+    castFilter->Update();
+    referenceDoseImageData = castFilter->GetOutput();
+  }
+
+  // Resample compare dose to the reference lattice
+  vtkSmartPointer<vtkGeneralTransform> referenceIjkToCompareIjkTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+  GetIjkToWorldTransform(referenceDoseVolumeNode, referenceIjkToCompareIjkTransform);
+  if (compareDoseVolumeNode->GetParentTransformNode())
+  {
+    vtkSmartPointer<vtkGeneralTransform> worldToCompareRasTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+    compareDoseVolumeNode->GetParentTransformNode()->GetTransformFromWorld(worldToCompareRasTransform);
+    referenceIjkToCompareIjkTransform->Concatenate(worldToCompareRasTransform);
+  }
+  vtkSmartPointer<vtkMatrix4x4> compareRasToIjkMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  compareDoseVolumeNode->GetRASToIJKMatrix(compareRasToIjkMatrix);
+  referenceIjkToCompareIjkTransform->Concatenate(compareRasToIjkMatrix);
+
+  vtkSmartPointer<vtkImageData> compareDoseImageData = vtkSmartPointer<vtkImageData>::New();
+  ResampleImageToReferenceLattice( compareDoseVolumeNode->GetImageData(), referenceIjkToCompareIjkTransform,
+    referenceDoseImageData, VTK_FLOAT, parameterNode->GetUseLinearInterpolation(), compareDoseImageData );
+
+  // Resample mask to the reference lattice
+  vtkSmartPointer<vtkImageData> maskImageData;
+  if (parameterNode->GetMaskSegmentationNode() && parameterNode->GetMaskSegmentID())
+  {
+    vtkSmartPointer<vtkOrientedImageData> maskLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+    std::string errorMessage = this->GetMaskSegmentLabelmap(parameterNode, maskLabelmap);
+    if (!errorMessage.empty())
+    {
+      return errorMessage;
+    }
+
+    vtkSmartPointer<vtkGeneralTransform> referenceIjkToMaskIjkTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+    GetIjkToWorldTransform(referenceDoseVolumeNode, referenceIjkToMaskIjkTransform);
+    vtkSmartPointer<vtkMatrix4x4> worldToMaskIjkMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    maskLabelmap->GetImageToWorldMatrix(worldToMaskIjkMatrix);
+    worldToMaskIjkMatrix->Invert();
+    referenceIjkToMaskIjkTransform->Concatenate(worldToMaskIjkMatrix);
+
+    // Index the labelmap voxels directly, the geometry is contained in the transform
+    vtkSmartPointer<vtkImageData> maskIjkImageData = vtkSmartPointer<vtkImageData>::New();
+    maskIjkImageData->ShallowCopy(maskLabelmap);
+    maskIjkImageData->SetOrigin(0.0, 0.0, 0.0);
+    maskIjkImageData->SetSpacing(1.0, 1.0, 1.0);
+
+    maskImageData = vtkSmartPointer<vtkImageData>::New();
+    ResampleImageToReferenceLattice( maskIjkImageData, referenceIjkToMaskIjkTransform,
+      referenceDoseImageData, VTK_UNSIGNED_CHAR, false, maskImageData );
+  }
+
+  // Compute gamma
+  double checkpointGammaStart = timer->GetUniversalTime();
+  vtkSmartPointer<vtkGammaDoseComparison> gamma = vtkSmartPointer<vtkGammaDoseComparison>::New();
+  gamma->SetReferenceDoseImageData(referenceDoseImageData);
+  gamma->SetCompareDoseImageData(compareDoseImageData);
+  gamma->SetMaskImageData(maskImageData);
+  gamma->SetSpacing(referenceDoseVolumeNode->GetSpacing());
+  gamma->SetDtaDistanceToleranceMm(parameterNode->GetDtaDistanceToleranceMm());
+  gamma->SetDoseDifferenceTolerance(parameterNode->GetDoseDifferenceTolerancePercent() / 100.0);
+  gamma->SetLocalDoseDifference(parameterNode->GetLocalDoseDifference());
+  gamma->SetReferenceDose(parameterNode->GetUseMaximumDose() ? 0.0 : parameterNode->GetReferenceDoseGy());
+  gamma->SetAnalysisThreshold(parameterNode->GetAnalysisThresholdPercent() / 100.0);
+  gamma->SetMaximumGamma(parameterNode->GetMaximumGamma());
+  gamma->SetDoseThresholdOnReferenceOnly(parameterNode->GetDoseThresholdOnReferenceOnly());
+  gamma->SetMultiResolution(parameterNode->GetUseMultiResolutionGamma());
+
+  vtkSmartPointer<vtkCallbackCommand> progressCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+  progressCallback->SetCallback(GammaProgressEventCallback);
+  progressCallback->SetClientData(this);
+  gamma->AddObserver(vtkCommand::ProgressEvent, progressCallback);
+
+  if (!gamma->Update())
+  {
+    std::string errorMessage("Failed to compute gamma");
+    vtkErrorMacro("ComputeGammaNative: " << errorMessage);
+    return errorMessage;
+  }
+
+  parameterNode->SetPassFractionPercent( gamma->GetPassFraction() * 100.0 );
+  parameterNode->SetReportString(gamma->GetReportString().c_str());
+
+  // Gamma volume is on the reference lattice
+  gammaVolumeNode->SetAndObserveImageData(gamma->GetOutputGammaImageData());
+  gammaVolumeNode->CopyOrientation(referenceDoseVolumeNode);
+  gammaVolumeNode->SetAndObserveTransformNodeID(referenceDoseVolumeNode->GetTransformNodeID());
+
+  if (this->LogSpeedMeasurements)
+  {
+    double checkpointEnd = timer->GetUniversalTime();
+    std::cout << "\tResampling to reference lattice: " << checkpointGammaStart-checkpointResampleStart << " s" << std::endl
+              << "\tGamma computation: " << checkpointEnd-checkpointGammaStart << " s" << std::endl;
+  }
+
+  return "";
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerDoseComparisonModuleLogic::ComputeGammaPlastimatch(vtkMRMLDoseComparisonNode* parameterNode, vtkMRMLScalarVolumeNode* gammaVolumeNode)
+{
+  vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
+  double checkpointConvertStart = timer->GetUniversalTime();
+  vtkMRMLScalarVolumeNode* referenceDoseVolumeNode = parameterNode->GetReferenceDoseVolumeNode();
+  // Gamma computation only reads the dose images, so the voxels of the volumes can be shared
+  Plm_image::Pointer referenceDose = PlmCommon::ConvertVolumeNodeToPlmImage(referenceDoseVolumeNode, true, true);
+  Plm_image::Pointer compareDose = PlmCommon::ConvertVolumeNodeToPlmImage(parameterNode->GetCompareDoseVolumeNode(), true, true);
+
+  Plm_image::Pointer maskVolume;
+  vtkMRMLSegmentationNode* maskSegmentationNode = parameterNode->GetMaskSegmentationNode();
+  const char* maskSegmentID = parameterNode->GetMaskSegmentID();
+  if (maskSegmentationNode && maskSegmentID)
+  {
+    vtkSmartPointer<vtkOrientedImageData> maskSegmentLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+    std::string errorMessage = this->GetMaskSegmentLabelmap(parameterNode, maskSegmentLabelmap);
+    if (!errorMessage.empty())
+    {
+      return errorMessage;
+    }
+
+    // Convert mask to Plm image
+    maskVolume = PlmCommon::ConvertVtkOrientedImageDataToPlmImage(maskSegmentLabelmap);
+    if (!maskVolume)
+    {
+      std::string errorMessage("Failed to convert mask segment labelmap into Plm_image");
+      vtkErrorMacro("ComputeGammaPlastimatch: " << errorMessage);
+      return errorMessage;
+    }
+  }
+
+  // Compute gamma dose volume
+  double checkpointGammaStart = timer->GetUniversalTime();
+  Gamma_dose_comparison gamma;
+  gamma.set_reference_image(referenceDose->itk_float());
+  gamma.set_compare_image(compareDose->itk_float());
+  if (maskSegmentationNode && maskSegmentID)
+  {
+    gamma.set_mask_image(maskVolume->itk_uchar());
+  }
+  gamma.set_spatial_tolerance(parameterNode->GetDtaDistanceToleranceMm());
+  gamma.set_dose_difference_tolerance(parameterNode->GetDoseDifferenceTolerancePercent() / 100.0);
+  gamma.set_resample_nn(!parameterNode->GetUseLinearInterpolation());
+  gamma.set_local_gamma(parameterNode->GetLocalDoseDifference());
+  if (!parameterNode->GetUseMaximumDose())
+  {
+    gamma.set_reference_dose(parameterNode->GetReferenceDoseGy());
+  }
+  gamma.set_analysis_threshold(parameterNode->GetAnalysisThresholdPercent() / 100.0 );
+  gamma.set_gamma_max(parameterNode->GetMaximumGamma());
+  gamma.set_ref_only_threshold(parameterNode->GetDoseThresholdOnReferenceOnly());
+  gamma.set_progress_callback(&GammaProgressCallback);
+
+  gamma.run();
+
+  itk::Image<float, 3>::Pointer gammaVolumeItk = gamma.get_gamma_image_itk();
+  parameterNode->SetPassFractionPercent( gamma.get_pass_fraction() * 100.0 );
+  parameterNode->SetReportString(gamma.get_report_string().c_str());
+
+  // Convert output to VTK
+  double checkpointVtkConvertStart = timer->GetUniversalTime();
+  SlicerRtCommon::ConvertItkImageToVolumeNode<float>(gammaVolumeItk, gammaVolumeNode, VTK_FLOAT);
+
+  if (this->LogSpeedMeasurements)
+  {
+    double checkpointEnd = timer->GetUniversalTime();
+    std::cout << "\tConverting from VTK to ITK: " << checkpointGammaStart-checkpointConvertStart << " s" << std::endl
               << "\tGamma computation: " << checkpointVtkConvertStart-checkpointGammaStart << " s" << std::endl
               << "\tConverting back from ITK to VTK: " << checkpointEnd-checkpointVtkConvertStart << " s" << std::endl;
   }
@@ -33,6 +33,8 @@
 #include "vtkSlicerDoseComparisonModuleLogicExport.h"
 
 class vtkMRMLDoseComparisonNode;
+class vtkMRMLScalarVolumeNode;
+class vtkOrientedImageData;
 
 /// \ingroup SlicerRt_QtModules_DoseComparison
 class VTK_SLICER_DOSECOMPARISON_LOGIC_EXPORT vtkSlicerDoseComparisonModuleLogic :
@@ -59,6 +61,19 @@ public:
   void GammaProgressUpdated(float progress);
 
 protected:
+  /// Compute gamma volume with the native multithreaded gamma engine (\sa vtkGammaDoseComparison).
+  /// The compare dose and the mask are resampled to the reference dose lattice directly on the VTK image buffers
+  /// \return Error message, empty string if no error
+  std::string ComputeGammaNative(vtkMRMLDoseComparisonNode* parameterNode, vtkMRMLScalarVolumeNode* gammaVolumeNode);
+
+  /// Compute gamma volume using plastimatch
+  /// \return Error message, empty string if no error
+  std::string ComputeGammaPlastimatch(vtkMRMLDoseComparisonNode* parameterNode, vtkMRMLScalarVolumeNode* gammaVolumeNode);
+
+  /// Get binary labelmap of the mask segment selected in the parameter node (in world coordinate system)
+  /// \return Error message, empty string if no error
+  std::string GetMaskSegmentLabelmap(vtkMRMLDoseComparisonNode* parameterNode, vtkOrientedImageData* maskLabelmap);
+
   /// Creates default gamma color table.
   /// Should not be called, except when updating the default gamma color table file manually, or when the file cannot be found (\sa LoadDefaultGammaColorTable)
   void CreateDefaultGammaColorTable();
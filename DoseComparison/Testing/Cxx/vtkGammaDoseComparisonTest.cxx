@@ -0,0 +1,199 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+// DoseComparison includes
+#include "vtkGammaDoseComparison.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cmath>
+#include <vector>
+
+namespace
+{
+  static const int DOSE_DIMENSIONS[3] = {40, 40, 20};
+  static const double SPACING = 2.0;
+  static const double GAMMA_ESTIMATE_TOLERANCE = 0.1;
+  /// Rounding margin between the float voxel computation and the block bounds
+  static const double ROUNDING_TOLERANCE = 1.0e-3;
+  static const double HISTOGRAM_BIN_WIDTH = 0.1;
+
+  //----------------------------------------------------------------------------
+  /// Gaussian dose peak, centered in the image with the given shift along I and scaled
+  void CreateDoseImage(vtkImageData* imageData, double shiftI, double scale)
+  {
+    imageData->SetDimensions(DOSE_DIMENSIONS[0], DOSE_DIMENSIONS[1], DOSE_DIMENSIONS[2]);
+    imageData->SetSpacing(SPACING, SPACING, SPACING);
+    imageData->AllocateScalars(VTK_FLOAT, 1);
+    float* dosePtr = static_cast<float*>(imageData->GetScalarPointer());
+    double sigma = 6.0;
+    for (int k=0; k<DOSE_DIMENSIONS[2]; ++k)
+    {
+      for (int j=0; j<DOSE_DIMENSIONS[1]; ++j)
+      {
+        for (int i=0; i<DOSE_DIMENSIONS[0]; ++i)
+        {
+          double di = i - 0.5 * (DOSE_DIMENSIONS[0]-1) - shiftI;
+          double dj = j - 0.5 * (DOSE_DIMENSIONS[1]-1);
+          double dk = k - 0.5 * (DOSE_DIMENSIONS[2]-1);
+          *(dosePtr++) = static_cast<float>(scale * 10.0 * exp(-(di*di + dj*dj + dk*dk) / (2.0 * sigma * sigma)));
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Number of voxels with gamma not greater than each histogram bin edge
+  void ComputeCumulativeHistogram(vtkImageData* gammaImageData, double maximumGamma, std::vector<vtkIdType>& cumulativeHistogram)
+  {
+    int numberOfBins = static_cast<int>(ceil(maximumGamma / HISTOGRAM_BIN_WIDTH)) + 1;
+    cumulativeHistogram.assign(numberOfBins, 0);
+    const float* gammaPtr = static_cast<const float*>(gammaImageData->GetScalarPointer());
+    vtkIdType numberOfVoxels = gammaImageData->GetNumberOfPoints();
+    for (vtkIdType index=0; index<numberOfVoxels; ++index)
+    {
+      for (int bin=0; bin<numberOfBins; ++bin)
+      {
+        if (gammaPtr[index] <= bin * HISTOGRAM_BIN_WIDTH)
+        {
+          ++cumulativeHistogram[bin];
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkGammaDoseComparisonTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  // Compare dose is the reference dose shifted by half voxel and scaled by 3%, so both passing and failing voxels occur
+  vtkSmartPointer<vtkImageData> referenceDoseImageData = vtkSmartPointer<vtkImageData>::New();
+  CreateDoseImage(referenceDoseImageData, 0.0, 1.0);
+  vtkSmartPointer<vtkImageData> compareDoseImageData = vtkSmartPointer<vtkImageData>::New();
+  CreateDoseImage(compareDoseImageData, 0.5, 1.03);
+
+  vtkSmartPointer<vtkGammaDoseComparison> gamma = vtkSmartPointer<vtkGammaDoseComparison>::New();
+  gamma->SetReferenceDoseImageData(referenceDoseImageData);
+  gamma->SetCompareDoseImageData(compareDoseImageData);
+  gamma->SetSpacing(SPACING, SPACING, SPACING);
+  gamma->SetDtaDistanceToleranceMm(2.0);
+  gamma->SetDoseDifferenceTolerance(0.03);
+  gamma->SetAnalysisThreshold(0.0);
+  gamma->SetMaximumGamma(2.0);
+  gamma->SetNumberOfThreads(3);
+
+  // Full resolution
+  gamma->MultiResolutionOff();
+  if (!gamma->Update())
+  {
+    std::cerr << __LINE__ << ": Failed to compute gamma at full resolution" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkSmartPointer<vtkImageData> fullResolutionGammaImageData = vtkSmartPointer<vtkImageData>::New();
+  fullResolutionGammaImageData->DeepCopy(gamma->GetOutputGammaImageData());
+  vtkIdType fullResolutionPassingVoxels = gamma->GetNumberOfPassingVoxels();
+  if (fullResolutionPassingVoxels == 0 || fullResolutionPassingVoxels == gamma->GetNumberOfAnalyzedVoxels())
+  {
+    std::cerr << __LINE__ << ": Test doses are expected to have both passing and failing voxels" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::vector<vtkIdType> fullResolutionHistogram;
+  ComputeCumulativeHistogram(fullResolutionGammaImageData, gamma->GetMaximumGamma(), fullResolutionHistogram);
+
+  // Coarse-to-fine with zero tolerance reproduces the full resolution gamma image
+  gamma->MultiResolutionOn();
+  gamma->SetGammaEstimateTolerance(0.0);
+  if (!gamma->Update())
+  {
+    std::cerr << __LINE__ << ": Failed to compute gamma coarse-to-fine" << std::endl;
+    return EXIT_FAILURE;
+  }
+  const float* fullResolutionGammaPtr = static_cast<const float*>(fullResolutionGammaImageData->GetScalarPointer());
+  const float* gammaPtr = static_cast<const float*>(gamma->GetOutputGammaImageData()->GetScalarPointer());
+  vtkIdType numberOfVoxels = fullResolutionGammaImageData->GetNumberOfPoints();
+  for (vtkIdType index=0; index<numberOfVoxels; ++index)
+  {
+    if (gammaPtr[index] != fullResolutionGammaPtr[index])
+    {
+      std::cerr << __LINE__ << ": Coarse-to-fine gamma with zero tolerance is " << gammaPtr[index] << " at voxel " << index
+        << " instead of " << fullResolutionGammaPtr[index] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  if (gamma->GetNumberOfPassingVoxels() != fullResolutionPassingVoxels)
+  {
+    std::cerr << __LINE__ << ": Coarse-to-fine pass count with zero tolerance differs from the full resolution one" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Coarse-to-fine with estimated gamma values: the pass rate is exact, and the gamma image and histogram
+  // are within the tolerance of the full resolution ones
+  gamma->SetGammaEstimateTolerance(GAMMA_ESTIMATE_TOLERANCE);
+  if (!gamma->Update())
+  {
+    std::cerr << __LINE__ << ": Failed to compute gamma coarse-to-fine" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (gamma->GetNumberOfRefinedVoxels() >= gamma->GetNumberOfAnalyzedVoxels())
+  {
+    std::cerr << __LINE__ << ": No gamma value was estimated from the coarse gamma" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (gamma->GetNumberOfPassingVoxels() != fullResolutionPassingVoxels)
+  {
+    std::cerr << __LINE__ << ": Coarse-to-fine pass count " << gamma->GetNumberOfPassingVoxels()
+      << " differs from the full resolution one " << fullResolutionPassingVoxels << std::endl;
+    return EXIT_FAILURE;
+  }
+  gammaPtr = static_cast<const float*>(gamma->GetOutputGammaImageData()->GetScalarPointer());
+  for (vtkIdType index=0; index<numberOfVoxels; ++index)
+  {
+    if (fabs(gammaPtr[index] - fullResolutionGammaPtr[index]) > GAMMA_ESTIMATE_TOLERANCE + ROUNDING_TOLERANCE)
+    {
+      std::cerr << __LINE__ << ": Coarse-to-fine gamma is " << gammaPtr[index] << " at voxel " << index
+        << " instead of " << fullResolutionGammaPtr[index] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Shifting the values by at most the tolerance keeps the cumulative histogram between the full resolution
+  // histogram at the neighboring bin edges
+  std::vector<vtkIdType> histogram;
+  ComputeCumulativeHistogram(gamma->GetOutputGammaImageData(), gamma->GetMaximumGamma(), histogram);
+  int toleranceBins = static_cast<int>(ceil((GAMMA_ESTIMATE_TOLERANCE + ROUNDING_TOLERANCE) / HISTOGRAM_BIN_WIDTH));
+  int numberOfBins = static_cast<int>(histogram.size());
+  for (int bin=0; bin<numberOfBins; ++bin)
+  {
+    vtkIdType lowerCount = (bin >= toleranceBins ? fullResolutionHistogram[bin - toleranceBins] : 0);
+    vtkIdType upperCount = fullResolutionHistogram[std::min(bin + toleranceBins, numberOfBins - 1)];
+    if (histogram[bin] < lowerCount || histogram[bin] > upperCount)
+    {
+      std::cerr << __LINE__ << ": Coarse-to-fine gamma histogram has " << histogram[bin] << " voxels up to gamma "
+        << bin * HISTOGRAM_BIN_WIDTH << " (full resolution range: " << lowerCount << " - " << upperCount << ")" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::cout << "Gamma dose comparison test passed" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -40,6 +40,7 @@
 #include <vtkImageAccumulate.h>
 #include <vtkMatrix4x4.h>
 #include <vtkImageMathematics.h>
+#include <vtkPointData.h>
 
 // ITK includes
 #include "itkFactoryRegistration.h"
@@ -47,6 +48,10 @@
 // VTKSYS includes
 #include <vtksys/SystemTools.hxx>
 
+// STD includes
+#include <algorithm>
+#include <vector>
+
 //-----------------------------------------------------------------------------
 int vtkSlicerDoseComparisonModuleLogicTest1( int argc, char * argv[] )
 {
@@ -156,7 +161,8 @@ int vtkSlicerDoseComparisonModuleLogicTest1( int argc, char * argv[] )
   vtkSmartPointer<vtkSlicerDoseComparisonModuleLogic> doseComparisonLogic = vtkSmartPointer<vtkSlicerDoseComparisonModuleLogic>::New();
   doseComparisonLogic->SetMRMLScene(mrmlScene);
 
-  // Compute DoseAccumulation
+  // Compute gamma using plastimatch, which produced the baseline
+  paramNode->SetUseNativeGammaEngine(false);
   doseComparisonLogic->ComputeGammaDoseDifference(paramNode);
 
   // Get saved volume
@@ -187,5 +193,103 @@ int vtkSlicerDoseComparisonModuleLogicTest1( int argc, char * argv[] )
     return EXIT_FAILURE;
   }
 
+  // Compute gamma using the native engine. Agreement criterion with the plastimatch baseline: pass fraction within
+  // 0.1 percentage point, and gamma within 0.05 in all but 0.1% of the voxels (search pattern and rounding differ)
+  const double passFractionTolerancePercent = 0.1;
+  const double gammaTolerance = 0.05;
+  const double differingVoxelsTolerancePercent = 0.1;
+  double plastimatchPassFractionPercent = paramNode->GetPassFractionPercent();
+  paramNode->SetUseNativeGammaEngine(true);
+  doseComparisonLogic->ComputeGammaDoseDifference(paramNode);
+  if (!paramNode->GetResultsValid())
+  {
+    errorStream << "ERROR: Failed to compute gamma using the native engine!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  double passFractionDifferencePercent = fabs(paramNode->GetPassFractionPercent() - plastimatchPassFractionPercent);
+  if (passFractionDifferencePercent > passFractionTolerancePercent)
+  {
+    errorStream << "ERROR: Native gamma pass fraction (" << paramNode->GetPassFractionPercent()
+      << "%) differs from the plastimatch one (" << plastimatchPassFractionPercent << "%)!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkDataArray* nativeGammaArray = outputGammaVolumeNode->GetImageData()->GetPointData()->GetScalars();
+  vtkDataArray* baselineGammaArray = baselineGammaVolumeNode->GetImageData()->GetPointData()->GetScalars();
+  if (!nativeGammaArray || !baselineGammaArray || nativeGammaArray->GetNumberOfTuples() != baselineGammaArray->GetNumberOfTuples())
+  {
+    errorStream << "ERROR: Native gamma volume geometry does not match the baseline!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkIdType numberOfDifferingVoxels = 0;
+  for (vtkIdType index=0; index<nativeGammaArray->GetNumberOfTuples(); ++index)
+  {
+    if (fabs(nativeGammaArray->GetTuple1(index) - baselineGammaArray->GetTuple1(index)) > gammaTolerance)
+    {
+      ++numberOfDifferingVoxels;
+    }
+  }
+  double differingVoxelsPercent = 100.0 * numberOfDifferingVoxels / nativeGammaArray->GetNumberOfTuples();
+  outputStream << "Native gamma: pass fraction " << paramNode->GetPassFractionPercent() << "%, voxels differing from baseline: "
+    << differingVoxelsPercent << "%" << std::endl;
+  if (differingVoxelsPercent > differingVoxelsTolerancePercent)
+  {
+    errorStream << "ERROR: Native gamma volume differs from the baseline in " << differingVoxelsPercent << "% of the voxels!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Compute gamma coarse-to-fine. Voxels are only classified without search where the block bounds guarantee
+  // the outcome, so the pass/fail classification needs to be identical to the full resolution result
+  std::vector<float> fullResolutionGamma(nativeGammaArray->GetNumberOfTuples(), 0.0f);
+  for (vtkIdType index=0; index<nativeGammaArray->GetNumberOfTuples(); ++index)
+  {
+    fullResolutionGamma[index] = static_cast<float>(nativeGammaArray->GetTuple1(index));
+  }
+  double fullResolutionPassFractionPercent = paramNode->GetPassFractionPercent();
+  paramNode->SetUseMultiResolutionGamma(true);
+  doseComparisonLogic->ComputeGammaDoseDifference(paramNode);
+  if (!paramNode->GetResultsValid())
+  {
+    errorStream << "ERROR: Failed to compute gamma coarse-to-fine!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (fabs(paramNode->GetPassFractionPercent() - fullResolutionPassFractionPercent) > 1.0e-6)
+  {
+    errorStream << "ERROR: Coarse-to-fine gamma pass fraction (" << paramNode->GetPassFractionPercent()
+      << "%) differs from the full resolution one (" << fullResolutionPassFractionPercent << "%)!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkDataArray* multiResolutionGammaArray = outputGammaVolumeNode->GetImageData()->GetPointData()->GetScalars();
+  if (!multiResolutionGammaArray || multiResolutionGammaArray->GetNumberOfTuples() != static_cast<vtkIdType>(fullResolutionGamma.size()))
+  {
+    errorStream << "ERROR: Coarse-to-fine gamma volume geometry does not match the full resolution one!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  // Estimated gamma values differ from the full resolution ones by at most the gamma estimate tolerance (0.1 by default)
+  const double gammaEstimateTolerance = 0.1 + 1.0e-3;
+  vtkIdType numberOfMisclassifiedVoxels = 0;
+  for (vtkIdType index=0; index<multiResolutionGammaArray->GetNumberOfTuples(); ++index)
+  {
+    if ((multiResolutionGammaArray->GetTuple1(index) <= 1.0) != (fullResolutionGamma[index] <= 1.0f))
+    {
+      ++numberOfMisclassifiedVoxels;
+    }
+    if (fabs(multiResolutionGammaArray->GetTuple1(index) - fullResolutionGamma[index]) > gammaEstimateTolerance)
+    {
+      errorStream << "ERROR: Coarse-to-fine gamma (" << multiResolutionGammaArray->GetTuple1(index) << ") differs from the full resolution one ("
+        << fullResolutionGamma[index] << ") by more than the gamma estimate tolerance at voxel " << index << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  outputStream << "Coarse-to-fine gamma: pass fraction " << paramNode->GetPassFractionPercent()
+    << "%, misclassified voxels: " << numberOfMisclassifiedVoxels << std::endl;
+  if (numberOfMisclassifiedVoxels > 0)
+  {
+    errorStream << "ERROR: Coarse-to-fine gamma classifies " << numberOfMisclassifiedVoxels << " voxels differently from the full resolution one!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
   return EXIT_SUCCESS;
 }
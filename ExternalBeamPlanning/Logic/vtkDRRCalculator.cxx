@@ -0,0 +1,280 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkDRRCalculator.h"
+#include "vtkVoxelRayTraversal.h"
+
+// Segmentations includes
+#include "vtkOrientedImageData.h"
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkDRRCalculator);
+
+vtkCxxSetObjectMacro(vtkDRRCalculator, InputImageData, vtkOrientedImageData);
+vtkCxxSetObjectMacro(vtkDRRCalculator, AttenuationFunction, vtkPiecewiseFunction);
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /// Range of the HU values in the attenuation lookup table. Values outside are clamped
+  const double LOOKUP_TABLE_MINIMUM_VALUE = -2048.0;
+  const double LOOKUP_TABLE_MAXIMUM_VALUE = 16383.0;
+
+  //----------------------------------------------------------------------------
+  /// Transform a point with a 4x4 row-major affine matrix
+  void TransformPoint(const double matrix[16], const double point[3], double transformedPoint[3])
+  {
+    for (int row=0; row<3; ++row)
+    {
+      transformedPoint[row] = matrix[4*row] * point[0] + matrix[4*row+1] * point[1] + matrix[4*row+2] * point[2] + matrix[4*row+3];
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Sum the attenuation coefficients of the voxels intersected by the traced ray, weighted by the ray parameter
+  /// ranges of the intersections
+  template <class T> double IntegrateAttenuation(const T* voxelsPtr, vtkVoxelRayTraversal* traversal,
+    const double* lookupTable, int lookupTableMinimumValue, int lookupTableSize)
+  {
+    int numberOfVoxels = traversal->GetNumberOfIntersectedVoxels();
+    const vtkIdType* voxelIndices = traversal->GetVoxelIndices();
+    const double* boundaryParameters = traversal->GetBoundaryParameters();
+    double integral = 0.0;
+    for (int voxel=0; voxel<numberOfVoxels; ++voxel)
+    {
+      int entry = (int)floor((double)voxelsPtr[voxelIndices[voxel]] + 0.5) - lookupTableMinimumValue;
+      entry = std::min(std::max(entry, 0), lookupTableSize - 1);
+      integral += lookupTable[entry] * (boundaryParameters[voxel+1] - boundaryParameters[voxel]);
+    }
+    return integral;
+  }
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE TraceRowsThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    vtkDRRCalculator* self = static_cast<vtkDRRCalculator*>(threadInfo->UserData);
+
+    int numberOfRows = self->GetDetectorSize()[1];
+    int rowsPerThread = (numberOfRows + threadInfo->NumberOfThreads - 1) / threadInfo->NumberOfThreads;
+    int startRow = threadInfo->ThreadID * rowsPerThread;
+    int endRow = std::min(startRow + rowsPerThread, numberOfRows);
+    if (startRow < endRow)
+    {
+      self->ThreadedTraceRows(startRow, endRow);
+    }
+
+    return VTK_THREAD_RETURN_VALUE;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkDRRCalculator::vtkDRRCalculator()
+{
+  this->InputImageData = NULL;
+  this->OutputImageData = vtkOrientedImageData::New();
+  this->AttenuationFunction = NULL;
+  this->WaterAttenuationCoefficient = 0.02;
+
+  this->SourcePosition[0] = this->SourcePosition[1] = this->SourcePosition[2] = 0.0;
+  this->DetectorCenter[0] = this->DetectorCenter[1] = this->DetectorCenter[2] = 0.0;
+  this->DetectorColumnDirection[0] = 1.0;
+  this->DetectorColumnDirection[1] = this->DetectorColumnDirection[2] = 0.0;
+  this->DetectorRowDirection[0] = this->DetectorRowDirection[1] = 0.0;
+  this->DetectorRowDirection[2] = 1.0;
+  this->DetectorSize[0] = this->DetectorSize[1] = 256;
+  this->DetectorSpacing[0] = this->DetectorSpacing[1] = 1.0;
+
+  this->LookupTableMinimumValue = 0;
+  vtkMatrix4x4::Identity(this->WorldToVoxelMatrix);
+  vtkMatrix4x4::Identity(this->DetectorToWorldMatrix);
+
+  this->Threader = vtkMultiThreader::New();
+  this->NumberOfThreads = this->Threader->GetNumberOfThreads();
+}
+
+//----------------------------------------------------------------------------
+vtkDRRCalculator::~vtkDRRCalculator()
+{
+  this->SetInputImageData(NULL);
+  this->SetAttenuationFunction(NULL);
+  if (this->OutputImageData)
+  {
+    this->OutputImageData->Delete();
+    this->OutputImageData = NULL;
+  }
+  if (this->Threader)
+  {
+    this->Threader->Delete();
+    this->Threader = NULL;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkDRRCalculator::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "WaterAttenuationCoefficient: " << this->WaterAttenuationCoefficient << "\n";
+  os << indent << "SourcePosition: " << this->SourcePosition[0] << ", " << this->SourcePosition[1] << ", " << this->SourcePosition[2] << "\n";
+  os << indent << "DetectorCenter: " << this->DetectorCenter[0] << ", " << this->DetectorCenter[1] << ", " << this->DetectorCenter[2] << "\n";
+  os << indent << "DetectorColumnDirection: " << this->DetectorColumnDirection[0] << ", " << this->DetectorColumnDirection[1] << ", " << this->DetectorColumnDirection[2] << "\n";
+  os << indent << "DetectorRowDirection: " << this->DetectorRowDirection[0] << ", " << this->DetectorRowDirection[1] << ", " << this->DetectorRowDirection[2] << "\n";
+  os << indent << "DetectorSize: " << this->DetectorSize[0] << ", " << this->DetectorSize[1] << "\n";
+  os << indent << "DetectorSpacing: " << this->DetectorSpacing[0] << ", " << this->DetectorSpacing[1] << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+}
+
+//----------------------------------------------------------------------------
+bool vtkDRRCalculator::Update()
+{
+  if (!this->InputImageData || !this->InputImageData->GetPointData()->GetScalars())
+  {
+    vtkErrorMacro("Update: Invalid input image!");
+    return false;
+  }
+  if ( this->DetectorSize[0] < 1 || this->DetectorSize[1] < 1
+    || this->DetectorSpacing[0] <= 0.0 || this->DetectorSpacing[1] <= 0.0 )
+  {
+    vtkErrorMacro("Update: Invalid detector size or spacing!");
+    return false;
+  }
+  double columnDirection[3] = { this->DetectorColumnDirection[0], this->DetectorColumnDirection[1], this->DetectorColumnDirection[2] };
+  double rowDirection[3] = { this->DetectorRowDirection[0], this->DetectorRowDirection[1], this->DetectorRowDirection[2] };
+  if ( vtkMath::Normalize(columnDirection) == 0.0 || vtkMath::Normalize(rowDirection) == 0.0
+    || fabs(vtkMath::Dot(columnDirection, rowDirection)) > 1.0e-6 )
+  {
+    vtkErrorMacro("Update: Detector column and row directions need to be perpendicular!");
+    return false;
+  }
+
+  // RAS to continuous voxel coordinates, the first voxel of the extent being at the origin
+  vtkSmartPointer<vtkMatrix4x4> imageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  this->InputImageData->GetImageToWorldMatrix(imageToWorldMatrix);
+  vtkSmartPointer<vtkMatrix4x4> worldToImageMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkMatrix4x4::Invert(imageToWorldMatrix, worldToImageMatrix);
+  int extent[6] = {0,-1,0,-1,0,-1};
+  this->InputImageData->GetExtent(extent);
+  for (int axis=0; axis<3; ++axis)
+  {
+    worldToImageMatrix->SetElement(axis, 3, worldToImageMatrix->GetElement(axis, 3) - extent[2*axis]);
+  }
+  vtkMatrix4x4::DeepCopy(this->WorldToVoxelMatrix, worldToImageMatrix);
+
+  this->BuildAttenuationLookupTable();
+
+  // Output geometry: detector plane centered on the detector center
+  double detectorNormal[3] = {0.0, 0.0, 0.0};
+  vtkMath::Cross(columnDirection, rowDirection, detectorNormal);
+  vtkSmartPointer<vtkMatrix4x4> detectorToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  for (int axis=0; axis<3; ++axis)
+  {
+    detectorToWorldMatrix->SetElement(axis, 0, columnDirection[axis] * this->DetectorSpacing[0]);
+    detectorToWorldMatrix->SetElement(axis, 1, rowDirection[axis] * this->DetectorSpacing[1]);
+    detectorToWorldMatrix->SetElement(axis, 2, detectorNormal[axis]);
+    detectorToWorldMatrix->SetElement(axis, 3, this->DetectorCenter[axis]
+      - 0.5 * (this->DetectorSize[0] - 1) * this->DetectorSpacing[0] * columnDirection[axis]
+      - 0.5 * (this->DetectorSize[1] - 1) * this->DetectorSpacing[1] * rowDirection[axis]);
+  }
+  vtkMatrix4x4::DeepCopy(this->DetectorToWorldMatrix, detectorToWorldMatrix);
+  this->OutputImageData->SetExtent(0, this->DetectorSize[0] - 1, 0, this->DetectorSize[1] - 1, 0, 0);
+  this->OutputImageData->AllocateScalars(VTK_FLOAT, 1);
+  this->OutputImageData->SetGeometryFromImageToWorldMatrix(detectorToWorldMatrix);
+
+  this->Threader->SetNumberOfThreads(this->NumberOfThreads);
+  this->Threader->SetSingleMethod(TraceRowsThreadFunction, this);
+  this->Threader->SingleMethodExecute();
+
+  this->OutputImageData->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkDRRCalculator::BuildAttenuationLookupTable()
+{
+  double scalarRange[2] = {0.0, 0.0};
+  this->InputImageData->GetScalarRange(scalarRange);
+  int minimumValue = (int)floor(std::min(std::max(scalarRange[0], LOOKUP_TABLE_MINIMUM_VALUE), LOOKUP_TABLE_MAXIMUM_VALUE));
+  int maximumValue = (int)ceil(std::max(std::min(scalarRange[1], LOOKUP_TABLE_MAXIMUM_VALUE), (double)minimumValue));
+
+  this->LookupTableMinimumValue = minimumValue;
+  this->AttenuationLookupTable.resize(maximumValue - minimumValue + 1);
+  for (int value = minimumValue; value <= maximumValue; ++value)
+  {
+    double attenuation = ( this->AttenuationFunction ? this->AttenuationFunction->GetValue(value)
+      : this->WaterAttenuationCoefficient * (1.0 + value / 1000.0) );
+    this->AttenuationLookupTable[value - minimumValue] = std::max(attenuation, 0.0);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkDRRCalculator::ThreadedTraceRows(int startRow, int endRow)
+{
+  int dimensions[3] = {0, 0, 0};
+  this->InputImageData->GetDimensions(dimensions);
+  vtkSmartPointer<vtkVoxelRayTraversal> traversal = vtkSmartPointer<vtkVoxelRayTraversal>::New();
+  traversal->SetDimensions(dimensions);
+
+  double sourceVoxelPosition[3] = {0.0, 0.0, 0.0};
+  TransformPoint(this->WorldToVoxelMatrix, this->SourcePosition, sourceVoxelPosition);
+
+  int scalarType = this->InputImageData->GetScalarType();
+  void* inputPtr = this->InputImageData->GetScalarPointer();
+  float* outputPtr = static_cast<float*>(this->OutputImageData->GetScalarPointer());
+  const double* lookupTable = &(this->AttenuationLookupTable[0]);
+  int lookupTableSize = (int)this->AttenuationLookupTable.size();
+
+  for (int row = startRow; row < endRow; ++row)
+  {
+    for (int column = 0; column < this->DetectorSize[0]; ++column)
+    {
+      double pixelIndex[3] = { (double)column, (double)row, 0.0 };
+      double pixelPosition[3] = {0.0, 0.0, 0.0};
+      TransformPoint(this->DetectorToWorldMatrix, pixelIndex, pixelPosition);
+      double pixelVoxelPosition[3] = {0.0, 0.0, 0.0};
+      TransformPoint(this->WorldToVoxelMatrix, pixelPosition, pixelVoxelPosition);
+
+      // The ray parameters are fractions of the source to pixel distance
+      double integral = 0.0;
+      if (traversal->TraceRay(sourceVoxelPosition, pixelVoxelPosition) > 0)
+      {
+        switch (scalarType)
+        {
+          vtkTemplateMacro( integral = IntegrateAttenuation(static_cast<const VTK_TT*>(inputPtr), traversal.GetPointer(),
+            lookupTable, this->LookupTableMinimumValue, lookupTableSize) );
+        }
+      }
+      double rayLength = sqrt(vtkMath::Distance2BetweenPoints(this->SourcePosition, pixelPosition));
+      outputPtr[row * this->DetectorSize[0] + column] = (float)(integral * rayLength);
+    }
+  }
+}
@@ -0,0 +1,153 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#ifndef __vtkDRRCalculator_h
+#define __vtkDRRCalculator_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkMultiThreader.h>
+
+// STD includes
+#include <vector>
+
+#include "vtkSlicerExternalBeamPlanningModuleLogicExport.h"
+
+class vtkOrientedImageData;
+class vtkPiecewiseFunction;
+
+/// \ingroup SlicerRt_QtModules_ExternalBeamPlanning
+/// \class vtkDRRCalculator
+/// \brief Compute a digitally reconstructed radiograph (DRR) of a CT volume without rendering.
+///
+/// A divergent ray is traced from the source to the center of each detector pixel through the voxels of the CT
+/// (\sa vtkVoxelRayTraversal), and the pixel gets the line integral of the linear attenuation coefficients along it.
+/// The attenuation coefficients are looked up from a table built from the HU range of the CT before tracing.
+/// The detector rows are processed in parallel. No render window is needed, so it can be used in batch processing.
+class VTK_SLICER_EXTERNALBEAMPLANNING_MODULE_LOGIC_EXPORT vtkDRRCalculator : public vtkObject
+{
+public:
+  static vtkDRRCalculator *New();
+  vtkTypeMacro(vtkDRRCalculator, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Set input CT volume (single component, any scalar type, HU, geometry in RAS)
+  void SetInputImageData(vtkOrientedImageData* imageData);
+  vtkGetObjectMacro(InputImageData, vtkOrientedImageData);
+
+  /// Get output DRR image (float, one slice of DetectorSize pixels, geometry of the detector plane in RAS).
+  /// The pixels contain the line integral of the linear attenuation coefficients (unitless)
+  vtkGetObjectMacro(OutputImageData, vtkOrientedImageData);
+
+  /// Set function mapping HU to linear attenuation coefficient (1/mm). If not set, the attenuation of water
+  /// is scaled by the electron density estimated from HU: WaterAttenuationCoefficient * max(0, 1+HU/1000)
+  void SetAttenuationFunction(vtkPiecewiseFunction* function);
+  vtkGetObjectMacro(AttenuationFunction, vtkPiecewiseFunction);
+
+  /// Linear attenuation coefficient of water (1/mm) used if there is no attenuation function. Default is 0.02
+  vtkSetMacro(WaterAttenuationCoefficient, double);
+  vtkGetMacro(WaterAttenuationCoefficient, double);
+
+  /// Source position (RAS)
+  vtkSetVector3Macro(SourcePosition, double);
+  vtkGetVector3Macro(SourcePosition, double);
+
+  /// Center of the detector (RAS)
+  vtkSetVector3Macro(DetectorCenter, double);
+  vtkGetVector3Macro(DetectorCenter, double);
+
+  /// Direction of increasing column index on the detector (RAS unit vector)
+  vtkSetVector3Macro(DetectorColumnDirection, double);
+  vtkGetVector3Macro(DetectorColumnDirection, double);
+
+  /// Direction of increasing row index on the detector (RAS unit vector, perpendicular to the column direction)
+  vtkSetVector3Macro(DetectorRowDirection, double);
+  vtkGetVector3Macro(DetectorRowDirection, double);
+
+  /// Number of detector columns and rows
+  vtkSetVector2Macro(DetectorSize, int);
+  vtkGetVector2Macro(DetectorSize, int);
+
+  /// Detector pixel spacing along the columns and rows (mm)
+  vtkSetVector2Macro(DetectorSpacing, double);
+  vtkGetVector2Macro(DetectorSpacing, double);
+
+  /// Number of threads used for the computation. By default the number of processors is used
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_MAX_THREADS);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Compute the DRR image
+  /// \return Success flag
+  bool Update();
+
+  /// Trace the rays of a range of detector rows. Called from the worker threads
+  void ThreadedTraceRows(int startRow, int endRow);
+
+protected:
+  /// Build attenuation lookup table for the HU range of the input
+  void BuildAttenuationLookupTable();
+
+protected:
+  vtkDRRCalculator();
+  virtual ~vtkDRRCalculator();
+
+protected:
+  /// Input CT volume
+  vtkOrientedImageData* InputImageData;
+  /// Output DRR image
+  vtkOrientedImageData* OutputImageData;
+  /// Function mapping HU to linear attenuation coefficient
+  vtkPiecewiseFunction* AttenuationFunction;
+  /// Linear attenuation coefficient of water
+  double WaterAttenuationCoefficient;
+
+  /// Source position
+  double SourcePosition[3];
+  /// Center of the detector
+  double DetectorCenter[3];
+  /// Direction of the detector columns
+  double DetectorColumnDirection[3];
+  /// Direction of the detector rows
+  double DetectorRowDirection[3];
+  /// Number of detector columns and rows
+  int DetectorSize[2];
+  /// Detector pixel spacing
+  double DetectorSpacing[2];
+  /// Number of threads
+  int NumberOfThreads;
+
+  /// Linear attenuation coefficient for each HU value from LookupTableMinimumValue
+  std::vector<double> AttenuationLookupTable;
+  /// HU value of the first lookup table entry
+  int LookupTableMinimumValue;
+  /// RAS to continuous voxel coordinates of the input (4x4 row-major, voxel (0,0,0) is the first voxel of the extent)
+  double WorldToVoxelMatrix[16];
+  /// Detector pixel index to RAS (4x4 row-major), built in Update from the normalized detector directions
+  double DetectorToWorldMatrix[16];
+
+  /// Multithreader tracing the detector rows
+  vtkMultiThreader* Threader;
+
+private:
+  vtkDRRCalculator(const vtkDRRCalculator&); // Not implemented
+  void operator=(const vtkDRRCalculator&);   // Not implemented
+};
+
+#endif
@@ -25,6 +25,14 @@
 #include "vtkMRMLRTPlanNode.h"
 #include "vtkMRMLRTBeamNode.h"
 #include "vtkSlicerBeamsModuleLogic.h"
+#include "vtkSlicerIECTransformLogic.h"
+
+// ExternalBeamPlanning includes
+#include "vtkDRRCalculator.h"
+#include "vtkWEDCalculator.h"
+
+// SlicerRt includes
+#include "SlicerRtCommon.h"
 
 // CLI invocation
 #include <vtkSlicerCLIModuleLogic.h>
@@ -44,6 +52,8 @@
 #include <vtkSlicerSubjectHierarchyModuleLogic.h>
 
 // VTK includes
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
 #include <vtkNew.h>
 #include <vtkSmartPointer.h>
 //#include <vtkConeSource.h>
@@ -56,9 +66,9 @@
 //#include <vtkRenderWindow.h>
 //#include <vtkCamera.h>
 //#include <vtkColorTransferFunction.h>
-//#include <vtkImageData.h>
+#include <vtkImageData.h>
 //#include <vtkImageCast.h>
-//#include <vtkPiecewiseFunction.h>
+#include <vtkPiecewiseFunction.h>
 //#include <vtkProperty.h>
 //#include <vtkActor.h>
 //#include <vtkVolumeProperty.h>
@@ -69,13 +79,24 @@
 //#include <vtkWindowToImageFilter.h>
 //#include <vtkImageShiftScale.h>
 //#include <vtkImageExtractComponents.h>
-//#include <vtkTransform.h>
+#include <vtkTransform.h>
 //#include <vtkPolyDataMapper.h>
 //#include <vtkImageGradientMagnitude.h>
 //#include <vtkImageMathematics.h>
 
+// STD includes
+#include <map>
+#include <vector>
+
 //----------------------------------------------------------------------------
 vtkCxxSetObjectMacro(vtkSlicerExternalBeamPlanningModuleLogic, BeamsLogic, vtkSlicerBeamsModuleLogic);
+vtkCxxSetObjectMacro(vtkSlicerExternalBeamPlanningModuleLogic, WEDStoppingPowerRatioFunction, vtkPiecewiseFunction);
+
+//----------------------------------------------------------------------------
+/// Distance of the DRR detector plane from the source relative to the SAD
+static const double DRR_DETECTOR_DISTANCE_TO_SAD_RATIO = 1.5;
+/// DRR pixel spacing projected to the isocenter plane (mm)
+static const double DRR_PIXEL_SPACING_AT_ISOCENTER = 1.0;
 
 //----------------------------------------------------------------------------
 class vtkSlicerExternalBeamPlanningModuleLogic::vtkInternal
@@ -85,6 +106,23 @@ public:
 
   //TODO: Add Matlab dose engine plugin infrastructure
   vtkSlicerCLIModuleLogic* MatlabDoseCalculationModuleLogic;
+
+  /// Cached water equivalent depth volume of a beam
+  struct WEDCacheEntry
+  {
+    /// Source and isocenter positions, reference image to world matrix and extent, and ray spacing the WED was computed with
+    std::vector<double> ParameterSignature;
+    /// Modified time of the reference volume voxels the WED was computed from
+    vtkMTimeType ReferenceVoxelsMTime;
+    /// Stopping power ratio function the WED was computed with
+    vtkSmartPointer<vtkPiecewiseFunction> StoppingPowerRatioFunction;
+    /// Modified time of the stopping power ratio function when the WED was computed
+    vtkMTimeType StoppingPowerRatioFunctionMTime;
+    /// WED volume
+    vtkSmartPointer<vtkOrientedImageData> WEDImageData;
+  };
+  /// Cached WED volumes (beam node ID -> cache entry)
+  std::map<std::string, WEDCacheEntry> WEDCache;
 };
 
 //----------------------------------------------------------------------------
@@ -102,6 +140,9 @@ vtkSlicerExternalBeamPlanningModuleLogic::vtkSlicerExternalBeamPlanningModuleLog
   this->DRRImageSize[0] = 256;
   this->DRRImageSize[1] = 256;
 
+  this->WEDStoppingPowerRatioFunction = NULL;
+  this->WEDRaySpacing = 2.0;
+
   this->BeamsLogic = NULL;
 
   this->Internal = new vtkInternal;
@@ -111,6 +152,7 @@ vtkSlicerExternalBeamPlanningModuleLogic::vtkSlicerExternalBeamPlanningModuleLog
 vtkSlicerExternalBeamPlanningModuleLogic::~vtkSlicerExternalBeamPlanningModuleLogic()
 {
   this->SetBeamsLogic(NULL);
+  this->SetWEDStoppingPowerRatioFunction(NULL);
 
   delete this->Internal;
 }
@@ -185,6 +227,7 @@ void vtkSlicerExternalBeamPlanningModuleLogic::OnMRMLSceneNodeAdded(vtkMRMLNode*
     // Observe beam events
     vtkSmartPointer<vtkIntArray> events = vtkSmartPointer<vtkIntArray>::New();
     events->InsertNextValue(vtkMRMLRTBeamNode::CloningRequested);
+    events->InsertNextValue(vtkMRMLRTBeamNode::DRRUpdateRequested);
     vtkObserveMRMLNodeEventsMacro(node, events);
   }
 }
@@ -212,6 +255,7 @@ void vtkSlicerExternalBeamPlanningModuleLogic::OnMRMLSceneEndImport()
     // Observe beam events
     vtkSmartPointer<vtkIntArray> events = vtkSmartPointer<vtkIntArray>::New();
     events->InsertNextValue(vtkMRMLRTBeamNode::CloningRequested);
+    events->InsertNextValue(vtkMRMLRTBeamNode::DRRUpdateRequested);
     vtkObserveMRMLNodeEventsMacro(node, events);
     node = this->GetMRMLScene()->GetNextNodeByClass("vtkMRMLRTBeamNode");
   }
@@ -226,6 +270,11 @@ void vtkSlicerExternalBeamPlanningModuleLogic::OnMRMLSceneNodeRemoved(vtkMRMLNod
     return;
   }
 
+  if (node->IsA("vtkMRMLRTBeamNode") && node->GetID())
+  {
+    this->Internal->WEDCache.erase(node->GetID());
+  }
+
   // if the scene is still updating, jump out
   if (this->GetMRMLScene()->IsBatchProcessing())
   {
@@ -241,6 +290,8 @@ void vtkSlicerExternalBeamPlanningModuleLogic::OnMRMLSceneNodeRemoved(vtkMRMLNod
 //---------------------------------------------------------------------------
 void vtkSlicerExternalBeamPlanningModuleLogic::OnMRMLSceneEndClose()
 {
+  this->ClearWEDCache();
+
   this->Modified();
 }
 
@@ -284,6 +335,14 @@ void vtkSlicerExternalBeamPlanningModuleLogic::ProcessMRMLNodesEvents(vtkObject*
     {
       this->CloneBeamInPlan(beamNode);
     }
+    else if (event == vtkMRMLRTBeamNode::DRRUpdateRequested)
+    {
+      std::string errorMessage = this->UpdateDRR(beamNode);
+      if (callData)
+      {
+        *(reinterpret_cast<std::string*>(callData)) = errorMessage;
+      }
+    }
   }
 }
 
@@ -319,18 +378,261 @@ vtkMRMLRTBeamNode* vtkSlicerExternalBeamPlanningModuleLogic::CloneBeamInPlan(vtk
   return beamCloneNode;
 }
 
+//---------------------------------------------------------------------------
+std::string vtkSlicerExternalBeamPlanningModuleLogic::UpdateDRR(vtkMRMLRTBeamNode* beamNode)
+{
+  if (!this->GetMRMLScene() || !beamNode)
+  {
+    std::string errorMessage("Invalid MRML scene or beam node");
+    vtkErrorMacro("UpdateDRR: " << errorMessage);
+    return errorMessage;
+  }
+  vtkMRMLRTPlanNode* planNode = beamNode->GetParentPlanNode();
+  vtkMRMLScalarVolumeNode* referenceVolumeNode = (planNode ? planNode->GetReferenceVolumeNode() : NULL);
+  if (!referenceVolumeNode)
+  {
+    std::string errorMessage("Failed to access reference volume node");
+    vtkErrorMacro("UpdateDRR: " << errorMessage);
+    return errorMessage;
+  }
+
+  vtkSmartPointer<vtkOrientedImageData> referenceImageData = vtkSmartPointer<vtkOrientedImageData>::New();
+  if (!SlicerRtCommon::ConvertVolumeNodeToVtkOrientedImageData(referenceVolumeNode, referenceImageData, true, true))
+  {
+    std::string errorMessage("Failed to convert reference volume to oriented image data");
+    vtkErrorMacro("UpdateDRR: " << errorMessage);
+    return errorMessage;
+  }
+
+  // Beam geometry: the detector is perpendicular to the central axis, behind the isocenter
+  double isocenterPosition[3] = {0.0, 0.0, 0.0};
+  if (!beamNode->GetPlanIsocenterPosition(isocenterPosition))
+  {
+    std::string errorMessage("Failed to get isocenter position");
+    vtkErrorMacro("UpdateDRR: " << errorMessage);
+    return errorMessage;
+  }
+
+  // The beam axis is the z axis of the IEC collimator frame (pointing to the source), and the detector columns and
+  // rows follow its x and y axes, so they rotate with the collimator and stay defined for any gantry and couch angle
+  vtkSmartPointer<vtkSlicerIECTransformLogic> iecLogic = vtkSmartPointer<vtkSlicerIECTransformLogic>::New();
+  iecLogic->GetGantryToFixedReferenceTransform()->RotateY(beamNode->GetGantryAngle());
+  iecLogic->GetCollimatorToGantryTransform()->RotateZ(beamNode->GetCollimatorAngle());
+  iecLogic->GetPatientSupportToFixedReferenceTransform()->RotateZ(beamNode->GetCouchAngle());
+  vtkSmartPointer<vtkMatrix4x4> collimatorToPatientSupportMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  if (!iecLogic->GetMatrixBetween(vtkSlicerIECTransformLogic::CollimatorToGantry,
+    vtkSlicerIECTransformLogic::PatientSupportToFixedReference, collimatorToPatientSupportMatrix) )
+  {
+    std::string errorMessage("Failed to get collimator to patient support transform");
+    vtkErrorMacro("UpdateDRR: " << errorMessage);
+    return errorMessage;
+  }
+
+  // IEC patient support axes in RAS, matching the source position of the beam at zero couch angle
+  // (\sa vtkMRMLRTBeamNode::CalculateSourcePosition): x is right, y is superior, z is posterior
+  double columnDirection[3] = {0.0, 0.0, 0.0};
+  double rowDirection[3] = {0.0, 0.0, 0.0};
+  double sourceDirection[3] = {0.0, 0.0, 0.0};
+  double* iecAxesInRas[3] = { columnDirection, rowDirection, sourceDirection };
+  for (int iecAxis=0; iecAxis<3; ++iecAxis)
+  {
+    iecAxesInRas[iecAxis][0] = collimatorToPatientSupportMatrix->GetElement(0, iecAxis);
+    iecAxesInRas[iecAxis][1] = -collimatorToPatientSupportMatrix->GetElement(2, iecAxis);
+    iecAxesInRas[iecAxis][2] = collimatorToPatientSupportMatrix->GetElement(1, iecAxis);
+  }
+
+  double sourcePosition[3] = {0.0, 0.0, 0.0};
+  double detectorCenter[3] = {0.0, 0.0, 0.0};
+  for (int axis=0; axis<3; ++axis)
+  {
+    sourcePosition[axis] = isocenterPosition[axis] + sourceDirection[axis] * beamNode->GetSAD();
+    detectorCenter[axis] = sourcePosition[axis] - sourceDirection[axis] * beamNode->GetSAD() * DRR_DETECTOR_DISTANCE_TO_SAD_RATIO;
+  }
+  double detectorSpacing = DRR_PIXEL_SPACING_AT_ISOCENTER * DRR_DETECTOR_DISTANCE_TO_SAD_RATIO;
+
+  vtkSmartPointer<vtkDRRCalculator> drrCalculator = vtkSmartPointer<vtkDRRCalculator>::New();
+  drrCalculator->SetInputImageData(referenceImageData);
+  drrCalculator->SetSourcePosition(sourcePosition);
+  drrCalculator->SetDetectorCenter(detectorCenter);
+  drrCalculator->SetDetectorColumnDirection(columnDirection);
+  drrCalculator->SetDetectorRowDirection(rowDirection);
+  drrCalculator->SetDetectorSize(this->DRRImageSize);
+  drrCalculator->SetDetectorSpacing(detectorSpacing, detectorSpacing);
+  if (!drrCalculator->Update())
+  {
+    std::string errorMessage("Failed to compute DRR image");
+    vtkErrorMacro("UpdateDRR: " << errorMessage);
+    return errorMessage;
+  }
+
+  // Create DRR volume node if it does not exist yet
+  vtkMRMLScalarVolumeNode* drrVolumeNode = beamNode->GetDRRVolumeNode();
+  if (!drrVolumeNode)
+  {
+    vtkSmartPointer<vtkMRMLScalarVolumeNode> newDrrVolumeNode = vtkSmartPointer<vtkMRMLScalarVolumeNode>::New();
+    std::string drrVolumeNodeName = this->GetMRMLScene()->GenerateUniqueName(std::string(beamNode->GetName()) + "_DRR");
+    newDrrVolumeNode->SetName(drrVolumeNodeName.c_str());
+    this->GetMRMLScene()->AddNode(newDrrVolumeNode);
+    newDrrVolumeNode->CreateDefaultDisplayNodes();
+    beamNode->SetAndObserveDRRVolumeNode(newDrrVolumeNode);
+    drrVolumeNode = newDrrVolumeNode;
+  }
+
+  // The geometry of the detector plane goes to the IJK to RAS matrix of the volume node
+  // (the calculator is discarded, so its output can be shared)
+  this->CopyOrientedImageDataToVolumeNode(drrCalculator->GetOutputImageData(), drrVolumeNode, true);
+
+  return "";
+}
 
 //---------------------------------------------------------------------------
-// Obsolete methods
+vtkOrientedImageData* vtkSlicerExternalBeamPlanningModuleLogic::GetWEDImageData(vtkMRMLRTBeamNode* beamNode)
+{
+  if (!beamNode || !beamNode->GetID())
+  {
+    vtkErrorMacro("GetWEDImageData: Invalid beam node!");
+    return NULL;
+  }
+  vtkMRMLRTPlanNode* planNode = beamNode->GetParentPlanNode();
+  vtkMRMLScalarVolumeNode* referenceVolumeNode = (planNode ? planNode->GetReferenceVolumeNode() : NULL);
+  if (!referenceVolumeNode || !referenceVolumeNode->GetImageData())
+  {
+    vtkErrorMacro("GetWEDImageData: Failed to access reference volume of beam " << beamNode->GetName());
+    return NULL;
+  }
+
+  // Voxels are shared, so the conversion is cheap even if the cached WED can be used
+  vtkSmartPointer<vtkOrientedImageData> referenceImageData = vtkSmartPointer<vtkOrientedImageData>::New();
+  if (!SlicerRtCommon::ConvertVolumeNodeToVtkOrientedImageData(referenceVolumeNode, referenceImageData, true, true))
+  {
+    vtkErrorMacro("GetWEDImageData: Failed to convert reference volume to oriented image data");
+    return NULL;
+  }
+  double isocenterPosition[3] = {0.0, 0.0, 0.0};
+  double sourcePosition[3] = {0.0, 0.0, 0.0};
+  if (!beamNode->GetPlanIsocenterPosition(isocenterPosition) || !beamNode->CalculateSourcePosition(sourcePosition))
+  {
+    vtkErrorMacro("GetWEDImageData: Failed to get isocenter and source positions of beam " << beamNode->GetName());
+    return NULL;
+  }
+
+  // Reuse the cached WED if neither the beam geometry, the reference volume nor the computation parameters changed
+  std::vector<double> parameterSignature(sourcePosition, sourcePosition + 3);
+  parameterSignature.insert(parameterSignature.end(), isocenterPosition, isocenterPosition + 3);
+  vtkSmartPointer<vtkMatrix4x4> referenceImageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  referenceImageData->GetImageToWorldMatrix(referenceImageToWorldMatrix);
+  parameterSignature.insert(parameterSignature.end(), referenceImageToWorldMatrix->Element[0], referenceImageToWorldMatrix->Element[0] + 16);
+  int* referenceExtent = referenceImageData->GetExtent();
+  parameterSignature.insert(parameterSignature.end(), referenceExtent, referenceExtent + 6);
+  parameterSignature.push_back(this->WEDRaySpacing);
+  vtkMTimeType referenceVoxelsMTime = referenceVolumeNode->GetImageData()->GetMTime();
+  vtkMTimeType stoppingPowerRatioFunctionMTime = (this->WEDStoppingPowerRatioFunction ? this->WEDStoppingPowerRatioFunction->GetMTime() : 0);
+
+  vtkInternal::WEDCacheEntry& cacheEntry = this->Internal->WEDCache[beamNode->GetID()];
+  if ( cacheEntry.WEDImageData.GetPointer()
+    && cacheEntry.ParameterSignature == parameterSignature && cacheEntry.ReferenceVoxelsMTime == referenceVoxelsMTime
+    && cacheEntry.StoppingPowerRatioFunction.GetPointer() == this->WEDStoppingPowerRatioFunction
+    && cacheEntry.StoppingPowerRatioFunctionMTime == stoppingPowerRatioFunctionMTime )
+  {
+    return cacheEntry.WEDImageData;
+  }
+
+  vtkSmartPointer<vtkWEDCalculator> wedCalculator = vtkSmartPointer<vtkWEDCalculator>::New();
+  wedCalculator->SetInputImageData(referenceImageData);
+  wedCalculator->SetSourcePosition(sourcePosition);
+  wedCalculator->SetIsocenterPosition(isocenterPosition);
+  wedCalculator->SetStoppingPowerRatioFunction(this->WEDStoppingPowerRatioFunction);
+  wedCalculator->SetRaySpacing(this->WEDRaySpacing);
+  if (!wedCalculator->Update())
+  {
+    vtkErrorMacro("GetWEDImageData: Failed to compute WED volume for beam " << beamNode->GetName());
+    this->Internal->WEDCache.erase(beamNode->GetID());
+    return NULL;
+  }
+
+  cacheEntry.ParameterSignature = parameterSignature;
+  cacheEntry.ReferenceVoxelsMTime = referenceVoxelsMTime;
+  cacheEntry.StoppingPowerRatioFunction = this->WEDStoppingPowerRatioFunction;
+  cacheEntry.StoppingPowerRatioFunctionMTime = stoppingPowerRatioFunctionMTime;
+  cacheEntry.WEDImageData = wedCalculator->GetOutputImageData();
+  return cacheEntry.WEDImageData;
+}
+
 //---------------------------------------------------------------------------
+std::string vtkSlicerExternalBeamPlanningModuleLogic::ComputeWED(vtkMRMLRTBeamNode* beamNode)
+{
+  if (!this->GetMRMLScene() || !beamNode)
+  {
+    std::string errorMessage("Invalid MRML scene or beam node");
+    vtkErrorMacro("ComputeWED: " << errorMessage);
+    return errorMessage;
+  }
+
+  vtkOrientedImageData* wedImageData = this->GetWEDImageData(beamNode);
+  if (!wedImageData)
+  {
+    std::string errorMessage("Failed to compute WED volume");
+    vtkErrorMacro("ComputeWED: " << errorMessage);
+    return errorMessage;
+  }
+
+  // Create WED volume node if it does not exist yet
+  vtkMRMLScalarVolumeNode* wedVolumeNode = beamNode->GetWEDVolumeNode();
+  if (!wedVolumeNode)
+  {
+    vtkSmartPointer<vtkMRMLScalarVolumeNode> newWedVolumeNode = vtkSmartPointer<vtkMRMLScalarVolumeNode>::New();
+    std::string wedVolumeNodeName = this->GetMRMLScene()->GenerateUniqueName(std::string(beamNode->GetName()) + "_WED");
+    newWedVolumeNode->SetName(wedVolumeNodeName.c_str());
+    this->GetMRMLScene()->AddNode(newWedVolumeNode);
+    newWedVolumeNode->CreateDefaultDisplayNodes();
+    beamNode->SetAndObserveWEDVolumeNode(newWedVolumeNode);
+    wedVolumeNode = newWedVolumeNode;
+  }
+
+  // The voxels are copied so that the volume node does not change with the cache, and the cache is not
+  // modified through the volume node
+  this->CopyOrientedImageDataToVolumeNode(wedImageData, wedVolumeNode, false);
+
+  return "";
+}
 
 //---------------------------------------------------------------------------
-void vtkSlicerExternalBeamPlanningModuleLogic::ComputeWED()
+void vtkSlicerExternalBeamPlanningModuleLogic::ClearWEDCache()
 {
-  //TODO: Needs implementation
-  vtkErrorMacro("ComputeWED: Not implemented!");
+  this->Internal->WEDCache.clear();
 }
 
+//---------------------------------------------------------------------------
+void vtkSlicerExternalBeamPlanningModuleLogic::CopyOrientedImageDataToVolumeNode(vtkOrientedImageData* imageData, vtkMRMLScalarVolumeNode* volumeNode, bool shallowCopy)
+{
+  if (!imageData || !volumeNode)
+  {
+    vtkErrorMacro("CopyOrientedImageDataToVolumeNode: Invalid image data or volume node!");
+    return;
+  }
+
+  vtkSmartPointer<vtkMatrix4x4> ijkToRasMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  imageData->GetImageToWorldMatrix(ijkToRasMatrix);
+  vtkSmartPointer<vtkImageData> volumeImageData = vtkSmartPointer<vtkImageData>::New();
+  if (shallowCopy)
+  {
+    volumeImageData->ShallowCopy(imageData);
+  }
+  else
+  {
+    volumeImageData->DeepCopy(imageData);
+  }
+  volumeImageData->SetOrigin(0.0, 0.0, 0.0);
+  volumeImageData->SetSpacing(1.0, 1.0, 1.0);
+  volumeNode->SetIJKToRASMatrix(ijkToRasMatrix);
+  volumeNode->SetAndObserveImageData(volumeImageData);
+}
+
+
+//---------------------------------------------------------------------------
+// Obsolete methods
+//---------------------------------------------------------------------------
+
 //----------------------------------------------------------------------------
 void vtkSlicerExternalBeamPlanningModuleLogic::SetMatlabDoseCalculationModuleLogic(vtkSlicerCLIModuleLogic* logic)
 {
@@ -383,325 +685,3 @@ std::string vtkSlicerExternalBeamPlanningModuleLogic::ComputeDoseByMatlab(vtkMRM
 
   return "Matlab dose engine unavailable";
 }
-
-//---------------------------------------------------------------------------
-void vtkSlicerExternalBeamPlanningModuleLogic::UpdateDRR(vtkMRMLRTPlanNode* planNode, char* beamName)
-{
-  if ( !this->GetMRMLScene() || !planNode )
-  {
-    vtkErrorMacro("RemoveBeam: Invalid MRML scene or RT plan node!");
-    return;
-  }
-
-#if defined (commentout)
-  vtkMRMLScalarVolumeNode* referenceVolumeNode = planNode->GetReferenceVolumeNode();
-  if (!referenceVolumeNode)
-  {
-    vtkErrorMacro("UpdateDRR: Failed to access reference volume node!");
-    return;
-  }
-
-  // Get beam node by name
-  vtkMRMLRTBeamNode* beamNode = planNode->GetBeamByName(beamName);
-  if (!beamNode)
-  {
-    vtkErrorMacro("UpdateDRR: Unable to access beam node with name " << (beamName?beamName:"NULL"));
-    return;
-  }
-
-  vtkMRMLMarkupsFiducialNode* isocenterMarkupsNode = beamNode->GetIsocenterFiducialNode();
-  // vtkMRMLDoubleArrayNode* MLCPositionDoubleArrayNode = beamNode->GetMLCPositionDoubleArrayNode();
-  if (!isocenterMarkupsNode) // || !MLCPositionDoubleArrayNode)
-  {
-    vtkErrorMacro("UpdateDRR: Inputs are not initialized!");
-    return;
-  }
-
-  // Cast image data to uchar for faster rendering (this is for CT data only now)
-  vtkSmartPointer<vtkImageShiftScale> cast = vtkSmartPointer<vtkImageShiftScale>::New();
-  cast->SetInputData(referenceVolumeNode->GetImageData());
-  cast->SetOutputScalarTypeToUnsignedChar();
-  cast->SetShift(1000);
-  cast->SetScale(255./2000.);
-  cast->SetClampOverflow(1);
-  cast->Update();
-
-  // Create the renderer, render window 
-  vtkSmartPointer<vtkRenderer> renderer = vtkSmartPointer<vtkRenderer>::New();
-  vtkSmartPointer<vtkRenderWindow> renWin = vtkSmartPointer<vtkRenderWindow>::New();
-  renWin->SetOffScreenRendering(1);
-  renWin->AddRenderer(renderer);
-
-  // Create our volume and mapper
-  // Currently use cpu ray casting as gpu ray casting and texturemapping 3d are not working on my computer
-  vtkSmartPointer<vtkVolume> volume = vtkSmartPointer<vtkVolume>::New();
-  vtkSmartPointer<vtkVolumeRayCastMapper> mapper = vtkSmartPointer<vtkVolumeRayCastMapper>::New();
-  vtkSmartPointer<vtkVolumeRayCastCompositeFunction> compositeFunction = vtkSmartPointer<vtkVolumeRayCastCompositeFunction>::New();
-  mapper->SetVolumeRayCastFunction(compositeFunction);
-  //vtkSmartPointer<vtkVolumeTextureMapper3D> mapper = vtkSmartPointer<vtkVolumeTextureMapper3D>::New();
-  //vtkSmartPointer<vtkVolumeTextureMapper2D> mapper = vtkSmartPointer<vtkVolumeTextureMapper2D>::New();
-  //vtkSmartPointer<vtkGPUVolumeRayCastMapper> mapper = vtkSmartPointer<vtkGPUVolumeRayCastMapper>::New();
-  mapper->SetInputData( cast->GetOutput() );
-  mapper->SetBlendModeToComposite();
-  volume->SetMapper( mapper );
-
-  // Create our transfer function
-  vtkSmartPointer<vtkColorTransferFunction> colorFun = vtkSmartPointer<vtkColorTransferFunction>::New();
-  vtkSmartPointer<vtkPiecewiseFunction> opacityFun = vtkSmartPointer<vtkPiecewiseFunction>::New();
-
-  // Create the property and attach the transfer functions
-  vtkSmartPointer<vtkVolumeProperty> volumeProperty = vtkSmartPointer<vtkVolumeProperty>::New();
-  volumeProperty->SetColor( colorFun );
-  volumeProperty->SetScalarOpacity( opacityFun );
-  volumeProperty->SetInterpolationTypeToLinear();
-
-  colorFun->AddRGBPoint( 0, 0, 0, 0);
-  colorFun->AddRGBPoint( 128, 0, 0, 0);
-  colorFun->AddRGBPoint( 255, 1, 1, 1);
-
-  opacityFun->AddPoint(0, 0 );
-  opacityFun->AddPoint(128, 0 );
-  opacityFun->AddPoint(255, 0.2);
-
-  volumeProperty->ShadeOff();
-  volumeProperty->SetScalarOpacityUnitDistance(0.8919);
-
-  // connect up the volume to the property and the mapper
-  volume->SetProperty( volumeProperty );
-
-  vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
-  transform->Identity();
-  transform->RotateY(beamNode->GetGantryAngle());
-  transform->RotateX(90);
-
-  vtkSmartPointer<vtkTransform> transform2 = vtkSmartPointer<vtkTransform>::New();
-  transform2->Identity();
-  double isoCenterPosition[3] = {0.0,0.0,0.0};
-  isocenterMarkupsNode->GetNthFiducialPosition(0,isoCenterPosition);
-  transform2->Translate(-isoCenterPosition[0], -isoCenterPosition[1], -isoCenterPosition[2]);
-
-  vtkSmartPointer<vtkTransform> transform3 = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkMatrix4x4> IJK2RASMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-  referenceVolumeNode->GetIJKToRASMatrix(IJK2RASMatrix);
-  transform3->SetMatrix(IJK2RASMatrix);
-
-  transform->PreMultiply();
-  transform->Concatenate(transform2);
-  transform->Concatenate(transform3);
-  volume->SetUserTransform( transform );
-
-  // The usual rendering stuff.
-  vtkSmartPointer<vtkCamera> camera = vtkSmartPointer<vtkCamera>::New();
-  // fixed camera parameters for now
-  camera->SetPosition(0, 0, 1000);
-  camera->SetFocalPoint(0, 0, 0);
-  camera->SetViewAngle(14.68);
-  camera->SetClippingRange(100, 2000);
-  camera->ParallelProjectionOff();
-
-  // Add the volume to the scene
-  renderer->AddVolume( volume );
-  renderer->SetActiveCamera(camera);
-
-  renWin->SetSize(this->DRRImageSize[0], this->DRRImageSize[1]);
-  renWin->Render();
-
-  // Capture and convert to 2D image
-  vtkSmartPointer<vtkWindowToImageFilter> windowToImage = vtkSmartPointer<vtkWindowToImageFilter>::New();
-  windowToImage->SetInput( renWin );
-
-  vtkSmartPointer<vtkImageExtractComponents> extract = vtkSmartPointer<vtkImageExtractComponents>::New();
-  extract->SetInputConnection( windowToImage->GetOutputPort() );
-  extract->SetComponents(0);
-  extract->Update();
-
-  // Add the drr image to mrml scene
-  vtkSmartPointer<vtkMRMLScalarVolumeNode> drrImageNode = beamNode->GetDRRVolumeNode();
-  if (!drrImageNode)
-  {
-    drrImageNode = vtkSmartPointer<vtkMRMLScalarVolumeNode>::New();
-    drrImageNode = vtkMRMLScalarVolumeNode::SafeDownCast(this->GetMRMLScene()->AddNode(drrImageNode));
-    std::string DRRImageNodeName = std::string(beamName) + std::string("_DRRImage");
-    DRRImageNodeName = this->GetMRMLScene()->GenerateUniqueName(DRRImageNodeName);
-    drrImageNode->SetName(DRRImageNodeName.c_str());
-    beamNode->SetAndObserveDRRVolumeNode(drrImageNode);
-  }
-  drrImageNode->SetAndObserveImageData(extract->GetOutput());
-  drrImageNode->SetOrigin(-128,-128,0);
-  drrImageNode->SetSelectable(1);
-
-  vtkSmartPointer<vtkMRMLSliceLogic> sliceLogic = this->GetApplicationLogic()->GetSliceLogicByLayoutName("Slice4");
-  if (!sliceLogic)
-  {
-    vtkErrorMacro("UpdateDRR: Invalid sliceLogic for DRR viewer!");
-    return;
-  }
-
-  // Transforms to place the DRR image aligned with the beam geometry
-  vtkSmartPointer<vtkTransform> transformDRR = vtkSmartPointer<vtkTransform>::New();
-  transformDRR->Identity();
-  transformDRR->RotateZ(beamNode->GetGantryAngle());
-  transformDRR->RotateX(-90);
-
-  vtkSmartPointer<vtkTransform> transformDRR2 = vtkSmartPointer<vtkTransform>::New();
-  transformDRR2->Identity();
-  transformDRR2->Translate(isoCenterPosition[0], isoCenterPosition[1], isoCenterPosition[2]);
-
-  transformDRR->PostMultiply();
-  transformDRR->Concatenate(transformDRR2->GetMatrix());
-
-  vtkSmartPointer<vtkMRMLLinearTransformNode> drrImageTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetNodeByID(drrImageNode->GetTransformNodeID()));
-  if (!drrImageTransformNode)
-  {
-    drrImageTransformNode = vtkSmartPointer<vtkMRMLLinearTransformNode>::New();
-    drrImageTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(this->GetMRMLScene()->AddNode(drrImageTransformNode));
-    std::string DRRImageTransformNodeName = std::string(beamName) + std::string("_DRRImage_Transform");
-    DRRImageTransformNodeName = this->GetMRMLScene()->GenerateUniqueName(DRRImageTransformNodeName);
-    drrImageTransformNode->SetName(DRRImageTransformNodeName.c_str());
-    drrImageNode->SetAndObserveTransformNodeID(drrImageTransformNode->GetID());
-  }
-  drrImageTransformNode->SetAndObserveMatrixTransformToParent(transformDRR->GetMatrix());
-
-  // 
-  vtkSmartPointer<vtkMRMLSliceNode> sliceNode = sliceLogic->GetSliceNode();
-  vtkSmartPointer<vtkMRMLSliceCompositeNode> compositeSliceNode = sliceLogic->GetSliceCompositeNode();
-  compositeSliceNode->SetBackgroundVolumeID(drrImageNode->GetID());
-
-  //TODO: convert to segmentations
-  // Get list of segments from the segmentation node
-  vtkSmartPointer<vtkSegmentation> selectedSegmentation = planNode->GetTargetSegmentationNode()->GetSegmentation();
-  vtkSegmentation::SegmentMap segmentMap = selectedSegmentation->GetSegments();
-
-  // Compute DVH and get result nodes
-  vtkSmartPointer<vtkImageData> mergedImageData = vtkSmartPointer<vtkImageData>::New();
-  unsigned int numberOfContours = 0;
-  
-  for (vtkSegmentation::SegmentMap::iterator segmentIt = segmentMap.begin(); segmentIt != segmentMap.end(); ++segmentIt)
-  {
-    numberOfContours++;
-    // Create the translucent contour object in BEV 
-    // Create the renderer, render window 
-    vtkSmartPointer<vtkRenderer> renderer2 = vtkSmartPointer<vtkRenderer>::New();
-    vtkSmartPointer<vtkRenderWindow> renWin2 = vtkSmartPointer<vtkRenderWindow>::New();
-    renWin2->SetOffScreenRendering(1);
-    renWin2->AddRenderer(renderer2);
-
-    // Now we'll look at it. //TODO: This comment is meaningless
-    vtkSmartPointer<vtkPolyDataMapper> contourPolyDataMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-    vtkSmartPointer<vtkPolyData> polydata = vtkPolyData::SafeDownCast(segmentIt->second->GetRepresentation(vtkSegmentationConverter::GetSegmentationPlanarContourRepresentationName()));
-    contourPolyDataMapper->SetInputData(polydata);
-    //contourPolyDataMapper->SetScalarRange(0,255);
-    vtkSmartPointer<vtkActor> contourPolyDataActor = vtkSmartPointer<vtkActor>::New();
-    contourPolyDataActor->SetMapper(contourPolyDataMapper);
-    contourPolyDataActor->GetProperty()->LightingOff();
-    contourPolyDataActor->GetProperty()->SetColor(1.0,1.0,1.0);
-
-    vtkSmartPointer<vtkTransform> transformContourBEV = vtkSmartPointer<vtkTransform>::New();
-    transformContourBEV->Identity();
-    transformContourBEV->RotateY(beamNode->GetGantryAngle());
-    transformContourBEV->RotateX(90);
-
-    vtkSmartPointer<vtkTransform> transformContourBEV2 = vtkSmartPointer<vtkTransform>::New();
-    transformContourBEV2->Identity();
-    transformContourBEV2->Translate(-isoCenterPosition[0], -isoCenterPosition[1], -isoCenterPosition[2]);
-
-    transformContourBEV->PreMultiply();
-    transformContourBEV->Concatenate(transformContourBEV2);
-    contourPolyDataActor->SetUserTransform( transformContourBEV );
-
-    // The usual rendering stuff.
-    vtkSmartPointer<vtkCamera> camera2 = vtkSmartPointer<vtkCamera>::New();
-    // fixed camera parameters for now
-    camera2->SetPosition(0, 0, 1000);
-    camera2->SetFocalPoint(0, 0, 0);
-    camera2->SetViewAngle(14.68);
-    camera2->SetClippingRange(100, 2000);
-    camera2->ParallelProjectionOff();
-
-    // Add the volume to the scene
-    renderer2->AddActor(contourPolyDataActor);
-    renderer2->SetActiveCamera(camera2);
-
-    renWin2->SetSize(this->DRRImageSize[0], this->DRRImageSize[1]);
-    renWin2->Render();
-
-    // Capture and convert to 2D image
-    vtkSmartPointer<vtkWindowToImageFilter> windowToImage2 = vtkSmartPointer<vtkWindowToImageFilter>::New();
-    windowToImage2->SetInput( renWin2 );
-
-    vtkSmartPointer<vtkImageExtractComponents> extract2 = vtkSmartPointer<vtkImageExtractComponents>::New();
-    extract2->SetInputConnection( windowToImage2->GetOutputPort() );
-    extract2->SetComponents(0);
-    extract2->Update();
-
-    // Investigate when contour technique to use (gradient )
-    vtkSmartPointer<vtkImageGradientMagnitude> magnitude = vtkSmartPointer<vtkImageGradientMagnitude>::New();
-    magnitude->SetInputConnection( extract2->GetOutputPort() );
-    magnitude->SetDimensionality(2);
-    magnitude->Update();
-
-    if (numberOfContours > 1)
-    {
-      vtkSmartPointer<vtkImageMathematics> addFilter = vtkSmartPointer<vtkImageMathematics>::New(); 
-      addFilter->SetInput1Data(mergedImageData);
-      addFilter->SetInput2Data(magnitude->GetOutput());
-      addFilter->SetOperationToAdd();
-      addFilter->Update();
-      mergedImageData->DeepCopy(addFilter->GetOutput());
-    }
-    else
-    {
-      mergedImageData->DeepCopy(magnitude->GetOutput());
-    }
-  }
-
-  // Add the contour BEV image to mrml scene
-  vtkSmartPointer<vtkMRMLScalarVolumeNode> contourBEVImageNode = beamNode->GetContourBEVVolumeNode();
-  if (!contourBEVImageNode)
-  {
-    contourBEVImageNode = vtkSmartPointer<vtkMRMLScalarVolumeNode>::New();
-    contourBEVImageNode = vtkMRMLScalarVolumeNode::SafeDownCast(this->GetMRMLScene()->AddNode(contourBEVImageNode));
-    std::string contourBEVImageNodeName = std::string(beamName) + std::string("_ContourBEVImage");
-    contourBEVImageNodeName = this->GetMRMLScene()->GenerateUniqueName(contourBEVImageNodeName);
-    contourBEVImageNode->SetName(contourBEVImageNodeName.c_str());
-  }
-  beamNode->SetAndObserveContourBEVVolumeNode(contourBEVImageNode);
-
-  vtkSmartPointer<vtkMRMLScalarVolumeDisplayNode> volumeDisplayNode = vtkMRMLScalarVolumeDisplayNode::SafeDownCast(contourBEVImageNode->GetDisplayNode());
-  if (!volumeDisplayNode)
-  {
-    // Set default colormap to the loaded one if found or generated, or to rainbow otherwise
-    volumeDisplayNode = vtkSmartPointer<vtkMRMLScalarVolumeDisplayNode>::New();
-    this->GetMRMLScene()->AddNode(volumeDisplayNode);
-  }
-  volumeDisplayNode->SetAndObserveColorNodeID("vtkMRMLColorTableNodeGreen");
-  volumeDisplayNode->SetScalarRange(0,255);
-  volumeDisplayNode->AutoWindowLevelOff();
-  volumeDisplayNode->SetWindow(64);
-  volumeDisplayNode->SetLevel(128);
-
-  contourBEVImageNode->SetAndObserveDisplayNodeID(volumeDisplayNode->GetID());
-  contourBEVImageNode->SetAndObserveImageData(mergedImageData);
-  contourBEVImageNode->SetOrigin(-128,-128,0);
-  contourBEVImageNode->SetSelectable(1);
-
-  contourBEVImageNode->SetAndObserveTransformNodeID(drrImageTransformNode->GetID());
-
-  compositeSliceNode->SetForegroundVolumeID(contourBEVImageNode->GetID());
-  compositeSliceNode->SetForegroundOpacity(0.3);
-
-  // Transform ???
-  vtkSmartPointer<vtkTransform> transformSlice = vtkSmartPointer<vtkTransform>::New();
-  transformSlice->Identity();
-  transformSlice->RotateZ(beamNode->GetGantryAngle());
-  transformSlice->RotateX(-90);
-  transformSlice->Update();
-
-  sliceNode->SetSliceToRAS(transformSlice->GetMatrix());
-  sliceNode->UpdateMatrices();
-
-  sliceLogic->FitSliceToAll();
-
-#endif
-}
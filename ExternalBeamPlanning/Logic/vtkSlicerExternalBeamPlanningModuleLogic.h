@@ -41,6 +41,8 @@
 
 class vtkMRMLRTPlanNode;
 class vtkMRMLRTBeamNode;
+class vtkMRMLScalarVolumeNode;
+class vtkPiecewiseFunction;
 class vtkSlicerCLIModuleLogic;
 class vtkSlicerBeamsModuleLogic;
 class vtkSlicerDoseAccumulationModuleLogic;
@@ -66,15 +68,38 @@ public:
   /// \return The new beam node that has been copied and added to the plan
   vtkMRMLRTBeamNode* CloneBeamInPlan(vtkMRMLRTBeamNode* copiedBeamNode, vtkMRMLRTPlanNode* planNode=NULL);
 
-//TODO: Obsolete functions
-public:
-  /// TODO Fix
-  /// TODO Move to separate logic
-  void UpdateDRR(vtkMRMLRTPlanNode* planNode, char* beamName);
+  /// Compute digitally reconstructed radiograph of the plan reference volume for a beam, and set it as the
+  /// DRR volume of the beam (created if missing). The detector is perpendicular to the beam axis behind the
+  /// isocenter, and its axes are those of the IEC collimator frame for the gantry, collimator and couch angles
+  /// of the beam \sa vtkSlicerIECTransformLogic. The computation does not need a render window \sa vtkDRRCalculator
+  /// \return Error message, empty string on success
+  std::string UpdateDRR(vtkMRMLRTBeamNode* beamNode);
 
-  /// TODO
-  void ComputeWED();
+  /// Get water equivalent depth (WED) volume of a beam: the radiological path length from the source to every voxel
+  /// of the dose grid (currently the reference volume lattice) \sa vtkWEDCalculator. The result is cached per beam and
+  /// only recomputed if the source, the isocenter, the reference volume, the stopping power ratio function or the ray
+  /// spacing changed, so dose engines can reuse it.
+  /// \return WED volume owned by the cache, NULL on failure
+  vtkOrientedImageData* GetWEDImageData(vtkMRMLRTBeamNode* beamNode);
+
+  /// Get WED volume of a beam (\sa GetWEDImageData) and set it as the WED volume of the beam (created if missing)
+  /// \return Error message, empty string on success
+  std::string ComputeWED(vtkMRMLRTBeamNode* beamNode);
+
+  /// Remove all cached WED volumes
+  void ClearWEDCache();
+
+  /// Set function mapping HU to stopping power ratio used for the WED volumes. If not set, the stopping power ratio
+  /// is estimated from the electron density \sa vtkWEDCalculator::SetStoppingPowerRatioFunction
+  void SetWEDStoppingPowerRatioFunction(vtkPiecewiseFunction* function);
+  vtkGetObjectMacro(WEDStoppingPowerRatioFunction, vtkPiecewiseFunction);
 
+  /// Distance between the rays of the WED computation in the isocenter plane (mm). Default is 2
+  vtkSetMacro(WEDRaySpacing, double);
+  vtkGetMacro(WEDRaySpacing, double);
+
+//TODO: Obsolete functions
+public:
   /// TODO
   void SetMatlabDoseCalculationModuleLogic(vtkSlicerCLIModuleLogic* logic);
   vtkSlicerCLIModuleLogic* GetMatlabDoseCalculationModuleLogic();
@@ -100,10 +125,19 @@ protected:
   /// Handles events registered in the observer manager
   virtual void ProcessMRMLNodesEvents(vtkObject* caller, unsigned long event, void* callData);
 
+  /// Set oriented image data to a volume node. The image geometry goes to the IJK to RAS matrix
+  /// \param shallowCopy Share the voxels with the image data if true (only if the image data is not kept), copy them otherwise
+  void CopyOrientedImageDataToVolumeNode(vtkOrientedImageData* imageData, vtkMRMLScalarVolumeNode* volumeNode, bool shallowCopy);
+
 protected:
-  /// TODO:
+  /// Number of columns and rows of the computed DRR images
   int DRRImageSize[2];
 
+  /// Function mapping HU to stopping power ratio used for the WED volumes
+  vtkPiecewiseFunction* WEDStoppingPowerRatioFunction;
+  /// Distance between the rays of the WED computation in the isocenter plane
+  double WEDRaySpacing;
+
 private:
   vtkSlicerExternalBeamPlanningModuleLogic(const vtkSlicerExternalBeamPlanningModuleLogic&); // Not implemented
   void operator=(const vtkSlicerExternalBeamPlanningModuleLogic&);               // Not implemented
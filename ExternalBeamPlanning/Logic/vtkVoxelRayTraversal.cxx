@@ -0,0 +1,144 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkVoxelRayTraversal.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkVoxelRayTraversal);
+
+//----------------------------------------------------------------------------
+vtkVoxelRayTraversal::vtkVoxelRayTraversal()
+{
+  this->Dimensions[0] = this->Dimensions[1] = this->Dimensions[2] = 0;
+}
+
+//----------------------------------------------------------------------------
+vtkVoxelRayTraversal::~vtkVoxelRayTraversal()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkVoxelRayTraversal::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "Dimensions: " << this->Dimensions[0] << ", " << this->Dimensions[1] << ", " << this->Dimensions[2] << "\n";
+  os << indent << "NumberOfIntersectedVoxels: " << this->VoxelIndices.size() << "\n";
+}
+
+//----------------------------------------------------------------------------
+int vtkVoxelRayTraversal::TraceRay(const double startPoint[3], const double endPoint[3])
+{
+  this->VoxelIndices.clear();
+  this->BoundaryParameters.clear();
+
+  // Clip the ray segment to the image box
+  double direction[3] = {0.0, 0.0, 0.0};
+  double minimumParameter = 0.0;
+  double maximumParameter = 1.0;
+  for (int axis=0; axis<3; ++axis)
+  {
+    if (this->Dimensions[axis] < 1)
+    {
+      return 0;
+    }
+    direction[axis] = endPoint[axis] - startPoint[axis];
+    double lowerPlane = -0.5;
+    double upperPlane = this->Dimensions[axis] - 0.5;
+    if (direction[axis] == 0.0)
+    {
+      if (startPoint[axis] <= lowerPlane || startPoint[axis] >= upperPlane)
+      {
+        return 0;
+      }
+      continue;
+    }
+    double lowerParameter = (lowerPlane - startPoint[axis]) / direction[axis];
+    double upperParameter = (upperPlane - startPoint[axis]) / direction[axis];
+    minimumParameter = std::max(minimumParameter, std::min(lowerParameter, upperParameter));
+    maximumParameter = std::min(maximumParameter, std::max(lowerParameter, upperParameter));
+  }
+  if (minimumParameter >= maximumParameter)
+  {
+    return 0;
+  }
+
+  // Voxel where the ray enters, and the parameters of the next plane crossings along each axis
+  int index[3] = {0, 0, 0};
+  int step[3] = {0, 0, 0};
+  double nextParameter[3] = {VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, VTK_DOUBLE_MAX};
+  double parameterIncrement[3] = {0.0, 0.0, 0.0};
+  for (int axis=0; axis<3; ++axis)
+  {
+    double entryPosition = startPoint[axis] + minimumParameter * direction[axis];
+    // On a voxel boundary the voxel in the direction of the ray is entered
+    index[axis] = (direction[axis] < 0.0 ? (int)ceil(entryPosition - 0.5) : (int)floor(entryPosition + 0.5));
+    index[axis] = std::min(std::max(index[axis], 0), this->Dimensions[axis] - 1);
+    if (direction[axis] > 0.0)
+    {
+      step[axis] = 1;
+      nextParameter[axis] = (index[axis] + 0.5 - startPoint[axis]) / direction[axis];
+      parameterIncrement[axis] = 1.0 / direction[axis];
+    }
+    else if (direction[axis] < 0.0)
+    {
+      step[axis] = -1;
+      nextParameter[axis] = (index[axis] - 0.5 - startPoint[axis]) / direction[axis];
+      parameterIncrement[axis] = -1.0 / direction[axis];
+    }
+  }
+
+  vtkIdType increments[3] = { 1, this->Dimensions[0], (vtkIdType)this->Dimensions[0] * this->Dimensions[1] };
+  vtkIdType voxelIndex = index[0] * increments[0] + index[1] * increments[1] + index[2] * increments[2];
+  double currentParameter = minimumParameter;
+  this->BoundaryParameters.push_back(currentParameter);
+  while (currentParameter < maximumParameter)
+  {
+    // Axis of the nearest plane crossing
+    int axis = ( nextParameter[0] <= nextParameter[1]
+      ? (nextParameter[0] <= nextParameter[2] ? 0 : 2)
+      : (nextParameter[1] <= nextParameter[2] ? 1 : 2) );
+    double exitParameter = std::min(nextParameter[axis], maximumParameter);
+    // Crossing several planes at once (edges and corners) does not add zero length intersections
+    if (exitParameter > currentParameter)
+    {
+      this->VoxelIndices.push_back(voxelIndex);
+      this->BoundaryParameters.push_back(exitParameter);
+      currentParameter = exitParameter;
+    }
+
+    index[axis] += step[axis];
+    if (index[axis] < 0 || index[axis] >= this->Dimensions[axis])
+    {
+      break;
+    }
+    voxelIndex += step[axis] * increments[axis];
+    nextParameter[axis] += parameterIncrement[axis];
+  }
+
+  return (int)this->VoxelIndices.size();
+}
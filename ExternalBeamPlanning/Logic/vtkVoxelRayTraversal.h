@@ -0,0 +1,85 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#ifndef __vtkVoxelRayTraversal_h
+#define __vtkVoxelRayTraversal_h
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <vector>
+
+#include "vtkSlicerExternalBeamPlanningModuleLogicExport.h"
+
+/// \ingroup SlicerRt_QtModules_ExternalBeamPlanning
+/// \class vtkVoxelRayTraversal
+/// \brief Collect the voxels intersected by a ray segment with their exact intersection lengths.
+///
+/// Implements the voxel traversal of Siddon (Fast calculation of the exact radiological path for a three-dimensional
+/// CT array, 1985) with the incremental plane crossing update of Jacobs et al. (A fast algorithm to calculate the
+/// exact radiological path through a pixel or voxel space, 1998): the ray is clipped to the image box, then the next
+/// crossing of each plane family is advanced by a constant increment, so each intersected voxel costs a few comparisons.
+///
+/// The ray is given in continuous voxel coordinates, where voxel (i,j,k) covers [i-0.5,i+0.5] x [j-0.5,j+0.5] x [k-0.5,k+0.5]
+/// and the first voxel has index (0,0,0). The intersections are stored in the instance, so each thread needs its own instance.
+class VTK_SLICER_EXTERNALBEAMPLANNING_MODULE_LOGIC_EXPORT vtkVoxelRayTraversal : public vtkObject
+{
+public:
+  static vtkVoxelRayTraversal *New();
+  vtkTypeMacro(vtkVoxelRayTraversal, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Set number of voxels along each axis
+  vtkSetVector3Macro(Dimensions, int);
+  vtkGetVector3Macro(Dimensions, int);
+
+  /// Trace a ray segment through the voxels
+  /// \param startPoint Start of the segment in continuous voxel coordinates (ray parameter 0)
+  /// \param endPoint End of the segment in continuous voxel coordinates (ray parameter 1)
+  /// \return Number of intersected voxels
+  int TraceRay(const double startPoint[3], const double endPoint[3]);
+
+  /// Get number of voxels intersected by the last traced ray
+  int GetNumberOfIntersectedVoxels() { return (int)this->VoxelIndices.size(); };
+  /// Get indices (i + j*dimX + k*dimX*dimY) of the intersected voxels in the order along the ray
+  const vtkIdType* GetVoxelIndices() { return this->VoxelIndices.empty() ? NULL : &this->VoxelIndices[0]; };
+  /// Get ray parameters of the voxel boundaries along the ray (number of intersected voxels + 1 values).
+  /// The n-th intersected voxel is between the n-th and the n+1-th parameter
+  const double* GetBoundaryParameters() { return this->BoundaryParameters.empty() ? NULL : &this->BoundaryParameters[0]; };
+
+protected:
+  vtkVoxelRayTraversal();
+  virtual ~vtkVoxelRayTraversal();
+
+protected:
+  /// Number of voxels along each axis
+  int Dimensions[3];
+  /// Indices of the intersected voxels
+  std::vector<vtkIdType> VoxelIndices;
+  /// Ray parameters of the voxel boundaries
+  std::vector<double> BoundaryParameters;
+
+private:
+  vtkVoxelRayTraversal(const vtkVoxelRayTraversal&); // Not implemented
+  void operator=(const vtkVoxelRayTraversal&);       // Not implemented
+};
+
+#endif
@@ -0,0 +1,463 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkWEDCalculator.h"
+#include "vtkVoxelRayTraversal.h"
+
+// Segmentations includes
+#include "vtkOrientedImageData.h"
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkWEDCalculator);
+
+vtkCxxSetObjectMacro(vtkWEDCalculator, InputImageData, vtkOrientedImageData);
+vtkCxxSetObjectMacro(vtkWEDCalculator, OutputGeometryImageData, vtkOrientedImageData);
+vtkCxxSetObjectMacro(vtkWEDCalculator, StoppingPowerRatioFunction, vtkPiecewiseFunction);
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /// Range of the HU values in the stopping power ratio lookup table. Values outside are clamped
+  const double LOOKUP_TABLE_MINIMUM_VALUE = -2048.0;
+  const double LOOKUP_TABLE_MAXIMUM_VALUE = 16383.0;
+
+  //----------------------------------------------------------------------------
+  /// Transform a point with a 4x4 row-major affine matrix
+  void TransformPoint(const double matrix[16], const double point[3], double transformedPoint[3])
+  {
+    for (int row=0; row<3; ++row)
+    {
+      transformedPoint[row] = matrix[4*row] * point[0] + matrix[4*row+1] * point[1] + matrix[4*row+2] * point[2] + matrix[4*row+3];
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Get the lower grid index and the weight of the upper one for linear interpolation at a continuous grid position.
+  /// Positions outside the grid are clamped to the first or last interval
+  void GetInterpolationIndex(double position, int size, int& index, double& weight)
+  {
+    index = std::min(std::max((int)floor(position), 0), size - 2);
+    weight = std::min(std::max(position - index, 0.0), 1.0);
+  }
+
+  //----------------------------------------------------------------------------
+  /// Accumulate the stopping power ratios of the voxels intersected by the traced ray, and sample the cumulative
+  /// water equivalent depth at regular distances from the start of the ray
+  template <class T> void SampleRay(const T* voxelsPtr, vtkVoxelRayTraversal* traversal,
+    const double* lookupTable, int lookupTableMinimumValue, int lookupTableSize,
+    double rayLength, double firstSampleDistance, double samplingStep, int numberOfSamples, float* samples)
+  {
+    int numberOfVoxels = traversal->GetNumberOfIntersectedVoxels();
+    const vtkIdType* voxelIndices = traversal->GetVoxelIndices();
+    const double* boundaryParameters = traversal->GetBoundaryParameters();
+    double waterEquivalentDepth = 0.0;
+    int sample = 0;
+    double sampleDistance = firstSampleDistance;
+    for (int voxel=0; voxel<numberOfVoxels; ++voxel)
+    {
+      int entry = (int)floor((double)voxelsPtr[voxelIndices[voxel]] + 0.5) - lookupTableMinimumValue;
+      entry = std::min(std::max(entry, 0), lookupTableSize - 1);
+      double stoppingPowerRatio = lookupTable[entry];
+      double entryDistance = boundaryParameters[voxel] * rayLength;
+      double exitDistance = boundaryParameters[voxel+1] * rayLength;
+      while (sample < numberOfSamples && sampleDistance <= exitDistance)
+      {
+        samples[sample] = (float)(waterEquivalentDepth + stoppingPowerRatio * std::max(sampleDistance - entryDistance, 0.0));
+        ++sample;
+        sampleDistance = firstSampleDistance + sample * samplingStep;
+      }
+      waterEquivalentDepth += stoppingPowerRatio * (exitDistance - entryDistance);
+    }
+    for (; sample<numberOfSamples; ++sample)
+    {
+      samples[sample] = (float)waterEquivalentDepth;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE TraceRaysThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    vtkWEDCalculator* self = static_cast<vtkWEDCalculator*>(threadInfo->UserData);
+
+    int numberOfRows = self->GetRayGridSize()[1];
+    int rowsPerThread = (numberOfRows + threadInfo->NumberOfThreads - 1) / threadInfo->NumberOfThreads;
+    int startRow = threadInfo->ThreadID * rowsPerThread;
+    int endRow = std::min(startRow + rowsPerThread, numberOfRows);
+    if (startRow < endRow)
+    {
+      self->ThreadedTraceRays(startRow, endRow);
+    }
+
+    return VTK_THREAD_RETURN_VALUE;
+  }
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE InterpolateSlicesThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    vtkWEDCalculator* self = static_cast<vtkWEDCalculator*>(threadInfo->UserData);
+
+    int extent[6] = {0,-1,0,-1,0,-1};
+    self->GetOutputImageData()->GetExtent(extent);
+    int numberOfSlices = extent[5] - extent[4] + 1;
+    int slicesPerThread = (numberOfSlices + threadInfo->NumberOfThreads - 1) / threadInfo->NumberOfThreads;
+    int startSlice = threadInfo->ThreadID * slicesPerThread;
+    int endSlice = std::min(startSlice + slicesPerThread, numberOfSlices);
+    if (startSlice < endSlice)
+    {
+      self->ThreadedInterpolateSlices(startSlice, endSlice);
+    }
+
+    return VTK_THREAD_RETURN_VALUE;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkWEDCalculator::vtkWEDCalculator()
+{
+  this->InputImageData = NULL;
+  this->OutputGeometryImageData = NULL;
+  this->OutputImageData = vtkOrientedImageData::New();
+  this->StoppingPowerRatioFunction = NULL;
+
+  this->SourcePosition[0] = this->SourcePosition[1] = this->SourcePosition[2] = 0.0;
+  this->IsocenterPosition[0] = this->IsocenterPosition[1] = this->IsocenterPosition[2] = 0.0;
+  this->RaySpacing = 2.0;
+  this->SamplingStep = 1.0;
+
+  this->LookupTableMinimumValue = 0;
+  vtkMatrix4x4::Identity(this->WorldToVoxelMatrix);
+
+  this->BeamDirection[0] = this->BeamDirection[1] = this->BeamDirection[2] = 0.0;
+  this->RayColumnDirection[0] = this->RayColumnDirection[1] = this->RayColumnDirection[2] = 0.0;
+  this->RayRowDirection[0] = this->RayRowDirection[1] = this->RayRowDirection[2] = 0.0;
+  this->SourceToIsocenterDistance = 0.0;
+  this->RayGridOrigin[0] = this->RayGridOrigin[1] = 0.0;
+  this->RayGridSize[0] = this->RayGridSize[1] = 0;
+  this->FirstSampleDistance = 0.0;
+  this->NumberOfSamples = 0;
+
+  this->Threader = vtkMultiThreader::New();
+  this->NumberOfThreads = this->Threader->GetNumberOfThreads();
+}
+
+//----------------------------------------------------------------------------
+vtkWEDCalculator::~vtkWEDCalculator()
+{
+  this->SetInputImageData(NULL);
+  this->SetOutputGeometryImageData(NULL);
+  this->SetStoppingPowerRatioFunction(NULL);
+  if (this->OutputImageData)
+  {
+    this->OutputImageData->Delete();
+    this->OutputImageData = NULL;
+  }
+  if (this->Threader)
+  {
+    this->Threader->Delete();
+    this->Threader = NULL;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkWEDCalculator::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "SourcePosition: " << this->SourcePosition[0] << ", " << this->SourcePosition[1] << ", " << this->SourcePosition[2] << "\n";
+  os << indent << "IsocenterPosition: " << this->IsocenterPosition[0] << ", " << this->IsocenterPosition[1] << ", " << this->IsocenterPosition[2] << "\n";
+  os << indent << "RaySpacing: " << this->RaySpacing << "\n";
+  os << indent << "SamplingStep: " << this->SamplingStep << "\n";
+  os << indent << "RayGridSize: " << this->RayGridSize[0] << ", " << this->RayGridSize[1] << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+}
+
+//----------------------------------------------------------------------------
+bool vtkWEDCalculator::Update()
+{
+  if (!this->InputImageData || !this->InputImageData->GetPointData()->GetScalars())
+  {
+    vtkErrorMacro("Update: Invalid input image!");
+    return false;
+  }
+  if (this->RaySpacing <= 0.0 || this->SamplingStep <= 0.0)
+  {
+    vtkErrorMacro("Update: Invalid ray spacing or sampling step!");
+    return false;
+  }
+
+  // RAS to continuous voxel coordinates, the first voxel of the extent being at the origin
+  vtkSmartPointer<vtkMatrix4x4> imageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  this->InputImageData->GetImageToWorldMatrix(imageToWorldMatrix);
+  vtkSmartPointer<vtkMatrix4x4> worldToImageMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkMatrix4x4::Invert(imageToWorldMatrix, worldToImageMatrix);
+  int extent[6] = {0,-1,0,-1,0,-1};
+  this->InputImageData->GetExtent(extent);
+  for (int axis=0; axis<3; ++axis)
+  {
+    worldToImageMatrix->SetElement(axis, 3, worldToImageMatrix->GetElement(axis, 3) - extent[2*axis]);
+  }
+  vtkMatrix4x4::DeepCopy(this->WorldToVoxelMatrix, worldToImageMatrix);
+
+  // Output on the dose grid
+  vtkOrientedImageData* geometryImageData = (this->OutputGeometryImageData ? this->OutputGeometryImageData : this->InputImageData);
+  vtkSmartPointer<vtkMatrix4x4> outputImageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  geometryImageData->GetImageToWorldMatrix(outputImageToWorldMatrix);
+  this->OutputImageData->SetExtent(geometryImageData->GetExtent());
+  this->OutputImageData->SetGeometryFromImageToWorldMatrix(outputImageToWorldMatrix);
+  this->OutputImageData->AllocateScalars(VTK_FLOAT, 1);
+
+  if (!this->InitializeRayGrid())
+  {
+    return false;
+  }
+  this->BuildStoppingPowerRatioLookupTable();
+
+  this->Threader->SetNumberOfThreads(this->NumberOfThreads);
+  this->Threader->SetSingleMethod(TraceRaysThreadFunction, this);
+  this->Threader->SingleMethodExecute();
+  this->Threader->SetSingleMethod(InterpolateSlicesThreadFunction, this);
+  this->Threader->SingleMethodExecute();
+
+  // Release the ray samples, they are only needed during the update
+  std::vector<float>().swap(this->RaySamples);
+
+  this->OutputImageData->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkWEDCalculator::InitializeRayGrid()
+{
+  for (int axis=0; axis<3; ++axis)
+  {
+    this->BeamDirection[axis] = this->IsocenterPosition[axis] - this->SourcePosition[axis];
+  }
+  this->SourceToIsocenterDistance = vtkMath::Normalize(this->BeamDirection);
+  if (this->SourceToIsocenterDistance == 0.0)
+  {
+    vtkErrorMacro("InitializeRayGrid: Source and isocenter positions coincide!");
+    return false;
+  }
+  double superiorDirection[3] = {0.0, 0.0, 1.0};
+  vtkMath::Cross(this->BeamDirection, superiorDirection, this->RayColumnDirection);
+  if (vtkMath::Normalize(this->RayColumnDirection) < 1.0e-6)
+  {
+    // Beam along the superior-inferior axis
+    this->RayColumnDirection[0] = 1.0;
+    this->RayColumnDirection[1] = this->RayColumnDirection[2] = 0.0;
+  }
+  vtkMath::Cross(this->RayColumnDirection, this->BeamDirection, this->RayRowDirection);
+
+  // Project the corners of the dose grid to the isocenter plane. As all corners are in front of the source,
+  // the projection of the whole grid is within the bounding rectangle of the projected corners
+  int extent[6] = {0,-1,0,-1,0,-1};
+  this->OutputImageData->GetExtent(extent);
+  vtkSmartPointer<vtkMatrix4x4> outputImageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  this->OutputImageData->GetImageToWorldMatrix(outputImageToWorldMatrix);
+  double rayGridBounds[4] = {VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX};
+  double minimumDepth = VTK_DOUBLE_MAX;
+  double maximumDistance = 0.0;
+  for (int corner=0; corner<8; ++corner)
+  {
+    double cornerIjk[4] = { (double)extent[corner & 1 ? 1 : 0], (double)extent[corner & 2 ? 3 : 2], (double)extent[corner & 4 ? 5 : 4], 1.0 };
+    double cornerPosition[4] = {0.0, 0.0, 0.0, 1.0};
+    outputImageToWorldMatrix->MultiplyPoint(cornerIjk, cornerPosition);
+    double sourceToCorner[3] = { cornerPosition[0] - this->SourcePosition[0],
+      cornerPosition[1] - this->SourcePosition[1], cornerPosition[2] - this->SourcePosition[2] };
+    double depth = vtkMath::Dot(sourceToCorner, this->BeamDirection);
+    if (depth <= 0.0)
+    {
+      vtkErrorMacro("InitializeRayGrid: The dose grid needs to be in front of the source!");
+      return false;
+    }
+    double projectionScale = this->SourceToIsocenterDistance / depth;
+    double columnPosition = vtkMath::Dot(sourceToCorner, this->RayColumnDirection) * projectionScale;
+    double rowPosition = vtkMath::Dot(sourceToCorner, this->RayRowDirection) * projectionScale;
+    rayGridBounds[0] = std::min(rayGridBounds[0], columnPosition);
+    rayGridBounds[1] = std::max(rayGridBounds[1], columnPosition);
+    rayGridBounds[2] = std::min(rayGridBounds[2], rowPosition);
+    rayGridBounds[3] = std::max(rayGridBounds[3], rowPosition);
+    minimumDepth = std::min(minimumDepth, depth);
+    maximumDistance = std::max(maximumDistance, vtkMath::Norm(sourceToCorner));
+  }
+
+  // One extra ray on each side so that every voxel is surrounded by four rays
+  for (int dimension=0; dimension<2; ++dimension)
+  {
+    this->RayGridOrigin[dimension] = rayGridBounds[2*dimension] - this->RaySpacing;
+    this->RayGridSize[dimension] = (int)ceil((rayGridBounds[2*dimension+1] - rayGridBounds[2*dimension]) / this->RaySpacing) + 3;
+  }
+
+  // The distance of any voxel from the source is at least its depth along the beam
+  this->FirstSampleDistance = std::max(minimumDepth - this->SamplingStep, 0.0);
+  this->NumberOfSamples = (int)ceil((maximumDistance - this->FirstSampleDistance) / this->SamplingStep) + 2;
+
+  this->RaySamples.resize((size_t)this->RayGridSize[0] * this->RayGridSize[1] * this->NumberOfSamples);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkWEDCalculator::BuildStoppingPowerRatioLookupTable()
+{
+  double scalarRange[2] = {0.0, 0.0};
+  this->InputImageData->GetScalarRange(scalarRange);
+  int minimumValue = (int)floor(std::min(std::max(scalarRange[0], LOOKUP_TABLE_MINIMUM_VALUE), LOOKUP_TABLE_MAXIMUM_VALUE));
+  int maximumValue = (int)ceil(std::max(std::min(scalarRange[1], LOOKUP_TABLE_MAXIMUM_VALUE), (double)minimumValue));
+
+  this->LookupTableMinimumValue = minimumValue;
+  this->StoppingPowerRatioLookupTable.resize(maximumValue - minimumValue + 1);
+  for (int value = minimumValue; value <= maximumValue; ++value)
+  {
+    double stoppingPowerRatio = ( this->StoppingPowerRatioFunction ? this->StoppingPowerRatioFunction->GetValue(value)
+      : 1.0 + value / 1000.0 );
+    this->StoppingPowerRatioLookupTable[value - minimumValue] = std::max(stoppingPowerRatio, 0.0);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkWEDCalculator::ThreadedTraceRays(int startRow, int endRow)
+{
+  int dimensions[3] = {0, 0, 0};
+  this->InputImageData->GetDimensions(dimensions);
+  vtkSmartPointer<vtkVoxelRayTraversal> traversal = vtkSmartPointer<vtkVoxelRayTraversal>::New();
+  traversal->SetDimensions(dimensions);
+
+  double sourceVoxelPosition[3] = {0.0, 0.0, 0.0};
+  TransformPoint(this->WorldToVoxelMatrix, this->SourcePosition, sourceVoxelPosition);
+
+  int scalarType = this->InputImageData->GetScalarType();
+  void* inputPtr = this->InputImageData->GetScalarPointer();
+  const double* lookupTable = &(this->StoppingPowerRatioLookupTable[0]);
+  int lookupTableSize = (int)this->StoppingPowerRatioLookupTable.size();
+  double rayLength = this->FirstSampleDistance + (this->NumberOfSamples - 1) * this->SamplingStep;
+
+  for (int row = startRow; row < endRow; ++row)
+  {
+    double rowPosition = this->RayGridOrigin[1] + row * this->RaySpacing;
+    for (int column = 0; column < this->RayGridSize[0]; ++column)
+    {
+      double columnPosition = this->RayGridOrigin[0] + column * this->RaySpacing;
+      double rayDirection[3] = {0.0, 0.0, 0.0};
+      for (int axis=0; axis<3; ++axis)
+      {
+        rayDirection[axis] = this->SourceToIsocenterDistance * this->BeamDirection[axis]
+          + columnPosition * this->RayColumnDirection[axis] + rowPosition * this->RayRowDirection[axis];
+      }
+      vtkMath::Normalize(rayDirection);
+      double rayEndPosition[3] = {0.0, 0.0, 0.0};
+      for (int axis=0; axis<3; ++axis)
+      {
+        rayEndPosition[axis] = this->SourcePosition[axis] + rayLength * rayDirection[axis];
+      }
+      double rayEndVoxelPosition[3] = {0.0, 0.0, 0.0};
+      TransformPoint(this->WorldToVoxelMatrix, rayEndPosition, rayEndVoxelPosition);
+
+      // The ray parameters are fractions of the ray length
+      float* samples = &(this->RaySamples[((size_t)row * this->RayGridSize[0] + column) * this->NumberOfSamples]);
+      if (traversal->TraceRay(sourceVoxelPosition, rayEndVoxelPosition) > 0)
+      {
+        switch (scalarType)
+        {
+          vtkTemplateMacro( SampleRay(static_cast<const VTK_TT*>(inputPtr), traversal.GetPointer(),
+            lookupTable, this->LookupTableMinimumValue, lookupTableSize,
+            rayLength, this->FirstSampleDistance, this->SamplingStep, this->NumberOfSamples, samples) );
+        }
+      }
+      else
+      {
+        std::fill(samples, samples + this->NumberOfSamples, 0.0f);
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkWEDCalculator::ThreadedInterpolateSlices(int startSlice, int endSlice)
+{
+  int extent[6] = {0,-1,0,-1,0,-1};
+  this->OutputImageData->GetExtent(extent);
+  vtkSmartPointer<vtkMatrix4x4> outputImageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  this->OutputImageData->GetImageToWorldMatrix(outputImageToWorldMatrix);
+  double columnStep[3] = { outputImageToWorldMatrix->GetElement(0, 0),
+    outputImageToWorldMatrix->GetElement(1, 0), outputImageToWorldMatrix->GetElement(2, 0) };
+
+  int numberOfColumns = extent[1] - extent[0] + 1;
+  int numberOfRows = extent[3] - extent[2] + 1;
+  float* outputPtr = static_cast<float*>(this->OutputImageData->GetScalarPointer());
+  const float* raySamples = &(this->RaySamples[0]);
+  vtkIdType rayRowOffset = (vtkIdType)this->RayGridSize[0] * this->NumberOfSamples;
+
+  for (int slice = startSlice; slice < endSlice; ++slice)
+  {
+    for (int row = 0; row < numberOfRows; ++row)
+    {
+      float* outputRowPtr = outputPtr + ((vtkIdType)slice * numberOfRows + row) * numberOfColumns;
+      double rowStartIjk[4] = { (double)extent[0], (double)(extent[2] + row), (double)(extent[4] + slice), 1.0 };
+      double voxelPosition[4] = {0.0, 0.0, 0.0, 1.0};
+      outputImageToWorldMatrix->MultiplyPoint(rowStartIjk, voxelPosition);
+
+      for (int column = 0; column < numberOfColumns; ++column)
+      {
+        double sourceToVoxel[3] = { voxelPosition[0] - this->SourcePosition[0],
+          voxelPosition[1] - this->SourcePosition[1], voxelPosition[2] - this->SourcePosition[2] };
+        double projectionScale = this->SourceToIsocenterDistance / vtkMath::Dot(sourceToVoxel, this->BeamDirection);
+
+        // Continuous position in the ray grid and along the rays
+        double rayColumn = (vtkMath::Dot(sourceToVoxel, this->RayColumnDirection) * projectionScale - this->RayGridOrigin[0]) / this->RaySpacing;
+        double rayRow = (vtkMath::Dot(sourceToVoxel, this->RayRowDirection) * projectionScale - this->RayGridOrigin[1]) / this->RaySpacing;
+        double sample = (vtkMath::Norm(sourceToVoxel) - this->FirstSampleDistance) / this->SamplingStep;
+        int rayColumnIndex = 0, rayRowIndex = 0, sampleIndex = 0;
+        double rayColumnWeight = 0.0, rayRowWeight = 0.0, sampleWeight = 0.0;
+        GetInterpolationIndex(rayColumn, this->RayGridSize[0], rayColumnIndex, rayColumnWeight);
+        GetInterpolationIndex(rayRow, this->RayGridSize[1], rayRowIndex, rayRowWeight);
+        GetInterpolationIndex(sample, this->NumberOfSamples, sampleIndex, sampleWeight);
+
+        const float* ray00 = raySamples + ((vtkIdType)rayRowIndex * this->RayGridSize[0] + rayColumnIndex) * this->NumberOfSamples + sampleIndex;
+        const float* ray10 = ray00 + this->NumberOfSamples;
+        const float* ray01 = ray00 + rayRowOffset;
+        const float* ray11 = ray01 + this->NumberOfSamples;
+        double depth00 = ray00[0] + sampleWeight * (ray00[1] - ray00[0]);
+        double depth10 = ray10[0] + sampleWeight * (ray10[1] - ray10[0]);
+        double depth01 = ray01[0] + sampleWeight * (ray01[1] - ray01[0]);
+        double depth11 = ray11[0] + sampleWeight * (ray11[1] - ray11[0]);
+        outputRowPtr[column] = (float)( (1.0 - rayRowWeight) * (depth00 + rayColumnWeight * (depth10 - depth00))
+          + rayRowWeight * (depth01 + rayColumnWeight * (depth11 - depth01)) );
+
+        voxelPosition[0] += columnStep[0];
+        voxelPosition[1] += columnStep[1];
+        voxelPosition[2] += columnStep[2];
+      }
+    }
+  }
+}
@@ -0,0 +1,170 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#ifndef __vtkWEDCalculator_h
+#define __vtkWEDCalculator_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkMultiThreader.h>
+
+// STD includes
+#include <vector>
+
+#include "vtkSlicerExternalBeamPlanningModuleLogicExport.h"
+
+class vtkOrientedImageData;
+class vtkPiecewiseFunction;
+
+/// \ingroup SlicerRt_QtModules_ExternalBeamPlanning
+/// \class vtkWEDCalculator
+/// \brief Compute the water equivalent depth (radiological path length) from the source to every voxel of a dose grid.
+///
+/// Divergent rays are cast from the source through a regular grid in the isocenter plane covering the projection of
+/// the dose grid (\sa vtkVoxelRayTraversal). Along each ray the stopping power ratios (relative to water) looked up
+/// from the HU of the CT are accumulated, and the cumulative depth is sampled at regular distances from the source.
+/// The WED of a dose voxel is interpolated bilinearly between the four nearest rays and linearly between the two
+/// nearest samples. The samples of a ray are contiguous in memory and the dose voxels are visited in memory order,
+/// so neighboring voxels read the same rays. Both the ray tracing (by ray grid rows) and the interpolation (by dose
+/// grid slices) run in parallel.
+class VTK_SLICER_EXTERNALBEAMPLANNING_MODULE_LOGIC_EXPORT vtkWEDCalculator : public vtkObject
+{
+public:
+  static vtkWEDCalculator *New();
+  vtkTypeMacro(vtkWEDCalculator, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Set input CT volume (single component, any scalar type, HU, geometry in RAS)
+  void SetInputImageData(vtkOrientedImageData* imageData);
+  vtkGetObjectMacro(InputImageData, vtkOrientedImageData);
+
+  /// Set image defining the dose grid (only the extent and geometry are used). If not set, the CT lattice is used
+  void SetOutputGeometryImageData(vtkOrientedImageData* imageData);
+  vtkGetObjectMacro(OutputGeometryImageData, vtkOrientedImageData);
+
+  /// Get output WED volume (float, mm, on the dose grid). Outside the CT the stopping power ratio is zero (air)
+  vtkGetObjectMacro(OutputImageData, vtkOrientedImageData);
+
+  /// Set function mapping HU to stopping power ratio relative to water. If not set, the stopping power ratio
+  /// is estimated from the electron density: max(0, 1+HU/1000)
+  void SetStoppingPowerRatioFunction(vtkPiecewiseFunction* function);
+  vtkGetObjectMacro(StoppingPowerRatioFunction, vtkPiecewiseFunction);
+
+  /// Source position (RAS)
+  vtkSetVector3Macro(SourcePosition, double);
+  vtkGetVector3Macro(SourcePosition, double);
+
+  /// Isocenter position (RAS). The central axis points from the source to the isocenter
+  vtkSetVector3Macro(IsocenterPosition, double);
+  vtkGetVector3Macro(IsocenterPosition, double);
+
+  /// Distance between the rays in the isocenter plane (mm). Default is 2
+  vtkSetMacro(RaySpacing, double);
+  vtkGetMacro(RaySpacing, double);
+
+  /// Distance between the depth samples along the rays (mm). Default is 1
+  vtkSetMacro(SamplingStep, double);
+  vtkGetMacro(SamplingStep, double);
+
+  /// Number of threads used for the computation. By default the number of processors is used
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_MAX_THREADS);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Compute the WED volume
+  /// \return Success flag
+  bool Update();
+
+  /// Get number of ray columns and rows used in the last update
+  vtkGetVector2Macro(RayGridSize, int);
+
+  /// Trace the rays of a range of ray grid rows. Called from the worker threads
+  void ThreadedTraceRays(int startRow, int endRow);
+
+  /// Interpolate the WED of a range of output slices (counted from the first slice of the extent).
+  /// Called from the worker threads
+  void ThreadedInterpolateSlices(int startSlice, int endSlice);
+
+protected:
+  /// Build stopping power ratio lookup table for the HU range of the input
+  void BuildStoppingPowerRatioLookupTable();
+
+  /// Set up the ray grid covering the projection of the dose grid
+  bool InitializeRayGrid();
+
+protected:
+  vtkWEDCalculator();
+  virtual ~vtkWEDCalculator();
+
+protected:
+  /// Input CT volume
+  vtkOrientedImageData* InputImageData;
+  /// Image defining the dose grid
+  vtkOrientedImageData* OutputGeometryImageData;
+  /// Output WED volume
+  vtkOrientedImageData* OutputImageData;
+  /// Function mapping HU to stopping power ratio
+  vtkPiecewiseFunction* StoppingPowerRatioFunction;
+
+  /// Source position
+  double SourcePosition[3];
+  /// Isocenter position
+  double IsocenterPosition[3];
+  /// Distance between the rays in the isocenter plane
+  double RaySpacing;
+  /// Distance between the depth samples
+  double SamplingStep;
+  /// Number of threads
+  int NumberOfThreads;
+
+  /// Stopping power ratio for each HU value from LookupTableMinimumValue
+  std::vector<double> StoppingPowerRatioLookupTable;
+  /// HU value of the first lookup table entry
+  int LookupTableMinimumValue;
+  /// RAS to continuous voxel coordinates of the input (4x4 row-major, voxel (0,0,0) is the first voxel of the extent)
+  double WorldToVoxelMatrix[16];
+
+  /// Unit vector from the source to the isocenter
+  double BeamDirection[3];
+  /// Unit vector of the ray grid columns (perpendicular to the beam)
+  double RayColumnDirection[3];
+  /// Unit vector of the ray grid rows (perpendicular to the beam and the columns)
+  double RayRowDirection[3];
+  /// Distance from the source to the isocenter plane
+  double SourceToIsocenterDistance;
+  /// Position of the first ray in the isocenter plane along the columns and rows, relative to the central axis
+  double RayGridOrigin[2];
+  /// Number of ray columns and rows
+  int RayGridSize[2];
+  /// Distance of the first depth sample from the source
+  double FirstSampleDistance;
+  /// Number of depth samples per ray
+  int NumberOfSamples;
+  /// Cumulative WED samples of all rays, ray by ray (row-major ray grid)
+  std::vector<float> RaySamples;
+
+  /// Multithreader tracing the rays and interpolating the output
+  vtkMultiThreader* Threader;
+
+private:
+  vtkWEDCalculator(const vtkWEDCalculator&); // Not implemented
+  void operator=(const vtkWEDCalculator&);   // Not implemented
+};
+
+#endif
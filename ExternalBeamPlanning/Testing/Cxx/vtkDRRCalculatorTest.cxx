@@ -0,0 +1,159 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// ExternalBeamPlanning includes
+#include "vtkDRRCalculator.h"
+
+// Segmentations includes
+#include "vtkOrientedImageData.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+  static const double TOLERANCE = 1.0e-4;
+
+  /// Uniform water cube phantom of 40 mm edge centered at the origin
+  static const int PHANTOM_DIMENSION = 20;
+  static const double PHANTOM_SPACING = 2.0;
+  static const double PHANTOM_HALF_EDGE = 0.5 * PHANTOM_DIMENSION * PHANTOM_SPACING;
+  static const double WATER_ATTENUATION_COEFFICIENT = 0.02;
+
+  /// Source and detector on the A-P axis
+  static const double SOURCE_Y = -1000.0;
+  static const double DETECTOR_Y = 500.0;
+  static const int DETECTOR_SIZE = 5;
+  static const double DETECTOR_SPACING = 10.0;
+
+  //----------------------------------------------------------------------------
+  /// Compare each DRR pixel to the line integral of the attenuation through the phantom. The rays of the detector
+  /// centered on the axis enter and leave through the anterior and posterior faces of the cube, so the length of
+  /// the ray in the phantom is the edge length divided by the cosine of the ray angle
+  bool CheckDRR(vtkDRRCalculator* drrCalculator, const char* caseName, double detectorOffsetX)
+  {
+    if (!drrCalculator->Update())
+    {
+      std::cerr << __LINE__ << ": Failed to compute DRR " << caseName << std::endl;
+      return false;
+    }
+
+    vtkOrientedImageData* drrImage = drrCalculator->GetOutputImageData();
+    int dimensions[3] = {0, 0, 0};
+    drrImage->GetDimensions(dimensions);
+    if (dimensions[0] != DETECTOR_SIZE || dimensions[1] != DETECTOR_SIZE || dimensions[2] != 1)
+    {
+      std::cerr << __LINE__ << ": DRR " << caseName << " has dimensions " << dimensions[0] << ", " << dimensions[1]
+        << ", " << dimensions[2] << " (expected " << DETECTOR_SIZE << ", " << DETECTOR_SIZE << ", 1)" << std::endl;
+      return false;
+    }
+
+    float* drrPtr = static_cast<float*>(drrImage->GetScalarPointer());
+    for (int row=0; row<DETECTOR_SIZE; ++row)
+    {
+      for (int column=0; column<DETECTOR_SIZE; ++column)
+      {
+        double pixelX = detectorOffsetX + (column - 0.5 * (DETECTOR_SIZE - 1)) * DETECTOR_SPACING;
+        double pixelZ = (row - 0.5 * (DETECTOR_SIZE - 1)) * DETECTOR_SPACING;
+        double sourceToDetectorDistance = DETECTOR_Y - SOURCE_Y;
+        double rayLength = sqrt(pixelX*pixelX + sourceToDetectorDistance*sourceToDetectorDistance + pixelZ*pixelZ);
+
+        double expectedIntegral = 0.0;
+        if (detectorOffsetX == 0.0)
+        {
+          expectedIntegral = WATER_ATTENUATION_COEFFICIENT * 2.0 * PHANTOM_HALF_EDGE * rayLength / sourceToDetectorDistance;
+        }
+        double integral = drrPtr[row * DETECTOR_SIZE + column];
+        if (fabs(integral - expectedIntegral) > TOLERANCE * std::max(1.0, expectedIntegral))
+        {
+          std::cerr << __LINE__ << ": DRR " << caseName << " pixel (" << column << ", " << row << ") is " << integral
+            << " (expected " << expectedIntegral << ")" << std::endl;
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkDRRCalculatorTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  // Uniform water phantom (0 HU)
+  vtkSmartPointer<vtkOrientedImageData> phantomImage = vtkSmartPointer<vtkOrientedImageData>::New();
+  phantomImage->SetExtent(0, PHANTOM_DIMENSION-1, 0, PHANTOM_DIMENSION-1, 0, PHANTOM_DIMENSION-1);
+  phantomImage->SetSpacing(PHANTOM_SPACING, PHANTOM_SPACING, PHANTOM_SPACING);
+  double origin = -PHANTOM_HALF_EDGE + 0.5 * PHANTOM_SPACING;
+  phantomImage->SetOrigin(origin, origin, origin);
+  phantomImage->AllocateScalars(VTK_SHORT, 1);
+  short* phantomPtr = static_cast<short*>(phantomImage->GetScalarPointer());
+  for (int voxel=0; voxel<PHANTOM_DIMENSION*PHANTOM_DIMENSION*PHANTOM_DIMENSION; ++voxel)
+  {
+    phantomPtr[voxel] = 0;
+  }
+
+  vtkSmartPointer<vtkDRRCalculator> drrCalculator = vtkSmartPointer<vtkDRRCalculator>::New();
+  drrCalculator->SetInputImageData(phantomImage);
+  drrCalculator->SetWaterAttenuationCoefficient(WATER_ATTENUATION_COEFFICIENT);
+  drrCalculator->SetSourcePosition(0.0, SOURCE_Y, 0.0);
+  drrCalculator->SetDetectorCenter(0.0, DETECTOR_Y, 0.0);
+  drrCalculator->SetDetectorColumnDirection(1.0, 0.0, 0.0);
+  drrCalculator->SetDetectorRowDirection(0.0, 0.0, 1.0);
+  drrCalculator->SetDetectorSize(DETECTOR_SIZE, DETECTOR_SIZE);
+  drrCalculator->SetDetectorSpacing(DETECTOR_SPACING, DETECTOR_SPACING);
+
+  // The detector rows are split between the threads, so the result must not depend on the number of threads
+  drrCalculator->SetNumberOfThreads(1);
+  if (!CheckDRR(drrCalculator, "with one thread", 0.0))
+  {
+    return EXIT_FAILURE;
+  }
+  drrCalculator->SetNumberOfThreads(3);
+  if (!CheckDRR(drrCalculator, "with three threads", 0.0))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // The detector directions are normalized for the computation without modifying the set values
+  drrCalculator->SetDetectorColumnDirection(2.0, 0.0, 0.0);
+  drrCalculator->SetDetectorRowDirection(0.0, 0.0, 0.5);
+  vtkMTimeType directionsMTime = drrCalculator->GetMTime();
+  if (!CheckDRR(drrCalculator, "with unnormalized directions", 0.0))
+  {
+    return EXIT_FAILURE;
+  }
+  if ( drrCalculator->GetMTime() != directionsMTime
+    || drrCalculator->GetDetectorColumnDirection()[0] != 2.0 || drrCalculator->GetDetectorRowDirection()[2] != 0.5 )
+  {
+    std::cerr << __LINE__ << ": DRR computation modified the detector directions" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Rays passing beside the phantom
+  drrCalculator->SetDetectorCenter(300.0, DETECTOR_Y, 0.0);
+  if (!CheckDRR(drrCalculator, "beside the phantom", 300.0))
+  {
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "DRR calculator test passed" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,294 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// ExternalBeamPlanning includes
+#include "vtkSlicerExternalBeamPlanningModuleLogic.h"
+
+// Beams includes
+#include "vtkMRMLRTBeamNode.h"
+#include "vtkMRMLRTPlanNode.h"
+#include "vtkSlicerBeamsModuleLogic.h"
+
+// Segmentations includes
+#include "vtkOrientedImageData.h"
+
+// Subject Hierarchy includes
+#include "vtkSlicerSubjectHierarchyModuleLogic.h"
+
+// MRML includes
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+  static const double TOLERANCE = 1.0e-6;
+
+  /// Uniform water cube phantom of 20 mm edge around the isocenter
+  static const int PHANTOM_DIMENSION = 10;
+  static const double PHANTOM_SPACING = 2.0;
+
+  //----------------------------------------------------------------------------
+  bool CheckDirection(const double direction[3], const double expectedDirection[3], const char* caseName, const char* directionName)
+  {
+    if ( fabs(direction[0] - expectedDirection[0]) > TOLERANCE || fabs(direction[1] - expectedDirection[1]) > TOLERANCE
+      || fabs(direction[2] - expectedDirection[2]) > TOLERANCE )
+    {
+      std::cerr << "DRR " << caseName << " has " << directionName << " direction " << direction[0] << ", " << direction[1]
+        << ", " << direction[2] << " (expected " << expectedDirection[0] << ", " << expectedDirection[1] << ", "
+        << expectedDirection[2] << ")" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Compute the DRR of a beam and compare the detector geometry to the expected one: the column and row directions
+  /// are the IEC collimator x and y axes in RAS, and the detector is centered on the beam axis opposite to the source
+  bool CheckDRRGeometry(vtkSlicerExternalBeamPlanningModuleLogic* logic, vtkMRMLRTBeamNode* beamNode, const char* caseName,
+    const double expectedSourceDirection[3], const double expectedColumnDirection[3], const double expectedRowDirection[3])
+  {
+    std::string errorMessage = logic->UpdateDRR(beamNode);
+    vtkMRMLScalarVolumeNode* drrVolumeNode = beamNode->GetDRRVolumeNode();
+    if (!errorMessage.empty() || !drrVolumeNode || !drrVolumeNode->GetImageData())
+    {
+      std::cerr << "Failed to compute DRR " << caseName << ": " << errorMessage << std::endl;
+      return false;
+    }
+
+    vtkSmartPointer<vtkMatrix4x4> ijkToRasMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    drrVolumeNode->GetIJKToRASMatrix(ijkToRasMatrix);
+    double columnDirection[3] = {0.0, 0.0, 0.0};
+    double rowDirection[3] = {0.0, 0.0, 0.0};
+    for (int axis=0; axis<3; ++axis)
+    {
+      columnDirection[axis] = ijkToRasMatrix->GetElement(axis, 0);
+      rowDirection[axis] = ijkToRasMatrix->GetElement(axis, 1);
+    }
+    vtkMath::Normalize(columnDirection);
+    vtkMath::Normalize(rowDirection);
+
+    int dimensions[3] = {0, 0, 0};
+    drrVolumeNode->GetImageData()->GetDimensions(dimensions);
+    double detectorCenterIjk[4] = { 0.5 * (dimensions[0] - 1), 0.5 * (dimensions[1] - 1), 0.0, 1.0 };
+    double detectorCenter[4] = {0.0, 0.0, 0.0, 1.0};
+    ijkToRasMatrix->MultiplyPoint(detectorCenterIjk, detectorCenter);
+    double isocenterPosition[3] = {0.0, 0.0, 0.0};
+    beamNode->GetPlanIsocenterPosition(isocenterPosition);
+    double isocenterToDetectorDirection[3] = { detectorCenter[0] - isocenterPosition[0],
+      detectorCenter[1] - isocenterPosition[1], detectorCenter[2] - isocenterPosition[2] };
+    vtkMath::Normalize(isocenterToDetectorDirection);
+    double expectedIsocenterToDetectorDirection[3] = { -expectedSourceDirection[0], -expectedSourceDirection[1], -expectedSourceDirection[2] };
+
+    return CheckDirection(columnDirection, expectedColumnDirection, caseName, "column")
+      && CheckDirection(rowDirection, expectedRowDirection, caseName, "row")
+      && CheckDirection(isocenterToDetectorDirection, expectedIsocenterToDetectorDirection, caseName, "isocenter to detector");
+  }
+
+  //----------------------------------------------------------------------------
+  /// Get the WED volume of a beam and check whether the cached volume was returned. The previous volume is kept
+  /// referenced, so a recomputed volume cannot be allocated at the same address
+  bool CheckWEDCache(vtkSlicerExternalBeamPlanningModuleLogic* logic, vtkMRMLRTBeamNode* beamNode, const char* stepName,
+    bool expectCached, vtkSmartPointer<vtkOrientedImageData>& previousWEDImageData)
+  {
+    vtkMTimeType previousWEDMTime = (previousWEDImageData.GetPointer() ? previousWEDImageData->GetMTime() : 0);
+    vtkOrientedImageData* wedImageData = logic->GetWEDImageData(beamNode);
+    if (!wedImageData)
+    {
+      std::cerr << "Failed to get WED volume " << stepName << std::endl;
+      return false;
+    }
+    bool cached = (wedImageData == previousWEDImageData.GetPointer() && wedImageData->GetMTime() == previousWEDMTime);
+    if (cached != expectCached)
+    {
+      std::cerr << "WED volume was " << (cached ? "returned from the cache " : "recomputed ") << stepName << std::endl;
+      return false;
+    }
+    previousWEDImageData = wedImageData;
+    return true;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerExternalBeamPlanningModuleLogicTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkSmartPointer<vtkMRMLScene> mrmlScene = vtkSmartPointer<vtkMRMLScene>::New();
+
+  vtkNew<vtkSlicerSubjectHierarchyModuleLogic> subjectHierarchyLogic;
+  subjectHierarchyLogic->SetMRMLScene(mrmlScene);
+  vtkNew<vtkSlicerBeamsModuleLogic> beamsLogic;
+  beamsLogic->SetMRMLScene(mrmlScene);
+  vtkNew<vtkSlicerExternalBeamPlanningModuleLogic> externalBeamPlanningLogic;
+  externalBeamPlanningLogic->SetMRMLScene(mrmlScene);
+  externalBeamPlanningLogic->SetBeamsLogic(beamsLogic.GetPointer());
+
+  // Plan with a uniform water phantom (0 HU) as reference volume, the isocenter at its center
+  double isocenter[3] = {10.0, -20.0, 30.0};
+  vtkSmartPointer<vtkImageData> phantomImage = vtkSmartPointer<vtkImageData>::New();
+  phantomImage->SetExtent(0, PHANTOM_DIMENSION-1, 0, PHANTOM_DIMENSION-1, 0, PHANTOM_DIMENSION-1);
+  phantomImage->AllocateScalars(VTK_SHORT, 1);
+  short* phantomPtr = static_cast<short*>(phantomImage->GetScalarPointer());
+  for (int voxel=0; voxel<PHANTOM_DIMENSION*PHANTOM_DIMENSION*PHANTOM_DIMENSION; ++voxel)
+  {
+    phantomPtr[voxel] = 0;
+  }
+  vtkSmartPointer<vtkMRMLScalarVolumeNode> referenceVolumeNode = vtkSmartPointer<vtkMRMLScalarVolumeNode>::New();
+  referenceVolumeNode->SetName("TestReferenceVolume");
+  referenceVolumeNode->SetSpacing(PHANTOM_SPACING, PHANTOM_SPACING, PHANTOM_SPACING);
+  double phantomOriginOffset = -0.5 * (PHANTOM_DIMENSION - 1) * PHANTOM_SPACING;
+  referenceVolumeNode->SetOrigin(isocenter[0] + phantomOriginOffset, isocenter[1] + phantomOriginOffset, isocenter[2] + phantomOriginOffset);
+  referenceVolumeNode->SetAndObserveImageData(phantomImage);
+  mrmlScene->AddNode(referenceVolumeNode);
+
+  vtkSmartPointer<vtkMRMLRTPlanNode> planNode = vtkSmartPointer<vtkMRMLRTPlanNode>::New();
+  planNode->SetName("TestPlan");
+  mrmlScene->AddNode(planNode);
+  planNode->SetAndObserveReferenceVolumeNode(referenceVolumeNode);
+  planNode->SetIsocenterSpecification(vtkMRMLRTPlanNode::ArbitraryPoint);
+  if (!planNode->SetIsocenterPosition(isocenter))
+  {
+    std::cerr << __LINE__ << ": Failed to set plan isocenter" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkMRMLRTBeamNode> beamNode = vtkSmartPointer<vtkMRMLRTBeamNode>::New();
+  beamNode->SetName(planNode->GenerateNewBeamName().c_str());
+  mrmlScene->AddNode(beamNode);
+  planNode->AddBeam(beamNode);
+
+  // Zero angles: the source is posterior, the columns go right and the rows superior
+  {
+    const double sourceDirection[3] = {0.0, -1.0, 0.0};
+    const double columnDirection[3] = {1.0, 0.0, 0.0};
+    const double rowDirection[3] = {0.0, 0.0, 1.0};
+    if (!CheckDRRGeometry(externalBeamPlanningLogic.GetPointer(), beamNode, "at zero angles", sourceDirection, columnDirection, rowDirection))
+    {
+      std::cerr << __LINE__ << ": DRR geometry check failed" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // The source is on the same side as the one of the beam model
+  beamNode->SetGantryAngle(90.0);
+  {
+    double beamSourcePosition[3] = {0.0, 0.0, 0.0};
+    beamNode->CalculateSourcePosition(beamSourcePosition);
+    double sourceDirection[3] = { beamSourcePosition[0] - isocenter[0], beamSourcePosition[1] - isocenter[1], beamSourcePosition[2] - isocenter[2] };
+    vtkMath::Normalize(sourceDirection);
+    const double columnDirection[3] = {0.0, 1.0, 0.0};
+    const double rowDirection[3] = {0.0, 0.0, 1.0};
+    if (!CheckDRRGeometry(externalBeamPlanningLogic.GetPointer(), beamNode, "at gantry 90", sourceDirection, columnDirection, rowDirection))
+    {
+      std::cerr << __LINE__ << ": DRR geometry check failed" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // The detector rotates with the collimator, counterclockwise as seen from the source
+  beamNode->SetGantryAngle(0.0);
+  beamNode->SetCollimatorAngle(90.0);
+  {
+    const double sourceDirection[3] = {0.0, -1.0, 0.0};
+    const double columnDirection[3] = {0.0, 0.0, 1.0};
+    const double rowDirection[3] = {-1.0, 0.0, 0.0};
+    if (!CheckDRRGeometry(externalBeamPlanningLogic.GetPointer(), beamNode, "at collimator 90", sourceDirection, columnDirection, rowDirection))
+    {
+      std::cerr << __LINE__ << ": DRR geometry check failed" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Beam along the superior-inferior axis, where the detector axes cannot be derived from the beam direction alone
+  beamNode->SetGantryAngle(90.0);
+  beamNode->SetCollimatorAngle(0.0);
+  beamNode->SetCouchAngle(90.0);
+  {
+    const double sourceDirection[3] = {0.0, 0.0, -1.0};
+    const double columnDirection[3] = {0.0, 1.0, 0.0};
+    const double rowDirection[3] = {1.0, 0.0, 0.0};
+    if (!CheckDRRGeometry(externalBeamPlanningLogic.GetPointer(), beamNode, "at gantry 90 couch 90", sourceDirection, columnDirection, rowDirection))
+    {
+      std::cerr << __LINE__ << ": DRR geometry check failed" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // The WED volume is only recomputed if the beam geometry, the reference voxels or the computation parameters change
+  vtkSmartPointer<vtkOrientedImageData> wedImageData;
+  vtkSlicerExternalBeamPlanningModuleLogic* logic = externalBeamPlanningLogic.GetPointer();
+  if (!CheckWEDCache(logic, beamNode, "on the first call", false, wedImageData))
+  {
+    std::cerr << __LINE__ << ": WED cache check failed" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!CheckWEDCache(logic, beamNode, "with unchanged inputs", true, wedImageData))
+  {
+    std::cerr << __LINE__ << ": WED cache check failed" << std::endl;
+    return EXIT_FAILURE;
+  }
+  referenceVolumeNode->GetImageData()->Modified();
+  if (!CheckWEDCache(logic, beamNode, "after modifying the reference voxels", false, wedImageData))
+  {
+    std::cerr << __LINE__ << ": WED cache check failed" << std::endl;
+    return EXIT_FAILURE;
+  }
+  beamNode->SetGantryAngle(180.0);
+  if (!CheckWEDCache(logic, beamNode, "after changing the gantry angle", false, wedImageData))
+  {
+    std::cerr << __LINE__ << ": WED cache check failed" << std::endl;
+    return EXIT_FAILURE;
+  }
+  logic->SetWEDRaySpacing(1.0);
+  if (!CheckWEDCache(logic, beamNode, "after changing the ray spacing", false, wedImageData))
+  {
+    std::cerr << __LINE__ << ": WED cache check failed" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkSmartPointer<vtkPiecewiseFunction> stoppingPowerRatioFunction = vtkSmartPointer<vtkPiecewiseFunction>::New();
+  stoppingPowerRatioFunction->AddPoint(-1000.0, 0.0);
+  stoppingPowerRatioFunction->AddPoint(1000.0, 2.0);
+  logic->SetWEDStoppingPowerRatioFunction(stoppingPowerRatioFunction);
+  if (!CheckWEDCache(logic, beamNode, "after setting the stopping power ratio function", false, wedImageData))
+  {
+    std::cerr << __LINE__ << ": WED cache check failed" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!CheckWEDCache(logic, beamNode, "with the same stopping power ratio function", true, wedImageData))
+  {
+    std::cerr << __LINE__ << ": WED cache check failed" << std::endl;
+    return EXIT_FAILURE;
+  }
+  stoppingPowerRatioFunction->AddPoint(0.0, 1.1);
+  if (!CheckWEDCache(logic, beamNode, "after modifying the stopping power ratio function", false, wedImageData))
+  {
+    std::cerr << __LINE__ << ": WED cache check failed" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "External beam planning logic test passed" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,171 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// ExternalBeamPlanning includes
+#include "vtkVoxelRayTraversal.h"
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+  static const double TOLERANCE = 1.0e-9;
+
+  //----------------------------------------------------------------------------
+  /// Trace a ray and check the number of intersected voxels, that consecutive voxels are neighbors,
+  /// and that the intersection lengths sum to the length of the ray segment clipped to the image box
+  bool CheckRay(vtkVoxelRayTraversal* traversal, const char* rayName, double startPoint[3], double endPoint[3],
+    int expectedNumberOfVoxels, double expectedClippedLength)
+  {
+    int numberOfVoxels = traversal->TraceRay(startPoint, endPoint);
+    if (numberOfVoxels != expectedNumberOfVoxels || traversal->GetNumberOfIntersectedVoxels() != expectedNumberOfVoxels)
+    {
+      std::cerr << __LINE__ << ": " << rayName << " ray intersects " << numberOfVoxels << " voxels (expected "
+        << expectedNumberOfVoxels << ")" << std::endl;
+      return false;
+    }
+    if (numberOfVoxels == 0)
+    {
+      return true;
+    }
+
+    int* dimensions = traversal->GetDimensions();
+    const vtkIdType* voxelIndices = traversal->GetVoxelIndices();
+    const double* boundaryParameters = traversal->GetBoundaryParameters();
+    double rayLength = sqrt(vtkMath::Distance2BetweenPoints(startPoint, endPoint));
+    double lengthSum = 0.0;
+    for (int voxel=0; voxel<numberOfVoxels; ++voxel)
+    {
+      double intersectionLength = (boundaryParameters[voxel+1] - boundaryParameters[voxel]) * rayLength;
+      if (intersectionLength <= 0.0)
+      {
+        std::cerr << __LINE__ << ": " << rayName << " ray has a zero length intersection with voxel " << voxelIndices[voxel] << std::endl;
+        return false;
+      }
+      lengthSum += intersectionLength;
+
+      // Consecutive voxels share a face, or an edge or a corner where the ray crosses several planes at once
+      if (voxel > 0)
+      {
+        vtkIdType sliceSize = (vtkIdType)dimensions[0] * dimensions[1];
+        vtkIdType previousIndex = voxelIndices[voxel-1];
+        vtkIdType index = voxelIndices[voxel];
+        vtkIdType steps[3] = {
+          index % dimensions[0] - previousIndex % dimensions[0],
+          (index % sliceSize) / dimensions[0] - (previousIndex % sliceSize) / dimensions[0],
+          index / sliceSize - previousIndex / sliceSize };
+        if ( steps[0] < -1 || steps[0] > 1 || steps[1] < -1 || steps[1] > 1 || steps[2] < -1 || steps[2] > 1
+          || (steps[0] == 0 && steps[1] == 0 && steps[2] == 0) )
+        {
+          std::cerr << __LINE__ << ": " << rayName << " ray jumps from voxel " << voxelIndices[voxel-1] << " to voxel "
+            << voxelIndices[voxel] << std::endl;
+          return false;
+        }
+      }
+    }
+    if (fabs(lengthSum - expectedClippedLength) > TOLERANCE)
+    {
+      std::cerr << __LINE__ << ": " << rayName << " ray intersection lengths sum to " << lengthSum
+        << " (expected clipped segment length " << expectedClippedLength << ")" << std::endl;
+      return false;
+    }
+    return true;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkVoxelRayTraversalTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkSmartPointer<vtkVoxelRayTraversal> traversal = vtkSmartPointer<vtkVoxelRayTraversal>::New();
+  int dimensions[3] = {4, 3, 5};
+  traversal->SetDimensions(dimensions);
+
+  // Axial ray through the voxel centers, clipped at both ends
+  double axialStart[3] = {1.0, 1.0, -2.0};
+  double axialEnd[3] = {1.0, 1.0, 7.0};
+  if (!CheckRay(traversal, "Axial", axialStart, axialEnd, 5, 5.0))
+  {
+    return EXIT_FAILURE;
+  }
+  for (int k=0; k<dimensions[2]; ++k)
+  {
+    vtkIdType expectedVoxelIndex = 1 + 1 * dimensions[0] + k * dimensions[0] * dimensions[1];
+    if (traversal->GetVoxelIndices()[k] != expectedVoxelIndex)
+    {
+      std::cerr << __LINE__ << ": Axial ray intersects voxel " << traversal->GetVoxelIndices()[k] << " at position " << k
+        << " (expected " << expectedVoxelIndex << ")" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Diagonal ray through voxel corners: the voxels touching the ray only at a corner or an edge are not intersected
+  double diagonalStart[3] = {-1.5, -1.5, -1.5};
+  double diagonalEnd[3] = {2.5, 2.5, 2.5};
+  if (!CheckRay(traversal, "Diagonal", diagonalStart, diagonalEnd, 3, 3.0 * sqrt(3.0)))
+  {
+    return EXIT_FAILURE;
+  }
+  for (int voxel=0; voxel<3; ++voxel)
+  {
+    vtkIdType expectedVoxelIndex = voxel + voxel * dimensions[0] + voxel * dimensions[0] * dimensions[1];
+    if (traversal->GetVoxelIndices()[voxel] != expectedVoxelIndex)
+    {
+      std::cerr << __LINE__ << ": Diagonal ray intersects voxel " << traversal->GetVoxelIndices()[voxel]
+        << " at position " << voxel << " (expected " << expectedVoxelIndex << ")" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Oblique ray entering and leaving through the X faces, crossing three X, one Y and two Z planes inside
+  double obliqueStart[3] = {-2.5, 0.1, 0.2};
+  double obliqueEnd[3] = {5.5, 2.1, 4.2};
+  if ( !CheckRay(traversal, "Oblique", obliqueStart, obliqueEnd, 7, 0.5 * sqrt(8.0*8.0 + 2.0*2.0 + 4.0*4.0))
+    || !CheckRay(traversal, "Reverse oblique", obliqueEnd, obliqueStart, 7, 0.5 * sqrt(8.0*8.0 + 2.0*2.0 + 4.0*4.0)) )
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Ray segment inside the image is not clipped
+  double insideStart[3] = {0.1, 0.2, 0.3};
+  double insideEnd[3] = {3.2, 1.9, 4.1};
+  if (!CheckRay( traversal, "Inside", insideStart, insideEnd, 1 + 3 + 2 + 4,
+    sqrt(vtkMath::Distance2BetweenPoints(insideStart, insideEnd)) ))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Rays missing the image: passing beside it, lying on its boundary plane, and ending before reaching it
+  double besideStart[3] = {-2.0, 5.0, 1.0};
+  double besideEnd[3] = {6.0, 5.0, 1.0};
+  double boundaryStart[3] = {-2.0, -0.5, 1.0};
+  double boundaryEnd[3] = {6.0, -0.5, 1.0};
+  double shortStart[3] = {-5.0, 1.0, 1.0};
+  double shortEnd[3] = {-1.0, 1.0, 1.0};
+  if ( !CheckRay(traversal, "Beside", besideStart, besideEnd, 0, 0.0)
+    || !CheckRay(traversal, "Boundary", boundaryStart, boundaryEnd, 0, 0.0)
+    || !CheckRay(traversal, "Short", shortStart, shortEnd, 0, 0.0) )
+  {
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Voxel ray traversal test passed" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,153 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// ExternalBeamPlanning includes
+#include "vtkWEDCalculator.h"
+
+// Segmentations includes
+#include "vtkOrientedImageData.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+  static const double TOLERANCE = 0.01; // mm
+
+  /// Water cube phantom of 100 mm edge centered at the origin, with a 20 mm thick bone slab
+  /// (1000 HU, stopping power ratio 2) perpendicular to the A-P axis at its center
+  static const int PHANTOM_DIMENSION = 20;
+  static const double PHANTOM_SPACING = 5.0;
+  static const double PHANTOM_HALF_EDGE = 0.5 * PHANTOM_DIMENSION * PHANTOM_SPACING;
+  static const double SLAB_HALF_THICKNESS = 10.0;
+  static const short SLAB_VALUE = 1000;
+  static const double SLAB_STOPPING_POWER_RATIO = 2.0;
+
+  /// Source on the A-P axis, beam pointing anterior
+  static const double SOURCE_Y = -1000.0;
+
+  //----------------------------------------------------------------------------
+  /// Water equivalent thickness of the phantom layers between its posterior face and the given A-P position
+  double GetWaterEquivalentThickness(double y)
+  {
+    double slabThickness = std::min(std::max(y, -SLAB_HALF_THICKNESS), SLAB_HALF_THICKNESS) + SLAB_HALF_THICKNESS;
+    return (y + PHANTOM_HALF_EDGE) + (SLAB_STOPPING_POWER_RATIO - 1.0) * slabThickness;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Compare the WED of each output voxel to the analytic value. The rays enter the phantom through its posterior
+  /// face, so the path length in each layer is its thickness divided by the cosine of the ray angle
+  bool CheckWED(vtkWEDCalculator* wedCalculator, const char* caseName)
+  {
+    if (!wedCalculator->Update())
+    {
+      std::cerr << __LINE__ << ": Failed to compute WED " << caseName << std::endl;
+      return false;
+    }
+
+    vtkOrientedImageData* wedImage = wedCalculator->GetOutputImageData();
+    int extent[6] = {0, -1, 0, -1, 0, -1};
+    wedImage->GetExtent(extent);
+    double origin[3] = {0.0, 0.0, 0.0};
+    wedImage->GetOrigin(origin);
+    double spacing[3] = {0.0, 0.0, 0.0};
+    wedImage->GetSpacing(spacing);
+    for (int k=extent[4]; k<=extent[5]; ++k)
+    {
+      for (int j=extent[2]; j<=extent[3]; ++j)
+      {
+        for (int i=extent[0]; i<=extent[1]; ++i)
+        {
+          double position[3] = { origin[0] + i * spacing[0], origin[1] + j * spacing[1], origin[2] + k * spacing[2] };
+          double sourceToVoxelDistance = sqrt( position[0]*position[0]
+            + (position[1] - SOURCE_Y)*(position[1] - SOURCE_Y) + position[2]*position[2] );
+          double cosine = (position[1] - SOURCE_Y) / sourceToVoxelDistance;
+          double expectedWED = GetWaterEquivalentThickness(position[1]) / cosine;
+
+          double wed = wedImage->GetScalarComponentAsDouble(i, j, k, 0);
+          if (fabs(wed - expectedWED) > TOLERANCE)
+          {
+            std::cerr << __LINE__ << ": WED " << caseName << " at (" << position[0] << ", " << position[1] << ", "
+              << position[2] << ") is " << wed << " mm (expected " << expectedWED << " mm)" << std::endl;
+            return false;
+          }
+        }
+      }
+    }
+    return true;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkWEDCalculatorTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  // Water phantom with bone slab
+  vtkSmartPointer<vtkOrientedImageData> phantomImage = vtkSmartPointer<vtkOrientedImageData>::New();
+  phantomImage->SetExtent(0, PHANTOM_DIMENSION-1, 0, PHANTOM_DIMENSION-1, 0, PHANTOM_DIMENSION-1);
+  phantomImage->SetSpacing(PHANTOM_SPACING, PHANTOM_SPACING, PHANTOM_SPACING);
+  double phantomOrigin = -PHANTOM_HALF_EDGE + 0.5 * PHANTOM_SPACING;
+  phantomImage->SetOrigin(phantomOrigin, phantomOrigin, phantomOrigin);
+  phantomImage->AllocateScalars(VTK_SHORT, 1);
+  short* phantomPtr = static_cast<short*>(phantomImage->GetScalarPointer());
+  for (int k=0; k<PHANTOM_DIMENSION; ++k)
+  {
+    for (int j=0; j<PHANTOM_DIMENSION; ++j)
+    {
+      double y = phantomOrigin + j * PHANTOM_SPACING;
+      short value = (fabs(y) < SLAB_HALF_THICKNESS ? SLAB_VALUE : 0);
+      for (int i=0; i<PHANTOM_DIMENSION; ++i)
+      {
+        *(phantomPtr++) = value;
+      }
+    }
+  }
+
+  // Dose grid in the middle of the phantom along the whole beam path. The voxel centers are half a voxel
+  // away from the slab faces, so the depth samples around them are in the same material
+  vtkSmartPointer<vtkOrientedImageData> doseGridImage = vtkSmartPointer<vtkOrientedImageData>::New();
+  doseGridImage->SetExtent(0, 8, 0, PHANTOM_DIMENSION-1, 0, 8);
+  doseGridImage->SetSpacing(PHANTOM_SPACING, PHANTOM_SPACING, PHANTOM_SPACING);
+  doseGridImage->SetOrigin(-4.0 * PHANTOM_SPACING, phantomOrigin, -4.0 * PHANTOM_SPACING);
+
+  vtkSmartPointer<vtkWEDCalculator> wedCalculator = vtkSmartPointer<vtkWEDCalculator>::New();
+  wedCalculator->SetInputImageData(phantomImage);
+  wedCalculator->SetOutputGeometryImageData(doseGridImage);
+  wedCalculator->SetSourcePosition(0.0, SOURCE_Y, 0.0);
+  wedCalculator->SetIsocenterPosition(0.0, 0.0, 0.0);
+  wedCalculator->SetRaySpacing(2.0);
+  wedCalculator->SetSamplingStep(1.0);
+
+  // The ray grid rows and the output slices are split between the threads, so the result must not depend
+  // on the number of threads
+  wedCalculator->SetNumberOfThreads(1);
+  if (!CheckWED(wedCalculator, "with one thread"))
+  {
+    return EXIT_FAILURE;
+  }
+  wedCalculator->SetNumberOfThreads(3);
+  if (!CheckWED(wedCalculator, "with three threads"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "WED calculator test passed" << std::endl;
+  return EXIT_SUCCESS;
+}
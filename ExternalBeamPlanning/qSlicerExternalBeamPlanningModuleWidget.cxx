@@ -1024,36 +1024,49 @@ void qSlicerExternalBeamPlanningModuleWidget::calculateWEDClicked()
     return;
   }
 
-  /// GCS FIX TODO *** Implementation needs work ***
-
-#if defined (commentout)
-  vtkMRMLExternalBeamPlanningNode* paramNode = d->logic()->GetExternalBeamPlanningNode();
-  if (!paramNode)
-  {
-    return;
-  }
-
-  // Make sure inputs were specified - only CT needed
-  vtkMRMLScalarVolumeNode* referenceVolume = planNode->GetReferenceVolumeNode();
-  if (!referenceVolume)
+  vtkMRMLRTPlanNode* rtPlanNode = vtkMRMLRTPlanNode::SafeDownCast(d->MRMLNodeComboBox_RtPlan->currentNode());
+  if (!rtPlanNode)
   {
-    d->label_CalculateDoseStatus->setText("No reference image");
+    QString errorString("No RT plan node selected");
+    d->label_CalculateDoseStatus->setText(errorString);
+    qCritical() << Q_FUNC_INFO << ": " << errorString;
     return;
   }
 
+  // Start timer
+  QTime time;
+  time.start();
+  // Set busy cursor
   QApplication::setOverrideCursor(QCursor(Qt::BusyCursor));
 
-  // Copy pertinent variable values from GUI to logic
-  // Is this the right place for this?
-  d->logic()->GetExternalBeamPlanningNode()->SetGantryAngle(d->SliderWidget_GantryAngle->value());
+  // Calculate WED for each beam (unchanged beams use the cached result)
+  QString errorMessage;
+  std::vector<vtkMRMLRTBeamNode*> beams;
+  rtPlanNode->GetBeams(beams);
+  for (std::vector<vtkMRMLRTBeamNode*>::iterator beamIt = beams.begin(); beamIt != beams.end(); ++beamIt)
+  {
+    std::string beamErrorMessage = d->logic()->ComputeWED(*beamIt);
+    if (!beamErrorMessage.empty())
+    {
+      errorMessage = QString("%1 (beam %2)").arg(beamErrorMessage.c_str()).arg((*beamIt)->GetName());
+      break;
+    }
+  }
 
-  // OK, we're good to go (well, not really, but let's pretend). 
-  // Do the actual computation in the logic object
-  d->logic()->ComputeWED();
+  if (errorMessage.isEmpty())
+  {
+    QString message = QString("WED calculated successfully in %1 s").arg(time.elapsed()/1000.0);
+    qDebug() << Q_FUNC_INFO << ": " << message;
+    d->label_CalculateDoseStatus->setText(message);
+  }
+  else
+  {
+    QString message = QString("ERROR: %1").arg(errorMessage);
+    qCritical() << Q_FUNC_INFO << ": " << message;
+    d->label_CalculateDoseStatus->setText(message);
+  }
 
-  d->label_CalculateDoseStatus->setText("WED calculation done.");
   QApplication::restoreOverrideCursor();
-#endif
 }
 
 //-----------------------------------------------------------------------------
@@ -0,0 +1,316 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkIsodoseSliceContourCache.h"
+
+// VTK includes
+#include <vtkContourFilter.h>
+#include <vtkImageData.h>
+#include <vtkImageReslice.h>
+#include <vtkIntArray.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkTransform.h>
+#include <vtkTransformPolyDataFilter.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+//----------------------------------------------------------------------------
+const char* vtkIsodoseSliceContourCache::LEVEL_INDEX_ARRAY_NAME = "IsodoseLevelIndex";
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIsodoseSliceContourCache);
+
+vtkCxxSetObjectMacro(vtkIsodoseSliceContourCache, InputImageData, vtkImageData);
+vtkCxxSetObjectMacro(vtkIsodoseSliceContourCache, IjkToRasMatrix, vtkMatrix4x4);
+
+//----------------------------------------------------------------------------
+vtkIsodoseSliceContourCache::vtkIsodoseSliceContourCache()
+{
+  this->InputImageData = NULL;
+  this->IjkToRasMatrix = NULL;
+  this->MaximumNumberOfCachedSlices = 256;
+  this->NumberOfComputedSlices = 0;
+  this->CachedInputMTime = 0;
+}
+
+//----------------------------------------------------------------------------
+vtkIsodoseSliceContourCache::~vtkIsodoseSliceContourCache()
+{
+  this->SetInputImageData(NULL);
+  this->SetIjkToRasMatrix(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkIsodoseSliceContourCache::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "IsoLevels:";
+  for (std::vector<double>::iterator levelIt = this->IsoLevels.begin(); levelIt != this->IsoLevels.end(); ++levelIt)
+  {
+    os << " " << (*levelIt);
+  }
+  os << "\n";
+  os << indent << "MaximumNumberOfCachedSlices: " << this->MaximumNumberOfCachedSlices << "\n";
+  os << indent << "NumberOfCachedSlices: " << this->SliceKeys.size() << "\n";
+  os << indent << "NumberOfComputedSlices: " << this->NumberOfComputedSlices << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkIsodoseSliceContourCache::AddIsoLevel(double level)
+{
+  this->IsoLevels.push_back(level);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkIsodoseSliceContourCache::RemoveAllIsoLevels()
+{
+  this->IsoLevels.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkIsodoseSliceContourCache::GetNumberOfIsoLevels()
+{
+  return static_cast<int>(this->IsoLevels.size());
+}
+
+//----------------------------------------------------------------------------
+int vtkIsodoseSliceContourCache::GetNumberOfCachedSlices()
+{
+  return static_cast<int>(this->SliceKeys.size());
+}
+
+//----------------------------------------------------------------------------
+void vtkIsodoseSliceContourCache::ClearCache()
+{
+  this->SliceContours.clear();
+  this->SliceKeys.clear();
+}
+
+//----------------------------------------------------------------------------
+vtkPolyData* vtkIsodoseSliceContourCache::GetSliceContours(vtkMatrix4x4* sliceToRas)
+{
+  if (!sliceToRas)
+  {
+    vtkErrorMacro("GetSliceContours: Invalid slice to RAS matrix!");
+    return NULL;
+  }
+  if (!this->InputImageData || !this->InputImageData->GetPointData()->GetScalars())
+  {
+    vtkErrorMacro("GetSliceContours: Input image is not set!");
+    return NULL;
+  }
+
+  // Discard cached contours if any of the inputs changed
+  unsigned long inputMTime = std::max(this->GetMTime(), this->InputImageData->GetMTime());
+  if (this->IjkToRasMatrix)
+  {
+    inputMTime = std::max(inputMTime, this->IjkToRasMatrix->GetMTime());
+  }
+  if (inputMTime != this->CachedInputMTime)
+  {
+    this->ClearCache();
+    this->CachedInputMTime = inputMTime;
+  }
+
+  // Get plane from the slice to RAS matrix
+  double planeAxes[3][3] = { {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0} };
+  double sliceOrigin[3] = {0.0, 0.0, 0.0};
+  for (int row=0; row<3; ++row)
+  {
+    for (int axis=0; axis<3; ++axis)
+    {
+      planeAxes[axis][row] = sliceToRas->GetElement(row, axis);
+    }
+    sliceOrigin[row] = sliceToRas->GetElement(row, 3);
+  }
+  for (int axis=0; axis<3; ++axis)
+  {
+    if (vtkMath::Normalize(planeAxes[axis]) == 0.0)
+    {
+      vtkErrorMacro("GetSliceContours: Degenerate slice to RAS matrix!");
+      return NULL;
+    }
+  }
+  double planeOffset = vtkMath::Dot(planeAxes[2], sliceOrigin);
+
+  // Look up plane in the cache. The in-plane X axis is part of the key, as it determines the sampling grid
+  std::ostringstream keyStream;
+  keyStream << std::fixed << std::setprecision(4)
+    << planeAxes[0][0] << " " << planeAxes[0][1] << " " << planeAxes[0][2] << " "
+    << planeAxes[2][0] << " " << planeAxes[2][1] << " " << planeAxes[2][2] << " "
+    << std::setprecision(3) << planeOffset;
+  std::string key = keyStream.str();
+
+  std::map<std::string, vtkSmartPointer<vtkPolyData> >::iterator contoursIt = this->SliceContours.find(key);
+  if (contoursIt != this->SliceContours.end())
+  {
+    return contoursIt->second;
+  }
+
+  vtkSmartPointer<vtkPolyData> contours = this->ComputeSliceContours(planeAxes, planeOffset);
+  ++this->NumberOfComputedSlices;
+
+  this->SliceContours[key] = contours;
+  this->SliceKeys.push_back(key);
+  while (static_cast<int>(this->SliceKeys.size()) > this->MaximumNumberOfCachedSlices)
+  {
+    this->SliceContours.erase(this->SliceKeys.front());
+    this->SliceKeys.pop_front();
+  }
+
+  return contours;
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkIsodoseSliceContourCache::ComputeSliceContours(double planeAxes[3][3], double planeOffset)
+{
+  vtkSmartPointer<vtkPolyData> contours = vtkSmartPointer<vtkPolyData>::New();
+  if (this->IsoLevels.empty())
+  {
+    return contours;
+  }
+
+  vtkSmartPointer<vtkMatrix4x4> ijkToRasMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  if (this->IjkToRasMatrix)
+  {
+    ijkToRasMatrix->DeepCopy(this->IjkToRasMatrix);
+  }
+  int extent[6] = {0, -1, 0, -1, 0, -1};
+  this->InputImageData->GetExtent(extent);
+
+  // Origin of the sampling grid is the projection of the first voxel onto the plane,
+  // so that the grid does not depend on the slice view origin
+  double firstVoxelRas[4] = { static_cast<double>(extent[0]), static_cast<double>(extent[2]), static_cast<double>(extent[4]), 1.0 };
+  ijkToRasMatrix->MultiplyPoint(firstVoxelRas, firstVoxelRas);
+  double distanceFromPlane = vtkMath::Dot(planeAxes[2], firstVoxelRas) - planeOffset;
+  double planeOrigin[3] = {0.0, 0.0, 0.0};
+  for (int coordinate=0; coordinate<3; ++coordinate)
+  {
+    planeOrigin[coordinate] = firstVoxelRas[coordinate] - distanceFromPlane * planeAxes[2][coordinate];
+  }
+
+  // Bounding box of the image in plane coordinates
+  double minimum[3] = {VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, VTK_DOUBLE_MAX};
+  double maximum[3] = {VTK_DOUBLE_MIN, VTK_DOUBLE_MIN, VTK_DOUBLE_MIN};
+  for (int corner=0; corner<8; ++corner)
+  {
+    double cornerRas[4] = { static_cast<double>(extent[(corner & 1) ? 1 : 0]), static_cast<double>(extent[(corner & 2) ? 3 : 2]),
+      static_cast<double>(extent[(corner & 4) ? 5 : 4]), 1.0 };
+    ijkToRasMatrix->MultiplyPoint(cornerRas, cornerRas);
+    double cornerFromOrigin[3] = { cornerRas[0]-planeOrigin[0], cornerRas[1]-planeOrigin[1], cornerRas[2]-planeOrigin[2] };
+    for (int axis=0; axis<3; ++axis)
+    {
+      double position = vtkMath::Dot(planeAxes[axis], cornerFromOrigin);
+      minimum[axis] = std::min(minimum[axis], position);
+      maximum[axis] = std::max(maximum[axis], position);
+    }
+  }
+  if (minimum[2] > 0.0 || maximum[2] < 0.0)
+  {
+    // The plane does not intersect the image
+    return contours;
+  }
+
+  // Sample the plane with the smallest voxel size
+  double spacing = VTK_DOUBLE_MAX;
+  for (int column=0; column<3; ++column)
+  {
+    double voxelSize = sqrt( ijkToRasMatrix->GetElement(0,column) * ijkToRasMatrix->GetElement(0,column)
+      + ijkToRasMatrix->GetElement(1,column) * ijkToRasMatrix->GetElement(1,column)
+      + ijkToRasMatrix->GetElement(2,column) * ijkToRasMatrix->GetElement(2,column) );
+    spacing = std::min(spacing, voxelSize);
+  }
+  int outputExtent[6] = { static_cast<int>(floor(minimum[0]/spacing)), static_cast<int>(ceil(maximum[0]/spacing)),
+    static_cast<int>(floor(minimum[1]/spacing)), static_cast<int>(ceil(maximum[1]/spacing)), 0, 0 };
+
+  vtkSmartPointer<vtkMatrix4x4> planeToRasMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  for (int row=0; row<3; ++row)
+  {
+    for (int axis=0; axis<3; ++axis)
+    {
+      planeToRasMatrix->SetElement(row, axis, planeAxes[axis][row]);
+    }
+    planeToRasMatrix->SetElement(row, 3, planeOrigin[row]);
+  }
+  vtkSmartPointer<vtkMatrix4x4> rasToIjkMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkMatrix4x4::Invert(ijkToRasMatrix, rasToIjkMatrix);
+  vtkSmartPointer<vtkMatrix4x4> planeToIjkMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkMatrix4x4::Multiply4x4(rasToIjkMatrix, planeToRasMatrix, planeToIjkMatrix);
+
+  // Resample dose on the plane and contour all levels at once
+  vtkSmartPointer<vtkImageReslice> reslice = vtkSmartPointer<vtkImageReslice>::New();
+  reslice->SetInputData(this->InputImageData);
+  reslice->SetResliceAxes(planeToIjkMatrix);
+  reslice->SetOutputDimensionality(2);
+  reslice->SetOutputOrigin(0, 0, 0);
+  reslice->SetOutputSpacing(spacing, spacing, 1);
+  reslice->SetOutputExtent(outputExtent);
+  reslice->SetInterpolationModeToLinear();
+
+  vtkSmartPointer<vtkContourFilter> contourFilter = vtkSmartPointer<vtkContourFilter>::New();
+  contourFilter->SetInputConnection(reslice->GetOutputPort());
+  for (int levelIndex=0; levelIndex<this->GetNumberOfIsoLevels(); ++levelIndex)
+  {
+    contourFilter->SetValue(levelIndex, this->IsoLevels[levelIndex]);
+  }
+  contourFilter->ComputeScalarsOn();
+
+  vtkSmartPointer<vtkTransform> planeToRasTransform = vtkSmartPointer<vtkTransform>::New();
+  planeToRasTransform->SetMatrix(planeToRasMatrix);
+  vtkSmartPointer<vtkTransformPolyDataFilter> transformPolyData = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
+  transformPolyData->SetInputConnection(contourFilter->GetOutputPort());
+  transformPolyData->SetTransform(planeToRasTransform);
+  transformPolyData->Update();
+  contours->ShallowCopy(transformPolyData->GetOutput());
+
+  // Replace contour values by level indices so that the lines can be colored by the isodose color table
+  vtkSmartPointer<vtkIntArray> levelIndices = vtkSmartPointer<vtkIntArray>::New();
+  levelIndices->SetName(LEVEL_INDEX_ARRAY_NAME);
+  levelIndices->SetNumberOfTuples(contours->GetNumberOfPoints());
+  vtkDataArray* contourValues = contours->GetPointData()->GetScalars();
+  for (vtkIdType pointIndex=0; pointIndex<contours->GetNumberOfPoints(); ++pointIndex)
+  {
+    double value = (contourValues ? contourValues->GetTuple1(pointIndex) : this->IsoLevels[0]);
+    int closestLevelIndex = 0;
+    for (int levelIndex=1; levelIndex<this->GetNumberOfIsoLevels(); ++levelIndex)
+    {
+      if (fabs(this->IsoLevels[levelIndex] - value) < fabs(this->IsoLevels[closestLevelIndex] - value))
+      {
+        closestLevelIndex = levelIndex;
+      }
+    }
+    levelIndices->SetValue(pointIndex, closestLevelIndex);
+  }
+  contours->GetPointData()->Initialize();
+  contours->GetPointData()->SetScalars(levelIndices);
+
+  return contours;
+}
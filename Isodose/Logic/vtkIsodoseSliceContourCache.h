@@ -0,0 +1,127 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#ifndef __vtkIsodoseSliceContourCache_h
+#define __vtkIsodoseSliceContourCache_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "vtkSlicerIsodoseModuleLogicExport.h"
+
+class vtkImageData;
+class vtkMatrix4x4;
+class vtkPolyData;
+
+/// \ingroup SlicerRt_QtModules_Isodose
+/// \class vtkIsodoseSliceContourCache
+/// \brief Compute and cache 2D isodose contour lines of the dose in arbitrary slice planes.
+///
+/// The dose is resampled on the slice plane (with the smallest voxel size of the dose as spacing) and contoured
+/// for all levels at once. The sampling grid only depends on the plane and its in-plane axis directions (not on
+/// the slice view origin), so the result is cached by plane, and panning or revisiting a slice reuses the contours.
+/// The cache is emptied when the input image, the IJK to RAS matrix or the levels change.
+///
+/// The output contours are poly lines in RAS, with the index of the level as point scalars (\sa LEVEL_INDEX_ARRAY_NAME).
+class VTK_SLICER_ISODOSE_LOGIC_EXPORT vtkIsodoseSliceContourCache : public vtkObject
+{
+public:
+  /// Name of the point scalar array containing the level index
+  static const char* LEVEL_INDEX_ARRAY_NAME;
+
+public:
+  static vtkIsodoseSliceContourCache *New();
+  vtkTypeMacro(vtkIsodoseSliceContourCache, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Set input image (single component, zero origin and unit spacing, the geometry is given by \sa IjkToRasMatrix)
+  void SetInputImageData(vtkImageData* imageData);
+  vtkGetObjectMacro(InputImageData, vtkImageData);
+
+  /// Set IJK to RAS matrix of the input image. Identity if not set
+  void SetIjkToRasMatrix(vtkMatrix4x4* matrix);
+  vtkGetObjectMacro(IjkToRasMatrix, vtkMatrix4x4);
+
+  /// Add isodose level
+  void AddIsoLevel(double level);
+  /// Remove all isodose levels
+  void RemoveAllIsoLevels();
+  /// Get number of isodose levels
+  int GetNumberOfIsoLevels();
+
+  /// Maximum number of slices kept in the cache. The least recently computed slices are discarded first
+  vtkSetClampMacro(MaximumNumberOfCachedSlices, int, 1, VTK_INT_MAX);
+  vtkGetMacro(MaximumNumberOfCachedSlices, int);
+
+  /// Get contours of all levels in a slice plane. Computed only if the plane is not in the cache
+  /// \param sliceToRas Slice to RAS matrix of the slice view (columns: slice X, Y, normal, origin)
+  /// \return Contours in RAS (empty if the plane does not intersect the image), NULL on failure
+  vtkPolyData* GetSliceContours(vtkMatrix4x4* sliceToRas);
+
+  /// Get number of slices in the cache
+  int GetNumberOfCachedSlices();
+  /// Get number of slices contoured since the creation of the object (for testing cache efficiency)
+  vtkGetMacro(NumberOfComputedSlices, int);
+
+  /// Remove all slices from the cache
+  void ClearCache();
+
+protected:
+  /// Contour the input image in the given plane
+  /// \param planeAxes Unit X axis, Y axis and normal of the plane (row by row)
+  /// \param planeOffset Signed distance of the plane from the RAS origin along the normal
+  vtkSmartPointer<vtkPolyData> ComputeSliceContours(double planeAxes[3][3], double planeOffset);
+
+protected:
+  vtkIsodoseSliceContourCache();
+  virtual ~vtkIsodoseSliceContourCache();
+
+protected:
+  /// Input image
+  vtkImageData* InputImageData;
+  /// IJK to RAS matrix of the input
+  vtkMatrix4x4* IjkToRasMatrix;
+  /// Isodose levels
+  std::vector<double> IsoLevels;
+  /// Maximum number of cached slices
+  int MaximumNumberOfCachedSlices;
+  /// Number of slices contoured so far
+  int NumberOfComputedSlices;
+
+  /// Contours by plane key
+  std::map<std::string, vtkSmartPointer<vtkPolyData> > SliceContours;
+  /// Plane keys in the order they were computed
+  std::deque<std::string> SliceKeys;
+  /// Time of the last change of the cache inputs the cached contours were computed with
+  unsigned long CachedInputMTime;
+
+private:
+  vtkIsodoseSliceContourCache(const vtkIsodoseSliceContourCache&); // Not implemented
+  void operator=(const vtkIsodoseSliceContourCache&);              // Not implemented
+};
+
+#endif
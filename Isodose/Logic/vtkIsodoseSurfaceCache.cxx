@@ -0,0 +1,170 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkIsodoseSurfaceCache.h"
+#include "vtkMultiLevelIsosurfaceExtractor.h"
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+#include <vtkPolyData.h>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIsodoseSurfaceCache);
+
+vtkCxxSetObjectMacro(vtkIsodoseSurfaceCache, IjkToRasMatrix, vtkMatrix4x4);
+
+//----------------------------------------------------------------------------
+vtkIsodoseSurfaceCache::vtkIsodoseSurfaceCache()
+{
+  this->IjkToRasMatrix = NULL;
+  this->MaximumNumberOfDetailLevels = 3;
+  this->NumberOfPostProcessedSurfaces = 0;
+}
+
+//----------------------------------------------------------------------------
+vtkIsodoseSurfaceCache::~vtkIsodoseSurfaceCache()
+{
+  this->SetIjkToRasMatrix(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkIsodoseSurfaceCache::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "DoseKey: " << this->DoseKey << "\n";
+  os << indent << "MaximumNumberOfDetailLevels: " << this->MaximumNumberOfDetailLevels << "\n";
+  os << indent << "NumberOfCachedLevels: " << this->Surfaces.size() << "\n";
+  os << indent << "NumberOfPostProcessedSurfaces: " << this->NumberOfPostProcessedSurfaces << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkIsodoseSurfaceCache::SetDoseKey(const std::string& doseKey)
+{
+  if (doseKey == this->DoseKey)
+  {
+    return;
+  }
+  this->ClearCache();
+  this->DoseKey = doseKey;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkIsodoseSurfaceCache::ClearCache()
+{
+  this->Surfaces.clear();
+}
+
+//----------------------------------------------------------------------------
+vtkPolyData* vtkIsodoseSurfaceCache::GetRawSurface(double level)
+{
+  std::map<double, LevelSurfaces>::iterator levelIt = this->Surfaces.find(level);
+  if (levelIt == this->Surfaces.end())
+  {
+    return NULL;
+  }
+  return levelIt->second.RawSurface;
+}
+
+//----------------------------------------------------------------------------
+void vtkIsodoseSurfaceCache::AddSurface(double level, vtkPolyData* rawSurface, double decimationTargetReduction,
+  int numberOfSmoothingIterations, vtkPolyData* surface)
+{
+  if (!rawSurface)
+  {
+    vtkErrorMacro("AddSurface: Invalid raw surface!");
+    return;
+  }
+
+  LevelSurfaces& levelSurfaces = this->Surfaces[level];
+  if (levelSurfaces.RawSurface != rawSurface)
+  {
+    levelSurfaces.RawSurface = rawSurface;
+    levelSurfaces.DetailLevels.clear();
+  }
+  if (surface)
+  {
+    this->AddDetailLevel(levelSurfaces, decimationTargetReduction, numberOfSmoothingIterations, surface);
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkPolyData* vtkIsodoseSurfaceCache::GetSurface(double level, double decimationTargetReduction, int numberOfSmoothingIterations)
+{
+  std::map<double, LevelSurfaces>::iterator levelIt = this->Surfaces.find(level);
+  if (levelIt == this->Surfaces.end())
+  {
+    return NULL;
+  }
+
+  LevelSurfaces& levelSurfaces = levelIt->second;
+  for (std::vector<DetailLevel>::iterator detailIt = levelSurfaces.DetailLevels.begin(); detailIt != levelSurfaces.DetailLevels.end(); ++detailIt)
+  {
+    if ( detailIt->DecimationTargetReduction == decimationTargetReduction
+      && detailIt->NumberOfSmoothingIterations == numberOfSmoothingIterations )
+    {
+      // Mark as most recently used
+      DetailLevel detailLevel = *detailIt;
+      levelSurfaces.DetailLevels.erase(detailIt);
+      levelSurfaces.DetailLevels.push_back(detailLevel);
+      return detailLevel.Surface;
+    }
+  }
+
+  // Post-process raw surface with the requested settings
+  vtkSmartPointer<vtkPolyData> surface = vtkSmartPointer<vtkPolyData>::New();
+  if (levelSurfaces.RawSurface->GetNumberOfPolys() > 0)
+  {
+    vtkMultiLevelIsosurfaceExtractor::PostProcessSurface( levelSurfaces.RawSurface, decimationTargetReduction,
+      numberOfSmoothingIterations, true, this->IjkToRasMatrix, surface );
+    ++this->NumberOfPostProcessedSurfaces;
+  }
+  this->AddDetailLevel(levelSurfaces, decimationTargetReduction, numberOfSmoothingIterations, surface);
+  return surface;
+}
+
+//----------------------------------------------------------------------------
+void vtkIsodoseSurfaceCache::AddDetailLevel(LevelSurfaces& levelSurfaces, double decimationTargetReduction,
+  int numberOfSmoothingIterations, vtkPolyData* surface)
+{
+  DetailLevel detailLevel;
+  detailLevel.DecimationTargetReduction = decimationTargetReduction;
+  detailLevel.NumberOfSmoothingIterations = numberOfSmoothingIterations;
+  detailLevel.Surface = surface;
+  levelSurfaces.DetailLevels.push_back(detailLevel);
+
+  if (static_cast<int>(levelSurfaces.DetailLevels.size()) > this->MaximumNumberOfDetailLevels)
+  {
+    levelSurfaces.DetailLevels.erase(levelSurfaces.DetailLevels.begin());
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkIsodoseSurfaceCache::GetNumberOfDetailLevels(double level)
+{
+  std::map<double, LevelSurfaces>::iterator levelIt = this->Surfaces.find(level);
+  if (levelIt == this->Surfaces.end())
+  {
+    return 0;
+  }
+  return static_cast<int>(levelIt->second.DetailLevels.size());
+}
@@ -0,0 +1,133 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#ifndef __vtkIsodoseSurfaceCache_h
+#define __vtkIsodoseSurfaceCache_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <map>
+#include <string>
+#include <vector>
+
+#include "vtkSlicerIsodoseModuleLogicExport.h"
+
+class vtkMatrix4x4;
+class vtkPolyData;
+
+/// \ingroup SlicerRt_QtModules_Isodose
+/// \class vtkIsodoseSurfaceCache
+/// \brief Cache of isodose surfaces with multiple levels of detail.
+///
+/// For each isodose level the raw extracted surface (in IJK) is stored, together with the post-processed surfaces
+/// (in RAS) for the decimation and smoothing settings they were requested with. Switching between detail levels only
+/// post-processes the raw surface again if the setting was not requested before, and never recontours the dose.
+/// Only a few detail levels are kept for each isodose level; the least recently used one is discarded first.
+/// The whole cache is cleared when the dose key (set by the caller from the dose volume ID, image modification time
+/// and geometry) changes.
+class VTK_SLICER_ISODOSE_LOGIC_EXPORT vtkIsodoseSurfaceCache : public vtkObject
+{
+public:
+  static vtkIsodoseSurfaceCache *New();
+  vtkTypeMacro(vtkIsodoseSurfaceCache, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Set key identifying the dose the surfaces were extracted from. Clears the cache if the key changes
+  void SetDoseKey(const std::string& doseKey);
+  /// Get key identifying the dose the surfaces were extracted from
+  std::string GetDoseKey() { return this->DoseKey; };
+
+  /// Set IJK to RAS matrix the raw surfaces are transformed with when post-processed
+  void SetIjkToRasMatrix(vtkMatrix4x4* matrix);
+  vtkGetObjectMacro(IjkToRasMatrix, vtkMatrix4x4);
+
+  /// Maximum number of post-processed surfaces kept for each level. The least recently used ones are discarded first
+  vtkSetClampMacro(MaximumNumberOfDetailLevels, int, 1, VTK_INT_MAX);
+  vtkGetMacro(MaximumNumberOfDetailLevels, int);
+
+  /// Get raw (extracted, not post-processed) surface of a level. NULL if the level is not in the cache
+  vtkPolyData* GetRawSurface(double level);
+
+  /// Add surface of a level to the cache
+  /// \param rawSurface Extracted surface in IJK
+  /// \param surface Post-processed surface in RAS with the given settings. Optional
+  void AddSurface(double level, vtkPolyData* rawSurface, double decimationTargetReduction, int numberOfSmoothingIterations, vtkPolyData* surface);
+
+  /// Get post-processed surface of a level with the given settings. It is computed from the raw surface if not cached yet.
+  /// The returned surface is owned by the cache, so callers need to copy it if they modify it or keep it for long
+  /// \return Surface in RAS, NULL if the level is not in the cache
+  vtkPolyData* GetSurface(double level, double decimationTargetReduction, int numberOfSmoothingIterations);
+
+  /// Get number of post-processed surfaces cached for a level
+  int GetNumberOfDetailLevels(double level);
+  /// Get number of surfaces post-processed by the cache since its creation (for testing cache efficiency)
+  vtkGetMacro(NumberOfPostProcessedSurfaces, int);
+
+  /// Remove all surfaces from the cache
+  void ClearCache();
+
+protected:
+  vtkIsodoseSurfaceCache();
+  virtual ~vtkIsodoseSurfaceCache();
+
+protected:
+  //BTX
+  /// Post-processed surface with its settings
+  struct DetailLevel
+  {
+    double DecimationTargetReduction;
+    int NumberOfSmoothingIterations;
+    vtkSmartPointer<vtkPolyData> Surface;
+  };
+  /// Cached surfaces of a level
+  struct LevelSurfaces
+  {
+    /// Extracted surface
+    vtkSmartPointer<vtkPolyData> RawSurface;
+    /// Post-processed surfaces from the least to the most recently used
+    std::vector<DetailLevel> DetailLevels;
+  };
+  //ETX
+
+  /// Add post-processed surface to a level, discard the least recently used detail level if there are too many
+  void AddDetailLevel(LevelSurfaces& levelSurfaces, double decimationTargetReduction, int numberOfSmoothingIterations, vtkPolyData* surface);
+
+protected:
+  /// Key of the dose the surfaces were extracted from
+  std::string DoseKey;
+  /// IJK to RAS matrix applied in post-processing
+  vtkMatrix4x4* IjkToRasMatrix;
+  /// Maximum number of detail levels per level
+  int MaximumNumberOfDetailLevels;
+  /// Number of surfaces post-processed by the cache
+  int NumberOfPostProcessedSurfaces;
+
+  /// Cached surfaces by isodose level
+  std::map<double, LevelSurfaces> Surfaces;
+
+private:
+  vtkIsodoseSurfaceCache(const vtkIsodoseSurfaceCache&); // Not implemented
+  void operator=(const vtkIsodoseSurfaceCache&);         // Not implemented
+};
+
+#endif
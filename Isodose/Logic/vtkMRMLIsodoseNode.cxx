@@ -31,6 +31,7 @@
 // VTK includes
 #include <vtkObjectFactory.h>
 #include <vtkSmartPointer.h>
+#include <vtkVariant.h>
 
 // STD includes
 #include <sstream>
@@ -49,6 +50,9 @@ vtkMRMLIsodoseNode::vtkMRMLIsodoseNode()
   this->ShowIsodoseSurfaces = true;
   this->ShowScalarBar = false;
   this->ShowDoseVolumesOnly = true;
+  this->ComputeIsodoseLinesPerSlice = false;
+  this->DecimationTargetReduction = 0.6;
+  this->NumberOfSmoothingIterations = 2;
 
   this->HideFromEditors = false;
 }
@@ -69,6 +73,9 @@ void vtkMRMLIsodoseNode::WriteXML(ostream& of, int nIndent)
   of << indent << " ShowIsodoseLines=\"" << (this->ShowIsodoseLines ? "true" : "false") << "\"";
   of << indent << " ShowIsodoseSurfaces=\"" << (this->ShowIsodoseSurfaces ? "true" : "false") << "\"";
   of << indent << " ShowScalarBar=\"" << (this->ShowScalarBar ? "true" : "false") << "\"";
+  of << indent << " ComputeIsodoseLinesPerSlice=\"" << (this->ComputeIsodoseLinesPerSlice ? "true" : "false") << "\"";
+  of << indent << " DecimationTargetReduction=\"" << this->DecimationTargetReduction << "\"";
+  of << indent << " NumberOfSmoothingIterations=\"" << this->NumberOfSmoothingIterations << "\"";
 }
 
 //----------------------------------------------------------------------------
@@ -100,6 +107,19 @@ void vtkMRMLIsodoseNode::ReadXMLAttributes(const char** atts)
       this->ShowScalarBar = 
         (strcmp(attValue,"true") ? false : true);
       }
+    else if (!strcmp(attName, "ComputeIsodoseLinesPerSlice")) 
+      {
+      this->ComputeIsodoseLinesPerSlice = 
+        (strcmp(attValue,"true") ? false : true);
+      }
+    else if (!strcmp(attName, "DecimationTargetReduction")) 
+      {
+      this->DecimationTargetReduction = vtkVariant(attValue).ToDouble();
+      }
+    else if (!strcmp(attName, "NumberOfSmoothingIterations")) 
+      {
+      this->NumberOfSmoothingIterations = vtkVariant(attValue).ToInt();
+      }
     }
 }
 
@@ -116,6 +136,9 @@ void vtkMRMLIsodoseNode::Copy(vtkMRMLNode *anode)
   this->ShowIsodoseLines = node->ShowIsodoseLines;
   this->ShowIsodoseSurfaces = node->ShowIsodoseSurfaces;
   this->ShowScalarBar = node->ShowScalarBar;
+  this->ComputeIsodoseLinesPerSlice = node->ComputeIsodoseLinesPerSlice;
+  this->DecimationTargetReduction = node->DecimationTargetReduction;
+  this->NumberOfSmoothingIterations = node->NumberOfSmoothingIterations;
 
   this->DisableModifiedEventOff();
   this->InvokePendingModifiedEvent();
@@ -129,6 +152,9 @@ void vtkMRMLIsodoseNode::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "ShowIsodoseLines:   " << (this->ShowIsodoseLines ? "true" : "false") << "\n";
   os << indent << "ShowIsodoseSurfaces:   " << (this->ShowIsodoseSurfaces ? "true" : "false") << "\n";
   os << indent << "ShowScalarBar:   " << (this->ShowScalarBar ? "true" : "false") << "\n";
+  os << indent << "ComputeIsodoseLinesPerSlice:   " << (this->ComputeIsodoseLinesPerSlice ? "true" : "false") << "\n";
+  os << indent << "DecimationTargetReduction:   " << this->DecimationTargetReduction << "\n";
+  os << indent << "NumberOfSmoothingIterations:   " << this->NumberOfSmoothingIterations << "\n";
 }
 
 //----------------------------------------------------------------------------
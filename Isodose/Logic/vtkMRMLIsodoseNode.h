@@ -87,6 +87,19 @@ public:
   vtkSetMacro(ShowDoseVolumesOnly, bool);
   vtkBooleanMacro(ShowDoseVolumesOnly, bool);
 
+  /// Get/Set flag whether isodose lines are computed only for the slices shown in the slice views (instead of surfaces)
+  vtkGetMacro(ComputeIsodoseLinesPerSlice, bool);
+  vtkSetMacro(ComputeIsodoseLinesPerSlice, bool);
+  vtkBooleanMacro(ComputeIsodoseLinesPerSlice, bool);
+
+  /// Get/Set target reduction of the isodose surface decimation (0: no decimation)
+  vtkGetMacro(DecimationTargetReduction, double);
+  vtkSetClampMacro(DecimationTargetReduction, double, 0.0, 1.0);
+
+  /// Get/Set number of smoothing iterations of the isodose surfaces (0: no smoothing)
+  vtkGetMacro(NumberOfSmoothingIterations, int);
+  vtkSetClampMacro(NumberOfSmoothingIterations, int, 0, VTK_INT_MAX);
+
 protected:
   vtkMRMLIsodoseNode();
   ~vtkMRMLIsodoseNode();
@@ -105,6 +118,15 @@ protected:
 
   /// State of Show dose volumes only checkbox
   bool ShowDoseVolumesOnly;
+
+  /// Flag whether isodose lines are computed per displayed slice
+  bool ComputeIsodoseLinesPerSlice;
+
+  /// Target reduction of the surface decimation
+  double DecimationTargetReduction;
+
+  /// Number of surface smoothing iterations
+  int NumberOfSmoothingIterations;
 };
 
 #endif
@@ -0,0 +1,640 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkMultiLevelIsosurfaceExtractor.h"
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkDecimatePro.h>
+#include <vtkImageData.h>
+#include <vtkMarchingCubesTriangleCases.h>
+#include <vtkMatrix4x4.h>
+#include <vtkMultiThreader.h>
+#include <vtkObjectFactory.h>
+#include <vtkPoints.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataNormals.h>
+#include <vtkTransform.h>
+#include <vtkTransformPolyDataFilter.h>
+#include <vtkWindowedSincPolyDataFilter.h>
+
+// STD includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkMultiLevelIsosurfaceExtractor);
+
+vtkCxxSetObjectMacro(vtkMultiLevelIsosurfaceExtractor, InputImageData, vtkImageData);
+vtkCxxSetObjectMacro(vtkMultiLevelIsosurfaceExtractor, IjkToRasMatrix, vtkMatrix4x4);
+
+namespace
+{
+  /// Lower vertex offset (I, J, K) and axis of the cube edges (same edge order as in vtkImageMarchingCubes).
+  /// The edge is owned by its lower vertex
+  const int CUBE_EDGE_OWNERS[12][4] = { {0,0,0,0}, {1,0,0,1}, {0,1,0,0}, {0,0,0,1}, {0,0,1,0}, {1,0,1,1},
+    {0,1,1,0}, {0,0,1,1}, {0,0,0,2}, {1,0,0,2}, {0,1,0,2}, {1,1,0,2} };
+
+  //----------------------------------------------------------------------------
+  /// Get the value of a vertex and of its +I, +J and +K neighbors (the other ends of the edges owned by the vertex).
+  /// Neighbors outside the image get the value of the vertex, so that their edges are never intersected
+  template <class T> void GetVertexEdgeValues(const T* vertexPtr, int i, int j, int k, const int dimensions[3], double values[4])
+  {
+    vtkIdType rowSize = dimensions[0];
+    vtkIdType sliceSize = rowSize * dimensions[1];
+    values[0] = static_cast<double>(vertexPtr[0]);
+    values[1] = (i < dimensions[0]-1 ? static_cast<double>(vertexPtr[1]) : values[0]);
+    values[2] = (j < dimensions[1]-1 ? static_cast<double>(vertexPtr[rowSize]) : values[0]);
+    values[3] = (k < dimensions[2]-1 ? static_cast<double>(vertexPtr[sliceSize]) : values[0]);
+  }
+
+  //----------------------------------------------------------------------------
+  /// Classification: count the intersected edges owned by the vertices of a row for each level
+  template <class T> void CountRowIntersections(const T* imagePtr, int j, int k, const int dimensions[3],
+    const std::vector<double>& sortedLevels, const std::vector<int>& sortedLevelIndices,
+    std::vector< std::vector<vtkIdType> >& rowPointOffsets)
+  {
+    vtkIdType row = static_cast<vtkIdType>(k) * dimensions[1] + j;
+    const T* vertexPtr = imagePtr + row * dimensions[0];
+    double values[4] = {0.0, 0.0, 0.0, 0.0};
+    for (int i=0; i<dimensions[0]; ++i, ++vertexPtr)
+    {
+      GetVertexEdgeValues(vertexPtr, i, j, k, dimensions, values);
+      double minimum = std::min(std::min(values[0], values[1]), std::min(values[2], values[3]));
+      double maximum = std::max(std::max(values[0], values[1]), std::max(values[2], values[3]));
+      for ( std::vector<double>::const_iterator levelIt = std::lower_bound(sortedLevels.begin(), sortedLevels.end(), minimum);
+        levelIt != sortedLevels.end() && (*levelIt) < maximum; ++levelIt )
+      {
+        double level = (*levelIt);
+        bool above = (values[0] > level);
+        rowPointOffsets[ sortedLevelIndices[levelIt - sortedLevels.begin()] ][row] +=
+          ((values[1] > level) != above) + ((values[2] > level) != above) + ((values[3] > level) != above);
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Generation: assign point indices to the intersected edges owned by the vertices of a row, in the same order as
+  /// they were counted. The edge index buffer is indexed by sorted level, then vertex I index * 3 + axis.
+  /// Points are written only if the point buffers are given (the row is written by a single thread)
+  template <class T> void AssignRowPointIds(const T* imagePtr, int j, int k, const int dimensions[3], const int extent[6],
+    const std::vector<double>& sortedLevels, const std::vector<int>& sortedLevelIndices,
+    const std::vector< std::vector<vtkIdType> >& rowPointOffsets, float* const* levelPointsPtrs,
+    std::vector<vtkIdType>& nextPointIds, std::vector<vtkIdType>& rowEdgePointIds)
+  {
+    vtkIdType row = static_cast<vtkIdType>(k) * dimensions[1] + j;
+    vtkIdType levelBufferSize = static_cast<vtkIdType>(dimensions[0]) * 3;
+    for (size_t sortedIndex=0; sortedIndex<sortedLevels.size(); ++sortedIndex)
+    {
+      nextPointIds[sortedIndex] = rowPointOffsets[ sortedLevelIndices[sortedIndex] ][row];
+    }
+
+    const T* vertexPtr = imagePtr + row * dimensions[0];
+    double values[4] = {0.0, 0.0, 0.0, 0.0};
+    for (int i=0; i<dimensions[0]; ++i, ++vertexPtr)
+    {
+      GetVertexEdgeValues(vertexPtr, i, j, k, dimensions, values);
+      double minimum = std::min(std::min(values[0], values[1]), std::min(values[2], values[3]));
+      double maximum = std::max(std::max(values[0], values[1]), std::max(values[2], values[3]));
+      for ( std::vector<double>::const_iterator levelIt = std::lower_bound(sortedLevels.begin(), sortedLevels.end(), minimum);
+        levelIt != sortedLevels.end() && (*levelIt) < maximum; ++levelIt )
+      {
+        double level = (*levelIt);
+        size_t sortedIndex = levelIt - sortedLevels.begin();
+        bool above = (values[0] > level);
+        vtkIdType* edgePointIds = &(rowEdgePointIds[sortedIndex * levelBufferSize + i * 3]);
+        for (int axis=0; axis<3; ++axis)
+        {
+          if ((values[axis+1] > level) == above)
+          {
+            continue;
+          }
+          vtkIdType pointId = nextPointIds[sortedIndex]++;
+          edgePointIds[axis] = pointId;
+          if (levelPointsPtrs)
+          {
+            double position[3] = { static_cast<double>(extent[0]+i), static_cast<double>(extent[2]+j), static_cast<double>(extent[4]+k) };
+            position[axis] += (level - values[0]) / (values[axis+1] - values[0]);
+            float* pointPtr = levelPointsPtrs[ sortedLevelIndices[sortedIndex] ] + pointId * 3;
+            pointPtr[0] = static_cast<float>(position[0]);
+            pointPtr[1] = static_cast<float>(position[1]);
+            pointPtr[2] = static_cast<float>(position[2]);
+          }
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T> void ClassifySlab(const T* imagePtr, const int extent[6], int kStart, int kEnd,
+    const std::vector<double>& sortedLevels, const std::vector<int>& sortedLevelIndices,
+    std::vector< std::vector<vtkIdType> >& rowPointOffsets)
+  {
+    int dimensions[3] = { extent[1]-extent[0]+1, extent[3]-extent[2]+1, extent[5]-extent[4]+1 };
+    for (int k=kStart; k<=kEnd; ++k)
+    {
+      for (int j=0; j<dimensions[1]; ++j)
+      {
+        CountRowIntersections(imagePtr, j, k, dimensions, sortedLevels, sortedLevelIndices, rowPointOffsets);
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T> void ExtractSlab(const T* imagePtr, const int extent[6], int kStart, int kEnd,
+    const std::vector<double>& sortedLevels, const std::vector<int>& sortedLevelIndices,
+    const std::vector< std::vector<vtkIdType> >& rowPointOffsets, float* const* levelPointsPtrs,
+    std::vector< std::vector<vtkIdType> >& levelTriangles)
+  {
+    vtkMarchingCubesTriangleCases* triangleCases = vtkMarchingCubesTriangleCases::GetCases();
+
+    int dimensions[3] = { extent[1]-extent[0]+1, extent[3]-extent[2]+1, extent[5]-extent[4]+1 };
+    vtkIdType rowSize = dimensions[0];
+    vtkIdType sliceSize = rowSize * dimensions[1];
+    vtkIdType vertexOffsets[8] = { 0, 1, 1+rowSize, rowSize, sliceSize, 1+sliceSize, 1+rowSize+sliceSize, rowSize+sliceSize };
+    double lowestLevel = sortedLevels.front();
+    double highestLevel = sortedLevels.back();
+    int lastPlane = dimensions[2] - 1;
+
+    // Edge index buffers of the four vertex rows around the current cell row: (J,K), (J+1,K), (J,K+1), (J+1,K+1).
+    // Entries are only read for intersected edges, so the buffers do not need to be reset
+    vtkIdType levelBufferSize = rowSize * 3;
+    std::vector<vtkIdType> rowEdgePointIds[4];
+    for (int rowIndex=0; rowIndex<4; ++rowIndex)
+    {
+      rowEdgePointIds[rowIndex].resize(sortedLevels.size() * levelBufferSize);
+    }
+    std::vector<vtkIdType> nextPointIds(sortedLevels.size());
+
+    double cubeValues[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    for (int k=kStart; k<=kEnd; ++k)
+    {
+      // The points of the rows of plane K are written by this slab, the ones of plane K+1 by the next slab
+      // (except for the last plane)
+      float* const* upperPlanePointsPtrs = (k+1 == lastPlane ? levelPointsPtrs : NULL);
+      for (int j=0; j<dimensions[1]-1; ++j)
+      {
+        if (j == 0)
+        {
+          AssignRowPointIds(imagePtr, j, k, dimensions, extent, sortedLevels, sortedLevelIndices, rowPointOffsets,
+            levelPointsPtrs, nextPointIds, rowEdgePointIds[0]);
+          AssignRowPointIds(imagePtr, j, k+1, dimensions, extent, sortedLevels, sortedLevelIndices, rowPointOffsets,
+            upperPlanePointsPtrs, nextPointIds, rowEdgePointIds[2]);
+        }
+        else
+        {
+          // Rows J+1 of the previous cell row are the rows J of this one
+          rowEdgePointIds[0].swap(rowEdgePointIds[1]);
+          rowEdgePointIds[2].swap(rowEdgePointIds[3]);
+        }
+        AssignRowPointIds(imagePtr, j+1, k, dimensions, extent, sortedLevels, sortedLevelIndices, rowPointOffsets,
+          levelPointsPtrs, nextPointIds, rowEdgePointIds[1]);
+        AssignRowPointIds(imagePtr, j+1, k+1, dimensions, extent, sortedLevels, sortedLevelIndices, rowPointOffsets,
+          upperPlanePointsPtrs, nextPointIds, rowEdgePointIds[3]);
+
+        vtkIdType cellIndex = k * sliceSize + j * rowSize;
+        for (int i=0; i<dimensions[0]-1; ++i, ++cellIndex)
+        {
+          const T* cellPtr = imagePtr + cellIndex;
+          double minimum = VTK_DOUBLE_MAX;
+          double maximum = VTK_DOUBLE_MIN;
+          for (int vertex=0; vertex<8; ++vertex)
+          {
+            cubeValues[vertex] = static_cast<double>(cellPtr[vertexOffsets[vertex]]);
+            minimum = std::min(minimum, cubeValues[vertex]);
+            maximum = std::max(maximum, cubeValues[vertex]);
+          }
+
+          // A level intersects the cell if some corners are above it and the others are not
+          if (maximum <= lowestLevel || minimum > highestLevel)
+          {
+            continue;
+          }
+          for ( std::vector<double>::const_iterator levelIt = std::lower_bound(sortedLevels.begin(), sortedLevels.end(), minimum);
+            levelIt != sortedLevels.end() && (*levelIt) < maximum; ++levelIt )
+          {
+            double level = (*levelIt);
+            size_t sortedIndex = levelIt - sortedLevels.begin();
+            std::vector<vtkIdType>& triangles = levelTriangles[ sortedLevelIndices[sortedIndex] ];
+
+            int caseIndex = 0;
+            for (int vertex=0; vertex<8; ++vertex)
+            {
+              if (cubeValues[vertex] > level)
+              {
+                caseIndex |= (1 << vertex);
+              }
+            }
+
+            for (const int* edges = triangleCases[caseIndex].edges; edges[0] > -1; edges += 3)
+            {
+              vtkIdType pointIds[3] = {0, 0, 0};
+              for (int trianglePoint=0; trianglePoint<3; ++trianglePoint)
+              {
+                const int* owner = CUBE_EDGE_OWNERS[ edges[trianglePoint] ];
+                pointIds[trianglePoint] = rowEdgePointIds[ owner[1] + 2*owner[2] ][ sortedIndex * levelBufferSize + (i+owner[0]) * 3 + owner[3] ];
+              }
+              if ( pointIds[0] != pointIds[1] && pointIds[0] != pointIds[2] && pointIds[1] != pointIds[2] )
+              {
+                triangles.insert(triangles.end(), pointIds, pointIds + 3);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Split a K index range (inclusive) to the threads
+  bool GetThreadRange(vtkMultiThreader::ThreadInfo* threadInfo, int numberOfLayers, int& kStart, int& kEnd)
+  {
+    int layersPerThread = (numberOfLayers + threadInfo->NumberOfThreads - 1) / threadInfo->NumberOfThreads;
+    kStart = threadInfo->ThreadID * layersPerThread;
+    kEnd = std::min(kStart + layersPerThread - 1, numberOfLayers - 1);
+    return (kStart <= kEnd);
+  }
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE ClassifyThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    vtkMultiLevelIsosurfaceExtractor* self = static_cast<vtkMultiLevelIsosurfaceExtractor*>(threadInfo->UserData);
+
+    // Vertex planes
+    int dimensions[3] = {0, 0, 0};
+    self->GetInputImageData()->GetDimensions(dimensions);
+    int kStart = 0;
+    int kEnd = -1;
+    if (GetThreadRange(threadInfo, dimensions[2], kStart, kEnd))
+    {
+      self->ThreadedClassify(kStart, kEnd);
+    }
+
+    return VTK_THREAD_RETURN_VALUE;
+  }
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE ExtractThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    vtkMultiLevelIsosurfaceExtractor* self = static_cast<vtkMultiLevelIsosurfaceExtractor*>(threadInfo->UserData);
+
+    // Cell layers
+    int dimensions[3] = {0, 0, 0};
+    self->GetInputImageData()->GetDimensions(dimensions);
+    int kStart = 0;
+    int kEnd = -1;
+    if (GetThreadRange(threadInfo, dimensions[2] - 1, kStart, kEnd))
+    {
+      self->ThreadedExtract(kStart, kEnd, threadInfo->ThreadID);
+    }
+
+    return VTK_THREAD_RETURN_VALUE;
+  }
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE PostProcessThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    vtkMultiLevelIsosurfaceExtractor* self = static_cast<vtkMultiLevelIsosurfaceExtractor*>(threadInfo->UserData);
+
+    for (int levelIndex=threadInfo->ThreadID; levelIndex<self->GetNumberOfIsoLevels(); levelIndex+=threadInfo->NumberOfThreads)
+    {
+      self->ThreadedPostProcess(levelIndex);
+    }
+
+    return VTK_THREAD_RETURN_VALUE;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkMultiLevelIsosurfaceExtractor::vtkMultiLevelIsosurfaceExtractor()
+{
+  this->InputImageData = NULL;
+  this->IjkToRasMatrix = NULL;
+  this->DecimationTargetReduction = 0.6;
+  this->NumberOfSmoothingIterations = 2;
+  this->ComputeNormals = true;
+  this->Threader = vtkMultiThreader::New();
+  this->NumberOfThreads = this->Threader->GetNumberOfThreads();
+}
+
+//----------------------------------------------------------------------------
+vtkMultiLevelIsosurfaceExtractor::~vtkMultiLevelIsosurfaceExtractor()
+{
+  this->SetInputImageData(NULL);
+  this->SetIjkToRasMatrix(NULL);
+  if (this->Threader)
+  {
+    this->Threader->Delete();
+    this->Threader = NULL;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiLevelIsosurfaceExtractor::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "IsoLevels:";
+  for (std::vector<double>::iterator levelIt = this->IsoLevels.begin(); levelIt != this->IsoLevels.end(); ++levelIt)
+  {
+    os << " " << (*levelIt);
+  }
+  os << "\n";
+  os << indent << "DecimationTargetReduction: " << this->DecimationTargetReduction << "\n";
+  os << indent << "NumberOfSmoothingIterations: " << this->NumberOfSmoothingIterations << "\n";
+  os << indent << "ComputeNormals: " << (this->ComputeNormals ? "true" : "false") << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiLevelIsosurfaceExtractor::AddIsoLevel(double level)
+{
+  this->IsoLevels.push_back(level);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiLevelIsosurfaceExtractor::RemoveAllIsoLevels()
+{
+  this->IsoLevels.clear();
+  this->OutputPolyDatas.clear();
+  this->RawOutputPolyDatas.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkMultiLevelIsosurfaceExtractor::GetNumberOfIsoLevels()
+{
+  return static_cast<int>(this->IsoLevels.size());
+}
+
+//----------------------------------------------------------------------------
+double vtkMultiLevelIsosurfaceExtractor::GetIsoLevel(int levelIndex)
+{
+  if (levelIndex < 0 || levelIndex >= this->GetNumberOfIsoLevels())
+  {
+    vtkErrorMacro("GetIsoLevel: Invalid level index " << levelIndex);
+    return 0.0;
+  }
+  return this->IsoLevels[levelIndex];
+}
+
+//----------------------------------------------------------------------------
+vtkPolyData* vtkMultiLevelIsosurfaceExtractor::GetOutputPolyData(int levelIndex)
+{
+  if (levelIndex < 0 || levelIndex >= static_cast<int>(this->OutputPolyDatas.size()))
+  {
+    vtkErrorMacro("GetOutputPolyData: Invalid level index " << levelIndex);
+    return NULL;
+  }
+  return this->OutputPolyDatas[levelIndex];
+}
+
+//----------------------------------------------------------------------------
+vtkPolyData* vtkMultiLevelIsosurfaceExtractor::GetRawOutputPolyData(int levelIndex)
+{
+  if (levelIndex < 0 || levelIndex >= static_cast<int>(this->RawOutputPolyDatas.size()))
+  {
+    vtkErrorMacro("GetRawOutputPolyData: Invalid level index " << levelIndex);
+    return NULL;
+  }
+  return this->RawOutputPolyDatas[levelIndex];
+}
+
+//----------------------------------------------------------------------------
+bool vtkMultiLevelIsosurfaceExtractor::Update()
+{
+  if (!this->InputImageData || !this->InputImageData->GetPointData()->GetScalars())
+  {
+    vtkErrorMacro("Update: Input image is not set!");
+    return false;
+  }
+  if (this->InputImageData->GetNumberOfScalarComponents() != 1)
+  {
+    vtkErrorMacro("Update: Input image needs to have a single scalar component!");
+    return false;
+  }
+
+  int numberOfLevels = this->GetNumberOfIsoLevels();
+  this->OutputPolyDatas.clear();
+  this->RawOutputPolyDatas.clear();
+  for (int levelIndex=0; levelIndex<numberOfLevels; ++levelIndex)
+  {
+    this->OutputPolyDatas.push_back(vtkSmartPointer<vtkPolyData>::New());
+    this->RawOutputPolyDatas.push_back(vtkSmartPointer<vtkPolyData>::New());
+  }
+  if (numberOfLevels == 0)
+  {
+    return true;
+  }
+
+  int dimensions[3] = {0, 0, 0};
+  this->InputImageData->GetDimensions(dimensions);
+  if (dimensions[0] < 2 || dimensions[1] < 2 || dimensions[2] < 2)
+  {
+    // No cells
+    return true;
+  }
+
+  // Sort levels so that the levels intersecting a cell can be found by binary search
+  std::vector< std::pair<double, int> > levelsWithIndices;
+  for (int levelIndex=0; levelIndex<numberOfLevels; ++levelIndex)
+  {
+    levelsWithIndices.push_back(std::make_pair(this->IsoLevels[levelIndex], levelIndex));
+  }
+  std::sort(levelsWithIndices.begin(), levelsWithIndices.end());
+  this->SortedIsoLevels.clear();
+  this->SortedIsoLevelIndices.clear();
+  for (std::vector< std::pair<double, int> >::iterator levelIt = levelsWithIndices.begin(); levelIt != levelsWithIndices.end(); ++levelIt)
+  {
+    this->SortedIsoLevels.push_back(levelIt->first);
+    this->SortedIsoLevelIndices.push_back(levelIt->second);
+  }
+
+  // Classification pass: count the intersected edges of each vertex row in parallel slabs
+  int numberOfThreads = this->NumberOfThreads;
+  vtkIdType numberOfRows = static_cast<vtkIdType>(dimensions[1]) * dimensions[2];
+  this->RowPointOffsets.assign(numberOfLevels, std::vector<vtkIdType>(numberOfRows, 0));
+  this->Threader->SetNumberOfThreads(numberOfThreads);
+  this->Threader->SetSingleMethod(ClassifyThreadFunction, this);
+  this->Threader->SingleMethodExecute();
+
+  // Index of the first point of each row, so that the slabs can write their points directly into the output
+  this->LevelPoints.clear();
+  for (int levelIndex=0; levelIndex<numberOfLevels; ++levelIndex)
+  {
+    std::vector<vtkIdType>& rowPointOffsets = this->RowPointOffsets[levelIndex];
+    vtkIdType numberOfPoints = 0;
+    for (vtkIdType row=0; row<numberOfRows; ++row)
+    {
+      vtkIdType numberOfRowPoints = rowPointOffsets[row];
+      rowPointOffsets[row] = numberOfPoints;
+      numberOfPoints += numberOfRowPoints;
+    }
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetDataTypeToFloat();
+    points->SetNumberOfPoints(numberOfPoints);
+    this->LevelPoints.push_back(points);
+  }
+
+  // Generation pass: create points and triangles in parallel slabs
+  this->SlabTriangles.clear();
+  this->SlabTriangles.resize(numberOfThreads, std::vector< std::vector<vtkIdType> >(numberOfLevels));
+  this->Threader->SetSingleMethod(ExtractThreadFunction, this);
+  this->Threader->SingleMethodExecute();
+
+  // Merge and post-process the levels in parallel
+  this->Threader->SetNumberOfThreads(std::min(numberOfThreads, numberOfLevels));
+  this->Threader->SetSingleMethod(PostProcessThreadFunction, this);
+  this->Threader->SingleMethodExecute();
+
+  this->RowPointOffsets.clear();
+  this->LevelPoints.clear();
+  this->SlabTriangles.clear();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiLevelIsosurfaceExtractor::ThreadedClassify(int kStart, int kEnd)
+{
+  int extent[6] = {0, -1, 0, -1, 0, -1};
+  this->InputImageData->GetExtent(extent);
+  void* imagePtr = this->InputImageData->GetScalarPointer();
+  switch (this->InputImageData->GetScalarType())
+  {
+    vtkTemplateMacro( ClassifySlab( static_cast<VTK_TT*>(imagePtr), extent, kStart, kEnd,
+      this->SortedIsoLevels, this->SortedIsoLevelIndices, this->RowPointOffsets ) );
+    default:
+      vtkErrorMacro("ThreadedClassify: Unsupported input image scalar type!");
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiLevelIsosurfaceExtractor::ThreadedExtract(int kStart, int kEnd, int threadId)
+{
+  std::vector<float*> levelPointsPtrs;
+  for (std::vector< vtkSmartPointer<vtkPoints> >::iterator pointsIt = this->LevelPoints.begin(); pointsIt != this->LevelPoints.end(); ++pointsIt)
+  {
+    levelPointsPtrs.push_back(static_cast<float*>((*pointsIt)->GetVoidPointer(0)));
+  }
+
+  int extent[6] = {0, -1, 0, -1, 0, -1};
+  this->InputImageData->GetExtent(extent);
+  void* imagePtr = this->InputImageData->GetScalarPointer();
+  switch (this->InputImageData->GetScalarType())
+  {
+    vtkTemplateMacro( ExtractSlab( static_cast<VTK_TT*>(imagePtr), extent, kStart, kEnd,
+      this->SortedIsoLevels, this->SortedIsoLevelIndices, this->RowPointOffsets, &(levelPointsPtrs[0]),
+      this->SlabTriangles[threadId] ) );
+    default:
+      vtkErrorMacro("ThreadedExtract: Unsupported input image scalar type!");
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiLevelIsosurfaceExtractor::ThreadedPostProcess(int levelIndex)
+{
+  // Points are shared by the slabs, the triangles are concatenated in slab order
+  vtkSmartPointer<vtkCellArray> triangles = vtkSmartPointer<vtkCellArray>::New();
+  for (size_t threadId=0; threadId<this->SlabTriangles.size(); ++threadId)
+  {
+    const std::vector<vtkIdType>& slabTriangles = this->SlabTriangles[threadId][levelIndex];
+    for (size_t triangleIndex=0; triangleIndex<slabTriangles.size(); triangleIndex+=3)
+    {
+      triangles->InsertNextCell(3);
+      for (int trianglePoint=0; trianglePoint<3; ++trianglePoint)
+      {
+        triangles->InsertCellPoint(slabTriangles[triangleIndex+trianglePoint]);
+      }
+    }
+  }
+
+  // The point coordinates were written directly into the point array
+  this->LevelPoints[levelIndex]->Modified();
+  this->RawOutputPolyDatas[levelIndex]->SetPoints(this->LevelPoints[levelIndex]);
+  this->RawOutputPolyDatas[levelIndex]->SetPolys(triangles);
+  if (triangles->GetNumberOfCells() > 0)
+  {
+    PostProcessSurface( this->RawOutputPolyDatas[levelIndex], this->DecimationTargetReduction, this->NumberOfSmoothingIterations,
+      this->ComputeNormals, this->IjkToRasMatrix, this->OutputPolyDatas[levelIndex] );
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiLevelIsosurfaceExtractor::PostProcessSurface(vtkPolyData* rawSurface, double decimationTargetReduction,
+  int numberOfSmoothingIterations, bool computeNormals, vtkMatrix4x4* ijkToRasMatrix, vtkPolyData* outputSurface)
+{
+  if (!rawSurface || !outputSurface)
+  {
+    return;
+  }
+
+  vtkSmartPointer<vtkPolyData> surfacePolyData = rawSurface;
+  if (decimationTargetReduction > 0.0)
+  {
+    vtkSmartPointer<vtkDecimatePro> decimate = vtkSmartPointer<vtkDecimatePro>::New();
+    decimate->SetInputData(surfacePolyData);
+    decimate->SetTargetReduction(decimationTargetReduction);
+    decimate->SetFeatureAngle(60);
+    decimate->SplittingOff();
+    decimate->PreserveTopologyOn();
+    decimate->SetMaximumError(1);
+    decimate->Update();
+    surfacePolyData = decimate->GetOutput();
+  }
+
+  if (numberOfSmoothingIterations > 0)
+  {
+    vtkSmartPointer<vtkWindowedSincPolyDataFilter> smootherSinc = vtkSmartPointer<vtkWindowedSincPolyDataFilter>::New();
+    smootherSinc->SetPassBand(0.1);
+    smootherSinc->SetInputData(surfacePolyData);
+    smootherSinc->SetNumberOfIterations(numberOfSmoothingIterations);
+    smootherSinc->FeatureEdgeSmoothingOff();
+    smootherSinc->BoundarySmoothingOff();
+    smootherSinc->Update();
+    surfacePolyData = smootherSinc->GetOutput();
+  }
+
+  if (computeNormals)
+  {
+    vtkSmartPointer<vtkPolyDataNormals> normals = vtkSmartPointer<vtkPolyDataNormals>::New();
+    normals->SetInputData(surfacePolyData);
+    normals->ComputePointNormalsOn();
+    normals->SetFeatureAngle(60);
+    normals->Update();
+    surfacePolyData = normals->GetOutput();
+  }
+
+  if (ijkToRasMatrix)
+  {
+    vtkSmartPointer<vtkTransform> ijkToRasTransform = vtkSmartPointer<vtkTransform>::New();
+    ijkToRasTransform->SetMatrix(ijkToRasMatrix);
+    vtkSmartPointer<vtkTransformPolyDataFilter> transformPolyData = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
+    transformPolyData->SetInputData(surfacePolyData);
+    transformPolyData->SetTransform(ijkToRasTransform);
+    transformPolyData->Update();
+    surfacePolyData = transformPolyData->GetOutput();
+  }
+
+  outputSurface->ShallowCopy(surfacePolyData);
+}
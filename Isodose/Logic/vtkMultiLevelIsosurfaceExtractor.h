@@ -0,0 +1,164 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#ifndef __vtkMultiLevelIsosurfaceExtractor_h
+#define __vtkMultiLevelIsosurfaceExtractor_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkMultiThreader.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <vector>
+
+#include "vtkSlicerIsodoseModuleLogicExport.h"
+
+class vtkImageData;
+class vtkMatrix4x4;
+class vtkPoints;
+class vtkPolyData;
+
+/// \ingroup SlicerRt_QtModules_Isodose
+/// \class vtkMultiLevelIsosurfaceExtractor
+/// \brief Extract isosurfaces of multiple levels from an image in one parallel pass.
+///
+/// The image is scanned for all levels at once in two parallel passes along the K axis, similarly to flying edges.
+/// Each vertex owns its edges towards the +I, +J and +K neighbors. The classification pass counts the intersected
+/// edges of each vertex row for each level, from which the index of the first point of each row is computed. The
+/// generation pass then assigns point indices to the intersected edges of the rows around the current cell row (in
+/// per-row edge index buffers), writes the points of its own rows, and triangulates the cells. For each cell the
+/// minimum and maximum of the corner values are computed first, and only the levels between them are triangulated
+/// (using the marching cubes cases of VTK, so the surfaces are identical to the ones of vtkImageMarchingCubes).
+///
+/// The surfaces are then post-processed (decimation, smoothing, normal computation and transformation from IJK
+/// to RAS) concurrently, one level per thread.
+class VTK_SLICER_ISODOSE_LOGIC_EXPORT vtkMultiLevelIsosurfaceExtractor : public vtkObject
+{
+public:
+  static vtkMultiLevelIsosurfaceExtractor *New();
+  vtkTypeMacro(vtkMultiLevelIsosurfaceExtractor, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Set input image (single component, zero origin and unit spacing, the geometry is given by \sa IjkToRasMatrix)
+  void SetInputImageData(vtkImageData* imageData);
+  vtkGetObjectMacro(InputImageData, vtkImageData);
+
+  /// Set IJK to RAS matrix the output surfaces are transformed with. Identity if not set
+  void SetIjkToRasMatrix(vtkMatrix4x4* matrix);
+  vtkGetObjectMacro(IjkToRasMatrix, vtkMatrix4x4);
+
+  /// Add isosurface level. The output surfaces are in the order the levels are added
+  void AddIsoLevel(double level);
+  /// Remove all isosurface levels
+  void RemoveAllIsoLevels();
+  /// Get number of isosurface levels
+  int GetNumberOfIsoLevels();
+  /// Get isosurface level
+  double GetIsoLevel(int levelIndex);
+
+  /// Target reduction of the decimation. No decimation if 0
+  vtkSetClampMacro(DecimationTargetReduction, double, 0.0, 1.0);
+  vtkGetMacro(DecimationTargetReduction, double);
+
+  /// Number of smoothing iterations. No smoothing if 0
+  vtkSetClampMacro(NumberOfSmoothingIterations, int, 0, VTK_INT_MAX);
+  vtkGetMacro(NumberOfSmoothingIterations, int);
+
+  /// Enable/disable computation of point normals
+  vtkSetMacro(ComputeNormals, bool);
+  vtkGetMacro(ComputeNormals, bool);
+  vtkBooleanMacro(ComputeNormals, bool);
+
+  /// Number of threads used for the computation. By default the number of processors is used
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_MAX_THREADS);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Extract and post-process the isosurfaces
+  /// \return Success flag
+  bool Update();
+
+  /// Get output surface of a level (in RAS). Empty poly data if the level does not intersect the image
+  vtkPolyData* GetOutputPolyData(int levelIndex);
+
+  /// Get surface of a level as extracted (in IJK), before decimation, smoothing and normal computation
+  vtkPolyData* GetRawOutputPolyData(int levelIndex);
+
+  /// Decimate, smooth, compute normals of, and transform a raw extracted surface
+  /// \param ijkToRasMatrix Matrix the surface is transformed with. Not transformed if NULL
+  static void PostProcessSurface(vtkPolyData* rawSurface, double decimationTargetReduction, int numberOfSmoothingIterations,
+    bool computeNormals, vtkMatrix4x4* ijkToRasMatrix, vtkPolyData* outputSurface);
+
+  /// Count the intersected edges of the vertex rows in a slab of vertex planes (K index range, inclusive).
+  /// Called from the worker threads
+  void ThreadedClassify(int kStart, int kEnd);
+
+  /// Create the points and triangles of a slab of cells (K index range, inclusive). Called from the worker threads
+  void ThreadedExtract(int kStart, int kEnd, int threadId);
+
+  /// Merge the slab triangles of a level and post-process it. Called from the worker threads
+  void ThreadedPostProcess(int levelIndex);
+
+protected:
+  vtkMultiLevelIsosurfaceExtractor();
+  virtual ~vtkMultiLevelIsosurfaceExtractor();
+
+protected:
+  /// Input image
+  vtkImageData* InputImageData;
+  /// IJK to RAS matrix applied on the output
+  vtkMatrix4x4* IjkToRasMatrix;
+
+  /// Isosurface levels in the order they were added
+  std::vector<double> IsoLevels;
+  /// Decimation target reduction
+  double DecimationTargetReduction;
+  /// Number of smoothing iterations
+  int NumberOfSmoothingIterations;
+  /// Flag whether normals are computed
+  bool ComputeNormals;
+  /// Number of threads
+  int NumberOfThreads;
+
+  /// Isosurface levels in ascending order, so that the levels intersecting a cell can be found by binary search
+  std::vector<double> SortedIsoLevels;
+  /// Level index of each sorted level
+  std::vector<int> SortedIsoLevelIndices;
+  /// Number of intersected edges in each vertex row (row index is K * dimension J + J) after the classification
+  /// pass, then the index of the first point of each row. Indexed by level then row
+  std::vector< std::vector<vtkIdType> > RowPointOffsets;
+  /// Points (IJK) of each level, written by the generation pass
+  std::vector< vtkSmartPointer<vtkPoints> > LevelPoints;
+  /// Triangle point indices created by each thread, indexed by thread then level
+  std::vector< std::vector< std::vector<vtkIdType> > > SlabTriangles;
+  /// Output surfaces
+  std::vector< vtkSmartPointer<vtkPolyData> > OutputPolyDatas;
+  /// Output surfaces before post-processing
+  std::vector< vtkSmartPointer<vtkPolyData> > RawOutputPolyDatas;
+
+  /// Multithreader executing the slabs and the post-processing
+  vtkMultiThreader* Threader;
+
+private:
+  vtkMultiLevelIsosurfaceExtractor(const vtkMultiLevelIsosurfaceExtractor&); // Not implemented
+  void operator=(const vtkMultiLevelIsosurfaceExtractor&);                   // Not implemented
+};
+
+#endif
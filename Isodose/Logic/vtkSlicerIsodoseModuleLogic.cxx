@@ -22,6 +22,9 @@
 // Isodose includes
 #include "vtkSlicerIsodoseModuleLogic.h"
 #include "vtkMRMLIsodoseNode.h"
+#include "vtkMultiLevelIsosurfaceExtractor.h"
+#include "vtkIsodoseSliceContourCache.h"
+#include "vtkIsodoseSurfaceCache.h"
 
 // Subject Hierarchy includes
 #include "vtkMRMLSubjectHierarchyConstants.h"
@@ -40,6 +43,7 @@
 #include <vtkMRMLColorNode.h>
 #include <vtkMRMLColorTableNode.h>
 #include <vtkMRMLTransformNode.h>
+#include <vtkMRMLSliceNode.h>
 
 // MRMLLogic includes
 #include <vtkMRMLColorLogic.h>
@@ -49,22 +53,25 @@
 // VTK includes
 #include <vtkNew.h>
 #include <vtkImageData.h>
-#include <vtkImageMarchingCubes.h>
+#include <vtkPolyData.h>
 #include <vtkImageChangeInformation.h>
 #include <vtkImageReslice.h>
 #include <vtkSmartPointer.h>
 #include <vtkLookupTable.h>
-#include <vtkTriangleFilter.h>
-#include <vtkDecimatePro.h>
-#include <vtkPolyDataNormals.h>
 #include <vtkGeneralTransform.h>
+#include <vtkTransform.h>
+#include <vtkLinearExtrusionFilter.h>
+#include <vtkMath.h>
+#include <vtkCollection.h>
+#include <vtkVariant.h>
 #include <vtkLookupTable.h>
 #include <vtkColorTransferFunction.h>
-#include <vtkWindowedSincPolyDataFilter.h>
-#include <vtkTransformPolyDataFilter.h>
 #include <vtkObjectFactory.h>
 #include "vtksys/SystemTools.hxx"
 
+// STD includes
+#include <sstream>
+
 //----------------------------------------------------------------------------
 const char* vtkSlicerIsodoseModuleLogic::DEFAULT_ISODOSE_COLOR_TABLE_FILE_NAME = "Isodose_ColorTable.ctbl";
 const std::string vtkSlicerIsodoseModuleLogic::ISODOSE_MODEL_NODE_NAME_PREFIX = "IsodoseLevel_";
@@ -74,6 +81,39 @@ const std::string vtkSlicerIsodoseModuleLogic::ISODOSE_ROOT_SUBJECT_HIERARCHY_NO
 
 static const char* ISODOSE_ROOT_MODEL_HIERARCHY_REFERENCE_ROLE = "isodoseRootModelHierarchyRef";
 static const char* ISODOSE_ROOT_MODEL_HIERARCHY_DISPLAY_REFERENCE_ROLE = "isodoseRootModelHierarchyDisplayRef";
+static const char* ISODOSE_SLICE_LINES_MODEL_REFERENCE_ROLE_PREFIX = "isodoseSliceLinesModelRef_";
+static const char* ISODOSE_SLICE_LINES_MODEL_NODE_NAME_PREFIX = "IsodoseLines_";
+static const double ISODOSE_SLICE_LINES_THICKNESS_MM = 0.5;
+static const char* ISODOSE_LEVEL_ATTRIBUTE_NAME = "IsodoseLevel";
+
+//----------------------------------------------------------------------------
+namespace
+{
+  /// Get key identifying the state of the dose the isodose surfaces are extracted from:
+  /// the dose volume, the modification time of its voxels, its geometry and its parent transform
+  std::string GetIsodoseSurfaceCacheDoseKey(vtkMRMLScalarVolumeNode* doseVolumeNode)
+  {
+    std::ostringstream keyStream;
+    keyStream << doseVolumeNode->GetID() << ";" << doseVolumeNode->GetImageData()->GetMTime();
+    vtkSmartPointer<vtkMatrix4x4> ijkToRasMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    doseVolumeNode->GetIJKToRASMatrix(ijkToRasMatrix);
+    for (int element=0; element<16; ++element)
+    {
+      keyStream << ";" << ijkToRasMatrix->GetElement(element/4, element%4);
+    }
+    vtkMRMLTransformNode* parentTransformNode = doseVolumeNode->GetParentTransformNode();
+    if (parentTransformNode)
+    {
+      vtkSmartPointer<vtkMatrix4x4> parentToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+      parentTransformNode->GetMatrixTransformToWorld(parentToWorldMatrix);
+      for (int element=0; element<16; ++element)
+      {
+        keyStream << ";" << parentToWorldMatrix->GetElement(element/4, element%4);
+      }
+    }
+    return keyStream.str();
+  }
+}
 
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerIsodoseModuleLogic);
@@ -81,11 +121,23 @@ vtkStandardNewMacro(vtkSlicerIsodoseModuleLogic);
 //----------------------------------------------------------------------------
 vtkSlicerIsodoseModuleLogic::vtkSlicerIsodoseModuleLogic()
 {
+  this->SliceContourCache = vtkIsodoseSliceContourCache::New();
+  this->IsodoseSurfaceCache = vtkIsodoseSurfaceCache::New();
 }
 
 //----------------------------------------------------------------------------
 vtkSlicerIsodoseModuleLogic::~vtkSlicerIsodoseModuleLogic()
 {
+  if (this->SliceContourCache)
+  {
+    this->SliceContourCache->Delete();
+    this->SliceContourCache = NULL;
+  }
+  if (this->IsodoseSurfaceCache)
+  {
+    this->IsodoseSurfaceCache->Delete();
+    this->IsodoseSurfaceCache = NULL;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -154,6 +206,9 @@ void vtkSlicerIsodoseModuleLogic::OnMRMLSceneEndClose()
     return;
   }
 
+  this->RemoveSliceIsodoseLines();
+  this->DisplayedIsodoseSurfaces.clear();
+
   this->Modified();
 }
 
@@ -199,6 +254,28 @@ void vtkSlicerIsodoseModuleLogic::OnMRMLSceneNodeRemoved(vtkMRMLNode* node)
   }
 }
 
+//----------------------------------------------------------------------------
+void vtkSlicerIsodoseModuleLogic::ProcessMRMLNodesEvents(vtkObject* caller, unsigned long event, void* callData)
+{
+  Superclass::ProcessMRMLNodesEvents(caller, event, callData);
+
+  vtkMRMLScene* mrmlScene = this->GetMRMLScene();
+  if (!mrmlScene)
+  {
+    vtkErrorMacro("ProcessMRMLNodesEvents: Invalid MRML scene!");
+    return;
+  }
+  if (mrmlScene->IsBatchProcessing())
+  {
+    return;
+  }
+
+  if (caller->IsA("vtkMRMLSliceNode") && event == vtkCommand::ModifiedEvent)
+  {
+    this->UpdateSliceIsodoseLines(vtkMRMLSliceNode::SafeDownCast(caller));
+  }
+}
+
 //----------------------------------------------------------------------------
 vtkMRMLModelHierarchyNode* vtkSlicerIsodoseModuleLogic::GetRootModelHierarchyNode(vtkMRMLIsodoseNode* parameterNode)
 {
@@ -402,32 +479,50 @@ void vtkSlicerIsodoseModuleLogic::SetNumberOfIsodoseLevels(vtkMRMLIsodoseNode* p
   colorTableNode->SetAttribute("Category", SlicerRtCommon::SLICERRT_EXTENSION_NAME);
 }
 
-//---------------------------------------------------------------------------
-void vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* parameterNode)
+//------------------------------------------------------------------------------
+void vtkSlicerIsodoseModuleLogic::ResliceDoseVolumeToIjk(vtkMRMLScalarVolumeNode* doseVolumeNode, vtkImageData* reslicedImage, vtkMatrix4x4* ijkToRasMatrix)
 {
-  if (!this->GetMRMLScene() || !parameterNode)
-  {
-    vtkErrorMacro("CreateIsodoseSurfaces: Invalid scene or parameter set node!");
-    return;
-  }
+  doseVolumeNode->GetIJKToRASMatrix(ijkToRasMatrix);
+  vtkSmartPointer<vtkMatrix4x4> inputRAS2IJKMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  doseVolumeNode->GetRASToIJKMatrix(inputRAS2IJKMatrix); 
 
-  vtkMRMLScalarVolumeNode* doseVolumeNode = parameterNode->GetDoseVolumeNode();
-  if (!doseVolumeNode || !doseVolumeNode->GetImageData())
+  vtkSmartPointer<vtkTransform> outputIJK2IJKResliceTransform = vtkSmartPointer<vtkTransform>::New(); 
+  outputIJK2IJKResliceTransform->Identity();
+  outputIJK2IJKResliceTransform->PostMultiply();
+  outputIJK2IJKResliceTransform->SetMatrix(ijkToRasMatrix);
+
+  vtkSmartPointer<vtkMRMLTransformNode> inputVolumeNodeTransformNode = doseVolumeNode->GetParentTransformNode();
+  vtkSmartPointer<vtkMatrix4x4> inputRAS2RASMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  if (inputVolumeNodeTransformNode!=NULL)
   {
-    vtkErrorMacro("CreateIsodoseSurfaces: Invalid dose volume!");
-    return;
+    inputVolumeNodeTransformNode->GetMatrixTransformToWorld(inputRAS2RASMatrix);  
+    outputIJK2IJKResliceTransform->Concatenate(inputRAS2RASMatrix);
   }
+  
+  outputIJK2IJKResliceTransform->Concatenate(inputRAS2IJKMatrix);
+  outputIJK2IJKResliceTransform->Inverse();
 
-  this->GetMRMLScene()->StartState(vtkMRMLScene::BatchProcessState); 
+  int dimensions[3] = {0, 0, 0};
+  doseVolumeNode->GetImageData()->GetDimensions(dimensions);
+  vtkSmartPointer<vtkImageReslice> reslice = vtkSmartPointer<vtkImageReslice>::New();
+  reslice->SetInputData(doseVolumeNode->GetImageData());
+  reslice->SetOutputOrigin(0, 0, 0);
+  reslice->SetOutputSpacing(1, 1, 1);
+  reslice->SetOutputExtent(0, dimensions[0]-1, 0, dimensions[1]-1, 0, dimensions[2]-1);
+  reslice->SetResliceTransform(outputIJK2IJKResliceTransform);
+  reslice->Update();
+  reslicedImage->ShallowCopy(reslice->GetOutput());
+}
 
-  // Get subject hierarchy node for the dose volume
-  vtkMRMLSubjectHierarchyNode* doseVolumeSubjectHierarchyNode = vtkMRMLSubjectHierarchyNode::GetAssociatedSubjectHierarchyNode(doseVolumeNode);
-  if (!doseVolumeSubjectHierarchyNode)
+//---------------------------------------------------------------------------
+vtkMRMLModelHierarchyNode* vtkSlicerIsodoseModuleLogic::GetOrCreateRootModelHierarchyNode(vtkMRMLScalarVolumeNode* doseVolumeNode)
+{
+  if (!this->GetMRMLScene() || !doseVolumeNode)
   {
-    vtkErrorMacro("CreateIsodoseSurfaces: Failed to get subject hierarchy node for dose volume '" << doseVolumeNode->GetName() << "'");
+    vtkErrorMacro("GetOrCreateRootModelHierarchyNode: Invalid scene or dose volume!");
+    return NULL;
   }
 
-  // Model hierarchy node for the loaded structure set
   vtkMRMLModelHierarchyNode* rootModelHierarchyNode = vtkMRMLModelHierarchyNode::SafeDownCast( doseVolumeNode->GetNodeReference(ISODOSE_ROOT_MODEL_HIERARCHY_REFERENCE_ROLE) );
   if (!rootModelHierarchyNode)
   {
@@ -435,36 +530,14 @@ void vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
     this->GetMRMLScene()->AddNode(rootModelHierarchyNode);
     rootModelHierarchyNode->Delete();
   }
-  else 
-  {
-    std::vector< vtkMRMLHierarchyNode *> children = rootModelHierarchyNode->GetChildrenNodes(); 
-    for (unsigned int i=0; i<children.size(); i++)
-    {
-      vtkMRMLHierarchyNode *child = children[i];
-      vtkMRMLModelNode* mnode = vtkMRMLModelNode::SafeDownCast(child->GetAssociatedNode());
-      this->GetMRMLScene()->RemoveNode(mnode);
-      this->GetMRMLScene()->RemoveNode(child);
-    }
-    this->GetMRMLScene()->RemoveNode(rootModelHierarchyNode);
-    rootModelHierarchyNode = vtkMRMLModelHierarchyNode::New();
-    this->GetMRMLScene()->AddNode(rootModelHierarchyNode);
-    rootModelHierarchyNode->Delete();    
-  }
   std::string modelHierarchyNodeName = std::string(doseVolumeNode->GetName()) + vtkSlicerIsodoseModuleLogic::ISODOSE_ROOT_MODEL_HIERARCHY_NODE_NAME_POSTFIX;
   rootModelHierarchyNode->SetName(modelHierarchyNodeName.c_str());
   doseVolumeNode->SetNodeReferenceID(ISODOSE_ROOT_MODEL_HIERARCHY_REFERENCE_ROLE, rootModelHierarchyNode->GetID());
  
   // Create display node for the model hierarchy node
   vtkMRMLModelDisplayNode* rootModelHierarchyDisplayNode = vtkMRMLModelDisplayNode::SafeDownCast( doseVolumeNode->GetNodeReference(ISODOSE_ROOT_MODEL_HIERARCHY_DISPLAY_REFERENCE_ROLE) );
-  if (rootModelHierarchyDisplayNode)
-  {
-    rootModelHierarchyDisplayNode = vtkMRMLModelDisplayNode::New();
-    this->GetMRMLScene()->AddNode(rootModelHierarchyDisplayNode);
-    rootModelHierarchyDisplayNode->Delete();
-  }
-  else
+  if (!rootModelHierarchyDisplayNode)
   {
-    this->GetMRMLScene()->RemoveNode(rootModelHierarchyDisplayNode);
     rootModelHierarchyDisplayNode = vtkMRMLModelDisplayNode::New();
     this->GetMRMLScene()->AddNode(rootModelHierarchyDisplayNode);
     rootModelHierarchyDisplayNode->Delete();
@@ -474,124 +547,204 @@ void vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
   rootModelHierarchyNode->SetAndObserveDisplayNodeID( rootModelHierarchyDisplayNode->GetID() );
   doseVolumeNode->SetNodeReferenceID(ISODOSE_ROOT_MODEL_HIERARCHY_DISPLAY_REFERENCE_ROLE, rootModelHierarchyDisplayNode->GetID() );
 
-  // Subject hierarchy node for the isodose surfaces
-  if (doseVolumeSubjectHierarchyNode->GetNumberOfChildrenNodes() >= 1)
+  return rootModelHierarchyNode;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* parameterNode)
+{
+  if (!this->GetMRMLScene() || !parameterNode)
   {
-    doseVolumeSubjectHierarchyNode->RemoveAllHierarchyChildrenNodes();
+    vtkErrorMacro("CreateIsodoseSurfaces: Invalid scene or parameter set node!");
+    return;
   }
-  std::string isodoseShNodeName = std::string(doseVolumeNode->GetName()) + vtkSlicerIsodoseModuleLogic::ISODOSE_ROOT_SUBJECT_HIERARCHY_NODE_NAME_POSTFIX;
-  vtkMRMLSubjectHierarchyNode* subjectHierarchyRootNode = vtkMRMLSubjectHierarchyNode::CreateSubjectHierarchyNode(
-    this->GetMRMLScene(), doseVolumeSubjectHierarchyNode, vtkMRMLSubjectHierarchyConstants::GetSubjectHierarchyLevelFolder(),
-    isodoseShNodeName.c_str());
 
-  // Get color table
+  vtkMRMLScalarVolumeNode* doseVolumeNode = parameterNode->GetDoseVolumeNode();
+  if (!doseVolumeNode || !doseVolumeNode->GetImageData())
+  {
+    vtkErrorMacro("CreateIsodoseSurfaces: Invalid dose volume!");
+    return;
+  }
   vtkMRMLColorTableNode* colorTableNode = parameterNode->GetColorTableNode();
+  if (!colorTableNode)
+  {
+    vtkErrorMacro("CreateIsodoseSurfaces: Invalid color table node!");
+    return;
+  }
+
+  this->GetMRMLScene()->StartState(vtkMRMLScene::BatchProcessState); 
+
+  // Isodose surfaces replace the isodose lines per slice
+  this->RemoveSliceIsodoseLines();
+
+  // Get subject hierarchy node for the dose volume
+  vtkMRMLSubjectHierarchyNode* doseVolumeSubjectHierarchyNode = vtkMRMLSubjectHierarchyNode::GetAssociatedSubjectHierarchyNode(doseVolumeNode);
+  if (!doseVolumeSubjectHierarchyNode)
+  {
+    vtkErrorMacro("CreateIsodoseSurfaces: Failed to get subject hierarchy node for dose volume '" << doseVolumeNode->GetName() << "'");
+  }
+
+  // Collect the isodose models of the previous computation by level, so that the models of the levels
+  // that are still present can be updated instead of being recreated
+  std::map<std::string, vtkMRMLModelNode*> existingModelNodes;
+  vtkMRMLSubjectHierarchyNode* subjectHierarchyRootNode = NULL;
+
+  // Model hierarchy node for the loaded structure set
+  vtkMRMLModelHierarchyNode* rootModelHierarchyNode = vtkMRMLModelHierarchyNode::SafeDownCast( doseVolumeNode->GetNodeReference(ISODOSE_ROOT_MODEL_HIERARCHY_REFERENCE_ROLE) );
+  if (rootModelHierarchyNode)
+  {
+    std::vector< vtkMRMLHierarchyNode *> children = rootModelHierarchyNode->GetChildrenNodes(); 
+    bool reuseModels = !children.empty();
+    for (unsigned int i=0; i<children.size() && reuseModels; i++)
+    {
+      vtkMRMLModelNode* mnode = vtkMRMLModelNode::SafeDownCast(children[i]->GetAssociatedNode());
+      const char* levelName = (mnode ? mnode->GetAttribute(ISODOSE_LEVEL_ATTRIBUTE_NAME) : NULL);
+      vtkMRMLSubjectHierarchyNode* modelSubjectHierarchyNode = (mnode ? vtkMRMLSubjectHierarchyNode::GetAssociatedSubjectHierarchyNode(mnode) : NULL);
+      if (!levelName || !modelSubjectHierarchyNode || !modelSubjectHierarchyNode->GetParentNode())
+      {
+        reuseModels = false;
+        break;
+      }
+      existingModelNodes[levelName] = mnode;
+      subjectHierarchyRootNode = vtkMRMLSubjectHierarchyNode::SafeDownCast(modelSubjectHierarchyNode->GetParentNode());
+    }
+
+    // Start from scratch if the models were not created with level information
+    if (!reuseModels)
+    {
+      existingModelNodes.clear();
+      subjectHierarchyRootNode = NULL;
+      for (unsigned int i=0; i<children.size(); i++)
+      {
+        vtkMRMLHierarchyNode *child = children[i];
+        vtkMRMLModelNode* mnode = vtkMRMLModelNode::SafeDownCast(child->GetAssociatedNode());
+        this->GetMRMLScene()->RemoveNode(mnode);
+        this->GetMRMLScene()->RemoveNode(child);
+      }
+      this->GetMRMLScene()->RemoveNode(rootModelHierarchyNode);
+      rootModelHierarchyNode = NULL;
+    }
+  }
+  rootModelHierarchyNode = this->GetOrCreateRootModelHierarchyNode(doseVolumeNode);
+
+  // Subject hierarchy node for the isodose surfaces
+  if (!subjectHierarchyRootNode)
+  {
+    if (doseVolumeSubjectHierarchyNode->GetNumberOfChildrenNodes() >= 1)
+    {
+      doseVolumeSubjectHierarchyNode->RemoveAllHierarchyChildrenNodes();
+    }
+    std::string isodoseShNodeName = std::string(doseVolumeNode->GetName()) + vtkSlicerIsodoseModuleLogic::ISODOSE_ROOT_SUBJECT_HIERARCHY_NODE_NAME_POSTFIX;
+    subjectHierarchyRootNode = vtkMRMLSubjectHierarchyNode::CreateSubjectHierarchyNode(
+      this->GetMRMLScene(), doseVolumeSubjectHierarchyNode, vtkMRMLSubjectHierarchyConstants::GetSubjectHierarchyLevelFolder(),
+      isodoseShNodeName.c_str());
+  }
 
   // Progress
-  int stepCount = 1 /* reslice step */ + colorTableNode->GetNumberOfColors();
+  int stepCount = 2 /* reslice and extraction steps */ + colorTableNode->GetNumberOfColors();
   int currentStep = 0;
 
-  // Reslice dose volume
+  // Use the cached surfaces if the dose has not changed since they were extracted
   vtkSmartPointer<vtkMatrix4x4> inputIJK2RASMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
   doseVolumeNode->GetIJKToRASMatrix(inputIJK2RASMatrix);
-  vtkSmartPointer<vtkMatrix4x4> inputRAS2IJKMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-  doseVolumeNode->GetRASToIJKMatrix(inputRAS2IJKMatrix); 
+  this->IsodoseSurfaceCache->SetDoseKey(GetIsodoseSurfaceCacheDoseKey(doseVolumeNode));
+  this->IsodoseSurfaceCache->SetIjkToRasMatrix(inputIJK2RASMatrix);
+  double decimationTargetReduction = parameterNode->GetDecimationTargetReduction();
+  int numberOfSmoothingIterations = parameterNode->GetNumberOfSmoothingIterations();
+
+  // Extract isodose surfaces of all levels missing from the cache in one pass
+  std::vector<double> isoLevels;
+  vtkSmartPointer<vtkMultiLevelIsosurfaceExtractor> isosurfaceExtractor = vtkSmartPointer<vtkMultiLevelIsosurfaceExtractor>::New();
+  for (int i = 0; i < colorTableNode->GetNumberOfColors(); i++)
+  {
+    double isoLevel = vtkVariant(colorTableNode->GetColorName(i)).ToDouble();
+    isoLevels.push_back(isoLevel);
+    if (!this->IsodoseSurfaceCache->GetRawSurface(isoLevel))
+    {
+      isosurfaceExtractor->AddIsoLevel(isoLevel);
+    }
+  }
 
-  vtkSmartPointer<vtkTransform> outputIJK2IJKResliceTransform = vtkSmartPointer<vtkTransform>::New(); 
-  outputIJK2IJKResliceTransform->Identity();
-  outputIJK2IJKResliceTransform->PostMultiply();
-  outputIJK2IJKResliceTransform->SetMatrix(inputIJK2RASMatrix);
+  double progress = 0.0;
+  if (isosurfaceExtractor->GetNumberOfIsoLevels() > 0)
+  {
+    // Reslice dose volume
+    vtkSmartPointer<vtkImageData> reslicedDoseVolumeImage = vtkSmartPointer<vtkImageData>::New();
+    this->ResliceDoseVolumeToIjk(doseVolumeNode, reslicedDoseVolumeImage, inputIJK2RASMatrix);
 
-  vtkSmartPointer<vtkMRMLTransformNode> inputVolumeNodeTransformNode = doseVolumeNode->GetParentTransformNode();
-  vtkSmartPointer<vtkMatrix4x4> inputRAS2RASMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-  if (inputVolumeNodeTransformNode!=NULL)
+    // Report progress
+    ++currentStep;
+    progress = (double)(currentStep) / (double)stepCount;
+    this->InvokeEvent(SlicerRtCommon::ProgressUpdated, (void*)&progress);
+
+    isosurfaceExtractor->SetInputImageData(reslicedDoseVolumeImage);
+    isosurfaceExtractor->SetIjkToRasMatrix(inputIJK2RASMatrix);
+    isosurfaceExtractor->SetDecimationTargetReduction(decimationTargetReduction);
+    isosurfaceExtractor->SetNumberOfSmoothingIterations(numberOfSmoothingIterations);
+    if (!isosurfaceExtractor->Update())
+    {
+      vtkErrorMacro("CreateIsodoseSurfaces: Failed to extract isodose surfaces!");
+      this->GetMRMLScene()->EndState(vtkMRMLScene::BatchProcessState); 
+      return;
+    }
+    for (int levelIndex = 0; levelIndex < isosurfaceExtractor->GetNumberOfIsoLevels(); levelIndex++)
+    {
+      this->IsodoseSurfaceCache->AddSurface( isosurfaceExtractor->GetIsoLevel(levelIndex), isosurfaceExtractor->GetRawOutputPolyData(levelIndex),
+        decimationTargetReduction, numberOfSmoothingIterations, isosurfaceExtractor->GetOutputPolyData(levelIndex) );
+    }
+  }
+  else
   {
-    inputVolumeNodeTransformNode->GetMatrixTransformToWorld(inputRAS2RASMatrix);  
-    outputIJK2IJKResliceTransform->Concatenate(inputRAS2RASMatrix);
+    ++currentStep;
   }
-  
-  outputIJK2IJKResliceTransform->Concatenate(inputRAS2IJKMatrix);
-  outputIJK2IJKResliceTransform->Inverse();
-
-  int dimensions[3] = {0, 0, 0};
-  doseVolumeNode->GetImageData()->GetDimensions(dimensions);
-  vtkSmartPointer<vtkImageReslice> reslice = vtkSmartPointer<vtkImageReslice>::New();
-  reslice->SetInputData(doseVolumeNode->GetImageData());
-  reslice->SetOutputOrigin(0, 0, 0);
-  reslice->SetOutputSpacing(1, 1, 1);
-  reslice->SetOutputExtent(0, dimensions[0]-1, 0, dimensions[1]-1, 0, dimensions[2]-1);
-  reslice->SetResliceTransform(outputIJK2IJKResliceTransform);
-  reslice->Update();
-  vtkSmartPointer<vtkImageData> reslicedDoseVolumeImage = reslice->GetOutput(); 
 
   // Report progress
   ++currentStep;
-  double progress = (double)(currentStep) / (double)stepCount;
+  progress = (double)(currentStep) / (double)stepCount;
   this->InvokeEvent(SlicerRtCommon::ProgressUpdated, (void*)&progress);
 
-  // Create isodose surfaces
+  // Create isodose surface models
   for (int i = 0; i < colorTableNode->GetNumberOfColors(); i++)
   {
     double val[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
     const char* strIsoLevel = colorTableNode->GetColorName(i);
-    double isoLevel = vtkVariant(strIsoLevel).ToDouble();
     colorTableNode->GetColor(i, val);
 
-    vtkSmartPointer<vtkImageMarchingCubes> marchingCubes = vtkSmartPointer<vtkImageMarchingCubes>::New();
-    marchingCubes->SetInputData(reslicedDoseVolumeImage);
-    marchingCubes->SetNumberOfContours(1); 
-    marchingCubes->SetValue(0, isoLevel);
-    marchingCubes->ComputeScalarsOff();
-    marchingCubes->ComputeGradientsOff();
-    marchingCubes->ComputeNormalsOff();
-    marchingCubes->Update();
-
-    vtkSmartPointer<vtkPolyData> isoPolyData= marchingCubes->GetOutput();
-    if (isoPolyData->GetNumberOfPoints() >= 1)
+    // Get surface of the requested detail level from the cache (post-processed only if not requested before)
+    vtkPolyData* isoPolyData = this->IsodoseSurfaceCache->GetSurface(isoLevels[i], decimationTargetReduction, numberOfSmoothingIterations);
+    std::map<std::string, vtkMRMLModelNode*>::iterator existingModelIt = existingModelNodes.find(strIsoLevel);
+    if (isoPolyData && isoPolyData->GetNumberOfPoints() >= 1 && existingModelIt != existingModelNodes.end())
+    {
+      // Update existing model of the level. The model gets its own copy, as the cached surface may be discarded
+      vtkMRMLModelNode* isodoseModelNode = existingModelIt->second;
+      if (!isodoseModelNode->GetPolyData())
+      {
+        vtkSmartPointer<vtkPolyData> modelPolyData = vtkSmartPointer<vtkPolyData>::New();
+        isodoseModelNode->SetAndObservePolyData(modelPolyData);
+        this->DisplayedIsodoseSurfaces.erase(isodoseModelNode->GetID());
+      }
+      if (this->DisplayedIsodoseSurfaces[isodoseModelNode->GetID()] != isoPolyData)
+      {
+        isodoseModelNode->GetPolyData()->DeepCopy(isoPolyData);
+        this->DisplayedIsodoseSurfaces[isodoseModelNode->GetID()] = isoPolyData;
+      }
+      vtkMRMLModelDisplayNode* displayNode = isodoseModelNode->GetModelDisplayNode();
+      if (displayNode)
+      {
+        displayNode->SetColor(val[0], val[1], val[2]);
+        displayNode->SetOpacity(val[3]);
+      }
+      existingModelNodes.erase(existingModelIt);
+    }
+    else if (isoPolyData && isoPolyData->GetNumberOfPoints() >= 1)
     {
-      vtkSmartPointer<vtkTriangleFilter> triangleFilter = vtkSmartPointer<vtkTriangleFilter>::New();
-      triangleFilter->SetInputData(marchingCubes->GetOutput());
-      triangleFilter->Update();
-
-      vtkSmartPointer<vtkDecimatePro> decimate = vtkSmartPointer<vtkDecimatePro>::New();
-      decimate->SetInputData(triangleFilter->GetOutput());
-      decimate->SetTargetReduction(0.6);
-      decimate->SetFeatureAngle(60);
-      decimate->SplittingOff();
-      decimate->PreserveTopologyOn();
-      decimate->SetMaximumError(1);
-      decimate->Update();
-
-      vtkSmartPointer<vtkWindowedSincPolyDataFilter> smootherSinc = vtkSmartPointer<vtkWindowedSincPolyDataFilter>::New();
-      smootherSinc->SetPassBand(0.1);
-      smootherSinc->SetInputData(decimate->GetOutput() );
-      smootherSinc->SetNumberOfIterations(2);
-      smootherSinc->FeatureEdgeSmoothingOff();
-      smootherSinc->BoundarySmoothingOff();
-      smootherSinc->Update();
-
-      vtkSmartPointer<vtkPolyDataNormals> normals = vtkSmartPointer<vtkPolyDataNormals>::New();
-      normals->SetInputData(smootherSinc->GetOutput());
-      normals->ComputePointNormalsOn();
-      normals->SetFeatureAngle(60);
-      normals->Update();
-
-      vtkSmartPointer<vtkTransform> inputIJKToRASTransform = vtkSmartPointer<vtkTransform>::New();
-      inputIJKToRASTransform->Identity();
-      inputIJKToRASTransform->SetMatrix(inputIJK2RASMatrix);
-
-      vtkSmartPointer<vtkTransformPolyDataFilter> transformPolyData = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
-      transformPolyData->SetInputData(normals->GetOutput());
-      transformPolyData->SetTransform(inputIJKToRASTransform);
-      transformPolyData->Update();
-  
       vtkSmartPointer<vtkMRMLModelDisplayNode> displayNode = vtkSmartPointer<vtkMRMLModelDisplayNode>::New();
       displayNode = vtkMRMLModelDisplayNode::SafeDownCast(this->GetMRMLScene()->AddNode(displayNode));
       displayNode->SliceIntersectionVisibilityOn();  
       displayNode->VisibilityOn(); 
       displayNode->SetColor(val[0], val[1], val[2]);
       displayNode->SetOpacity(val[3]);
-    
+  
       // Disable backface culling to make the back side of the model visible as well
       displayNode->SetBackfaceCulling(0);
 
@@ -609,9 +762,13 @@ void vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
       std::string isodoseModelNodeName = vtkSlicerIsodoseModuleLogic::ISODOSE_MODEL_NODE_NAME_PREFIX + strIsoLevel + doseUnitName;
       isodoseModelNode->SetName(isodoseModelNodeName.c_str());
       isodoseModelNode->SetAndObserveDisplayNodeID(displayNode->GetID());
-      isodoseModelNode->SetAndObservePolyData(transformPolyData->GetOutput());
+      vtkSmartPointer<vtkPolyData> modelPolyData = vtkSmartPointer<vtkPolyData>::New();
+      modelPolyData->DeepCopy(isoPolyData);
+      isodoseModelNode->SetAndObservePolyData(modelPolyData);
+      this->DisplayedIsodoseSurfaces[isodoseModelNode->GetID()] = isoPolyData;
       isodoseModelNode->SetSelectable(1);
       isodoseModelNode->SetAttribute(SlicerRtCommon::DICOMRTIMPORT_ISODOSE_MODEL_IDENTIFIER_ATTRIBUTE_NAME.c_str(), "1");
+      isodoseModelNode->SetAttribute(ISODOSE_LEVEL_ATTRIBUTE_NAME, strIsoLevel);
 
       // Put the new node in the model hierarchy
       vtkSmartPointer<vtkMRMLModelHierarchyNode> isodoseModelHierarchyNode = vtkSmartPointer<vtkMRMLModelHierarchyNode>::New();
@@ -635,5 +792,208 @@ void vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
     this->InvokeEvent(SlicerRtCommon::ProgressUpdated, (void*)&progress);
   }
 
+  // Remove models of the levels that are not present any more
+  for (std::map<std::string, vtkMRMLModelNode*>::iterator modelIt = existingModelNodes.begin(); modelIt != existingModelNodes.end(); ++modelIt)
+  {
+    vtkMRMLModelNode* isodoseModelNode = modelIt->second;
+    this->DisplayedIsodoseSurfaces.erase(isodoseModelNode->GetID());
+    this->GetMRMLScene()->RemoveNode(vtkMRMLSubjectHierarchyNode::GetAssociatedSubjectHierarchyNode(isodoseModelNode));
+    this->GetMRMLScene()->RemoveNode(vtkMRMLHierarchyNode::GetAssociatedHierarchyNode(this->GetMRMLScene(), isodoseModelNode->GetID()));
+    this->GetMRMLScene()->RemoveNode(isodoseModelNode->GetDisplayNode());
+    this->GetMRMLScene()->RemoveNode(isodoseModelNode);
+  }
+
   this->GetMRMLScene()->EndState(vtkMRMLScene::BatchProcessState); 
 }
+
+//------------------------------------------------------------------------------
+void vtkSlicerIsodoseModuleLogic::CreateSliceIsodoseLines(vtkMRMLIsodoseNode* parameterNode)
+{
+  if (!this->GetMRMLScene() || !parameterNode)
+  {
+    vtkErrorMacro("CreateSliceIsodoseLines: Invalid scene or parameter set node!");
+    return;
+  }
+
+  vtkMRMLScalarVolumeNode* doseVolumeNode = parameterNode->GetDoseVolumeNode();
+  if (!doseVolumeNode || !doseVolumeNode->GetImageData())
+  {
+    vtkErrorMacro("CreateSliceIsodoseLines: Invalid dose volume!");
+    return;
+  }
+  vtkMRMLColorTableNode* colorTableNode = parameterNode->GetColorTableNode();
+  if (!colorTableNode)
+  {
+    vtkErrorMacro("CreateSliceIsodoseLines: Invalid color table node!");
+    return;
+  }
+
+  // Lines set up with a previous dose or parameter set are replaced
+  this->RemoveSliceIsodoseLines();
+  this->SliceIsodoseParameterNodeID = std::string(parameterNode->GetID());
+  this->SliceIsodoseDoseVolumeNodeID = std::string(doseVolumeNode->GetID());
+  this->SliceIsodoseDoseKey = GetIsodoseSurfaceCacheDoseKey(doseVolumeNode);
+
+  // Set up contour cache with the resliced dose and the isodose levels
+  vtkSmartPointer<vtkImageData> reslicedDoseVolumeImage = vtkSmartPointer<vtkImageData>::New();
+  vtkSmartPointer<vtkMatrix4x4> inputIJK2RASMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  this->ResliceDoseVolumeToIjk(doseVolumeNode, reslicedDoseVolumeImage, inputIJK2RASMatrix);
+  this->SliceContourCache->SetInputImageData(reslicedDoseVolumeImage);
+  this->SliceContourCache->SetIjkToRasMatrix(inputIJK2RASMatrix);
+  this->SliceContourCache->RemoveAllIsoLevels();
+  for (int i = 0; i < colorTableNode->GetNumberOfColors(); i++)
+  {
+    this->SliceContourCache->AddIsoLevel(vtkVariant(colorTableNode->GetColorName(i)).ToDouble());
+  }
+
+  // Observe slice nodes and create lines for the current slices
+  vtkSmartPointer<vtkCollection> sliceNodes = vtkSmartPointer<vtkCollection>::Take(
+    this->GetMRMLScene()->GetNodesByClass("vtkMRMLSliceNode") );
+  for (int sliceNodeIndex=0; sliceNodeIndex<sliceNodes->GetNumberOfItems(); ++sliceNodeIndex)
+  {
+    vtkMRMLSliceNode* sliceNode = vtkMRMLSliceNode::SafeDownCast(sliceNodes->GetItemAsObject(sliceNodeIndex));
+    vtkSmartPointer<vtkIntArray> events = vtkSmartPointer<vtkIntArray>::New();
+    events->InsertNextValue(vtkCommand::ModifiedEvent);
+    vtkObserveMRMLNodeEventsMacro(sliceNode, events);
+
+    this->UpdateSliceIsodoseLines(sliceNode);
+  }
+}
+
+//------------------------------------------------------------------------------
+void vtkSlicerIsodoseModuleLogic::UpdateSliceIsodoseLines(vtkMRMLSliceNode* sliceNode)
+{
+  if (!this->GetMRMLScene() || !sliceNode || this->SliceIsodoseParameterNodeID.empty())
+  {
+    return;
+  }
+  vtkMRMLIsodoseNode* parameterNode = vtkMRMLIsodoseNode::SafeDownCast(
+    this->GetMRMLScene()->GetNodeByID(this->SliceIsodoseParameterNodeID.c_str()) );
+  vtkMRMLScalarVolumeNode* doseVolumeNode = (parameterNode ? parameterNode->GetDoseVolumeNode() : NULL);
+  vtkMRMLColorTableNode* colorTableNode = (parameterNode ? parameterNode->GetColorTableNode() : NULL);
+  if ( !parameterNode || !parameterNode->GetComputeIsodoseLinesPerSlice() || !doseVolumeNode || !doseVolumeNode->GetImageData()
+    || !colorTableNode || this->SliceIsodoseDoseVolumeNodeID.compare(doseVolumeNode->GetID())
+    || this->SliceIsodoseDoseKey != GetIsodoseSurfaceCacheDoseKey(doseVolumeNode) )
+  {
+    // The lines do not correspond to the current settings and dose any more
+    this->RemoveSliceIsodoseLines();
+    return;
+  }
+
+  // Get contours of the slice (computed only if the slice is not in the cache)
+  vtkPolyData* sliceContours = this->SliceContourCache->GetSliceContours(sliceNode->GetSliceToRAS());
+  if (!sliceContours)
+  {
+    vtkErrorMacro("UpdateSliceIsodoseLines: Failed to get isodose contours for slice " << sliceNode->GetName());
+    return;
+  }
+  std::string sliceNodeID(sliceNode->GetID());
+  std::string modelReferenceRole = std::string(ISODOSE_SLICE_LINES_MODEL_REFERENCE_ROLE_PREFIX) + sliceNodeID;
+  vtkMRMLModelNode* sliceLinesModelNode = vtkMRMLModelNode::SafeDownCast(doseVolumeNode->GetNodeReference(modelReferenceRole.c_str()));
+  if (sliceLinesModelNode && this->DisplayedSliceContours[sliceNodeID] == sliceContours)
+  {
+    return; // The slice is already displayed
+  }
+
+  // Create model node for the slice view if it does not exist yet
+  if (!sliceLinesModelNode)
+  {
+    vtkSmartPointer<vtkMRMLModelDisplayNode> displayNode = vtkSmartPointer<vtkMRMLModelDisplayNode>::New();
+    this->GetMRMLScene()->AddNode(displayNode);
+    displayNode->SetColor(1.0, 1.0, 1.0);
+    displayNode->SetAndObserveColorNodeID(colorTableNode->GetID());
+    displayNode->SetActiveScalarName(vtkIsodoseSliceContourCache::LEVEL_INDEX_ARRAY_NAME);
+    displayNode->SetScalarRange(0, colorTableNode->GetNumberOfColors() - 1);
+    displayNode->ScalarVisibilityOn();
+    displayNode->SliceIntersectionVisibilityOn();
+    displayNode->VisibilityOn();
+    // Only show the lines in the slice view they were computed for
+    displayNode->AddViewNodeID(sliceNode->GetID());
+
+    vtkSmartPointer<vtkMRMLModelNode> modelNode = vtkSmartPointer<vtkMRMLModelNode>::New();
+    this->GetMRMLScene()->AddNode(modelNode);
+    std::string modelNodeName = std::string(ISODOSE_SLICE_LINES_MODEL_NODE_NAME_PREFIX)
+      + (sliceNode->GetLayoutName() ? sliceNode->GetLayoutName() : sliceNodeID);
+    modelNode->SetName(modelNodeName.c_str());
+    modelNode->SetAndObserveDisplayNodeID(displayNode->GetID());
+    modelNode->SetAttribute(SlicerRtCommon::DICOMRTIMPORT_ISODOSE_MODEL_IDENTIFIER_ATTRIBUTE_NAME.c_str(), "1");
+    doseVolumeNode->SetNodeReferenceID(modelReferenceRole.c_str(), modelNode->GetID());
+    sliceLinesModelNode = modelNode;
+
+    // Put the new node in the isodose model hierarchy
+    vtkMRMLModelHierarchyNode* rootModelHierarchyNode = this->GetOrCreateRootModelHierarchyNode(doseVolumeNode);
+    vtkSmartPointer<vtkMRMLModelHierarchyNode> sliceLinesModelHierarchyNode = vtkSmartPointer<vtkMRMLModelHierarchyNode>::New();
+    this->GetMRMLScene()->AddNode(sliceLinesModelHierarchyNode);
+    std::string modelHierarchyNodeName = modelNodeName + SlicerRtCommon::DICOMRTIMPORT_MODEL_HIERARCHY_NODE_NAME_POSTFIX;
+    sliceLinesModelHierarchyNode->SetName(modelHierarchyNodeName.c_str());
+    sliceLinesModelHierarchyNode->SetParentNodeID(rootModelHierarchyNode ? rootModelHierarchyNode->GetID() : NULL);
+    sliceLinesModelHierarchyNode->SetModelNodeID(modelNode->GetID());
+    sliceLinesModelHierarchyNode->HideFromEditorsOn();
+  }
+
+  // The slice views show the intersection of models with the slice plane, so the in-plane lines
+  // are extruded to a thin ribbon centered on the plane
+  double sliceNormal[3] = { sliceNode->GetSliceToRAS()->GetElement(0,2), sliceNode->GetSliceToRAS()->GetElement(1,2),
+    sliceNode->GetSliceToRAS()->GetElement(2,2) };
+  vtkMath::Normalize(sliceNormal);
+  vtkSmartPointer<vtkTransform> centerOnPlaneTransform = vtkSmartPointer<vtkTransform>::New();
+  centerOnPlaneTransform->Translate( -0.5 * ISODOSE_SLICE_LINES_THICKNESS_MM * sliceNormal[0],
+    -0.5 * ISODOSE_SLICE_LINES_THICKNESS_MM * sliceNormal[1], -0.5 * ISODOSE_SLICE_LINES_THICKNESS_MM * sliceNormal[2] );
+  vtkSmartPointer<vtkTransformPolyDataFilter> centerOnPlane = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
+  centerOnPlane->SetInputData(sliceContours);
+  centerOnPlane->SetTransform(centerOnPlaneTransform);
+  vtkSmartPointer<vtkLinearExtrusionFilter> extrusion = vtkSmartPointer<vtkLinearExtrusionFilter>::New();
+  extrusion->SetInputConnection(centerOnPlane->GetOutputPort());
+  extrusion->SetExtrusionTypeToVectorExtrusion();
+  extrusion->SetVector(sliceNormal);
+  extrusion->SetScaleFactor(ISODOSE_SLICE_LINES_THICKNESS_MM);
+  extrusion->CappingOff();
+  extrusion->Update();
+
+  vtkSmartPointer<vtkPolyData> sliceLinesPolyData = vtkSmartPointer<vtkPolyData>::New();
+  sliceLinesPolyData->ShallowCopy(extrusion->GetOutput());
+  sliceLinesModelNode->SetAndObservePolyData(sliceLinesPolyData);
+  this->DisplayedSliceContours[sliceNodeID] = sliceContours;
+}
+
+//------------------------------------------------------------------------------
+void vtkSlicerIsodoseModuleLogic::RemoveSliceIsodoseLines()
+{
+  vtkMRMLScene* mrmlScene = this->GetMRMLScene();
+  if (mrmlScene)
+  {
+    // Stop updating the lines when the slices change
+    vtkSmartPointer<vtkCollection> sliceNodes = vtkSmartPointer<vtkCollection>::Take(
+      mrmlScene->GetNodesByClass("vtkMRMLSliceNode") );
+    for (int sliceNodeIndex=0; sliceNodeIndex<sliceNodes->GetNumberOfItems(); ++sliceNodeIndex)
+    {
+      vtkMRMLSliceNode* sliceNode = vtkMRMLSliceNode::SafeDownCast(sliceNodes->GetItemAsObject(sliceNodeIndex));
+      vtkUnObserveMRMLNodeMacro(sliceNode);
+    }
+
+    // Remove the line models of the slice views from the dose volume they were created for
+    vtkMRMLScalarVolumeNode* doseVolumeNode = NULL;
+    if (!this->SliceIsodoseDoseVolumeNodeID.empty())
+    {
+      doseVolumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(mrmlScene->GetNodeByID(this->SliceIsodoseDoseVolumeNodeID.c_str()));
+    }
+    for (std::map<std::string, vtkWeakPointer<vtkPolyData> >::iterator sliceIt = this->DisplayedSliceContours.begin();
+      doseVolumeNode && sliceIt != this->DisplayedSliceContours.end(); ++sliceIt)
+    {
+      std::string modelReferenceRole = std::string(ISODOSE_SLICE_LINES_MODEL_REFERENCE_ROLE_PREFIX) + sliceIt->first;
+      vtkMRMLModelNode* sliceLinesModelNode = vtkMRMLModelNode::SafeDownCast(doseVolumeNode->GetNodeReference(modelReferenceRole.c_str()));
+      doseVolumeNode->RemoveNodeReferenceIDs(modelReferenceRole.c_str());
+      if (sliceLinesModelNode)
+      {
+        mrmlScene->RemoveNode(vtkMRMLHierarchyNode::GetAssociatedHierarchyNode(mrmlScene, sliceLinesModelNode->GetID()));
+        mrmlScene->RemoveNode(sliceLinesModelNode->GetDisplayNode());
+        mrmlScene->RemoveNode(sliceLinesModelNode);
+      }
+    }
+  }
+
+  this->SliceIsodoseParameterNodeID.clear();
+  this->SliceIsodoseDoseVolumeNodeID.clear();
+  this->SliceIsodoseDoseKey.clear();
+  this->DisplayedSliceContours.clear();
+}
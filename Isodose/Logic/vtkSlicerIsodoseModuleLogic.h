@@ -33,10 +33,24 @@
 
 #include "vtkSlicerIsodoseModuleLogicExport.h"
 
+// STD includes
+#include <map>
+
+// VTK includes
+#include <vtkWeakPointer.h>
+
 // MRML includes
 class vtkMRMLIsodoseNode;
 class vtkMRMLModelHierarchyNode;
 class vtkMRMLColorTableNode;
+class vtkMRMLScalarVolumeNode;
+class vtkMRMLSliceNode;
+
+class vtkImageData;
+class vtkIsodoseSliceContourCache;
+class vtkIsodoseSurfaceCache;
+class vtkMatrix4x4;
+class vtkPolyData;
 
 /// \ingroup SlicerRt_QtModules_Isodose
 class VTK_SLICER_ISODOSE_LOGIC_EXPORT vtkSlicerIsodoseModuleLogic : public vtkSlicerModuleLogic
@@ -57,12 +71,31 @@ public:
   /// Set number of isodose levels
   void SetNumberOfIsodoseLevels(vtkMRMLIsodoseNode* parameterNode, int newNumberOfColors);
 
-  /// Accumulates dose volumes with the given IDs and corresponding weights
+  /// Create isodose surface models for the levels of the color table. Surfaces are taken from the isodose surface cache
+  /// if the dose has not changed, and the models of levels that were already shown are updated instead of being recreated
   void CreateIsodoseSurfaces(vtkMRMLIsodoseNode* parameterNode);
 
   /// Get dose volume node
   vtkMRMLModelHierarchyNode* GetRootModelHierarchyNode(vtkMRMLIsodoseNode* parameterNode);
 
+  /// Set up isodose lines computed only in the slices shown in the slice views, and create them for the current slices.
+  /// The lines are updated whenever a slice node changes, and the contours of each slice are cached, so that
+  /// scrolling through the dose costs one 2D contouring per new slice
+  void CreateSliceIsodoseLines(vtkMRMLIsodoseNode* parameterNode);
+
+  /// Update isodose lines of a slice view (if isodose lines per slice are set up).
+  /// The lines are removed if isodose lines per slice have been turned off or the dose has changed since they were set up
+  void UpdateSliceIsodoseLines(vtkMRMLSliceNode* sliceNode);
+
+  /// Remove the isodose line models of the slice views and stop observing the slice nodes
+  void RemoveSliceIsodoseLines();
+
+  /// Get cache of the per-slice isodose contours
+  vtkGetObjectMacro(SliceContourCache, vtkIsodoseSliceContourCache);
+
+  /// Get cache of the isodose surfaces
+  vtkGetObjectMacro(IsodoseSurfaceCache, vtkIsodoseSurfaceCache);
+
 public:
   /// Creates default isodose color table. Gets and returns if already exists
   static vtkMRMLColorTableNode* CreateDefaultIsodoseColorTable(vtkMRMLScene* scene);
@@ -79,6 +112,14 @@ protected:
   /// Get isodose color table node name
   static std::string GetIsodoseColorTableNodeName();
 
+  /// Resample dose volume image on its IJK lattice with the parent transform of the volume applied
+  /// \param reslicedImage Output image in IJK coordinates (zero origin, unit spacing)
+  /// \param ijkToRasMatrix Output IJK to RAS matrix of the resliced image
+  void ResliceDoseVolumeToIjk(vtkMRMLScalarVolumeNode* doseVolumeNode, vtkImageData* reslicedImage, vtkMatrix4x4* ijkToRasMatrix);
+
+  /// Get root isodose model hierarchy node of a dose volume, create it with its display node if it does not exist yet
+  vtkMRMLModelHierarchyNode* GetOrCreateRootModelHierarchyNode(vtkMRMLScalarVolumeNode* doseVolumeNode);
+
 protected:
   virtual void SetMRMLSceneInternal(vtkMRMLScene* newScene);
 
@@ -89,10 +130,35 @@ protected:
   virtual void OnMRMLSceneNodeRemoved(vtkMRMLNode* node);
   virtual void OnMRMLSceneEndClose();
 
+  /// Handles slice node changes for the isodose lines per slice
+  virtual void ProcessMRMLNodesEvents(vtkObject* caller, unsigned long event, void* callData);
+
 protected:
   vtkSlicerIsodoseModuleLogic();
   virtual ~vtkSlicerIsodoseModuleLogic();
 
+protected:
+  /// Cache of the isodose contours in the displayed slices
+  vtkIsodoseSliceContourCache* SliceContourCache;
+
+  /// Cache of the isodose surfaces with multiple levels of detail
+  vtkIsodoseSurfaceCache* IsodoseSurfaceCache;
+
+  /// ID of the parameter node the isodose lines per slice were set up with
+  std::string SliceIsodoseParameterNodeID;
+
+  /// ID of the dose volume node the isodose lines per slice were set up with (the line models are referenced from it)
+  std::string SliceIsodoseDoseVolumeNodeID;
+
+  /// Key of the dose state the isodose lines per slice were set up with
+  std::string SliceIsodoseDoseKey;
+
+  /// Contours currently shown in each slice view (by slice node ID)
+  std::map<std::string, vtkWeakPointer<vtkPolyData> > DisplayedSliceContours;
+
+  /// Cached isodose surfaces currently copied into each isodose model (by model node ID)
+  std::map<std::string, vtkWeakPointer<vtkPolyData> > DisplayedIsodoseSurfaces;
+
 private:
   vtkSlicerIsodoseModuleLogic(const vtkSlicerIsodoseModuleLogic&); // Not implemented
   void operator=(const vtkSlicerIsodoseModuleLogic&);               // Not implemented
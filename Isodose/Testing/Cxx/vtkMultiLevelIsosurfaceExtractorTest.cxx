@@ -0,0 +1,140 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+// Isodose includes
+#include "vtkMultiLevelIsosurfaceExtractor.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkImageMarchingCubes.h>
+#include <vtkMassProperties.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cmath>
+
+namespace
+{
+  static const int IMAGE_DIMENSIONS[3] = {36, 30, 24};
+  /// Levels in arbitrary order, the last one does not intersect the image
+  static const double ISO_LEVELS[5] = {5.55, 0.517, 8.31, 2.93, 30.0};
+  static const int NUMBER_OF_ISO_LEVELS = 5;
+  static const double SURFACE_AREA_TOLERANCE = 1.0e-4;
+
+  //----------------------------------------------------------------------------
+  /// Two overlapping peaks with a ripple, so that the levels have several components of different topology
+  void CreateImage(vtkImageData* imageData)
+  {
+    imageData->SetDimensions(IMAGE_DIMENSIONS[0], IMAGE_DIMENSIONS[1], IMAGE_DIMENSIONS[2]);
+    imageData->AllocateScalars(VTK_FLOAT, 1);
+    float* imagePtr = static_cast<float*>(imageData->GetScalarPointer());
+    for (int k=0; k<IMAGE_DIMENSIONS[2]; ++k)
+    {
+      for (int j=0; j<IMAGE_DIMENSIONS[1]; ++j)
+      {
+        for (int i=0; i<IMAGE_DIMENSIONS[0]; ++i)
+        {
+          double peak1 = ((i-14)*(i-14) + 1.3*(j-15)*(j-15) + 0.7*(k-12)*(k-12)) / 60.0;
+          double peak2 = ((i-26)*(i-26) + (j-9)*(j-9) + (k-8)*(k-8)) / 20.0;
+          *(imagePtr++) = static_cast<float>(10.0 * exp(-peak1) + 6.0 * exp(-peak2) + 0.3 * sin(1.7*i + 0.3*j + k));
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkMultiLevelIsosurfaceExtractorTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+  CreateImage(imageData);
+
+  // Raw surfaces of the extractor are in IJK, compare them to the marching cubes surfaces of the same image
+  // (zero origin and unit spacing). Use several threads so that the slab boundaries are covered
+  vtkSmartPointer<vtkMultiLevelIsosurfaceExtractor> extractor = vtkSmartPointer<vtkMultiLevelIsosurfaceExtractor>::New();
+  extractor->SetInputImageData(imageData);
+  for (int levelIndex=0; levelIndex<NUMBER_OF_ISO_LEVELS; ++levelIndex)
+  {
+    extractor->AddIsoLevel(ISO_LEVELS[levelIndex]);
+  }
+  extractor->SetDecimationTargetReduction(0.0);
+  extractor->SetNumberOfSmoothingIterations(0);
+  extractor->ComputeNormalsOff();
+  extractor->SetNumberOfThreads(3);
+  if (!extractor->Update())
+  {
+    std::cerr << __LINE__ << ": Failed to extract isosurfaces" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  for (int levelIndex=0; levelIndex<NUMBER_OF_ISO_LEVELS; ++levelIndex)
+  {
+    vtkSmartPointer<vtkImageMarchingCubes> marchingCubes = vtkSmartPointer<vtkImageMarchingCubes>::New();
+    marchingCubes->SetInputData(imageData);
+    marchingCubes->SetValue(0, ISO_LEVELS[levelIndex]);
+    marchingCubes->ComputeNormalsOff();
+    marchingCubes->ComputeGradientsOff();
+    marchingCubes->ComputeScalarsOff();
+    marchingCubes->Update();
+    vtkPolyData* expectedSurface = marchingCubes->GetOutput();
+    vtkPolyData* surface = extractor->GetRawOutputPolyData(levelIndex);
+
+    if (surface->GetNumberOfPoints() != expectedSurface->GetNumberOfPoints())
+    {
+      std::cerr << __LINE__ << ": Number of points of level " << ISO_LEVELS[levelIndex] << " is " << surface->GetNumberOfPoints()
+        << " instead of " << expectedSurface->GetNumberOfPoints() << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (surface->GetNumberOfPolys() != expectedSurface->GetNumberOfPolys())
+    {
+      std::cerr << __LINE__ << ": Number of triangles of level " << ISO_LEVELS[levelIndex] << " is " << surface->GetNumberOfPolys()
+        << " instead of " << expectedSurface->GetNumberOfPolys() << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (expectedSurface->GetNumberOfPolys() == 0)
+    {
+      continue;
+    }
+
+    vtkSmartPointer<vtkMassProperties> massProperties = vtkSmartPointer<vtkMassProperties>::New();
+    massProperties->SetInputData(expectedSurface);
+    massProperties->Update();
+    double expectedSurfaceArea = massProperties->GetSurfaceArea();
+    massProperties->SetInputData(surface);
+    massProperties->Update();
+    double surfaceArea = massProperties->GetSurfaceArea();
+    if (fabs(surfaceArea - expectedSurfaceArea) > SURFACE_AREA_TOLERANCE * expectedSurfaceArea)
+    {
+      std::cerr << __LINE__ << ": Surface area of level " << ISO_LEVELS[levelIndex] << " is " << surfaceArea
+        << " instead of " << expectedSurfaceArea << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Levels that do not intersect the image give empty surfaces
+  if (extractor->GetRawOutputPolyData(NUMBER_OF_ISO_LEVELS-1)->GetNumberOfPolys() != 0)
+  {
+    std::cerr << __LINE__ << ": Level outside the image range has a surface" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -22,6 +22,8 @@
 // Isodose includes
 #include "vtkSlicerIsodoseModuleLogic.h"
 #include "vtkMRMLIsodoseNode.h"
+#include "vtkIsodoseSliceContourCache.h"
+#include "vtkIsodoseSurfaceCache.h"
 
 // SlicerRt includes
 #include "SlicerRtCommon.h"
@@ -36,6 +38,7 @@
 #include <vtkMRMLScalarVolumeNode.h>
 #include <vtkMRMLColorTableNode.h>
 #include <vtkMRMLScene.h>
+#include <vtkMRMLSliceNode.h>
 
 // VTK includes
 #include <vtkDoubleArray.h>
@@ -47,6 +50,8 @@
 #include <vtkLookupTable.h>
 #include <vtkCollection.h>
 #include <vtkMassProperties.h>
+#include <vtkMatrix4x4.h>
+#include <vtkVariant.h>
 
 // ITK includes
 #include "itkFactoryRegistration.h"
@@ -241,6 +246,112 @@ int vtkSlicerIsodoseModuleLogicTest1( int argc, char * argv[] )
     return EXIT_FAILURE;
   }
 
+  // The model must own its surface instead of sharing the one in the surface cache
+  vtkIsodoseSurfaceCache* surfaceCache = isodoseLogic->GetIsodoseSurfaceCache();
+  double isodoseLevel = vtkVariant(modelNode->GetAttribute("IsodoseLevel")).ToDouble();
+  vtkPolyData* firstIsodoseSurface = modelNode->GetPolyData();
+  vtkIdType firstNumberOfPoints = firstIsodoseSurface->GetNumberOfPoints();
+  if ( firstIsodoseSurface == surfaceCache->GetSurface(isodoseLevel, paramNode->GetDecimationTargetReduction(),
+    paramNode->GetNumberOfSmoothingIterations()) )
+  {
+    std::cerr << "Isodose model shares its surface with the isodose surface cache!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Recomputing with unchanged dose and settings must reuse the model and its surface without copying it again
+  unsigned long firstIsodoseSurfaceMTime = firstIsodoseSurface->GetMTime();
+  isodoseLogic->CreateIsodoseSurfaces(paramNode);
+  if (modelHierarchyRootNode->GetChildrenNodes().size() != 1 || modelNode->GetPolyData() != firstIsodoseSurface
+    || firstIsodoseSurface->GetMTime() != firstIsodoseSurfaceMTime || surfaceCache->GetNumberOfPostProcessedSurfaces() != 0)
+  {
+    std::cerr << "Isodose surface was not reused when recomputing with unchanged dose and settings!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Switching the detail level must only post-process the cached surface, and switching back must reuse the first one
+  paramNode->SetDecimationTargetReduction(0.3);
+  isodoseLogic->CreateIsodoseSurfaces(paramNode);
+  paramNode->SetDecimationTargetReduction(0.6);
+  isodoseLogic->CreateIsodoseSurfaces(paramNode);
+  if ( modelNode->GetPolyData() != firstIsodoseSurface || firstIsodoseSurface->GetNumberOfPoints() != firstNumberOfPoints
+    || surfaceCache->GetNumberOfPostProcessedSurfaces() != 1 )
+  {
+    std::cerr << "Isodose surface detail levels were not reused (number of post-processed surfaces: "
+      << surfaceCache->GetNumberOfPostProcessedSurfaces() << ")!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Detail levels are discarded in least recently used order: the first detail level was used last,
+  // so it must survive adding detail levels beyond the capacity of the cache
+  paramNode->SetDecimationTargetReduction(0.45);
+  isodoseLogic->CreateIsodoseSurfaces(paramNode);
+  paramNode->SetDecimationTargetReduction(0.2);
+  isodoseLogic->CreateIsodoseSurfaces(paramNode);
+  paramNode->SetDecimationTargetReduction(0.6);
+  isodoseLogic->CreateIsodoseSurfaces(paramNode);
+  if ( surfaceCache->GetNumberOfDetailLevels(isodoseLevel) != surfaceCache->GetMaximumNumberOfDetailLevels()
+    || surfaceCache->GetNumberOfPostProcessedSurfaces() != 3 || firstIsodoseSurface->GetNumberOfPoints() != firstNumberOfPoints )
+  {
+    std::cerr << "Recently used isodose surface detail level was discarded (number of post-processed surfaces: "
+      << surfaceCache->GetNumberOfPostProcessedSurfaces() << ")!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Compute isodose lines in an axial slice through the center of the dose
+  vtkSmartPointer<vtkMRMLSliceNode> sliceNode = vtkSmartPointer<vtkMRMLSliceNode>::New();
+  sliceNode->SetLayoutName("Red");
+  mrmlScene->AddNode(sliceNode);
+  double doseBounds[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  propertiesCurrent->GetInput()->GetBounds(doseBounds);
+  vtkMatrix4x4* sliceToRas = sliceNode->GetSliceToRAS();
+  sliceToRas->Identity();
+  sliceToRas->SetElement(0, 3, (doseBounds[0] + doseBounds[1]) / 2.0);
+  sliceToRas->SetElement(1, 3, (doseBounds[2] + doseBounds[3]) / 2.0);
+  sliceToRas->SetElement(2, 3, (doseBounds[4] + doseBounds[5]) / 2.0);
+  sliceNode->UpdateMatrices();
+
+  paramNode->SetComputeIsodoseLinesPerSlice(true);
+  isodoseLogic->CreateSliceIsodoseLines(paramNode);
+  vtkIsodoseSliceContourCache* sliceContourCache = isodoseLogic->GetSliceContourCache();
+  vtkPolyData* sliceContours = sliceContourCache->GetSliceContours(sliceToRas);
+  if (!sliceContours || sliceContours->GetNumberOfPoints() == 0)
+  {
+    std::cerr << "No isodose lines in the slice through the isodose surface center!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Revisiting the same slice (even with a panned view) must not contour it again
+  sliceToRas->SetElement(0, 3, sliceToRas->GetElement(0, 3) + 10.0);
+  sliceNode->UpdateMatrices();
+  isodoseLogic->UpdateSliceIsodoseLines(sliceNode);
+  if (sliceContourCache->GetNumberOfComputedSlices() != 1)
+  {
+    std::cerr << "Isodose lines of a cached slice were computed again (number of computed slices: "
+      << sliceContourCache->GetNumberOfComputedSlices() << ")!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // The lines of the slice view must be in the isodose model hierarchy
+  vtkMRMLModelNode* sliceLinesModelNode = vtkMRMLModelNode::SafeDownCast(mrmlScene->GetFirstNodeByName("IsodoseLines_Red"));
+  vtkMRMLHierarchyNode* sliceLinesHierarchyNode = (sliceLinesModelNode
+    ? vtkMRMLHierarchyNode::GetAssociatedHierarchyNode(mrmlScene, sliceLinesModelNode->GetID()) : NULL);
+  if (!sliceLinesHierarchyNode || sliceLinesHierarchyNode->GetParentNode() != isodoseLogic->GetRootModelHierarchyNode(paramNode))
+  {
+    std::cerr << "Isodose lines model of the slice view is not in the isodose model hierarchy!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Turning off isodose lines per slice must remove the lines and stop following the slice
+  paramNode->SetComputeIsodoseLinesPerSlice(false);
+  isodoseLogic->UpdateSliceIsodoseLines(sliceNode);
+  sliceToRas->SetElement(2, 3, sliceToRas->GetElement(2, 3) + 5.0);
+  sliceNode->UpdateMatrices();
+  if (mrmlScene->GetFirstNodeByName("IsodoseLines_Red") || sliceContourCache->GetNumberOfComputedSlices() != 1)
+  {
+    std::cerr << "Isodose lines of the slice view were not removed when isodose lines per slice were turned off!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
   return EXIT_SUCCESS;
 }
 
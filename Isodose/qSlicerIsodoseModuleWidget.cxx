@@ -367,6 +367,7 @@ void qSlicerIsodoseModuleWidget::updateWidgetFromMRML()
     d->spinBox_NumberOfLevels->setValue(colorTableNode->GetNumberOfColors());
     d->checkBox_Isoline->setChecked(paramNode->GetShowIsodoseLines());
     d->checkBox_Isosurface->setChecked(paramNode->GetShowIsodoseSurfaces());
+    d->checkBox_IsolinesPerSlice->setChecked(paramNode->GetComputeIsodoseLinesPerSlice());
   }
 }
 
@@ -394,6 +395,7 @@ void qSlicerIsodoseModuleWidget::setup()
   connect( d->checkBox_ShowDoseVolumesOnly, SIGNAL( stateChanged(int) ), this, SLOT( showDoseVolumesOnlyCheckboxChanged(int) ) );
   connect( d->checkBox_Isoline, SIGNAL(toggled(bool)), this, SLOT( setIsolineVisibility(bool) ) );
   connect( d->checkBox_Isosurface, SIGNAL(toggled(bool)), this, SLOT( setIsosurfaceVisibility(bool) ) );
+  connect( d->checkBox_IsolinesPerSlice, SIGNAL(toggled(bool)), this, SLOT( setIsolinesPerSlice(bool) ) );
   connect( d->checkBox_ScalarBar, SIGNAL(toggled(bool)), this, SLOT( setScalarBarVisibility(bool) ) );
   connect( d->checkBox_ScalarBar2D, SIGNAL(toggled(bool)), this, SLOT( setScalarBar2DVisibility(bool) ) );
 
@@ -654,6 +656,28 @@ void qSlicerIsodoseModuleWidget::setIsosurfaceVisibility(bool visible)
   }
 }
 
+//------------------------------------------------------------------------------
+void qSlicerIsodoseModuleWidget::setIsolinesPerSlice(bool perSlice)
+{
+  Q_D(qSlicerIsodoseModuleWidget);
+
+  vtkMRMLIsodoseNode* paramNode = vtkMRMLIsodoseNode::SafeDownCast(d->MRMLNodeComboBox_ParameterSet->currentNode());
+  if (!paramNode)
+  {
+    return;
+  }
+
+  paramNode->DisableModifiedEventOn();
+  paramNode->SetComputeIsodoseLinesPerSlice(perSlice);
+  paramNode->DisableModifiedEventOff();
+
+  // Isodose lines of the slice views are not updated any more, so remove them
+  if (!perSlice)
+  {
+    d->logic()->RemoveSliceIsodoseLines();
+  }
+}
+
 //------------------------------------------------------------------------------
 void qSlicerIsodoseModuleWidget::setScalarBarVisibility(bool visible)
 {
@@ -761,8 +785,15 @@ void qSlicerIsodoseModuleWidget::applyClicked()
 
   QApplication::setOverrideCursor(QCursor(Qt::BusyCursor));
 
-  // Compute the isodose surface for the selected dose volume
-  d->logic()->CreateIsodoseSurfaces(paramNode);
+  // Compute the isodose surface (or the isodose lines in the displayed slices) for the selected dose volume
+  if (paramNode->GetComputeIsodoseLinesPerSlice())
+  {
+    d->logic()->CreateSliceIsodoseLines(paramNode);
+  }
+  else
+  {
+    d->logic()->CreateIsodoseSurfaces(paramNode);
+  }
 
   QApplication::restoreOverrideCursor();
 }
@@ -74,6 +74,9 @@ protected slots:
   /// Slot for changing isosurface visibility
   void setIsosurfaceVisibility(bool);
 
+  /// Slot for switching between isodose surfaces and isodose lines computed per displayed slice
+  void setIsolinesPerSlice(bool);
+
   /// Slot for changing 3D scalar bar visibility
   void setScalarBarVisibility(bool);
 
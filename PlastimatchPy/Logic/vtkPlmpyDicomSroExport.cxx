@@ -137,12 +137,12 @@ void vtkPlmpyDicomSroExport::DoExport ()
     return;
   }
 
-  // Convert input CT/MR image to the format Plastimatch can use
+  // Convert input CT/MR image to the format Plastimatch can use. The exporter only reads the images, so the voxels can be shared
   vtkMRMLScalarVolumeNode* fixedNode = vtkMRMLScalarVolumeNode::SafeDownCast(this->GetMRMLScene()->GetNodeByID(this->FixedImageID));
-  Plm_image::Pointer fixedImage = PlmCommon::ConvertVolumeNodeToPlmImage (fixedNode, true);
+  Plm_image::Pointer fixedImage = PlmCommon::ConvertVolumeNodeToPlmImage (fixedNode, true, true);
 
   vtkMRMLScalarVolumeNode* movingNode = vtkMRMLScalarVolumeNode::SafeDownCast(this->GetMRMLScene()->GetNodeByID(this->MovingImageID));
-  Plm_image::Pointer movingImage = PlmCommon::ConvertVolumeNodeToPlmImage (movingNode, false);
+  Plm_image::Pointer movingImage = PlmCommon::ConvertVolumeNodeToPlmImage (movingNode, false, true);
 
   // Convert xform into a form that Plastimatch can use
   vtkMRMLLinearTransformNode *xformNode = vtkMRMLLinearTransformNode::SafeDownCast(this->GetMRMLScene()->GetNodeByID(this->XformID));
@@ -40,10 +40,10 @@
 //----------------------------------------------------------------------------
 template<class T> 
 static typename itk::Image<T,3>::Pointer
-convert_to_itk (vtkMRMLScalarVolumeNode* inVolumeNode, bool applyWorldTransform)
+convert_to_itk (vtkMRMLScalarVolumeNode* inVolumeNode, bool applyWorldTransform, bool shareVoxelData)
 {
   typename itk::Image<T,3>::Pointer image = itk::Image<T,3>::New ();
-  if (!SlicerRtCommon::ConvertVolumeNodeToItkImage<T>(inVolumeNode, image, applyWorldTransform, true))
+  if (!SlicerRtCommon::ConvertVolumeNodeToItkImage<T>(inVolumeNode, image, applyWorldTransform, true, shareVoxelData))
   {
     vtkGenericWarningMacro("PlmCommon::convert_to_itk(vtkMRMLScalarVolumeNode): Failed to convert volume node to PlmImage!");
   }
@@ -66,7 +66,7 @@ convert_to_itk (vtkOrientedImageData* inImageData)
 //----------------------------------------------------------------------------
 //----------------------------------------------------------------------------
 Plm_image::Pointer 
-PlmCommon::ConvertVolumeNodeToPlmImage(vtkMRMLScalarVolumeNode* inVolumeNode, bool applyWorldTransform/* = true*/)
+PlmCommon::ConvertVolumeNodeToPlmImage(vtkMRMLScalarVolumeNode* inVolumeNode, bool applyWorldTransform/* = true*/, bool shareVoxelData/* = false*/)
 {
   Plm_image::Pointer image = Plm_image::New ();
 
@@ -82,49 +82,49 @@ PlmCommon::ConvertVolumeNodeToPlmImage(vtkMRMLScalarVolumeNode* inVolumeNode, bo
   switch (vtk_type) {
   case VTK_CHAR:
   case VTK_SIGNED_CHAR:
-    image->set_itk (convert_to_itk<char> (inVolumeNode, applyWorldTransform));
+    image->set_itk (convert_to_itk<char> (inVolumeNode, applyWorldTransform, shareVoxelData));
     break;
   
   case VTK_UNSIGNED_CHAR:
-    image->set_itk (convert_to_itk<unsigned char> (inVolumeNode, applyWorldTransform));
+    image->set_itk (convert_to_itk<unsigned char> (inVolumeNode, applyWorldTransform, shareVoxelData));
     break;
   
   case VTK_SHORT:
-    image->set_itk (convert_to_itk<short> (inVolumeNode, applyWorldTransform));
+    image->set_itk (convert_to_itk<short> (inVolumeNode, applyWorldTransform, shareVoxelData));
     break;
   
   case VTK_UNSIGNED_SHORT:
-    image->set_itk (convert_to_itk<unsigned short> (inVolumeNode, applyWorldTransform));
+    image->set_itk (convert_to_itk<unsigned short> (inVolumeNode, applyWorldTransform, shareVoxelData));
     break;
   
 #if (CMAKE_SIZEOF_UINT == 4)
   case VTK_INT:
   case VTK_LONG: 
-    image->set_itk (convert_to_itk<int> (inVolumeNode, applyWorldTransform));
+    image->set_itk (convert_to_itk<int> (inVolumeNode, applyWorldTransform, shareVoxelData));
     break;
   
   case VTK_UNSIGNED_INT:
   case VTK_UNSIGNED_LONG:
-    image->set_itk (convert_to_itk<unsigned int> (inVolumeNode, applyWorldTransform));
+    image->set_itk (convert_to_itk<unsigned int> (inVolumeNode, applyWorldTransform, shareVoxelData));
     break;
 #else
   case VTK_INT:
   case VTK_LONG: 
-    image->set_itk (convert_to_itk<long> (inVolumeNode, applyWorldTransform));
+    image->set_itk (convert_to_itk<long> (inVolumeNode, applyWorldTransform, shareVoxelData));
     break;
   
   case VTK_UNSIGNED_INT:
   case VTK_UNSIGNED_LONG:
-    image->set_itk (convert_to_itk<unsigned long> (inVolumeNode, applyWorldTransform));
+    image->set_itk (convert_to_itk<unsigned long> (inVolumeNode, applyWorldTransform, shareVoxelData));
     break;
 #endif
   
   case VTK_FLOAT:
-    image->set_itk (convert_to_itk<float> (inVolumeNode, applyWorldTransform));
+    image->set_itk (convert_to_itk<float> (inVolumeNode, applyWorldTransform, shareVoxelData));
     break;
   
   case VTK_DOUBLE:
-    image->set_itk (convert_to_itk<double> (inVolumeNode, applyWorldTransform));
+    image->set_itk (convert_to_itk<double> (inVolumeNode, applyWorldTransform, shareVoxelData));
     break;
 
   default:
@@ -137,10 +137,10 @@ PlmCommon::ConvertVolumeNodeToPlmImage(vtkMRMLScalarVolumeNode* inVolumeNode, bo
 
 //----------------------------------------------------------------------------
 Plm_image::Pointer 
-PlmCommon::ConvertVolumeNodeToPlmImage(vtkMRMLNode* inNode, bool applyWorldTransform/* = true*/)
+PlmCommon::ConvertVolumeNodeToPlmImage(vtkMRMLNode* inNode, bool applyWorldTransform/* = true*/, bool shareVoxelData/* = false*/)
 {
   return PlmCommon::ConvertVolumeNodeToPlmImage(
-    vtkMRMLScalarVolumeNode::SafeDownCast(inNode), applyWorldTransform);
+    vtkMRMLScalarVolumeNode::SafeDownCast(inNode), applyWorldTransform, shareVoxelData);
 }
 
 //----------------------------------------------------------------------------
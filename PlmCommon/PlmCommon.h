@@ -48,14 +48,17 @@ public:
   /// Convert MRML volume node to Plm image using typed scalar volume node
   /// \param inVolumeNode Scalar volume node to convert
   /// \param applyWorldTransform Flag determining if parent transform is applied to volume node when converting to Plm image. True by default
-  static Plm_image::Pointer ConvertVolumeNodeToPlmImage(vtkMRMLScalarVolumeNode* inVolumeNode, bool applyWorldTransform = true);
+  /// \param shareVoxelData Reference the voxels of the volume node instead of copying them. Only use it if the Plm image
+  ///   is not modified in place. False by default
+  static Plm_image::Pointer ConvertVolumeNodeToPlmImage(vtkMRMLScalarVolumeNode* inVolumeNode, bool applyWorldTransform = true, bool shareVoxelData = false);
 
   /// Convert MRML volume node to Plm image using generic MRML node type
   /// \param inNode Node to convert (must be scalar volume node type)
   /// \param applyWorldTransform Flag determining if parent transform is applied to volume node when converting to Plm image. True by default
-  static Plm_image::Pointer ConvertVolumeNodeToPlmImage(vtkMRMLNode* inNode, bool applyWorldTransform = true);
+  /// \param shareVoxelData Reference the voxels of the volume node instead of copying them. False by default
+  static Plm_image::Pointer ConvertVolumeNodeToPlmImage(vtkMRMLNode* inNode, bool applyWorldTransform = true, bool shareVoxelData = false);
 
-  /// Convert VTK oriented image data to Plm image
+  /// Convert VTK oriented image data to Plm image. The Plm image references the voxels of the image data
   static Plm_image::Pointer ConvertVtkOrientedImageDataToPlmImage(vtkOrientedImageData* inImageData);
 };
 
@@ -22,6 +22,9 @@
 #include "vtkSlicerRoomsEyeViewModuleLogic.h"
 #include "vtkMRMLRoomsEyeViewNode.h"
 
+// Beams includes
+#include "vtkSlicerIECTransformLogic.h"
+
 // MRML includes
 #include <vtkMRMLScene.h>
 #include <vtkMRMLLinearTransformNode.h>
@@ -30,15 +33,30 @@
 
 // Slicer includes
 #include <vtkSlicerSegmentationsModuleLogic.h>
+#include <vtkMRMLSegmentationNode.h>
 #include <vtkSegmentationConverter.h>
+#include <vtkSegmentation.h>
+#include <vtkSegment.h>
 
 // VTK includes
+#include <vtkDoubleArray.h>
+#include <vtkIntArray.h>
+#include <vtkMath.h>
+#include <vtkMultiThreader.h>
 #include <vtkNew.h>
 #include <vtkSmartPointer.h>
 #include <vtkObjectFactory.h>
+#include <vtkOBBTree.h>
+#include <vtkPolyData.h>
 #include <vtkSlicerModelsLogic.h>
+#include <vtkTable.h>
 #include <vtkTransform.h>
 
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 //----------------------------------------------------------------------------
 // Treatment machine component names
 static const char* COLLIMATOR_MODEL_NAME = "CollimatorModel";
@@ -68,19 +86,222 @@ static const char* PATIENTSUPPORTSCALEDTRANSLATED_TO_TABLETOPVERTICALTRANSLATION
 static const char* TABLETOPECCENTRICROTATION_TO_PATIENTSUPPORT_TRANSFORM_NODE_NAME = "TableTopEccentricRotationToPatientSupportTransform";
 static const char* TABLETOP_TO_TABLETOPECCENENTRICROTATION_TRANSFORM_NODE_NAME = "TableTopToTableTopEccentricRotationTransform";
 
+//----------------------------------------------------------------------------
+// Transform node of each coordinate frame of the IEC transform logic
+struct IECTransformNodeName
+{
+  vtkSlicerIECTransformLogic::CoordinateSystemIdentifier Frame;
+  const char* NodeName;
+};
+static const IECTransformNodeName IEC_TRANSFORM_NODE_NAMES[] = {
+  { vtkSlicerIECTransformLogic::GantryToFixedReference, GANTRY_TO_FIXEDREFERENCE_TRANSFORM_NODE_NAME },
+  { vtkSlicerIECTransformLogic::CollimatorToGantry, COLLIMATOR_TO_GANTRY_TRANSFORM_NODE_NAME },
+  { vtkSlicerIECTransformLogic::LeftImagingPanelTranslation, LEFTIMAGINGPANELTRANSLATION_TRANSFORM_NODE_NAME },
+  { vtkSlicerIECTransformLogic::LeftImagingPanelRotatedToGantry, LEFTIMAGINGPANELROTATED_TO_GANTRY_TRANSFORM_NODE_NAME },
+  { vtkSlicerIECTransformLogic::LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotated,
+    LEFTIMAGINGPANELFIXEDREFERENCEISOCENTER_TO_LEFTIMAGINGPANELROTATED_TRANSFORM_NODE_NAME },
+  { vtkSlicerIECTransformLogic::LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenter,
+    LEFTIMAGINGPANEL_TO_LEFTIMAGINGPANELFIXEDREFERENCEISOCENTER_TRANSFORM_NODE_NAME },
+  { vtkSlicerIECTransformLogic::RightImagingPanelTranslation, RIGHTIMAGINGPANELTRANSLATION_TRANSFORM_NODE_NAME },
+  { vtkSlicerIECTransformLogic::RightImagingPanelRotatedToGantry, RIGHTIMAGINGPANELROTATED_TO_GANTRY_TRANSFORM_NODE_NAME },
+  { vtkSlicerIECTransformLogic::RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotated,
+    RIGHTIMAGINGPANELFIXEDREFERENCEISOCENTER_TO_RIGHTIMAGINGPANELROTATED_TRANSFORM_NODE_NAME },
+  { vtkSlicerIECTransformLogic::RightImagingPanelToRightImagingPanelFixedReferenceIsocenter,
+    RIGHTIMAGINGPANEL_TO_RIGHTIMAGINGPANELFIXEDREFERENCEISOCENTER_TRANSFORM_NODE_NAME },
+  { vtkSlicerIECTransformLogic::PatientSupportToFixedReference, PATIENTSUPPORT_TO_FIXEDREFERENCE_TRANSFORM_NODE_NAME },
+  { vtkSlicerIECTransformLogic::PatientSupportScaledTranslatedToTableTopVerticalTranslation,
+    PATIENTSUPPORTSCALEDTRANSLATED_TO_TABLETOPVERTICALTRANSLATION_TRANSFORM_NODE_NAME },
+  { vtkSlicerIECTransformLogic::PatientSupportScaledByTableTopVerticalMovement, PATIENTSUPPORTSCALEDBYTABLETOPVERTICALMOVEMENT_TRANSFORM_NODE_NAME },
+  { vtkSlicerIECTransformLogic::PatientSupportPositiveVerticalTranslation, PATIENTSUPPORTPOSITIVEVERTICALTRANSLATION_TRANSFORM_NODE_NAME },
+  { vtkSlicerIECTransformLogic::TableTopEccentricRotationToPatientSupport, TABLETOPECCENTRICROTATION_TO_PATIENTSUPPORT_TRANSFORM_NODE_NAME },
+  { vtkSlicerIECTransformLogic::TableTopToTableEccentricRotation, TABLETOP_TO_TABLETOPECCENENTRICROTATION_TRANSFORM_NODE_NAME }
+};
+static const int NUMBER_OF_IEC_TRANSFORM_NODES = sizeof(IEC_TRANSFORM_NODE_NAMES) / sizeof(IEC_TRANSFORM_NODE_NAMES[0]);
+
+//----------------------------------------------------------------------------
+// Treatment machine geometry
+//TODO: This is specific to the Varian TrueBeam STx model, move this somewhere else when generalizing for any treatment machine
+static const double COLLIMATOR_IMPLICIT_CENTER_OF_ROTATION[3] = { 3.652191162109375, 8.4510498046875, 528.0714111328125 };
+static const double COLLIMATOR_ACTUAL_CENTER_OF_ROTATION[3] = { -0.041, 0.094, 528.0714111328125 };
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /// Number of values in an angle range given by first value, last value and step
+  int GetNumberOfAngles(double angleRange[3])
+  {
+    if (angleRange[2] <= 0.0 || angleRange[1] < angleRange[0])
+    {
+      return 1;
+    }
+    return (int)floor((angleRange[1] - angleRange[0]) / angleRange[2] + 1.0e-6) + 1;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Set the collimator to gantry transform, translating the collimator to the actual center of rotation
+  /// and rotating it by the collimator angle
+  void SetCollimatorToGantryTransform(vtkTransform* collimatorToGantryTransform, double collimatorAngle)
+  {
+    // TODO: Look into why translating the object twice prevents wobble
+    double implicitCenterToActualCenterDisplacement[3] = {
+      COLLIMATOR_ACTUAL_CENTER_OF_ROTATION[0] - COLLIMATOR_IMPLICIT_CENTER_OF_ROTATION[0],
+      COLLIMATOR_ACTUAL_CENTER_OF_ROTATION[1] - COLLIMATOR_IMPLICIT_CENTER_OF_ROTATION[1],
+      COLLIMATOR_ACTUAL_CENTER_OF_ROTATION[2] - COLLIMATOR_IMPLICIT_CENTER_OF_ROTATION[2] };
+    collimatorToGantryTransform->Identity();
+    collimatorToGantryTransform->Translate(implicitCenterToActualCenterDisplacement);
+    collimatorToGantryTransform->RotateZ(collimatorAngle);
+    collimatorToGantryTransform->Translate(implicitCenterToActualCenterDisplacement);
+  }
+
+  //----------------------------------------------------------------------------
+  /// Poses and collision queries of a collision map computation shared by the worker threads
+  struct CollisionMapContext
+  {
+    std::vector<double> GantryAngles;
+    std::vector<double> PatientSupportAngles;
+    std::vector<double> CollimatorAngles;
+    /// Lateral, longitudinal and vertical table top displacements
+    std::vector<double> TableTopDisplacements;
+
+    vtkCollisionDetectionFilter* GantryTableTopCollisionDetection;
+    vtkCollisionDetectionFilter* GantryPatientSupportCollisionDetection;
+    vtkCollisionDetectionFilter* CollimatorTableTopCollisionDetection;
+    vtkCollisionDetectionFilter* GantryPatientCollisionDetection;
+    vtkCollisionDetectionFilter* CollimatorPatientCollisionDetection;
+    bool CheckPatientBody;
+
+    /// Collision flags of the poses
+    int* Collisions;
+  };
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE CollisionMapThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    CollisionMapContext* context = static_cast<CollisionMapContext*>(threadInfo->UserData);
+
+    int numberOfGantryAngles = (int)context->GantryAngles.size();
+    int numberOfPatientSupportAngles = (int)context->PatientSupportAngles.size();
+    int numberOfCollimatorAngles = (int)context->CollimatorAngles.size();
+    int numberOfTableTopDisplacements = (int)context->TableTopDisplacements.size() / 3;
+    vtkIdType numberOfPoses = (vtkIdType)numberOfGantryAngles * numberOfPatientSupportAngles
+      * numberOfCollimatorAngles * numberOfTableTopDisplacements;
+
+    // Each thread evaluates its poses on its own IEC transform hierarchy, as the cached matrices of the
+    // hierarchy are updated by the queries. Only the transforms of the angles that changed since the previous
+    // pose of the thread are set, so the cached matrices of the other pieces are reused.
+    vtkSmartPointer<vtkSlicerIECTransformLogic> iecLogic = vtkSmartPointer<vtkSlicerIECTransformLogic>::New();
+    int previousGantryIndex = -1;
+    int previousCollimatorIndex = -1;
+    int previousPatientSupportIndex = -1;
+    int previousTableTopIndex = -1;
+    vtkSmartPointer<vtkMatrix4x4> gantryToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkSmartPointer<vtkMatrix4x4> collimatorToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkSmartPointer<vtkMatrix4x4> patientSupportToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkSmartPointer<vtkMatrix4x4> tableTopToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+
+    // Interleave the poses so that the threads get a similar mix of colliding (cheap) and free (expensive) poses
+    for (vtkIdType poseIndex = threadInfo->ThreadID; poseIndex < numberOfPoses; poseIndex += threadInfo->NumberOfThreads)
+    {
+      vtkIdType remainder = poseIndex;
+      int collimatorIndex = (int)(remainder % numberOfCollimatorAngles);
+      remainder /= numberOfCollimatorAngles;
+      int patientSupportIndex = (int)(remainder % numberOfPatientSupportAngles);
+      remainder /= numberOfPatientSupportAngles;
+      int gantryIndex = (int)(remainder % numberOfGantryAngles);
+      int tableTopIndex = (int)(remainder / numberOfGantryAngles);
+
+      // Same transforms as the Update...Transform methods of the logic
+      if (gantryIndex != previousGantryIndex)
+      {
+        vtkTransform* gantryToFixedReferenceTransform = iecLogic->GetGantryToFixedReferenceTransform();
+        gantryToFixedReferenceTransform->Identity();
+        gantryToFixedReferenceTransform->RotateY(context->GantryAngles[gantryIndex]);
+        previousGantryIndex = gantryIndex;
+      }
+      if (collimatorIndex != previousCollimatorIndex)
+      {
+        SetCollimatorToGantryTransform(iecLogic->GetCollimatorToGantryTransform(), context->CollimatorAngles[collimatorIndex]);
+        previousCollimatorIndex = collimatorIndex;
+      }
+      if (patientSupportIndex != previousPatientSupportIndex)
+      {
+        vtkTransform* patientSupportToFixedReferenceTransform = iecLogic->GetPatientSupportToFixedReferenceTransform();
+        patientSupportToFixedReferenceTransform->Identity();
+        patientSupportToFixedReferenceTransform->RotateZ(context->PatientSupportAngles[patientSupportIndex]);
+        previousPatientSupportIndex = patientSupportIndex;
+      }
+      if (tableTopIndex != previousTableTopIndex)
+      {
+        vtkTransform* tableTopEccentricRotationToPatientSupportTransform = iecLogic->GetTableTopEccentricRotationToPatientSupportTransform();
+        tableTopEccentricRotationToPatientSupportTransform->Identity();
+        tableTopEccentricRotationToPatientSupportTransform->Translate(&context->TableTopDisplacements[3*tableTopIndex]);
+        previousTableTopIndex = tableTopIndex;
+      }
+
+      // The fixed reference coordinate system is the world coordinate system of the treatment room
+      iecLogic->GetMatrixBetween(vtkSlicerIECTransformLogic::GantryToFixedReference,
+        vtkSlicerIECTransformLogic::FixedReference, gantryToWorldMatrix);
+      iecLogic->GetMatrixBetween(vtkSlicerIECTransformLogic::CollimatorToGantry,
+        vtkSlicerIECTransformLogic::FixedReference, collimatorToWorldMatrix);
+      iecLogic->GetMatrixBetween(vtkSlicerIECTransformLogic::PatientSupportToFixedReference,
+        vtkSlicerIECTransformLogic::FixedReference, patientSupportToWorldMatrix);
+      iecLogic->GetMatrixBetween(vtkSlicerIECTransformLogic::TableTopEccentricRotationToPatientSupport,
+        vtkSlicerIECTransformLogic::FixedReference, tableTopToWorldMatrix);
+
+      int collisions = 0;
+      if (context->GantryTableTopCollisionDetection->IsColliding(gantryToWorldMatrix, tableTopToWorldMatrix))
+      {
+        collisions |= vtkSlicerRoomsEyeViewModuleLogic::GantryTableTopCollision;
+      }
+      if (context->GantryPatientSupportCollisionDetection->IsColliding(gantryToWorldMatrix, patientSupportToWorldMatrix))
+      {
+        collisions |= vtkSlicerRoomsEyeViewModuleLogic::GantryPatientSupportCollision;
+      }
+      if (context->CollimatorTableTopCollisionDetection->IsColliding(collimatorToWorldMatrix, tableTopToWorldMatrix))
+      {
+        collisions |= vtkSlicerRoomsEyeViewModuleLogic::CollimatorTableTopCollision;
+      }
+      if (context->CheckPatientBody)
+      {
+        if (context->GantryPatientCollisionDetection->IsColliding(gantryToWorldMatrix, tableTopToWorldMatrix))
+        {
+          collisions |= vtkSlicerRoomsEyeViewModuleLogic::GantryPatientCollision;
+        }
+        if (context->CollimatorPatientCollisionDetection->IsColliding(collimatorToWorldMatrix, tableTopToWorldMatrix))
+        {
+          collisions |= vtkSlicerRoomsEyeViewModuleLogic::CollimatorPatientCollision;
+        }
+      }
+      context->Collisions[poseIndex] = collisions;
+    }
+
+    return VTK_THREAD_RETURN_VALUE;
+  }
+}
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerRoomsEyeViewModuleLogic);
 
 //----------------------------------------------------------------------------
 vtkSlicerRoomsEyeViewModuleLogic::vtkSlicerRoomsEyeViewModuleLogic()
-  : CollimatorToWorldTransformMatrix(NULL)
+  : IECLogic(NULL)
+  , CollimatorToWorldTransformMatrix(NULL)
   , TableTopToWorldTransformMatrix(NULL)
   , GantryPatientCollisionDetection(NULL)
   , GantryTableTopCollisionDetection(NULL)
   , GantryPatientSupportCollisionDetection(NULL)
   , CollimatorPatientCollisionDetection(NULL)
   , CollimatorTableTopCollisionDetection(NULL)
+  , GantryOBBTree(NULL)
+  , CollimatorOBBTree(NULL)
+  , TableTopOBBTree(NULL)
+  , PatientSupportOBBTree(NULL)
+  , PatientBodyOBBTree(NULL)
+  , PatientBodyPolyData(NULL)
+  , PatientBodyMTime(0)
 {
+  this->IECLogic = vtkSlicerIECTransformLogic::New();
   this->CollimatorToWorldTransformMatrix = vtkMatrix4x4::New();
   this->TableTopToWorldTransformMatrix = vtkMatrix4x4::New();
 
@@ -89,11 +310,42 @@ vtkSlicerRoomsEyeViewModuleLogic::vtkSlicerRoomsEyeViewModuleLogic()
   this->GantryPatientSupportCollisionDetection = vtkCollisionDetectionFilter::New();
   this->CollimatorPatientCollisionDetection = vtkCollisionDetectionFilter::New();
   this->CollimatorTableTopCollisionDetection = vtkCollisionDetectionFilter::New();
+
+  this->GantryOBBTree = vtkOBBTree::New();
+  this->CollimatorOBBTree = vtkOBBTree::New();
+  this->TableTopOBBTree = vtkOBBTree::New();
+  this->PatientSupportOBBTree = vtkOBBTree::New();
+  this->PatientBodyOBBTree = vtkOBBTree::New();
+  this->PatientBodyPolyData = vtkPolyData::New();
+
+  // Share the trees of the models used by multiple collision detection filters
+  this->GantryTableTopCollisionDetection->SetOBBTree(0, this->GantryOBBTree);
+  this->GantryTableTopCollisionDetection->SetOBBTree(1, this->TableTopOBBTree);
+  this->GantryPatientSupportCollisionDetection->SetOBBTree(0, this->GantryOBBTree);
+  this->GantryPatientSupportCollisionDetection->SetOBBTree(1, this->PatientSupportOBBTree);
+  this->CollimatorTableTopCollisionDetection->SetOBBTree(0, this->CollimatorOBBTree);
+  this->CollimatorTableTopCollisionDetection->SetOBBTree(1, this->TableTopOBBTree);
+  this->GantryPatientCollisionDetection->SetOBBTree(0, this->GantryOBBTree);
+  this->GantryPatientCollisionDetection->SetOBBTree(1, this->PatientBodyOBBTree);
+  this->CollimatorPatientCollisionDetection->SetOBBTree(0, this->CollimatorOBBTree);
+  this->CollimatorPatientCollisionDetection->SetOBBTree(1, this->PatientBodyOBBTree);
+
+  // Most poses of a collision map are far from contact, where the convex proxies skip the tree traversals
+  this->GantryTableTopCollisionDetection->UseProxiesOn();
+  this->GantryPatientSupportCollisionDetection->UseProxiesOn();
+  this->CollimatorTableTopCollisionDetection->UseProxiesOn();
+  this->GantryPatientCollisionDetection->UseProxiesOn();
+  this->CollimatorPatientCollisionDetection->UseProxiesOn();
 }
 
 //----------------------------------------------------------------------------
 vtkSlicerRoomsEyeViewModuleLogic::~vtkSlicerRoomsEyeViewModuleLogic()
 {
+  if (this->IECLogic)
+  {
+    this->IECLogic->Delete();
+    this->IECLogic = NULL;
+  }
   if (this->CollimatorToWorldTransformMatrix)
   {
     this->CollimatorToWorldTransformMatrix->Delete();
@@ -130,6 +382,37 @@ vtkSlicerRoomsEyeViewModuleLogic::~vtkSlicerRoomsEyeViewModuleLogic()
     this->CollimatorTableTopCollisionDetection->Delete();
     this->CollimatorTableTopCollisionDetection = NULL;
   }
+
+  if (this->GantryOBBTree)
+  {
+    this->GantryOBBTree->Delete();
+    this->GantryOBBTree = NULL;
+  }
+  if (this->CollimatorOBBTree)
+  {
+    this->CollimatorOBBTree->Delete();
+    this->CollimatorOBBTree = NULL;
+  }
+  if (this->TableTopOBBTree)
+  {
+    this->TableTopOBBTree->Delete();
+    this->TableTopOBBTree = NULL;
+  }
+  if (this->PatientSupportOBBTree)
+  {
+    this->PatientSupportOBBTree->Delete();
+    this->PatientSupportOBBTree = NULL;
+  }
+  if (this->PatientBodyOBBTree)
+  {
+    this->PatientBodyOBBTree->Delete();
+    this->PatientBodyOBBTree = NULL;
+  }
+  if (this->PatientBodyPolyData)
+  {
+    this->PatientBodyPolyData->Delete();
+    this->PatientBodyPolyData = NULL;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -317,8 +600,18 @@ void vtkSlicerRoomsEyeViewModuleLogic::SetMRMLSceneInternal(vtkMRMLScene* newSce
   tableTopEccentricRotationToPatientSupportTransformNode->SetAndObserveTransformNodeID(patientSupportToFixedReferenceTransformNode->GetID());
   tableTopToTableTopEccentricRotationTransformNode->SetAndObserveTransformNodeID(tableTopEccentricRotationToPatientSupportTransformNode->GetID());
 
-  collimatorToGantryTransformNode->GetMatrixTransformToWorld(this->CollimatorToWorldTransformMatrix);
-  tableTopEccentricRotationToPatientSupportTransformNode->GetMatrixTransformToWorld(this->TableTopToWorldTransformMatrix);
+  // Start the IEC transform logic from the transforms in the scene
+  for (int nodeIndex=0; nodeIndex<NUMBER_OF_IEC_TRANSFORM_NODES; ++nodeIndex)
+  {
+    vtkMRMLLinearTransformNode* transformNode = vtkMRMLLinearTransformNode::SafeDownCast(
+      newScene->GetFirstNodeByName(IEC_TRANSFORM_NODE_NAMES[nodeIndex].NodeName) );
+    vtkSmartPointer<vtkMatrix4x4> transformToParentMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    transformNode->GetMatrixTransformToParent(transformToParentMatrix);
+    vtkTransform* transformToParent = this->IECLogic->GetTransformToParent(IEC_TRANSFORM_NODE_NAMES[nodeIndex].Frame);
+    transformToParent->SetMatrix(transformToParentMatrix);
+    transformToParent->Modified();
+  }
+  this->UpdateWorldTransformMatrices();
 
   //TODO: Should not be needed!
   // Set transform nodes to parameter set nodes
@@ -542,6 +835,101 @@ bool vtkSlicerRoomsEyeViewModuleLogic::GetPatientBodyPolyData(vtkMRMLRoomsEyeVie
     patientBodyPolyData );
 }
 
+//----------------------------------------------------------------------------
+vtkMTimeType vtkSlicerRoomsEyeViewModuleLogic::GetPatientBodyMTime(vtkMRMLRoomsEyeViewNode* parameterNode)
+{
+  vtkMRMLSegmentationNode* segmentationNode = (parameterNode ? parameterNode->GetPatientBodySegmentationNode() : NULL);
+  if (!segmentationNode)
+  {
+    return 0;
+  }
+
+  vtkMTimeType mTime = segmentationNode->GetMTime();
+  vtkSegmentation* segmentation = segmentationNode->GetSegmentation();
+  if (segmentation)
+  {
+    mTime = std::max(mTime, segmentation->GetMTime());
+    vtkSegment* segment = (parameterNode->GetPatientBodySegmentID()
+      ? segmentation->GetSegment(parameterNode->GetPatientBodySegmentID()) : NULL);
+    if (segment)
+    {
+      // Representations are modified in place when the segment is edited
+      vtkDataObject* masterRepresentation = segment->GetRepresentation(segmentation->GetMasterRepresentationName());
+      if (masterRepresentation)
+      {
+        mTime = std::max(mTime, masterRepresentation->GetMTime());
+      }
+      vtkDataObject* closedSurfaceRepresentation = segment->GetRepresentation(
+        vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName() );
+      if (closedSurfaceRepresentation)
+      {
+        mTime = std::max(mTime, closedSurfaceRepresentation->GetMTime());
+      }
+    }
+  }
+
+  // The closed surface is transformed to world coordinates
+  for (vtkMRMLTransformNode* transformNode = segmentationNode->GetParentTransformNode();
+    transformNode; transformNode = transformNode->GetParentTransformNode())
+  {
+    mTime = std::max(mTime, transformNode->GetMTime());
+    if (transformNode->GetTransformToParent())
+    {
+      mTime = std::max(mTime, transformNode->GetTransformToParent()->GetMTime());
+    }
+  }
+
+  return mTime;
+}
+
+//----------------------------------------------------------------------------
+vtkPolyData* vtkSlicerRoomsEyeViewModuleLogic::UpdatePatientBodyPolyData(vtkMRMLRoomsEyeViewNode* parameterNode)
+{
+  if (!parameterNode)
+  {
+    vtkErrorMacro("UpdatePatientBodyPolyData: Invalid parameter set node!");
+    return NULL;
+  }
+
+  vtkMRMLSegmentationNode* segmentationNode = parameterNode->GetPatientBodySegmentationNode();
+  if (!segmentationNode || !parameterNode->GetPatientBodySegmentID())
+  {
+    return NULL;
+  }
+
+  std::string segmentationNodeID(segmentationNode->GetID() ? segmentationNode->GetID() : "");
+  std::string segmentID(parameterNode->GetPatientBodySegmentID());
+  vtkMTimeType patientBodyMTime = this->GetPatientBodyMTime(parameterNode);
+  if ( segmentationNodeID != this->PatientBodySegmentationNodeID || segmentID != this->PatientBodySegmentID
+    || patientBodyMTime != this->PatientBodyMTime )
+  {
+    // Regenerate the poly data in the cached object. Its modified time changes, so the OBB tree is rebuilt once
+    if (!this->GetPatientBodyPolyData(parameterNode, this->PatientBodyPolyData))
+    {
+      this->PatientBodyPolyData->Initialize();
+      this->PatientBodySegmentationNodeID.clear();
+      this->PatientBodySegmentID.clear();
+      this->PatientBodyMTime = 0;
+      return NULL;
+    }
+    this->PatientBodySegmentationNodeID = segmentationNodeID;
+    this->PatientBodySegmentID = segmentID;
+    this->PatientBodyMTime = patientBodyMTime;
+  }
+
+  // Only connect the input if it is not connected yet, the OBB tree is kept as long as the poly data is unchanged
+  if (this->GantryPatientCollisionDetection->GetInput(1) != this->PatientBodyPolyData)
+  {
+    this->GantryPatientCollisionDetection->SetInput(1, this->PatientBodyPolyData);
+  }
+  if (this->CollimatorPatientCollisionDetection->GetInput(1) != this->PatientBodyPolyData)
+  {
+    this->CollimatorPatientCollisionDetection->SetInput(1, this->PatientBodyPolyData);
+  }
+
+  return this->PatientBodyPolyData;
+}
+
 //----------------------------------------------------------------------------
 void vtkSlicerRoomsEyeViewModuleLogic::UpdateCollimatorToGantryTransform(vtkMRMLRoomsEyeViewNode* parameterNode)
 {
@@ -551,22 +939,14 @@ void vtkSlicerRoomsEyeViewModuleLogic::UpdateCollimatorToGantryTransform(vtkMRML
     return;
   }
 
-  vtkMRMLLinearTransformNode* collimatorToGantryTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(COLLIMATOR_TO_GANTRY_TRANSFORM_NODE_NAME) );
-  vtkTransform* collimatorToGantryTransform = vtkTransform::SafeDownCast(
-    collimatorToGantryTransformNode->GetTransformToParent() );
+  vtkTransform* collimatorToGantryTransform = this->IECLogic->GetCollimatorToGantryTransform();
 
-  //TODO: This is specific to the Varian TrueBeam STx model, move this somewhere else when generalizing for any treatment machine
   // Translates collimator to actual center of rotation and then rotates based on rotationAngle
-  // TODO: Look into why translating the object twice prevents wobble
-  collimatorToGantryTransform->Identity();
-  double implicitCenterOfRotation[3] = { 3.652191162109375, 8.4510498046875, 528.0714111328125 };
-  double actualCenterOfRotation[3] = { -0.041, 0.094, 528.0714111328125 };
-  double implicitCenterToActualCenterDisplacement[3] = { actualCenterOfRotation[0] - implicitCenterOfRotation[0], actualCenterOfRotation[1] - implicitCenterOfRotation[1], actualCenterOfRotation[2] - implicitCenterOfRotation[2] };
-  collimatorToGantryTransform->Translate(implicitCenterToActualCenterDisplacement);
-  collimatorToGantryTransform->RotateZ(parameterNode->GetCollimatorRotationAngle());
-  collimatorToGantryTransform->Translate(implicitCenterToActualCenterDisplacement);
+  SetCollimatorToGantryTransform(collimatorToGantryTransform, parameterNode->GetCollimatorRotationAngle());
   collimatorToGantryTransform->Modified();
+
+  this->UpdateTransformNodeFromIECLogic(vtkSlicerIECTransformLogic::CollimatorToGantry);
+  this->UpdateWorldTransformMatrices();
 }
 
 //----------------------------------------------------------------------------
@@ -578,21 +958,14 @@ void vtkSlicerRoomsEyeViewModuleLogic::UpdateGantryToFixedReferenceTransform(vtk
     return;
   }
 
-  vtkMRMLLinearTransformNode* gantryToFixedReferenceTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(GANTRY_TO_FIXEDREFERENCE_TRANSFORM_NODE_NAME) );
-  vtkTransform* gantryToFixedReferenceTransform = vtkTransform::SafeDownCast(
-    gantryToFixedReferenceTransformNode->GetTransformToParent() );
+  vtkTransform* gantryToFixedReferenceTransform = this->IECLogic->GetGantryToFixedReferenceTransform();
 
   gantryToFixedReferenceTransform->Identity();
   gantryToFixedReferenceTransform->RotateY(parameterNode->GetGantryRotationAngle());
   gantryToFixedReferenceTransform->Modified();
 
-  vtkMRMLLinearTransformNode* collimatorToGantryTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(COLLIMATOR_TO_GANTRY_TRANSFORM_NODE_NAME) );
-  vtkTransform* collimatorToGantryTransform = vtkTransform::SafeDownCast(
-    collimatorToGantryTransformNode->GetTransformToParent() );
-
-  collimatorToGantryTransformNode->GetMatrixTransformToWorld(this->CollimatorToWorldTransformMatrix);
+  this->UpdateTransformNodeFromIECLogic(vtkSlicerIECTransformLogic::GantryToFixedReference);
+  this->UpdateWorldTransformMatrices();
 }
 
 //-----------------------------------------------------------------------------
@@ -605,22 +978,15 @@ void vtkSlicerRoomsEyeViewModuleLogic::UpdateLeftImagingPanelToLeftImagingPanelF
   }
 
   //TODO: This method does not use any input
-  vtkMRMLLinearTransformNode* leftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(LEFTIMAGINGPANEL_TO_LEFTIMAGINGPANELFIXEDREFERENCEISOCENTER_TRANSFORM_NODE_NAME) );
-  vtkTransform* leftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransform = vtkTransform::SafeDownCast(
-    leftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransformNode->GetTransformToParent() );
+  vtkTransform* leftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransform = this->IECLogic->GetLeftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransform();
 
   leftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransform->Identity();
   double translationArray[3] = { 656.606, -1518.434, -345.164 };
   leftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransform->Translate(translationArray);
   leftImagingPanelToLeftImagingPanelFixedReferenceIsocenterTransform->Modified();
 
-  vtkMRMLLinearTransformNode* collimatorToGantryTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(COLLIMATOR_TO_GANTRY_TRANSFORM_NODE_NAME) );
-  vtkTransform* collimatorToGantryTransform = vtkTransform::SafeDownCast(
-    collimatorToGantryTransformNode->GetTransformToParent() );
-
-  collimatorToGantryTransformNode->GetMatrixTransformToWorld(this->CollimatorToWorldTransformMatrix);
+  this->UpdateTransformNodeFromIECLogic(vtkSlicerIECTransformLogic::LeftImagingPanelToLeftImagingPanelFixedReferenceIsocenter);
+  this->UpdateWorldTransformMatrices();
 }
 
 //-----------------------------------------------------------------------------
@@ -634,10 +1000,7 @@ void vtkSlicerRoomsEyeViewModuleLogic::UpdateLeftImagingPanelFixedReferenceIsoce
 
   double panelMovement = parameterNode->GetImagingPanelMovement();
 
-  vtkMRMLLinearTransformNode* leftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(LEFTIMAGINGPANELFIXEDREFERENCEISOCENTER_TO_LEFTIMAGINGPANELROTATED_TRANSFORM_NODE_NAME) );
-  vtkTransform* leftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform = vtkTransform::SafeDownCast(
-    leftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransformNode->GetTransformToParent() );
+  vtkTransform* leftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform = this->IECLogic->GetLeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform();
 
   leftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform->Identity();
   if (panelMovement > 0)
@@ -651,12 +1014,8 @@ void vtkSlicerRoomsEyeViewModuleLogic::UpdateLeftImagingPanelFixedReferenceIsoce
 
   leftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotatedTransform->Modified();
 
-  vtkMRMLLinearTransformNode* collimatorToGantryTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(COLLIMATOR_TO_GANTRY_TRANSFORM_NODE_NAME) );
-  vtkTransform* collimatorToGantryTransform = vtkTransform::SafeDownCast(
-    collimatorToGantryTransformNode->GetTransformToParent() );
-
-  collimatorToGantryTransformNode->GetMatrixTransformToWorld(this->CollimatorToWorldTransformMatrix);
+  this->UpdateTransformNodeFromIECLogic(vtkSlicerIECTransformLogic::LeftImagingPanelFixedReferenceIsocenterToLeftImagingPanelRotated);
+  this->UpdateWorldTransformMatrices();
 }
 
 //-----------------------------------------------------------------------------
@@ -669,22 +1028,15 @@ void vtkSlicerRoomsEyeViewModuleLogic::UpdateLeftImagingPanelRotatedToGantryTran
   }
 
   //TODO: This method does not use any input
-  vtkMRMLLinearTransformNode* leftImagingPanelRotatedToGantryTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(LEFTIMAGINGPANELROTATED_TO_GANTRY_TRANSFORM_NODE_NAME) );
-  vtkTransform* leftImagingPanelRotatedToGantryTransform = vtkTransform::SafeDownCast(
-    leftImagingPanelRotatedToGantryTransformNode->GetTransformToParent() );
+  vtkTransform* leftImagingPanelRotatedToGantryTransform = this->IECLogic->GetLeftImagingPanelRotatedToGantryTransform();
 
   leftImagingPanelRotatedToGantryTransform->Identity();
   double translationArray[3] = { -656.606, 1518.434, 345.164 };
   leftImagingPanelRotatedToGantryTransform->Translate(translationArray);
   leftImagingPanelRotatedToGantryTransform->Modified();
 
-  vtkMRMLLinearTransformNode* collimatorToGantryTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(COLLIMATOR_TO_GANTRY_TRANSFORM_NODE_NAME) );
-  vtkTransform* collimatorToGantryTransform = vtkTransform::SafeDownCast(
-    collimatorToGantryTransformNode->GetTransformToParent() );
-
-  collimatorToGantryTransformNode->GetMatrixTransformToWorld(this->CollimatorToWorldTransformMatrix);
+  this->UpdateTransformNodeFromIECLogic(vtkSlicerIECTransformLogic::LeftImagingPanelRotatedToGantry);
+  this->UpdateWorldTransformMatrices();
 }
 
 //-----------------------------------------------------------------------------
@@ -698,22 +1050,15 @@ void vtkSlicerRoomsEyeViewModuleLogic::UpdateLeftImagingPanelTranslationTransfor
 
   double panelMovement = parameterNode->GetImagingPanelMovement();
 
-  vtkMRMLLinearTransformNode* leftImagingPanelTranslationTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(LEFTIMAGINGPANELTRANSLATION_TRANSFORM_NODE_NAME) );
-  vtkTransform* leftImagingPanelTranslationTransform = vtkTransform::SafeDownCast(
-    leftImagingPanelTranslationTransformNode->GetTransformToParent() );
+  vtkTransform* leftImagingPanelTranslationTransform = this->IECLogic->GetLeftImagingPanelTranslationTransform();
 
   leftImagingPanelTranslationTransform->Identity();
   double translationArray[3] = { 0, -(panelMovement), 0 };
   leftImagingPanelTranslationTransform->Translate(translationArray);
   leftImagingPanelTranslationTransform->Modified();
 
-  vtkMRMLLinearTransformNode* collimatorToGantryTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(COLLIMATOR_TO_GANTRY_TRANSFORM_NODE_NAME) );
-  vtkTransform* collimatorToGantryTransform = vtkTransform::SafeDownCast(
-    collimatorToGantryTransformNode->GetTransformToParent() );
-
-  collimatorToGantryTransformNode->GetMatrixTransformToWorld(this->CollimatorToWorldTransformMatrix); //TODO: Why is this done in every function?
+  this->UpdateTransformNodeFromIECLogic(vtkSlicerIECTransformLogic::LeftImagingPanelTranslation);
+  this->UpdateWorldTransformMatrices();
 }
 
 //-----------------------------------------------------------------------------
@@ -726,22 +1071,15 @@ void vtkSlicerRoomsEyeViewModuleLogic::UpdateRightImagingPanelToRightImagingPane
   }
 
   //TODO: This method does not use any input
-  vtkMRMLLinearTransformNode* rightImagingPanelToRightImagingPanelFixedReferenceIsocenterTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(RIGHTIMAGINGPANEL_TO_RIGHTIMAGINGPANELFIXEDREFERENCEISOCENTER_TRANSFORM_NODE_NAME) );
-  vtkTransform* rightImagingPanelToRightImagingPanelFixedReferenceIsocenterTransform = vtkTransform::SafeDownCast(
-    rightImagingPanelToRightImagingPanelFixedReferenceIsocenterTransformNode->GetTransformToParent() );
+  vtkTransform* rightImagingPanelToRightImagingPanelFixedReferenceIsocenterTransform = this->IECLogic->GetRightImagingPanelToRightImagingPanelFixedReferenceIsocenterTransform();
 
   rightImagingPanelToRightImagingPanelFixedReferenceIsocenterTransform->Identity();
   double translationArray[3] = { -649.763, -1504.412, -342.200 };
   rightImagingPanelToRightImagingPanelFixedReferenceIsocenterTransform->Translate(translationArray);
   rightImagingPanelToRightImagingPanelFixedReferenceIsocenterTransform->Modified();
 
-  vtkMRMLLinearTransformNode* collimatorToGantryTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(COLLIMATOR_TO_GANTRY_TRANSFORM_NODE_NAME) );
-  vtkTransform* collimatorToGantryTransform = vtkTransform::SafeDownCast(
-    collimatorToGantryTransformNode->GetTransformToParent() );
-
-  collimatorToGantryTransformNode->GetMatrixTransformToWorld(this->CollimatorToWorldTransformMatrix);
+  this->UpdateTransformNodeFromIECLogic(vtkSlicerIECTransformLogic::RightImagingPanelToRightImagingPanelFixedReferenceIsocenter);
+  this->UpdateWorldTransformMatrices();
 }
 
 //-----------------------------------------------------------------------------
@@ -755,10 +1093,7 @@ void vtkSlicerRoomsEyeViewModuleLogic::UpdateRightImagingPanelFixedReferenceIsoc
 
   double panelMovement = parameterNode->GetImagingPanelMovement();
 
-  vtkMRMLLinearTransformNode* rightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(RIGHTIMAGINGPANELFIXEDREFERENCEISOCENTER_TO_RIGHTIMAGINGPANELROTATED_TRANSFORM_NODE_NAME) );
-  vtkTransform* rightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform = vtkTransform::SafeDownCast(
-    rightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransformNode->GetTransformToParent() );
+  vtkTransform* rightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform = this->IECLogic->GetRightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform();
 
   rightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform->Identity();
   if (panelMovement > 0)
@@ -771,12 +1106,8 @@ void vtkSlicerRoomsEyeViewModuleLogic::UpdateRightImagingPanelFixedReferenceIsoc
   }
   rightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotatedTransform->Modified();
 
-  vtkMRMLLinearTransformNode* collimatorToGantryTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(COLLIMATOR_TO_GANTRY_TRANSFORM_NODE_NAME) );
-  vtkTransform* collimatorToGantryTransform = vtkTransform::SafeDownCast(
-    collimatorToGantryTransformNode->GetTransformToParent() );
-
-  collimatorToGantryTransformNode->GetMatrixTransformToWorld(this->CollimatorToWorldTransformMatrix);
+  this->UpdateTransformNodeFromIECLogic(vtkSlicerIECTransformLogic::RightImagingPanelFixedReferenceIsocenterToRightImagingPanelRotated);
+  this->UpdateWorldTransformMatrices();
 }
 
 //-----------------------------------------------------------------------------
@@ -789,22 +1120,15 @@ void vtkSlicerRoomsEyeViewModuleLogic::UpdateRightImagingPanelRotatedToGantryTra
   }
 
   //TODO: This method does not use any input
-  vtkMRMLLinearTransformNode* rightImagingPanelRotatedToGantryTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(RIGHTIMAGINGPANELROTATED_TO_GANTRY_TRANSFORM_NODE_NAME) );
-  vtkTransform* rightImagingPanelRotatedToGantryTransform = vtkTransform::SafeDownCast(
-    rightImagingPanelRotatedToGantryTransformNode->GetTransformToParent() );
+  vtkTransform* rightImagingPanelRotatedToGantryTransform = this->IECLogic->GetRightImagingPanelRotatedToGantryTransform();
 
   rightImagingPanelRotatedToGantryTransform->Identity();
   double translationArray[3] = { 649.763, 1504.412, 342.200 };
   rightImagingPanelRotatedToGantryTransform->Translate(translationArray);
   rightImagingPanelRotatedToGantryTransform->Modified();
 
-  vtkMRMLLinearTransformNode* collimatorToGantryTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(COLLIMATOR_TO_GANTRY_TRANSFORM_NODE_NAME) );
-  vtkTransform* collimatorToGantryTransform = vtkTransform::SafeDownCast(
-    collimatorToGantryTransformNode->GetTransformToParent() );
-
-  collimatorToGantryTransformNode->GetMatrixTransformToWorld(this->CollimatorToWorldTransformMatrix);
+  this->UpdateTransformNodeFromIECLogic(vtkSlicerIECTransformLogic::RightImagingPanelRotatedToGantry);
+  this->UpdateWorldTransformMatrices();
 }
 
 //-----------------------------------------------------------------------------
@@ -818,22 +1142,15 @@ void vtkSlicerRoomsEyeViewModuleLogic::UpdateRightImagingPanelTranslationTransfo
 
   double panelMovement = parameterNode->GetImagingPanelMovement();
 
-  vtkMRMLLinearTransformNode* rightImagingPanelTranslationTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(RIGHTIMAGINGPANELTRANSLATION_TRANSFORM_NODE_NAME) );
-  vtkTransform* rightImagingPanelTranslationTransform = vtkTransform::SafeDownCast(
-    rightImagingPanelTranslationTransformNode->GetTransformToParent() );
+  vtkTransform* rightImagingPanelTranslationTransform = this->IECLogic->GetRightImagingPanelTranslationTransform();
 
   rightImagingPanelTranslationTransform->Identity();
   double translationArray[3] = { 0, -(panelMovement), 0 };
   rightImagingPanelTranslationTransform->Translate(translationArray);
   rightImagingPanelTranslationTransform->Modified();
 
-  vtkMRMLLinearTransformNode* collimatorToGantryTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(COLLIMATOR_TO_GANTRY_TRANSFORM_NODE_NAME) );
-  vtkTransform* collimatorToGantryTransform = vtkTransform::SafeDownCast(
-    collimatorToGantryTransformNode->GetTransformToParent() );
-
-  collimatorToGantryTransformNode->GetMatrixTransformToWorld(this->CollimatorToWorldTransformMatrix);
+  this->UpdateTransformNodeFromIECLogic(vtkSlicerIECTransformLogic::RightImagingPanelTranslation);
+  this->UpdateWorldTransformMatrices();
 }
 
 //-----------------------------------------------------------------------------
@@ -871,21 +1188,14 @@ void vtkSlicerRoomsEyeViewModuleLogic::UpdatePatientSupportToFixedReferenceTrans
 
   double rotationAngle = parameterNode->GetPatientSupportRotationAngle();
 
-  vtkMRMLLinearTransformNode* patientSupportToFixedReferenceTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(PATIENTSUPPORT_TO_FIXEDREFERENCE_TRANSFORM_NODE_NAME) );
-  vtkTransform* patientSupportToFixedReferenceTransform = vtkTransform::SafeDownCast(
-    patientSupportToFixedReferenceTransformNode->GetTransformToParent() );
+  vtkTransform* patientSupportToFixedReferenceTransform = this->IECLogic->GetPatientSupportToFixedReferenceTransform();
 
   patientSupportToFixedReferenceTransform->Identity();
   patientSupportToFixedReferenceTransform->RotateZ(rotationAngle);
   patientSupportToFixedReferenceTransform->Modified();
 
-  vtkMRMLLinearTransformNode* tableTopEccentricRotationToPatientSupportTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(TABLETOPECCENTRICROTATION_TO_PATIENTSUPPORT_TRANSFORM_NODE_NAME) );
-  vtkTransform* tableTopEccentricRotationToPatientSupportTransform = vtkTransform::SafeDownCast(
-    tableTopEccentricRotationToPatientSupportTransformNode->GetTransformToParent() );
-
-  tableTopEccentricRotationToPatientSupportTransformNode->GetMatrixTransformToWorld(this->TableTopToWorldTransformMatrix);
+  this->UpdateTransformNodeFromIECLogic(vtkSlicerIECTransformLogic::PatientSupportToFixedReference);
+  this->UpdateWorldTransformMatrices();
 }
 
 //-----------------------------------------------------------------------------
@@ -898,10 +1208,7 @@ void vtkSlicerRoomsEyeViewModuleLogic::UpdateTableTopEccentricRotationToPatientS
   }
 
   //TODO: This method does not use any input
-  vtkMRMLLinearTransformNode* tableTopEccentricRotationToPatientSupportTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(TABLETOPECCENTRICROTATION_TO_PATIENTSUPPORT_TRANSFORM_NODE_NAME) );
-  vtkTransform* tableTopEccentricRotationToPatientSupportTransform = vtkTransform::SafeDownCast(
-    tableTopEccentricRotationToPatientSupportTransformNode->GetTransformToParent() );
+  vtkTransform* tableTopEccentricRotationToPatientSupportTransform = this->IECLogic->GetTableTopEccentricRotationToPatientSupportTransform();
 
   tableTopEccentricRotationToPatientSupportTransform->Identity();
   double translationArray[3] = {
@@ -909,7 +1216,8 @@ void vtkSlicerRoomsEyeViewModuleLogic::UpdateTableTopEccentricRotationToPatientS
   tableTopEccentricRotationToPatientSupportTransform->Translate(translationArray);
   tableTopEccentricRotationToPatientSupportTransform->Modified();
 
-  tableTopEccentricRotationToPatientSupportTransformNode->GetMatrixTransformToWorld(this->TableTopToWorldTransformMatrix);
+  this->UpdateTransformNodeFromIECLogic(vtkSlicerIECTransformLogic::TableTopEccentricRotationToPatientSupport);
+  this->UpdateWorldTransformMatrices();
 }
 
 //-----------------------------------------------------------------------------
@@ -922,22 +1230,15 @@ void vtkSlicerRoomsEyeViewModuleLogic::UpdatePatientSupportScaledTranslatedToTab
   }
 
   //TODO: This method does not use any input
-  vtkMRMLLinearTransformNode* patientSupportScaledTranslatedToTableTopVerticalTranslationTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(PATIENTSUPPORTSCALEDTRANSLATED_TO_TABLETOPVERTICALTRANSLATION_TRANSFORM_NODE_NAME) );
-  vtkTransform* patientSupportScaledTranslatedToTableTopVerticalTranslationTransform = vtkTransform::SafeDownCast(
-    patientSupportScaledTranslatedToTableTopVerticalTranslationTransformNode->GetTransformToParent() );
+  vtkTransform* patientSupportScaledTranslatedToTableTopVerticalTranslationTransform = this->IECLogic->GetPatientSupportScaledTranslatedToTableTopVerticalTranslationTransform();
 
   patientSupportScaledTranslatedToTableTopVerticalTranslationTransform->Identity();
   double translationArray[3] = { 0, 0, -1359.469848632281225 };
   patientSupportScaledTranslatedToTableTopVerticalTranslationTransform->Translate(translationArray);
   patientSupportScaledTranslatedToTableTopVerticalTranslationTransform->Modified();
 
-  vtkMRMLLinearTransformNode* tableTopEccentricRotationToPatientSupportTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(TABLETOPECCENTRICROTATION_TO_PATIENTSUPPORT_TRANSFORM_NODE_NAME) );
-  vtkTransform* tableTopEccentricRotationToPatientSupportTransform = vtkTransform::SafeDownCast(
-    tableTopEccentricRotationToPatientSupportTransformNode->GetTransformToParent() );
-
-  tableTopEccentricRotationToPatientSupportTransformNode->GetMatrixTransformToWorld(this->TableTopToWorldTransformMatrix);
+  this->UpdateTransformNodeFromIECLogic(vtkSlicerIECTransformLogic::PatientSupportScaledTranslatedToTableTopVerticalTranslation);
+  this->UpdateWorldTransformMatrices();
 }
 
 //-----------------------------------------------------------------------------
@@ -951,21 +1252,14 @@ void vtkSlicerRoomsEyeViewModuleLogic::UpdatePatientSupportScaledByTableTopVerti
 
   double tableTopDisplacement = parameterNode->GetVerticalTableTopDisplacement();
 
-  vtkMRMLLinearTransformNode* patientSupportScaledByTableTopVerticalMovementTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(PATIENTSUPPORTSCALEDBYTABLETOPVERTICALMOVEMENT_TRANSFORM_NODE_NAME) );
-  vtkTransform* patientSupportScaledByTableTopVerticalMovementTransform = vtkTransform::SafeDownCast(
-    patientSupportScaledByTableTopVerticalMovementTransformNode->GetTransformToParent() );
+  vtkTransform* patientSupportScaledByTableTopVerticalMovementTransform = this->IECLogic->GetPatientSupportScaledByTableTopVerticalMovementTransform();
 
   patientSupportScaledByTableTopVerticalMovementTransform->Identity();
   patientSupportScaledByTableTopVerticalMovementTransform->Scale(1, 1, ((906 + tableTopDisplacement*1.01)) / 900);
   patientSupportScaledByTableTopVerticalMovementTransform->Modified();
 
-  vtkMRMLLinearTransformNode* tableTopEccentricRotationToPatientSupportTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(TABLETOPECCENTRICROTATION_TO_PATIENTSUPPORT_TRANSFORM_NODE_NAME) );
-  vtkTransform* tableTopEccentricRotationToPatientSupportTransform = vtkTransform::SafeDownCast(
-    tableTopEccentricRotationToPatientSupportTransformNode->GetTransformToParent() );
-
-  tableTopEccentricRotationToPatientSupportTransformNode->GetMatrixTransformToWorld(this->TableTopToWorldTransformMatrix);
+  this->UpdateTransformNodeFromIECLogic(vtkSlicerIECTransformLogic::PatientSupportScaledByTableTopVerticalMovement);
+  this->UpdateWorldTransformMatrices();
 }
 
 //-----------------------------------------------------------------------------
@@ -978,22 +1272,15 @@ void vtkSlicerRoomsEyeViewModuleLogic::UpdatePatientSupportPositiveVerticalTrans
   }
 
   //TODO: This method does not use any input
-  vtkMRMLLinearTransformNode* patientSupportPositiveVerticalTranslationTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(PATIENTSUPPORTPOSITIVEVERTICALTRANSLATION_TRANSFORM_NODE_NAME) );
-  vtkTransform* patientSupportPositiveVerticalTranslationTransform = vtkTransform::SafeDownCast(
-    patientSupportPositiveVerticalTranslationTransformNode->GetTransformToParent() );
+  vtkTransform* patientSupportPositiveVerticalTranslationTransform = this->IECLogic->GetPatientSupportPositiveVerticalTranslationTransform();
 
   patientSupportPositiveVerticalTranslationTransform->Identity();
   double translationArray[3] = { 0, 0, 1359.469848632281225 };
   patientSupportPositiveVerticalTranslationTransform->Translate(translationArray);
   patientSupportPositiveVerticalTranslationTransform->Modified();
 
-  vtkMRMLLinearTransformNode* tableTopEccentricRotationToPatientSupportTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(
-    this->GetMRMLScene()->GetFirstNodeByName(TABLETOPECCENTRICROTATION_TO_PATIENTSUPPORT_TRANSFORM_NODE_NAME) );
-  vtkTransform* tableTopEccentricRotationToPatientSupportTransform = vtkTransform::SafeDownCast(
-    tableTopEccentricRotationToPatientSupportTransformNode->GetTransformToParent() );
-
-  tableTopEccentricRotationToPatientSupportTransformNode->GetMatrixTransformToWorld(this->TableTopToWorldTransformMatrix);
+  this->UpdateTransformNodeFromIECLogic(vtkSlicerIECTransformLogic::PatientSupportPositiveVerticalTranslation);
+  this->UpdateWorldTransformMatrices();
 }
 
 //-----------------------------------------------------------------------------
@@ -1011,6 +1298,41 @@ void vtkSlicerRoomsEyeViewModuleLogic::UpdateVerticalDisplacementTransforms(vtkM
   this->UpdatePatientSupportPositiveVerticalTranslationTransform(parameterNode);
 }
 
+//-----------------------------------------------------------------------------
+void vtkSlicerRoomsEyeViewModuleLogic::UpdateTransformNodeFromIECLogic(vtkSlicerIECTransformLogic::CoordinateSystemIdentifier frame)
+{
+  const char* transformNodeName = NULL;
+  for (int nodeIndex=0; nodeIndex<NUMBER_OF_IEC_TRANSFORM_NODES; ++nodeIndex)
+  {
+    if (IEC_TRANSFORM_NODE_NAMES[nodeIndex].Frame == frame)
+    {
+      transformNodeName = IEC_TRANSFORM_NODE_NAMES[nodeIndex].NodeName;
+    }
+  }
+  vtkMRMLLinearTransformNode* transformNode = vtkMRMLLinearTransformNode::SafeDownCast(
+    transformNodeName ? this->GetMRMLScene()->GetFirstNodeByName(transformNodeName) : NULL );
+  if (!transformNode)
+  {
+    vtkErrorMacro("UpdateTransformNodeFromIECLogic: Unable to access transform node of coordinate frame " << frame);
+    return;
+  }
+
+  vtkTransform* transform = vtkTransform::SafeDownCast(transformNode->GetTransformToParent());
+  transform->SetMatrix(this->IECLogic->GetTransformToParent(frame)->GetMatrix());
+  transform->Modified();
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerRoomsEyeViewModuleLogic::UpdateWorldTransformMatrices()
+{
+  // The fixed reference coordinate system is the world coordinate system of the treatment room. Only the
+  // matrices on the paths with a modified transform are recomputed
+  this->IECLogic->GetMatrixBetween(vtkSlicerIECTransformLogic::CollimatorToGantry,
+    vtkSlicerIECTransformLogic::FixedReference, this->CollimatorToWorldTransformMatrix);
+  this->IECLogic->GetMatrixBetween(vtkSlicerIECTransformLogic::TableTopEccentricRotationToPatientSupport,
+    vtkSlicerIECTransformLogic::FixedReference, this->TableTopToWorldTransformMatrix);
+}
+
 //-----------------------------------------------------------------------------
 std::string vtkSlicerRoomsEyeViewModuleLogic::CheckForCollisions(vtkMRMLRoomsEyeViewNode* parameterNode)
 {
@@ -1022,40 +1344,33 @@ std::string vtkSlicerRoomsEyeViewModuleLogic::CheckForCollisions(vtkMRMLRoomsEye
 
   std::string statusString = "";
 
-  // If number of contacts between pieces of treatment room is greater than 0, the collision between which pieces
-  // will be set to the output string and returned by the function.
-  this->GantryTableTopCollisionDetection->Update();
-  if (this->GantryTableTopCollisionDetection->GetNumberOfContacts() > 0)
+  // If pieces of the treatment room collide, the collision between which pieces will be set to the output string
+  // and returned by the function. Only the existence of a collision is queried, so the traversal of the OBB trees
+  // stops at the first contact and no contact outputs are generated.
+  if (this->GantryTableTopCollisionDetection->IsColliding())
   {
     statusString = statusString + "Collision between gantry and table top\n";
   }
 
-  this->GantryPatientSupportCollisionDetection->Update();
-  if (this->GantryPatientSupportCollisionDetection->GetNumberOfContacts() > 0)
+  if (this->GantryPatientSupportCollisionDetection->IsColliding())
   {
     statusString = statusString + "Collision between gantry and patient support\n";
   }
 
-  this->CollimatorTableTopCollisionDetection->Update();
-  if (this->CollimatorTableTopCollisionDetection->GetNumberOfContacts() > 0)
+  if (this->CollimatorTableTopCollisionDetection->IsColliding())
   {
     statusString = statusString + "Collision between collimator and table top\n";
   }
 
   // Get patient body poly data
-  vtkSmartPointer<vtkPolyData> patientBodyPolyData = vtkSmartPointer<vtkPolyData>::New();
-  if (this->GetPatientBodyPolyData(parameterNode, patientBodyPolyData))
+  if (this->UpdatePatientBodyPolyData(parameterNode))
   {
-    this->GantryPatientCollisionDetection->SetInput(1, patientBodyPolyData);
-    this->GantryPatientCollisionDetection->Update();
-    if (this->GantryPatientCollisionDetection->GetNumberOfContacts() > 0)
+    if (this->GantryPatientCollisionDetection->IsColliding())
     {
       statusString = statusString + "Collision between gantry and patient\n";
     }
 
-    this->CollimatorPatientCollisionDetection->SetInput(1, patientBodyPolyData);
-    this->CollimatorPatientCollisionDetection->Update();
-    if (this->CollimatorPatientCollisionDetection->GetNumberOfContacts() > 0)
+    if (this->CollimatorPatientCollisionDetection->IsColliding())
     {
       statusString = statusString + "Collision between collimator and patient\n";
     }
@@ -1063,3 +1378,186 @@ std::string vtkSlicerRoomsEyeViewModuleLogic::CheckForCollisions(vtkMRMLRoomsEye
 
   return statusString;
 }
+
+//-----------------------------------------------------------------------------
+double vtkSlicerRoomsEyeViewModuleLogic::ComputeClearance(vtkMRMLRoomsEyeViewNode* parameterNode, int partPair,
+  double maximumDistance, double closestPointOnFirstPart[3], double closestPointOnSecondPart[3])
+{
+  if (!parameterNode)
+  {
+    vtkErrorMacro("ComputeClearance: Invalid parameter set node!");
+    return -1.0;
+  }
+
+  vtkCollisionDetectionFilter* collisionDetection = NULL;
+  bool patientBodyPair = false;
+  switch (partPair)
+  {
+    case GantryTableTopCollision:
+      collisionDetection = this->GantryTableTopCollisionDetection;
+      break;
+    case GantryPatientSupportCollision:
+      collisionDetection = this->GantryPatientSupportCollisionDetection;
+      break;
+    case CollimatorTableTopCollision:
+      collisionDetection = this->CollimatorTableTopCollisionDetection;
+      break;
+    case GantryPatientCollision:
+      collisionDetection = this->GantryPatientCollisionDetection;
+      patientBodyPair = true;
+      break;
+    case CollimatorPatientCollision:
+      collisionDetection = this->CollimatorPatientCollisionDetection;
+      patientBodyPair = true;
+      break;
+    default:
+      vtkErrorMacro("ComputeClearance: Invalid part pair " << partPair);
+      return -1.0;
+  }
+
+  if (patientBodyPair)
+  {
+    if (!this->UpdatePatientBodyPolyData(parameterNode))
+    {
+      vtkErrorMacro("ComputeClearance: Patient body is not available!");
+      return -1.0;
+    }
+  }
+  if (!collisionDetection->GetInput(0) || !collisionDetection->GetInput(1))
+  {
+    vtkErrorMacro("ComputeClearance: Treatment machine models are not set up, call InitializeIEC first");
+    return -1.0;
+  }
+
+  return collisionDetection->ComputeMinimumDistance(maximumDistance, closestPointOnFirstPart, closestPointOnSecondPart);
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkSlicerRoomsEyeViewModuleLogic::ComputeCollisionMap(vtkMRMLRoomsEyeViewNode* parameterNode,
+  double gantryAngleRange[3], double patientSupportAngleRange[3], double collimatorAngleRange[3],
+  vtkDoubleArray* tableTopDisplacements, vtkTable* collisionMap)
+{
+  if (!parameterNode || !gantryAngleRange || !patientSupportAngleRange || !collimatorAngleRange || !collisionMap)
+  {
+    std::string errorMessage("Invalid input arguments");
+    vtkErrorMacro("ComputeCollisionMap: " << errorMessage);
+    return errorMessage;
+  }
+  if (tableTopDisplacements && tableTopDisplacements->GetNumberOfTuples() > 0 && tableTopDisplacements->GetNumberOfComponents() != 3)
+  {
+    std::string errorMessage("Table top displacements need to have three components");
+    vtkErrorMacro("ComputeCollisionMap: " << errorMessage);
+    return errorMessage;
+  }
+
+  // Collision queries are only possible after the models are set up
+  vtkCollisionDetectionFilter* machineCollisionDetections[3] = { this->GantryTableTopCollisionDetection,
+    this->GantryPatientSupportCollisionDetection, this->CollimatorTableTopCollisionDetection };
+  for (int filterIndex=0; filterIndex<3; ++filterIndex)
+  {
+    if (!machineCollisionDetections[filterIndex]->GetInput(0) || !machineCollisionDetections[filterIndex]->GetInput(1))
+    {
+      std::string errorMessage("Treatment machine models are not set up, call InitializeIEC first");
+      vtkErrorMacro("ComputeCollisionMap: " << errorMessage);
+      return errorMessage;
+    }
+  }
+
+  CollisionMapContext context;
+  for (int index=0; index<GetNumberOfAngles(gantryAngleRange); ++index)
+  {
+    context.GantryAngles.push_back(gantryAngleRange[0] + index*gantryAngleRange[2]);
+  }
+  for (int index=0; index<GetNumberOfAngles(patientSupportAngleRange); ++index)
+  {
+    context.PatientSupportAngles.push_back(patientSupportAngleRange[0] + index*patientSupportAngleRange[2]);
+  }
+  for (int index=0; index<GetNumberOfAngles(collimatorAngleRange); ++index)
+  {
+    context.CollimatorAngles.push_back(collimatorAngleRange[0] + index*collimatorAngleRange[2]);
+  }
+  if (tableTopDisplacements && tableTopDisplacements->GetNumberOfTuples() > 0)
+  {
+    for (vtkIdType index=0; index<tableTopDisplacements->GetNumberOfTuples(); ++index)
+    {
+      double displacement[3] = {0.0, 0.0, 0.0};
+      tableTopDisplacements->GetTuple(index, displacement);
+      context.TableTopDisplacements.insert(context.TableTopDisplacements.end(), displacement, displacement+3);
+    }
+  }
+  else
+  {
+    context.TableTopDisplacements.push_back(parameterNode->GetLateralTableTopDisplacement());
+    context.TableTopDisplacements.push_back(parameterNode->GetLongitudinalTableTopDisplacement());
+    context.TableTopDisplacements.push_back(parameterNode->GetVerticalTableTopDisplacement());
+  }
+
+  context.GantryTableTopCollisionDetection = this->GantryTableTopCollisionDetection;
+  context.GantryPatientSupportCollisionDetection = this->GantryPatientSupportCollisionDetection;
+  context.CollimatorTableTopCollisionDetection = this->CollimatorTableTopCollisionDetection;
+  context.GantryPatientCollisionDetection = this->GantryPatientCollisionDetection;
+  context.CollimatorPatientCollisionDetection = this->CollimatorPatientCollisionDetection;
+
+  // Patient body is rigidly attached to the table top
+  context.CheckPatientBody = (this->UpdatePatientBodyPolyData(parameterNode) != NULL);
+
+  // Build the OBB trees before the threads start, the queries only read them
+  for (int filterIndex=0; filterIndex<3; ++filterIndex)
+  {
+    machineCollisionDetections[filterIndex]->UpdateOBBTrees();
+  }
+  if (context.CheckPatientBody)
+  {
+    this->GantryPatientCollisionDetection->UpdateOBBTrees();
+    this->CollimatorPatientCollisionDetection->UpdateOBBTrees();
+  }
+
+  vtkIdType numberOfPoses = (vtkIdType)context.GantryAngles.size() * context.PatientSupportAngles.size()
+    * context.CollimatorAngles.size() * (context.TableTopDisplacements.size() / 3);
+  vtkSmartPointer<vtkIntArray> collisionsArray = vtkSmartPointer<vtkIntArray>::New();
+  collisionsArray->SetName("Collisions");
+  collisionsArray->SetNumberOfTuples(numberOfPoses);
+  context.Collisions = collisionsArray->GetPointer(0);
+
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+  threader->SetSingleMethod(CollisionMapThreadFunction, &context);
+  threader->SingleMethodExecute();
+
+  // Assemble collision map table in the order of the poses (the collimator angle changes fastest)
+  const char* columnNames[6] = { "GantryAngle", "PatientSupportAngle", "CollimatorAngle",
+    "LateralTableTopDisplacement", "LongitudinalTableTopDisplacement", "VerticalTableTopDisplacement" };
+  vtkDoubleArray* poseArrays[6];
+  collisionMap->Initialize();
+  for (int column=0; column<6; ++column)
+  {
+    vtkSmartPointer<vtkDoubleArray> poseArray = vtkSmartPointer<vtkDoubleArray>::New();
+    poseArray->SetName(columnNames[column]);
+    poseArray->SetNumberOfTuples(numberOfPoses);
+    collisionMap->AddColumn(poseArray);
+    poseArrays[column] = poseArray;
+  }
+  collisionMap->AddColumn(collisionsArray);
+
+  vtkIdType poseIndex = 0;
+  for (size_t tableTopIndex=0; tableTopIndex<context.TableTopDisplacements.size()/3; ++tableTopIndex)
+  {
+    for (size_t gantryIndex=0; gantryIndex<context.GantryAngles.size(); ++gantryIndex)
+    {
+      for (size_t patientSupportIndex=0; patientSupportIndex<context.PatientSupportAngles.size(); ++patientSupportIndex)
+      {
+        for (size_t collimatorIndex=0; collimatorIndex<context.CollimatorAngles.size(); ++collimatorIndex, ++poseIndex)
+        {
+          poseArrays[0]->SetValue(poseIndex, context.GantryAngles[gantryIndex]);
+          poseArrays[1]->SetValue(poseIndex, context.PatientSupportAngles[patientSupportIndex]);
+          poseArrays[2]->SetValue(poseIndex, context.CollimatorAngles[collimatorIndex]);
+          for (int axis=0; axis<3; ++axis)
+          {
+            poseArrays[3+axis]->SetValue(poseIndex, context.TableTopDisplacements[3*tableTopIndex+axis]);
+          }
+        }
+      }
+    }
+  }
+
+  return "";
+}
@@ -33,7 +33,14 @@ Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
 
 #include "vtkCollisionDetectionFilter.h"
 
+// Beams includes
+#include "vtkSlicerIECTransformLogic.h"
+
+class vtkDoubleArray;
 class vtkMRMLRoomsEyeViewNode;
+class vtkOBBTree;
+class vtkTable;
+class vtkTransform;
 
 /// \ingroup SlicerRt_QtModules_RoomsEyeView
 class VTK_SLICER_ROOMSEYEVIEW_LOGIC_EXPORT vtkSlicerRoomsEyeViewModuleLogic :
@@ -44,6 +51,17 @@ public:
   vtkTypeMacro(vtkSlicerRoomsEyeViewModuleLogic, vtkSlicerModuleLogic);
   void PrintSelf(ostream& os, vtkIndent indent);
 
+public:
+  /// Flags of the colliding treatment room part pairs in the collision map
+  enum CollisionFlag
+  {
+    GantryTableTopCollision = 1,
+    GantryPatientSupportCollision = 2,
+    CollimatorTableTopCollision = 4,
+    GantryPatientCollision = 8,
+    CollimatorPatientCollision = 16
+  };
+
 public:
   /// Load pre-defined components of the treatment machine into the scene
   void LoadLinacModels();
@@ -95,11 +113,64 @@ public:
   /// \return string indicating whether collision occurred
   std::string CheckForCollisions(vtkMRMLRoomsEyeViewNode* parameterNode);
 
+  /// Check for collisions over a grid of gantry, patient support and collimator angles and table top positions.
+  /// The part positions of each pose are computed from the same IEC transform chain as the Update...Transform methods,
+  /// but without modifying the transform nodes, so the poses are evaluated in parallel with the collision queries
+  /// of \sa CheckForCollisions. The patient body is included if it is selected in the parameter node.
+  /// \param gantryAngleRange First angle, last angle and step of the gantry rotation (degrees)
+  /// \param patientSupportAngleRange First angle, last angle and step of the patient support rotation (degrees)
+  /// \param collimatorAngleRange First angle, last angle and step of the collimator rotation (degrees)
+  /// \param tableTopDisplacements Lateral, longitudinal and vertical table top displacements to evaluate (three
+  ///   components per tuple). If NULL or empty, then only the table top displacement in the parameter node is used
+  /// \param collisionMap Output table with one row per pose: the angles, the table top displacement and the bitwise
+  ///   or of the flags of the colliding part pairs (\sa CollisionFlag) in column "Collisions". Zero means collision-free
+  /// \return Error message, empty if successful
+  std::string ComputeCollisionMap(vtkMRMLRoomsEyeViewNode* parameterNode,
+    double gantryAngleRange[3], double patientSupportAngleRange[3], double collimatorAngleRange[3],
+    vtkDoubleArray* tableTopDisplacements, vtkTable* collisionMap);
+
+  /// Compute the clearance (minimum distance) between two pieces of the treatment room at the current pose
+  /// using the OBB trees of the collision detection
+  /// \param partPair Pair of pieces given by its collision flag (\sa CollisionFlag)
+  /// \param maximumDistance Clearances above this distance are not searched for (mm). No limit if not positive
+  /// \param closestPointOnFirstPart Closest point on the first piece of the pair in world coordinates (may be NULL)
+  /// \param closestPointOnSecondPart Closest point on the second piece of the pair in world coordinates (may be NULL)
+  /// \return Clearance (mm), zero if the pieces collide, VTK_DOUBLE_MAX if farther than maximumDistance, negative on error
+  double ComputeClearance(vtkMRMLRoomsEyeViewNode* parameterNode, int partPair, double maximumDistance,
+    double closestPointOnFirstPart[3], double closestPointOnSecondPart[3]);
+
+  /// Get OBB trees of the treatment room parts used by the collision detection
+  vtkGetObjectMacro(GantryOBBTree, vtkOBBTree);
+  vtkGetObjectMacro(CollimatorOBBTree, vtkOBBTree);
+  vtkGetObjectMacro(TableTopOBBTree, vtkOBBTree);
+  vtkGetObjectMacro(PatientSupportOBBTree, vtkOBBTree);
+  vtkGetObjectMacro(PatientBodyOBBTree, vtkOBBTree);
+
 protected:
   /// Get patient body closed surface poly data from segmentation node and segment selection in the parameter node
   bool GetPatientBodyPolyData(vtkMRMLRoomsEyeViewNode* parameterNode, vtkPolyData* patientBodyPolyData);
 
+  /// Get the cached patient body poly data and set it as second input of the patient collision detection filters.
+  /// The poly data is only regenerated if the selected segmentation node or segment changed, or the segmentation
+  /// or its parent transforms were modified since the last call, so that the patient body OBB tree is kept
+  /// between collision queries.
+  /// \return Patient body poly data, NULL if no patient body segment is available
+  vtkPolyData* UpdatePatientBodyPolyData(vtkMRMLRoomsEyeViewNode* parameterNode);
+
+  /// Get the modified time of the patient body segment, including the segmentation and its parent transforms
+  vtkMTimeType GetPatientBodyMTime(vtkMRMLRoomsEyeViewNode* parameterNode);
+
+  /// Copy the transform of a coordinate frame to its parent from the IEC transform logic to its transform node
+  void UpdateTransformNodeFromIECLogic(vtkSlicerIECTransformLogic::CoordinateSystemIdentifier frame);
+
+  /// Get the collimator and table top to world matrices from the cached IEC transform hierarchy
+  void UpdateWorldTransformMatrices();
+
 protected:
+  /// IEC transform hierarchy the Update...Transform methods set the transforms in. The transform nodes of the
+  /// scene are updated from it, and the matrices to world are queried from its cache
+  vtkSlicerIECTransformLogic* IECLogic;
+
   vtkMatrix4x4* CollimatorToWorldTransformMatrix;
   vtkMatrix4x4* TableTopToWorldTransformMatrix;
 
@@ -110,6 +181,23 @@ protected:
   vtkCollisionDetectionFilter* CollimatorPatientCollisionDetection;
   vtkCollisionDetectionFilter* CollimatorTableTopCollisionDetection;
 
+  /// OBB trees of the treatment machine models, shared by the collision detection filters.
+  /// The models are rigid, so the trees are built only once and only the transforms change.
+  vtkOBBTree* GantryOBBTree;
+  vtkOBBTree* CollimatorOBBTree;
+  vtkOBBTree* TableTopOBBTree;
+  vtkOBBTree* PatientSupportOBBTree;
+  /// OBB tree of the patient body, shared by the gantry and collimator collision detection filters
+  vtkOBBTree* PatientBodyOBBTree;
+
+  /// Patient body poly data cached for the collision detection. The object is kept so that the OBB tree
+  /// built on it is only rebuilt when the poly data is regenerated
+  vtkPolyData* PatientBodyPolyData;
+  /// Segmentation node ID, segment ID and modified time the cached patient body poly data was generated from
+  std::string PatientBodySegmentationNodeID;
+  std::string PatientBodySegmentID;
+  vtkMTimeType PatientBodyMTime;
+
 protected:
   vtkSlicerRoomsEyeViewModuleLogic();
   virtual ~vtkSlicerRoomsEyeViewModuleLogic();
@@ -0,0 +1,422 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// SlicerRtCommon includes
+#include "vtkCollisionDetectionFilter.h"
+
+// VTK includes
+#include <vtkCubeSource.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTransform.h>
+#include <vtkTransformPolyDataFilter.h>
+#include <vtkTriangleFilter.h>
+
+// STD includes
+#include <cmath>
+
+namespace
+{
+  static const double TOLERANCE = 1.0e-6;
+
+  //----------------------------------------------------------------------------
+  /// Unit cube centered at the origin, triangulated as the filter only processes triangles
+  vtkSmartPointer<vtkPolyData> CreateUnitCube()
+  {
+    vtkNew<vtkCubeSource> cubeSource;
+    cubeSource->SetXLength(1.0);
+    cubeSource->SetYLength(1.0);
+    cubeSource->SetZLength(1.0);
+    vtkNew<vtkTriangleFilter> triangleFilter;
+    triangleFilter->SetInputConnection(cubeSource->GetOutputPort());
+    triangleFilter->Update();
+    vtkSmartPointer<vtkPolyData> cube = vtkSmartPointer<vtkPolyData>::New();
+    cube->DeepCopy(triangleFilter->GetOutput());
+    return cube;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Thin rod of length 4 centered at the origin along the (1,-1,0) diagonal, so that rotating it
+  /// by 45 degrees around z aligns it with the x axis
+  vtkSmartPointer<vtkPolyData> CreateDiagonalRod()
+  {
+    vtkNew<vtkCubeSource> cubeSource;
+    cubeSource->SetXLength(4.0);
+    cubeSource->SetYLength(0.1);
+    cubeSource->SetZLength(0.1);
+    vtkNew<vtkTriangleFilter> triangleFilter;
+    triangleFilter->SetInputConnection(cubeSource->GetOutputPort());
+    vtkNew<vtkTransform> rotation;
+    rotation->RotateZ(-45.0);
+    vtkNew<vtkTransformPolyDataFilter> transformFilter;
+    transformFilter->SetInputConnection(triangleFilter->GetOutputPort());
+    transformFilter->SetTransform(rotation.GetPointer());
+    transformFilter->Update();
+    vtkSmartPointer<vtkPolyData> rod = vtkSmartPointer<vtkPolyData>::New();
+    rod->DeepCopy(transformFilter->GetOutput());
+    return rod;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Compute the minimum distance with the transforms of the filter and with the equivalent matrices,
+  /// and compare it to the expected distance. The closest points need to be in world coordinates and
+  /// as far apart as the distance. Their coordinates are only compared along the given number of axes,
+  /// as the closest points are not unique along the others.
+  bool CheckMinimumDistance(vtkCollisionDetectionFilter* collisionDetection, const char* poseName,
+    double expectedDistance, int numberOfUniqueAxes = 0,
+    const double expectedClosestPoint0[3] = NULL, const double expectedClosestPoint1[3] = NULL)
+  {
+    for (int useMatrices=0; useMatrices<2; ++useMatrices)
+    {
+      double closestPoint0[3] = {0.0, 0.0, 0.0};
+      double closestPoint1[3] = {0.0, 0.0, 0.0};
+      double distance = (useMatrices
+        ? collisionDetection->ComputeMinimumDistance(collisionDetection->GetTransform(0)->GetMatrix(),
+          collisionDetection->GetTransform(1)->GetMatrix(), 0.0, closestPoint0, closestPoint1)
+        : collisionDetection->ComputeMinimumDistance(0.0, closestPoint0, closestPoint1) );
+
+      if (fabs(distance - expectedDistance) > TOLERANCE)
+      {
+        std::cerr << __LINE__ << ": Distance mismatch for " << poseName << " (matrices: " << useMatrices << "): "
+          << distance << " (expected " << expectedDistance << ")" << std::endl;
+        return false;
+      }
+      if (fabs(sqrt(vtkMath::Distance2BetweenPoints(closestPoint0, closestPoint1)) - expectedDistance) > TOLERANCE)
+      {
+        std::cerr << __LINE__ << ": Closest points of " << poseName << " (matrices: " << useMatrices
+          << ") are not at the minimum distance" << std::endl;
+        return false;
+      }
+      for (int axis=0; axis<numberOfUniqueAxes; ++axis)
+      {
+        if ( fabs(closestPoint0[axis] - expectedClosestPoint0[axis]) > TOLERANCE
+          || fabs(closestPoint1[axis] - expectedClosestPoint1[axis]) > TOLERANCE )
+        {
+          std::cerr << __LINE__ << ": Closest point mismatch for " << poseName << " (matrices: " << useMatrices
+            << ") along axis " << axis << ": " << closestPoint0[axis] << ", " << closestPoint1[axis]
+            << " (expected " << expectedClosestPoint0[axis] << ", " << expectedClosestPoint1[axis] << ")" << std::endl;
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Check that the full filter execution (contact count), the early-out query with the transforms of the filter
+  /// and the early-out query with the equivalent matrices all give the expected collision state
+  bool CheckCollision(vtkCollisionDetectionFilter* collisionDetection, const char* poseName, bool expectedColliding)
+  {
+    collisionDetection->Update();
+    bool contactsFound = (collisionDetection->GetNumberOfContacts() > 0);
+    bool colliding = (collisionDetection->IsColliding() != 0);
+    bool collidingWithMatrices = (collisionDetection->IsColliding(
+      collisionDetection->GetTransform(0)->GetMatrix(), collisionDetection->GetTransform(1)->GetMatrix()) != 0);
+    if (contactsFound != expectedColliding || colliding != expectedColliding || collidingWithMatrices != expectedColliding)
+    {
+      std::cerr << __LINE__ << ": Collision mismatch for " << poseName << " (proxies: " << collisionDetection->GetUseProxies()
+        << "): contacts " << collisionDetection->GetNumberOfContacts() << ", IsColliding " << colliding
+        << ", IsColliding with matrices " << collidingWithMatrices << " (expected " << expectedColliding << ")" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Minimum distance of cubes in poses with known distance and closest points
+  bool TestMinimumDistance(vtkCollisionDetectionFilter* collisionDetection, vtkTransform* transform0, vtkTransform* transform1)
+  {
+    // Gap of 0.5 between the facing sides, the closest points are only unique along x
+    transform0->Identity();
+    transform1->Identity();
+    transform1->Translate(1.5, 0.0, 0.0);
+    double gapPoint0[3] = {0.5, 0.0, 0.0};
+    double gapPoint1[3] = {1.0, 0.0, 0.0};
+    if (!CheckMinimumDistance(collisionDetection, "cubes with a gap", 0.5, 1, gapPoint0, gapPoint1))
+    {
+      return false;
+    }
+
+    // Distances above the maximum distance are not searched for
+    if (collisionDetection->ComputeMinimumDistance(0.25, NULL, NULL) != VTK_DOUBLE_MAX)
+    {
+      std::cerr << __LINE__ << ": Distance above the maximum distance is not VTK_DOUBLE_MAX (proxies: "
+        << collisionDetection->GetUseProxies() << ")" << std::endl;
+      return false;
+    }
+    double distance = collisionDetection->ComputeMinimumDistance(1.0, NULL, NULL);
+    if (fabs(distance - 0.5) > TOLERANCE)
+    {
+      std::cerr << __LINE__ << ": Distance below the maximum distance is " << distance << " (expected 0.5, proxies: "
+        << collisionDetection->GetUseProxies() << ")" << std::endl;
+      return false;
+    }
+
+    // Touching sides
+    transform1->Identity();
+    transform1->Translate(1.0, 0.0, 0.0);
+    if (!CheckMinimumDistance(collisionDetection, "touching cubes", 0.0))
+    {
+      return false;
+    }
+
+    // Intersecting cubes have zero distance
+    transform1->Identity();
+    transform1->Translate(0.5, 0.25, 0.0);
+    if (!CheckMinimumDistance(collisionDetection, "intersecting cubes", 0.0))
+    {
+      return false;
+    }
+
+    // Cube rotated by 45 degrees around z, its edge facing a side of the other cube
+    transform1->Identity();
+    transform1->Translate(2.0, 0.0, 0.0);
+    transform1->RotateZ(45.0);
+    double rotatedPoint0[3] = {0.5, 0.0, 0.0};
+    double rotatedPoint1[3] = {2.0 - sqrt(0.5), 0.0, 0.0};
+    if (!CheckMinimumDistance(collisionDetection, "rotated cube", 1.5 - sqrt(0.5), 2, rotatedPoint0, rotatedPoint1))
+    {
+      return false;
+    }
+
+    // Both cubes rotated so that two crossing edges face each other. Model 0 is not at the origin of
+    // the world, so the closest points need to be transformed back to world coordinates
+    transform0->Identity();
+    transform0->Translate(-1.0, 0.0, 0.0);
+    transform0->RotateZ(45.0);
+    transform1->Identity();
+    transform1->Translate(1.0, 0.0, 0.0);
+    transform1->RotateY(45.0);
+    double crossingEdgesPoint0[3] = {-1.0 + sqrt(0.5), 0.0, 0.0};
+    double crossingEdgesPoint1[3] = {1.0 - sqrt(0.5), 0.0, 0.0};
+    if (!CheckMinimumDistance(collisionDetection, "crossing edges", 2.0 - 2.0*sqrt(0.5), 3, crossingEdgesPoint0, crossingEdgesPoint1))
+    {
+      return false;
+    }
+
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Collision state of cubes in colliding and separated poses
+  bool TestCollisions(vtkCollisionDetectionFilter* collisionDetection, vtkTransform* transform0, vtkTransform* transform1)
+  {
+    transform0->Identity();
+
+    transform1->Identity();
+    transform1->Translate(1.5, 0.0, 0.0);
+    if (!CheckCollision(collisionDetection, "cubes with a gap", false))
+    {
+      return false;
+    }
+
+    // Gap smaller than the proxy padding: the proxies overlap, but the models do not
+    transform1->Identity();
+    transform1->Translate(1.005, 0.0, 0.0);
+    if (!CheckCollision(collisionDetection, "cubes with a narrow gap", false))
+    {
+      return false;
+    }
+
+    transform1->Identity();
+    transform1->Translate(0.5, 0.25, 0.0);
+    if (!CheckCollision(collisionDetection, "intersecting cubes", true))
+    {
+      return false;
+    }
+
+    // Rotated cube with its edge close to, then penetrating the side of the other cube
+    transform1->Identity();
+    transform1->Translate(1.25, 0.0, 0.0);
+    transform1->RotateZ(45.0);
+    if (!CheckCollision(collisionDetection, "rotated cube with a gap", false))
+    {
+      return false;
+    }
+    transform1->Identity();
+    transform1->Translate(1.0, 0.0, 0.0);
+    transform1->RotateZ(45.0);
+    if (!CheckCollision(collisionDetection, "penetrating rotated cube", true))
+    {
+      return false;
+    }
+
+    // Both cubes moved and rotated, model 0 is not at the origin of the world
+    transform0->Identity();
+    transform0->Translate(-1.0, 0.0, 0.0);
+    transform0->RotateZ(45.0);
+    transform1->Identity();
+    transform1->Translate(1.0, 0.0, 0.0);
+    transform1->RotateY(45.0);
+    if (!CheckCollision(collisionDetection, "crossing edges with a gap", false))
+    {
+      return false;
+    }
+    transform1->Identity();
+    transform1->Translate(0.2, 0.0, 0.0);
+    transform1->RotateY(45.0);
+    if (!CheckCollision(collisionDetection, "penetrating crossing edges", true))
+    {
+      return false;
+    }
+
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Proxies of a model placed by a rotation followed by a non-uniform scaling. The rod is scaled along its
+  /// axis by 2, which the column norms of the matrix underestimate (sqrt(2.5)), so the bounding spheres
+  /// would be reported separated although the rod reaches into the cube
+  bool TestScaledProxies(vtkPolyData* cube, vtkPolyData* rod)
+  {
+    vtkNew<vtkTransform> transform0;
+    vtkNew<vtkTransform> transform1;
+    vtkNew<vtkCollisionDetectionFilter> collisionDetection;
+    collisionDetection->SetInput(0, cube);
+    collisionDetection->SetInput(1, rod);
+    collisionDetection->SetTransform(0, transform0.GetPointer());
+    collisionDetection->SetTransform(1, transform1.GetPointer());
+    collisionDetection->SetCollisionModeToAllContacts();
+
+    for (int useProxies=0; useProxies<2; ++useProxies)
+    {
+      collisionDetection->SetUseProxies(useProxies);
+
+      // Rod spanning x from 0.3 to 8.3
+      transform1->Identity();
+      transform1->Translate(4.3, 0.0, 0.0);
+      transform1->Scale(2.0, 1.0, 1.0);
+      transform1->RotateZ(45.0);
+      if (!CheckCollision(collisionDetection.GetPointer(), "scaled rod reaching into the cube", true))
+      {
+        return false;
+      }
+
+      // Rod spanning x from 0.7 to 8.7
+      transform1->Identity();
+      transform1->Translate(4.7, 0.0, 0.0);
+      transform1->Scale(2.0, 1.0, 1.0);
+      transform1->RotateZ(45.0);
+      if (!CheckCollision(collisionDetection.GetPointer(), "scaled rod with a gap", false))
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  /// The proxies only skip tree traversals, so in random poses combining translations, rotations and
+  /// non-uniform scaling the filter needs to give the same collision state with and without them
+  bool TestRandomPoses(vtkPolyData* model0, vtkPolyData* model1)
+  {
+    vtkNew<vtkTransform> transform0;
+    vtkNew<vtkTransform> transform1;
+    vtkNew<vtkCollisionDetectionFilter> treeCollisionDetection;
+    vtkNew<vtkCollisionDetectionFilter> proxyCollisionDetection;
+    vtkCollisionDetectionFilter* collisionDetections[2] = { treeCollisionDetection.GetPointer(), proxyCollisionDetection.GetPointer() };
+    for (int useProxies=0; useProxies<2; ++useProxies)
+    {
+      collisionDetections[useProxies]->SetInput(0, model0);
+      collisionDetections[useProxies]->SetInput(1, model1);
+      collisionDetections[useProxies]->SetTransform(0, transform0.GetPointer());
+      collisionDetections[useProxies]->SetTransform(1, transform1.GetPointer());
+      collisionDetections[useProxies]->SetUseProxies(useProxies);
+    }
+
+    vtkMath::RandomSeed(12345);
+    int numberOfCollidingPoses = 0;
+    const int numberOfPoses = 500;
+    for (int poseIndex=0; poseIndex<numberOfPoses; ++poseIndex)
+    {
+      transform0->Identity();
+      transform0->RotateWXYZ(vtkMath::Random(0.0, 360.0), vtkMath::Random(-1.0, 1.0), vtkMath::Random(-1.0, 1.0), 1.0);
+      transform0->Scale(vtkMath::Random(0.5, 2.0), vtkMath::Random(0.5, 2.0), vtkMath::Random(0.5, 2.0));
+      transform1->Identity();
+      transform1->Translate(vtkMath::Random(-4.0, 4.0), vtkMath::Random(-4.0, 4.0), vtkMath::Random(-2.0, 2.0));
+      transform1->Scale(vtkMath::Random(0.5, 2.0), vtkMath::Random(0.5, 2.0), vtkMath::Random(0.5, 2.0));
+      transform1->RotateWXYZ(vtkMath::Random(0.0, 360.0), 1.0, vtkMath::Random(-1.0, 1.0), vtkMath::Random(-1.0, 1.0));
+      transform0->Modified();
+      transform1->Modified();
+
+      int treeColliding = treeCollisionDetection->IsColliding();
+      int proxyColliding = proxyCollisionDetection->IsColliding();
+      if (treeColliding != proxyColliding)
+      {
+        std::cerr << __LINE__ << ": Collision state with proxies differs from the OBB tree result in random pose "
+          << poseIndex << ": " << proxyColliding << " (expected " << treeColliding << ")" << std::endl;
+        return false;
+      }
+      numberOfCollidingPoses += treeColliding;
+    }
+
+    // Both states need to be covered for the comparison to be meaningful
+    if (numberOfCollidingPoses == 0 || numberOfCollidingPoses == numberOfPoses)
+    {
+      std::cerr << __LINE__ << ": Random poses are all colliding or all separated (" << numberOfCollidingPoses << " colliding)" << std::endl;
+      return false;
+    }
+
+    return true;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkCollisionDetectionFilterTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkSmartPointer<vtkPolyData> cube0 = CreateUnitCube();
+  vtkSmartPointer<vtkPolyData> cube1 = CreateUnitCube();
+  vtkNew<vtkTransform> transform0;
+  vtkNew<vtkTransform> transform1;
+
+  vtkNew<vtkCollisionDetectionFilter> collisionDetection;
+  collisionDetection->SetInput(0, cube0);
+  collisionDetection->SetInput(1, cube1);
+  collisionDetection->SetTransform(0, transform0.GetPointer());
+  collisionDetection->SetTransform(1, transform1.GetPointer());
+  collisionDetection->SetCollisionModeToAllContacts();
+
+  // The convex proxies only skip tree traversals, the results need to be the same with and without them
+  for (int useProxies=0; useProxies<2; ++useProxies)
+  {
+    collisionDetection->SetUseProxies(useProxies);
+    if (!TestMinimumDistance(collisionDetection.GetPointer(), transform0.GetPointer(), transform1.GetPointer()))
+    {
+      return EXIT_FAILURE;
+    }
+    if (!TestCollisions(collisionDetection.GetPointer(), transform0.GetPointer(), transform1.GetPointer()))
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  vtkSmartPointer<vtkPolyData> rod = CreateDiagonalRod();
+  if (!TestScaledProxies(cube0, rod))
+  {
+    return EXIT_FAILURE;
+  }
+  if (!TestRandomPoses(cube0, rod))
+  {
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Collision detection filter test passed" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,234 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// RoomsEyeView includes
+#include "vtkSlicerRoomsEyeViewModuleLogic.h"
+#include "vtkMRMLRoomsEyeViewNode.h"
+
+// Segmentations includes
+#include <vtkMRMLSegmentationNode.h>
+#include <vtkSegmentationConverter.h>
+#include <vtkSegmentation.h>
+#include <vtkSegment.h>
+
+// MRML includes
+#include <vtkMRMLCoreTestingMacros.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkCubeSource.h>
+#include <vtkDoubleArray.h>
+#include <vtkIntArray.h>
+#include <vtkNew.h>
+#include <vtkOBBTree.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTable.h>
+#include <vtkTriangleFilter.h>
+#include <vtkVariant.h>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /// Get the collision flags from the status string of CheckForCollisions
+  int GetCollisionFlags(const std::string& statusString)
+  {
+    int collisions = 0;
+    if (statusString.find("Collision between gantry and table top") != std::string::npos)
+    {
+      collisions |= vtkSlicerRoomsEyeViewModuleLogic::GantryTableTopCollision;
+    }
+    if (statusString.find("Collision between gantry and patient support") != std::string::npos)
+    {
+      collisions |= vtkSlicerRoomsEyeViewModuleLogic::GantryPatientSupportCollision;
+    }
+    if (statusString.find("Collision between collimator and table top") != std::string::npos)
+    {
+      collisions |= vtkSlicerRoomsEyeViewModuleLogic::CollimatorTableTopCollision;
+    }
+    if (statusString.find("Collision between gantry and patient\n") != std::string::npos)
+    {
+      collisions |= vtkSlicerRoomsEyeViewModuleLogic::GantryPatientCollision;
+    }
+    if (statusString.find("Collision between collimator and patient\n") != std::string::npos)
+    {
+      collisions |= vtkSlicerRoomsEyeViewModuleLogic::CollimatorPatientCollision;
+    }
+    return collisions;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Add a box shaped patient body segment in table top coordinates
+  void AddPatientBodySegment(vtkMRMLSegmentationNode* segmentationNode, const char* segmentId)
+  {
+    vtkNew<vtkCubeSource> cubeSource;
+    cubeSource->SetXLength(400.0);
+    cubeSource->SetYLength(1800.0);
+    cubeSource->SetZLength(250.0);
+    vtkNew<vtkTriangleFilter> triangleFilter;
+    triangleFilter->SetInputConnection(cubeSource->GetOutputPort());
+    triangleFilter->Update();
+    vtkSmartPointer<vtkPolyData> bodyPolyData = vtkSmartPointer<vtkPolyData>::New();
+    bodyPolyData->DeepCopy(triangleFilter->GetOutput());
+
+    segmentationNode->GetSegmentation()->SetMasterRepresentationName(
+      vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName() );
+    vtkSmartPointer<vtkSegment> segment = vtkSmartPointer<vtkSegment>::New();
+    segment->SetName(segmentId);
+    segment->AddRepresentation(vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName(), bodyPolyData);
+    segmentationNode->GetSegmentation()->AddSegment(segment, segmentId);
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkSlicerRoomsEyeViewModuleLogicTest1(int argc, char* argv[])
+{
+  int argIndex = 1;
+
+  // ModelsDirectory
+  const char* modelsDirectory = NULL;
+  if (argc > argIndex+1)
+  {
+    if (STRCASECMP(argv[argIndex], "-ModelsDirectory") == 0)
+    {
+      modelsDirectory = argv[argIndex+1];
+      std::cout << "Treatment machine models directory: " << modelsDirectory << std::endl;
+      argIndex += 2;
+    }
+    else
+    {
+      modelsDirectory = "";
+    }
+  }
+  else
+  {
+    std::cerr << "Invalid arguments!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Set up the treatment room
+  vtkSmartPointer<vtkMRMLScene> mrmlScene = vtkSmartPointer<vtkMRMLScene>::New();
+  vtkSmartPointer<vtkSlicerRoomsEyeViewModuleLogic> roomsEyeViewLogic = vtkSmartPointer<vtkSlicerRoomsEyeViewModuleLogic>::New();
+  roomsEyeViewLogic->SetModuleShareDirectory(modelsDirectory);
+  roomsEyeViewLogic->SetMRMLScene(mrmlScene);
+  roomsEyeViewLogic->LoadLinacModels();
+  roomsEyeViewLogic->InitializeIEC();
+
+  vtkSmartPointer<vtkMRMLSegmentationNode> patientBodySegmentationNode = vtkSmartPointer<vtkMRMLSegmentationNode>::New();
+  mrmlScene->AddNode(patientBodySegmentationNode);
+  AddPatientBodySegment(patientBodySegmentationNode, "Body");
+
+  vtkSmartPointer<vtkMRMLRoomsEyeViewNode> parameterNode = vtkSmartPointer<vtkMRMLRoomsEyeViewNode>::New();
+  mrmlScene->AddNode(parameterNode);
+  parameterNode->SetAndObservePatientBodySegmentationNode(patientBodySegmentationNode);
+  parameterNode->SetPatientBodySegmentID("Body");
+
+  // Compute the collision map on a small grid of angles and two table top positions
+  double gantryAngleRange[3] = {0.0, 270.0, 90.0};
+  double patientSupportAngleRange[3] = {0.0, 90.0, 90.0};
+  double collimatorAngleRange[3] = {0.0, 90.0, 45.0};
+  vtkSmartPointer<vtkDoubleArray> tableTopDisplacements = vtkSmartPointer<vtkDoubleArray>::New();
+  tableTopDisplacements->SetNumberOfComponents(3);
+  tableTopDisplacements->InsertNextTuple3(0.0, 0.0, 0.0);
+  tableTopDisplacements->InsertNextTuple3(0.0, 0.0, -300.0);
+  vtkSmartPointer<vtkTable> collisionMap = vtkSmartPointer<vtkTable>::New();
+  std::string errorMessage = roomsEyeViewLogic->ComputeCollisionMap(parameterNode,
+    gantryAngleRange, patientSupportAngleRange, collimatorAngleRange, tableTopDisplacements, collisionMap);
+  if (!errorMessage.empty())
+  {
+    std::cerr << __LINE__ << ": Failed to compute collision map: " << errorMessage << std::endl;
+    return EXIT_FAILURE;
+  }
+  const vtkIdType expectedNumberOfPoses = 4 * 2 * 3 * 2;
+  if (collisionMap->GetNumberOfRows() != expectedNumberOfPoses)
+  {
+    std::cerr << __LINE__ << ": Collision map has " << collisionMap->GetNumberOfRows()
+      << " poses instead of " << expectedNumberOfPoses << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Each pose of the map has to give the same collisions as setting up the pose through the
+  // transform nodes and checking it separately
+  vtkIntArray* collisionsArray = vtkIntArray::SafeDownCast(collisionMap->GetColumnByName("Collisions"));
+  if (!collisionsArray)
+  {
+    std::cerr << __LINE__ << ": Collision map has no collisions column" << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (vtkIdType poseIndex=0; poseIndex<collisionMap->GetNumberOfRows(); ++poseIndex)
+  {
+    parameterNode->SetGantryRotationAngle(collisionMap->GetValueByName(poseIndex, "GantryAngle").ToDouble());
+    parameterNode->SetPatientSupportRotationAngle(collisionMap->GetValueByName(poseIndex, "PatientSupportAngle").ToDouble());
+    parameterNode->SetCollimatorRotationAngle(collisionMap->GetValueByName(poseIndex, "CollimatorAngle").ToDouble());
+    parameterNode->SetLateralTableTopDisplacement(collisionMap->GetValueByName(poseIndex, "LateralTableTopDisplacement").ToDouble());
+    parameterNode->SetLongitudinalTableTopDisplacement(collisionMap->GetValueByName(poseIndex, "LongitudinalTableTopDisplacement").ToDouble());
+    parameterNode->SetVerticalTableTopDisplacement(collisionMap->GetValueByName(poseIndex, "VerticalTableTopDisplacement").ToDouble());
+    roomsEyeViewLogic->UpdateGantryToFixedReferenceTransform(parameterNode);
+    roomsEyeViewLogic->UpdateCollimatorToGantryTransform(parameterNode);
+    roomsEyeViewLogic->UpdatePatientSupportToFixedReferenceTransform(parameterNode);
+    roomsEyeViewLogic->UpdateTableTopEccentricRotationToPatientSupportTransform(parameterNode);
+
+    int expectedCollisions = GetCollisionFlags(roomsEyeViewLogic->CheckForCollisions(parameterNode));
+    if (collisionsArray->GetValue(poseIndex) != expectedCollisions)
+    {
+      std::cerr << __LINE__ << ": Collision map mismatch at gantry angle " << parameterNode->GetGantryRotationAngle()
+        << ", patient support angle " << parameterNode->GetPatientSupportRotationAngle()
+        << ", collimator angle " << parameterNode->GetCollimatorRotationAngle()
+        << ", vertical table top displacement " << parameterNode->GetVerticalTableTopDisplacement()
+        << ": " << collisionsArray->GetValue(poseIndex) << " (expected " << expectedCollisions << ")" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::cout << "Collision map test passed" << std::endl;
+
+  // The OBB trees are only rebuilt when their models change. An OBB tree is rebuilt if it or its data set was
+  // modified after the last build, so if neither modified time changes between two collision queries with
+  // different poses, then the trees were built only once
+  vtkOBBTree* obbTrees[5] = { roomsEyeViewLogic->GetGantryOBBTree(), roomsEyeViewLogic->GetCollimatorOBBTree(),
+    roomsEyeViewLogic->GetTableTopOBBTree(), roomsEyeViewLogic->GetPatientSupportOBBTree(), roomsEyeViewLogic->GetPatientBodyOBBTree() };
+  const char* obbTreeNames[5] = { "gantry", "collimator", "table top", "patient support", "patient body" };
+  parameterNode->SetGantryRotationAngle(0.0);
+  roomsEyeViewLogic->UpdateGantryToFixedReferenceTransform(parameterNode);
+  roomsEyeViewLogic->CheckForCollisions(parameterNode);
+  vtkMTimeType obbTreeMTimes[5] = {0, 0, 0, 0, 0};
+  vtkMTimeType dataSetMTimes[5] = {0, 0, 0, 0, 0};
+  for (int treeIndex=0; treeIndex<5; ++treeIndex)
+  {
+    if (!obbTrees[treeIndex] || !obbTrees[treeIndex]->GetDataSet())
+    {
+      std::cerr << __LINE__ << ": OBB tree of the " << obbTreeNames[treeIndex] << " is not built" << std::endl;
+      return EXIT_FAILURE;
+    }
+    obbTreeMTimes[treeIndex] = obbTrees[treeIndex]->GetMTime();
+    dataSetMTimes[treeIndex] = obbTrees[treeIndex]->GetDataSet()->GetMTime();
+  }
+
+  parameterNode->SetGantryRotationAngle(90.0);
+  roomsEyeViewLogic->UpdateGantryToFixedReferenceTransform(parameterNode);
+  roomsEyeViewLogic->CheckForCollisions(parameterNode);
+  for (int treeIndex=0; treeIndex<5; ++treeIndex)
+  {
+    if ( obbTrees[treeIndex]->GetMTime() != obbTreeMTimes[treeIndex]
+      || obbTrees[treeIndex]->GetDataSet()->GetMTime() != dataSetMTimes[treeIndex] )
+    {
+      std::cerr << __LINE__ << ": OBB tree of the " << obbTreeNames[treeIndex] << " is rebuilt although its model did not change" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,377 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkBinaryLabelmapDistanceMetrics.h"
+
+// SlicerRtCommon includes
+#include "vtkEuclideanDistanceTransform.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkBinaryLabelmapDistanceMetrics);
+
+vtkCxxSetObjectMacro(vtkBinaryLabelmapDistanceMetrics, ReferenceLabelmap, vtkImageData);
+vtkCxxSetObjectMacro(vtkBinaryLabelmapDistanceMetrics, CompareLabelmap, vtkImageData);
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /// Tolerance of the surface Dice comparisons (distances are computed in single precision)
+  const double SURFACE_DICE_EPSILON_MM = 1.0e-4;
+
+  //----------------------------------------------------------------------------
+  /// Extend the bounding box (in IJK) with the non-zero voxels of a labelmap
+  template <class T> void ExtendNonZeroExtent(const T* labelmapPtr, const int extent[6], int nonZeroExtent[6])
+  {
+    const T* voxelPtr = labelmapPtr;
+    for (int k=extent[4]; k<=extent[5]; ++k)
+    {
+      for (int j=extent[2]; j<=extent[3]; ++j)
+      {
+        for (int i=extent[0]; i<=extent[1]; ++i, ++voxelPtr)
+        {
+          if (*voxelPtr != 0)
+          {
+            nonZeroExtent[0] = std::min(nonZeroExtent[0], i);
+            nonZeroExtent[1] = std::max(nonZeroExtent[1], i);
+            nonZeroExtent[2] = std::min(nonZeroExtent[2], j);
+            nonZeroExtent[3] = std::max(nonZeroExtent[3], j);
+            nonZeroExtent[4] = std::min(nonZeroExtent[4], k);
+            nonZeroExtent[5] = std::max(nonZeroExtent[5], k);
+          }
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Copy a labelmap as a 0/1 mask into a cropped (or padded) extent. Voxels outside the input are zero
+  template <class T> void CopyMask(const T* labelmapPtr, const int extent[6], unsigned char* maskPtr, const int maskExtent[6])
+  {
+    int maskDimensions[3] = { maskExtent[1]-maskExtent[0]+1, maskExtent[3]-maskExtent[2]+1, maskExtent[5]-maskExtent[4]+1 };
+    int dimensions[3] = { extent[1]-extent[0]+1, extent[3]-extent[2]+1, extent[5]-extent[4]+1 };
+    std::fill(maskPtr, maskPtr + (vtkIdType)maskDimensions[0]*maskDimensions[1]*maskDimensions[2], 0);
+    for (int k=std::max(extent[4], maskExtent[4]); k<=std::min(extent[5], maskExtent[5]); ++k)
+    {
+      for (int j=std::max(extent[2], maskExtent[2]); j<=std::min(extent[3], maskExtent[3]); ++j)
+      {
+        int iStart = std::max(extent[0], maskExtent[0]);
+        int iEnd = std::min(extent[1], maskExtent[1]);
+        const T* inputRowPtr = labelmapPtr + (iStart-extent[0])
+          + (vtkIdType)dimensions[0] * ((j-extent[2]) + (vtkIdType)dimensions[1] * (k-extent[4]));
+        unsigned char* maskRowPtr = maskPtr + (iStart-maskExtent[0])
+          + (vtkIdType)maskDimensions[0] * ((j-maskExtent[2]) + (vtkIdType)maskDimensions[1] * (k-maskExtent[4]));
+        for (int i=iStart; i<=iEnd; ++i)
+        {
+          *(maskRowPtr++) = (*(inputRowPtr++) != 0 ? 1 : 0);
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// 95th percentile of distances (reorders the vector)
+  double GetPercentile95(std::vector<float>& distances)
+  {
+    if (distances.empty())
+    {
+      return 0.0;
+    }
+    size_t percentileIndex = std::min( (size_t)(0.95 * (double)distances.size()), distances.size()-1 );
+    std::nth_element(distances.begin(), distances.begin() + percentileIndex, distances.end());
+    return distances[percentileIndex];
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkBinaryLabelmapDistanceMetrics::vtkBinaryLabelmapDistanceMetrics()
+{
+  this->ReferenceLabelmap = NULL;
+  this->CompareLabelmap = NULL;
+  this->NumberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+
+  this->MaximumHausdorffDistanceForBoundaryMm = 0.0;
+  this->AverageHausdorffDistanceForBoundaryMm = 0.0;
+  this->Percent95HausdorffDistanceForBoundaryMm = 0.0;
+  this->MaximumHausdorffDistanceForVolumeMm = 0.0;
+  this->AverageHausdorffDistanceForVolumeMm = 0.0;
+  this->Percent95HausdorffDistanceForVolumeMm = 0.0;
+  this->NumberOfReferenceBoundaryVoxels = 0;
+  this->NumberOfCompareBoundaryVoxels = 0;
+}
+
+//----------------------------------------------------------------------------
+vtkBinaryLabelmapDistanceMetrics::~vtkBinaryLabelmapDistanceMetrics()
+{
+  this->SetReferenceLabelmap(NULL);
+  this->SetCompareLabelmap(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkBinaryLabelmapDistanceMetrics::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "SurfaceDiceTolerancesMm:";
+  for (std::vector<double>::iterator toleranceIt = this->SurfaceDiceTolerancesMm.begin(); toleranceIt != this->SurfaceDiceTolerancesMm.end(); ++toleranceIt)
+  {
+    os << " " << (*toleranceIt);
+  }
+  os << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "MaximumHausdorffDistanceForBoundaryMm: " << this->MaximumHausdorffDistanceForBoundaryMm << "\n";
+  os << indent << "AverageHausdorffDistanceForBoundaryMm: " << this->AverageHausdorffDistanceForBoundaryMm << "\n";
+  os << indent << "Percent95HausdorffDistanceForBoundaryMm: " << this->Percent95HausdorffDistanceForBoundaryMm << "\n";
+  os << indent << "MaximumHausdorffDistanceForVolumeMm: " << this->MaximumHausdorffDistanceForVolumeMm << "\n";
+  os << indent << "AverageHausdorffDistanceForVolumeMm: " << this->AverageHausdorffDistanceForVolumeMm << "\n";
+  os << indent << "Percent95HausdorffDistanceForVolumeMm: " << this->Percent95HausdorffDistanceForVolumeMm << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkBinaryLabelmapDistanceMetrics::AddSurfaceDiceToleranceMm(double tolerance)
+{
+  this->SurfaceDiceTolerancesMm.push_back(tolerance);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkBinaryLabelmapDistanceMetrics::RemoveAllSurfaceDiceTolerances()
+{
+  this->SurfaceDiceTolerancesMm.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkBinaryLabelmapDistanceMetrics::GetNumberOfSurfaceDiceTolerances()
+{
+  return (int)this->SurfaceDiceTolerancesMm.size();
+}
+
+//----------------------------------------------------------------------------
+double vtkBinaryLabelmapDistanceMetrics::GetSurfaceDiceToleranceMm(int toleranceIndex)
+{
+  if (toleranceIndex < 0 || toleranceIndex >= (int)this->SurfaceDiceTolerancesMm.size())
+  {
+    vtkErrorMacro("GetSurfaceDiceToleranceMm: Invalid tolerance index " << toleranceIndex);
+    return 0.0;
+  }
+  return this->SurfaceDiceTolerancesMm[toleranceIndex];
+}
+
+//----------------------------------------------------------------------------
+double vtkBinaryLabelmapDistanceMetrics::GetSurfaceDice(int toleranceIndex)
+{
+  if (toleranceIndex < 0 || toleranceIndex >= (int)this->SurfaceDices.size())
+  {
+    vtkErrorMacro("GetSurfaceDice: Invalid tolerance index " << toleranceIndex << " (need to call Update after adding the tolerances)");
+    return 0.0;
+  }
+  return this->SurfaceDices[toleranceIndex];
+}
+
+//----------------------------------------------------------------------------
+void vtkBinaryLabelmapDistanceMetrics::ComputeStatistics(std::vector<float>& referenceDistances, std::vector<float>& compareDistances,
+  double& maximum, double& average, double& percent95)
+{
+  maximum = 0.0;
+  average = 0.0;
+  percent95 = 0.0;
+  std::vector<float>* distanceVectors[2] = { &referenceDistances, &compareDistances };
+  for (int direction=0; direction<2; ++direction)
+  {
+    std::vector<float>& distances = *distanceVectors[direction];
+    if (distances.empty())
+    {
+      continue;
+    }
+    double sum = 0.0;
+    for (std::vector<float>::iterator distanceIt = distances.begin(); distanceIt != distances.end(); ++distanceIt)
+    {
+      sum += (*distanceIt);
+      maximum = std::max(maximum, (double)(*distanceIt));
+    }
+    average += 0.5 * sum / (double)distances.size();
+    percent95 = std::max(percent95, GetPercentile95(distances));
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkBinaryLabelmapDistanceMetrics::Update()
+{
+  this->SurfaceDices.clear();
+  if ( !this->ReferenceLabelmap || !this->ReferenceLabelmap->GetPointData()->GetScalars()
+    || !this->CompareLabelmap || !this->CompareLabelmap->GetPointData()->GetScalars() )
+  {
+    vtkErrorMacro("Update: Reference and compare labelmaps need to be set!");
+    return false;
+  }
+  int referenceExtent[6] = {0, -1, 0, -1, 0, -1};
+  int compareExtent[6] = {0, -1, 0, -1, 0, -1};
+  this->ReferenceLabelmap->GetExtent(referenceExtent);
+  this->CompareLabelmap->GetExtent(compareExtent);
+  double referenceSpacing[3] = {1.0, 1.0, 1.0};
+  double compareSpacing[3] = {1.0, 1.0, 1.0};
+  this->ReferenceLabelmap->GetSpacing(referenceSpacing);
+  this->CompareLabelmap->GetSpacing(compareSpacing);
+  double referenceOrigin[3] = {0.0, 0.0, 0.0};
+  double compareOrigin[3] = {0.0, 0.0, 0.0};
+  this->ReferenceLabelmap->GetOrigin(referenceOrigin);
+  this->CompareLabelmap->GetOrigin(compareOrigin);
+  for (int axis=0; axis<3; ++axis)
+  {
+    if ( fabs(referenceSpacing[axis] - compareSpacing[axis]) > 1.0e-6 * fabs(referenceSpacing[axis])
+      || fabs(referenceOrigin[axis] - compareOrigin[axis]) > 1.0e-3 * fabs(referenceSpacing[axis]) )
+    {
+      vtkErrorMacro("Update: Reference and compare labelmaps need to be on the same lattice!");
+      return false;
+    }
+  }
+
+  // Determine the extent containing both objects, padded by one voxel so that the boundary is well defined
+  int nonZeroExtent[6] = { VTK_INT_MAX, VTK_INT_MIN, VTK_INT_MAX, VTK_INT_MIN, VTK_INT_MAX, VTK_INT_MIN };
+  int referenceNonZeroExtent[6] = { VTK_INT_MAX, VTK_INT_MIN, VTK_INT_MAX, VTK_INT_MIN, VTK_INT_MAX, VTK_INT_MIN };
+  switch (this->ReferenceLabelmap->GetScalarType())
+  {
+    vtkTemplateMacro( ExtendNonZeroExtent(static_cast<VTK_TT*>(this->ReferenceLabelmap->GetScalarPointer()), referenceExtent, referenceNonZeroExtent) );
+    default:
+      vtkErrorMacro("Update: Unsupported reference labelmap scalar type!");
+      return false;
+  }
+  switch (this->CompareLabelmap->GetScalarType())
+  {
+    vtkTemplateMacro( ExtendNonZeroExtent(static_cast<VTK_TT*>(this->CompareLabelmap->GetScalarPointer()), compareExtent, nonZeroExtent) );
+    default:
+      vtkErrorMacro("Update: Unsupported compare labelmap scalar type!");
+      return false;
+  }
+  if (referenceNonZeroExtent[0] > referenceNonZeroExtent[1] || nonZeroExtent[0] > nonZeroExtent[1])
+  {
+    vtkErrorMacro("Update: Reference or compare labelmap is empty!");
+    return false;
+  }
+  int maskExtent[6] = {0, -1, 0, -1, 0, -1};
+  for (int axis=0; axis<3; ++axis)
+  {
+    maskExtent[2*axis] = std::min(referenceNonZeroExtent[2*axis], nonZeroExtent[2*axis]) - 1;
+    maskExtent[2*axis+1] = std::max(referenceNonZeroExtent[2*axis+1], nonZeroExtent[2*axis+1]) + 1;
+  }
+
+  // Copy the labelmaps as masks into the common extent
+  vtkSmartPointer<vtkImageData> referenceMask = vtkSmartPointer<vtkImageData>::New();
+  vtkSmartPointer<vtkImageData> compareMask = vtkSmartPointer<vtkImageData>::New();
+  vtkImageData* masks[2] = { referenceMask, compareMask };
+  vtkImageData* labelmaps[2] = { this->ReferenceLabelmap, this->CompareLabelmap };
+  int* extents[2] = { referenceExtent, compareExtent };
+  for (int index=0; index<2; ++index)
+  {
+    masks[index]->SetExtent(maskExtent);
+    masks[index]->SetSpacing(referenceSpacing);
+    masks[index]->SetOrigin(referenceOrigin);
+    masks[index]->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    unsigned char* maskPtr = static_cast<unsigned char*>(masks[index]->GetScalarPointer());
+    switch (labelmaps[index]->GetScalarType())
+    {
+      vtkTemplateMacro( CopyMask(static_cast<VTK_TT*>(labelmaps[index]->GetScalarPointer()), extents[index], maskPtr, maskExtent) );
+    }
+  }
+
+  // Distance transform of the boundary of each labelmap
+  vtkSmartPointer<vtkEuclideanDistanceTransform> referenceDistanceTransform = vtkSmartPointer<vtkEuclideanDistanceTransform>::New();
+  referenceDistanceTransform->SetInputImageData(referenceMask);
+  referenceDistanceTransform->SetFeatureMode(vtkEuclideanDistanceTransform::DistanceToObjectBoundary);
+  referenceDistanceTransform->SetNumberOfThreads(this->NumberOfThreads);
+  vtkSmartPointer<vtkEuclideanDistanceTransform> compareDistanceTransform = vtkSmartPointer<vtkEuclideanDistanceTransform>::New();
+  compareDistanceTransform->SetInputImageData(compareMask);
+  compareDistanceTransform->SetFeatureMode(vtkEuclideanDistanceTransform::DistanceToObjectBoundary);
+  compareDistanceTransform->SetNumberOfThreads(this->NumberOfThreads);
+  if (!referenceDistanceTransform->Update() || !compareDistanceTransform->Update())
+  {
+    vtkErrorMacro("Update: Failed to compute distance transforms!");
+    return false;
+  }
+
+  // Read the distances off the object and boundary voxels
+  const unsigned char* referenceMaskPtr = static_cast<unsigned char*>(referenceMask->GetScalarPointer());
+  const unsigned char* compareMaskPtr = static_cast<unsigned char*>(compareMask->GetScalarPointer());
+  const float* referenceSquaredDistancePtr = static_cast<float*>(referenceDistanceTransform->GetOutputImageData()->GetScalarPointer());
+  const float* compareSquaredDistancePtr = static_cast<float*>(compareDistanceTransform->GetOutputImageData()->GetScalarPointer());
+  DirectedDistances referenceToCompare;
+  DirectedDistances compareToReference;
+  vtkIdType numberOfVoxels = referenceMask->GetNumberOfPoints();
+  for (vtkIdType index=0; index<numberOfVoxels; ++index)
+  {
+    if (referenceMaskPtr[index])
+    {
+      float distanceToCompareBoundary = sqrt(compareSquaredDistancePtr[index]);
+      referenceToCompare.VolumeDistances.push_back(compareMaskPtr[index] ? 0.0f : distanceToCompareBoundary);
+      if (referenceSquaredDistancePtr[index] == 0.0f)
+      {
+        referenceToCompare.BoundaryDistances.push_back(distanceToCompareBoundary);
+      }
+    }
+    if (compareMaskPtr[index])
+    {
+      float distanceToReferenceBoundary = sqrt(referenceSquaredDistancePtr[index]);
+      compareToReference.VolumeDistances.push_back(referenceMaskPtr[index] ? 0.0f : distanceToReferenceBoundary);
+      if (compareSquaredDistancePtr[index] == 0.0f)
+      {
+        compareToReference.BoundaryDistances.push_back(distanceToReferenceBoundary);
+      }
+    }
+  }
+  this->NumberOfReferenceBoundaryVoxels = (vtkIdType)referenceToCompare.BoundaryDistances.size();
+  this->NumberOfCompareBoundaryVoxels = (vtkIdType)compareToReference.BoundaryDistances.size();
+
+  // Surface Dice (before the statistics reorder the distances)
+  for (std::vector<double>::iterator toleranceIt = this->SurfaceDiceTolerancesMm.begin(); toleranceIt != this->SurfaceDiceTolerancesMm.end(); ++toleranceIt)
+  {
+    vtkIdType numberOfBoundaryVoxelsWithinTolerance = 0;
+    DirectedDistances* directions[2] = { &referenceToCompare, &compareToReference };
+    for (int direction=0; direction<2; ++direction)
+    {
+      std::vector<float>& distances = directions[direction]->BoundaryDistances;
+      for (std::vector<float>::iterator distanceIt = distances.begin(); distanceIt != distances.end(); ++distanceIt)
+      {
+        if ((*distanceIt) <= (*toleranceIt) + SURFACE_DICE_EPSILON_MM)
+        {
+          ++numberOfBoundaryVoxelsWithinTolerance;
+        }
+      }
+    }
+    this->SurfaceDices.push_back( (double)numberOfBoundaryVoxelsWithinTolerance
+      / (double)(this->NumberOfReferenceBoundaryVoxels + this->NumberOfCompareBoundaryVoxels) );
+  }
+
+  ComputeStatistics(referenceToCompare.BoundaryDistances, compareToReference.BoundaryDistances,
+    this->MaximumHausdorffDistanceForBoundaryMm, this->AverageHausdorffDistanceForBoundaryMm, this->Percent95HausdorffDistanceForBoundaryMm);
+  ComputeStatistics(referenceToCompare.VolumeDistances, compareToReference.VolumeDistances,
+    this->MaximumHausdorffDistanceForVolumeMm, this->AverageHausdorffDistanceForVolumeMm, this->Percent95HausdorffDistanceForVolumeMm);
+
+  return true;
+}
@@ -0,0 +1,154 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#ifndef __vtkBinaryLabelmapDistanceMetrics_h
+#define __vtkBinaryLabelmapDistanceMetrics_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkMultiThreader.h>
+
+// STD includes
+#include <vector>
+
+#include "vtkSlicerSegmentComparisonModuleLogicExport.h"
+
+class vtkImageData;
+
+/// \ingroup SlicerRt_QtModules_SegmentComparison
+/// \class vtkBinaryLabelmapDistanceMetrics
+/// \brief Compute Hausdorff distances and surface Dice of two binary labelmaps using distance transforms.
+///
+/// Both labelmaps are cropped to the bounding box of their non-zero voxels (padded by one voxel), and the
+/// Euclidean distance transform of the boundary of each is computed once (\sa vtkEuclideanDistanceTransform).
+/// Boundary voxels are object voxels with a background face neighbor. All metrics are then read off in one pass:
+/// - Boundary metrics: distances from the boundary voxels of each labelmap to the boundary of the other
+/// - Volume metrics: distances from the object voxels of each labelmap to the other object (zero inside it)
+/// - Surface Dice at a tolerance: fraction of boundary voxels of both labelmaps that are within the tolerance
+///   from the boundary of the other labelmap
+/// The maximum is the symmetric Hausdorff distance (maximum of the two directions), the average is the mean of the
+/// average distances of the two directions, and the 95% value is the maximum of the 95th percentiles of the two directions.
+///
+/// The two labelmaps need to be on the same lattice (same extent, origin and spacing).
+class VTK_SLICER_SEGMENTCOMPARISON_MODULE_LOGIC_EXPORT vtkBinaryLabelmapDistanceMetrics : public vtkObject
+{
+public:
+  static vtkBinaryLabelmapDistanceMetrics *New();
+  vtkTypeMacro(vtkBinaryLabelmapDistanceMetrics, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Set reference labelmap (single component, any scalar type, non-zero voxels are inside)
+  void SetReferenceLabelmap(vtkImageData* imageData);
+  vtkGetObjectMacro(ReferenceLabelmap, vtkImageData);
+
+  /// Set compare labelmap (single component, any scalar type, same lattice as the reference)
+  void SetCompareLabelmap(vtkImageData* imageData);
+  vtkGetObjectMacro(CompareLabelmap, vtkImageData);
+
+  /// Add tolerance (mm) at which the surface Dice is computed
+  void AddSurfaceDiceToleranceMm(double tolerance);
+  /// Remove all surface Dice tolerances
+  void RemoveAllSurfaceDiceTolerances();
+  /// Get number of surface Dice tolerances
+  int GetNumberOfSurfaceDiceTolerances();
+  /// Get surface Dice tolerance (mm)
+  double GetSurfaceDiceToleranceMm(int toleranceIndex);
+
+  /// Number of threads used for the distance transforms. By default the number of processors is used
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_MAX_THREADS);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Compute the metrics
+  /// \return Success flag
+  bool Update();
+
+  /// Get maximum Hausdorff distance for the boundary voxels
+  vtkGetMacro(MaximumHausdorffDistanceForBoundaryMm, double);
+  /// Get average Hausdorff distance for the boundary voxels
+  vtkGetMacro(AverageHausdorffDistanceForBoundaryMm, double);
+  /// Get 95% Hausdorff distance for the boundary voxels
+  vtkGetMacro(Percent95HausdorffDistanceForBoundaryMm, double);
+  /// Get maximum Hausdorff distance for the whole volume
+  vtkGetMacro(MaximumHausdorffDistanceForVolumeMm, double);
+  /// Get average Hausdorff distance for the whole volume
+  vtkGetMacro(AverageHausdorffDistanceForVolumeMm, double);
+  /// Get 95% Hausdorff distance for the whole volume
+  vtkGetMacro(Percent95HausdorffDistanceForVolumeMm, double);
+  /// Get surface Dice at a tolerance (in the order the tolerances were added)
+  double GetSurfaceDice(int toleranceIndex);
+
+  /// Get number of boundary voxels of the reference labelmap
+  vtkGetMacro(NumberOfReferenceBoundaryVoxels, vtkIdType);
+  /// Get number of boundary voxels of the compare labelmap
+  vtkGetMacro(NumberOfCompareBoundaryVoxels, vtkIdType);
+
+protected:
+  /// Distances of one direction (from the voxels of one labelmap to the other labelmap)
+  struct DirectedDistances
+  {
+    /// Distances from the boundary voxels to the boundary of the other labelmap
+    std::vector<float> BoundaryDistances;
+    /// Distances from the object voxels to the other object
+    std::vector<float> VolumeDistances;
+  };
+
+  /// Compute maximum, average and 95th percentile of the distances of both directions
+  static void ComputeStatistics(std::vector<float>& referenceDistances, std::vector<float>& compareDistances,
+    double& maximum, double& average, double& percent95);
+
+protected:
+  vtkBinaryLabelmapDistanceMetrics();
+  virtual ~vtkBinaryLabelmapDistanceMetrics();
+
+protected:
+  /// Reference labelmap
+  vtkImageData* ReferenceLabelmap;
+  /// Compare labelmap
+  vtkImageData* CompareLabelmap;
+  /// Surface Dice tolerances
+  std::vector<double> SurfaceDiceTolerancesMm;
+  /// Number of threads
+  int NumberOfThreads;
+
+  /// Maximum Hausdorff distance for the boundary voxels
+  double MaximumHausdorffDistanceForBoundaryMm;
+  /// Average Hausdorff distance for the boundary voxels
+  double AverageHausdorffDistanceForBoundaryMm;
+  /// 95% Hausdorff distance for the boundary voxels
+  double Percent95HausdorffDistanceForBoundaryMm;
+  /// Maximum Hausdorff distance for the whole volume
+  double MaximumHausdorffDistanceForVolumeMm;
+  /// Average Hausdorff distance for the whole volume
+  double AverageHausdorffDistanceForVolumeMm;
+  /// 95% Hausdorff distance for the whole volume
+  double Percent95HausdorffDistanceForVolumeMm;
+  /// Surface Dice for each tolerance
+  std::vector<double> SurfaceDices;
+  /// Number of reference boundary voxels
+  vtkIdType NumberOfReferenceBoundaryVoxels;
+  /// Number of compare boundary voxels
+  vtkIdType NumberOfCompareBoundaryVoxels;
+
+private:
+  vtkBinaryLabelmapDistanceMetrics(const vtkBinaryLabelmapDistanceMetrics&); // Not implemented
+  void operator=(const vtkBinaryLabelmapDistanceMetrics&);                   // Not implemented
+};
+
+#endif
@@ -0,0 +1,480 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkLabelmapOverlapMatrix.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkLabelmapOverlapMatrix);
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /// Number of voxels packed in one bit word
+  const int BITS_PER_WORD = 64;
+
+  //----------------------------------------------------------------------------
+  /// Get range of the words of the slice bit plane (of the common extent) that a labelmap extent covers
+  void GetSliceWordRange(const int extent[6], const int commonExtent[6], vtkIdType wordRange[2])
+  {
+    vtkIdType commonDimensionX = commonExtent[1]-commonExtent[0]+1;
+    wordRange[0] = ((extent[2]-commonExtent[2]) * commonDimensionX + (extent[0]-commonExtent[0])) / BITS_PER_WORD;
+    wordRange[1] = ((extent[3]-commonExtent[2]) * commonDimensionX + (extent[1]-commonExtent[0])) / BITS_PER_WORD;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Set the bits of the non-zero voxels of a labelmap in its bit plane of a slice of the common extent
+  template <class T> void PackSliceBits(const T* labelmapPtr, const int extent[6], int k, const int commonExtent[6], vtkTypeUInt64* bitsPtr)
+  {
+    int dimensions[2] = { extent[1]-extent[0]+1, extent[3]-extent[2]+1 };
+    vtkIdType commonDimensionX = commonExtent[1]-commonExtent[0]+1;
+    for (int j=extent[2]; j<=extent[3]; ++j)
+    {
+      const T* voxelPtr = labelmapPtr + (vtkIdType)dimensions[0] * ((j-extent[2]) + (vtkIdType)dimensions[1] * (k-extent[4]));
+      vtkIdType bitIndex = (j-commonExtent[2]) * commonDimensionX + (extent[0]-commonExtent[0]);
+      for (int i=extent[0]; i<=extent[1]; ++i, ++voxelPtr, ++bitIndex)
+      {
+        if (*voxelPtr != 0)
+        {
+          bitsPtr[bitIndex / BITS_PER_WORD] |= ((vtkTypeUInt64)1) << (bitIndex % BITS_PER_WORD);
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Count the set bits of a word
+  inline int CountSetBits(vtkTypeUInt64 word)
+  {
+#if defined(__GNUC__)
+    return __builtin_popcountll(word);
+#else
+    word = word - ((word >> 1) & 0x5555555555555555ULL);
+    word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+    word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((word * 0x0101010101010101ULL) >> 56);
+#endif
+  }
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE CountSlicesThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    vtkLabelmapOverlapMatrix* self = static_cast<vtkLabelmapOverlapMatrix*>(threadInfo->UserData);
+
+    int numberOfSlices = self->GetNumberOfSlices();
+    int slicesPerThread = (numberOfSlices + threadInfo->NumberOfThreads - 1) / threadInfo->NumberOfThreads;
+    int startSlice = threadInfo->ThreadID * slicesPerThread;
+    int endSlice = std::min(startSlice + slicesPerThread, numberOfSlices);
+    if (startSlice < endSlice)
+    {
+      self->ThreadedCountSlices(startSlice, endSlice, threadInfo->ThreadID);
+    }
+
+    return VTK_THREAD_RETURN_VALUE;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkLabelmapOverlapMatrix::vtkLabelmapOverlapMatrix()
+{
+  this->Threader = vtkMultiThreader::New();
+  this->NumberOfThreads = this->Threader->GetNumberOfThreads();
+  this->CommonExtent[0] = this->CommonExtent[2] = this->CommonExtent[4] = 0;
+  this->CommonExtent[1] = this->CommonExtent[3] = this->CommonExtent[5] = -1;
+  this->VoxelVolumeMm3 = 0.0;
+}
+
+//----------------------------------------------------------------------------
+vtkLabelmapOverlapMatrix::~vtkLabelmapOverlapMatrix()
+{
+  this->RemoveAllLabelmaps();
+  if (this->Threader)
+  {
+    this->Threader->Delete();
+    this->Threader = NULL;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkLabelmapOverlapMatrix::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "NumberOfReferenceLabelmaps: " << this->ReferenceLabelmaps.size() << "\n";
+  os << indent << "NumberOfCompareLabelmaps: " << this->CompareLabelmaps.size() << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "VoxelVolumeMm3: " << this->VoxelVolumeMm3 << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkLabelmapOverlapMatrix::AddReferenceLabelmap(vtkImageData* labelmap)
+{
+  if (!labelmap)
+  {
+    vtkErrorMacro("AddReferenceLabelmap: Invalid labelmap!");
+    return;
+  }
+  this->ReferenceLabelmaps.push_back(labelmap);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkLabelmapOverlapMatrix::AddCompareLabelmap(vtkImageData* labelmap)
+{
+  if (!labelmap)
+  {
+    vtkErrorMacro("AddCompareLabelmap: Invalid labelmap!");
+    return;
+  }
+  this->CompareLabelmaps.push_back(labelmap);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkLabelmapOverlapMatrix::RemoveAllLabelmaps()
+{
+  this->ReferenceLabelmaps.clear();
+  this->CompareLabelmaps.clear();
+  this->ReferenceVoxelCounts.clear();
+  this->CompareVoxelCounts.clear();
+  this->IntersectionVoxelCounts.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+bool vtkLabelmapOverlapMatrix::InitializeCommonLattice()
+{
+  // The lattice is defined by the first non-empty labelmap
+  bool latticeInitialized = false;
+  double spacing[3] = {1.0, 1.0, 1.0};
+  double origin[3] = {0.0, 0.0, 0.0};
+  this->VoxelVolumeMm3 = 0.0;
+
+  this->CommonExtent[0] = this->CommonExtent[2] = this->CommonExtent[4] = VTK_INT_MAX;
+  this->CommonExtent[1] = this->CommonExtent[3] = this->CommonExtent[5] = VTK_INT_MIN;
+  std::vector< vtkSmartPointer<vtkImageData> > labelmaps(this->ReferenceLabelmaps);
+  labelmaps.insert(labelmaps.end(), this->CompareLabelmaps.begin(), this->CompareLabelmaps.end());
+  for (std::vector< vtkSmartPointer<vtkImageData> >::iterator labelmapIt = labelmaps.begin(); labelmapIt != labelmaps.end(); ++labelmapIt)
+  {
+    vtkImageData* labelmap = (*labelmapIt);
+    int extent[6] = {0, -1, 0, -1, 0, -1};
+    labelmap->GetExtent(extent);
+    if (extent[0] > extent[1] || extent[2] > extent[3] || extent[4] > extent[5])
+    {
+      continue; // Empty labelmap
+    }
+    if (!labelmap->GetPointData()->GetScalars() || labelmap->GetNumberOfScalarComponents() != 1)
+    {
+      vtkErrorMacro("InitializeCommonLattice: Labelmaps need to have single component scalars!");
+      return false;
+    }
+    double currentSpacing[3] = {1.0, 1.0, 1.0};
+    labelmap->GetSpacing(currentSpacing);
+    double currentOrigin[3] = {0.0, 0.0, 0.0};
+    labelmap->GetOrigin(currentOrigin);
+    if (!latticeInitialized)
+    {
+      std::copy(currentSpacing, currentSpacing + 3, spacing);
+      std::copy(currentOrigin, currentOrigin + 3, origin);
+      this->VoxelVolumeMm3 = fabs(spacing[0] * spacing[1] * spacing[2]);
+      latticeInitialized = true;
+    }
+    for (int axis=0; axis<3; ++axis)
+    {
+      if ( fabs(currentSpacing[axis] - spacing[axis]) > 1.0e-6 * fabs(spacing[axis])
+        || fabs(currentOrigin[axis] - origin[axis]) > 1.0e-3 * fabs(spacing[axis]) )
+      {
+        vtkErrorMacro("InitializeCommonLattice: All labelmaps need to be on the same lattice!");
+        return false;
+      }
+    }
+
+    for (int axis=0; axis<3; ++axis)
+    {
+      this->CommonExtent[2*axis] = std::min(this->CommonExtent[2*axis], extent[2*axis]);
+      this->CommonExtent[2*axis+1] = std::max(this->CommonExtent[2*axis+1], extent[2*axis+1]);
+    }
+  }
+  if (this->CommonExtent[0] > this->CommonExtent[1])
+  {
+    // All labelmaps are empty
+    this->CommonExtent[0] = this->CommonExtent[2] = this->CommonExtent[4] = 0;
+    this->CommonExtent[1] = this->CommonExtent[3] = this->CommonExtent[5] = -1;
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkLabelmapOverlapMatrix::Update()
+{
+  this->ReferenceVoxelCounts.clear();
+  this->CompareVoxelCounts.clear();
+  this->IntersectionVoxelCounts.clear();
+  if (this->ReferenceLabelmaps.empty() || this->CompareLabelmaps.empty())
+  {
+    vtkErrorMacro("Update: At least one reference and one compare labelmap is needed!");
+    return false;
+  }
+  if (!this->InitializeCommonLattice())
+  {
+    return false;
+  }
+
+  size_t numberOfReferenceLabelmaps = this->ReferenceLabelmaps.size();
+  size_t numberOfCompareLabelmaps = this->CompareLabelmaps.size();
+  for (int threadId=0; threadId<this->NumberOfThreads; ++threadId)
+  {
+    this->ThreadReferenceVoxelCounts[threadId].assign(numberOfReferenceLabelmaps, 0);
+    this->ThreadCompareVoxelCounts[threadId].assign(numberOfCompareLabelmaps, 0);
+    this->ThreadIntersectionVoxelCounts[threadId].assign(numberOfReferenceLabelmaps * numberOfCompareLabelmaps, 0);
+  }
+
+  if (this->GetNumberOfSlices() > 0)
+  {
+    this->Threader->SetNumberOfThreads(this->NumberOfThreads);
+    this->Threader->SetSingleMethod(CountSlicesThreadFunction, this);
+    this->Threader->SingleMethodExecute();
+  }
+
+  // Merge the counts of the threads
+  this->ReferenceVoxelCounts.assign(numberOfReferenceLabelmaps, 0);
+  this->CompareVoxelCounts.assign(numberOfCompareLabelmaps, 0);
+  this->IntersectionVoxelCounts.assign(numberOfReferenceLabelmaps * numberOfCompareLabelmaps, 0);
+  for (int threadId=0; threadId<this->NumberOfThreads; ++threadId)
+  {
+    for (size_t index=0; index<numberOfReferenceLabelmaps; ++index)
+    {
+      this->ReferenceVoxelCounts[index] += this->ThreadReferenceVoxelCounts[threadId][index];
+    }
+    for (size_t index=0; index<numberOfCompareLabelmaps; ++index)
+    {
+      this->CompareVoxelCounts[index] += this->ThreadCompareVoxelCounts[threadId][index];
+    }
+    for (size_t index=0; index<this->IntersectionVoxelCounts.size(); ++index)
+    {
+      this->IntersectionVoxelCounts[index] += this->ThreadIntersectionVoxelCounts[threadId][index];
+    }
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkLabelmapOverlapMatrix::ThreadedCountSlices(int startSlice, int endSlice, int threadId)
+{
+  int numberOfReferenceLabelmaps = (int)this->ReferenceLabelmaps.size();
+  int numberOfCompareLabelmaps = (int)this->CompareLabelmaps.size();
+  int numberOfLabelmaps = numberOfReferenceLabelmaps + numberOfCompareLabelmaps;
+  vtkIdType numberOfVoxelsInSlice = (vtkIdType)(this->CommonExtent[1]-this->CommonExtent[0]+1) * (this->CommonExtent[3]-this->CommonExtent[2]+1);
+  vtkIdType wordsPerSlice = (numberOfVoxelsInSlice + BITS_PER_WORD - 1) / BITS_PER_WORD;
+
+  // One bit plane per labelmap (reference labelmaps first), of which only the words covered by the extent of the labelmap are used
+  std::vector<vtkImageData*> labelmaps;
+  labelmaps.insert(labelmaps.end(), this->ReferenceLabelmaps.begin(), this->ReferenceLabelmaps.end());
+  labelmaps.insert(labelmaps.end(), this->CompareLabelmaps.begin(), this->CompareLabelmaps.end());
+  std::vector<vtkTypeUInt64> bits(wordsPerSlice * numberOfLabelmaps, 0);
+  std::vector<vtkIdType> wordRanges(2 * numberOfLabelmaps, 0);
+  std::vector<bool> labelmapInSlice(numberOfLabelmaps, false);
+  for (int labelmapIndex=0; labelmapIndex<numberOfLabelmaps; ++labelmapIndex)
+  {
+    int extent[6] = {0, -1, 0, -1, 0, -1};
+    labelmaps[labelmapIndex]->GetExtent(extent);
+    if (extent[0] <= extent[1] && extent[2] <= extent[3] && extent[4] <= extent[5])
+    {
+      GetSliceWordRange(extent, this->CommonExtent, &wordRanges[2*labelmapIndex]);
+    }
+  }
+
+  vtkIdType* referenceCounts = &(this->ThreadReferenceVoxelCounts[threadId][0]);
+  vtkIdType* compareCounts = &(this->ThreadCompareVoxelCounts[threadId][0]);
+  vtkIdType* intersectionCounts = &(this->ThreadIntersectionVoxelCounts[threadId][0]);
+
+  for (int slice=startSlice; slice<endSlice; ++slice)
+  {
+    int k = this->CommonExtent[4] + slice;
+
+    // Pack the voxels of the labelmaps in the slice into their bit planes and count them
+    for (int labelmapIndex=0; labelmapIndex<numberOfLabelmaps; ++labelmapIndex)
+    {
+      vtkImageData* labelmap = labelmaps[labelmapIndex];
+      int extent[6] = {0, -1, 0, -1, 0, -1};
+      labelmap->GetExtent(extent);
+      labelmapInSlice[labelmapIndex] = (k >= extent[4] && k <= extent[5] && extent[0] <= extent[1] && extent[2] <= extent[3]);
+      if (!labelmapInSlice[labelmapIndex])
+      {
+        continue;
+      }
+      vtkTypeUInt64* bitsPtr = &bits[wordsPerSlice * labelmapIndex];
+      vtkIdType firstWord = wordRanges[2*labelmapIndex];
+      vtkIdType lastWord = wordRanges[2*labelmapIndex+1];
+      std::fill(bitsPtr + firstWord, bitsPtr + lastWord + 1, 0);
+      switch (labelmap->GetScalarType())
+      {
+        vtkTemplateMacro( PackSliceBits(static_cast<VTK_TT*>(labelmap->GetScalarPointer()), extent, k, this->CommonExtent, bitsPtr) );
+      }
+
+      vtkIdType count = 0;
+      for (vtkIdType word=firstWord; word<=lastWord; ++word)
+      {
+        count += CountSetBits(bitsPtr[word]);
+      }
+      if (labelmapIndex < numberOfReferenceLabelmaps)
+      {
+        referenceCounts[labelmapIndex] += count;
+      }
+      else
+      {
+        compareCounts[labelmapIndex - numberOfReferenceLabelmaps] += count;
+      }
+    }
+
+    // Count the intersections of each pair by AND-ing their bit planes where their extents overlap
+    for (int referenceIndex=0; referenceIndex<numberOfReferenceLabelmaps; ++referenceIndex)
+    {
+      if (!labelmapInSlice[referenceIndex])
+      {
+        continue;
+      }
+      const vtkTypeUInt64* referenceBitsPtr = &bits[wordsPerSlice * referenceIndex];
+      vtkIdType* intersectionRowPtr = intersectionCounts + (vtkIdType)referenceIndex * numberOfCompareLabelmaps;
+      for (int compareIndex=0; compareIndex<numberOfCompareLabelmaps; ++compareIndex)
+      {
+        int compareLabelmapIndex = numberOfReferenceLabelmaps + compareIndex;
+        if (!labelmapInSlice[compareLabelmapIndex])
+        {
+          continue;
+        }
+        const vtkTypeUInt64* compareBitsPtr = &bits[wordsPerSlice * compareLabelmapIndex];
+        vtkIdType firstWord = std::max(wordRanges[2*referenceIndex], wordRanges[2*compareLabelmapIndex]);
+        vtkIdType lastWord = std::min(wordRanges[2*referenceIndex+1], wordRanges[2*compareLabelmapIndex+1]);
+        vtkIdType count = 0;
+        for (vtkIdType word=firstWord; word<=lastWord; ++word)
+        {
+          count += CountSetBits(referenceBitsPtr[word] & compareBitsPtr[word]);
+        }
+        intersectionRowPtr[compareIndex] += count;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkLabelmapOverlapMatrix::IsValidPair(int referenceIndex, int compareIndex, const char* methodName)
+{
+  if ( referenceIndex < 0 || referenceIndex >= (int)this->ReferenceVoxelCounts.size()
+    || compareIndex < 0 || compareIndex >= (int)this->CompareVoxelCounts.size() )
+  {
+    vtkErrorMacro(methodName << ": Invalid labelmap indices " << referenceIndex << ", " << compareIndex
+      << " (need to call Update after adding the labelmaps)");
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkLabelmapOverlapMatrix::GetReferenceVoxelCount(int referenceIndex)
+{
+  if (!this->IsValidPair(referenceIndex, 0, "GetReferenceVoxelCount"))
+  {
+    return 0;
+  }
+  return this->ReferenceVoxelCounts[referenceIndex];
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkLabelmapOverlapMatrix::GetCompareVoxelCount(int compareIndex)
+{
+  if (!this->IsValidPair(0, compareIndex, "GetCompareVoxelCount"))
+  {
+    return 0;
+  }
+  return this->CompareVoxelCounts[compareIndex];
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkLabelmapOverlapMatrix::GetIntersectionVoxelCount(int referenceIndex, int compareIndex)
+{
+  if (!this->IsValidPair(referenceIndex, compareIndex, "GetIntersectionVoxelCount"))
+  {
+    return 0;
+  }
+  return this->IntersectionVoxelCounts[(size_t)referenceIndex * this->CompareVoxelCounts.size() + compareIndex];
+}
+
+//----------------------------------------------------------------------------
+double vtkLabelmapOverlapMatrix::GetDiceCoefficient(int referenceIndex, int compareIndex)
+{
+  if (!this->IsValidPair(referenceIndex, compareIndex, "GetDiceCoefficient"))
+  {
+    return 0.0;
+  }
+  vtkIdType sumOfVolumes = this->ReferenceVoxelCounts[referenceIndex] + this->CompareVoxelCounts[compareIndex];
+  if (sumOfVolumes == 0)
+  {
+    return 0.0;
+  }
+  return 2.0 * (double)this->GetIntersectionVoxelCount(referenceIndex, compareIndex) / (double)sumOfVolumes;
+}
+
+//----------------------------------------------------------------------------
+double vtkLabelmapOverlapMatrix::GetJaccardIndex(int referenceIndex, int compareIndex)
+{
+  if (!this->IsValidPair(referenceIndex, compareIndex, "GetJaccardIndex"))
+  {
+    return 0.0;
+  }
+  vtkIdType intersection = this->GetIntersectionVoxelCount(referenceIndex, compareIndex);
+  vtkIdType unionVolume = this->ReferenceVoxelCounts[referenceIndex] + this->CompareVoxelCounts[compareIndex] - intersection;
+  if (unionVolume == 0)
+  {
+    return 0.0;
+  }
+  return (double)intersection / (double)unionVolume;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkLabelmapOverlapMatrix::GetFalsePositiveVoxelCount(int referenceIndex, int compareIndex)
+{
+  if (!this->IsValidPair(referenceIndex, compareIndex, "GetFalsePositiveVoxelCount"))
+  {
+    return 0;
+  }
+  return this->CompareVoxelCounts[compareIndex] - this->GetIntersectionVoxelCount(referenceIndex, compareIndex);
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkLabelmapOverlapMatrix::GetFalseNegativeVoxelCount(int referenceIndex, int compareIndex)
+{
+  if (!this->IsValidPair(referenceIndex, compareIndex, "GetFalseNegativeVoxelCount"))
+  {
+    return 0;
+  }
+  return this->ReferenceVoxelCounts[referenceIndex] - this->GetIntersectionVoxelCount(referenceIndex, compareIndex);
+}
@@ -0,0 +1,145 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#ifndef __vtkLabelmapOverlapMatrix_h
+#define __vtkLabelmapOverlapMatrix_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkMultiThreader.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <vector>
+
+#include "vtkSlicerSegmentComparisonModuleLogicExport.h"
+
+class vtkImageData;
+
+/// \ingroup SlicerRt_QtModules_SegmentComparison
+/// \class vtkLabelmapOverlapMatrix
+/// \brief Compute the overlap of every reference labelmap with every compare labelmap in one pass.
+///
+/// Each slice of each labelmap is read once and packed into a bit plane (one bit per voxel) of the slice. The voxel
+/// counts are the population counts of the bit planes, and the intersection count of a reference and a compare
+/// labelmap is the population count of the AND of their bit planes, restricted to the words their extents overlap in.
+/// The slices are processed in parallel with per-thread counters.
+/// Dice coefficient, Jaccard index, volumes and false positives/negatives of all pairs are derived from the counts.
+///
+/// All labelmaps need to be on the same lattice (same origin, spacing and directions), but their extents may differ.
+class VTK_SLICER_SEGMENTCOMPARISON_MODULE_LOGIC_EXPORT vtkLabelmapOverlapMatrix : public vtkObject
+{
+public:
+  static vtkLabelmapOverlapMatrix *New();
+  vtkTypeMacro(vtkLabelmapOverlapMatrix, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Add reference labelmap (single component, any scalar type, non-zero voxels are inside)
+  void AddReferenceLabelmap(vtkImageData* labelmap);
+  /// Add compare labelmap (single component, any scalar type, non-zero voxels are inside)
+  void AddCompareLabelmap(vtkImageData* labelmap);
+  /// Remove all reference and compare labelmaps
+  void RemoveAllLabelmaps();
+
+  /// Get number of reference labelmaps
+  int GetNumberOfReferenceLabelmaps() { return (int)this->ReferenceLabelmaps.size(); };
+  /// Get number of compare labelmaps
+  int GetNumberOfCompareLabelmaps() { return (int)this->CompareLabelmaps.size(); };
+
+  /// Number of threads used for the computation. By default the number of processors is used
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_MAX_THREADS);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Count the voxels of all labelmaps and all pairwise intersections
+  /// \return Success flag
+  bool Update();
+
+  /// Get volume of one voxel (mm^3)
+  vtkGetMacro(VoxelVolumeMm3, double);
+
+  /// Get number of voxels in a reference labelmap
+  vtkIdType GetReferenceVoxelCount(int referenceIndex);
+  /// Get number of voxels in a compare labelmap
+  vtkIdType GetCompareVoxelCount(int compareIndex);
+  /// Get number of voxels that are in both a reference and a compare labelmap
+  vtkIdType GetIntersectionVoxelCount(int referenceIndex, int compareIndex);
+
+  /// Get Dice coefficient of a reference and a compare labelmap: 2|R*C| / (|R|+|C|)
+  double GetDiceCoefficient(int referenceIndex, int compareIndex);
+  /// Get Jaccard index of a reference and a compare labelmap: |R*C| / |R+C|
+  double GetJaccardIndex(int referenceIndex, int compareIndex);
+  /// Get number of voxels that are in the compare but not in the reference labelmap
+  vtkIdType GetFalsePositiveVoxelCount(int referenceIndex, int compareIndex);
+  /// Get number of voxels that are in the reference but not in the compare labelmap
+  vtkIdType GetFalseNegativeVoxelCount(int referenceIndex, int compareIndex);
+
+  /// Count voxels in a range of slices of the common extent. Called from the worker threads
+  void ThreadedCountSlices(int startSlice, int endSlice, int threadId);
+
+  /// Get number of slices in the common extent
+  int GetNumberOfSlices() { return this->CommonExtent[5] - this->CommonExtent[4] + 1; };
+
+protected:
+  /// Determine common extent and voxel volume, and check that the labelmaps are on the same lattice
+  bool InitializeCommonLattice();
+
+  /// Check labelmap indices and print error if invalid
+  bool IsValidPair(int referenceIndex, int compareIndex, const char* methodName);
+
+protected:
+  vtkLabelmapOverlapMatrix();
+  virtual ~vtkLabelmapOverlapMatrix();
+
+protected:
+  /// Reference labelmaps
+  std::vector< vtkSmartPointer<vtkImageData> > ReferenceLabelmaps;
+  /// Compare labelmaps
+  std::vector< vtkSmartPointer<vtkImageData> > CompareLabelmaps;
+  /// Number of threads
+  int NumberOfThreads;
+
+  /// Extent containing all labelmaps
+  int CommonExtent[6];
+  /// Volume of one voxel
+  double VoxelVolumeMm3;
+
+  /// Voxel counts of the reference labelmaps
+  std::vector<vtkIdType> ReferenceVoxelCounts;
+  /// Voxel counts of the compare labelmaps
+  std::vector<vtkIdType> CompareVoxelCounts;
+  /// Intersection voxel counts, row-major (reference index * number of compare labelmaps + compare index)
+  std::vector<vtkIdType> IntersectionVoxelCounts;
+
+  /// Per-thread reference voxel counts
+  std::vector<vtkIdType> ThreadReferenceVoxelCounts[VTK_MAX_THREADS];
+  /// Per-thread compare voxel counts
+  std::vector<vtkIdType> ThreadCompareVoxelCounts[VTK_MAX_THREADS];
+  /// Per-thread intersection voxel counts
+  std::vector<vtkIdType> ThreadIntersectionVoxelCounts[VTK_MAX_THREADS];
+
+  /// Multithreader counting the slices
+  vtkMultiThreader* Threader;
+
+private:
+  vtkLabelmapOverlapMatrix(const vtkLabelmapOverlapMatrix&); // Not implemented
+  void operator=(const vtkLabelmapOverlapMatrix&);           // Not implemented
+};
+
+#endif
@@ -42,6 +42,7 @@ static const char* COMPARE_SEGMENTATION_REFERENCE_ROLE = "compareSegmentationRef
 static const char* RASTERIZATION_REFERENCE_VOLUME_REFERENCE_ROLE = "rasterizationReferenceVolumeRef";
 static const char* DICE_TABLE_REFERENCE_ROLE = "diceTableRef";
 static const char* HAUSDORFF_TABLE_REFERENCE_ROLE = "hausdorffTableRef";
+static const char* OVERLAP_MATRIX_TABLE_REFERENCE_ROLE = "overlapMatrixTableRef";
 
 //------------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLSegmentComparisonNode);
@@ -70,6 +71,9 @@ vtkMRMLSegmentComparisonNode::vtkMRMLSegmentComparisonNode()
   this->Percent95HausdorffDistanceForVolumeMm = -1.0;
   this->Percent95HausdorffDistanceForBoundaryMm = -1.0;
   this->HausdorffResultsValidOff();
+  this->UseDistanceTransformForHausdorff = false;
+  this->SurfaceDiceToleranceMm = 1.0;
+  this->SurfaceDiceCoefficient = -1.0;
 
   this->HideFromEditors = false;
 }
@@ -132,6 +136,9 @@ void vtkMRMLSegmentComparisonNode::WriteXML(ostream& of, int nIndent)
   of << indent << " Percent95HausdorffDistanceForBoundaryMm=\"" << this->Percent95HausdorffDistanceForBoundaryMm << "\"";
 
   of << indent << " HausdorffResultsValid=\"" << (this->HausdorffResultsValid ? "true" : "false") << "\"";
+  of << indent << " UseDistanceTransformForHausdorff=\"" << (this->UseDistanceTransformForHausdorff ? "true" : "false") << "\"";
+  of << indent << " SurfaceDiceToleranceMm=\"" << this->SurfaceDiceToleranceMm << "\"";
+  of << indent << " SurfaceDiceCoefficient=\"" << this->SurfaceDiceCoefficient << "\"";
 }
 
 //----------------------------------------------------------------------------
@@ -248,6 +255,18 @@ void vtkMRMLSegmentComparisonNode::ReadXMLAttributes(const char** atts)
       {
       this->HausdorffResultsValid = (strcmp(attValue,"true") ? false : true);
       }
+    else if (!strcmp(attName, "UseDistanceTransformForHausdorff")) 
+      {
+      this->UseDistanceTransformForHausdorff = (strcmp(attValue,"true") ? false : true);
+      }
+    else if (!strcmp(attName, "SurfaceDiceToleranceMm")) 
+      {
+      this->SurfaceDiceToleranceMm = vtkVariant(attValue).ToDouble();
+      }
+    else if (!strcmp(attName, "SurfaceDiceCoefficient")) 
+      {
+      this->SurfaceDiceCoefficient = vtkVariant(attValue).ToDouble();
+      }
     }
 }
 
@@ -280,6 +299,9 @@ void vtkMRMLSegmentComparisonNode::Copy(vtkMRMLNode *anode)
   this->Percent95HausdorffDistanceForVolumeMm = node->Percent95HausdorffDistanceForVolumeMm;
   this->Percent95HausdorffDistanceForBoundaryMm = node->Percent95HausdorffDistanceForBoundaryMm;
   this->HausdorffResultsValid = node->HausdorffResultsValid;
+  this->UseDistanceTransformForHausdorff = node->UseDistanceTransformForHausdorff;
+  this->SurfaceDiceToleranceMm = node->SurfaceDiceToleranceMm;
+  this->SurfaceDiceCoefficient = node->SurfaceDiceCoefficient;
 
   this->DisableModifiedEventOff();
   this->InvokePendingModifiedEvent();
@@ -333,6 +355,9 @@ void vtkMRMLSegmentComparisonNode::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << " Percent95HausdorffDistanceForBoundaryMm:   " << this->Percent95HausdorffDistanceForBoundaryMm << "\n";
 
   os << indent << " HausdorffResultsValid:   " << (this->HausdorffResultsValid ? "true" : "false") << "\n";
+  os << indent << " UseDistanceTransformForHausdorff:   " << (this->UseDistanceTransformForHausdorff ? "true" : "false") << "\n";
+  os << indent << " SurfaceDiceToleranceMm:   " << this->SurfaceDiceToleranceMm << "\n";
+  os << indent << " SurfaceDiceCoefficient:   " << this->SurfaceDiceCoefficient << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -394,3 +419,15 @@ void vtkMRMLSegmentComparisonNode::SetAndObserveHausdorffTableNode(vtkMRMLTableN
 {
   this->SetNodeReferenceID(HAUSDORFF_TABLE_REFERENCE_ROLE, (node ? node->GetID() : NULL));
 }
+
+//----------------------------------------------------------------------------
+vtkMRMLTableNode* vtkMRMLSegmentComparisonNode::GetOverlapMatrixTableNode()
+{
+  return vtkMRMLTableNode::SafeDownCast( this->GetNodeReference(OVERLAP_MATRIX_TABLE_REFERENCE_ROLE) );
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLSegmentComparisonNode::SetAndObserveOverlapMatrixTableNode(vtkMRMLTableNode* node)
+{
+  this->SetNodeReferenceID(OVERLAP_MATRIX_TABLE_REFERENCE_ROLE, (node ? node->GetID() : NULL));
+}
@@ -80,6 +80,11 @@ public:
   /// Set Hausdorff table node
   void SetAndObserveHausdorffTableNode(vtkMRMLTableNode* node);
 
+  /// Get overlap matrix table node (overlap of all reference segments with all compare segments)
+  vtkMRMLTableNode* GetOverlapMatrixTableNode();
+  /// Set overlap matrix table node
+  void SetAndObserveOverlapMatrixTableNode(vtkMRMLTableNode* node);
+
   /// Get reference segment ID
   vtkGetStringMacro(ReferenceSegmentID);
   /// Set reference segment ID
@@ -175,6 +180,21 @@ public:
   vtkSetMacro(HausdorffResultsValid, bool);
   vtkBooleanMacro(HausdorffResultsValid, bool);
 
+  /// Get/Set flag whether the Hausdorff distances are computed using distance transforms instead of plastimatch
+  vtkGetMacro(UseDistanceTransformForHausdorff, bool);
+  vtkSetMacro(UseDistanceTransformForHausdorff, bool);
+  vtkBooleanMacro(UseDistanceTransformForHausdorff, bool);
+
+  /// Get tolerance of the surface Dice coefficient
+  vtkGetMacro(SurfaceDiceToleranceMm, double);
+  /// Set tolerance of the surface Dice coefficient
+  vtkSetMacro(SurfaceDiceToleranceMm, double);
+
+  /// Get surface Dice coefficient (only computed if distance transforms are used for the Hausdorff distances)
+  vtkGetMacro(SurfaceDiceCoefficient, double);
+  /// Set surface Dice coefficient
+  vtkSetMacro(SurfaceDiceCoefficient, double);
+
 protected:
   vtkMRMLSegmentComparisonNode();
   ~vtkMRMLSegmentComparisonNode();
@@ -238,6 +258,16 @@ protected:
 
   /// Flag telling whether the Hausdorff results are valid
   bool HausdorffResultsValid;
+
+  /// Flag telling whether the Hausdorff distances are computed using distance transforms (\sa vtkBinaryLabelmapDistanceMetrics).
+  /// Off by default, when plastimatch is used
+  bool UseDistanceTransformForHausdorff;
+
+  /// Tolerance of the surface Dice coefficient
+  double SurfaceDiceToleranceMm;
+
+  /// Surface Dice coefficient, i.e. fraction of the boundary voxels that are within tolerance from the other boundary
+  double SurfaceDiceCoefficient;
 };
 
 #endif
@@ -8,11 +8,16 @@
 #include <vtkDataObject.h>
 #include <vtkSmartPointer.h>
 #include <vtkPolyDataPointSampler.h>
-#include <vtkImplicitPolyDataDistance.h>
-#include <vtkImageData.h>
-#include <vtkImageAccumulate.h>
+#include <vtkTriangleFilter.h>
+#include <vtkPolyDataNormals.h>
+#include <vtkCellArray.h>
+#include <vtkPoints.h>
 #include <vtkIntArray.h>
-#include <vtkSortDataArray.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 
 vtkStandardNewMacro(vtkPolyDataDistanceHistogramFilter);
 
@@ -22,21 +27,283 @@ const int vtkPolyDataDistanceHistogramFilter::INPUT_PORT_COMPARE_POLYDATA = 1;
 const int vtkPolyDataDistanceHistogramFilter::OUTPUT_PORT_HISTOGRAM = 0;
 //const int vtkPolyDataDistanceHistogramFilter::OUTPUT_PORT_DISTANCES = 1;
 
+namespace
+{
+  //----------------------------------------------------------------------------
+  /// State of the closest point search for one sample point
+  struct DistanceQuery
+  {
+    /// Sample point
+    double Point[3];
+    /// Squared distance to the closest triangle found so far
+    double BestSquaredDistance;
+    /// Dot product of the vector from the closest point to the sample point and the normal of the closest triangle
+    double BestNormalDot;
+    /// Query number each triangle was last tested in (per thread)
+    std::vector<unsigned int>* VisitStamps;
+    /// Number of the current query
+    unsigned int Stamp;
+  };
+
+  //----------------------------------------------------------------------------
+  /// Find the point of a triangle closest to a point (see Ericson: Real-Time Collision Detection, 5.1.5)
+  void ClosestPointOnTriangle(const double p[3], const double* a, const double* b, const double* c, double closest[3])
+  {
+    double ab[3] = { b[0]-a[0], b[1]-a[1], b[2]-a[2] };
+    double ac[3] = { c[0]-a[0], c[1]-a[1], c[2]-a[2] };
+    double ap[3] = { p[0]-a[0], p[1]-a[1], p[2]-a[2] };
+    double d1 = ab[0]*ap[0] + ab[1]*ap[1] + ab[2]*ap[2];
+    double d2 = ac[0]*ap[0] + ac[1]*ap[1] + ac[2]*ap[2];
+    if (d1 <= 0.0 && d2 <= 0.0)
+    {
+      closest[0] = a[0]; closest[1] = a[1]; closest[2] = a[2];
+      return;
+    }
+
+    double bp[3] = { p[0]-b[0], p[1]-b[1], p[2]-b[2] };
+    double d3 = ab[0]*bp[0] + ab[1]*bp[1] + ab[2]*bp[2];
+    double d4 = ac[0]*bp[0] + ac[1]*bp[1] + ac[2]*bp[2];
+    if (d3 >= 0.0 && d4 <= d3)
+    {
+      closest[0] = b[0]; closest[1] = b[1]; closest[2] = b[2];
+      return;
+    }
+
+    double vc = d1*d4 - d3*d2;
+    if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+    {
+      double v = d1 / (d1 - d3);
+      closest[0] = a[0] + v*ab[0]; closest[1] = a[1] + v*ab[1]; closest[2] = a[2] + v*ab[2];
+      return;
+    }
+
+    double cp[3] = { p[0]-c[0], p[1]-c[1], p[2]-c[2] };
+    double d5 = ab[0]*cp[0] + ab[1]*cp[1] + ab[2]*cp[2];
+    double d6 = ac[0]*cp[0] + ac[1]*cp[1] + ac[2]*cp[2];
+    if (d6 >= 0.0 && d5 <= d6)
+    {
+      closest[0] = c[0]; closest[1] = c[1]; closest[2] = c[2];
+      return;
+    }
+
+    double vb = d5*d2 - d1*d6;
+    if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+    {
+      double w = d2 / (d2 - d6);
+      closest[0] = a[0] + w*ac[0]; closest[1] = a[1] + w*ac[1]; closest[2] = a[2] + w*ac[2];
+      return;
+    }
+
+    double va = d3*d6 - d5*d4;
+    if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+    {
+      double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+      closest[0] = b[0] + w*(c[0]-b[0]); closest[1] = b[1] + w*(c[1]-b[1]); closest[2] = b[2] + w*(c[2]-b[2]);
+      return;
+    }
+
+    double denominator = 1.0 / (va + vb + vc);
+    double v = vb * denominator;
+    double w = vc * denominator;
+    closest[0] = a[0] + ab[0]*v + ac[0]*w;
+    closest[1] = a[1] + ab[1]*v + ac[1]*w;
+    closest[2] = a[2] + ab[2]*v + ac[2]*w;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Test the triangles of a bucket against the current closest triangle of the query
+  void VisitBucket(const vtkPolyDataDistanceHistogramFilter::SurfaceLocator& locator, int i, int j, int k, DistanceQuery& query)
+  {
+    // Skip bucket if it cannot contain a closer triangle
+    int bucketIndex[3] = { i, j, k };
+    double bucketSquaredDistance = 0.0;
+    for (int axis=0; axis<3; ++axis)
+    {
+      double bucketMin = locator.Origin[axis] + bucketIndex[axis] * locator.BucketSize;
+      double axisDistance = std::max(0.0, std::max(bucketMin - query.Point[axis], query.Point[axis] - bucketMin - locator.BucketSize));
+      bucketSquaredDistance += axisDistance * axisDistance;
+    }
+    if (bucketSquaredDistance >= query.BestSquaredDistance)
+    {
+      return;
+    }
+
+    vtkIdType bucketId = i + locator.Dimensions[0] * (j + (vtkIdType)locator.Dimensions[1] * k);
+    std::vector<unsigned int>& visitStamps = *query.VisitStamps;
+    for (vtkIdType entry = locator.BucketOffsets[bucketId]; entry < locator.BucketOffsets[bucketId+1]; ++entry)
+    {
+      vtkIdType triangleIndex = locator.BucketTriangles[entry];
+      if (visitStamps[triangleIndex] == query.Stamp)
+      {
+        continue; // Triangle spans multiple buckets and has already been tested
+      }
+      visitStamps[triangleIndex] = query.Stamp;
+
+      const double* corners = &locator.TriangleCorners[9*triangleIndex];
+      double closest[3] = {0.0, 0.0, 0.0};
+      ClosestPointOnTriangle(query.Point, corners, corners+3, corners+6, closest);
+      double offset[3] = { query.Point[0]-closest[0], query.Point[1]-closest[1], query.Point[2]-closest[2] };
+      double squaredDistance = offset[0]*offset[0] + offset[1]*offset[1] + offset[2]*offset[2];
+
+      // If the closest point is shared by multiple triangles (edge or vertex), use the triangle the
+      // sample point is the most in front of or behind, so that the sign is determined robustly
+      double tolerance = 1.0e-10 * query.BestSquaredDistance;
+      if (squaredDistance > query.BestSquaredDistance + tolerance)
+      {
+        continue;
+      }
+      const double* normal = &locator.TriangleNormals[3*triangleIndex];
+      double normalDot = offset[0]*normal[0] + offset[1]*normal[1] + offset[2]*normal[2];
+      if (squaredDistance < query.BestSquaredDistance - tolerance || fabs(normalDot) > fabs(query.BestNormalDot))
+      {
+        query.BestSquaredDistance = squaredDistance;
+        query.BestNormalDot = normalDot;
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Compute signed distance of a point from the surface binned in the locator (negative behind the triangles).
+  /// Buckets are searched in shells of increasing radius around the bucket of the point until no closer
+  /// triangle can be found outside the searched region.
+  double ComputeSignedDistance(const vtkPolyDataDistanceHistogramFilter::SurfaceLocator& locator, const double point[3],
+    std::vector<unsigned int>& visitStamps, unsigned int& stamp)
+  {
+    if (++stamp == 0)
+    {
+      // Query counter wrapped around, reset stamps
+      std::fill(visitStamps.begin(), visitStamps.end(), 0);
+      stamp = 1;
+    }
+
+    DistanceQuery query;
+    query.Point[0] = point[0]; query.Point[1] = point[1]; query.Point[2] = point[2];
+    query.BestSquaredDistance = VTK_DOUBLE_MAX;
+    query.BestNormalDot = 0.0;
+    query.VisitStamps = &visitStamps;
+    query.Stamp = stamp;
+
+    int center[3] = {0, 0, 0};
+    for (int axis=0; axis<3; ++axis)
+    {
+      int index = (int)floor((point[axis] - locator.Origin[axis]) / locator.BucketSize);
+      center[axis] = std::max(0, std::min(index, locator.Dimensions[axis]-1));
+    }
+
+    for (int radius=0; ; ++radius)
+    {
+      int lower[3] = {0, 0, 0};
+      int upper[3] = {0, 0, 0};
+      bool shellCoversGrid = true;
+      for (int axis=0; axis<3; ++axis)
+      {
+        lower[axis] = std::max(center[axis] - radius, 0);
+        upper[axis] = std::min(center[axis] + radius, locator.Dimensions[axis] - 1);
+        if (lower[axis] > 0 || upper[axis] < locator.Dimensions[axis] - 1)
+        {
+          shellCoversGrid = false;
+        }
+      }
+
+      // Visit the buckets on the surface of the cube of the current radius
+      for (int k=lower[2]; k<=upper[2]; ++k)
+      {
+        bool kOnShell = (abs(k - center[2]) == radius);
+        for (int j=lower[1]; j<=upper[1]; ++j)
+        {
+          if (kOnShell || abs(j - center[1]) == radius)
+          {
+            for (int i=lower[0]; i<=upper[0]; ++i)
+            {
+              VisitBucket(locator, i, j, k, query);
+            }
+          }
+          else
+          {
+            if (center[0] - radius >= 0)
+            {
+              VisitBucket(locator, center[0] - radius, j, k, query);
+            }
+            if (center[0] + radius < locator.Dimensions[0])
+            {
+              VisitBucket(locator, center[0] + radius, j, k, query);
+            }
+          }
+        }
+      }
+
+      if (shellCoversGrid)
+      {
+        break;
+      }
+
+      // Distance of the point from any bucket outside the searched cube
+      double lowerBound = VTK_DOUBLE_MAX;
+      for (int axis=0; axis<3; ++axis)
+      {
+        if (lower[axis] > 0)
+        {
+          lowerBound = std::min(lowerBound, std::max(0.0, point[axis] - (locator.Origin[axis] + lower[axis] * locator.BucketSize)));
+        }
+        if (upper[axis] < locator.Dimensions[axis] - 1)
+        {
+          lowerBound = std::min(lowerBound, std::max(0.0, locator.Origin[axis] + (upper[axis] + 1) * locator.BucketSize - point[axis]));
+        }
+      }
+      if (query.BestSquaredDistance <= lowerBound * lowerBound)
+      {
+        break;
+      }
+    }
+
+    double distance = sqrt(query.BestSquaredDistance);
+    return (query.BestNormalDot < 0.0 ? -distance : distance);
+  }
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE ComputeDistancesThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    vtkPolyDataDistanceHistogramFilter* self = static_cast<vtkPolyDataDistanceHistogramFilter*>(threadInfo->UserData);
+
+    vtkIdType numberOfSamplePoints = self->GetNumberOfSamplePoints();
+    vtkIdType pointsPerThread = (numberOfSamplePoints + threadInfo->NumberOfThreads - 1) / threadInfo->NumberOfThreads;
+    vtkIdType startIndex = threadInfo->ThreadID * pointsPerThread;
+    vtkIdType endIndex = std::min(startIndex + pointsPerThread, numberOfSamplePoints);
+    if (startIndex < endIndex)
+    {
+      self->ThreadedComputeDistances(startIndex, endIndex, threadInfo->ThreadID);
+    }
+
+    return VTK_THREAD_RETURN_VALUE;
+  }
+}
+
 //----------------------------------------------------------------------------
 vtkPolyDataDistanceHistogramFilter::vtkPolyDataDistanceHistogramFilter()
   : OutputDistances(NULL)
+  , OutputReverseDistances(NULL)
   , SamplePolyDataVertices(1)
   , SamplePolyDataEdges(0)
   , SamplePolyDataFaces(0)
   , SamplingDistance(0.01)
+  , SymmetricDistance(0)
   , HistogramMinimum(-10.0)
   , HistogramMaximum(10.0)
   , HistogramSpacing(0.2)
+  , MaximumDistance(0.0)
+  , AverageDistance(0.0)
 {
   this->InputComparePolyData = vtkPolyData::New();
   this->InputReferencePolyData = vtkPolyData::New();
   this->OutputHistogram = vtkTable::New();
   this->OutputDistances = vtkDoubleArray::New();
+  this->OutputReverseDistances = vtkDoubleArray::New();
+  this->CompareSamplePoints = vtkPoints::New();
+  this->ReferenceSamplePoints = vtkPoints::New();
+
+  this->Threader = vtkMultiThreader::New();
+  this->NumberOfThreads = this->Threader->GetNumberOfThreads();
 
   //this->SetNumberOfInputPorts(2);
   //this->SetNumberOfOutputPorts(1); // See below why not 2
@@ -65,6 +332,26 @@ vtkPolyDataDistanceHistogramFilter::~vtkPolyDataDistanceHistogramFilter()
     this->OutputDistances->Delete();
     this->OutputDistances = NULL;
   }
+  if (this->OutputReverseDistances)
+  {
+    this->OutputReverseDistances->Delete();
+    this->OutputReverseDistances = NULL;
+  }
+  if (this->CompareSamplePoints)
+  {
+    this->CompareSamplePoints->Delete();
+    this->CompareSamplePoints = NULL;
+  }
+  if (this->ReferenceSamplePoints)
+  {
+    this->ReferenceSamplePoints->Delete();
+    this->ReferenceSamplePoints = NULL;
+  }
+  if (this->Threader)
+  {
+    this->Threader->Delete();
+    this->Threader = NULL;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -101,6 +388,12 @@ vtkDoubleArray* vtkPolyDataDistanceHistogramFilter::GetOutputDistances()
   return this->OutputDistances;
 }
 
+//----------------------------------------------------------------------------
+vtkDoubleArray* vtkPolyDataDistanceHistogramFilter::GetOutputReverseDistances()
+{
+  return this->OutputReverseDistances;
+}
+
 //----------------------------------------------------------------------------
 vtkTable* vtkPolyDataDistanceHistogramFilter::GetOutputHistogram()
 {
@@ -108,54 +401,61 @@ vtkTable* vtkPolyDataDistanceHistogramFilter::GetOutputHistogram()
   return this->OutputHistogram;
 }
 
+//----------------------------------------------------------------------------
+vtkIdType vtkPolyDataDistanceHistogramFilter::GetNumberOfSamplePoints()
+{
+  return this->OutputDistances->GetNumberOfTuples() + this->OutputReverseDistances->GetNumberOfTuples();
+}
+
 //----------------------------------------------------------------------------
 double vtkPolyDataDistanceHistogramFilter::GetMaximumHausdorffDistance()
 {
-  if (!this->OutputDistances)
+  if (this->GetNumberOfSamplePoints() == 0)
   {
     vtkErrorMacro("GetMaximumHausdorffDistance: Output distances has not been created! Need to call Update after setting the inputs.");
     return 0.0;
   }
 
-  return this->OutputDistances->GetMaxNorm();
+  return this->MaximumDistance;
 }
   
 //----------------------------------------------------------------------------
 double vtkPolyDataDistanceHistogramFilter::GetAverageHausdorffDistance()
 {
-  if (!this->OutputDistances)
+  if (this->GetNumberOfSamplePoints() == 0)
   {
     vtkErrorMacro("GetAverageHausdorffDistance: Output distances has not been created! Need to call Update after setting the inputs.");
     return 0.0;
   }
 
-  double sum = 0.0;
-  for (int i=0; i<this->OutputDistances->GetNumberOfValues(); ++i)
-  {
-    sum += this->OutputDistances->GetValue(i);
-  }
-
-  return sum / (double)this->OutputDistances->GetNumberOfValues();
+  return this->AverageDistance;
 }
   
 //----------------------------------------------------------------------------
 double vtkPolyDataDistanceHistogramFilter::GetPercent95HausdorffDistance()
 {
-  if (!this->OutputDistances)
+  vtkIdType numberOfSamplePoints = this->GetNumberOfSamplePoints();
+  if (numberOfSamplePoints == 0)
   {
     vtkErrorMacro("GetPercent95HausdorffDistance: Output distances has not been created! Need to call Update after setting the inputs.");
     return 0.0;
   }
 
-  vtkSmartPointer<vtkDoubleArray> sortedDistances = vtkSmartPointer<vtkDoubleArray>::New();
-  sortedDistances->DeepCopy(this->OutputDistances);
-
-  vtkSmartPointer<vtkSortDataArray> sortDataArray = vtkSmartPointer<vtkSortDataArray>::New();
-  sortDataArray->Sort(sortedDistances);
+  std::vector<double> absoluteDistances;
+  absoluteDistances.reserve(numberOfSamplePoints);
+  vtkDoubleArray* distanceArrays[2] = { this->OutputDistances, this->OutputReverseDistances };
+  for (int arrayIndex=0; arrayIndex<2; ++arrayIndex)
+  {
+    for (vtkIdType i=0; i<distanceArrays[arrayIndex]->GetNumberOfTuples(); ++i)
+    {
+      absoluteDistances.push_back(fabs(distanceArrays[arrayIndex]->GetValue(i)));
+    }
+  }
 
-  double percentile95thDistance = sortedDistances->GetValue(
-    (int)(0.95 * (double)(sortedDistances->GetNumberOfValues()) + 0.5) );
-  return percentile95thDistance;
+  // Only the element at the percentile position needs to be in place, no need for a full sort
+  vtkIdType percentileIndex = std::min( (vtkIdType)(0.95 * (double)numberOfSamplePoints + 0.5), numberOfSamplePoints - 1 );
+  std::nth_element(absoluteDistances.begin(), absoluteDistances.begin() + percentileIndex, absoluteDistances.end());
+  return absoluteDistances[percentileIndex];
 }
 
 //----------------------------------------------------------------------------
@@ -188,34 +488,231 @@ double vtkPolyDataDistanceHistogramFilter::GetPercent95HausdorffDistance()
 //}
 
 //----------------------------------------------------------------------------
-void vtkPolyDataDistanceHistogramFilter::ComputeDistances(vtkPolyData* referencePolyData, vtkPolyData* comparePolyData, vtkDoubleArray* distanceArray)
+void vtkPolyDataDistanceHistogramFilter::GenerateSamplePoints(vtkPolyData* polyData, vtkPoints* samplePoints)
 {
-  //TODO: Revise the role of reference and compare
-
-  // generate the points at which to sample the distance
   vtkSmartPointer<vtkPolyDataPointSampler> pointSampler = vtkSmartPointer<vtkPolyDataPointSampler>::New();
   pointSampler->SetGenerateVertexPoints(this->SamplePolyDataVertices);
   pointSampler->SetGenerateEdgePoints(this->SamplePolyDataEdges);
   pointSampler->SetGenerateInteriorPoints(this->SamplePolyDataFaces);
   pointSampler->SetDistance(this->SamplingDistance);
-  pointSampler->SetInputData(comparePolyData);
+  pointSampler->SetInputData(polyData);
   pointSampler->Update();  
-  vtkPoints* samplingPoints = pointSampler->GetOutput()->GetPoints();
-  
-  // generate the distance field
-  vtkSmartPointer<vtkImplicitPolyDataDistance> distanceField = vtkSmartPointer<vtkImplicitPolyDataDistance>::New();
-  distanceField->SetInput(referencePolyData);
   
-  int numPoints = samplingPoints->GetNumberOfPoints();
-  for (int i = 0; i < numPoints; i++)
+  samplePoints->Reset();
+  if (pointSampler->GetOutput()->GetPoints())
   {
-    double samplePoint[3];
-    samplingPoints->GetPoint(i,samplePoint);
-    double newDistance = distanceField->EvaluateFunction(samplePoint);
-    distanceArray->InsertNextTuple1(newDistance);
+    samplePoints->DeepCopy(pointSampler->GetOutput()->GetPoints());
   }
 }
 
+//----------------------------------------------------------------------------
+void vtkPolyDataDistanceHistogramFilter::BuildSurfaceLocator(vtkPolyData* polyData, SurfaceLocator& locator)
+{
+  locator.TriangleCorners.clear();
+  locator.TriangleNormals.clear();
+  locator.BucketOffsets.clear();
+  locator.BucketTriangles.clear();
+  if (!polyData)
+  {
+    return;
+  }
+
+  // Triangulate the surface and make the orientation of the triangles consistent (as in vtkImplicitPolyDataDistance)
+  vtkSmartPointer<vtkTriangleFilter> triangleFilter = vtkSmartPointer<vtkTriangleFilter>::New();
+  triangleFilter->SetInputData(polyData);
+  triangleFilter->PassVertsOff();
+  triangleFilter->PassLinesOff();
+  vtkSmartPointer<vtkPolyDataNormals> normalFilter = vtkSmartPointer<vtkPolyDataNormals>::New();
+  normalFilter->SetInputConnection(triangleFilter->GetOutputPort());
+  normalFilter->ComputePointNormalsOff();
+  normalFilter->ComputeCellNormalsOn();
+  normalFilter->SplittingOff();
+  normalFilter->ConsistencyOn();
+  normalFilter->AutoOrientNormalsOff();
+  normalFilter->Update();
+  vtkPolyData* surface = normalFilter->GetOutput();
+
+  // Collect triangle corners and normals, skipping degenerate triangles
+  double bounds[6] = { VTK_DOUBLE_MAX, VTK_DOUBLE_MIN, VTK_DOUBLE_MAX, VTK_DOUBLE_MIN, VTK_DOUBLE_MAX, VTK_DOUBLE_MIN };
+  vtkCellArray* polys = surface->GetPolys();
+  locator.TriangleCorners.reserve(9 * polys->GetNumberOfCells());
+  locator.TriangleNormals.reserve(3 * polys->GetNumberOfCells());
+  vtkIdType numberOfCellPoints = 0;
+  vtkIdType* cellPointIds = NULL;
+  for (polys->InitTraversal(); polys->GetNextCell(numberOfCellPoints, cellPointIds); )
+  {
+    if (numberOfCellPoints != 3)
+    {
+      continue;
+    }
+    double corners[3][3];
+    for (int corner=0; corner<3; ++corner)
+    {
+      surface->GetPoint(cellPointIds[corner], corners[corner]);
+    }
+    double normal[3] = {0.0, 0.0, 0.0};
+    double ab[3] = { corners[1][0]-corners[0][0], corners[1][1]-corners[0][1], corners[1][2]-corners[0][2] };
+    double ac[3] = { corners[2][0]-corners[0][0], corners[2][1]-corners[0][1], corners[2][2]-corners[0][2] };
+    normal[0] = ab[1]*ac[2] - ab[2]*ac[1];
+    normal[1] = ab[2]*ac[0] - ab[0]*ac[2];
+    normal[2] = ab[0]*ac[1] - ab[1]*ac[0];
+    double normalLength = sqrt(normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2]);
+    if (normalLength == 0.0)
+    {
+      continue;
+    }
+    for (int corner=0; corner<3; ++corner)
+    {
+      for (int axis=0; axis<3; ++axis)
+      {
+        locator.TriangleCorners.push_back(corners[corner][axis]);
+        bounds[2*axis] = std::min(bounds[2*axis], corners[corner][axis]);
+        bounds[2*axis+1] = std::max(bounds[2*axis+1], corners[corner][axis]);
+      }
+    }
+    for (int axis=0; axis<3; ++axis)
+    {
+      locator.TriangleNormals.push_back(normal[axis] / normalLength);
+    }
+  }
+
+  vtkIdType numberOfTriangles = (vtkIdType)locator.TriangleNormals.size() / 3;
+  if (numberOfTriangles == 0)
+  {
+    return;
+  }
+
+  // Choose bucket size so that there is about one bucket per triangle
+  double size[3] = {0.0, 0.0, 0.0};
+  double diagonal = sqrt( (bounds[1]-bounds[0])*(bounds[1]-bounds[0]) + (bounds[3]-bounds[2])*(bounds[3]-bounds[2])
+    + (bounds[5]-bounds[4])*(bounds[5]-bounds[4]) );
+  double padding = std::max(1.0e-6 * diagonal, 1.0e-6);
+  for (int axis=0; axis<3; ++axis)
+  {
+    locator.Origin[axis] = bounds[2*axis] - padding;
+    size[axis] = bounds[2*axis+1] - bounds[2*axis] + 2.0 * padding;
+  }
+  locator.BucketSize = pow(size[0] * size[1] * size[2] / (double)numberOfTriangles, 1.0/3.0);
+  while (true)
+  {
+    double numberOfBuckets = 1.0;
+    for (int axis=0; axis<3; ++axis)
+    {
+      locator.Dimensions[axis] = std::max(1, (int)ceil(size[axis] / locator.BucketSize));
+      numberOfBuckets *= locator.Dimensions[axis];
+    }
+    // Flat surfaces would get too many buckets along their extent
+    if (numberOfBuckets <= 4.0 * numberOfTriangles + 8.0)
+    {
+      break;
+    }
+    locator.BucketSize *= 1.5;
+  }
+
+  // Bin the triangles by their bounding box: count first, then fill
+  vtkIdType numberOfBuckets = (vtkIdType)locator.Dimensions[0] * locator.Dimensions[1] * locator.Dimensions[2];
+  std::vector<int> triangleBucketRanges(6 * numberOfTriangles, 0);
+  locator.BucketOffsets.assign(numberOfBuckets + 1, 0);
+  for (int pass=0; pass<2; ++pass)
+  {
+    if (pass == 1)
+    {
+      // Convert counts to offsets
+      for (vtkIdType bucketId=0; bucketId<numberOfBuckets; ++bucketId)
+      {
+        locator.BucketOffsets[bucketId+1] += locator.BucketOffsets[bucketId];
+      }
+      locator.BucketTriangles.resize(locator.BucketOffsets[numberOfBuckets]);
+    }
+    std::vector<vtkIdType> fillPositions;
+    if (pass == 1)
+    {
+      fillPositions.assign(locator.BucketOffsets.begin(), locator.BucketOffsets.end() - 1);
+    }
+
+    for (vtkIdType triangleIndex=0; triangleIndex<numberOfTriangles; ++triangleIndex)
+    {
+      int* range = &triangleBucketRanges[6*triangleIndex];
+      if (pass == 0)
+      {
+        const double* corners = &locator.TriangleCorners[9*triangleIndex];
+        for (int axis=0; axis<3; ++axis)
+        {
+          double triangleMin = std::min(corners[axis], std::min(corners[3+axis], corners[6+axis]));
+          double triangleMax = std::max(corners[axis], std::max(corners[3+axis], corners[6+axis]));
+          range[2*axis] = std::max(0, std::min(locator.Dimensions[axis]-1, (int)floor((triangleMin - locator.Origin[axis]) / locator.BucketSize)));
+          range[2*axis+1] = std::max(0, std::min(locator.Dimensions[axis]-1, (int)floor((triangleMax - locator.Origin[axis]) / locator.BucketSize)));
+        }
+      }
+      for (int k=range[4]; k<=range[5]; ++k)
+      {
+        for (int j=range[2]; j<=range[3]; ++j)
+        {
+          for (int i=range[0]; i<=range[1]; ++i)
+          {
+            vtkIdType bucketId = i + locator.Dimensions[0] * (j + (vtkIdType)locator.Dimensions[1] * k);
+            if (pass == 0)
+            {
+              ++locator.BucketOffsets[bucketId+1];
+            }
+            else
+            {
+              locator.BucketTriangles[fillPositions[bucketId]++] = triangleIndex;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPolyDataDistanceHistogramFilter::ThreadedComputeDistances(vtkIdType startIndex, vtkIdType endIndex, int threadId)
+{
+  vtkIdType numberOfCompareSamplePoints = this->OutputDistances->GetNumberOfTuples();
+  double* distances = this->OutputDistances->GetPointer(0);
+  double* reverseDistances = this->OutputReverseDistances->GetPointer(0);
+
+  // Each thread has its own visit stamps, the locators are shared
+  std::vector<unsigned int> referenceVisitStamps(this->ReferenceLocator.TriangleNormals.size() / 3, 0);
+  std::vector<unsigned int> compareVisitStamps(this->CompareLocator.TriangleNormals.size() / 3, 0);
+  unsigned int referenceStamp = 0;
+  unsigned int compareStamp = 0;
+
+  std::vector<vtkIdType>& frequencies = this->ThreadFrequencies[threadId];
+  int numberOfBins = (int)frequencies.size();
+  double maximumDistance = 0.0;
+  double distanceSum = 0.0;
+
+  double samplePoint[3] = {0.0, 0.0, 0.0};
+  for (vtkIdType index=startIndex; index<endIndex; ++index)
+  {
+    double distance = 0.0;
+    if (index < numberOfCompareSamplePoints)
+    {
+      this->CompareSamplePoints->GetPoint(index, samplePoint);
+      distance = ComputeSignedDistance(this->ReferenceLocator, samplePoint, referenceVisitStamps, referenceStamp);
+      distances[index] = distance;
+    }
+    else
+    {
+      this->ReferenceSamplePoints->GetPoint(index - numberOfCompareSamplePoints, samplePoint);
+      distance = ComputeSignedDistance(this->CompareLocator, samplePoint, compareVisitStamps, compareStamp);
+      reverseDistances[index - numberOfCompareSamplePoints] = distance;
+    }
+
+    int bin = (int)floor((distance - this->HistogramMinimum) / this->HistogramSpacing);
+    if (bin >= 0 && bin < numberOfBins)
+    {
+      ++frequencies[bin];
+    }
+    maximumDistance = std::max(maximumDistance, fabs(distance));
+    distanceSum += fabs(distance);
+  }
+
+  this->ThreadMaximumDistance[threadId] = maximumDistance;
+  this->ThreadDistanceSum[threadId] = distanceSum;
+}
 
 //----------------------------------------------------------------------------
 // DO NOT run anything in this function within the pipeline. This function
@@ -224,65 +721,85 @@ void vtkPolyDataDistanceHistogramFilter::ComputeDistances(vtkPolyData* reference
 //----------------------------------------------------------------------------
 void vtkPolyDataDistanceHistogramFilter::Update()
 {
-  // get the input data objects
-  vtkPolyData* inputPolyDataReference = this->GetInputReferencePolyData();
-  vtkPolyData* inputPolyDataCompare = this->GetInputComparePolyData();
+  this->OutputDistances->Reset();
+  this->OutputReverseDistances->Reset();
+  this->OutputHistogram->Initialize();
+  this->MaximumDistance = 0.0;
+  this->AverageDistance = 0.0;
 
-  vtkSmartPointer<vtkDoubleArray> distances = vtkSmartPointer<vtkDoubleArray>::New(); // hold the distances in this array until we copy to the output
-  this->ComputeDistances(inputPolyDataReference, inputPolyDataCompare, distances);
+  if (this->HistogramSpacing <= 0.0 || this->HistogramMaximum <= this->HistogramMinimum)
+  {
+    vtkErrorMacro("Update: Invalid histogram range or spacing!");
+    return;
+  }
   
-  // copy the distances into a dummy image
-  vtkSmartPointer<vtkImageData> dummyImage = vtkSmartPointer<vtkImageData>::New();
-  int N = distances->GetNumberOfTuples();
-  dummyImage->SetDimensions(N,1,1);
-  dummyImage->AllocateScalars(VTK_DOUBLE,1);
-  vtkDataArray* dummyDataArray;
-  double* sourcePtr = static_cast<double*>(distances->GetVoidPointer(0));
-  double* targetPtr = static_cast<double*>(dummyImage->GetScalarPointer());
-  memcpy(targetPtr,sourcePtr,N);
-
-  // set up the image accumulator for building the histogram
-  vtkSmartPointer<vtkImageAccumulate> imageAccumulator = vtkSmartPointer<vtkImageAccumulate>::New();
-  imageAccumulator->SetInputData(dummyImage);
-  double histogramBinMinimumArray[3] = {this->HistogramMinimum, 0.0, 0.0}; // the first component contains the minimum, other values are unused
-  imageAccumulator->SetComponentOrigin(histogramBinMinimumArray);
-  double histogramBinSpacingArray[3] = {this->HistogramSpacing, 1.0, 1.0}; // the first component contains the spacing, other values are unused
-  imageAccumulator->SetComponentSpacing(histogramBinSpacingArray);
-  int histogramBinExtent = (this->HistogramMaximum - this->HistogramMinimum) / this->HistogramSpacing;
-  int histogramBinExtentArray[6] = {0, histogramBinExtent, 0, 1, 0, 1}; // the first and second values contain the extent, others are unused
-  imageAccumulator->SetComponentExtent(histogramBinExtentArray);
-  imageAccumulator->Update();
-
-  // create the bin array
-  vtkSmartPointer<vtkDoubleArray> bins = vtkSmartPointer<vtkDoubleArray>::New();
-  bins->SetName("Bins");
-  for (int i = 0; i < histogramBinExtent; i++)
+  // Generate the points at which to sample the distance, and bin the triangles of the surfaces they are measured from
+  this->GenerateSamplePoints(this->GetInputComparePolyData(), this->CompareSamplePoints);
+  this->BuildSurfaceLocator(this->GetInputReferencePolyData(), this->ReferenceLocator);
+  if (this->SymmetricDistance)
   {
-    double newBinValue = this->HistogramMinimum + (i * this->HistogramSpacing);
-    bins->InsertNextTuple1(newBinValue);
+    this->GenerateSamplePoints(this->GetInputReferencePolyData(), this->ReferenceSamplePoints);
+    this->BuildSurfaceLocator(this->GetInputComparePolyData(), this->CompareLocator);
+  }
+  else
+  {
+    this->ReferenceSamplePoints->Reset();
+    this->BuildSurfaceLocator(NULL, this->CompareLocator); // Clear
+  }
+  if ( this->ReferenceLocator.TriangleNormals.empty()
+    || (this->SymmetricDistance && this->CompareLocator.TriangleNormals.empty()) )
+  {
+    vtkErrorMacro("Update: Input poly data does not contain any surface!");
+    return;
   }
 
-  // create the frequencies array
-  vtkImageData* frequencyImage = imageAccumulator->GetOutput();
-  vtkSmartPointer<vtkIntArray> frequencies = vtkSmartPointer<vtkIntArray>::New();
-  frequencies->SetName("Frequencies");
-  for (int i = 0; i < histogramBinExtent; i++)
+  // Preallocate the outputs so that the threads can write the distances directly
+  this->OutputDistances->SetNumberOfComponents(1);
+  this->OutputDistances->SetNumberOfTuples(this->CompareSamplePoints->GetNumberOfPoints());
+  this->OutputReverseDistances->SetNumberOfComponents(1);
+  this->OutputReverseDistances->SetNumberOfTuples(this->ReferenceSamplePoints->GetNumberOfPoints());
+
+  int numberOfBins = (int)((this->HistogramMaximum - this->HistogramMinimum) / this->HistogramSpacing);
+  for (int threadId=0; threadId<VTK_MAX_THREADS; ++threadId)
   {
-    int newFrequencyValue = (int)(frequencyImage->GetScalarComponentAsDouble(i,0,0,0) + 0.5);
-    frequencies->InsertNextTuple1(newFrequencyValue);
+    this->ThreadFrequencies[threadId].assign(threadId < this->NumberOfThreads ? numberOfBins : 0, 0);
+    this->ThreadMaximumDistance[threadId] = 0.0;
+    this->ThreadDistanceSum[threadId] = 0.0;
   }
 
-  // combine the bins and frequencies into a histogram
-  vtkSmartPointer<vtkTable> histogram = vtkSmartPointer<vtkTable>::New();
-  histogram->AddColumn(bins);
-  histogram->AddColumn(frequencies);
+  this->Threader->SetNumberOfThreads(this->NumberOfThreads);
+  this->Threader->SetSingleMethod(ComputeDistancesThreadFunction, this);
+  this->Threader->SingleMethodExecute();
 
-  // output the distances
-  //vtkInformation* outputInfoDistances = outputVector->GetInformationObject(OUTPUT_PORT_DISTANCES);
-  //vtkDoubleArray* outputDistances = vtkDoubleArray::SafeDownCast(outputInfoHistogram->Get(vtkDataObject::DATA_OBJECT()));
-  //outputDistances->DeepCopy(distances);
-  this->OutputDistances->DeepCopy(distances);
+  // Merge the results of the threads
+  std::vector<vtkIdType> frequencySums(numberOfBins, 0);
+  double distanceSum = 0.0;
+  for (int threadId=0; threadId<this->NumberOfThreads; ++threadId)
+  {
+    for (int bin=0; bin<numberOfBins; ++bin)
+    {
+      frequencySums[bin] += this->ThreadFrequencies[threadId][bin];
+    }
+    this->MaximumDistance = std::max(this->MaximumDistance, this->ThreadMaximumDistance[threadId]);
+    distanceSum += this->ThreadDistanceSum[threadId];
+  }
+  vtkIdType numberOfSamplePoints = this->GetNumberOfSamplePoints();
+  this->AverageDistance = (numberOfSamplePoints > 0 ? distanceSum / (double)numberOfSamplePoints : 0.0);
+
+  // create the bin and frequencies arrays
+  vtkSmartPointer<vtkDoubleArray> bins = vtkSmartPointer<vtkDoubleArray>::New();
+  bins->SetName("Bins");
+  bins->SetNumberOfTuples(numberOfBins);
+  vtkSmartPointer<vtkIntArray> frequencies = vtkSmartPointer<vtkIntArray>::New();
+  frequencies->SetName("Frequencies");
+  frequencies->SetNumberOfTuples(numberOfBins);
+  for (int i = 0; i < numberOfBins; i++)
+  {
+    bins->SetValue(i, this->HistogramMinimum + (i * this->HistogramSpacing));
+    frequencies->SetValue(i, (int)frequencySums[i]);
+  }
 
-  // output the histogram
-  this->OutputHistogram->DeepCopy(histogram);
+  // combine the bins and frequencies into the output histogram
+  this->OutputHistogram->AddColumn(bins);
+  this->OutputHistogram->AddColumn(frequencies);
 }
@@ -4,6 +4,10 @@
 #include <vtkPolyData.h>
 #include <vtkDoubleArray.h>
 #include <vtkTable.h>
+#include <vtkMultiThreader.h>
+
+// STD includes
+#include <vector>
 
 #include "vtkSlicerSegmentComparisonModuleLogicExport.h"
 
@@ -12,11 +16,19 @@
 /// \brief Compute a histogram of distances from one poly data to another.
 ///
 /// vtkPolyDataDistanceHistogramFilter is an algorithm that outputs a histogram
-/// of the distances from one input vtkPolyData to another. This filter
-/// is based on the following classes from vtk: vtkPolyDataPointSampler,
-/// vtkImplicitPolyDataDistance. The histogram is output  as a vtkTable 
-/// object. The user can also access the raw distances directly as a 
-/// vtkDoubleArray using GetOutputDistances().
+/// of the distances from one input vtkPolyData to another. The points at which
+/// the distances are sampled are generated by vtkPolyDataPointSampler. The histogram
+/// is output  as a vtkTable object. The user can also access the raw distances
+/// directly as a vtkDoubleArray using GetOutputDistances().
+///
+/// The distances are signed (negative inside), the same way as computed by
+/// vtkImplicitPolyDataDistance. Each input surface is triangulated and its triangles
+/// are binned in a uniform grid once, then the sample points are split between threads
+/// that all search the same (read-only) grid, and write the distances directly into the
+/// output arrays. The histogram and the statistics are accumulated in the same pass.
+/// If SymmetricDistance is on, the distances from the reference to the compare surface
+/// are computed as well in the same call, and the histogram and statistics contain both
+/// directions.
 ///
 /// This class CANNOT be a part of the VTK pipeline (as a filter) because
 /// it uses the pipeline internally. Creating such a "mini-pipeline" may
@@ -30,6 +42,28 @@ public:
   static const int OUTPUT_PORT_HISTOGRAM;
   //static const int OUTPUT_PORT_DISTANCES;
 
+  //BTX
+  /// Triangles of a surface binned in a uniform grid of buckets for closest point queries.
+  /// Built once per input, then only read by the threads.
+  struct SurfaceLocator
+  {
+    /// Corner coordinates of the triangles (9 values per triangle)
+    std::vector<double> TriangleCorners;
+    /// Unit normals of the triangles (3 values per triangle)
+    std::vector<double> TriangleNormals;
+    /// Position of the corner of the first bucket
+    double Origin[3];
+    /// Edge length of the (cubic) buckets
+    double BucketSize;
+    /// Number of buckets along each axis
+    int Dimensions[3];
+    /// Index of the first triangle of each bucket in \sa BucketTriangles (number of buckets + 1 values)
+    std::vector<vtkIdType> BucketOffsets;
+    /// Triangle indices sorted by bucket
+    std::vector<vtkIdType> BucketTriangles;
+  };
+  //ETX
+
 public:
   vtkTypeMacro(vtkPolyDataDistanceHistogramFilter,vtkObject);
  
@@ -58,14 +92,21 @@ public:
   /// Contains as many distance values as there are samples (points, etc.) in the compare mesh
   vtkDoubleArray* GetOutputDistances();
   
-  /// Get maximum of the absolute of the minimum distances \sa GetOutputDistances from the compare mesh to the reference mesh.
+  /// Get the minimum of the distances from each point of the reference mesh to the compare mesh
+  /// Only computed if \sa SymmetricDistance is on, empty otherwise
+  vtkDoubleArray* GetOutputReverseDistances();
+
+  /// Get maximum of the absolute of the minimum distances \sa GetOutputDistances from the compare mesh to the reference mesh
+  /// (and from the reference mesh to the compare mesh if \sa SymmetricDistance is on).
   /// This is what is traditionally called Hausdorff distance.
   double GetMaximumHausdorffDistance();
   
-  /// Get average of the absolute of the minimum distances \sa GetOutputDistances from the compare mesh to the reference mesh.
+  /// Get average of the absolute of the minimum distances \sa GetOutputDistances from the compare mesh to the reference mesh
+  /// (and from the reference mesh to the compare mesh if \sa SymmetricDistance is on).
   double GetAverageHausdorffDistance();
   
-  /// Get 95th percentile of the absolute of the minimum distances \sa GetOutputDistances from the compare mesh to the reference mesh.
+  /// Get 95th percentile of the absolute of the minimum distances \sa GetOutputDistances from the compare mesh to the reference mesh
+  /// (and from the reference mesh to the compare mesh if \sa SymmetricDistance is on).
   double GetPercent95HausdorffDistance();
   
   /// Set whether the filter should sample on the vertices of the input vtkPolyData objects.
@@ -94,6 +135,13 @@ public:
   /// Get the sampling distance for points on edges or faces of the input vtkPolyData objects.
   vtkGetMacro(SamplingDistance, double);
 
+  /// Set whether the distances are computed in both directions (compare to reference and reference to compare).
+  vtkSetMacro(SymmetricDistance, int);
+  /// Get whether the distances are computed in both directions (compare to reference and reference to compare).
+  vtkGetMacro(SymmetricDistance, int);
+  /// Set whether the distances are computed in both directions (compare to reference and reference to compare).
+  vtkBooleanMacro(SymmetricDistance, int);
+
   /// Set the histogram minimum (left-most value).
   vtkSetMacro(HistogramMinimum, double);
   /// Get the histogram minimum (left-most value).
@@ -109,9 +157,21 @@ public:
   /// Get the histogram spacing (width of the bins).
   vtkGetMacro(HistogramSpacing, double);
   
+  /// Set the number of threads used for the computation. By default the number of processors is used
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_MAX_THREADS);
+  /// Get the number of threads used for the computation.
+  vtkGetMacro(NumberOfThreads, int);
+
   /// Compute distances an histogram
   void Update();
 
+  /// Compute the distances of a range of sample points (the compare samples followed by the
+  /// reference samples if symmetric). Called from the worker threads
+  void ThreadedComputeDistances(vtkIdType startIndex, vtkIdType endIndex, int threadId);
+
+  /// Get the number of sample points the distances are computed for (in both directions if symmetric)
+  vtkIdType GetNumberOfSamplePoints();
+
 protected:
   vtkPolyDataDistanceHistogramFilter();
   ~vtkPolyDataDistanceHistogramFilter();
@@ -124,11 +184,15 @@ protected:
   //int FillOutputPortInformation(int port, vtkInformation* info);
 
 private:
-  /// This method measures the raw distances from points on comparePolyData to referencePolyData, and stores them in distanceArray.
-  /// \param referencePolyData The reference vtkPolyData on which to compute the distances. Distances are measured from points on the comparePolyData to the referencePolyData.
-  /// \param comparePolyData The compare vtkPolyData on which to compute the distances. Distances are measured from points on the comparePolyData to the referencePolyData.
-  /// \param distanceArray The array in which to store the raw distances.
-  void ComputeDistances(vtkPolyData* referencePolyData, vtkPolyData* comparePolyData, vtkDoubleArray* distanceArray);
+  /// Generate the points at which the distances from a poly data are sampled
+  /// \param polyData The vtkPolyData to sample according to the sampling settings
+  /// \param samplePoints The points to fill with the sample points
+  void GenerateSamplePoints(vtkPolyData* polyData, vtkPoints* samplePoints);
+
+  /// Triangulate a poly data and bin its triangles for the distance computation
+  /// \param polyData The vtkPolyData to which the distances are measured
+  /// \param locator The locator structure to build. Only cleared if polyData is NULL
+  void BuildSurfaceLocator(vtkPolyData* polyData, SurfaceLocator& locator);
   
 protected:
   /// Compare polydata, one of the inputs to generate the distances (from the compare vtkPolyData to the reference vtkPolyData)
@@ -138,8 +202,10 @@ protected:
 
   /// Output histogram of the distances
   vtkTable* OutputHistogram;
-  /// Output distances for each reference vertex in an array
+  /// Output distances for each compare vertex in an array
   vtkDoubleArray* OutputDistances;
+  /// Output distances for each reference vertex in an array (if symmetric)
+  vtkDoubleArray* OutputReverseDistances;
 
   /// Flag determining  whether the filter should sample on the vertices of the input vtkPolyData objects.
   /// All vertices from the vtkPolyData will be used, regardless of the sampling distance.
@@ -157,6 +223,9 @@ protected:
   /// Sampling distance for points on edges or faces of the input vtkPolyData objects.
   /// Default is 0.01.
   double SamplingDistance;
+  /// Flag determining whether the distances from the reference to the compare vtkPolyData are computed too.
+  /// Default is 0 (off).
+  int SymmetricDistance;
   /// Histogram minimum (left-most value).
   /// Default is -10.
   double HistogramMinimum;
@@ -166,6 +235,31 @@ protected:
   /// Histogram spacing (width of the bins).
   /// Default is 0.1.
   double HistogramSpacing;
+  /// Number of threads
+  int NumberOfThreads;
+
+  /// Sample points on the compare vtkPolyData
+  vtkPoints* CompareSamplePoints;
+  /// Sample points on the reference vtkPolyData (if symmetric)
+  vtkPoints* ReferenceSamplePoints;
+  /// Binned triangles of the reference vtkPolyData
+  SurfaceLocator ReferenceLocator;
+  /// Binned triangles of the compare vtkPolyData (if symmetric)
+  SurfaceLocator CompareLocator;
+
+  /// Histogram frequencies counted by each thread
+  std::vector<vtkIdType> ThreadFrequencies[VTK_MAX_THREADS];
+  /// Maximum of the absolute distances found by each thread
+  double ThreadMaximumDistance[VTK_MAX_THREADS];
+  /// Sum of the absolute distances found by each thread
+  double ThreadDistanceSum[VTK_MAX_THREADS];
+  /// Maximum of the absolute distances in the last computation
+  double MaximumDistance;
+  /// Average of the absolute distances in the last computation
+  double AverageDistance;
+
+  /// Multithreader executing the distance computation
+  vtkMultiThreader* Threader;
   
 private:
   vtkPolyDataDistanceHistogramFilter(const vtkPolyDataDistanceHistogramFilter&);  // Not implemented.
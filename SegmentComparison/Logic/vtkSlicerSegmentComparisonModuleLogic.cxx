@@ -21,6 +21,8 @@
 // SegmentComparison includes
 #include "vtkSlicerSegmentComparisonModuleLogic.h"
 #include "vtkMRMLSegmentComparisonNode.h"
+#include "vtkBinaryLabelmapDistanceMetrics.h"
+#include "vtkLabelmapOverlapMatrix.h"
 
 // Segmentations includes
 #include "vtkMRMLSegmentationNode.h"
@@ -28,6 +30,8 @@
 
 // SegmentationCore includes
 #include "vtkOrientedImageDataResample.h"
+#include "vtkSegmentation.h"
+#include "vtkSegment.h"
 
 // SlicerRT includes
 #include "PlmCommon.h"
@@ -48,10 +52,14 @@
 // VTK includes
 #include <vtkNew.h>
 #include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
 #include <vtkTimerLog.h>
 #include <vtkObjectFactory.h>
 #include <vtkStringArray.h>
 
+// STD includes
+#include <sstream>
+
 //-----------------------------------------------------------------------------
 /// \ingroup SlicerRt_QtModules_SegmentComparison
 class vtkSlicerSegmentComparisonModuleLogicPrivate : public vtkObject
@@ -68,6 +76,16 @@ public:
     Plm_image::Pointer& plmCmpSegmentLabelmap,
     double &checkpointItkConvertStart);
 
+  /// Get input segments as binary labelmaps on the lattice of the reference segment
+  /// \return Error message, empty string if no error
+  std::string GetInputSegmentsAsLabelmaps(
+    vtkMRMLSegmentComparisonNode* parameterNode,
+    vtkOrientedImageData* referenceSegmentLabelmap,
+    vtkOrientedImageData* compareSegmentLabelmap);
+
+  /// Determine if two labelmaps are on the same lattice (same origin, spacing and directions). The extents may differ
+  static bool DoLatticesMatch(vtkOrientedImageData* image1, vtkOrientedImageData* image2);
+
   void SetLogic(vtkSlicerSegmentComparisonModuleLogic* logic) { this->Logic = logic; };
 
 protected:
@@ -169,6 +187,91 @@ std::string vtkSlicerSegmentComparisonModuleLogicPrivate::GetInputSegmentsAsPlmV
   return "";
 }
 
+//---------------------------------------------------------------------------
+std::string vtkSlicerSegmentComparisonModuleLogicPrivate::GetInputSegmentsAsLabelmaps(
+  vtkMRMLSegmentComparisonNode* parameterNode,
+  vtkOrientedImageData* referenceSegmentLabelmap,
+  vtkOrientedImageData* compareSegmentLabelmap )
+{
+  if (!parameterNode || !this->Logic->GetMRMLScene() || !referenceSegmentLabelmap || !compareSegmentLabelmap)
+  {
+    std::string errorMessage("Invalid MRML scene, parameter set node, or output labelmaps");
+    vtkErrorMacro("GetInputSegmentsAsLabelmaps: " << errorMessage);
+    return errorMessage;
+  }
+
+  // Get selection
+  vtkMRMLSegmentationNode* referenceSegmentationNode = parameterNode->GetReferenceSegmentationNode();
+  const char* referenceSegmentID = parameterNode->GetReferenceSegmentID();
+  vtkMRMLSegmentationNode* compareSegmentationNode = parameterNode->GetCompareSegmentationNode();
+  const char* compareSegmentID = parameterNode->GetCompareSegmentID();
+
+  if (!referenceSegmentationNode || !referenceSegmentID)
+  {
+    std::string errorMessage("Invalid reference segment selection");
+    vtkErrorMacro("GetInputSegmentsAsLabelmaps: " << errorMessage);
+    return errorMessage;
+  }
+  if (!compareSegmentationNode || !compareSegmentID)
+  {
+    std::string errorMessage("Invalid compare segment selection");
+    vtkErrorMacro("GetInputSegmentsAsLabelmaps: " << errorMessage);
+    return errorMessage;
+  }
+
+  // Get segment binary labelmaps
+  if ( !vtkSlicerSegmentationsModuleLogic::GetSegmentBinaryLabelmapRepresentation(
+    referenceSegmentationNode, referenceSegmentID, referenceSegmentLabelmap ) )
+  {
+    std::string errorMessage("Failed to get binary labelmap from reference segment: " + std::string(referenceSegmentID));
+    vtkErrorMacro("GetInputSegmentsAsLabelmaps: " << errorMessage);
+    return errorMessage;
+  }
+  if ( !vtkSlicerSegmentationsModuleLogic::GetSegmentBinaryLabelmapRepresentation(
+    compareSegmentationNode, compareSegmentID, compareSegmentLabelmap ) )
+  {
+    std::string errorMessage("Failed to get binary labelmap from compare segment: " + std::string(compareSegmentID));
+    vtkErrorMacro("GetInputSegmentsAsLabelmaps: " << errorMessage);
+    return errorMessage;
+  }
+
+  // Resample compare labelmap to the lattice of the reference if the geometries differ.
+  // The extent is padded so that the parts of the compare segment outside the reference extent are kept,
+  // the distance computation handles the differing extents
+  if (!vtkOrientedImageDataResample::DoGeometriesMatch(referenceSegmentLabelmap, compareSegmentLabelmap))
+  {
+    if (!vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(
+      compareSegmentLabelmap, referenceSegmentLabelmap, compareSegmentLabelmap, false, true ) )
+    {
+      std::string errorMessage("Failed to resample compare segment labelmap to the reference geometry");
+      vtkErrorMacro("GetInputSegmentsAsLabelmaps: " << errorMessage);
+      return errorMessage;
+    }
+  }
+
+  return "";
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerSegmentComparisonModuleLogicPrivate::DoLatticesMatch(vtkOrientedImageData* image1, vtkOrientedImageData* image2)
+{
+  vtkSmartPointer<vtkMatrix4x4> image1ToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  image1->GetImageToWorldMatrix(image1ToWorldMatrix);
+  vtkSmartPointer<vtkMatrix4x4> image2ToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  image2->GetImageToWorldMatrix(image2ToWorldMatrix);
+  for (int row=0; row<3; ++row)
+  {
+    for (int column=0; column<4; ++column)
+    {
+      if (fabs(image1ToWorldMatrix->GetElement(row, column) - image2ToWorldMatrix->GetElement(row, column)) > 1.0e-4)
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
 //-----------------------------------------------------------------------------
 // vtkSlicerSegmentComparisonModuleLogic methods
 
@@ -426,6 +529,12 @@ std::string vtkSlicerSegmentComparisonModuleLogic::ComputeHausdorffDistances(vtk
   }
 
   parameterNode->HausdorffResultsValidOff();
+  parameterNode->SetSurfaceDiceCoefficient(-1.0);
+
+  if (parameterNode->GetUseDistanceTransformForHausdorff())
+  {
+    return this->ComputeHausdorffDistancesUsingDistanceTransform(parameterNode);
+  }
 
   vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
   double checkpointStart = timer->GetUniversalTime();
@@ -452,18 +561,84 @@ std::string vtkSlicerSegmentComparisonModuleLogic::ComputeHausdorffDistances(vtk
 
   hausdorff.run();
 
-  double maximumHausdorffDistanceForBoundaryMm = hausdorff.get_hausdorff();
-  double averageHausdorffDistanceForBoundaryMm = hausdorff.get_avg_average_boundary_hausdorff();
-  double percent95HausdorffDistanceForBoundaryMm = hausdorff.get_percent_boundary_hausdorff();
   parameterNode->SetMaximumHausdorffDistanceForVolumeMm(hausdorff.get_boundary_hausdorff());
-  parameterNode->SetMaximumHausdorffDistanceForBoundaryMm(maximumHausdorffDistanceForBoundaryMm);
+  parameterNode->SetMaximumHausdorffDistanceForBoundaryMm(hausdorff.get_hausdorff());
   parameterNode->SetAverageHausdorffDistanceForVolumeMm(hausdorff.get_avg_average_hausdorff());
-  parameterNode->SetAverageHausdorffDistanceForBoundaryMm(averageHausdorffDistanceForBoundaryMm);
+  parameterNode->SetAverageHausdorffDistanceForBoundaryMm(hausdorff.get_avg_average_boundary_hausdorff());
   parameterNode->SetPercent95HausdorffDistanceForVolumeMm(hausdorff.get_percent_hausdorff());
-  parameterNode->SetPercent95HausdorffDistanceForBoundaryMm(percent95HausdorffDistanceForBoundaryMm);
+  parameterNode->SetPercent95HausdorffDistanceForBoundaryMm(hausdorff.get_percent_boundary_hausdorff());
   parameterNode->HausdorffResultsValidOn();
 
-  // Set results to table node
+  this->SetHausdorffResultsToTable(parameterNode);
+
+  if (this->LogSpeedMeasurements)
+  {
+    double checkpointEnd = timer->GetUniversalTime();
+    UNUSED_VARIABLE(checkpointEnd); // Although it is used just below, a warning is logged so needs to be suppressed
+    vtkDebugMacro("ComputeHausdorffDistances: Total Hausdorff computation time: " << checkpointEnd-checkpointStart << " s\n"
+      << "\tApplying transforms: " << checkpointItkConvertStart-checkpointStart << " s\n"
+      << "\tConverting from VTK to ITK: " << checkpointHausdorffStart-checkpointItkConvertStart << " s\n"
+      << "\tHausdorff computation: " << checkpointEnd-checkpointHausdorffStart << " s");
+  }
+
+  return "";
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerSegmentComparisonModuleLogic::ComputeHausdorffDistancesUsingDistanceTransform(vtkMRMLSegmentComparisonNode* parameterNode)
+{
+  vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
+  double checkpointStart = timer->GetUniversalTime();
+  UNUSED_VARIABLE(checkpointStart); // Although it is used later, a warning is logged so needs to be suppressed
+
+  vtkSmartPointer<vtkOrientedImageData> referenceSegmentLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+  vtkSmartPointer<vtkOrientedImageData> compareSegmentLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+  std::string inputResult = this->LogicPrivate->GetInputSegmentsAsLabelmaps(parameterNode, referenceSegmentLabelmap, compareSegmentLabelmap);
+  if (!inputResult.empty())
+  {
+    return inputResult;
+  }
+
+  // Compute distances
+  double checkpointHausdorffStart = timer->GetUniversalTime();
+  UNUSED_VARIABLE(checkpointHausdorffStart); // Although it is used later, a warning is logged so needs to be suppressed
+  vtkSmartPointer<vtkBinaryLabelmapDistanceMetrics> distanceMetrics = vtkSmartPointer<vtkBinaryLabelmapDistanceMetrics>::New();
+  distanceMetrics->SetReferenceLabelmap(referenceSegmentLabelmap);
+  distanceMetrics->SetCompareLabelmap(compareSegmentLabelmap);
+  distanceMetrics->AddSurfaceDiceToleranceMm(parameterNode->GetSurfaceDiceToleranceMm());
+  if (!distanceMetrics->Update())
+  {
+    std::string errorMessage("Failed to compute distances between the segment labelmaps");
+    vtkErrorMacro("ComputeHausdorffDistancesUsingDistanceTransform: " << errorMessage);
+    return errorMessage;
+  }
+
+  parameterNode->SetMaximumHausdorffDistanceForVolumeMm(distanceMetrics->GetMaximumHausdorffDistanceForVolumeMm());
+  parameterNode->SetMaximumHausdorffDistanceForBoundaryMm(distanceMetrics->GetMaximumHausdorffDistanceForBoundaryMm());
+  parameterNode->SetAverageHausdorffDistanceForVolumeMm(distanceMetrics->GetAverageHausdorffDistanceForVolumeMm());
+  parameterNode->SetAverageHausdorffDistanceForBoundaryMm(distanceMetrics->GetAverageHausdorffDistanceForBoundaryMm());
+  parameterNode->SetPercent95HausdorffDistanceForVolumeMm(distanceMetrics->GetPercent95HausdorffDistanceForVolumeMm());
+  parameterNode->SetPercent95HausdorffDistanceForBoundaryMm(distanceMetrics->GetPercent95HausdorffDistanceForBoundaryMm());
+  parameterNode->SetSurfaceDiceCoefficient(distanceMetrics->GetSurfaceDice(0));
+  parameterNode->HausdorffResultsValidOn();
+
+  this->SetHausdorffResultsToTable(parameterNode);
+
+  if (this->LogSpeedMeasurements)
+  {
+    double checkpointEnd = timer->GetUniversalTime();
+    UNUSED_VARIABLE(checkpointEnd); // Although it is used just below, a warning is logged so needs to be suppressed
+    vtkDebugMacro("ComputeHausdorffDistancesUsingDistanceTransform: Total Hausdorff computation time: " << checkpointEnd-checkpointStart << " s\n"
+      << "\tGetting and resampling labelmaps: " << checkpointHausdorffStart-checkpointStart << " s\n"
+      << "\tDistance transforms and metrics: " << checkpointEnd-checkpointHausdorffStart << " s");
+  }
+
+  return "";
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerSegmentComparisonModuleLogic::SetHausdorffResultsToTable(vtkMRMLSegmentComparisonNode* parameterNode)
+{
   vtkMRMLTableNode* tableNode = parameterNode->GetHausdorffTableNode();
   if (tableNode)
   {
@@ -480,6 +655,12 @@ std::string vtkSlicerSegmentComparisonModuleLogic::ComputeHausdorffDistances(vtk
     header->InsertNextValue("Maximum (mm)");
     header->InsertNextValue("Average (mm)");
     header->InsertNextValue("95% (mm)");
+    if (parameterNode->GetSurfaceDiceCoefficient() >= 0.0)
+    {
+      std::stringstream surfaceDiceHeaderStream;
+      surfaceDiceHeaderStream << "Surface Dice (" << parameterNode->GetSurfaceDiceToleranceMm() << " mm)";
+      header->InsertNextValue(surfaceDiceHeaderStream.str());
+    }
 
     vtkStringArray* column = vtkStringArray::SafeDownCast(tableNode->AddColumn());
     column->SetName("Metric value");
@@ -494,9 +675,142 @@ std::string vtkSlicerSegmentComparisonModuleLogic::ComputeHausdorffDistances(vtk
     const char* compareSegmentID = parameterNode->GetCompareSegmentID();
     column->SetValue(row++, compareSegmentID);
 
-    column->SetVariantValue(row++, vtkVariant(maximumHausdorffDistanceForBoundaryMm));
-    column->SetVariantValue(row++, vtkVariant(averageHausdorffDistanceForBoundaryMm));
-    column->SetVariantValue(row++, vtkVariant(percent95HausdorffDistanceForBoundaryMm));
+    column->SetVariantValue(row++, vtkVariant(parameterNode->GetMaximumHausdorffDistanceForBoundaryMm()));
+    column->SetVariantValue(row++, vtkVariant(parameterNode->GetAverageHausdorffDistanceForBoundaryMm()));
+    column->SetVariantValue(row++, vtkVariant(parameterNode->GetPercent95HausdorffDistanceForBoundaryMm()));
+    if (parameterNode->GetSurfaceDiceCoefficient() >= 0.0)
+    {
+      column->SetVariantValue(row++, vtkVariant(parameterNode->GetSurfaceDiceCoefficient()));
+    }
+
+    // Trigger UI update
+    tableNode->Modified();
+  }
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerSegmentComparisonModuleLogic::ComputeOverlapMatrix(vtkMRMLSegmentComparisonNode* parameterNode)
+{
+  if (!parameterNode || !this->GetMRMLScene())
+  {
+    std::string errorMessage("Invalid MRML scene or parameter set node");
+    vtkErrorMacro("ComputeOverlapMatrix: " << errorMessage);
+    return errorMessage;
+  }
+  vtkMRMLSegmentationNode* referenceSegmentationNode = parameterNode->GetReferenceSegmentationNode();
+  vtkMRMLSegmentationNode* compareSegmentationNode = parameterNode->GetCompareSegmentationNode();
+  if (!referenceSegmentationNode || !compareSegmentationNode)
+  {
+    std::string errorMessage("Invalid reference or compare segmentation selection");
+    vtkErrorMacro("ComputeOverlapMatrix: " << errorMessage);
+    return errorMessage;
+  }
+
+  vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
+  double checkpointStart = timer->GetUniversalTime();
+  UNUSED_VARIABLE(checkpointStart); // Although it is used later, a warning is logged so needs to be suppressed
+
+  // Get the labelmaps of all segments on the lattice of the first reference segment. Labelmaps on other lattices
+  // are resampled with padding, so that they keep their full extent (the overlap matrix handles differing extents)
+  std::vector<std::string> referenceSegmentIDs;
+  referenceSegmentationNode->GetSegmentation()->GetSegmentIDs(referenceSegmentIDs);
+  std::vector<std::string> compareSegmentIDs;
+  compareSegmentationNode->GetSegmentation()->GetSegmentIDs(compareSegmentIDs);
+  if (referenceSegmentIDs.empty() || compareSegmentIDs.empty())
+  {
+    std::string errorMessage("Reference and compare segmentations need to contain segments");
+    vtkErrorMacro("ComputeOverlapMatrix: " << errorMessage);
+    return errorMessage;
+  }
+
+  vtkSmartPointer<vtkLabelmapOverlapMatrix> overlapMatrix = vtkSmartPointer<vtkLabelmapOverlapMatrix>::New();
+  vtkSmartPointer<vtkOrientedImageData> latticeReferenceLabelmap;
+  for (int setIndex=0; setIndex<2; ++setIndex)
+  {
+    vtkMRMLSegmentationNode* segmentationNode = (setIndex == 0 ? referenceSegmentationNode : compareSegmentationNode);
+    std::vector<std::string>& segmentIDs = (setIndex == 0 ? referenceSegmentIDs : compareSegmentIDs);
+    for (std::vector<std::string>::iterator segmentIdIt = segmentIDs.begin(); segmentIdIt != segmentIDs.end(); ++segmentIdIt)
+    {
+      vtkSmartPointer<vtkOrientedImageData> segmentLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+      if ( !vtkSlicerSegmentationsModuleLogic::GetSegmentBinaryLabelmapRepresentation(
+        segmentationNode, segmentIdIt->c_str(), segmentLabelmap ) )
+      {
+        std::string errorMessage("Failed to get binary labelmap from segment: " + (*segmentIdIt));
+        vtkErrorMacro("ComputeOverlapMatrix: " << errorMessage);
+        return errorMessage;
+      }
+      if (!latticeReferenceLabelmap)
+      {
+        latticeReferenceLabelmap = segmentLabelmap;
+      }
+      else if (!vtkSlicerSegmentComparisonModuleLogicPrivate::DoLatticesMatch(latticeReferenceLabelmap, segmentLabelmap))
+      {
+        if (!vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(
+          segmentLabelmap, latticeReferenceLabelmap, segmentLabelmap, false, true ) )
+        {
+          std::string errorMessage("Failed to resample labelmap of segment: " + (*segmentIdIt));
+          vtkErrorMacro("ComputeOverlapMatrix: " << errorMessage);
+          return errorMessage;
+        }
+      }
+      if (setIndex == 0)
+      {
+        overlapMatrix->AddReferenceLabelmap(segmentLabelmap);
+      }
+      else
+      {
+        overlapMatrix->AddCompareLabelmap(segmentLabelmap);
+      }
+    }
+  }
+
+  // Count all pairwise intersections
+  double checkpointOverlapStart = timer->GetUniversalTime();
+  UNUSED_VARIABLE(checkpointOverlapStart); // Although it is used later, a warning is logged so needs to be suppressed
+  if (!overlapMatrix->Update())
+  {
+    std::string errorMessage("Failed to compute overlap of the segment labelmaps");
+    vtkErrorMacro("ComputeOverlapMatrix: " << errorMessage);
+    return errorMessage;
+  }
+
+  // Set results to table node, one row for each reference and compare segment pair
+  vtkMRMLTableNode* tableNode = parameterNode->GetOverlapMatrixTableNode();
+  if (tableNode)
+  {
+    tableNode->SetUseColumnNameAsColumnHeader(true);
+    tableNode->RemoveAllColumns();
+    const char* columnNames[9] = { "Reference segment", "Compare segment", "Dice coefficient", "Jaccard index",
+      "Reference volume (cc)", "Compare volume (cc)", "Intersection volume (cc)", "False positives (cc)", "False negatives (cc)" };
+    std::vector<vtkStringArray*> columns;
+    for (int columnIndex=0; columnIndex<9; ++columnIndex)
+    {
+      vtkStringArray* column = vtkStringArray::SafeDownCast(tableNode->AddColumn());
+      column->SetName(columnNames[columnIndex]);
+      columns.push_back(column);
+    }
+
+    double voxelVolumeCc = overlapMatrix->GetVoxelVolumeMm3() / 1000.0;
+    for (int referenceIndex=0; referenceIndex<overlapMatrix->GetNumberOfReferenceLabelmaps(); ++referenceIndex)
+    {
+      vtkSegment* referenceSegment = referenceSegmentationNode->GetSegmentation()->GetSegment(referenceSegmentIDs[referenceIndex]);
+      for (int compareIndex=0; compareIndex<overlapMatrix->GetNumberOfCompareLabelmaps(); ++compareIndex)
+      {
+        vtkSegment* compareSegment = compareSegmentationNode->GetSegmentation()->GetSegment(compareSegmentIDs[compareIndex]);
+        int column = 0;
+        vtkIdType row = columns[column++]->InsertNextValue(
+          referenceSegment && referenceSegment->GetName() ? referenceSegment->GetName() : referenceSegmentIDs[referenceIndex].c_str() );
+        columns[column++]->InsertValue(row,
+          compareSegment && compareSegment->GetName() ? compareSegment->GetName() : compareSegmentIDs[compareIndex].c_str() );
+        columns[column++]->InsertVariantValue(row, vtkVariant(overlapMatrix->GetDiceCoefficient(referenceIndex, compareIndex)));
+        columns[column++]->InsertVariantValue(row, vtkVariant(overlapMatrix->GetJaccardIndex(referenceIndex, compareIndex)));
+        columns[column++]->InsertVariantValue(row, vtkVariant(overlapMatrix->GetReferenceVoxelCount(referenceIndex) * voxelVolumeCc));
+        columns[column++]->InsertVariantValue(row, vtkVariant(overlapMatrix->GetCompareVoxelCount(compareIndex) * voxelVolumeCc));
+        columns[column++]->InsertVariantValue(row, vtkVariant(overlapMatrix->GetIntersectionVoxelCount(referenceIndex, compareIndex) * voxelVolumeCc));
+        columns[column++]->InsertVariantValue(row, vtkVariant(overlapMatrix->GetFalsePositiveVoxelCount(referenceIndex, compareIndex) * voxelVolumeCc));
+        columns[column++]->InsertVariantValue(row, vtkVariant(overlapMatrix->GetFalseNegativeVoxelCount(referenceIndex, compareIndex) * voxelVolumeCc));
+      }
+    }
 
     // Trigger UI update
     tableNode->Modified();
@@ -506,10 +820,9 @@ std::string vtkSlicerSegmentComparisonModuleLogic::ComputeHausdorffDistances(vtk
   {
     double checkpointEnd = timer->GetUniversalTime();
     UNUSED_VARIABLE(checkpointEnd); // Although it is used just below, a warning is logged so needs to be suppressed
-    vtkDebugMacro("ComputeHausdorffDistances: Total Hausdorff computation time: " << checkpointEnd-checkpointStart << " s\n"
-      << "\tApplying transforms: " << checkpointItkConvertStart-checkpointStart << " s\n"
-      << "\tConverting from VTK to ITK: " << checkpointHausdorffStart-checkpointItkConvertStart << " s\n"
-      << "\tHausdorff computation: " << checkpointEnd-checkpointHausdorffStart << " s");
+    vtkDebugMacro("ComputeOverlapMatrix: Total overlap matrix computation time: " << checkpointEnd-checkpointStart << " s\n"
+      << "\tGetting and resampling labelmaps: " << checkpointOverlapStart-checkpointStart << " s\n"
+      << "\tCounting overlaps: " << checkpointEnd-checkpointOverlapStart << " s");
   }
 
   return "";
@@ -53,6 +53,11 @@ public:
   /// \return Error message, empty string if no error
   std::string ComputeHausdorffDistances(vtkMRMLSegmentComparisonNode* parameterNode);
 
+  /// Compute overlap (Dice, Jaccard, volumes, false positives and negatives) of all reference segments with all compare segments.
+  /// The segment labelmaps are counted in a single pass, and the results are written to the overlap matrix table node
+  /// \return Error message, empty string if no error
+  std::string ComputeOverlapMatrix(vtkMRMLSegmentComparisonNode* parameterNode);
+
 public:
   vtkGetMacro(LogSpeedMeasurements, bool);
   vtkSetMacro(LogSpeedMeasurements, bool);
@@ -62,6 +67,13 @@ protected:
   /// Set private logic implementation
   void SetLogicPrivate(vtkSlicerSegmentComparisonModuleLogicPrivate* logicPrivate);
 
+  /// Compute Hausdorff distances and surface Dice using distance transforms of the segment labelmaps
+  /// \return Error message, empty string if no error
+  std::string ComputeHausdorffDistancesUsingDistanceTransform(vtkMRMLSegmentComparisonNode* parameterNode);
+
+  /// Write Hausdorff results of the parameter node into its Hausdorff table node
+  void SetHausdorffResultsToTable(vtkMRMLSegmentComparisonNode* parameterNode);
+
 protected:
   vtkSlicerSegmentComparisonModuleLogic();
   virtual ~vtkSlicerSegmentComparisonModuleLogic();
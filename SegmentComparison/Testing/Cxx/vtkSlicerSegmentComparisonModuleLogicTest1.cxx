@@ -21,10 +21,14 @@
 // SegmentComparison includes
 #include "vtkSlicerSegmentComparisonModuleLogic.h"
 #include "vtkMRMLSegmentComparisonNode.h"
+#include "vtkPolyDataDistanceHistogramFilter.h"
+#include "vtkBinaryLabelmapDistanceMetrics.h"
+#include "vtkLabelmapOverlapMatrix.h"
 
 // Segmentations includes
 #include "vtkMRMLSegmentationNode.h"
 #include "vtkSlicerSegmentationsModuleLogic.h"
+#include "vtkSegment.h"
 
 // SlicerRt includes
 #include "SlicerRtCommon.h"
@@ -41,12 +45,18 @@
 #include <vtkMRMLScalarVolumeNode.h>
 #include <vtkMRMLLinearTransformNode.h>
 #include <vtkMRMLScene.h>
+#include <vtkMRMLTableNode.h>
 
 // VTK includes
 #include <vtkNew.h>
 #include <vtkImageData.h>
 #include <vtkImageAccumulate.h>
 #include <vtkImageMathematics.h>
+#include <vtkSphereSource.h>
+#include <vtkTable.h>
+#include <vtkIntArray.h>
+#include <vtkPointData.h>
+#include <vtkDataArray.h>
 
 // ITK includes
 #include "itkFactoryRegistration.h"
@@ -55,6 +65,10 @@
 #include <vtksys/SystemTools.hxx>
 
 bool CheckIfResultIsWithinOneTenthPercentFromBaseline(double result, double baseline);
+int TestPolyDataDistanceHistogramFilter();
+int TestBinaryLabelmapDistanceMetrics();
+int TestLabelmapOverlapMatrix();
+int TestComputeOverlapMatrixWithDisjointExtents();
 
 //-----------------------------------------------------------------------------
 int vtkSlicerSegmentComparisonModuleLogicTest1( int argc, char * argv[] )
@@ -455,9 +469,337 @@ int vtkSlicerSegmentComparisonModuleLogicTest1( int argc, char * argv[] )
     result = EXIT_FAILURE;
   }
 
+  if (TestPolyDataDistanceHistogramFilter() != EXIT_SUCCESS)
+  {
+    result = EXIT_FAILURE;
+  }
+  if (TestBinaryLabelmapDistanceMetrics() != EXIT_SUCCESS)
+  {
+    result = EXIT_FAILURE;
+  }
+  if (TestLabelmapOverlapMatrix() != EXIT_SUCCESS)
+  {
+    result = EXIT_FAILURE;
+  }
+  if (TestComputeOverlapMatrixWithDisjointExtents() != EXIT_SUCCESS)
+  {
+    result = EXIT_FAILURE;
+  }
+
   return result;
 }
 
+//-----------------------------------------------------------------------------
+int TestPolyDataDistanceHistogramFilter()
+{
+  // Concentric spheres 2mm apart: the compare surface is outside the reference, so the distances
+  // are positive in the forward direction and negative in the reverse direction
+  vtkNew<vtkSphereSource> referenceSphere;
+  referenceSphere->SetRadius(10.0);
+  referenceSphere->SetThetaResolution(64);
+  referenceSphere->SetPhiResolution(64);
+  referenceSphere->Update();
+  vtkNew<vtkSphereSource> compareSphere;
+  compareSphere->SetRadius(12.0);
+  compareSphere->SetThetaResolution(48);
+  compareSphere->SetPhiResolution(48);
+  compareSphere->Update();
+
+  vtkNew<vtkPolyDataDistanceHistogramFilter> distanceFilter;
+  distanceFilter->SetInputReferencePolyData(referenceSphere->GetOutput());
+  distanceFilter->SetInputComparePolyData(compareSphere->GetOutput());
+  distanceFilter->SymmetricDistanceOn();
+  distanceFilter->Update();
+
+  vtkDoubleArray* distances = distanceFilter->GetOutputDistances();
+  vtkDoubleArray* reverseDistances = distanceFilter->GetOutputReverseDistances();
+  if ( distances->GetNumberOfTuples() != compareSphere->GetOutput()->GetNumberOfPoints()
+    || reverseDistances->GetNumberOfTuples() != referenceSphere->GetOutput()->GetNumberOfPoints() )
+  {
+    std::cerr << "Distance filter: Number of distances does not match the number of sample points!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (vtkIdType i=0; i<distances->GetNumberOfTuples(); ++i)
+  {
+    if (fabs(distances->GetValue(i) - 2.0) > 0.05)
+    {
+      std::cerr << "Distance filter: Distance " << distances->GetValue(i) << " instead of 2.0!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  for (vtkIdType i=0; i<reverseDistances->GetNumberOfTuples(); ++i)
+  {
+    if (fabs(reverseDistances->GetValue(i) + 2.0) > 0.05)
+    {
+      std::cerr << "Distance filter: Reverse distance " << reverseDistances->GetValue(i) << " instead of -2.0!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  double maximumDistance = distanceFilter->GetMaximumHausdorffDistance();
+  double averageDistance = distanceFilter->GetAverageHausdorffDistance();
+  double percent95Distance = distanceFilter->GetPercent95HausdorffDistance();
+  if ( fabs(maximumDistance - 2.0) > 0.05 || fabs(averageDistance - 2.0) > 0.05 || fabs(percent95Distance - 2.0) > 0.05
+    || averageDistance > maximumDistance || percent95Distance > maximumDistance )
+  {
+    std::cerr << "Distance filter: Hausdorff maximum/average/95% " << maximumDistance << "/" << averageDistance << "/"
+      << percent95Distance << " instead of 2.0!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // All distances are within the histogram range
+  vtkIntArray* frequencies = vtkIntArray::SafeDownCast(distanceFilter->GetOutputHistogram()->GetColumnByName("Frequencies"));
+  if (!frequencies)
+  {
+    std::cerr << "Distance filter: No frequencies in the histogram!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkIdType frequencySum = 0;
+  for (vtkIdType bin=0; bin<frequencies->GetNumberOfTuples(); ++bin)
+  {
+    frequencySum += frequencies->GetValue(bin);
+  }
+  if (frequencySum != distances->GetNumberOfTuples() + reverseDistances->GetNumberOfTuples())
+  {
+    std::cerr << "Distance filter: Histogram contains " << frequencySum << " distances instead of "
+      << distances->GetNumberOfTuples() + reverseDistances->GetNumberOfTuples() << "!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int TestBinaryLabelmapDistanceMetrics()
+{
+  // Two 10mm cubes, the compare cube shifted by 3mm along X. The compare labelmap has a smaller extent
+  // than the reference on the same lattice
+  vtkNew<vtkImageData> referenceLabelmap;
+  referenceLabelmap->SetExtent(0, 39, 0, 39, 0, 39);
+  referenceLabelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  vtkNew<vtkImageData> compareLabelmap;
+  compareLabelmap->SetExtent(5, 34, 5, 34, 5, 34);
+  compareLabelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  vtkImageData* labelmaps[2] = { referenceLabelmap.GetPointer(), compareLabelmap.GetPointer() };
+  int cubeStartX[2] = { 10, 13 };
+  for (int index=0; index<2; ++index)
+  {
+    int extent[6] = {0, -1, 0, -1, 0, -1};
+    labelmaps[index]->GetExtent(extent);
+    for (int k=extent[4]; k<=extent[5]; ++k)
+    {
+      for (int j=extent[2]; j<=extent[3]; ++j)
+      {
+        for (int i=extent[0]; i<=extent[1]; ++i)
+        {
+          bool inside = (i >= cubeStartX[index] && i < cubeStartX[index]+10 && j >= 10 && j < 20 && k >= 10 && k < 20);
+          *static_cast<unsigned char*>(labelmaps[index]->GetScalarPointer(i, j, k)) = (inside ? 1 : 0);
+        }
+      }
+    }
+  }
+
+  vtkNew<vtkBinaryLabelmapDistanceMetrics> distanceMetrics;
+  distanceMetrics->SetReferenceLabelmap(referenceLabelmap.GetPointer());
+  distanceMetrics->SetCompareLabelmap(compareLabelmap.GetPointer());
+  distanceMetrics->AddSurfaceDiceToleranceMm(1.0);
+  distanceMetrics->AddSurfaceDiceToleranceMm(3.0);
+  if (!distanceMetrics->Update())
+  {
+    std::cerr << "Distance metrics: Failed to compute metrics!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Expected values computed by brute force
+  if (distanceMetrics->GetNumberOfReferenceBoundaryVoxels() != 488 || distanceMetrics->GetNumberOfCompareBoundaryVoxels() != 488)
+  {
+    std::cerr << "Distance metrics: Number of boundary voxels " << distanceMetrics->GetNumberOfReferenceBoundaryVoxels()
+      << "/" << distanceMetrics->GetNumberOfCompareBoundaryVoxels() << " instead of 488!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if ( fabs(distanceMetrics->GetMaximumHausdorffDistanceForBoundaryMm() - 3.0) > 0.0001
+    || fabs(distanceMetrics->GetAverageHausdorffDistanceForBoundaryMm() - 1.07377) > 0.0001
+    || fabs(distanceMetrics->GetPercent95HausdorffDistanceForBoundaryMm() - 3.0) > 0.0001 )
+  {
+    std::cerr << "Distance metrics: Boundary Hausdorff maximum/average/95% " << distanceMetrics->GetMaximumHausdorffDistanceForBoundaryMm()
+      << "/" << distanceMetrics->GetAverageHausdorffDistanceForBoundaryMm() << "/" << distanceMetrics->GetPercent95HausdorffDistanceForBoundaryMm()
+      << " instead of 3/1.07377/3!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if ( fabs(distanceMetrics->GetMaximumHausdorffDistanceForVolumeMm() - 3.0) > 0.0001
+    || fabs(distanceMetrics->GetAverageHausdorffDistanceForVolumeMm() - 0.6) > 0.0001
+    || fabs(distanceMetrics->GetPercent95HausdorffDistanceForVolumeMm() - 3.0) > 0.0001 )
+  {
+    std::cerr << "Distance metrics: Volume Hausdorff maximum/average/95% " << distanceMetrics->GetMaximumHausdorffDistanceForVolumeMm()
+      << "/" << distanceMetrics->GetAverageHausdorffDistanceForVolumeMm() << "/" << distanceMetrics->GetPercent95HausdorffDistanceForVolumeMm()
+      << " instead of 3/0.6/3!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (fabs(distanceMetrics->GetSurfaceDice(0) - 0.647541) > 0.0001 || fabs(distanceMetrics->GetSurfaceDice(1) - 1.0) > 0.0001)
+  {
+    std::cerr << "Distance metrics: Surface Dice at 1mm/3mm " << distanceMetrics->GetSurfaceDice(0) << "/"
+      << distanceMetrics->GetSurfaceDice(1) << " instead of 0.647541/1!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int TestLabelmapOverlapMatrix()
+{
+  // Two reference boxes of 10x10x10 voxels at I=0..9 and I=5..14 (of different scalar types), and 70 compare
+  // slabs of 1x10x10 voxels at I=n%20, each with its own extent. More than 64 compare labelmaps need more bit words
+  vtkNew<vtkLabelmapOverlapMatrix> overlapMatrix;
+  int referenceStartI[2] = { 0, 5 };
+  int referenceScalarTypes[2] = { VTK_UNSIGNED_CHAR, VTK_SHORT };
+  for (int referenceIndex=0; referenceIndex<2; ++referenceIndex)
+  {
+    vtkSmartPointer<vtkImageData> referenceLabelmap = vtkSmartPointer<vtkImageData>::New();
+    referenceLabelmap->SetExtent(0, 19, 0, 9, 0, 9);
+    referenceLabelmap->AllocateScalars(referenceScalarTypes[referenceIndex], 1);
+    for (int k=0; k<10; ++k)
+    {
+      for (int j=0; j<10; ++j)
+      {
+        for (int i=0; i<20; ++i)
+        {
+          bool inside = (i >= referenceStartI[referenceIndex] && i < referenceStartI[referenceIndex]+10);
+          referenceLabelmap->SetScalarComponentFromDouble(i, j, k, 0, (inside ? 1.0 : 0.0));
+        }
+      }
+    }
+    overlapMatrix->AddReferenceLabelmap(referenceLabelmap);
+  }
+  const int numberOfCompareLabelmaps = 70;
+  for (int compareIndex=0; compareIndex<numberOfCompareLabelmaps; ++compareIndex)
+  {
+    vtkSmartPointer<vtkImageData> compareLabelmap = vtkSmartPointer<vtkImageData>::New();
+    compareLabelmap->SetExtent(compareIndex%20, compareIndex%20, 0, 9, 0, 9);
+    compareLabelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    compareLabelmap->GetPointData()->GetScalars()->FillComponent(0, 1.0);
+    overlapMatrix->AddCompareLabelmap(compareLabelmap);
+  }
+  overlapMatrix->SetNumberOfThreads(3);
+  if (!overlapMatrix->Update())
+  {
+    std::cerr << "Overlap matrix: Failed to compute overlaps!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  for (int referenceIndex=0; referenceIndex<2; ++referenceIndex)
+  {
+    if (overlapMatrix->GetReferenceVoxelCount(referenceIndex) != 1000)
+    {
+      std::cerr << "Overlap matrix: Reference " << referenceIndex << " voxel count "
+        << overlapMatrix->GetReferenceVoxelCount(referenceIndex) << " instead of 1000!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    for (int compareIndex=0; compareIndex<numberOfCompareLabelmaps; ++compareIndex)
+    {
+      int i = compareIndex%20;
+      vtkIdType expectedIntersection = (i >= referenceStartI[referenceIndex] && i < referenceStartI[referenceIndex]+10 ? 100 : 0);
+      if ( overlapMatrix->GetCompareVoxelCount(compareIndex) != 100
+        || overlapMatrix->GetIntersectionVoxelCount(referenceIndex, compareIndex) != expectedIntersection
+        || overlapMatrix->GetFalsePositiveVoxelCount(referenceIndex, compareIndex) != 100 - expectedIntersection
+        || overlapMatrix->GetFalseNegativeVoxelCount(referenceIndex, compareIndex) != 1000 - expectedIntersection
+        || fabs(overlapMatrix->GetDiceCoefficient(referenceIndex, compareIndex) - 2.0 * expectedIntersection / 1100.0) > 1.0e-9
+        || fabs(overlapMatrix->GetJaccardIndex(referenceIndex, compareIndex) - expectedIntersection / (1100.0 - expectedIntersection)) > 1.0e-9 )
+      {
+        std::cerr << "Overlap matrix: Mismatch for reference " << referenceIndex << " and compare " << compareIndex
+          << ": intersection " << overlapMatrix->GetIntersectionVoxelCount(referenceIndex, compareIndex)
+          << " instead of " << expectedIntersection << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+void AddBoxSegment(vtkMRMLSegmentationNode* segmentationNode, const char* segmentId, double spacing, double origin, int extent[6])
+{
+  vtkSmartPointer<vtkOrientedImageData> labelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+  labelmap->SetSpacing(spacing, spacing, spacing);
+  labelmap->SetOrigin(origin, origin, origin);
+  labelmap->SetExtent(extent);
+  labelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  labelmap->GetPointData()->GetScalars()->FillComponent(0, 1.0);
+
+  vtkSmartPointer<vtkSegment> segment = vtkSmartPointer<vtkSegment>::New();
+  segment->SetName(segmentId);
+  segment->AddRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(), labelmap);
+  segmentationNode->GetSegmentation()->AddSegment(segment, segmentId);
+}
+
+//-----------------------------------------------------------------------------
+int TestComputeOverlapMatrixWithDisjointExtents()
+{
+  // Reference segment: 10mm cube of 1mm voxels at I,J,K=0..9. Compare segments: 10mm cubes of 2mm voxels, shifted by
+  // 0, 6 and 20mm along X. The compare segments are resampled to the 1mm lattice, where they partially or completely
+  // fall outside the extent of the reference segment, and must not be cropped to it
+  vtkSmartPointer<vtkMRMLScene> mrmlScene = vtkSmartPointer<vtkMRMLScene>::New();
+  vtkSmartPointer<vtkMRMLSegmentationNode> referenceSegmentationNode = vtkSmartPointer<vtkMRMLSegmentationNode>::New();
+  mrmlScene->AddNode(referenceSegmentationNode);
+  referenceSegmentationNode->GetSegmentation()->SetMasterRepresentationName(
+    vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName() );
+  int referenceExtent[6] = { 0, 9, 0, 9, 0, 9 };
+  AddBoxSegment(referenceSegmentationNode, "Reference", 1.0, 0.0, referenceExtent);
+
+  vtkSmartPointer<vtkMRMLSegmentationNode> compareSegmentationNode = vtkSmartPointer<vtkMRMLSegmentationNode>::New();
+  mrmlScene->AddNode(compareSegmentationNode);
+  compareSegmentationNode->GetSegmentation()->SetMasterRepresentationName(
+    vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName() );
+  const int numberOfCompareSegments = 3;
+  const char* compareSegmentIds[numberOfCompareSegments] = { "Same", "HalfOutside", "Disjoint" };
+  int compareStartI[numberOfCompareSegments] = { 0, 3, 10 };
+  double expectedIntersectionCc[numberOfCompareSegments] = { 1.0, 0.4, 0.0 };
+  for (int compareIndex=0; compareIndex<numberOfCompareSegments; ++compareIndex)
+  {
+    int compareExtent[6] = { compareStartI[compareIndex], compareStartI[compareIndex]+4, 0, 4, 0, 4 };
+    AddBoxSegment(compareSegmentationNode, compareSegmentIds[compareIndex], 2.0, 0.5, compareExtent);
+  }
+
+  vtkSmartPointer<vtkMRMLTableNode> tableNode = vtkSmartPointer<vtkMRMLTableNode>::New();
+  mrmlScene->AddNode(tableNode);
+  vtkSmartPointer<vtkMRMLSegmentComparisonNode> paramNode = vtkSmartPointer<vtkMRMLSegmentComparisonNode>::New();
+  mrmlScene->AddNode(paramNode);
+  paramNode->SetAndObserveReferenceSegmentationNode(referenceSegmentationNode);
+  paramNode->SetAndObserveCompareSegmentationNode(compareSegmentationNode);
+  paramNode->SetAndObserveOverlapMatrixTableNode(tableNode);
+
+  vtkSmartPointer<vtkSlicerSegmentComparisonModuleLogic> segmentComparisonLogic = vtkSmartPointer<vtkSlicerSegmentComparisonModuleLogic>::New();
+  segmentComparisonLogic->SetMRMLScene(mrmlScene);
+  std::string errorMessage = segmentComparisonLogic->ComputeOverlapMatrix(paramNode);
+  if (!errorMessage.empty() || tableNode->GetTable()->GetNumberOfRows() != numberOfCompareSegments)
+  {
+    std::cerr << "Overlap matrix with disjoint extents: Failed to compute overlap matrix! " << errorMessage << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Columns: reference, compare, Dice, Jaccard, reference volume, compare volume, intersection volume, false positives, false negatives
+  vtkTable* table = tableNode->GetTable();
+  for (int compareIndex=0; compareIndex<numberOfCompareSegments; ++compareIndex)
+  {
+    double diceCoefficient = table->GetValue(compareIndex, 2).ToDouble();
+    double referenceVolumeCc = table->GetValue(compareIndex, 4).ToDouble();
+    double compareVolumeCc = table->GetValue(compareIndex, 5).ToDouble();
+    double intersectionVolumeCc = table->GetValue(compareIndex, 6).ToDouble();
+    if ( fabs(referenceVolumeCc - 1.0) > 1.0e-6 || fabs(compareVolumeCc - 1.0) > 1.0e-6
+      || fabs(intersectionVolumeCc - expectedIntersectionCc[compareIndex]) > 1.0e-6
+      || fabs(diceCoefficient - expectedIntersectionCc[compareIndex]) > 1.0e-6 )
+    {
+      std::cerr << "Overlap matrix with disjoint extents: Mismatch for compare segment " << compareSegmentIds[compareIndex]
+        << ": reference volume " << referenceVolumeCc << " cc, compare volume " << compareVolumeCc << " cc (expected 1 cc), intersection "
+        << intersectionVolumeCc << " cc (expected " << expectedIntersectionCc[compareIndex] << " cc), Dice " << diceCoefficient << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
 //-----------------------------------------------------------------------------
 bool CheckIfResultIsWithinOneTenthPercentFromBaseline(double result, double baseline)
 {
@@ -0,0 +1,441 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkBinaryLabelmapBooleanOperation.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkBinaryLabelmapBooleanOperation);
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /// Number of voxels packed in one bit word
+  const int BITS_PER_WORD = 64;
+
+  //----------------------------------------------------------------------------
+  bool IsExtentEmpty(const int extent[6])
+  {
+    return (extent[0] > extent[1] || extent[2] > extent[3] || extent[4] > extent[5]);
+  }
+
+  //----------------------------------------------------------------------------
+  /// Determine the bounding extent of the non-zero voxels. The extent is empty if there are no non-zero voxels
+  template <class T> void DetermineNonZeroExtent(const T* labelmapPtr, const int extent[6], int nonZeroExtent[6])
+  {
+    nonZeroExtent[0] = nonZeroExtent[2] = nonZeroExtent[4] = VTK_INT_MAX;
+    nonZeroExtent[1] = nonZeroExtent[3] = nonZeroExtent[5] = VTK_INT_MIN;
+    const T* voxelPtr = labelmapPtr;
+    for (int k=extent[4]; k<=extent[5]; ++k)
+    {
+      for (int j=extent[2]; j<=extent[3]; ++j)
+      {
+        for (int i=extent[0]; i<=extent[1]; ++i, ++voxelPtr)
+        {
+          if (*voxelPtr != 0)
+          {
+            nonZeroExtent[0] = std::min(nonZeroExtent[0], i);
+            nonZeroExtent[1] = std::max(nonZeroExtent[1], i);
+            nonZeroExtent[2] = std::min(nonZeroExtent[2], j);
+            nonZeroExtent[3] = std::max(nonZeroExtent[3], j);
+            nonZeroExtent[4] = std::min(nonZeroExtent[4], k);
+            nonZeroExtent[5] = std::max(nonZeroExtent[5], k);
+          }
+        }
+      }
+    }
+    if (IsExtentEmpty(nonZeroExtent))
+    {
+      nonZeroExtent[0] = nonZeroExtent[2] = nonZeroExtent[4] = 0;
+      nonZeroExtent[1] = nonZeroExtent[3] = nonZeroExtent[5] = -1;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Pack the rows of a labelmap within the operation extent into bit words (one bit per voxel, rows start on word boundaries)
+  template <class T> void PackRows(const T* labelmapPtr, const int extent[6], const int operationExtent[6],
+    int wordsPerRow, vtkTypeUInt64* bitsPtr)
+  {
+    // Part of the operation extent that is covered by the labelmap
+    int packedExtent[6] = {0,-1,0,-1,0,-1};
+    for (int axis=0; axis<3; ++axis)
+    {
+      packedExtent[2*axis] = std::max(extent[2*axis], operationExtent[2*axis]);
+      packedExtent[2*axis+1] = std::min(extent[2*axis+1], operationExtent[2*axis+1]);
+    }
+    if (IsExtentEmpty(packedExtent))
+    {
+      return;
+    }
+
+    vtkIdType dimensions[2] = { extent[1]-extent[0]+1, extent[3]-extent[2]+1 };
+    int operationDimensionY = operationExtent[3]-operationExtent[2]+1;
+    for (int k=packedExtent[4]; k<=packedExtent[5]; ++k)
+    {
+      for (int j=packedExtent[2]; j<=packedExtent[3]; ++j)
+      {
+        const T* voxelPtr = labelmapPtr
+          + (packedExtent[0]-extent[0]) + dimensions[0] * ((j-extent[2]) + dimensions[1] * (k-extent[4]));
+        vtkTypeUInt64* rowPtr = bitsPtr
+          + (vtkIdType)wordsPerRow * ((j-operationExtent[2]) + (vtkIdType)operationDimensionY * (k-operationExtent[4]));
+        for (int i=packedExtent[0]; i<=packedExtent[1]; ++i, ++voxelPtr)
+        {
+          if (*voxelPtr != 0)
+          {
+            int bitIndex = i - operationExtent[0];
+            rowPtr[bitIndex / BITS_PER_WORD] |= ((vtkTypeUInt64)1) << (bitIndex % BITS_PER_WORD);
+          }
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Set the output voxels of the set bits to the label value. The output needs to be zero-filled and contain the operation extent
+  template <class T> void UnpackRows(const vtkTypeUInt64* bitsPtr, int wordsPerRow, const int operationExtent[6],
+    T labelValue, T* outputPtr, const int outputExtent[6])
+  {
+    vtkIdType outputDimensions[2] = { outputExtent[1]-outputExtent[0]+1, outputExtent[3]-outputExtent[2]+1 };
+    const vtkTypeUInt64* wordPtr = bitsPtr;
+    for (int k=operationExtent[4]; k<=operationExtent[5]; ++k)
+    {
+      for (int j=operationExtent[2]; j<=operationExtent[3]; ++j)
+      {
+        T* rowPtr = outputPtr
+          + (operationExtent[0]-outputExtent[0]) + outputDimensions[0] * ((j-outputExtent[2]) + outputDimensions[1] * (k-outputExtent[4]));
+        for (int wordIndex=0; wordIndex<wordsPerRow; ++wordIndex, ++wordPtr)
+        {
+          vtkTypeUInt64 word = (*wordPtr);
+          for (int bit=0; word; ++bit, word >>= 1)
+          {
+            if (word & 1)
+            {
+              rowPtr[wordIndex * BITS_PER_WORD + bit] = labelValue;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkBinaryLabelmapBooleanOperation::vtkBinaryLabelmapBooleanOperation()
+{
+  this->OutputLabelmap = vtkImageData::New();
+  this->Operation = Union;
+  this->LabelValue = 1.0;
+  this->CropToResultExtent = true;
+}
+
+//----------------------------------------------------------------------------
+vtkBinaryLabelmapBooleanOperation::~vtkBinaryLabelmapBooleanOperation()
+{
+  this->RemoveAllInputLabelmaps();
+  if (this->OutputLabelmap)
+  {
+    this->OutputLabelmap->Delete();
+    this->OutputLabelmap = NULL;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkBinaryLabelmapBooleanOperation::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "NumberOfInputLabelmaps: " << this->InputLabelmaps.size() << "\n";
+  os << indent << "Operation: " << (this->Operation == Union ? "Union" : (this->Operation == Intersect ? "Intersect" : "Subtract")) << "\n";
+  os << indent << "LabelValue: " << this->LabelValue << "\n";
+  os << indent << "CropToResultExtent: " << (this->CropToResultExtent ? "true" : "false") << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkBinaryLabelmapBooleanOperation::SetInputLabelmap(int index, vtkImageData* imageData)
+{
+  if (index < 0)
+  {
+    vtkErrorMacro("SetInputLabelmap: Invalid input index " << index);
+    return;
+  }
+  if (index >= (int)this->InputLabelmaps.size())
+  {
+    this->InputLabelmaps.resize(index+1);
+  }
+  this->InputLabelmaps[index] = imageData;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkBinaryLabelmapBooleanOperation::GetInputLabelmap(int index)
+{
+  if (index < 0 || index >= (int)this->InputLabelmaps.size())
+  {
+    return NULL;
+  }
+  return this->InputLabelmaps[index];
+}
+
+//----------------------------------------------------------------------------
+void vtkBinaryLabelmapBooleanOperation::AddInputLabelmap(vtkImageData* imageData)
+{
+  this->InputLabelmaps.push_back(imageData);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkBinaryLabelmapBooleanOperation::RemoveAllInputLabelmaps()
+{
+  this->InputLabelmaps.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+bool vtkBinaryLabelmapBooleanOperation::GetNonZeroExtent(vtkImageData* labelmap, int nonZeroExtent[6])
+{
+  nonZeroExtent[0] = nonZeroExtent[2] = nonZeroExtent[4] = 0;
+  nonZeroExtent[1] = nonZeroExtent[3] = nonZeroExtent[5] = -1;
+  if (!labelmap || !labelmap->GetPointData()->GetScalars())
+  {
+    return false;
+  }
+  int extent[6] = {0,-1,0,-1,0,-1};
+  labelmap->GetExtent(extent);
+  if (IsExtentEmpty(extent))
+  {
+    return true;
+  }
+  switch (labelmap->GetScalarType())
+  {
+    vtkTemplateMacro( DetermineNonZeroExtent(static_cast<VTK_TT*>(labelmap->GetScalarPointer()), extent, nonZeroExtent) );
+    default:
+      return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkBinaryLabelmapBooleanOperation::Update()
+{
+  int numberOfInputs = (int)this->InputLabelmaps.size();
+  if (numberOfInputs < 2)
+  {
+    vtkErrorMacro("Update: At least two input labelmaps are needed!");
+    return false;
+  }
+  for (int inputIndex=0; inputIndex<numberOfInputs; ++inputIndex)
+  {
+    if (!this->InputLabelmaps[inputIndex] || !this->InputLabelmaps[inputIndex]->GetPointData()->GetScalars())
+    {
+      vtkErrorMacro("Update: Invalid input labelmap at index " << inputIndex << "!");
+      return false;
+    }
+  }
+
+  // Make sure the labelmaps are on the same lattice
+  vtkImageData* labelmapA = this->InputLabelmaps[0];
+  double spacingA[3] = {1.0, 1.0, 1.0};
+  labelmapA->GetSpacing(spacingA);
+  double originA[3] = {0.0, 0.0, 0.0};
+  labelmapA->GetOrigin(originA);
+  for (int inputIndex=1; inputIndex<numberOfInputs; ++inputIndex)
+  {
+    double spacing[3] = {1.0, 1.0, 1.0};
+    this->InputLabelmaps[inputIndex]->GetSpacing(spacing);
+    double origin[3] = {0.0, 0.0, 0.0};
+    this->InputLabelmaps[inputIndex]->GetOrigin(origin);
+    for (int axis=0; axis<3; ++axis)
+    {
+      if ( fabs(spacingA[axis] - spacing[axis]) > 1.0e-6 * fabs(spacingA[axis])
+        || fabs(originA[axis] - origin[axis]) > 1.0e-3 * fabs(spacingA[axis]) )
+      {
+        vtkErrorMacro("Update: Input labelmaps are not on the same lattice!");
+        return false;
+      }
+    }
+  }
+
+  // Bounding extents of the non-zero voxels. Further inputs only matter within the non-zero extent of A for intersection and subtraction
+  std::vector<int> extents(6*numberOfInputs, 0);
+  std::vector<int> nonZeroExtents(6*numberOfInputs, 0);
+  for (int inputIndex=0; inputIndex<numberOfInputs; ++inputIndex)
+  {
+    this->InputLabelmaps[inputIndex]->GetExtent(&(extents[6*inputIndex]));
+    int* nonZeroExtent = &(nonZeroExtents[6*inputIndex]);
+    nonZeroExtent[0] = nonZeroExtent[2] = nonZeroExtent[4] = 0;
+    nonZeroExtent[1] = nonZeroExtent[3] = nonZeroExtent[5] = -1;
+    if (inputIndex == 0 || this->Operation == Union || !IsExtentEmpty(&(nonZeroExtents[0])))
+    {
+      if (!GetNonZeroExtent(this->InputLabelmaps[inputIndex], nonZeroExtent))
+      {
+        vtkErrorMacro("Update: Unsupported scalar type in input labelmap at index " << inputIndex << "!");
+        return false;
+      }
+    }
+  }
+
+  // Extent where the result can be non-zero
+  int operationExtent[6] = {0,-1,0,-1,0,-1};
+  std::copy(nonZeroExtents.begin(), nonZeroExtents.begin()+6, operationExtent);
+  if (this->Operation != Subtract)
+  {
+    for (int inputIndex=1; inputIndex<numberOfInputs; ++inputIndex)
+    {
+      const int* nonZeroExtent = &(nonZeroExtents[6*inputIndex]);
+      if (this->Operation == Union && IsExtentEmpty(nonZeroExtent))
+      {
+        continue;
+      }
+      if (this->Operation == Union && IsExtentEmpty(operationExtent))
+      {
+        std::copy(nonZeroExtent, nonZeroExtent+6, operationExtent);
+        continue;
+      }
+      for (int axis=0; axis<3; ++axis)
+      {
+        if (this->Operation == Union)
+        {
+          operationExtent[2*axis] = std::min(operationExtent[2*axis], nonZeroExtent[2*axis]);
+          operationExtent[2*axis+1] = std::max(operationExtent[2*axis+1], nonZeroExtent[2*axis+1]);
+        }
+        else
+        {
+          operationExtent[2*axis] = std::max(operationExtent[2*axis], nonZeroExtent[2*axis]);
+          operationExtent[2*axis+1] = std::min(operationExtent[2*axis+1], nonZeroExtent[2*axis+1]);
+        }
+      }
+    }
+  }
+  bool emptyResult = IsExtentEmpty(operationExtent);
+
+  // Allocate zero-filled output
+  int outputExtent[6] = {0,-1,0,-1,0,-1};
+  if (this->CropToResultExtent)
+  {
+    if (!emptyResult)
+    {
+      std::copy(operationExtent, operationExtent+6, outputExtent);
+    }
+  }
+  else
+  {
+    std::copy(extents.begin(), extents.begin()+6, outputExtent);
+    for (int inputIndex=1; inputIndex<numberOfInputs; ++inputIndex)
+    {
+      for (int axis=0; axis<3; ++axis)
+      {
+        outputExtent[2*axis] = std::min(outputExtent[2*axis], extents[6*inputIndex+2*axis]);
+        outputExtent[2*axis+1] = std::max(outputExtent[2*axis+1], extents[6*inputIndex+2*axis+1]);
+      }
+    }
+  }
+  this->OutputLabelmap->SetExtent(outputExtent);
+  this->OutputLabelmap->SetOrigin(originA);
+  this->OutputLabelmap->SetSpacing(spacingA);
+  this->OutputLabelmap->AllocateScalars(labelmapA->GetScalarType(), 1);
+  if (this->OutputLabelmap->GetNumberOfPoints() > 0)
+  {
+    memset(this->OutputLabelmap->GetScalarPointer(), 0,
+      this->OutputLabelmap->GetNumberOfPoints() * this->OutputLabelmap->GetScalarSize());
+  }
+  if (emptyResult)
+  {
+    this->OutputLabelmap->Modified();
+    return true;
+  }
+
+  // Pack the rows of the labelmaps within the operation extent and combine them with the result, 64 voxels per operation
+  int wordsPerRow = (operationExtent[1]-operationExtent[0]+1 + BITS_PER_WORD-1) / BITS_PER_WORD;
+  vtkIdType numberOfWords = (vtkIdType)wordsPerRow
+    * (operationExtent[3]-operationExtent[2]+1) * (operationExtent[5]-operationExtent[4]+1);
+  std::vector<vtkTypeUInt64> resultBits(numberOfWords, 0);
+  std::vector<vtkTypeUInt64> inputBits;
+  for (int inputIndex=0; inputIndex<numberOfInputs; ++inputIndex)
+  {
+    const int* nonZeroExtent = &(nonZeroExtents[6*inputIndex]);
+    bool overlapsOperationExtent = true;
+    for (int axis=0; axis<3; ++axis)
+    {
+      if ( nonZeroExtent[2*axis] > operationExtent[2*axis+1] || nonZeroExtent[2*axis+1] < operationExtent[2*axis]
+        || nonZeroExtent[2*axis] > nonZeroExtent[2*axis+1] )
+      {
+        overlapsOperationExtent = false;
+      }
+    }
+    if (!overlapsOperationExtent)
+    {
+      // No effect on the result (intersections with non-overlapping inputs have an empty operation extent)
+      continue;
+    }
+
+    vtkImageData* labelmap = this->InputLabelmaps[inputIndex];
+    vtkTypeUInt64* bitsPtr = &(resultBits[0]);
+    if (inputIndex > 0 && this->Operation != Union)
+    {
+      inputBits.assign(numberOfWords, 0);
+      bitsPtr = &(inputBits[0]);
+    }
+    switch (labelmap->GetScalarType())
+    {
+      vtkTemplateMacro( PackRows(static_cast<VTK_TT*>(labelmap->GetScalarPointer()), &(extents[6*inputIndex]), operationExtent, wordsPerRow, bitsPtr) );
+    }
+    if (bitsPtr == &(resultBits[0]))
+    {
+      // Union is packed directly into the result
+      continue;
+    }
+
+    vtkTypeUInt64* resultWordPtr = &(resultBits[0]);
+    const vtkTypeUInt64* inputWordPtr = &(inputBits[0]);
+    if (this->Operation == Intersect)
+    {
+      for (vtkIdType wordIndex=0; wordIndex<numberOfWords; ++wordIndex, ++resultWordPtr, ++inputWordPtr)
+      {
+        (*resultWordPtr) &= (*inputWordPtr);
+      }
+    }
+    else
+    {
+      for (vtkIdType wordIndex=0; wordIndex<numberOfWords; ++wordIndex, ++resultWordPtr, ++inputWordPtr)
+      {
+        (*resultWordPtr) &= ~(*inputWordPtr);
+      }
+    }
+  }
+
+  switch (this->OutputLabelmap->GetScalarType())
+  {
+    vtkTemplateMacro( UnpackRows(&(resultBits[0]), wordsPerRow, operationExtent, static_cast<VTK_TT>(this->LabelValue),
+      static_cast<VTK_TT*>(this->OutputLabelmap->GetScalarPointer()), outputExtent) );
+  }
+
+  this->OutputLabelmap->Modified();
+  return true;
+}
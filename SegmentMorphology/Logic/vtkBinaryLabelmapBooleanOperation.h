@@ -0,0 +1,133 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#ifndef __vtkBinaryLabelmapBooleanOperation_h
+#define __vtkBinaryLabelmapBooleanOperation_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <vector>
+
+#include "vtkSlicerSegmentMorphologyModuleLogicExport.h"
+
+class vtkImageData;
+
+/// \ingroup SlicerRt_QtModules_SegmentMorphology
+/// \class vtkBinaryLabelmapBooleanOperation
+/// \brief Union, intersection or subtraction of binary labelmaps on bit-packed rows.
+///
+/// The operation is only evaluated within the bounding extent of the non-zero voxels that can be in the result
+/// (union of the non-zero extents for union, their intersection for intersection, and the non-zero extent of A
+/// for subtraction). The image rows within this extent are packed into 64-bit words, so one word operation
+/// processes 64 voxels, and only the set bits are written to the output.
+///
+/// More than two labelmaps can be combined in one pass: union and intersection are applied on all inputs, and
+/// subtraction removes all further inputs from the first one (A).
+///
+/// The labelmaps need to be on the same lattice (same origin, spacing and directions), but their extents and
+/// scalar types may differ. The output has the scalar type of labelmap A.
+class VTK_SLICER_SEGMENTMORPHOLOGY_MODULE_LOGIC_EXPORT vtkBinaryLabelmapBooleanOperation : public vtkObject
+{
+public:
+  enum
+  {
+    Union = 0,
+    Intersect,
+    Subtract
+  };
+
+public:
+  static vtkBinaryLabelmapBooleanOperation *New();
+  vtkTypeMacro(vtkBinaryLabelmapBooleanOperation, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Set first input binary labelmap (single component, any scalar type, non-zero voxels are inside)
+  void SetInputLabelmapA(vtkImageData* imageData) { this->SetInputLabelmap(0, imageData); };
+  vtkImageData* GetInputLabelmapA() { return this->GetInputLabelmap(0); };
+
+  /// Set second input binary labelmap (single component, any scalar type, non-zero voxels are inside)
+  void SetInputLabelmapB(vtkImageData* imageData) { this->SetInputLabelmap(1, imageData); };
+  vtkImageData* GetInputLabelmapB() { return this->GetInputLabelmap(1); };
+
+  /// Set input binary labelmap at a given index (the list of inputs is extended if needed)
+  void SetInputLabelmap(int index, vtkImageData* imageData);
+  /// Get input binary labelmap at a given index. Returns NULL if there is no input at the index
+  vtkImageData* GetInputLabelmap(int index);
+  /// Append input binary labelmap
+  void AddInputLabelmap(vtkImageData* imageData);
+  /// Remove all input labelmaps
+  void RemoveAllInputLabelmaps();
+  /// Get number of input labelmaps
+  int GetNumberOfInputLabelmaps() { return (int)this->InputLabelmaps.size(); };
+
+  /// Get output labelmap (same scalar type, origin and spacing as input A)
+  vtkGetObjectMacro(OutputLabelmap, vtkImageData);
+
+  /// Set operation. Default is union
+  vtkSetClampMacro(Operation, int, Union, Subtract);
+  vtkGetMacro(Operation, int);
+  void SetOperationToUnion() { this->SetOperation(Union); };
+  void SetOperationToIntersect() { this->SetOperation(Intersect); };
+  void SetOperationToSubtract() { this->SetOperation(Subtract); };
+
+  /// Set value of the inside voxels in the output. Default is 1
+  vtkSetMacro(LabelValue, double);
+  vtkGetMacro(LabelValue, double);
+
+  /// If on, then the output extent is the bounding extent of the result, and it is empty if the result is empty.
+  /// If off, then the output extent is the union of the input extents. Default is on
+  vtkSetMacro(CropToResultExtent, bool);
+  vtkGetMacro(CropToResultExtent, bool);
+  vtkBooleanMacro(CropToResultExtent, bool);
+
+  /// Compute the output labelmap
+  /// \return Success flag
+  bool Update();
+
+  /// Determine the bounding extent of the non-zero voxels of a labelmap. The extent is empty (0,-1,0,-1,0,-1)
+  /// if the labelmap has no non-zero voxels
+  /// \return Success flag
+  static bool GetNonZeroExtent(vtkImageData* labelmap, int nonZeroExtent[6]);
+
+protected:
+  vtkBinaryLabelmapBooleanOperation();
+  virtual ~vtkBinaryLabelmapBooleanOperation();
+
+protected:
+  /// Input labelmaps
+  std::vector< vtkSmartPointer<vtkImageData> > InputLabelmaps;
+  /// Output labelmap
+  vtkImageData* OutputLabelmap;
+  /// Union, intersect or subtract
+  int Operation;
+  /// Value of the inside voxels in the output
+  double LabelValue;
+  /// Flag determining whether the output is cropped to the extent of the result
+  bool CropToResultExtent;
+
+private:
+  vtkBinaryLabelmapBooleanOperation(const vtkBinaryLabelmapBooleanOperation&); // Not implemented
+  void operator=(const vtkBinaryLabelmapBooleanOperation&);                    // Not implemented
+};
+
+#endif
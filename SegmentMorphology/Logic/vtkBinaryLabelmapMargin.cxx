@@ -0,0 +1,172 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkBinaryLabelmapMargin.h"
+
+// SlicerRtCommon includes
+#include "vtkEuclideanDistanceTransform.h"
+
+// VTK includes
+#include <vtkImageConstantPad.h>
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cmath>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkBinaryLabelmapMargin);
+
+vtkCxxSetObjectMacro(vtkBinaryLabelmapMargin, InputLabelmap, vtkImageData);
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /// Tolerance of the distance threshold (the distances are computed in single precision)
+  const float DISTANCE_THRESHOLD_EPSILON = 1.0e-6f;
+
+  //----------------------------------------------------------------------------
+  /// Set the output voxels from the scaled squared distances: voxels within the margin ellipsoid have distance <= 1
+  template <class T> void ThresholdDistances(const T* inputPtr, const float* squaredDistancePtr, vtkIdType numberOfVoxels,
+    bool expand, T labelValue, T* outputPtr)
+  {
+    for (vtkIdType index=0; index<numberOfVoxels; ++index)
+    {
+      bool withinMargin = (squaredDistancePtr[index] <= 1.0f + DISTANCE_THRESHOLD_EPSILON);
+      if (expand)
+      {
+        // Distance to the object
+        outputPtr[index] = (withinMargin ? labelValue : 0);
+      }
+      else
+      {
+        // Distance to the background
+        outputPtr[index] = (inputPtr[index] != 0 && !withinMargin ? labelValue : 0);
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkBinaryLabelmapMargin::vtkBinaryLabelmapMargin()
+{
+  this->InputLabelmap = NULL;
+  this->OutputLabelmap = vtkImageData::New();
+  this->Operation = Expand;
+  this->MarginMm[0] = this->MarginMm[1] = this->MarginMm[2] = 0.0;
+  this->LabelValue = 1.0;
+  this->NumberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+}
+
+//----------------------------------------------------------------------------
+vtkBinaryLabelmapMargin::~vtkBinaryLabelmapMargin()
+{
+  this->SetInputLabelmap(NULL);
+  if (this->OutputLabelmap)
+  {
+    this->OutputLabelmap->Delete();
+    this->OutputLabelmap = NULL;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkBinaryLabelmapMargin::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "Operation: " << (this->Operation == Expand ? "Expand" : "Shrink") << "\n";
+  os << indent << "MarginMm: " << this->MarginMm[0] << ", " << this->MarginMm[1] << ", " << this->MarginMm[2] << "\n";
+  os << indent << "LabelValue: " << this->LabelValue << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+}
+
+//----------------------------------------------------------------------------
+bool vtkBinaryLabelmapMargin::Update()
+{
+  if (!this->InputLabelmap || !this->InputLabelmap->GetPointData()->GetScalars())
+  {
+    vtkErrorMacro("Update: Invalid input labelmap!");
+    return false;
+  }
+
+  // Margin ellipsoid radii in voxels, rounded the same way as the morphology kernels
+  double spacing[3] = {1.0, 1.0, 1.0};
+  this->InputLabelmap->GetSpacing(spacing);
+  double scaledSpacing[3] = {1.0, 1.0, 1.0};
+  double evaluationOffset[3] = {0.0, 0.0, 0.0};
+  int padding[3] = {0, 0, 0};
+  for (int axis=0; axis<3; ++axis)
+  {
+    double marginVoxels = fabs(this->MarginMm[axis] / spacing[axis]);
+    int kernelSize = (int)( 2.0*(marginVoxels + 0.5) );
+    // The squared distance is 1 on the ellipsoid of radius kernelSize/2
+    scaledSpacing[axis] = 2.0 / kernelSize;
+    // Even kernels are centered half a voxel before the voxel
+    evaluationOffset[axis] = (kernelSize % 2 == 0 ? -0.5 : 0.0);
+    padding[axis] = (int)(marginVoxels + 1.0); // Rounding up
+  }
+
+  // Pad image by the margin when expanding (extents are fitted to the structure)
+  vtkSmartPointer<vtkImageData> inputLabelmap = this->InputLabelmap;
+  if (this->Operation == Expand)
+  {
+    int extent[6] = {0,-1,0,-1,0,-1};
+    this->InputLabelmap->GetExtent(extent);
+    vtkSmartPointer<vtkImageConstantPad> padder = vtkSmartPointer<vtkImageConstantPad>::New();
+    padder->SetInputData(this->InputLabelmap);
+    padder->SetOutputWholeExtent(extent[0]-padding[0], extent[1]+padding[0], extent[2]-padding[1], extent[3]+padding[1], extent[4]-padding[2], extent[5]+padding[2]);
+    padder->Update();
+    inputLabelmap = padder->GetOutput();
+  }
+
+  vtkSmartPointer<vtkEuclideanDistanceTransform> distanceTransform = vtkSmartPointer<vtkEuclideanDistanceTransform>::New();
+  distanceTransform->SetInputImageData(inputLabelmap);
+  distanceTransform->SetFeatureMode(this->Operation == Expand
+    ? vtkEuclideanDistanceTransform::DistanceToObject : vtkEuclideanDistanceTransform::DistanceToBackground);
+  distanceTransform->UseImageSpacingOff();
+  distanceTransform->SetSpacing(scaledSpacing);
+  distanceTransform->SetEvaluationOffset(evaluationOffset);
+  distanceTransform->SetNumberOfThreads(this->NumberOfThreads);
+  if (!distanceTransform->Update())
+  {
+    vtkErrorMacro("Update: Failed to compute distance transform!");
+    return false;
+  }
+
+  this->OutputLabelmap->SetExtent(inputLabelmap->GetExtent());
+  this->OutputLabelmap->SetOrigin(inputLabelmap->GetOrigin());
+  this->OutputLabelmap->SetSpacing(inputLabelmap->GetSpacing());
+  this->OutputLabelmap->AllocateScalars(inputLabelmap->GetScalarType(), 1);
+  const float* squaredDistancePtr = static_cast<float*>(distanceTransform->GetOutputImageData()->GetScalarPointer());
+  switch (inputLabelmap->GetScalarType())
+  {
+    vtkTemplateMacro( ThresholdDistances(static_cast<VTK_TT*>(inputLabelmap->GetScalarPointer()), squaredDistancePtr,
+      inputLabelmap->GetNumberOfPoints(), this->Operation == Expand, static_cast<VTK_TT>(this->LabelValue),
+      static_cast<VTK_TT*>(this->OutputLabelmap->GetScalarPointer())) );
+    default:
+      vtkErrorMacro("Update: Unsupported input labelmap scalar type!");
+      return false;
+  }
+
+  this->OutputLabelmap->Modified();
+  return true;
+}
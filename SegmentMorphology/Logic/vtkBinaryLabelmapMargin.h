@@ -0,0 +1,110 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#ifndef __vtkBinaryLabelmapMargin_h
+#define __vtkBinaryLabelmapMargin_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkMultiThreader.h>
+
+#include "vtkSlicerSegmentMorphologyModuleLogicExport.h"
+
+class vtkImageData;
+
+/// \ingroup SlicerRt_QtModules_SegmentMorphology
+/// \class vtkBinaryLabelmapMargin
+/// \brief Expand or shrink a binary labelmap by an anisotropic margin using a Euclidean distance transform.
+///
+/// A voxel is added (expand) if an object voxel is within the margin ellipsoid around it, and removed (shrink)
+/// if a background voxel is within the margin ellipsoid around it. The distances are computed by
+/// \sa vtkEuclideanDistanceTransform, so the cost is linear in the number of voxels regardless of the margin.
+///
+/// The margin ellipsoid is rounded to the voxel grid the same way as the ellipsoid kernels of
+/// vtkImageContinuousDilate3D and vtkImageContinuousErode3D with a kernel size of (int)(2*(margin/spacing+0.5)),
+/// so the results are identical to those of the morphology filters. When expanding, the output is padded
+/// by the margin so that the expanded object fits.
+class VTK_SLICER_SEGMENTMORPHOLOGY_MODULE_LOGIC_EXPORT vtkBinaryLabelmapMargin : public vtkObject
+{
+public:
+  enum
+  {
+    Expand = 0,
+    Shrink
+  };
+
+public:
+  static vtkBinaryLabelmapMargin *New();
+  vtkTypeMacro(vtkBinaryLabelmapMargin, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Set input binary labelmap (single component, any scalar type, non-zero voxels are inside)
+  void SetInputLabelmap(vtkImageData* imageData);
+  vtkGetObjectMacro(InputLabelmap, vtkImageData);
+
+  /// Get output labelmap (same scalar type, origin and spacing as the input)
+  vtkGetObjectMacro(OutputLabelmap, vtkImageData);
+
+  /// Set operation (expand or shrink). Default is expand
+  vtkSetClampMacro(Operation, int, Expand, Shrink);
+  vtkGetMacro(Operation, int);
+  void SetOperationToExpand() { this->SetOperation(Expand); };
+  void SetOperationToShrink() { this->SetOperation(Shrink); };
+
+  /// Set margin along the image axes (mm)
+  vtkSetVector3Macro(MarginMm, double);
+  vtkGetVector3Macro(MarginMm, double);
+
+  /// Set value of the inside voxels in the output. Default is 1
+  vtkSetMacro(LabelValue, double);
+  vtkGetMacro(LabelValue, double);
+
+  /// Number of threads used for the distance transform. By default the number of processors is used
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_MAX_THREADS);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Compute the output labelmap
+  /// \return Success flag
+  bool Update();
+
+protected:
+  vtkBinaryLabelmapMargin();
+  virtual ~vtkBinaryLabelmapMargin();
+
+protected:
+  /// Input labelmap
+  vtkImageData* InputLabelmap;
+  /// Output labelmap
+  vtkImageData* OutputLabelmap;
+  /// Expand or shrink
+  int Operation;
+  /// Margin along the image axes
+  double MarginMm[3];
+  /// Value of the inside voxels in the output
+  double LabelValue;
+  /// Number of threads
+  int NumberOfThreads;
+
+private:
+  vtkBinaryLabelmapMargin(const vtkBinaryLabelmapMargin&); // Not implemented
+  void operator=(const vtkBinaryLabelmapMargin&);          // Not implemented
+};
+
+#endif
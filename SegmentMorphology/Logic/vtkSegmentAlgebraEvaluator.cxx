@@ -0,0 +1,1061 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkSegmentAlgebraEvaluator.h"
+#include "vtkBinaryLabelmapBooleanOperation.h"
+#include "vtkBinaryLabelmapMargin.h"
+
+// Segmentation includes
+#include "vtkOrientedImageData.h"
+#include "vtkOrientedImageDataResample.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+
+// STD includes
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSegmentAlgebraEvaluator);
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /// UTF-8 encoded operator symbols
+  const char* UNION_SYMBOL = "\xE2\x88\xAA";
+  const char* INTERSECTION_SYMBOL = "\xE2\x88\xA9";
+  const char* MINUS_SYMBOL = "\xE2\x88\x92";
+  const char* EXPAND_SYMBOL = "\xE2\x8A\x95";
+  const char* SHRINK_SYMBOL = "\xE2\x8A\x96";
+
+  //----------------------------------------------------------------------------
+  bool IsExtentEmpty(const int extent[6])
+  {
+    return (extent[0] > extent[1] || extent[2] > extent[3] || extent[4] > extent[5]);
+  }
+
+  //----------------------------------------------------------------------------
+  void SetEmptyExtent(int extent[6])
+  {
+    extent[0] = extent[2] = extent[4] = 0;
+    extent[1] = extent[3] = extent[5] = -1;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Intersect extents. The result may be the same array as one of the extents
+  void IntersectExtents(const int extent1[6], const int extent2[6], int result[6])
+  {
+    for (int axis=0; axis<3; ++axis)
+    {
+      result[2*axis] = std::max(extent1[2*axis], extent2[2*axis]);
+      result[2*axis+1] = std::min(extent1[2*axis+1], extent2[2*axis+1]);
+    }
+    if (IsExtentEmpty(result))
+    {
+      SetEmptyExtent(result);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Extend extent to contain another extent. Empty extents are ignored
+  void MergeExtents(int extent[6], const int addedExtent[6])
+  {
+    if (IsExtentEmpty(addedExtent))
+    {
+      return;
+    }
+    if (IsExtentEmpty(extent))
+    {
+      std::copy(addedExtent, addedExtent+6, extent);
+      return;
+    }
+    for (int axis=0; axis<3; ++axis)
+    {
+      extent[2*axis] = std::min(extent[2*axis], addedExtent[2*axis]);
+      extent[2*axis+1] = std::max(extent[2*axis+1], addedExtent[2*axis+1]);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Grow extent by a number of voxels along each axis. Empty extents stay empty
+  void PadExtent(const int extent[6], const int padding[3], int result[6])
+  {
+    if (IsExtentEmpty(extent))
+    {
+      SetEmptyExtent(result);
+      return;
+    }
+    for (int axis=0; axis<3; ++axis)
+    {
+      result[2*axis] = extent[2*axis] - padding[axis];
+      result[2*axis+1] = extent[2*axis+1] + padding[axis];
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void SkipWhitespace(const std::string& expression, size_t& position)
+  {
+    while (position < expression.size() && isspace((unsigned char)expression[position]))
+    {
+      ++position;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Advance the position after the symbol if the next non-whitespace characters are the symbol
+  bool MatchSymbol(const std::string& expression, size_t& position, const char* symbol)
+  {
+    size_t symbolPosition = position;
+    SkipWhitespace(expression, symbolPosition);
+    size_t symbolLength = strlen(symbol);
+    if (expression.compare(symbolPosition, symbolLength, symbol) != 0)
+    {
+      return false;
+    }
+    position = symbolPosition + symbolLength;
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  bool IsNameCharacter(char character, bool firstCharacter)
+  {
+    unsigned char c = (unsigned char)character;
+    if (c >= 128)
+    {
+      return false;
+    }
+    return (isalpha(c) || c == '_' || (!firstCharacter && (isdigit(c) || c == '.')));
+  }
+
+  //----------------------------------------------------------------------------
+  std::string TrimWhitespace(const std::string& text)
+  {
+    size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos)
+    {
+      return "";
+    }
+    size_t last = text.find_last_not_of(" \t\r\n");
+    return text.substr(first, last-first+1);
+  }
+
+  //----------------------------------------------------------------------------
+  /// Copy the voxels of the input within the output extent
+  template <class T> void CopyExtent(const T* inputPtr, const int inputExtent[6], T* outputPtr, const int outputExtent[6])
+  {
+    int copiedExtent[6] = {0,-1,0,-1,0,-1};
+    IntersectExtents(inputExtent, outputExtent, copiedExtent);
+    if (IsExtentEmpty(copiedExtent))
+    {
+      return;
+    }
+    vtkIdType inputDimensions[2] = { inputExtent[1]-inputExtent[0]+1, inputExtent[3]-inputExtent[2]+1 };
+    vtkIdType outputDimensions[2] = { outputExtent[1]-outputExtent[0]+1, outputExtent[3]-outputExtent[2]+1 };
+    size_t rowSize = sizeof(T) * (copiedExtent[1]-copiedExtent[0]+1);
+    for (int k=copiedExtent[4]; k<=copiedExtent[5]; ++k)
+    {
+      for (int j=copiedExtent[2]; j<=copiedExtent[3]; ++j)
+      {
+        memcpy( outputPtr + (copiedExtent[0]-outputExtent[0]) + outputDimensions[0] * ((j-outputExtent[2]) + outputDimensions[1] * (k-outputExtent[4])),
+          inputPtr + (copiedExtent[0]-inputExtent[0]) + inputDimensions[0] * ((j-inputExtent[2]) + inputDimensions[1] * (k-inputExtent[4])),
+          rowSize );
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Create labelmap with the given extent that contains the input voxels within the extent and zeros elsewhere
+  vtkSmartPointer<vtkImageData> ExtractExtent(vtkImageData* input, const int extent[6])
+  {
+    int outputExtent[6] = {0,-1,0,-1,0,-1};
+    std::copy(extent, extent+6, outputExtent);
+    vtkSmartPointer<vtkImageData> output = vtkSmartPointer<vtkImageData>::New();
+    output->SetExtent(outputExtent);
+    output->SetOrigin(input->GetOrigin());
+    output->SetSpacing(input->GetSpacing());
+    output->AllocateScalars(input->GetScalarType(), 1);
+    if (output->GetNumberOfPoints() == 0)
+    {
+      return output;
+    }
+    memset(output->GetScalarPointer(), 0, output->GetNumberOfPoints() * output->GetScalarSize());
+
+    int inputExtent[6] = {0,-1,0,-1,0,-1};
+    input->GetExtent(inputExtent);
+    if (IsExtentEmpty(inputExtent))
+    {
+      return output;
+    }
+    switch (input->GetScalarType())
+    {
+      vtkTemplateMacro( CopyExtent(static_cast<VTK_TT*>(input->GetScalarPointer()), inputExtent,
+        static_cast<VTK_TT*>(output->GetScalarPointer()), outputExtent) );
+    }
+    return output;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkSegmentAlgebraEvaluator::vtkSegmentAlgebraEvaluator()
+{
+  this->NumberOfEvaluatedOperations = 0;
+}
+
+//----------------------------------------------------------------------------
+vtkSegmentAlgebraEvaluator::~vtkSegmentAlgebraEvaluator()
+{
+  this->RemoveAllStructures();
+  this->RemoveAllSegmentLabelmaps();
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentAlgebraEvaluator::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "NumberOfStructures: " << this->Structures.size() << "\n";
+  for (std::vector<Structure>::iterator structureIt = this->Structures.begin(); structureIt != this->Structures.end(); ++structureIt)
+  {
+    os << indent.GetNextIndent() << structureIt->Name << "\n";
+  }
+  os << indent << "NumberOfNodes: " << this->Nodes.size() << "\n";
+  os << indent << "NumberOfSegmentLabelmaps: " << this->SegmentLabelmaps.size() << "\n";
+  os << indent << "NumberOfEvaluatedOperations: " << this->NumberOfEvaluatedOperations << "\n";
+}
+
+//----------------------------------------------------------------------------
+bool vtkSegmentAlgebraEvaluator::AddStructure(const char* name, const char* expression)
+{
+  if (!name || !expression)
+  {
+    vtkErrorMacro("AddStructure: Invalid structure name or expression!");
+    return false;
+  }
+
+  std::string expressionString(expression);
+  size_t position = 0;
+  this->ParseErrorMessage.clear();
+  int nodeIndex = this->ParseUnion(expressionString, position);
+  if (nodeIndex >= 0)
+  {
+    SkipWhitespace(expressionString, position);
+    if (position < expressionString.size())
+    {
+      std::stringstream ss;
+      ss << "Unexpected character '" << expressionString[position] << "' at position " << position;
+      this->ParseErrorMessage = ss.str();
+      nodeIndex = -1;
+    }
+  }
+  if (nodeIndex < 0)
+  {
+    vtkErrorMacro("AddStructure: Failed to parse expression '" << expressionString << "' of structure " << name << ": " << this->ParseErrorMessage);
+    return false;
+  }
+
+  Structure structure;
+  structure.Name = std::string(name);
+  structure.NodeIndex = nodeIndex;
+  this->Structures.push_back(structure);
+  this->UpdateReferencedSegmentNames();
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSegmentAlgebraEvaluator::AddStructures(const char* definitions)
+{
+  if (!definitions)
+  {
+    vtkErrorMacro("AddStructures: Invalid structure definitions!");
+    return false;
+  }
+
+  std::string definitionsString(definitions);
+  size_t definitionStart = 0;
+  while (definitionStart <= definitionsString.size())
+  {
+    size_t definitionEnd = definitionsString.find_first_of(";\n", definitionStart);
+    if (definitionEnd == std::string::npos)
+    {
+      definitionEnd = definitionsString.size();
+    }
+    std::string definition = TrimWhitespace(definitionsString.substr(definitionStart, definitionEnd-definitionStart));
+    definitionStart = definitionEnd + 1;
+    if (definition.empty())
+    {
+      continue;
+    }
+
+    size_t equalSignPosition = definition.find('=');
+    std::string name = TrimWhitespace(definition.substr(0, equalSignPosition));
+    if (name.size() >= 2 && name[0] == '"' && name[name.size()-1] == '"')
+    {
+      name = name.substr(1, name.size()-2);
+    }
+    if (equalSignPosition == std::string::npos || name.empty())
+    {
+      vtkErrorMacro("AddStructures: Invalid structure definition '" << definition << "', it needs to be of the form 'name = expression'");
+      return false;
+    }
+    if (!this->AddStructure(name.c_str(), definition.substr(equalSignPosition+1).c_str()))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentAlgebraEvaluator::RemoveAllStructures()
+{
+  this->Structures.clear();
+  this->Nodes.clear();
+  this->NodeIndicesByKey.clear();
+  this->ReferencedSegmentNames.clear();
+  this->NumberOfEvaluatedOperations = 0;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+const char* vtkSegmentAlgebraEvaluator::GetStructureName(int structureIndex)
+{
+  if (structureIndex < 0 || structureIndex >= (int)this->Structures.size())
+  {
+    vtkErrorMacro("GetStructureName: Invalid structure index " << structureIndex);
+    return NULL;
+  }
+  return this->Structures[structureIndex].Name.c_str();
+}
+
+//----------------------------------------------------------------------------
+vtkOrientedImageData* vtkSegmentAlgebraEvaluator::GetStructureLabelmap(int structureIndex)
+{
+  if (structureIndex < 0 || structureIndex >= (int)this->Structures.size())
+  {
+    vtkErrorMacro("GetStructureLabelmap: Invalid structure index " << structureIndex);
+    return NULL;
+  }
+  return this->Structures[structureIndex].Labelmap;
+}
+
+//----------------------------------------------------------------------------
+const char* vtkSegmentAlgebraEvaluator::GetReferencedSegmentName(int segmentIndex)
+{
+  if (segmentIndex < 0 || segmentIndex >= (int)this->ReferencedSegmentNames.size())
+  {
+    vtkErrorMacro("GetReferencedSegmentName: Invalid segment index " << segmentIndex);
+    return NULL;
+  }
+  return this->ReferencedSegmentNames[segmentIndex].c_str();
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentAlgebraEvaluator::SetSegmentLabelmap(const char* name, vtkOrientedImageData* labelmap)
+{
+  if (!name)
+  {
+    vtkErrorMacro("SetSegmentLabelmap: Invalid segment name!");
+    return;
+  }
+  if (labelmap)
+  {
+    this->SegmentLabelmaps[std::string(name)] = labelmap;
+  }
+  else
+  {
+    this->SegmentLabelmaps.erase(std::string(name));
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentAlgebraEvaluator::RemoveAllSegmentLabelmaps()
+{
+  this->SegmentLabelmaps.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkSegmentAlgebraEvaluator::ParseUnion(const std::string& expression, size_t& position)
+{
+  int nodeIndex = this->ParseIntersection(expression, position);
+  while (nodeIndex >= 0)
+  {
+    int type = UnionOperation;
+    if ( MatchSymbol(expression, position, "|") || MatchSymbol(expression, position, "+")
+      || MatchSymbol(expression, position, UNION_SYMBOL) )
+    {
+      type = UnionOperation;
+    }
+    else if (MatchSymbol(expression, position, "-") || MatchSymbol(expression, position, MINUS_SYMBOL))
+    {
+      type = SubtractOperation;
+    }
+    else
+    {
+      break;
+    }
+
+    int operandIndex = this->ParseIntersection(expression, position);
+    if (operandIndex < 0)
+    {
+      return -1;
+    }
+    nodeIndex = this->AddBooleanNode(type, nodeIndex, operandIndex);
+  }
+  return nodeIndex;
+}
+
+//----------------------------------------------------------------------------
+int vtkSegmentAlgebraEvaluator::ParseIntersection(const std::string& expression, size_t& position)
+{
+  int nodeIndex = this->ParseOperand(expression, position);
+  while ( nodeIndex >= 0
+    && (MatchSymbol(expression, position, "&") || MatchSymbol(expression, position, INTERSECTION_SYMBOL)) )
+  {
+    int operandIndex = this->ParseOperand(expression, position);
+    if (operandIndex < 0)
+    {
+      return -1;
+    }
+    nodeIndex = this->AddBooleanNode(IntersectOperation, nodeIndex, operandIndex);
+  }
+  return nodeIndex;
+}
+
+//----------------------------------------------------------------------------
+int vtkSegmentAlgebraEvaluator::ParseOperand(const std::string& expression, size_t& position)
+{
+  int nodeIndex = -1;
+  size_t unquotedNameEndPosition = std::string::npos;
+  if (MatchSymbol(expression, position, "("))
+  {
+    nodeIndex = this->ParseUnion(expression, position);
+    if (nodeIndex < 0)
+    {
+      return -1;
+    }
+    if (!MatchSymbol(expression, position, ")"))
+    {
+      std::stringstream ss;
+      ss << "Missing closing parenthesis at position " << position;
+      this->ParseErrorMessage = ss.str();
+      return -1;
+    }
+  }
+  else
+  {
+    // Segment name
+    SkipWhitespace(expression, position);
+    std::string segmentName;
+    if (position < expression.size() && expression[position] == '"')
+    {
+      size_t closingQuotePosition = expression.find('"', position+1);
+      if (closingQuotePosition == std::string::npos)
+      {
+        std::stringstream ss;
+        ss << "Missing closing quote of segment name at position " << position;
+        this->ParseErrorMessage = ss.str();
+        return -1;
+      }
+      segmentName = expression.substr(position+1, closingQuotePosition-position-1);
+      position = closingQuotePosition + 1;
+    }
+    else
+    {
+      size_t nameStart = position;
+      while (position < expression.size() && IsNameCharacter(expression[position], position == nameStart))
+      {
+        ++position;
+      }
+      segmentName = expression.substr(nameStart, position-nameStart);
+      unquotedNameEndPosition = position;
+    }
+    if (segmentName.empty())
+    {
+      std::stringstream ss;
+      ss << "Segment name expected at position " << position;
+      this->ParseErrorMessage = ss.str();
+      return -1;
+    }
+    nodeIndex = this->AddSegmentNode(segmentName);
+  }
+
+  // Margins
+  while (true)
+  {
+    size_t operatorPosition = position;
+    int type = ExpandOperation;
+    bool marginRequired = false;
+    if (MatchSymbol(expression, position, EXPAND_SYMBOL))
+    {
+      marginRequired = true;
+    }
+    else if (MatchSymbol(expression, position, SHRINK_SYMBOL))
+    {
+      type = ShrinkOperation;
+      marginRequired = true;
+    }
+    else if (MatchSymbol(expression, position, "-") || MatchSymbol(expression, position, MINUS_SYMBOL))
+    {
+      type = ShrinkOperation;
+
+      // A name directly followed by '-' and a number (such as PTV-70) is most likely a segment name, not a shrink
+      if ( operatorPosition == unquotedNameEndPosition && expression[operatorPosition] == '-'
+        && position < expression.size() && isdigit((unsigned char)expression[position]) )
+      {
+        std::stringstream ss;
+        ss << "Ambiguous '-' at position " << operatorPosition
+          << " (segment names containing '-' need to be quoted, shrink margins need to be separated by whitespace)";
+        this->ParseErrorMessage = ss.str();
+        return -1;
+      }
+    }
+    else if (!MatchSymbol(expression, position, "+"))
+    {
+      break;
+    }
+
+    double marginMm[3] = {0.0, 0.0, 0.0};
+    int marginFound = this->ParseMargin(expression, position, marginMm);
+    if (marginFound < 0)
+    {
+      return -1;
+    }
+    if (marginFound == 0)
+    {
+      if (marginRequired)
+      {
+        std::stringstream ss;
+        ss << "Margin expected at position " << position;
+        this->ParseErrorMessage = ss.str();
+        return -1;
+      }
+      // Union or subtraction, parsed by the caller
+      position = operatorPosition;
+      break;
+    }
+    nodeIndex = this->AddMarginNode(type, nodeIndex, marginMm);
+  }
+
+  return nodeIndex;
+}
+
+//----------------------------------------------------------------------------
+int vtkSegmentAlgebraEvaluator::ParseMargin(const std::string& expression, size_t& position, double marginMm[3])
+{
+  size_t marginPosition = position;
+  SkipWhitespace(expression, marginPosition);
+  bool vectorMargin = (marginPosition < expression.size() && expression[marginPosition] == '[');
+  if (vectorMargin)
+  {
+    ++marginPosition;
+  }
+
+  int numberOfComponents = (vectorMargin ? 3 : 1);
+  for (int component=0; component<numberOfComponents; ++component)
+  {
+    SkipWhitespace(expression, marginPosition);
+    if ( marginPosition >= expression.size()
+      || !(isdigit((unsigned char)expression[marginPosition]) || expression[marginPosition] == '.') )
+    {
+      if (!vectorMargin)
+      {
+        // Not a margin
+        return 0;
+      }
+      std::stringstream ss;
+      ss << "Number expected in margin at position " << marginPosition;
+      this->ParseErrorMessage = ss.str();
+      return -1;
+    }
+    const char* numberStart = expression.c_str() + marginPosition;
+    char* numberEnd = NULL;
+    marginMm[component] = strtod(numberStart, &numberEnd);
+    marginPosition += (numberEnd - numberStart);
+    if (vectorMargin && !MatchSymbol(expression, marginPosition, (component < 2 ? "," : "]")))
+    {
+      std::stringstream ss;
+      ss << "Margin needs to be of the form [x,y,z] at position " << marginPosition;
+      this->ParseErrorMessage = ss.str();
+      return -1;
+    }
+  }
+  if (!vectorMargin)
+  {
+    marginMm[1] = marginMm[2] = marginMm[0];
+  }
+
+  // Optional unit
+  size_t unitPosition = marginPosition;
+  SkipWhitespace(expression, unitPosition);
+  if (expression.compare(unitPosition, 2, "mm") == 0)
+  {
+    marginPosition = unitPosition + 2;
+  }
+  if (marginPosition < expression.size() && IsNameCharacter(expression[marginPosition], false))
+  {
+    std::stringstream ss;
+    ss << "Invalid margin at position " << marginPosition << " (segment names starting with a digit need to be quoted)";
+    this->ParseErrorMessage = ss.str();
+    return -1;
+  }
+
+  position = marginPosition;
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkSegmentAlgebraEvaluator::AddSegmentNode(const std::string& segmentName)
+{
+  OperationNode node;
+  node.Type = SegmentOperation;
+  node.SegmentName = segmentName;
+  return this->AddNode(std::string("S:") + segmentName, node);
+}
+
+//----------------------------------------------------------------------------
+int vtkSegmentAlgebraEvaluator::AddMarginNode(int type, int inputIndex, double marginMm[3])
+{
+  if (marginMm[0] == 0.0 && marginMm[1] == 0.0 && marginMm[2] == 0.0)
+  {
+    return inputIndex;
+  }
+
+  OperationNode node;
+  node.Type = type;
+  node.Inputs.push_back(inputIndex);
+  std::stringstream ss;
+  ss.precision(10);
+  ss << (type == ExpandOperation ? "E[" : "H[") << marginMm[0] << "," << marginMm[1] << "," << marginMm[2] << "](" << inputIndex << ")";
+  for (int axis=0; axis<3; ++axis)
+  {
+    node.MarginMm[axis] = marginMm[axis];
+  }
+  return this->AddNode(ss.str(), node);
+}
+
+//----------------------------------------------------------------------------
+int vtkSegmentAlgebraEvaluator::AddBooleanNode(int type, int inputIndex1, int inputIndex2)
+{
+  OperationNode node;
+  node.Type = type;
+  std::stringstream ss;
+  if (type == SubtractOperation)
+  {
+    // (A - B) - C is A - (B | C), and all subtracted operands are removed in one pass
+    int minuendIndex = inputIndex1;
+    std::vector<int> subtrahendIndices;
+    if (this->Nodes[inputIndex1].Type == SubtractOperation)
+    {
+      minuendIndex = this->Nodes[inputIndex1].Inputs[0];
+      subtrahendIndices.assign(this->Nodes[inputIndex1].Inputs.begin()+1, this->Nodes[inputIndex1].Inputs.end());
+    }
+    if (this->Nodes[inputIndex2].Type == UnionOperation)
+    {
+      subtrahendIndices.insert(subtrahendIndices.end(), this->Nodes[inputIndex2].Inputs.begin(), this->Nodes[inputIndex2].Inputs.end());
+    }
+    else
+    {
+      subtrahendIndices.push_back(inputIndex2);
+    }
+    std::sort(subtrahendIndices.begin(), subtrahendIndices.end());
+    subtrahendIndices.erase(std::unique(subtrahendIndices.begin(), subtrahendIndices.end()), subtrahendIndices.end());
+
+    node.Inputs.push_back(minuendIndex);
+    node.Inputs.insert(node.Inputs.end(), subtrahendIndices.begin(), subtrahendIndices.end());
+    ss << "D(" << minuendIndex << ";";
+  }
+  else
+  {
+    // Nested unions and intersections are fused, and the order of the operands does not matter
+    int inputIndices[2] = { inputIndex1, inputIndex2 };
+    for (int input=0; input<2; ++input)
+    {
+      if (this->Nodes[inputIndices[input]].Type == type)
+      {
+        node.Inputs.insert(node.Inputs.end(), this->Nodes[inputIndices[input]].Inputs.begin(), this->Nodes[inputIndices[input]].Inputs.end());
+      }
+      else
+      {
+        node.Inputs.push_back(inputIndices[input]);
+      }
+    }
+    std::sort(node.Inputs.begin(), node.Inputs.end());
+    node.Inputs.erase(std::unique(node.Inputs.begin(), node.Inputs.end()), node.Inputs.end());
+    if (node.Inputs.size() == 1)
+    {
+      return node.Inputs[0];
+    }
+    ss << (type == UnionOperation ? "U(" : "I(");
+  }
+
+  for (size_t input=(type == SubtractOperation ? 1 : 0); input<node.Inputs.size(); ++input)
+  {
+    ss << node.Inputs[input] << ",";
+  }
+  ss << ")";
+  return this->AddNode(ss.str(), node);
+}
+
+//----------------------------------------------------------------------------
+int vtkSegmentAlgebraEvaluator::AddNode(const std::string& key, const OperationNode& node)
+{
+  std::map<std::string, int>::iterator nodeIt = this->NodeIndicesByKey.find(key);
+  if (nodeIt != this->NodeIndicesByKey.end())
+  {
+    return nodeIt->second;
+  }
+
+  int nodeIndex = (int)this->Nodes.size();
+  this->Nodes.push_back(node);
+  OperationNode& addedNode = this->Nodes.back();
+  if (addedNode.Type == SegmentOperation || addedNode.Type >= UnionOperation)
+  {
+    addedNode.MarginMm[0] = addedNode.MarginMm[1] = addedNode.MarginMm[2] = 0.0;
+  }
+  SetEmptyExtent(addedNode.BoundingExtent);
+  SetEmptyExtent(addedNode.RequiredExtent);
+  addedNode.NumberOfConsumers = 0;
+  this->NodeIndicesByKey[key] = nodeIndex;
+  return nodeIndex;
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentAlgebraEvaluator::MarkUsedNodes(std::vector<bool>& usedNodes)
+{
+  usedNodes.assign(this->Nodes.size(), false);
+  std::vector<int> nodesToVisit;
+  for (std::vector<Structure>::iterator structureIt = this->Structures.begin(); structureIt != this->Structures.end(); ++structureIt)
+  {
+    nodesToVisit.push_back(structureIt->NodeIndex);
+  }
+  while (!nodesToVisit.empty())
+  {
+    int nodeIndex = nodesToVisit.back();
+    nodesToVisit.pop_back();
+    if (usedNodes[nodeIndex])
+    {
+      continue;
+    }
+    usedNodes[nodeIndex] = true;
+    nodesToVisit.insert(nodesToVisit.end(), this->Nodes[nodeIndex].Inputs.begin(), this->Nodes[nodeIndex].Inputs.end());
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentAlgebraEvaluator::UpdateReferencedSegmentNames()
+{
+  this->ReferencedSegmentNames.clear();
+  std::vector<bool> usedNodes;
+  this->MarkUsedNodes(usedNodes);
+  for (int nodeIndex=0; nodeIndex<(int)this->Nodes.size(); ++nodeIndex)
+  {
+    if (usedNodes[nodeIndex] && this->Nodes[nodeIndex].Type == SegmentOperation)
+    {
+      this->ReferencedSegmentNames.push_back(this->Nodes[nodeIndex].SegmentName);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentAlgebraEvaluator::GetMarginPadding(const OperationNode& node, const double spacing[3], int padding[3])
+{
+  for (int axis=0; axis<3; ++axis)
+  {
+    // Same rounding as in vtkBinaryLabelmapMargin
+    padding[axis] = (int)(fabs(node.MarginMm[axis] / spacing[axis]) + 1.0);
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkSegmentAlgebraEvaluator::Update()
+{
+  if (this->Structures.empty())
+  {
+    vtkErrorMacro("Update: No structures to compute!");
+    return false;
+  }
+
+  // Reset evaluation state
+  std::vector<bool> usedNodes;
+  this->MarkUsedNodes(usedNodes);
+  std::vector<bool> structureNodes(this->Nodes.size(), false);
+  for (std::vector<Structure>::iterator structureIt = this->Structures.begin(); structureIt != this->Structures.end(); ++structureIt)
+  {
+    structureIt->Labelmap = NULL;
+    structureNodes[structureIt->NodeIndex] = true;
+  }
+  int numberOfNodes = (int)this->Nodes.size();
+  this->NumberOfEvaluatedOperations = 0;
+  for (int nodeIndex=0; nodeIndex<numberOfNodes; ++nodeIndex)
+  {
+    OperationNode& node = this->Nodes[nodeIndex];
+    node.Labelmap = NULL;
+    node.NumberOfConsumers = 0;
+    SetEmptyExtent(node.BoundingExtent);
+    SetEmptyExtent(node.RequiredExtent);
+  }
+
+  // Get segment labelmaps on the lattice of the first segment
+  vtkSmartPointer<vtkOrientedImageData> referenceLabelmap;
+  for (int nodeIndex=0; nodeIndex<numberOfNodes; ++nodeIndex)
+  {
+    OperationNode& node = this->Nodes[nodeIndex];
+    if (!usedNodes[nodeIndex] || node.Type != SegmentOperation)
+    {
+      continue;
+    }
+    std::map<std::string, vtkSmartPointer<vtkOrientedImageData> >::iterator labelmapIt = this->SegmentLabelmaps.find(node.SegmentName);
+    if (labelmapIt == this->SegmentLabelmaps.end() || !labelmapIt->second->GetPointData()->GetScalars())
+    {
+      vtkErrorMacro("Update: Labelmap of segment " << node.SegmentName << " is not set!");
+      return false;
+    }
+    vtkSmartPointer<vtkOrientedImageData> labelmap = labelmapIt->second;
+    if (!referenceLabelmap)
+    {
+      referenceLabelmap = labelmap;
+    }
+    else if (!vtkOrientedImageDataResample::DoGeometriesMatch(labelmap, referenceLabelmap))
+    {
+      vtkSmartPointer<vtkOrientedImageData> resampledLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+      if (!vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(labelmap, referenceLabelmap, resampledLabelmap, true))
+      {
+        vtkErrorMacro("Update: Failed to resample labelmap of segment " << node.SegmentName);
+        return false;
+      }
+      labelmap = resampledLabelmap;
+    }
+    node.Labelmap = labelmap.GetPointer();
+    if (!vtkBinaryLabelmapBooleanOperation::GetNonZeroExtent(labelmap, node.BoundingExtent))
+    {
+      vtkErrorMacro("Update: Unsupported scalar type in labelmap of segment " << node.SegmentName);
+      return false;
+    }
+  }
+  double spacing[3] = {1.0, 1.0, 1.0};
+  referenceLabelmap->GetSpacing(spacing);
+
+  // Bounding extents of the non-zero voxels that the operations can produce (inputs precede the nodes using them)
+  for (int nodeIndex=0; nodeIndex<numberOfNodes; ++nodeIndex)
+  {
+    OperationNode& node = this->Nodes[nodeIndex];
+    if (!usedNodes[nodeIndex] || node.Type == SegmentOperation)
+    {
+      continue;
+    }
+    ++this->NumberOfEvaluatedOperations;
+    const int* firstInputExtent = this->Nodes[node.Inputs[0]].BoundingExtent;
+    std::copy(firstInputExtent, firstInputExtent+6, node.BoundingExtent);
+    if (node.Type == ExpandOperation)
+    {
+      int padding[3] = {0, 0, 0};
+      GetMarginPadding(node, spacing, padding);
+      PadExtent(firstInputExtent, padding, node.BoundingExtent);
+    }
+    else if (node.Type == UnionOperation || node.Type == IntersectOperation)
+    {
+      for (size_t input=1; input<node.Inputs.size(); ++input)
+      {
+        if (node.Type == UnionOperation)
+        {
+          MergeExtents(node.BoundingExtent, this->Nodes[node.Inputs[input]].BoundingExtent);
+        }
+        else
+        {
+          IntersectExtents(node.BoundingExtent, this->Nodes[node.Inputs[input]].BoundingExtent, node.BoundingExtent);
+        }
+      }
+    }
+  }
+
+  // Extents where the results are needed, from the structures back to the segments. Only the part within
+  // the bounding extent needs to be computed, as the result is empty outside
+  for (std::vector<Structure>::iterator structureIt = this->Structures.begin(); structureIt != this->Structures.end(); ++structureIt)
+  {
+    OperationNode& node = this->Nodes[structureIt->NodeIndex];
+    std::copy(node.BoundingExtent, node.BoundingExtent+6, node.RequiredExtent);
+  }
+  for (int nodeIndex=numberOfNodes-1; nodeIndex>=0; --nodeIndex)
+  {
+    OperationNode& node = this->Nodes[nodeIndex];
+    if (!usedNodes[nodeIndex])
+    {
+      continue;
+    }
+    IntersectExtents(node.RequiredExtent, node.BoundingExtent, node.RequiredExtent);
+    if (IsExtentEmpty(node.RequiredExtent))
+    {
+      continue;
+    }
+    int inputRequiredExtent[6] = {0,-1,0,-1,0,-1};
+    std::copy(node.RequiredExtent, node.RequiredExtent+6, inputRequiredExtent);
+    if (node.Type == ExpandOperation || node.Type == ShrinkOperation)
+    {
+      // The margin operations need the neighborhood of the voxels
+      int padding[3] = {0, 0, 0};
+      GetMarginPadding(node, spacing, padding);
+      PadExtent(node.RequiredExtent, padding, inputRequiredExtent);
+    }
+    for (std::vector<int>::iterator inputIt = node.Inputs.begin(); inputIt != node.Inputs.end(); ++inputIt)
+    {
+      MergeExtents(this->Nodes[*inputIt].RequiredExtent, inputRequiredExtent);
+      ++this->Nodes[*inputIt].NumberOfConsumers;
+    }
+  }
+
+  // Evaluate the operations. Intermediate results are released as soon as all operations using them are evaluated
+  for (int nodeIndex=0; nodeIndex<numberOfNodes; ++nodeIndex)
+  {
+    if (!usedNodes[nodeIndex])
+    {
+      continue;
+    }
+    if (!this->EvaluateNode(nodeIndex, referenceLabelmap))
+    {
+      return false;
+    }
+    OperationNode& node = this->Nodes[nodeIndex];
+    if (IsExtentEmpty(node.RequiredExtent))
+    {
+      continue;
+    }
+    for (std::vector<int>::iterator inputIt = node.Inputs.begin(); inputIt != node.Inputs.end(); ++inputIt)
+    {
+      OperationNode& inputNode = this->Nodes[*inputIt];
+      if (--inputNode.NumberOfConsumers == 0 && !structureNodes[*inputIt])
+      {
+        inputNode.Labelmap = NULL;
+      }
+    }
+  }
+
+  // Create structure labelmaps with the geometry of the reference labelmap
+  vtkSmartPointer<vtkMatrix4x4> referenceImageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  referenceLabelmap->GetImageToWorldMatrix(referenceImageToWorldMatrix);
+  for (std::vector<Structure>::iterator structureIt = this->Structures.begin(); structureIt != this->Structures.end(); ++structureIt)
+  {
+    structureIt->Labelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+    structureIt->Labelmap->DeepCopy(this->Nodes[structureIt->NodeIndex].Labelmap);
+    structureIt->Labelmap->SetGeometryFromImageToWorldMatrix(referenceImageToWorldMatrix);
+  }
+  for (int nodeIndex=0; nodeIndex<numberOfNodes; ++nodeIndex)
+  {
+    this->Nodes[nodeIndex].Labelmap = NULL;
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSegmentAlgebraEvaluator::EvaluateNode(int nodeIndex, vtkImageData* referenceLabelmap)
+{
+  OperationNode& node = this->Nodes[nodeIndex];
+  const int* requiredExtent = node.RequiredExtent;
+  if (IsExtentEmpty(requiredExtent))
+  {
+    vtkSmartPointer<vtkImageData> emptyLabelmap = vtkSmartPointer<vtkImageData>::New();
+    emptyLabelmap->SetExtent(0, -1, 0, -1, 0, -1);
+    emptyLabelmap->SetOrigin(referenceLabelmap->GetOrigin());
+    emptyLabelmap->SetSpacing(referenceLabelmap->GetSpacing());
+    emptyLabelmap->AllocateScalars(node.Labelmap ? node.Labelmap->GetScalarType() : referenceLabelmap->GetScalarType(), 1);
+    node.Labelmap = emptyLabelmap;
+    return true;
+  }
+
+  switch (node.Type)
+  {
+  case SegmentOperation:
+    {
+    node.Labelmap = ExtractExtent(node.Labelmap, requiredExtent);
+    break;
+    }
+
+  case ExpandOperation:
+  case ShrinkOperation:
+    {
+    vtkSmartPointer<vtkImageData> inputLabelmap = this->Nodes[node.Inputs[0]].Labelmap;
+    if (node.Type == ShrinkOperation)
+    {
+      // Background beyond the extent of the input needs to be present for shrinking
+      int padding[3] = {0, 0, 0};
+      GetMarginPadding(node, referenceLabelmap->GetSpacing(), padding);
+      int paddedExtent[6] = {0,-1,0,-1,0,-1};
+      PadExtent(requiredExtent, padding, paddedExtent);
+      inputLabelmap = ExtractExtent(inputLabelmap, paddedExtent);
+    }
+    vtkSmartPointer<vtkBinaryLabelmapMargin> marginFilter = vtkSmartPointer<vtkBinaryLabelmapMargin>::New();
+    marginFilter->SetInputLabelmap(inputLabelmap);
+    marginFilter->SetOperation(node.Type == ExpandOperation ? vtkBinaryLabelmapMargin::Expand : vtkBinaryLabelmapMargin::Shrink);
+    marginFilter->SetMarginMm(node.MarginMm);
+    marginFilter->SetLabelValue(1.0);
+    if (!marginFilter->Update())
+    {
+      vtkErrorMacro("EvaluateNode: Failed to apply margin!");
+      return false;
+    }
+    node.Labelmap = ExtractExtent(marginFilter->GetOutputLabelmap(), requiredExtent);
+    break;
+    }
+
+  default:
+    {
+    vtkSmartPointer<vtkBinaryLabelmapBooleanOperation> booleanFilter = vtkSmartPointer<vtkBinaryLabelmapBooleanOperation>::New();
+    for (std::vector<int>::iterator inputIt = node.Inputs.begin(); inputIt != node.Inputs.end(); ++inputIt)
+    {
+      booleanFilter->AddInputLabelmap(this->Nodes[*inputIt].Labelmap);
+    }
+    booleanFilter->SetOperation( node.Type == UnionOperation ? vtkBinaryLabelmapBooleanOperation::Union
+      : (node.Type == IntersectOperation ? vtkBinaryLabelmapBooleanOperation::Intersect : vtkBinaryLabelmapBooleanOperation::Subtract) );
+    booleanFilter->SetLabelValue(1.0);
+    booleanFilter->CropToResultExtentOn();
+    if (!booleanFilter->Update())
+    {
+      vtkErrorMacro("EvaluateNode: Failed to apply boolean operation!");
+      return false;
+    }
+    vtkSmartPointer<vtkImageData> outputLabelmap = booleanFilter->GetOutputLabelmap();
+    int outputExtent[6] = {0,-1,0,-1,0,-1};
+    outputLabelmap->GetExtent(outputExtent);
+    int croppedExtent[6] = {0,-1,0,-1,0,-1};
+    IntersectExtents(outputExtent, requiredExtent, croppedExtent);
+    if (!IsExtentEmpty(outputExtent) && !std::equal(outputExtent, outputExtent+6, croppedExtent))
+    {
+      // Inputs used by other operations may extend beyond the required extent
+      outputLabelmap = ExtractExtent(outputLabelmap, croppedExtent);
+    }
+    node.Labelmap = outputLabelmap;
+    break;
+    }
+  }
+
+  return true;
+}
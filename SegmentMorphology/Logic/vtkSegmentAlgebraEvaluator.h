@@ -0,0 +1,200 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#ifndef __vtkSegmentAlgebraEvaluator_h
+#define __vtkSegmentAlgebraEvaluator_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <map>
+#include <string>
+#include <vector>
+
+#include "vtkSlicerSegmentMorphologyModuleLogicExport.h"
+
+class vtkImageData;
+class vtkOrientedImageData;
+
+/// \ingroup SlicerRt_QtModules_SegmentMorphology
+/// \class vtkSegmentAlgebraEvaluator
+/// \brief Derive structures from segments using structure algebra expressions, such as "(PTV_70 + 3mm) - (Rectum | Bladder)".
+///
+/// Expression syntax:
+/// - Segment names: letters, digits, '_' and '.' not starting with a digit, or any text in double quotes
+/// - Union: '|', '+' or U+222A, intersection: '&' or U+2229, subtraction: '-' or U+2212
+/// - Expansion: '+' or U+2295 followed by a margin, shrinking: '-' or U+2296 followed by a margin. The margin is
+///   a number or a [x,y,z] triplet in mm, optionally followed by "mm". Margins apply to the operand right before them
+///   ("A + B + 3mm" is A | (B + 3mm)), intersection binds tighter than union and subtraction
+/// - A segment name directly followed by '-' and a digit (such as PTV-70) is rejected as ambiguous: segment names
+///   containing '-' need to be quoted, and shrink margins need whitespace after the name ("PTV - 3mm")
+///
+/// All expressions added before an update are parsed into one graph of operations. Identical subexpressions are
+/// only evaluated once, and nested unions, intersections and subtractions are fused into one operation with multiple
+/// inputs. Each operation is only evaluated within the extent that is needed for the derived structures, which is
+/// determined from the bounding extents of the non-zero voxels of the segments.
+/// Voxels outside the labelmap extents are treated as background, also when shrinking.
+///
+/// The labelmaps are resampled to the geometry of the first segment that is used.
+class VTK_SLICER_SEGMENTMORPHOLOGY_MODULE_LOGIC_EXPORT vtkSegmentAlgebraEvaluator : public vtkObject
+{
+public:
+  static vtkSegmentAlgebraEvaluator *New();
+  vtkTypeMacro(vtkSegmentAlgebraEvaluator, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Add derived structure defined by an expression
+  /// \return Success flag (false if the expression could not be parsed)
+  bool AddStructure(const char* name, const char* expression);
+  /// Add derived structures from definitions of the form "name = expression", separated by semicolons or new lines
+  /// \return Success flag (false if any of the definitions could not be parsed)
+  bool AddStructures(const char* definitions);
+  /// Remove all structures and the parsed operations
+  void RemoveAllStructures();
+
+  /// Get number of derived structures
+  int GetNumberOfStructures() { return (int)this->Structures.size(); };
+  /// Get name of a derived structure
+  const char* GetStructureName(int structureIndex);
+  /// Get labelmap of a derived structure computed in the last update
+  vtkOrientedImageData* GetStructureLabelmap(int structureIndex);
+
+  /// Get number of segments referenced in the expressions
+  int GetNumberOfReferencedSegments() { return (int)this->ReferencedSegmentNames.size(); };
+  /// Get name of a segment referenced in the expressions
+  const char* GetReferencedSegmentName(int segmentIndex);
+
+  /// Set labelmap of a referenced segment
+  void SetSegmentLabelmap(const char* name, vtkOrientedImageData* labelmap);
+  /// Remove all segment labelmaps
+  void RemoveAllSegmentLabelmaps();
+
+  /// Compute labelmaps of all derived structures
+  /// \return Success flag
+  bool Update();
+
+  /// Get number of operations evaluated in the last update (after reusing common subexpressions and fusing operations)
+  vtkGetMacro(NumberOfEvaluatedOperations, int);
+
+protected:
+  //BTX
+  /// Operation types
+  enum
+  {
+    SegmentOperation = 0,
+    ExpandOperation,
+    ShrinkOperation,
+    UnionOperation,
+    IntersectOperation,
+    SubtractOperation
+  };
+
+  /// Node of the operation graph
+  struct OperationNode
+  {
+    /// Operation type
+    int Type;
+    /// Segment name for segment nodes
+    std::string SegmentName;
+    /// Margin for expand and shrink nodes
+    double MarginMm[3];
+    /// Input nodes. For subtraction the first input is the one the others are subtracted from
+    std::vector<int> Inputs;
+
+    /// Bounding extent of the non-zero voxels the operation can produce
+    int BoundingExtent[6];
+    /// Extent where the result is needed
+    int RequiredExtent[6];
+    /// Number of evaluated nodes using the result
+    int NumberOfConsumers;
+    /// Result labelmap. Released when all consumers are evaluated
+    vtkSmartPointer<vtkImageData> Labelmap;
+  };
+
+  /// Derived structure
+  struct Structure
+  {
+    std::string Name;
+    int NodeIndex;
+    vtkSmartPointer<vtkOrientedImageData> Labelmap;
+  };
+  //ETX
+
+  /// Parse union and subtraction of intersections
+  /// \return Index of the node of the parsed expression, -1 on error
+  int ParseUnion(const std::string& expression, size_t& position);
+  /// Parse intersection of operands
+  int ParseIntersection(const std::string& expression, size_t& position);
+  /// Parse operand with optional margins
+  int ParseOperand(const std::string& expression, size_t& position);
+  /// Parse margin if there is one at the position. The position is only advanced if a margin was parsed
+  /// \return 1 if a margin was parsed, 0 if there is no margin at the position, -1 if the margin is invalid
+  int ParseMargin(const std::string& expression, size_t& position, double marginMm[3]);
+
+  /// Add segment node, or return the existing one for the segment
+  int AddSegmentNode(const std::string& segmentName);
+  /// Add expand or shrink node, or return the existing identical node
+  int AddMarginNode(int type, int inputIndex, double marginMm[3]);
+  /// Add union, intersection or subtraction node fused with the nested nodes of the same type, or return the existing identical node
+  int AddBooleanNode(int type, int inputIndex1, int inputIndex2);
+  /// Add node if there is no node with the same key
+  int AddNode(const std::string& key, const OperationNode& node);
+
+  /// Mark the nodes that the derived structures depend on
+  void MarkUsedNodes(std::vector<bool>& usedNodes);
+  /// Collect the names of the segments that the derived structures depend on
+  void UpdateReferencedSegmentNames();
+
+  /// Get number of voxels the bounding extent grows by when expanding with the margin of a node
+  static void GetMarginPadding(const OperationNode& node, const double spacing[3], int padding[3]);
+
+  /// Evaluate node from its inputs within the node's required extent
+  /// \param referenceLabelmap Labelmap defining the lattice of the results
+  bool EvaluateNode(int nodeIndex, vtkImageData* referenceLabelmap);
+
+protected:
+  vtkSegmentAlgebraEvaluator();
+  virtual ~vtkSegmentAlgebraEvaluator();
+
+protected:
+  /// Derived structures
+  std::vector<Structure> Structures;
+  /// Nodes of the operation graph. Inputs always precede the nodes using them
+  std::vector<OperationNode> Nodes;
+  /// Node indices by the canonical description of the operations
+  std::map<std::string, int> NodeIndicesByKey;
+  /// Names of the segments the derived structures depend on
+  std::vector<std::string> ReferencedSegmentNames;
+  /// Segment labelmaps by segment name
+  std::map<std::string, vtkSmartPointer<vtkOrientedImageData> > SegmentLabelmaps;
+  /// Number of operations evaluated in the last update
+  int NumberOfEvaluatedOperations;
+
+  /// Error message of the last parsing
+  std::string ParseErrorMessage;
+
+private:
+  vtkSegmentAlgebraEvaluator(const vtkSegmentAlgebraEvaluator&); // Not implemented
+  void operator=(const vtkSegmentAlgebraEvaluator&);             // Not implemented
+};
+
+#endif
@@ -22,6 +22,9 @@
 // SegmentMorphology Logic includes
 #include "vtkSlicerSegmentMorphologyModuleLogic.h"
 #include "vtkMRMLSegmentMorphologyNode.h"
+#include "vtkBinaryLabelmapMargin.h"
+#include "vtkBinaryLabelmapBooleanOperation.h"
+#include "vtkSegmentAlgebraEvaluator.h"
 
 // Segmentation includes
 #include "vtkMRMLSegmentationNode.h"
@@ -38,13 +41,9 @@
 // VTK includes
 #include <vtkGeneralTransform.h>
 #include <vtkImageAccumulate.h>
-#include <vtkImageContinuousDilate3D.h>
-#include <vtkImageContinuousErode3D.h>
-#include <vtkImageLogic.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkSmartPointer.h>
-#include <vtkImageConstantPad.h>
 
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerSegmentMorphologyModuleLogic);
@@ -230,36 +229,10 @@ std::string vtkSlicerSegmentMorphologyModuleLogic::ApplyMorphologyOperation(vtkM
     {
       vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(imageB, imageA, imageB, true);
     }
-
-    // Make sure the two volumes have the same extent (otherwise logic filter crashes)
-    int aExtent[6] = {0,-1,0,-1,0,-1};
-    imageA->GetExtent(aExtent);
-    int bExtent[6] = {0,-1,0,-1,0,-1};
-    imageB->GetExtent(bExtent);
-    int unionExtent[6] = { std::min(aExtent[0],bExtent[0]), std::max(aExtent[1],bExtent[1]), std::min(aExtent[2],bExtent[2]), std::max(aExtent[3],bExtent[3]), std::min(aExtent[4],bExtent[4]), std::max(aExtent[5],bExtent[5]) };
-
-    vtkSmartPointer<vtkImageConstantPad> padder = vtkSmartPointer<vtkImageConstantPad>::New();
-    padder->SetInputData(imageA);
-    padder->SetOutputWholeExtent(unionExtent);
-    padder->Update();
-    imageA->vtkImageData::DeepCopy(padder->GetOutput());
-    padder->SetInputData(imageB);
-    padder->Update();
-    imageB->vtkImageData::DeepCopy(padder->GetOutput());
   }
 
-  // Get kernel size
-  double spacingA[3] = {0.0,0.0,0.0};
-  imageA->GetSpacing(spacingA);
-
-  double xSize = parameterNode->GetXSize();
-  double ySize = parameterNode->GetYSize();
-  double zSize = parameterNode->GetZSize();
-
-  int kernelSize[3] = {1,1,1};
-  kernelSize[0] = (int)( 2.0*(xSize/spacingA[0] + 0.5) );
-  kernelSize[1] = (int)( 2.0*(ySize/spacingA[1] + 0.5) );
-  kernelSize[2] = (int)( 2.0*(zSize/spacingA[2] + 0.5) );
+  // Get margin
+  double marginMm[3] = { parameterNode->GetXSize(), parameterNode->GetYSize(), parameterNode->GetZSize() };
 
   // Apply operation on image data
   vtkSmartPointer<vtkImageAccumulate> histogram = vtkSmartPointer<vtkImageAccumulate>::New();
@@ -270,81 +243,55 @@ std::string vtkSlicerSegmentMorphologyModuleLogic::ApplyMorphologyOperation(vtkM
   vtkSmartPointer<vtkImageData> tempOutputImageData = NULL;
   switch (operation) 
   {
-  // Expand
+  // Expand and shrink (the output is padded by the margin when expanding, as extents are fitted to the structure)
   case vtkMRMLSegmentMorphologyNode::Expand:
-    {
-    // Pad image by expansion extent (extents are fitted to the structure, dilate will reach the edge of the image)
-    vtkSmartPointer<vtkImageConstantPad> padder = vtkSmartPointer<vtkImageConstantPad>::New();
-    padder->SetInputData(imageA);
-    int extent[6] = {0,-1,0,-1,0,-1};
-    imageA->GetExtent(extent);
-
-    // Now set the output extent to the new size
-    int expansionExtent[3] = { int(xSize/spacingA[0] + 1.0), int(ySize/spacingA[1] + 1.0), int(zSize/spacingA[2] + 1.0) }; // Rounding up
-    padder->SetOutputWholeExtent(extent[0]-expansionExtent[0], extent[1]+expansionExtent[0], extent[2]-expansionExtent[1], extent[3]+expansionExtent[1], extent[4]-expansionExtent[2], extent[5]+expansionExtent[2]);
-    padder->Update();
-
-    vtkSmartPointer<vtkImageContinuousDilate3D> dilateFilter = vtkSmartPointer<vtkImageContinuousDilate3D>::New();
-    dilateFilter->SetInputConnection(padder->GetOutputPort());
-    dilateFilter->SetKernelSize(kernelSize[0], kernelSize[1], kernelSize[2]);
-    dilateFilter->Update();
-    tempOutputImageData = dilateFilter->GetOutput();
-    break;
-    }
-
-  // Shrink
   case vtkMRMLSegmentMorphologyNode::Shrink:
     {
-    vtkSmartPointer<vtkImageContinuousErode3D> erodeFilter = vtkSmartPointer<vtkImageContinuousErode3D>::New();
-    erodeFilter->SetInputData(imageA);
-    erodeFilter->SetKernelSize(kernelSize[0], kernelSize[1], kernelSize[2]);
-    erodeFilter->Update();
-    tempOutputImageData = erodeFilter->GetOutput();
+    vtkSmartPointer<vtkBinaryLabelmapMargin> marginFilter = vtkSmartPointer<vtkBinaryLabelmapMargin>::New();
+    marginFilter->SetInputLabelmap(imageA);
+    marginFilter->SetOperation(operation == vtkMRMLSegmentMorphologyNode::Expand
+      ? vtkBinaryLabelmapMargin::Expand : vtkBinaryLabelmapMargin::Shrink);
+    marginFilter->SetMarginMm(marginMm);
+    marginFilter->SetLabelValue(valueMax);
+    if (!marginFilter->Update())
+    {
+      std::string errorMessage("Failed to apply margin on segment A");
+      vtkErrorMacro("ApplyMorphologyOperation: " << errorMessage);
+      return errorMessage;
+    }
+    tempOutputImageData = marginFilter->GetOutputLabelmap();
     break;
     }
 
-  // Union
+  // Union, intersect and subtract (the output extent is the union of the input extents, as before)
   case vtkMRMLSegmentMorphologyNode::Union:
+  case vtkMRMLSegmentMorphologyNode::Intersect:
+  case vtkMRMLSegmentMorphologyNode::Subtract:
     {
-    vtkSmartPointer<vtkImageLogic> logicFilter = vtkSmartPointer<vtkImageLogic>::New();
-    logicFilter->SetInput1Data(imageA);
-    logicFilter->SetInput2Data(imageB);
-    logicFilter->SetOperationToOr();
-    logicFilter->SetOutputTrueValue(valueMax);
-    logicFilter->Update();
-    tempOutputImageData = logicFilter->GetOutput();
-    break;
+    vtkSmartPointer<vtkBinaryLabelmapBooleanOperation> booleanFilter = vtkSmartPointer<vtkBinaryLabelmapBooleanOperation>::New();
+    booleanFilter->SetInputLabelmapA(imageA);
+    booleanFilter->SetInputLabelmapB(imageB);
+    if (operation == vtkMRMLSegmentMorphologyNode::Union)
+    {
+      booleanFilter->SetOperationToUnion();
     }
-
-  // Intersect
-  case vtkMRMLSegmentMorphologyNode::Intersect:
+    else if (operation == vtkMRMLSegmentMorphologyNode::Intersect)
     {
-    vtkSmartPointer<vtkImageLogic> logicFilter = vtkSmartPointer<vtkImageLogic>::New();
-    logicFilter->SetInput1Data(imageA);
-    logicFilter->SetInput2Data(imageB);
-    logicFilter->SetOperationToAnd();
-    logicFilter->SetOutputTrueValue(valueMax);
-    logicFilter->Update();
-    tempOutputImageData = logicFilter->GetOutput();
-    break;
+      booleanFilter->SetOperationToIntersect();
     }
-
-  // Subtract
-  case vtkMRMLSegmentMorphologyNode::Subtract:
+    else
+    {
+      booleanFilter->SetOperationToSubtract();
+    }
+    booleanFilter->SetLabelValue(valueMax);
+    booleanFilter->CropToResultExtentOff();
+    if (!booleanFilter->Update())
     {
-    vtkSmartPointer<vtkImageLogic> logicFilter = vtkSmartPointer<vtkImageLogic>::New();
-    logicFilter->SetInput1Data(imageB);
-    logicFilter->SetOperationToNot();
-    logicFilter->SetOutputTrueValue(valueMax);
-    logicFilter->Update();
-
-    vtkSmartPointer<vtkImageLogic> logicFilter2 = vtkSmartPointer<vtkImageLogic>::New();
-    logicFilter2->SetInput1Data(imageA);
-    logicFilter2->SetInput2Data(logicFilter->GetOutput());
-    logicFilter2->SetOperationToAnd();
-    logicFilter2->SetOutputTrueValue(valueMax);
-    logicFilter2->Update();
-    tempOutputImageData = logicFilter2->GetOutput();
+      std::string errorMessage("Failed to apply boolean operation on segments A and B");
+      vtkErrorMacro("ApplyMorphologyOperation: " << errorMessage);
+      return errorMessage;
+    }
+    tempOutputImageData = booleanFilter->GetOutputLabelmap();
     break;
     }
   default:
@@ -386,6 +333,100 @@ std::string vtkSlicerSegmentMorphologyModuleLogic::ApplyMorphologyOperation(vtkM
   return "";
 }
 
+//---------------------------------------------------------------------------
+std::string vtkSlicerSegmentMorphologyModuleLogic::ApplySegmentAlgebra(vtkMRMLSegmentationNode* inputSegmentationNode, const char* definitions, vtkMRMLSegmentationNode* outputSegmentationNode)
+{
+  if (!inputSegmentationNode || !outputSegmentationNode || !definitions)
+  {
+    std::string errorMessage("Invalid input or output segmentation or structure definitions");
+    vtkErrorMacro("ApplySegmentAlgebra: " << errorMessage);
+    return errorMessage;
+  }
+  if (inputSegmentationNode == outputSegmentationNode)
+  {
+    std::string errorMessage("Output segmentation needs to be different from the input segmentation");
+    vtkErrorMacro("ApplySegmentAlgebra: " << errorMessage);
+    return errorMessage;
+  }
+
+  vtkSmartPointer<vtkSegmentAlgebraEvaluator> evaluator = vtkSmartPointer<vtkSegmentAlgebraEvaluator>::New();
+  if (!evaluator->AddStructures(definitions))
+  {
+    std::string errorMessage("Failed to parse structure definitions");
+    vtkErrorMacro("ApplySegmentAlgebra: " << errorMessage);
+    return errorMessage;
+  }
+
+  // Get labelmaps of the referenced segments (by ID or name)
+  vtkSegmentation* inputSegmentation = inputSegmentationNode->GetSegmentation();
+  std::vector<std::string> segmentIds;
+  inputSegmentation->GetSegmentIDs(segmentIds);
+  for (int segmentIndex=0; segmentIndex<evaluator->GetNumberOfReferencedSegments(); ++segmentIndex)
+  {
+    std::string segmentName(evaluator->GetReferencedSegmentName(segmentIndex));
+    std::string segmentId("");
+    if (inputSegmentation->GetSegment(segmentName))
+    {
+      segmentId = segmentName;
+    }
+    for (std::vector<std::string>::iterator segmentIdIt = segmentIds.begin(); segmentId.empty() && segmentIdIt != segmentIds.end(); ++segmentIdIt)
+    {
+      vtkSegment* segment = inputSegmentation->GetSegment(*segmentIdIt);
+      if (segment && segment->GetName() && segmentName.compare(segment->GetName()) == 0)
+      {
+        segmentId = (*segmentIdIt);
+      }
+    }
+    if (segmentId.empty())
+    {
+      std::string errorMessage("Segment not found: " + segmentName);
+      vtkErrorMacro("ApplySegmentAlgebra: " << errorMessage);
+      return errorMessage;
+    }
+
+    vtkSmartPointer<vtkOrientedImageData> labelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+    if (!vtkSlicerSegmentationsModuleLogic::GetSegmentBinaryLabelmapRepresentation(inputSegmentationNode, segmentId.c_str(), labelmap))
+    {
+      std::string errorMessage("Failed to get binary labelmap from segment: " + segmentName);
+      vtkErrorMacro("ApplySegmentAlgebra: " << errorMessage);
+      return errorMessage;
+    }
+    evaluator->SetSegmentLabelmap(segmentName.c_str(), labelmap);
+  }
+
+  if (!evaluator->Update())
+  {
+    std::string errorMessage("Failed to compute derived structures");
+    vtkErrorMacro("ApplySegmentAlgebra: " << errorMessage);
+    return errorMessage;
+  }
+
+  // Clear output segmentation and make sure master is binary labelmap
+  std::vector<std::string> outputSegmentIds;
+  outputSegmentationNode->GetSegmentation()->GetSegmentIDs(outputSegmentIds);
+  for (std::vector<std::string>::iterator segmentIt = outputSegmentIds.begin(); segmentIt != outputSegmentIds.end(); ++segmentIt)
+  {
+    outputSegmentationNode->GetSegmentation()->RemoveSegment(*segmentIt);
+  }
+  outputSegmentationNode->GetSegmentation()->SetMasterRepresentationName(
+    vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName() );
+
+  // Create segments for the derived structures
+  for (int structureIndex=0; structureIndex<evaluator->GetNumberOfStructures(); ++structureIndex)
+  {
+    vtkSmartPointer<vtkSegment> newSegment = vtkSmartPointer<vtkSegment>::New();
+    newSegment->SetName(evaluator->GetStructureName(structureIndex));
+    newSegment->AddRepresentation(
+      vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(), evaluator->GetStructureLabelmap(structureIndex) );
+    outputSegmentationNode->GetSegmentation()->AddSegment(newSegment);
+  }
+
+  // Clear output parent transform, the image data will be in the right coordinate frame
+  outputSegmentationNode->SetAndObserveTransformNodeID(NULL);
+
+  return "";
+}
+
 //---------------------------------------------------------------------------
 std::string vtkSlicerSegmentMorphologyModuleLogic::GenerateOutputSegmentName(vtkMRMLSegmentMorphologyNode* parameterNode)
 {
@@ -34,6 +34,7 @@
 #include "vtkSlicerSegmentMorphologyModuleLogicExport.h"
 
 class vtkMRMLSegmentMorphologyNode;
+class vtkMRMLSegmentationNode;
 
 /// \ingroup SlicerRt_QtModules_SegmentMorphology
 class VTK_SLICER_SEGMENTMORPHOLOGY_MODULE_LOGIC_EXPORT vtkSlicerSegmentMorphologyModuleLogic :
@@ -48,6 +49,16 @@ public:
   /// \return Error message, empty string if no error
   std::string ApplyMorphologyOperation(vtkMRMLSegmentMorphologyNode* parameterNode);
 
+  /// Derive structures from the segments of a segmentation using structure algebra expressions
+  /// (see \sa vtkSegmentAlgebraEvaluator for the syntax). All structures are computed together, so that
+  /// common subexpressions are only evaluated once.
+  /// \param definitions Structure definitions of the form "name = expression", separated by semicolons or new lines.
+  ///   Segments are referenced by name or ID
+  /// \param outputSegmentationNode Segmentation the derived structures are added to (existing segments are removed).
+  ///   It needs to be different from the input segmentation
+  /// \return Error message, empty string if no error
+  std::string ApplySegmentAlgebra(vtkMRMLSegmentationNode* inputSegmentationNode, const char* definitions, vtkMRMLSegmentationNode* outputSegmentationNode);
+
 protected:
   /// Generate output segment name from input segment names
   std::string GenerateOutputSegmentName(vtkMRMLSegmentMorphologyNode* parameterNode);
@@ -22,6 +22,9 @@
 // SegmentMorphology includes
 #include "vtkSlicerSegmentMorphologyModuleLogic.h"
 #include "vtkMRMLSegmentMorphologyNode.h"
+#include "vtkBinaryLabelmapMargin.h"
+#include "vtkBinaryLabelmapBooleanOperation.h"
+#include "vtkSegmentAlgebraEvaluator.h"
 
 // SlicerRt includes
 #include "SlicerRtCommon.h"
@@ -39,13 +42,19 @@
 // SegmentationCore includes
 #include "vtkOrientedImageData.h"
 #include "vtkOrientedImageDataResample.h"
+#include "vtkSegment.h"
 #include "vtkSegmentationConverterFactory.h"
 
 // VTK includes
+#include <vtkDataArray.h>
 #include <vtkImageAccumulate.h>
+#include <vtkImageConstantPad.h>
+#include <vtkImageContinuousDilate3D.h>
+#include <vtkImageContinuousErode3D.h>
 #include <vtkImageData.h>
 #include <vtkImageMathematics.h>
 #include <vtkNew.h>
+#include <vtkPointData.h>
 #include <vtkTransform.h>
 
 // ITK includes
@@ -54,8 +63,16 @@
 // VTKSYS includes
 #include <vtksys/SystemTools.hxx>
 
+// STD includes
+#include <algorithm>
+
 #define MIN_VOLUME_DIFFERENCE_TOLERANCE_VOXEL 100
 
+int TestBinaryLabelmapMargin();
+int TestBinaryLabelmapBooleanOperation();
+int TestSegmentAlgebraEvaluator();
+int TestApplySegmentAlgebra();
+
 //-----------------------------------------------------------------------------
 int vtkSlicerSegmentMorphologyModuleLogicTest1( int argc, char * argv[] )
 {
@@ -473,6 +490,529 @@ int vtkSlicerSegmentMorphologyModuleLogicTest1( int argc, char * argv[] )
     return EXIT_FAILURE;
   }
 
+  if (TestBinaryLabelmapMargin() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (TestBinaryLabelmapBooleanOperation() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (TestSegmentAlgebraEvaluator() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (TestApplySegmentAlgebra() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int TestBinaryLabelmapMargin()
+{
+  // Anisotropic blob with margins that result in kernels of both even and odd sizes (8, 6 and 5 voxels).
+  // The distance transform based margin needs to reproduce the morphology filters exactly
+  vtkNew<vtkImageData> labelmap;
+  labelmap->SetExtent(0, 29, 0, 27, 0, 19);
+  labelmap->SetSpacing(0.8, 1.1, 2.5);
+  labelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  for (int k=0; k<20; ++k)
+  {
+    for (int j=0; j<28; ++j)
+    {
+      for (int i=0; i<30; ++i)
+      {
+        double x = (i-14.5) / 9.0;
+        double y = (j-12.0) / 7.0;
+        double z = (k-9.0) / 5.0;
+        bool inside = (x*x + y*y + z*z <= 1.0) || (i == 20 && j > 5 && k == 9);
+        labelmap->SetScalarComponentFromDouble(i, j, k, 0, (inside ? 1.0 : 0.0));
+      }
+    }
+  }
+  double marginMm[3] = { 3.0, 3.0, 5.0 };
+  int kernelSize[3] = { 8, 6, 5 };
+
+  for (int operation=vtkBinaryLabelmapMargin::Expand; operation<=vtkBinaryLabelmapMargin::Shrink; ++operation)
+  {
+    vtkNew<vtkBinaryLabelmapMargin> marginFilter;
+    marginFilter->SetInputLabelmap(labelmap.GetPointer());
+    marginFilter->SetOperation(operation);
+    marginFilter->SetMarginMm(marginMm);
+    if (!marginFilter->Update())
+    {
+      std::cerr << "Margin: Failed to apply margin!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    vtkSmartPointer<vtkImageData> baselineImageData;
+    if (operation == vtkBinaryLabelmapMargin::Expand)
+    {
+      vtkNew<vtkImageConstantPad> padder;
+      padder->SetInputData(labelmap.GetPointer());
+      padder->SetOutputWholeExtent(-4, 33, -3, 30, -3, 22);
+      vtkNew<vtkImageContinuousDilate3D> dilateFilter;
+      dilateFilter->SetInputConnection(padder->GetOutputPort());
+      dilateFilter->SetKernelSize(kernelSize[0], kernelSize[1], kernelSize[2]);
+      dilateFilter->Update();
+      baselineImageData = dilateFilter->GetOutput();
+    }
+    else
+    {
+      vtkNew<vtkImageContinuousErode3D> erodeFilter;
+      erodeFilter->SetInputData(labelmap.GetPointer());
+      erodeFilter->SetKernelSize(kernelSize[0], kernelSize[1], kernelSize[2]);
+      erodeFilter->Update();
+      baselineImageData = erodeFilter->GetOutput();
+    }
+
+    vtkImageData* outputImageData = marginFilter->GetOutputLabelmap();
+    int outputExtent[6] = {0,-1,0,-1,0,-1};
+    outputImageData->GetExtent(outputExtent);
+    int baselineExtent[6] = {0,-1,0,-1,0,-1};
+    baselineImageData->GetExtent(baselineExtent);
+    for (int index=0; index<6; ++index)
+    {
+      if (outputExtent[index] != baselineExtent[index])
+      {
+        std::cerr << "Margin: Output extent does not match the extent of the morphology filter output!" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+    unsigned char* baselineImagePtr = static_cast<unsigned char*>(baselineImageData->GetScalarPointer());
+    unsigned char* outputImagePtr = static_cast<unsigned char*>(outputImageData->GetScalarPointer());
+    int mismatches = 0;
+    for (vtkIdType index=0; index<outputImageData->GetNumberOfPoints(); ++index)
+    {
+      if ((baselineImagePtr[index] != 0) != (outputImagePtr[index] != 0))
+      {
+        ++mismatches;
+      }
+    }
+    if (mismatches > 0)
+    {
+      std::cerr << "Margin: " << (operation == vtkBinaryLabelmapMargin::Expand ? "Expanded" : "Shrunk")
+        << " labelmap differs from the morphology filter output in " << mismatches << " voxels!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int TestBinaryLabelmapBooleanOperation()
+{
+  // Two overlapping blobs with different extents and scalar types. The rows are longer than one bit word
+  vtkNew<vtkImageData> labelmapA;
+  labelmapA->SetExtent(0, 89, 0, 9, 0, 4);
+  labelmapA->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  vtkNew<vtkImageData> labelmapB;
+  labelmapB->SetExtent(-7, 99, 4, 15, 2, 7);
+  labelmapB->AllocateScalars(VTK_SHORT, 1);
+  int extentA[6] = {0,-1,0,-1,0,-1};
+  labelmapA->GetExtent(extentA);
+  int extentB[6] = {0,-1,0,-1,0,-1};
+  labelmapB->GetExtent(extentB);
+  int unionExtent[6] = {0,-1,0,-1,0,-1};
+  for (int axis=0; axis<3; ++axis)
+  {
+    unionExtent[2*axis] = std::min(extentA[2*axis], extentB[2*axis]);
+    unionExtent[2*axis+1] = std::max(extentA[2*axis+1], extentB[2*axis+1]);
+  }
+  for (int k=unionExtent[4]; k<=unionExtent[5]; ++k)
+  {
+    for (int j=unionExtent[2]; j<=unionExtent[3]; ++j)
+    {
+      for (int i=unionExtent[0]; i<=unionExtent[1]; ++i)
+      {
+        if ( i>=extentA[0] && i<=extentA[1] && j>=extentA[2] && j<=extentA[3] && k>=extentA[4] && k<=extentA[5] )
+        {
+          bool insideA = (i > 10 && i < 80 && j > 1 && j < 9 && k > 0 && (i+j+k) % 5 != 0);
+          labelmapA->SetScalarComponentFromDouble(i, j, k, 0, (insideA ? 1.0 : 0.0));
+        }
+        if ( i>=extentB[0] && i<=extentB[1] && j>=extentB[2] && j<=extentB[3] && k>=extentB[4] && k<=extentB[5] )
+        {
+          bool insideB = (i > 60 && i < 97 && j > 5 && j < 13 && k < 6 && (i*j) % 3 != 0);
+          labelmapB->SetScalarComponentFromDouble(i, j, k, 0, (insideB ? 2.0 : 0.0));
+        }
+      }
+    }
+  }
+
+  for (int operation=vtkBinaryLabelmapBooleanOperation::Union; operation<=vtkBinaryLabelmapBooleanOperation::Subtract; ++operation)
+  {
+    for (int crop=0; crop<2; ++crop)
+    {
+      vtkNew<vtkBinaryLabelmapBooleanOperation> booleanFilter;
+      booleanFilter->SetInputLabelmapA(labelmapA.GetPointer());
+      booleanFilter->SetInputLabelmapB(labelmapB.GetPointer());
+      booleanFilter->SetOperation(operation);
+      booleanFilter->SetLabelValue(5.0);
+      booleanFilter->SetCropToResultExtent(crop != 0);
+      if (!booleanFilter->Update())
+      {
+        std::cerr << "Boolean: Failed to apply boolean operation!" << std::endl;
+        return EXIT_FAILURE;
+      }
+      vtkImageData* outputImageData = booleanFilter->GetOutputLabelmap();
+      if (outputImageData->GetScalarType() != VTK_UNSIGNED_CHAR)
+      {
+        std::cerr << "Boolean: Output scalar type does not match the scalar type of labelmap A!" << std::endl;
+        return EXIT_FAILURE;
+      }
+      int outputExtent[6] = {0,-1,0,-1,0,-1};
+      outputImageData->GetExtent(outputExtent);
+      if (!crop)
+      {
+        for (int index=0; index<6; ++index)
+        {
+          if (outputExtent[index] != unionExtent[index])
+          {
+            std::cerr << "Boolean: Output extent is not the union of the input extents!" << std::endl;
+            return EXIT_FAILURE;
+          }
+        }
+      }
+
+      // Compare to the voxel by voxel result within the union of the input extents
+      int mismatches = 0;
+      vtkIdType numberOfOutputVoxels = 0;
+      vtkIdType numberOfUnionVoxels = (vtkIdType)(unionExtent[1]-unionExtent[0]+1) * (unionExtent[3]-unionExtent[2]+1) * (unionExtent[5]-unionExtent[4]+1);
+      for (int k=unionExtent[4]; k<=unionExtent[5]; ++k)
+      {
+        for (int j=unionExtent[2]; j<=unionExtent[3]; ++j)
+        {
+          for (int i=unionExtent[0]; i<=unionExtent[1]; ++i)
+          {
+            bool insideA = ( i>=extentA[0] && i<=extentA[1] && j>=extentA[2] && j<=extentA[3] && k>=extentA[4] && k<=extentA[5]
+              && labelmapA->GetScalarComponentAsDouble(i, j, k, 0) != 0.0 );
+            bool insideB = ( i>=extentB[0] && i<=extentB[1] && j>=extentB[2] && j<=extentB[3] && k>=extentB[4] && k<=extentB[5]
+              && labelmapB->GetScalarComponentAsDouble(i, j, k, 0) != 0.0 );
+            bool expectedInside = (operation == vtkBinaryLabelmapBooleanOperation::Union ? (insideA || insideB)
+              : (operation == vtkBinaryLabelmapBooleanOperation::Intersect ? (insideA && insideB) : (insideA && !insideB)));
+            double outputValue = 0.0;
+            if ( i>=outputExtent[0] && i<=outputExtent[1] && j>=outputExtent[2] && j<=outputExtent[3] && k>=outputExtent[4] && k<=outputExtent[5] )
+            {
+              outputValue = outputImageData->GetScalarComponentAsDouble(i, j, k, 0);
+              ++numberOfOutputVoxels;
+            }
+            if (outputValue != (expectedInside ? 5.0 : 0.0))
+            {
+              ++mismatches;
+            }
+          }
+        }
+      }
+      if (mismatches > 0)
+      {
+        std::cerr << "Boolean: Result of operation " << operation << " differs from the voxel by voxel result in " << mismatches << " voxels!" << std::endl;
+        return EXIT_FAILURE;
+      }
+      if (crop && numberOfOutputVoxels == numberOfUnionVoxels)
+      {
+        std::cerr << "Boolean: Output of operation " << operation << " is not cropped to the result!" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+/// Count the voxels that differ in two labelmaps on the same lattice (voxels outside the extents are background)
+int CountMismatchingVoxels(vtkImageData* labelmap1, vtkImageData* labelmap2)
+{
+  int extent1[6] = {0,-1,0,-1,0,-1};
+  labelmap1->GetExtent(extent1);
+  int extent2[6] = {0,-1,0,-1,0,-1};
+  labelmap2->GetExtent(extent2);
+  int unionExtent[6] = {0,-1,0,-1,0,-1};
+  for (int axis=0; axis<3; ++axis)
+  {
+    unionExtent[2*axis] = std::min(extent1[2*axis], extent2[2*axis]);
+    unionExtent[2*axis+1] = std::max(extent1[2*axis+1], extent2[2*axis+1]);
+  }
+  int mismatches = 0;
+  for (int k=unionExtent[4]; k<=unionExtent[5]; ++k)
+  {
+    for (int j=unionExtent[2]; j<=unionExtent[3]; ++j)
+    {
+      for (int i=unionExtent[0]; i<=unionExtent[1]; ++i)
+      {
+        bool inside1 = ( i>=extent1[0] && i<=extent1[1] && j>=extent1[2] && j<=extent1[3] && k>=extent1[4] && k<=extent1[5]
+          && labelmap1->GetScalarComponentAsDouble(i, j, k, 0) != 0.0 );
+        bool inside2 = ( i>=extent2[0] && i<=extent2[1] && j>=extent2[2] && j<=extent2[3] && k>=extent2[4] && k<=extent2[5]
+          && labelmap2->GetScalarComponentAsDouble(i, j, k, 0) != 0.0 );
+        if (inside1 != inside2)
+        {
+          ++mismatches;
+        }
+      }
+    }
+  }
+  return mismatches;
+}
+
+//-----------------------------------------------------------------------------
+int TestSegmentAlgebraEvaluator()
+{
+  // Target blob with two organs at risk, partly overlapping it
+  vtkNew<vtkOrientedImageData> ptvLabelmap;
+  ptvLabelmap->SetExtent(0, 60, 0, 50, 0, 20);
+  vtkNew<vtkOrientedImageData> rectumLabelmap;
+  rectumLabelmap->SetExtent(-5, 70, -3, 40, -2, 22);
+  vtkNew<vtkOrientedImageData> bladderLabelmap;
+  bladderLabelmap->SetExtent(10, 50, 20, 60, 0, 20);
+  vtkOrientedImageData* labelmaps[3] = { ptvLabelmap.GetPointer(), rectumLabelmap.GetPointer(), bladderLabelmap.GetPointer() };
+  for (int labelmapIndex=0; labelmapIndex<3; ++labelmapIndex)
+  {
+    vtkOrientedImageData* labelmap = labelmaps[labelmapIndex];
+    labelmap->SetSpacing(1.0, 1.2, 2.5);
+    labelmap->SetOrigin(1.0, 2.0, 3.0);
+    labelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    int extent[6] = {0,-1,0,-1,0,-1};
+    labelmap->GetExtent(extent);
+    for (int k=extent[4]; k<=extent[5]; ++k)
+    {
+      for (int j=extent[2]; j<=extent[3]; ++j)
+      {
+        for (int i=extent[0]; i<=extent[1]; ++i)
+        {
+          bool inside = false;
+          if (labelmapIndex == 0)
+          {
+            double x = (i-30) / 12.0;
+            double y = (j-25) / 9.0;
+            double z = (k-10) / 4.0;
+            inside = (x*x + y*y + z*z <= 1.0);
+          }
+          else if (labelmapIndex == 1)
+          {
+            inside = (i >= 38 && i <= 50 && j >= 5 && j <= 20 && k >= 3 && k <= 17);
+          }
+          else
+          {
+            double x = (i-25) / 8.0;
+            double y = (j-40) / 9.0;
+            double z = (k-12) / 3.0;
+            inside = (x*x + y*y + z*z <= 1.0);
+          }
+          labelmap->SetScalarComponentFromDouble(i, j, k, 0, (inside ? 1.0 : 0.0));
+        }
+      }
+    }
+  }
+
+  // A name directly followed by '-' and a number is ambiguous, it needs to be quoted or written with whitespace
+  vtkNew<vtkSegmentAlgebraEvaluator> ambiguityEvaluator;
+  vtkObject::GlobalWarningDisplayOff();
+  bool ambiguousExpressionAccepted = ambiguityEvaluator->AddStructure("Ambiguous", "PTV-70");
+  vtkObject::GlobalWarningDisplayOn();
+  if ( ambiguousExpressionAccepted || !ambiguityEvaluator->AddStructure("Quoted", "\"PTV-70\" | Rectum")
+    || !ambiguityEvaluator->AddStructure("Shrunk", "PTV - 3mm") || ambiguityEvaluator->GetNumberOfStructures() != 2 )
+  {
+    std::cerr << "Segment algebra: Segment name followed by '-' and a number is not rejected as ambiguous!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkNew<vtkSegmentAlgebraEvaluator> evaluator;
+  if (!evaluator->AddStructures("Opt = (PTV + 3mm) - (Rectum | Bladder)\nRing = (PTV + 6mm) - (PTV + 3mm); Overlap = PTV & (Rectum \xE2\x88\xAA Bladder)"))
+  {
+    std::cerr << "Segment algebra: Failed to parse structure definitions!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (evaluator->GetNumberOfStructures() != 3 || evaluator->GetNumberOfReferencedSegments() != 3)
+  {
+    std::cerr << "Segment algebra: Invalid number of structures or referenced segments!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  evaluator->SetSegmentLabelmap("PTV", ptvLabelmap.GetPointer());
+  evaluator->SetSegmentLabelmap("Rectum", rectumLabelmap.GetPointer());
+  evaluator->SetSegmentLabelmap("Bladder", bladderLabelmap.GetPointer());
+  if (!evaluator->Update())
+  {
+    std::cerr << "Segment algebra: Failed to compute structures!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  // PTV + 3mm is used by Opt and Ring but evaluated once. The union in Opt is fused into its subtraction, so
+  // Rectum | Bladder is only evaluated for Overlap: two expansions, two subtractions, one union and one intersection
+  if (evaluator->GetNumberOfEvaluatedOperations() != 6)
+  {
+    std::cerr << "Segment algebra: Common subexpressions are not reused (" << evaluator->GetNumberOfEvaluatedOperations() << " operations instead of 6)!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Compute the structures step by step on the full labelmaps
+  double margin3Mm[3] = { 3.0, 3.0, 3.0 };
+  double margin6Mm[3] = { 6.0, 6.0, 6.0 };
+  vtkNew<vtkBinaryLabelmapMargin> expand3Filter;
+  expand3Filter->SetInputLabelmap(ptvLabelmap.GetPointer());
+  expand3Filter->SetMarginMm(margin3Mm);
+  expand3Filter->Update();
+  vtkNew<vtkBinaryLabelmapMargin> expand6Filter;
+  expand6Filter->SetInputLabelmap(ptvLabelmap.GetPointer());
+  expand6Filter->SetMarginMm(margin6Mm);
+  expand6Filter->Update();
+  vtkNew<vtkBinaryLabelmapBooleanOperation> organsFilter;
+  organsFilter->SetInputLabelmapA(rectumLabelmap.GetPointer());
+  organsFilter->SetInputLabelmapB(bladderLabelmap.GetPointer());
+  organsFilter->Update();
+  vtkNew<vtkBinaryLabelmapBooleanOperation> optFilter;
+  optFilter->SetInputLabelmapA(expand3Filter->GetOutputLabelmap());
+  optFilter->SetInputLabelmapB(organsFilter->GetOutputLabelmap());
+  optFilter->SetOperationToSubtract();
+  optFilter->Update();
+  vtkNew<vtkBinaryLabelmapBooleanOperation> ringFilter;
+  ringFilter->SetInputLabelmapA(expand6Filter->GetOutputLabelmap());
+  ringFilter->SetInputLabelmapB(expand3Filter->GetOutputLabelmap());
+  ringFilter->SetOperationToSubtract();
+  ringFilter->Update();
+  vtkNew<vtkBinaryLabelmapBooleanOperation> overlapFilter;
+  overlapFilter->SetInputLabelmapA(ptvLabelmap.GetPointer());
+  overlapFilter->SetInputLabelmapB(organsFilter->GetOutputLabelmap());
+  overlapFilter->SetOperationToIntersect();
+  overlapFilter->Update();
+
+  vtkImageData* baselineLabelmaps[3] = { optFilter->GetOutputLabelmap(), ringFilter->GetOutputLabelmap(), overlapFilter->GetOutputLabelmap() };
+  for (int structureIndex=0; structureIndex<3; ++structureIndex)
+  {
+    int mismatches = CountMismatchingVoxels(evaluator->GetStructureLabelmap(structureIndex), baselineLabelmaps[structureIndex]);
+    if (mismatches > 0)
+    {
+      std::cerr << "Segment algebra: Structure " << evaluator->GetStructureName(structureIndex)
+        << " differs from the step by step result in " << mismatches << " voxels!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
   return EXIT_SUCCESS;
 }
 
+//-----------------------------------------------------------------------------
+/// Add segment with a box labelmap (unit spacing, zero origin)
+void AddBoxSegment(vtkMRMLSegmentationNode* segmentationNode, const char* segmentId, const char* segmentName, int extent[6])
+{
+  vtkSmartPointer<vtkOrientedImageData> labelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+  labelmap->SetExtent(extent);
+  labelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  labelmap->GetPointData()->GetScalars()->FillComponent(0, 1.0);
+
+  vtkSmartPointer<vtkSegment> segment = vtkSmartPointer<vtkSegment>::New();
+  segment->SetName(segmentName);
+  segment->AddRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(), labelmap);
+  segmentationNode->GetSegmentation()->AddSegment(segment, segmentId);
+}
+
+//-----------------------------------------------------------------------------
+/// Count the non-zero voxels of the segment with the given name, -1 if there is no such segment
+int CountSegmentVoxels(vtkMRMLSegmentationNode* segmentationNode, const char* segmentName)
+{
+  std::vector<std::string> segmentIds;
+  segmentationNode->GetSegmentation()->GetSegmentIDs(segmentIds);
+  for (std::vector<std::string>::iterator segmentIdIt = segmentIds.begin(); segmentIdIt != segmentIds.end(); ++segmentIdIt)
+  {
+    vtkSegment* segment = segmentationNode->GetSegmentation()->GetSegment(*segmentIdIt);
+    if (!segment->GetName() || strcmp(segment->GetName(), segmentName) != 0)
+    {
+      continue;
+    }
+    vtkImageData* labelmap = vtkImageData::SafeDownCast(
+      segment->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) );
+    if (!labelmap)
+    {
+      return -1;
+    }
+    int extent[6] = {0,-1,0,-1,0,-1};
+    labelmap->GetExtent(extent);
+    int numberOfVoxels = 0;
+    for (int k=extent[4]; k<=extent[5]; ++k)
+    {
+      for (int j=extent[2]; j<=extent[3]; ++j)
+      {
+        for (int i=extent[0]; i<=extent[1]; ++i)
+        {
+          if (labelmap->GetScalarComponentAsDouble(i, j, k, 0) != 0.0)
+          {
+            ++numberOfVoxels;
+          }
+        }
+      }
+    }
+    return numberOfVoxels;
+  }
+  return -1;
+}
+
+//-----------------------------------------------------------------------------
+int TestApplySegmentAlgebra()
+{
+  vtkSmartPointer<vtkMRMLScene> mrmlScene = vtkSmartPointer<vtkMRMLScene>::New();
+  vtkSmartPointer<vtkSlicerSegmentMorphologyModuleLogic> segmentMorphologyLogic = vtkSmartPointer<vtkSlicerSegmentMorphologyModuleLogic>::New();
+  segmentMorphologyLogic->SetMRMLScene(mrmlScene);
+
+  // Boxes of 10x10x10 voxels. PTV overlaps Rectum in 500 voxels and Bladder in 200 voxels, of which 100 are in all three
+  vtkSmartPointer<vtkMRMLSegmentationNode> inputSegmentationNode = vtkSmartPointer<vtkMRMLSegmentationNode>::New();
+  inputSegmentationNode->SetName("Input_Segmentation");
+  mrmlScene->AddNode(inputSegmentationNode);
+  inputSegmentationNode->GetSegmentation()->SetMasterRepresentationName(
+    vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName() );
+  int ptvExtent[6] = { 10, 19, 10, 19, 10, 19 };
+  AddBoxSegment(inputSegmentationNode, "Segment_1", "PTV", ptvExtent);
+  int rectumExtent[6] = { 15, 24, 10, 19, 10, 19 };
+  AddBoxSegment(inputSegmentationNode, "Segment_2", "Rectum", rectumExtent);
+  int bladderExtent[6] = { 10, 19, 18, 27, 10, 19 };
+  AddBoxSegment(inputSegmentationNode, "Segment_3", "Bladder", bladderExtent);
+
+  vtkSmartPointer<vtkMRMLSegmentationNode> outputSegmentationNode = vtkSmartPointer<vtkMRMLSegmentationNode>::New();
+  outputSegmentationNode->SetName("Output_Segmentation");
+  mrmlScene->AddNode(outputSegmentationNode);
+
+  // Segments are referenced by name or by ID (Rectum)
+  std::string errorMessage = segmentMorphologyLogic->ApplySegmentAlgebra( inputSegmentationNode,
+    "Opt = PTV - (Segment_2 | Bladder); Overlap = PTV & (Segment_2 | Bladder)\nRing = (PTV + 1mm) - PTV", outputSegmentationNode );
+  if (!errorMessage.empty())
+  {
+    std::cerr << "Apply segment algebra: " << errorMessage << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (outputSegmentationNode->GetSegmentation()->GetNumberOfSegments() != 3)
+  {
+    std::cerr << "Apply segment algebra: Output segmentation contains " << outputSegmentationNode->GetSegmentation()->GetNumberOfSegments()
+      << " segments instead of 3!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // The expansion is checked against the margin filter, the booleans against the box overlaps
+  vtkSmartPointer<vtkOrientedImageData> ptvLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+  vtkSlicerSegmentationsModuleLogic::GetSegmentBinaryLabelmapRepresentation(inputSegmentationNode, "Segment_1", ptvLabelmap);
+  double margin1Mm[3] = { 1.0, 1.0, 1.0 };
+  vtkNew<vtkBinaryLabelmapMargin> expandFilter;
+  expandFilter->SetInputLabelmap(ptvLabelmap);
+  expandFilter->SetMarginMm(margin1Mm);
+  expandFilter->Update();
+  vtkNew<vtkImageAccumulate> histogram;
+  histogram->SetInputData(expandFilter->GetOutputLabelmap());
+  histogram->IgnoreZeroOn();
+  histogram->Update();
+  int expectedRingVoxels = static_cast<int>(histogram->GetVoxelCount()) - 1000;
+
+  const char* structureNames[3] = { "Opt", "Overlap", "Ring" };
+  int expectedVoxels[3] = { 400, 600, expectedRingVoxels };
+  for (int structureIndex=0; structureIndex<3; ++structureIndex)
+  {
+    int numberOfVoxels = CountSegmentVoxels(outputSegmentationNode, structureNames[structureIndex]);
+    if (numberOfVoxels != expectedVoxels[structureIndex])
+    {
+      std::cerr << "Apply segment algebra: Structure " << structureNames[structureIndex] << " has " << numberOfVoxels
+        << " voxels instead of " << expectedVoxels[structureIndex] << "!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -371,7 +371,41 @@ void SlicerRtCommon::WriteImageDataToFile(vtkMRMLScene* scene, vtkImageData* ima
 }
 
 //---------------------------------------------------------------------------
-bool SlicerRtCommon::ConvertVolumeNodeToVtkOrientedImageData(vtkMRMLScalarVolumeNode* inVolumeNode, vtkOrientedImageData* outImageData, bool applyRasToWorldConversion/*=true*/)
+bool SlicerRtCommon::AreMatrixAxesOrthogonal(vtkMatrix4x4* matrix)
+{
+  if (!matrix)
+  {
+    return false;
+  }
+
+  for (int column1=0; column1<3; ++column1)
+  {
+    double length1 = 0.0;
+    for (int row=0; row<3; ++row)
+    {
+      length1 += matrix->GetElement(row, column1) * matrix->GetElement(row, column1);
+    }
+    for (int column2=column1+1; column2<3; ++column2)
+    {
+      double length2 = 0.0;
+      double dotProduct = 0.0;
+      for (int row=0; row<3; ++row)
+      {
+        length2 += matrix->GetElement(row, column2) * matrix->GetElement(row, column2);
+        dotProduct += matrix->GetElement(row, column1) * matrix->GetElement(row, column2);
+      }
+      if (fabs(dotProduct) > EPSILON * sqrt(length1 * length2))
+      {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool SlicerRtCommon::ConvertVolumeNodeToVtkOrientedImageData(vtkMRMLScalarVolumeNode* inVolumeNode, vtkOrientedImageData* outImageData, bool applyRasToWorldConversion/*=true*/, bool shareVoxelData/*=false*/)
 {
   if (!inVolumeNode || !inVolumeNode->GetImageData())
   {
@@ -384,7 +418,14 @@ bool SlicerRtCommon::ConvertVolumeNodeToVtkOrientedImageData(vtkMRMLScalarVolume
     return false;
   }
 
-  outImageData->vtkImageData::DeepCopy(inVolumeNode->GetImageData());
+  if (shareVoxelData)
+  {
+    outImageData->vtkImageData::ShallowCopy(inVolumeNode->GetImageData());
+  }
+  else
+  {
+    outImageData->vtkImageData::DeepCopy(inVolumeNode->GetImageData());
+  }
 
   vtkSmartPointer<vtkMatrix4x4> ijkToRasMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
   inVolumeNode->GetIJKToRASMatrix(ijkToRasMatrix);
@@ -406,6 +447,27 @@ bool SlicerRtCommon::ConvertVolumeNodeToVtkOrientedImageData(vtkMRMLScalarVolume
       return true;
     }
 
+    if (shareVoxelData)
+    {
+      // Linear transforms without shear only change the geometry, the shared voxels can be kept
+      if (parentTransformNode->IsTransformToWorldLinear())
+      {
+        vtkSmartPointer<vtkMatrix4x4> rasToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+        parentTransformNode->GetMatrixTransformToWorld(rasToWorldMatrix);
+        vtkSmartPointer<vtkMatrix4x4> ijkToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+        vtkMatrix4x4::Multiply4x4(rasToWorldMatrix, ijkToRasMatrix, ijkToWorldMatrix);
+        if (SlicerRtCommon::AreMatrixAxesOrthogonal(ijkToWorldMatrix))
+        {
+          outImageData->SetGeometryFromImageToWorldMatrix(ijkToWorldMatrix);
+          return true;
+        }
+      }
+
+      // Voxels need to be resampled, do not modify the shared ones
+      outImageData->vtkImageData::DeepCopy(inVolumeNode->GetImageData());
+      outImageData->SetGeometryFromImageToWorldMatrix(ijkToRasMatrix);
+    }
+
     // Transform oriented image data
     vtkOrientedImageDataResample::TransformOrientedImage(outImageData, inVolumeToWorldTransform);
   }
@@ -169,14 +169,19 @@ public:
   /// \param overwrite whether or not to remove an existing file before re-writing (avoids warnings)
   static void WriteImageDataToFile(vtkMRMLScene* scene, vtkImageData* imageData, const char* fileName, double dirs[3][3], double spacing[3], double origin[3], bool overwrite);
 
+  /// Determine whether the first three columns (axes) of a matrix are orthogonal, i.e. the matrix contains no shear
+  static bool AreMatrixAxesOrthogonal(vtkMatrix4x4* matrix);
+
   /*!
     Convert volume MRML node to oriented image data
     \param inVolumeNode Input volume node
     \param outImageData Output oriented image data
     \param applyRasToWorldConversion Apply parent linear transform to image. True by default.
+    \param shareVoxelData Reference the voxels of the volume instead of copying them. The voxels are still copied if they
+      need to be resampled to apply a sheared or non-linear parent transform. False by default.
     \return Success
   */
-  static bool ConvertVolumeNodeToVtkOrientedImageData(vtkMRMLScalarVolumeNode* inVolumeNode, vtkOrientedImageData* outImageData, bool applyRasToWorldConversion=true);
+  static bool ConvertVolumeNodeToVtkOrientedImageData(vtkMRMLScalarVolumeNode* inVolumeNode, vtkOrientedImageData* outImageData, bool applyRasToWorldConversion=true, bool shareVoxelData=false);
 
 //BTX
   /*!
@@ -185,12 +190,15 @@ public:
     \param outItkVolume Output ITK image
     \param applyRasToWorldConversion Apply parent linear transform to image. True by default
     \param applyRasToLpsConversion Apply RAS (Slicer) to LPS (ITK, DICOM) coordinate frame conversion. True by default
+    \param shareVoxelData Reference the voxels of the volume node instead of copying them (unless a scalar type conversion
+      or resampling is needed). The ITK image must then be treated as read-only. False by default
     \return Success
   */
-  template<typename T> static bool ConvertVolumeNodeToItkImage(vtkMRMLScalarVolumeNode* inVolumeNode, typename itk::Image<T, 3>::Pointer outItkImage, bool applyRasToWorldConversion=true, bool applyRasToLpsConversion=true);
+  template<typename T> static bool ConvertVolumeNodeToItkImage(vtkMRMLScalarVolumeNode* inVolumeNode, typename itk::Image<T, 3>::Pointer outItkImage, bool applyRasToWorldConversion=true, bool applyRasToLpsConversion=true, bool shareVoxelData=false);
 
   /*!
-    Convert oriented image data to ITK image
+    Convert oriented image data to ITK image. The ITK image references the scalar array of the image data and keeps it
+    alive. The voxels are only copied if the scalar type differs from the requested one
     \param inImageData Input oriented image data
     \param outItkVolume Output ITK image
     \param applyRasToLpsConversion Apply RAS (Slicer) to LPS (ITK, DICOM) coordinate frame conversion. True by default
@@ -200,6 +208,8 @@ public:
 
   /*!
     Convert ITK image to VTK image data. The image geometry is not considered!
+    The VTK scalar array references the ITK pixel buffer and keeps it alive. The voxels are only copied if the
+    requested VTK scalar type differs from the ITK pixel type, or if the ITK image is not fully buffered
     \param inItkImage Input ITK image
     \param outVtkImageData Output VTK image data
     \param vtkType Data scalar type (i.e VTK_FLOAT)
@@ -26,13 +26,22 @@
 
 // VTK includes
 #include <vtkSmartPointer.h>
+#include <vtkCommand.h>
+#include <vtkDataArray.h>
+#include <vtkImageCast.h>
 #include <vtkImageData.h>
-#include <vtkImageExport.h>
 #include <vtkImageThreshold.h>
+#include <vtkPointData.h>
 #include <vtkTransform.h>
+#include <vtkTypeTraits.h>
 
 // ITK includes
+#include <itkImageRegionConstIterator.h>
 #include <itkImageRegionIteratorWithIndex.h>
+#include <itkImportImageContainer.h>
+
+// STD includes
+#include <limits>
 
 // Segmentations includes
 #include "vtkOrientedImageData.h"
@@ -49,10 +58,79 @@ namespace
     }
     return val < EPSILON;
   }
+
+  /// Determine whether voxels of the given VTK scalar type can be used as pixels of type T without conversion
+  template<typename T> bool IsVtkScalarTypeBinaryCompatible(int vtkType)
+  {
+    bool vtkTypeIsFloatingPoint = (vtkType == VTK_FLOAT || vtkType == VTK_DOUBLE);
+    return vtkDataArray::GetDataTypeSize(vtkType) == static_cast<int>(sizeof(T))
+      && vtkTypeIsFloatingPoint == !std::numeric_limits<T>::is_integer
+      && (vtkDataArray::GetDataTypeMin(vtkType) < 0.0) == std::numeric_limits<T>::is_signed;
+  }
 }
 
 //----------------------------------------------------------------------------
-template<typename T> bool SlicerRtCommon::ConvertVolumeNodeToItkImage(vtkMRMLScalarVolumeNode* inVolumeNode, typename itk::Image<T, 3>::Pointer outItkImage, bool applyRasToWorldConversion/*=true*/, bool applyRasToLpsConversion/*=true*/)
+/// ITK pixel container using the scalar array of a VTK image as buffer. The array is kept alive
+/// as long as the container exists, the container never frees the buffer itself
+template<typename T> class SlicerRtVtkDataArrayImportImageContainer : public itk::ImportImageContainer<itk::SizeValueType, T>
+{
+public:
+  typedef SlicerRtVtkDataArrayImportImageContainer Self;
+  typedef itk::ImportImageContainer<itk::SizeValueType, T> Superclass;
+  typedef itk::SmartPointer<Self> Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  itkNewMacro(Self);
+  itkTypeMacro(SlicerRtVtkDataArrayImportImageContainer, ImportImageContainer);
+
+  /// Use the given array as pixel buffer
+  void SetDataArray(vtkDataArray* dataArray)
+  {
+    this->DataArray = dataArray;
+    this->SetImportPointer( static_cast<T*>(dataArray->GetVoidPointer(0)),
+      static_cast<itk::SizeValueType>(dataArray->GetNumberOfTuples() * dataArray->GetNumberOfComponents()), false );
+  }
+
+protected:
+  SlicerRtVtkDataArrayImportImageContainer() { }
+  virtual ~SlicerRtVtkDataArrayImportImageContainer() { }
+
+  /// Referenced VTK array
+  vtkSmartPointer<vtkDataArray> DataArray;
+
+private:
+  SlicerRtVtkDataArrayImportImageContainer(const Self&); // Not implemented
+  void operator=(const Self&);                           // Not implemented
+};
+
+//----------------------------------------------------------------------------
+/// VTK command keeping an ITK object (typically a pixel container) alive until the observed VTK object is deleted
+class SlicerRtItkObjectReferenceCommand : public vtkCommand
+{
+public:
+  static SlicerRtItkObjectReferenceCommand* New() { return new SlicerRtItkObjectReferenceCommand; }
+
+  /// Set referenced ITK object
+  void SetItkObject(itk::LightObject* itkObject) { this->ItkObject = itkObject; }
+
+  virtual void Execute(vtkObject* vtkNotUsed(caller), unsigned long eventId, void* vtkNotUsed(callData))
+  {
+    if (eventId == vtkCommand::DeleteEvent)
+    {
+      this->ItkObject = NULL;
+    }
+  }
+
+protected:
+  SlicerRtItkObjectReferenceCommand() { }
+  virtual ~SlicerRtItkObjectReferenceCommand() { }
+
+  /// Referenced ITK object
+  itk::LightObject::Pointer ItkObject;
+};
+
+//----------------------------------------------------------------------------
+template<typename T> bool SlicerRtCommon::ConvertVolumeNodeToItkImage(vtkMRMLScalarVolumeNode* inVolumeNode, typename itk::Image<T, 3>::Pointer outItkImage, bool applyRasToWorldConversion/*=true*/, bool applyRasToLpsConversion/*=true*/, bool shareVoxelData/*=false*/)
 {
   if (inVolumeNode == NULL)
   {
@@ -70,15 +148,10 @@ template<typename T> bool SlicerRtCommon::ConvertVolumeNodeToItkImage(vtkMRMLSca
     vtkErrorWithObjectMacro(inVolumeNode, "ConvertVolumeNodeToItkImage: Failed to convert volume node to itk image - output image is NULL!");
     return false; 
   }
-  if (sizeof(T) != inVolume->GetScalarSize())
-  {
-    vtkErrorWithObjectMacro(inVolumeNode, "ConvertVolumeNodeToItkImage: Requested type has a different scalar size than input type - output image is NULL!");
-    return false; 
-  }
   
-  // Convert volume to oriented image data
+  // Convert volume to oriented image data (copying or referencing the voxels of the volume)
   vtkSmartPointer<vtkOrientedImageData> orientedImageData = vtkSmartPointer<vtkOrientedImageData>::New();
-  if (!SlicerRtCommon::ConvertVolumeNodeToVtkOrientedImageData(inVolumeNode, orientedImageData, applyRasToWorldConversion))
+  if (!SlicerRtCommon::ConvertVolumeNodeToVtkOrientedImageData(inVolumeNode, orientedImageData, applyRasToWorldConversion, shareVoxelData))
   {
     vtkErrorWithObjectMacro(inVolumeNode, "ConvertVolumeNodeToItkImage: Failed to convert volume node to oriented image data!");
     return false; 
@@ -101,17 +174,13 @@ template<typename T> bool SlicerRtCommon::ConvertVtkOrientedImageDataToItkImage(
     vtkErrorWithObjectMacro(inImageData, "ConvertVtkOrientedImageDataToItkImage: Failed to convert oriented image data to itk image - output image is NULL!");
     return false; 
   }
-  if (sizeof(T) != inImageData->GetScalarSize())
+  vtkSmartPointer<vtkDataArray> inScalars = inImageData->GetPointData()->GetScalars();
+  if (!inScalars || inScalars->GetNumberOfComponents() != 1)
   {
-    vtkErrorWithObjectMacro(inImageData, "ConvertVtkOrientedImageDataToItkImage: Requested type has a different scalar size than input type - output image is NULL!");
+    vtkErrorWithObjectMacro(inImageData, "ConvertVtkOrientedImageDataToItkImage: Failed to convert oriented image data to itk image - input image has no single component scalars!");
     return false; 
   }
 
-  // Convert vtkOrientedImageData to itkImage 
-  vtkSmartPointer<vtkImageExport> imageExport = vtkSmartPointer<vtkImageExport>::New(); 
-  imageExport->SetInputData(inImageData);
-  imageExport->Update(); 
-
   // Determine input image to world transform
   vtkSmartPointer<vtkMatrix4x4> inImageToWorldRasMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
   inImageData->GetImageToWorldMatrix(inImageToWorldRasMatrix);
@@ -194,18 +263,20 @@ template<typename T> bool SlicerRtCommon::ConvertVtkOrientedImageDataToItkImage(
   region.SetIndex(start);
   outItkImage->SetRegions(region);
 
-  // Create and export ITK image
-  try
-  {
-    outItkImage->Allocate();
-  }
-  catch(itk::ExceptionObject & err)
+  // Convert scalars only if the voxels cannot be used as they are
+  if (!IsVtkScalarTypeBinaryCompatible<T>(inScalars->GetDataType()))
   {
-    vtkErrorWithObjectMacro(inImageData, "ConvertVtkOrientedImageDataToItkImage: Failed to allocate memory for the image conversion: " << err.GetDescription())
-    return false;
+    vtkSmartPointer<vtkImageCast> imageCast = vtkSmartPointer<vtkImageCast>::New();
+    imageCast->SetInputData(inImageData);
+    imageCast->SetOutputScalarType(vtkTypeTraits<T>::VTKTypeID());
+    imageCast->Update();
+    inScalars = imageCast->GetOutput()->GetPointData()->GetScalars();
   }
 
-  imageExport->Export( outItkImage->GetBufferPointer() );
+  // Use the VTK scalar array as pixel buffer of the ITK image
+  typename SlicerRtVtkDataArrayImportImageContainer<T>::Pointer pixelContainer = SlicerRtVtkDataArrayImportImageContainer<T>::New();
+  pixelContainer->SetDataArray(inScalars);
+  outItkImage->SetPixelContainer(pixelContainer);
 
   return true;
 }
@@ -228,19 +299,54 @@ template<typename T> bool SlicerRtCommon::ConvertItkImageToVtkImageData(typename
   typename itk::Image<T, 3>::RegionType region = inItkImage->GetBufferedRegion();
   typename itk::Image<T, 3>::SizeType imageSize = region.GetSize();
   int extent[6]={0, (int) imageSize[0]-1, 0, (int) imageSize[1]-1, 0, (int) imageSize[2]-1};
-  outVtkImageData->SetExtent(extent);
-  outVtkImageData->AllocateScalars(vtkType, 1);
+  vtkIdType numberOfVoxels = static_cast<vtkIdType>(region.GetNumberOfPixels());
+
+  vtkSmartPointer<vtkDataArray> outScalars;
+  if (region == inItkImage->GetLargestPossibleRegion())
+  {
+    // Reference the ITK pixel buffer. The array is created with the requested type if that is binary compatible with the pixels
+    int wrapperVtkType = (IsVtkScalarTypeBinaryCompatible<T>(vtkType) ? vtkType : vtkTypeTraits<T>::VTKTypeID());
+    outScalars = vtkSmartPointer<vtkDataArray>::Take(vtkDataArray::CreateDataArray(wrapperVtkType));
+    outScalars->SetNumberOfComponents(1);
+    outScalars->SetVoidArray(inItkImage->GetBufferPointer(), numberOfVoxels, 1);
+
+    // Keep the pixel buffer alive while the array uses it
+    vtkSmartPointer<SlicerRtItkObjectReferenceCommand> pixelContainerReference = vtkSmartPointer<SlicerRtItkObjectReferenceCommand>::New();
+    pixelContainerReference->SetItkObject(inItkImage->GetPixelContainer());
+    outScalars->AddObserver(vtkCommand::DeleteEvent, pixelContainerReference);
+  }
+  else
+  {
+    // Copy the buffered region
+    outScalars = vtkSmartPointer<vtkDataArray>::Take(vtkDataArray::CreateDataArray(vtkTypeTraits<T>::VTKTypeID()));
+    outScalars->SetNumberOfComponents(1);
+    outScalars->SetNumberOfTuples(numberOfVoxels);
+    T* outScalarsPtr = static_cast<T*>(outScalars->GetVoidPointer(0));
+    itk::ImageRegionConstIterator< itk::Image<T, 3> > itInItkImage(inItkImage, region);
+    for ( itInItkImage.GoToBegin(); !itInItkImage.IsAtEnd(); ++itInItkImage )
+    {
+      (*outScalarsPtr) = itInItkImage.Get();
+      outScalarsPtr++;
+    }
+  }
 
-  T* outVtkImageDataPtr = (T*)outVtkImageData->GetScalarPointer();
-  typename itk::ImageRegionIteratorWithIndex< itk::Image<T, 3> > itInItkImage(
-    inItkImage, inItkImage->GetLargestPossibleRegion() );
-  for ( itInItkImage.GoToBegin(); !itInItkImage.IsAtEnd(); ++itInItkImage )
+  // Convert scalar type only if requested type differs from the pixel type
+  if (outScalars->GetDataType() != vtkType)
   {
-    typename itk::Image<T, 3>::IndexType i = itInItkImage.GetIndex();
-    (*outVtkImageDataPtr) = inItkImage->GetPixel(i);
-    outVtkImageDataPtr++;
+    vtkSmartPointer<vtkImageData> itkImageWrapper = vtkSmartPointer<vtkImageData>::New();
+    itkImageWrapper->SetExtent(extent);
+    itkImageWrapper->GetPointData()->SetScalars(outScalars);
+    vtkSmartPointer<vtkImageCast> imageCast = vtkSmartPointer<vtkImageCast>::New();
+    imageCast->SetInputData(itkImageWrapper);
+    imageCast->SetOutputScalarType(vtkType);
+    imageCast->Update();
+    outScalars = imageCast->GetOutput()->GetPointData()->GetScalars();
   }
 
+  outVtkImageData->SetExtent(extent);
+  outVtkImageData->GetPointData()->SetScalars(outScalars);
+  outVtkImageData->Modified();
+
   return true;
 }
 
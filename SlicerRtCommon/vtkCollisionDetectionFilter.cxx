@@ -41,8 +41,14 @@
 #include "vtkTransform.h"
 #include "vtkSmartPointer.h"
 #include "vtkCellArray.h"
+#include "vtkHull.h"
 #include <vtkTrivialProducer.h>
 
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
 vtkStandardNewMacro(vtkCollisionDetectionFilter);
 
 // Constructs with initial 0 values.
@@ -64,10 +70,22 @@ vtkCollisionDetectionFilter::vtkCollisionDetectionFilter()
   this->CellTolerance = 0.0;
   this->NumberOfCellsPerNode = 2;
   this->tree0 = vtkOBBTree::New();
+  this->tree0->Register(this);
+  this->tree0->Delete();
   this->tree1 = vtkOBBTree::New();
+  this->tree1->Register(this);
+  this->tree1->Delete();
   this->GenerateScalars = 0;
   this->CollisionMode = VTK_ALL_CONTACTS;
   this->Opacity = 1.0;
+  for (int i=0; i<2; i++)
+    {
+    this->ProxyCenter[i][0] = this->ProxyCenter[i][1] = this->ProxyCenter[i][2] = 0.0;
+    this->ProxyRadius[i] = -1.0;
+    this->ProxyModel[i] = NULL;
+    }
+  this->UseProxies = 0;
+  this->ProxyPadding = 0.01;
 }
 
 // Destroy any allocated memory.
@@ -75,11 +93,11 @@ vtkCollisionDetectionFilter::~vtkCollisionDetectionFilter()
 {
   if (this->tree0 != NULL)
     {
-    this->tree0->Delete();
+    this->tree0->UnRegister(this);
     }
   if (this->tree1 != NULL)
     {
-    this->tree1->Delete();
+    this->tree1->UnRegister(this);
     }
 
   if (this->Matrix[0])
@@ -126,6 +144,49 @@ void vtkCollisionDetectionFilter::SetInput(int idx, vtkPolyData *input)
 
 
 
+//----------------------------------------------------------------------------
+void vtkCollisionDetectionFilter::SetOBBTree(int i, vtkOBBTree *tree)
+{
+  if (i > 1 || i < 0)
+    {
+    vtkErrorMacro(<<"Index " << i << " is out of range in SetOBBTree. Only two trees allowed!");
+    return;
+    }
+
+  vtkOBBTree **treePointer = (i == 0 ? &this->tree0 : &this->tree1);
+  if (tree == NULL)
+    {
+    // Restore a private tree
+    tree = vtkOBBTree::New();
+    tree->Register(this);
+    tree->Delete();
+    }
+  else if (tree == *treePointer)
+    {
+    return;
+    }
+  else
+    {
+    tree->Register(this);
+    }
+
+  (*treePointer)->UnRegister(this);
+  *treePointer = tree;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkOBBTree *vtkCollisionDetectionFilter::GetOBBTree(int i)
+{
+  if (i > 1 || i < 0)
+    {
+    vtkErrorMacro(<<"Index " << i << " is out of range in GetOBBTree. Only two trees allowed!");
+    return NULL;
+    }
+
+  return (i == 0 ? this->tree0 : this->tree1);
+}
+
 //----------------------------------------------------------------------------
 vtkPolyData *vtkCollisionDetectionFilter::GetInput(int idx)
 {
@@ -399,6 +460,548 @@ static int ComputeCollisions(vtkOBBNode *nodeA, vtkOBBNode *nodeB, vtkMatrix4x4
   return 1;
 }
 
+// Client data of the boolean collision query
+struct vtkCollisionDetectionFilterQuery
+{
+  vtkCollisionDetectionFilter *Self;
+  vtkPolyData *InputA;
+  vtkPolyData *InputB;
+  int Colliding;
+};
+
+// Callback of the boolean collision query. Stops the traversal at the first
+// intersecting pair of cells and records nothing but the fact of the collision.
+static int ComputeFirstCollision(vtkOBBNode *nodeA, vtkOBBNode *nodeB, vtkMatrix4x4 *Xform, void *clientdata)
+{
+  vtkCollisionDetectionFilterQuery *query = reinterpret_cast<vtkCollisionDetectionFilterQuery *>( clientdata );
+  vtkIdList *IdsA = nodeA->Cells;
+  vtkIdList *IdsB = nodeB->Cells;
+  vtkIdType numIdsA = IdsA->GetNumberOfIds();
+  vtkIdType numIdsB = IdsB->GetNumberOfIds();
+  vtkPoints *pointsA = query->InputA->GetPoints();
+  vtkPoints *pointsB = query->InputB->GetPoints();
+  double Tolerance = query->Self->GetCellTolerance();
+
+  double x1[4], x2[4];
+  double ptsA[9], ptsB[9];
+  double boundsA[6], boundsB[6];
+  double in[4], out[4];
+  vtkIdType npts, *ptIds;
+
+  // Transform the cells of B once per node pair rather than once per cell pair
+  std::vector<double> ptsBAll(9*numIdsB);
+  std::vector<double> boundsBAll(6*numIdsB);
+  for (vtkIdType m = 0; m < numIdsB; m++)
+    {
+    query->InputB->GetCellPoints(IdsB->GetId(m), npts, ptIds);
+    double *pts = &ptsBAll[9*m];
+    double *bounds = &boundsBAll[6*m];
+    bounds[0] = bounds[2] = bounds[4] = VTK_DOUBLE_MAX;
+    bounds[1] = bounds[3] = bounds[5] = VTK_DOUBLE_MIN;
+    for (int n = 0; n < 3; n++)
+      {
+      pointsB->GetPoint(ptIds[n], in);
+      in[3] = 1.0;
+      Xform->MultiplyPoint(in, out);
+      for (int p = 0; p < 3; p++)
+        {
+        pts[n*3+p] = out[p]/out[3];
+        if (pts[n*3+p] < bounds[2*p]) bounds[2*p] = pts[n*3+p];
+        if (pts[n*3+p] > bounds[2*p+1]) bounds[2*p+1] = pts[n*3+p];
+        }
+      }
+    }
+
+  for (vtkIdType i = 0; i < numIdsA; i++)
+    {
+    vtkIdType cellIdA = IdsA->GetId(i);
+    query->InputA->GetCellPoints(cellIdA, npts, ptIds);
+    query->InputA->GetCellBounds(cellIdA, boundsA);
+    for (int j = 0; j < 3; j++)
+      {
+      pointsA->GetPoint(ptIds[j], ptsA + j*3);
+      }
+
+    for (vtkIdType m = 0; m < numIdsB; m++)
+      {
+      std::copy(&ptsBAll[9*m], &ptsBAll[9*m] + 9, ptsB);
+      std::copy(&boundsBAll[6*m], &boundsBAll[6*m] + 6, boundsB);
+      if (query->Self->IntersectPolygonWithPolygon(3, ptsA, boundsA, 3, ptsB, boundsB,
+        Tolerance, x1, x2, vtkCollisionDetectionFilter::VTK_FIRST_CONTACT))
+        {
+        // A negative return value halts the traversal
+        query->Colliding = 1;
+        return -1;
+        }
+      }
+    }
+  return 0;
+}
+
+// Gives access to the root node of an OBB tree, which vtkOBBTree keeps protected.
+// The class is never instantiated, only the pointer to the inherited member is taken.
+class vtkCollisionDetectionFilterOBBTreeAccess : public vtkOBBTree
+{
+public:
+  static vtkOBBNode *GetRoot(vtkOBBTree *tree)
+    {
+    return tree->*(&vtkCollisionDetectionFilterOBBTreeAccess::Tree);
+    }
+};
+
+// Closest point to p on the triangle (a,b,c), following Ericson, Real-Time
+// Collision Detection, section 5.1.5
+static void ClosestPointOnTriangle(const double p[3], const double a[3], const double b[3],
+                                   const double c[3], double closest[3])
+{
+  double ab[3], ac[3], ap[3], bp[3], cp[3];
+  for (int i = 0; i < 3; i++)
+    {
+    ab[i] = b[i] - a[i];
+    ac[i] = c[i] - a[i];
+    ap[i] = p[i] - a[i];
+    bp[i] = p[i] - b[i];
+    cp[i] = p[i] - c[i];
+    }
+  double d1 = vtkMath::Dot(ab, ap);
+  double d2 = vtkMath::Dot(ac, ap);
+  if (d1 <= 0.0 && d2 <= 0.0)
+    {
+    closest[0] = a[0]; closest[1] = a[1]; closest[2] = a[2];
+    return;
+    }
+  double d3 = vtkMath::Dot(ab, bp);
+  double d4 = vtkMath::Dot(ac, bp);
+  if (d3 >= 0.0 && d4 <= d3)
+    {
+    closest[0] = b[0]; closest[1] = b[1]; closest[2] = b[2];
+    return;
+    }
+  double vc = d1*d4 - d3*d2;
+  if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+    {
+    double v = d1 / (d1 - d3);
+    for (int i = 0; i < 3; i++)
+      {
+      closest[i] = a[i] + v*ab[i];
+      }
+    return;
+    }
+  double d5 = vtkMath::Dot(ab, cp);
+  double d6 = vtkMath::Dot(ac, cp);
+  if (d6 >= 0.0 && d5 <= d6)
+    {
+    closest[0] = c[0]; closest[1] = c[1]; closest[2] = c[2];
+    return;
+    }
+  double vb = d5*d2 - d1*d6;
+  if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+    {
+    double w = d2 / (d2 - d6);
+    for (int i = 0; i < 3; i++)
+      {
+      closest[i] = a[i] + w*ac[i];
+      }
+    return;
+    }
+  double va = d3*d6 - d5*d4;
+  if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+    {
+    double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    for (int i = 0; i < 3; i++)
+      {
+      closest[i] = b[i] + w*(c[i] - b[i]);
+      }
+    return;
+    }
+  double denominator = va + vb + vc;
+  if (denominator == 0.0)
+    {
+    // Degenerate triangle, all the closer features were tested above
+    closest[0] = a[0]; closest[1] = a[1]; closest[2] = a[2];
+    return;
+    }
+  double v = vb / denominator;
+  double w = vc / denominator;
+  for (int i = 0; i < 3; i++)
+    {
+    closest[i] = a[i] + v*ab[i] + w*ac[i];
+    }
+}
+
+static double ClampToUnitInterval(double value)
+{
+  return (value < 0.0 ? 0.0 : (value > 1.0 ? 1.0 : value));
+}
+
+// Closest points of the segments (p1,q1) and (p2,q2), following Ericson, Real-Time
+// Collision Detection, section 5.1.9. Returns the squared distance.
+static double ClosestPointsOnSegments(const double p1[3], const double q1[3],
+                                      const double p2[3], const double q2[3],
+                                      double c1[3], double c2[3])
+{
+  double d1[3], d2[3], r[3];
+  for (int i = 0; i < 3; i++)
+    {
+    d1[i] = q1[i] - p1[i];
+    d2[i] = q2[i] - p2[i];
+    r[i] = p1[i] - p2[i];
+    }
+  double a = vtkMath::Dot(d1, d1);
+  double e = vtkMath::Dot(d2, d2);
+  double f = vtkMath::Dot(d2, r);
+  double s = 0.0, t = 0.0;
+  const double epsilon = 1.0e-12;
+  if (a <= epsilon && e <= epsilon)
+    {
+    s = t = 0.0;
+    }
+  else if (a <= epsilon)
+    {
+    s = 0.0;
+    t = ClampToUnitInterval(f / e);
+    }
+  else
+    {
+    double c = vtkMath::Dot(d1, r);
+    if (e <= epsilon)
+      {
+      t = 0.0;
+      s = ClampToUnitInterval(-c / a);
+      }
+    else
+      {
+      double b = vtkMath::Dot(d1, d2);
+      double denominator = a*e - b*b;
+      s = (denominator != 0.0 ? ClampToUnitInterval((b*f - c*e) / denominator) : 0.0);
+      t = (b*s + f) / e;
+      if (t < 0.0)
+        {
+        t = 0.0;
+        s = ClampToUnitInterval(-c / a);
+        }
+      else if (t > 1.0)
+        {
+        t = 1.0;
+        s = ClampToUnitInterval((b - c) / a);
+        }
+      }
+    }
+  for (int i = 0; i < 3; i++)
+    {
+    c1[i] = p1[i] + d1[i]*s;
+    c2[i] = p2[i] + d2[i]*t;
+    }
+  return vtkMath::Distance2BetweenPoints(c1, c2);
+}
+
+// Intersection of the segment (p,q) with the triangle (a,b,c). Returns 1 and the
+// intersection point if they intersect.
+static int IntersectSegmentWithTriangle(const double p[3], const double q[3], const double a[3],
+                                        const double b[3], const double c[3], double x[3])
+{
+  double ab[3], ac[3], qp[3], ap[3], n[3], e[3];
+  for (int i = 0; i < 3; i++)
+    {
+    ab[i] = b[i] - a[i];
+    ac[i] = c[i] - a[i];
+    qp[i] = p[i] - q[i];
+    ap[i] = p[i] - a[i];
+    }
+  vtkMath::Cross(ab, ac, n);
+  double d = vtkMath::Dot(qp, n);
+  if (d == 0.0)
+    {
+    // Parallel to the plane, coplanar contacts are found by the edge and vertex tests
+    return 0;
+    }
+  if (d < 0.0)
+    {
+    // Intersect the reversed segment
+    d = -d;
+    for (int i = 0; i < 3; i++)
+      {
+      qp[i] = -qp[i];
+      ap[i] = q[i] - a[i];
+      }
+    }
+  double t = vtkMath::Dot(ap, n);
+  if (t < 0.0 || t > d)
+    {
+    return 0;
+    }
+  vtkMath::Cross(qp, ap, e);
+  double v = vtkMath::Dot(ac, e);
+  if (v < 0.0 || v > d)
+    {
+    return 0;
+    }
+  double w = -vtkMath::Dot(ab, e);
+  if (w < 0.0 || v + w > d)
+    {
+    return 0;
+    }
+  double u = 1.0 - (v + w) / d;
+  for (int i = 0; i < 3; i++)
+    {
+    x[i] = u*a[i] + (v/d)*b[i] + (w/d)*c[i];
+    }
+  return 1;
+}
+
+// Closest points of the triangles P and Q (three points each). Returns the squared distance.
+static double ClosestPointsOnTriangles(const double P[9], const double Q[9], double closestP[3], double closestQ[3])
+{
+  int i, j;
+  double x[3];
+
+  // Intersecting triangles: an edge of one of them crosses the other
+  for (i = 0; i < 3; i++)
+    {
+    if (IntersectSegmentWithTriangle(P+3*i, P+3*((i+1)%3), Q, Q+3, Q+6, x) ||
+        IntersectSegmentWithTriangle(Q+3*i, Q+3*((i+1)%3), P, P+3, P+6, x))
+      {
+      closestP[0] = closestQ[0] = x[0];
+      closestP[1] = closestQ[1] = x[1];
+      closestP[2] = closestQ[2] = x[2];
+      return 0.0;
+      }
+    }
+
+  // Otherwise the closest points are on a pair of edges or a vertex and a face
+  double minimumDistance2 = VTK_DOUBLE_MAX;
+  double c1[3], c2[3];
+  for (i = 0; i < 3; i++)
+    {
+    for (j = 0; j < 3; j++)
+      {
+      double distance2 = ClosestPointsOnSegments(P+3*i, P+3*((i+1)%3), Q+3*j, Q+3*((j+1)%3), c1, c2);
+      if (distance2 < minimumDistance2)
+        {
+        minimumDistance2 = distance2;
+        std::copy(c1, c1+3, closestP);
+        std::copy(c2, c2+3, closestQ);
+        }
+      }
+    }
+  for (i = 0; i < 3; i++)
+    {
+    ClosestPointOnTriangle(P+3*i, Q, Q+3, Q+6, c2);
+    double distance2 = vtkMath::Distance2BetweenPoints(P+3*i, c2);
+    if (distance2 < minimumDistance2)
+      {
+      minimumDistance2 = distance2;
+      std::copy(P+3*i, P+3*i+3, closestP);
+      std::copy(c2, c2+3, closestQ);
+      }
+    ClosestPointOnTriangle(Q+3*i, P, P+3, P+6, c1);
+    distance2 = vtkMath::Distance2BetweenPoints(Q+3*i, c1);
+    if (distance2 < minimumDistance2)
+      {
+      minimumDistance2 = distance2;
+      std::copy(c1, c1+3, closestP);
+      std::copy(Q+3*i, Q+3*i+3, closestQ);
+      }
+    }
+  return minimumDistance2;
+}
+
+// Oriented box given by a corner and three edge vectors
+struct vtkCollisionDetectionFilterBox
+{
+  double Center[3];
+  double Axes[3][3];
+};
+
+static void GetOBBNodeBox(vtkOBBNode *node, const double *matrix, vtkCollisionDetectionFilterBox &box)
+{
+  double corner[3], axes[3][3];
+  for (int i = 0; i < 3; i++)
+    {
+    corner[i] = node->Corner[i]
+      + 0.5*(node->Axes[0][i] + node->Axes[1][i] + node->Axes[2][i]);
+    for (int j = 0; j < 3; j++)
+      {
+      axes[j][i] = node->Axes[j][i];
+      }
+    }
+  if (matrix == NULL)
+    {
+    std::copy(corner, corner+3, box.Center);
+    std::copy(axes[0], axes[0]+9, box.Axes[0]);
+    return;
+    }
+  for (int i = 0; i < 3; i++)
+    {
+    box.Center[i] = matrix[4*i+3];
+    for (int k = 0; k < 3; k++)
+      {
+      box.Center[i] += matrix[4*i+k]*corner[k];
+      }
+    for (int j = 0; j < 3; j++)
+      {
+      box.Axes[j][i] = 0.0;
+      for (int k = 0; k < 3; k++)
+        {
+        box.Axes[j][i] += matrix[4*i+k]*axes[j][k];
+        }
+      }
+    }
+}
+
+// Lower bound of the distance between two oriented boxes: the largest gap between
+// their projections onto the box axes, or between their bounding spheres
+static double GetBoxDistanceLowerBound(const vtkCollisionDetectionFilterBox &boxA,
+                                       const vtkCollisionDetectionFilterBox &boxB)
+{
+  double d[3];
+  vtkMath::Subtract(boxB.Center, boxA.Center, d);
+  double radiusA = 0.5*sqrt(vtkMath::Dot(boxA.Axes[0], boxA.Axes[0])
+    + vtkMath::Dot(boxA.Axes[1], boxA.Axes[1]) + vtkMath::Dot(boxA.Axes[2], boxA.Axes[2]));
+  double radiusB = 0.5*sqrt(vtkMath::Dot(boxB.Axes[0], boxB.Axes[0])
+    + vtkMath::Dot(boxB.Axes[1], boxB.Axes[1]) + vtkMath::Dot(boxB.Axes[2], boxB.Axes[2]));
+  double lowerBound = vtkMath::Norm(d) - radiusA - radiusB;
+
+  for (int axisIndex = 0; axisIndex < 6; axisIndex++)
+    {
+    double u[3] = { 0.0, 0.0, 0.0 };
+    const double *axis = (axisIndex < 3 ? boxA.Axes[axisIndex] : boxB.Axes[axisIndex-3]);
+    double length = vtkMath::Norm(axis);
+    if (length <= 0.0)
+      {
+      continue;
+      }
+    u[0] = axis[0] / length; u[1] = axis[1] / length; u[2] = axis[2] / length;
+    double projectedRadiusA = 0.5*(fabs(vtkMath::Dot(boxA.Axes[0], u))
+      + fabs(vtkMath::Dot(boxA.Axes[1], u)) + fabs(vtkMath::Dot(boxA.Axes[2], u)));
+    double projectedRadiusB = 0.5*(fabs(vtkMath::Dot(boxB.Axes[0], u))
+      + fabs(vtkMath::Dot(boxB.Axes[1], u)) + fabs(vtkMath::Dot(boxB.Axes[2], u)));
+    double gap = fabs(vtkMath::Dot(d, u)) - projectedRadiusA - projectedRadiusB;
+    if (gap > lowerBound)
+      {
+      lowerBound = gap;
+      }
+    }
+  return (lowerBound > 0.0 ? lowerBound : 0.0);
+}
+
+// Get the points of a triangle, transformed by the matrix if not NULL
+static void GetTrianglePoints(vtkPolyData *polyData, vtkIdType cellId, const double *matrix, double points[9])
+{
+  vtkIdType npts, *ptIds;
+  double point[3];
+  polyData->GetCellPoints(cellId, npts, ptIds);
+  for (int n = 0; n < 3; n++)
+    {
+    polyData->GetPoints()->GetPoint(ptIds[n], point);
+    if (matrix == NULL)
+      {
+      std::copy(point, point+3, points+3*n);
+      continue;
+      }
+    for (int i = 0; i < 3; i++)
+      {
+      points[3*n+i] = matrix[4*i]*point[0] + matrix[4*i+1]*point[1]
+        + matrix[4*i+2]*point[2] + matrix[4*i+3];
+      }
+    }
+}
+
+// Branch and bound search for the closest pair of cells of two OBB trees. Node pairs
+// whose boxes are not closer than the best distance found so far are pruned. The
+// matrix transforms model B into the coordinate system of model A. Returns the
+// squared distance, or VTK_DOUBLE_MAX if no cells are closer than maximumDistance.
+static double ComputeClosestCells(vtkOBBNode *rootA, vtkPolyData *inputA,
+                                  vtkOBBNode *rootB, vtkPolyData *inputB,
+                                  const double matrix[16], double maximumDistance,
+                                  double closestPointA[3], double closestPointB[3])
+{
+  double minimumDistance = maximumDistance;
+  double minimumDistance2 = VTK_DOUBLE_MAX;
+  double trianglesB[9], triangleA[9], c1[3], c2[3];
+
+  std::vector< std::pair<vtkOBBNode*, vtkOBBNode*> > stack;
+  stack.push_back(std::make_pair(rootA, rootB));
+  vtkCollisionDetectionFilterBox boxA, boxB;
+  while (!stack.empty())
+    {
+    vtkOBBNode *nodeA = stack.back().first;
+    vtkOBBNode *nodeB = stack.back().second;
+    stack.pop_back();
+
+    GetOBBNodeBox(nodeA, NULL, boxA);
+    GetOBBNodeBox(nodeB, matrix, boxB);
+    if (GetBoxDistanceLowerBound(boxA, boxB) >= minimumDistance)
+      {
+      continue;
+      }
+
+    if (nodeA->Kids == NULL && nodeB->Kids == NULL)
+      {
+      // Leaves: test all the cell pairs
+      vtkIdType numIdsA = nodeA->Cells->GetNumberOfIds();
+      vtkIdType numIdsB = nodeB->Cells->GetNumberOfIds();
+      std::vector<double> pointsB(9*numIdsB);
+      for (vtkIdType m = 0; m < numIdsB; m++)
+        {
+        GetTrianglePoints(inputB, nodeB->Cells->GetId(m), matrix, &pointsB[9*m]);
+        }
+      for (vtkIdType i = 0; i < numIdsA; i++)
+        {
+        GetTrianglePoints(inputA, nodeA->Cells->GetId(i), NULL, triangleA);
+        for (vtkIdType m = 0; m < numIdsB; m++)
+          {
+          std::copy(&pointsB[9*m], &pointsB[9*m]+9, trianglesB);
+          double distance2 = ClosestPointsOnTriangles(triangleA, trianglesB, c1, c2);
+          if (distance2 < minimumDistance2 && sqrt(distance2) < minimumDistance)
+            {
+            minimumDistance2 = distance2;
+            minimumDistance = sqrt(distance2);
+            std::copy(c1, c1+3, closestPointA);
+            std::copy(c2, c2+3, closestPointB);
+            }
+          }
+        }
+      continue;
+      }
+
+    // Descend into the larger box (or the one that is not a leaf), visiting the closer kid first
+    double sizeA = vtkMath::Dot(boxA.Axes[0], boxA.Axes[0]) + vtkMath::Dot(boxA.Axes[1], boxA.Axes[1])
+      + vtkMath::Dot(boxA.Axes[2], boxA.Axes[2]);
+    double sizeB = vtkMath::Dot(boxB.Axes[0], boxB.Axes[0]) + vtkMath::Dot(boxB.Axes[1], boxB.Axes[1])
+      + vtkMath::Dot(boxB.Axes[2], boxB.Axes[2]);
+    bool descendA = (nodeB->Kids == NULL || (nodeA->Kids != NULL && sizeA >= sizeB));
+    std::pair<vtkOBBNode*, vtkOBBNode*> kidPairs[2];
+    double kidLowerBounds[2];
+    for (int k = 0; k < 2; k++)
+      {
+      if (descendA)
+        {
+        kidPairs[k] = std::make_pair(nodeA->Kids[k], nodeB);
+        GetOBBNodeBox(nodeA->Kids[k], NULL, boxA);
+        }
+      else
+        {
+        kidPairs[k] = std::make_pair(nodeA, nodeB->Kids[k]);
+        GetOBBNodeBox(nodeB->Kids[k], matrix, boxB);
+        }
+      kidLowerBounds[k] = GetBoxDistanceLowerBound(boxA, boxB);
+      }
+    // The pair pushed last is visited first
+    int closerKid = (kidLowerBounds[0] <= kidLowerBounds[1] ? 0 : 1);
+    for (int k = 0; k < 2; k++)
+      {
+      int kid = (k == 0 ? 1 - closerKid : closerKid);
+      if (kidLowerBounds[kid] < minimumDistance)
+        {
+        stack.push_back(kidPairs[kid]);
+        }
+      }
+    }
+
+  return minimumDistance2;
+}
+
 // Description:
 // Perform a collision detection
 int vtkCollisionDetectionFilter::RequestData(
@@ -479,47 +1082,26 @@ int vtkCollisionDetectionFilter::RequestData(
     
   // The transformations...
   vtkMatrix4x4 *matrix = vtkMatrix4x4::New();
-  vtkMatrix4x4 *tmpMatrix = vtkMatrix4x4::New();
 
-  if (this->Transform[0] != NULL || this->Transform[1] != NULL)
-    {
-    vtkMatrix4x4::Invert(this->Transform[0]->GetMatrix(), tmpMatrix);
-    // the sequence of multiplication is significant
-    vtkMatrix4x4::Multiply4x4(tmpMatrix, this->Transform[1]->GetMatrix(), matrix);
-    }
-   else
+  if (!this->ComputeRelativeMatrix(matrix))
     {
      vtkWarningMacro(<< "Set two transforms or two matrices");
+     matrix->Delete();
      return 1;
     }
 
   this->InvokeEvent(vtkCommand::StartEvent, NULL);
-  
-
-  // rebuild the obb trees... they do their own mtime checking with input data
-  tree0->SetDataSet(input[0]);
-  tree0->AutomaticOn();
-  tree0->SetNumberOfCellsPerNode(this->NumberOfCellsPerNode);
-  tree0->BuildLocator();
-
-  tree1->SetDataSet(input[1]);
-  tree1->AutomaticOn();
-  tree1->SetNumberOfCellsPerNode(this->NumberOfCellsPerNode);
-  tree1->BuildLocator();
-    
-  // Set the Box Tolerance
-  tree0->SetTolerance(this->BoxTolerance);
-  tree1->SetTolerance(this->BoxTolerance);
-
 
-
-
-  // Do the collision detection...
-  int boxTests = 
-    tree0->IntersectWithOBBTree(tree1,  matrix, ComputeCollisions, this);
+  // Do the collision detection, unless the proxies show that the models are apart...
+  int boxTests = 0;
+  this->UpdateProxies(input[0], input[1]);
+  if (!this->UseProxies || !this->AreProxiesSeparated(*matrix->Element, this->GetProxyTolerance()))
+    {
+    this->UpdateOBBTrees(input[0], input[1]);
+    boxTests = tree0->IntersectWithOBBTree(tree1,  matrix, ComputeCollisions, this);
+    }
 
   matrix->Delete();
-  tmpMatrix->Delete();
 
   vtkDebugMacro(<< "Collision detection finished");
   this->NumberOfBoxTests = std::abs(boxTests);
@@ -600,6 +1182,441 @@ int vtkCollisionDetectionFilter::RequestData(
 
 }
 
+//----------------------------------------------------------------------------
+int vtkCollisionDetectionFilter::IsColliding()
+{
+  vtkCollisionDetectionFilterQuery query;
+  query.Self = this;
+  query.InputA = this->GetInput(0);
+  query.InputB = this->GetInput(1);
+  query.Colliding = 0;
+  if (query.InputA == NULL || query.InputB == NULL)
+    {
+    vtkErrorMacro(<< "IsColliding: Both inputs need to be set!");
+    return 0;
+    }
+
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  if (!this->ComputeRelativeMatrix(matrix))
+    {
+    vtkErrorMacro(<< "IsColliding: Set two transforms or two matrices!");
+    return 0;
+    }
+
+  this->UpdateProxies(query.InputA, query.InputB);
+  if (this->UseProxies && this->AreProxiesSeparated(*matrix->Element, this->GetProxyTolerance()))
+    {
+    this->NumberOfBoxTests = 0;
+    return 0;
+    }
+
+  this->UpdateOBBTrees(query.InputA, query.InputB);
+
+  int boxTests = 
+    tree0->IntersectWithOBBTree(tree1, matrix, ComputeFirstCollision, &query);
+  this->NumberOfBoxTests = std::abs(boxTests);
+
+  return query.Colliding;
+}
+
+//----------------------------------------------------------------------------
+int vtkCollisionDetectionFilter::IsColliding(vtkMatrix4x4 *matrix0, vtkMatrix4x4 *matrix1)
+{
+  vtkCollisionDetectionFilterQuery query;
+  query.Self = this;
+  query.InputA = this->GetInput(0);
+  query.InputB = this->GetInput(1);
+  query.Colliding = 0;
+  if (query.InputA == NULL || query.InputB == NULL || matrix0 == NULL || matrix1 == NULL)
+    {
+    vtkErrorMacro(<< "IsColliding: Both inputs and matrices need to be set!");
+    return 0;
+    }
+
+  // Transform of model 1 into the coordinate system of model 0
+  double inverseMatrix0[16];
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkMatrix4x4::Invert(*matrix0->Element, inverseMatrix0);
+  vtkMatrix4x4::Multiply4x4(inverseMatrix0, *matrix1->Element, *matrix->Element);
+
+  this->UpdateProxies(query.InputA, query.InputB);
+  if (this->UseProxies && this->AreProxiesSeparated(*matrix->Element, this->GetProxyTolerance()))
+    {
+    return 0;
+    }
+
+  tree0->IntersectWithOBBTree(tree1, matrix, ComputeFirstCollision, &query);
+
+  return query.Colliding;
+}
+
+//----------------------------------------------------------------------------
+double vtkCollisionDetectionFilter::ComputeMinimumDistance(double maximumDistance,
+  double closestPoint0[3], double closestPoint1[3])
+{
+  if (this->GetInput(0) == NULL || this->GetInput(1) == NULL)
+    {
+    vtkErrorMacro(<< "ComputeMinimumDistance: Both inputs need to be set!");
+    return VTK_DOUBLE_MAX;
+    }
+  if (this->Transform[0] == NULL || this->Transform[1] == NULL)
+    {
+    vtkErrorMacro(<< "ComputeMinimumDistance: Set two transforms or two matrices!");
+    return VTK_DOUBLE_MAX;
+    }
+
+  this->UpdateOBBTrees(this->GetInput(0), this->GetInput(1));
+  this->UpdateProxies(this->GetInput(0), this->GetInput(1));
+
+  return this->ComputeMinimumDistance(this->Transform[0]->GetMatrix(), this->Transform[1]->GetMatrix(),
+    maximumDistance, closestPoint0, closestPoint1);
+}
+
+//----------------------------------------------------------------------------
+double vtkCollisionDetectionFilter::ComputeMinimumDistance(vtkMatrix4x4 *matrix0, vtkMatrix4x4 *matrix1,
+  double maximumDistance, double closestPoint0[3], double closestPoint1[3])
+{
+  vtkPolyData *input0 = this->GetInput(0);
+  vtkPolyData *input1 = this->GetInput(1);
+  if (input0 == NULL || input1 == NULL || matrix0 == NULL || matrix1 == NULL)
+    {
+    vtkErrorMacro(<< "ComputeMinimumDistance: Both inputs and matrices need to be set!");
+    return VTK_DOUBLE_MAX;
+    }
+
+  // Transform of model 1 into the coordinate system of model 0
+  double inverseMatrix0[16], matrix[16];
+  vtkMatrix4x4::Invert(*matrix0->Element, inverseMatrix0);
+  vtkMatrix4x4::Multiply4x4(inverseMatrix0, *matrix1->Element, matrix);
+
+  // The proxies enclose the models, so their distance is a lower bound of the distance of the models
+  if (this->UseProxies && maximumDistance > 0.0
+    && this->AreProxiesSeparated(matrix, maximumDistance + this->ProxyPadding))
+    {
+    return VTK_DOUBLE_MAX;
+    }
+
+  vtkOBBNode *root0 = vtkCollisionDetectionFilterOBBTreeAccess::GetRoot(this->tree0);
+  vtkOBBNode *root1 = vtkCollisionDetectionFilterOBBTreeAccess::GetRoot(this->tree1);
+  if (root0 == NULL || root1 == NULL)
+    {
+    vtkErrorMacro(<< "ComputeMinimumDistance: OBB trees are not built!");
+    return VTK_DOUBLE_MAX;
+    }
+
+  double point0[4] = { 0.0, 0.0, 0.0, 1.0 };
+  double point1[4] = { 0.0, 0.0, 0.0, 1.0 };
+  double distance2 = ComputeClosestCells(root0, input0, root1, input1, matrix,
+    (maximumDistance > 0.0 ? maximumDistance : VTK_DOUBLE_MAX), point0, point1);
+  if (distance2 == VTK_DOUBLE_MAX)
+    {
+    return VTK_DOUBLE_MAX;
+    }
+
+  // Closest points back to world coordinates
+  double worldPoint[4];
+  if (closestPoint0)
+    {
+    matrix0->MultiplyPoint(point0, worldPoint);
+    closestPoint0[0] = worldPoint[0]/worldPoint[3];
+    closestPoint0[1] = worldPoint[1]/worldPoint[3];
+    closestPoint0[2] = worldPoint[2]/worldPoint[3];
+    }
+  if (closestPoint1)
+    {
+    matrix0->MultiplyPoint(point1, worldPoint);
+    closestPoint1[0] = worldPoint[0]/worldPoint[3];
+    closestPoint1[1] = worldPoint[1]/worldPoint[3];
+    closestPoint1[2] = worldPoint[2]/worldPoint[3];
+    }
+  return sqrt(distance2);
+}
+
+//----------------------------------------------------------------------------
+void vtkCollisionDetectionFilter::UpdateOBBTrees()
+{
+  vtkPolyData *input0 = this->GetInput(0);
+  vtkPolyData *input1 = this->GetInput(1);
+  if (input0 == NULL || input1 == NULL)
+    {
+    vtkErrorMacro(<< "UpdateOBBTrees: Both inputs need to be set!");
+    return;
+    }
+
+  this->UpdateOBBTrees(input0, input1);
+  this->UpdateProxies(input0, input1);
+}
+
+//----------------------------------------------------------------------------
+void vtkCollisionDetectionFilter::UpdateOBBTrees(vtkPolyData *input0, vtkPolyData *input1)
+{
+  // Set up the obb trees before building them, so that setting the same values
+  // again does not modify the trees and force a rebuild on every update
+  tree0->SetDataSet(input0);
+  tree0->AutomaticOn();
+  tree0->SetNumberOfCellsPerNode(this->NumberOfCellsPerNode);
+  tree0->SetTolerance(this->BoxTolerance);
+
+  tree1->SetDataSet(input1);
+  tree1->AutomaticOn();
+  tree1->SetNumberOfCellsPerNode(this->NumberOfCellsPerNode);
+  tree1->SetTolerance(this->BoxTolerance);
+
+  // Rebuild the obb trees only if the models or the tree settings changed since
+  // the last build. The trees of rigid models are kept (and possibly shared by
+  // other filters), only the relative transform changes between updates.
+  tree0->Update();
+  tree1->Update();
+}
+
+//----------------------------------------------------------------------------
+int vtkCollisionDetectionFilter::ComputeRelativeMatrix(vtkMatrix4x4 *matrix)
+{
+  if (this->Transform[0] == NULL || this->Transform[1] == NULL)
+    {
+    return 0;
+    }
+
+  vtkMatrix4x4 *tmpMatrix = vtkMatrix4x4::New();
+  vtkMatrix4x4::Invert(this->Transform[0]->GetMatrix(), tmpMatrix);
+  // the sequence of multiplication is significant
+  vtkMatrix4x4::Multiply4x4(tmpMatrix, this->Transform[1]->GetMatrix(), matrix);
+  tmpMatrix->Delete();
+  return 1;
+}
+
+// Directions of the planes bounding the convex proxies: the face, edge and corner
+// directions of a cube. Each direction bounds the proxy from both sides.
+static const int NUMBER_OF_PROXY_DIRECTIONS = 13;
+static const double PROXY_DIRECTIONS[NUMBER_OF_PROXY_DIRECTIONS][3] = {
+  {1,0,0}, {0,1,0}, {0,0,1},
+  {1,1,0}, {1,-1,0}, {1,0,1}, {1,0,-1}, {0,1,1}, {0,1,-1},
+  {1,1,1}, {1,1,-1}, {1,-1,1}, {1,-1,-1} };
+
+//----------------------------------------------------------------------------
+void vtkCollisionDetectionFilter::UpdateProxies(vtkPolyData *input0, vtkPolyData *input1)
+{
+  if (!this->UseProxies)
+    {
+    return;
+    }
+
+  vtkPolyData *inputs[2] = { input0, input1 };
+  for (int i=0; i<2; i++)
+    {
+    // The model pointer is only compared, to notice when the input is replaced
+    if (inputs[i] != this->ProxyModel[i] || inputs[i]->GetMTime() > this->ProxyBuildTime[i])
+      {
+      this->BuildProxy(i, inputs[i]);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkCollisionDetectionFilter::BuildProxy(int i, vtkPolyData *input)
+{
+  this->ProxyPlanes[i].clear();
+  this->ProxyVertices[i].clear();
+  this->ProxyRadius[i] = -1.0;
+  this->ProxyModel[i] = input;
+  this->ProxyBuildTime[i].Modified();
+
+  vtkPoints *points = input->GetPoints();
+  vtkIdType numberOfPoints = (points ? points->GetNumberOfPoints() : 0);
+  if (numberOfPoints == 0)
+    {
+    return;
+    }
+
+  // Planes touching the points from outside
+  double normals[2*NUMBER_OF_PROXY_DIRECTIONS][3];
+  double offsets[2*NUMBER_OF_PROXY_DIRECTIONS];
+  for (int k=0; k<NUMBER_OF_PROXY_DIRECTIONS; k++)
+    {
+    double direction[3] = { PROXY_DIRECTIONS[k][0], PROXY_DIRECTIONS[k][1], PROXY_DIRECTIONS[k][2] };
+    vtkMath::Normalize(direction);
+    for (int j=0; j<3; j++)
+      {
+      normals[2*k][j] = direction[j];
+      normals[2*k+1][j] = -direction[j];
+      }
+    offsets[2*k] = offsets[2*k+1] = -VTK_DOUBLE_MAX;
+    }
+  double point[3];
+  for (vtkIdType pointId=0; pointId<numberOfPoints; pointId++)
+    {
+    points->GetPoint(pointId, point);
+    for (int k=0; k<NUMBER_OF_PROXY_DIRECTIONS; k++)
+      {
+      double projection = vtkMath::Dot(normals[2*k], point);
+      offsets[2*k] = std::max(offsets[2*k], projection);
+      offsets[2*k+1] = std::max(offsets[2*k+1], -projection);
+      }
+    }
+  for (int k=0; k<2*NUMBER_OF_PROXY_DIRECTIONS; k++)
+    {
+    this->ProxyPlanes[i].push_back(normals[k][0]);
+    this->ProxyPlanes[i].push_back(normals[k][1]);
+    this->ProxyPlanes[i].push_back(normals[k][2]);
+    this->ProxyPlanes[i].push_back(offsets[k]);
+    }
+
+  // Vertices of the polyhedron bounded by the planes. Any vertex set enclosing the model
+  // keeps the separation tests conservative, so the corners of the bounding box are used
+  // if the polyhedron is degenerate (e.g. planar models).
+  vtkSmartPointer<vtkHull> hull = vtkSmartPointer<vtkHull>::New();
+  for (int k=0; k<2*NUMBER_OF_PROXY_DIRECTIONS; k++)
+    {
+    hull->AddPlane(normals[k]);
+    }
+  hull->SetInputData(input);
+  hull->Update();
+  vtkPoints *hullPoints = hull->GetOutput()->GetPoints();
+  if (hullPoints && hullPoints->GetNumberOfPoints() >= 4)
+    {
+    for (vtkIdType pointId=0; pointId<hullPoints->GetNumberOfPoints(); pointId++)
+      {
+      hullPoints->GetPoint(pointId, point);
+      this->ProxyVertices[i].insert(this->ProxyVertices[i].end(), point, point+3);
+      }
+    }
+  else
+    {
+    double bounds[6];
+    points->GetBounds(bounds);
+    for (int corner=0; corner<8; corner++)
+      {
+      this->ProxyVertices[i].push_back(bounds[corner&1 ? 1 : 0]);
+      this->ProxyVertices[i].push_back(bounds[corner&2 ? 3 : 2]);
+      this->ProxyVertices[i].push_back(bounds[corner&4 ? 5 : 4]);
+      }
+    }
+
+  // Bounding sphere around the center of the bounding box
+  double bounds[6];
+  points->GetBounds(bounds);
+  double radius2 = 0.0;
+  for (int j=0; j<3; j++)
+    {
+    this->ProxyCenter[i][j] = 0.5*(bounds[2*j] + bounds[2*j+1]);
+    }
+  for (vtkIdType pointId=0; pointId<numberOfPoints; pointId++)
+    {
+    points->GetPoint(pointId, point);
+    radius2 = std::max(radius2, vtkMath::Distance2BetweenPoints(point, this->ProxyCenter[i]));
+    }
+  this->ProxyRadius[i] = sqrt(radius2);
+}
+
+//----------------------------------------------------------------------------
+double vtkCollisionDetectionFilter::GetProxyTolerance()
+{
+  return this->ProxyPadding + this->BoxTolerance + sqrt(this->CellTolerance);
+}
+
+//----------------------------------------------------------------------------
+int vtkCollisionDetectionFilter::AreProxiesSeparated(const double matrix[16], double distance)
+{
+  if (this->ProxyRadius[0] < 0.0 || this->ProxyRadius[1] < 0.0)
+    {
+    return 0;
+    }
+
+  // Bounding spheres first. The radius of proxy 1 is scaled by the spectral norm of the linear part
+  // of the matrix (square root of the largest eigenvalue of M^T*M), which is the largest factor any
+  // direction is scaled by, also when rotations and non-uniform scaling are combined.
+  double linearTransposeLinear[3][3];
+  for (int j=0; j<3; j++)
+    {
+    for (int k=0; k<3; k++)
+      {
+      linearTransposeLinear[j][k] = matrix[j]*matrix[k] + matrix[4+j]*matrix[4+k] + matrix[8+j]*matrix[8+k];
+      }
+    }
+  double eigenvalues[3], eigenvectors[3][3];
+  vtkMath::Diagonalize3x3(linearTransposeLinear, eigenvalues, eigenvectors);
+  double scale2 = std::max(std::max(eigenvalues[0], eigenvalues[1]), eigenvalues[2]);
+  // Round-off margin of the eigenvalue computation
+  scale2 *= 1.0 + 1.0e-9;
+  const double *center1 = this->ProxyCenter[1];
+  double transformedCenter1[3];
+  for (int j=0; j<3; j++)
+    {
+    transformedCenter1[j] = matrix[4*j]*center1[0] + matrix[4*j+1]*center1[1] + matrix[4*j+2]*center1[2] + matrix[4*j+3];
+    }
+  double centerDistance = sqrt(vtkMath::Distance2BetweenPoints(this->ProxyCenter[0], transformedCenter1));
+  if (centerDistance - this->ProxyRadius[0] - sqrt(scale2)*this->ProxyRadius[1] > distance)
+    {
+    return 1;
+    }
+
+  // Separating planes among the face planes of the two polyhedra
+  const std::vector<double> &planes0 = this->ProxyPlanes[0];
+  const std::vector<double> &planes1 = this->ProxyPlanes[1];
+  const std::vector<double> &vertices0 = this->ProxyVertices[0];
+  const std::vector<double> &vertices1 = this->ProxyVertices[1];
+
+  // Vertices of proxy 1 against the planes of proxy 0
+  std::vector<double> transformedVertices1(vertices1.size());
+  for (size_t v=0; v<vertices1.size(); v+=3)
+    {
+    for (int j=0; j<3; j++)
+      {
+      transformedVertices1[v+j] = matrix[4*j]*vertices1[v] + matrix[4*j+1]*vertices1[v+1]
+        + matrix[4*j+2]*vertices1[v+2] + matrix[4*j+3];
+      }
+    }
+  for (size_t p=0; p<planes0.size(); p+=4)
+    {
+    double gap = VTK_DOUBLE_MAX;
+    for (size_t v=0; v<transformedVertices1.size() && gap>distance; v+=3)
+      {
+      gap = std::min(gap, vtkMath::Dot(&planes0[p], &transformedVertices1[v]) - planes0[p+3]);
+      }
+    if (gap > distance)
+      {
+      return 1;
+      }
+    }
+
+  // Vertices of proxy 0 against the planes of proxy 1. The planes are transformed into the
+  // coordinate system of model 0 by the inverse transpose of the linear part of the matrix.
+  double linear[3][3], inverseLinear[3][3];
+  for (int j=0; j<3; j++)
+    {
+    linear[j][0] = matrix[4*j];
+    linear[j][1] = matrix[4*j+1];
+    linear[j][2] = matrix[4*j+2];
+    }
+  vtkMath::Invert3x3(linear, inverseLinear);
+  const double translation[3] = { matrix[3], matrix[7], matrix[11] };
+  for (size_t p=0; p<planes1.size(); p+=4)
+    {
+    double normal[3];
+    for (int j=0; j<3; j++)
+      {
+      normal[j] = inverseLinear[0][j]*planes1[p] + inverseLinear[1][j]*planes1[p+1] + inverseLinear[2][j]*planes1[p+2];
+      }
+    double offset = planes1[p+3] + vtkMath::Dot(normal, translation);
+    double norm = vtkMath::Norm(normal);
+    if (norm == 0.0)
+      {
+      continue;
+      }
+    double gap = VTK_DOUBLE_MAX;
+    for (size_t v=0; v<vertices0.size() && gap>distance; v+=3)
+      {
+      gap = std::min(gap, (vtkMath::Dot(normal, &vertices0[v]) - offset) / norm);
+      }
+    if (gap > distance)
+      {
+      return 1;
+      }
+    }
+
+  return 0;
+}
+
 // Method intersects two polygons. You must supply the number of points and
 // point coordinates (npts, *pts) and the bounding box (bounds) of the two
 // polygons. Also supply a tolerance squared for controlling
@@ -784,5 +1801,7 @@ void vtkCollisionDetectionFilter::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "Box Tolerance: " << this->BoxTolerance << "\n";
   os << indent << "Cell Tolerance: " << this->CellTolerance << "\n";
   os << indent << "Number of cells per Node: " << this->NumberOfCellsPerNode << "\n";
+  os << indent << "Use Proxies: " << this->UseProxies << "\n";
+  os << indent << "Proxy Padding: " << this->ProxyPadding << "\n";
 
 }
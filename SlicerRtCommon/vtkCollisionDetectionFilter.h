@@ -46,6 +46,8 @@
 #include "vtkIdTypeArray.h"
 #include "vtkFieldData.h"
 
+#include <vector>
+
 class vtkOBBTree;
 class vtkPolyData;
 class vtkPoints;
@@ -127,6 +129,16 @@ public:
   // Specify the matrix object used to transform models.
   void SetMatrix(int i, vtkMatrix4x4 *matrix);
   vtkMatrix4x4 *GetMatrix(int i);
+
+  // Description:
+  // Set and Get the OBB tree of model i. By default each filter owns two trees.
+  // Filters that take the same rigid model as input can share its tree, so the
+  // hierarchy is built only once and only the transforms change between updates.
+  // A tree is rebuilt only if its model or settings were modified since the last
+  // build, so filters sharing a tree should use the same NumberOfCellsPerNode and
+  // BoxTolerance. Setting NULL restores a private tree.
+  void SetOBBTree(int i, vtkOBBTree *tree);
+  vtkOBBTree *GetOBBTree(int i);
   
   //Description:
   // Set and Get the obb tolerance (absolute value, in world coords). Default is 0.001
@@ -150,6 +162,64 @@ public:
   int GetNumberOfContacts() 
     {return this->GetOutput(0)->GetFieldData()->GetArray("ContactCells")->GetNumberOfTuples();}
   
+  //Description:
+  // Test if the two models intersect without executing the filter. The OBB tree
+  // traversal stops at the first intersecting pair of cells and no output polydata
+  // or contact cell arrays are generated, so this is much cheaper than updating the
+  // filter and checking GetNumberOfContacts() when only a yes/no answer is needed.
+  // The inputs, transforms, tolerances and OBB trees are used the same way as in
+  // the filter execution. Returns 1 if the models collide, 0 otherwise.
+  int IsColliding();
+
+  //Description:
+  // Test if the two models intersect when placed by the given matrices instead of the
+  // transforms of the filter. Neither the filter nor its OBB trees are modified, so once
+  // the trees are up to date (see UpdateOBBTrees()) this method can be called from
+  // multiple threads to evaluate many poses in parallel.
+  // Returns 1 if the models collide, 0 otherwise.
+  int IsColliding(vtkMatrix4x4 *matrix0, vtkMatrix4x4 *matrix1);
+
+  //Description:
+  // Build the OBB trees and the convex proxies (if enabled) of the current inputs unless they are up to date
+  void UpdateOBBTrees();
+
+  //Description:
+  // Set and Get the flag to test the convex proxies of the models before their OBB trees.
+  // The proxy of a model is a convex polyhedron bounded by 26 planes (cube faces, edges and
+  // corners) around its points, and its bounding sphere. When the proxies are farther apart
+  // than the padding, the models cannot collide and the trees are not traversed at all, so
+  // poses far from contact cost a few dot products instead of a tree traversal. The result
+  // of the collision detection and distance queries is the same either way. The proxies are
+  // only built when enabled. Default is off.
+  vtkSetMacro(UseProxies, int);
+  vtkGetMacro(UseProxies, int);
+  vtkBooleanMacro(UseProxies, int);
+
+  //Description:
+  // Set and Get the padding of the convex proxies (absolute value, in world coords).
+  // Proxies closer than the padding plus the box and cell tolerances are considered
+  // overlapping, which absorbs the round-off of the proxy construction. Default is 0.01
+  vtkSetMacro(ProxyPadding, double);
+  vtkGetMacro(ProxyPadding, double);
+
+  //Description:
+  // Compute the minimum distance between the two models under the current transforms,
+  // and the closest pair of points in world coordinates (if not NULL). The same OBB trees
+  // are traversed as for the collision detection, pruning the pairs of boxes that are not
+  // closer than the closest pair of cells found so far. If maximumDistance is positive,
+  // then only distances below it are searched for: when the models are farther apart the
+  // traversal ends at the top of the trees and VTK_DOUBLE_MAX is returned without setting
+  // the points. Colliding models have zero distance. The distance is measured in the
+  // coordinate system of model 0, which equals the world distance for rigid transforms.
+  double ComputeMinimumDistance(double maximumDistance, double closestPoint0[3], double closestPoint1[3]);
+
+  //Description:
+  // Compute the minimum distance between the two models placed by the given matrices
+  // instead of the transforms of the filter. Like IsColliding(matrix0, matrix1), this
+  // method does not modify the filter and can be called from multiple threads.
+  double ComputeMinimumDistance(vtkMatrix4x4 *matrix0, vtkMatrix4x4 *matrix1,
+    double maximumDistance, double closestPoint0[3], double closestPoint1[3]);
+
   //Description:
   // Get the number of box tests
   vtkGetMacro(NumberOfBoxTests, int); 
@@ -175,10 +245,40 @@ protected:
 
   // Usual data generation method
   virtual int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *);
+
+  // Set up the OBB trees for the models and rebuild them if they are out of date
+  void UpdateOBBTrees(vtkPolyData *input0, vtkPolyData *input1);
+
+  // Compute the transform of model 1 into the coordinate system of model 0.
+  // Returns 0 if the transforms are not set.
+  int ComputeRelativeMatrix(vtkMatrix4x4 *matrix);
+
+  // Build the convex proxies of the models if the models were modified since the last build
+  void UpdateProxies(vtkPolyData *input0, vtkPolyData *input1);
+  void BuildProxy(int i, vtkPolyData *input);
+
+  // Test if the convex proxies are farther apart than the given distance when model 1 is
+  // transformed by matrix into the coordinate system of model 0. Returns 0 if the proxies
+  // may be closer, or if they are not built. Does not modify the filter.
+  int AreProxiesSeparated(const double matrix[16], double distance);
+
+  // Distance below which the proxies are considered overlapping in the collision tests
+  double GetProxyTolerance();
   
   vtkOBBTree *tree0;
   vtkOBBTree *tree1;
 
+  // Convex proxies: unit normal and offset of each plane, vertices, bounding sphere
+  std::vector<double> ProxyPlanes[2];
+  std::vector<double> ProxyVertices[2];
+  double ProxyCenter[2][3];
+  double ProxyRadius[2];
+  vtkPolyData *ProxyModel[2];
+  vtkTimeStamp ProxyBuildTime[2];
+
+  int UseProxies;
+  double ProxyPadding;
+
   vtkLinearTransform *Transform[2];
   vtkMatrix4x4 *Matrix[2];
   
@@ -0,0 +1,304 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkEuclideanDistanceTransform.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkEuclideanDistanceTransform);
+
+vtkCxxSetObjectMacro(vtkEuclideanDistanceTransform, InputImageData, vtkImageData);
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /// Squared distance value of voxels without a feature voxel
+  const float NO_FEATURE_DISTANCE = VTK_FLOAT_MAX;
+
+  //----------------------------------------------------------------------------
+  /// Initialize the squared distances: zero at the feature voxels, maximum elsewhere
+  template <class T> void InitializeDistances(const T* labelmapPtr, const int dimensions[3], int featureMode, float* distancePtr)
+  {
+    vtkIdType sliceSize = (vtkIdType)dimensions[0] * dimensions[1];
+    vtkIdType index = 0;
+    for (int k=0; k<dimensions[2]; ++k)
+    {
+      for (int j=0; j<dimensions[1]; ++j)
+      {
+        for (int i=0; i<dimensions[0]; ++i, ++index)
+        {
+          bool object = (labelmapPtr[index] != 0);
+          bool feature = false;
+          if (featureMode == vtkEuclideanDistanceTransform::DistanceToObject)
+          {
+            feature = object;
+          }
+          else if (featureMode == vtkEuclideanDistanceTransform::DistanceToBackground)
+          {
+            feature = !object;
+          }
+          else if (object)
+          {
+            // Boundary: object voxel on the border of the image or with a background face neighbor
+            feature = ( i == 0 || i == dimensions[0]-1 || j == 0 || j == dimensions[1]-1 || k == 0 || k == dimensions[2]-1
+              || labelmapPtr[index-1] == 0 || labelmapPtr[index+1] == 0
+              || labelmapPtr[index-dimensions[0]] == 0 || labelmapPtr[index+dimensions[0]] == 0
+              || labelmapPtr[index-sliceSize] == 0 || labelmapPtr[index+sliceSize] == 0 );
+          }
+          distancePtr[index] = (feature ? 0.0f : NO_FEATURE_DISTANCE);
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE TransformLinesThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    vtkEuclideanDistanceTransform* self = static_cast<vtkEuclideanDistanceTransform*>(threadInfo->UserData);
+
+    vtkIdType numberOfLines = self->GetNumberOfLinesInCurrentPass();
+    vtkIdType linesPerThread = (numberOfLines + threadInfo->NumberOfThreads - 1) / threadInfo->NumberOfThreads;
+    vtkIdType startLine = threadInfo->ThreadID * linesPerThread;
+    vtkIdType endLine = std::min(startLine + linesPerThread, numberOfLines);
+    if (startLine < endLine)
+    {
+      self->ThreadedTransformLines(startLine, endLine);
+    }
+
+    return VTK_THREAD_RETURN_VALUE;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkEuclideanDistanceTransform::vtkEuclideanDistanceTransform()
+{
+  this->InputImageData = NULL;
+  this->OutputImageData = vtkImageData::New();
+  this->FeatureMode = DistanceToObject;
+  this->UseImageSpacing = true;
+  this->Spacing[0] = this->Spacing[1] = this->Spacing[2] = 1.0;
+  this->EvaluationOffset[0] = this->EvaluationOffset[1] = this->EvaluationOffset[2] = 0.0;
+  this->CurrentAxis = 0;
+  this->CurrentSpacing[0] = this->CurrentSpacing[1] = this->CurrentSpacing[2] = 1.0;
+  this->Threader = vtkMultiThreader::New();
+  this->NumberOfThreads = this->Threader->GetNumberOfThreads();
+}
+
+//----------------------------------------------------------------------------
+vtkEuclideanDistanceTransform::~vtkEuclideanDistanceTransform()
+{
+  this->SetInputImageData(NULL);
+  if (this->OutputImageData)
+  {
+    this->OutputImageData->Delete();
+    this->OutputImageData = NULL;
+  }
+  if (this->Threader)
+  {
+    this->Threader->Delete();
+    this->Threader = NULL;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkEuclideanDistanceTransform::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "FeatureMode: " << this->FeatureMode << "\n";
+  os << indent << "UseImageSpacing: " << (this->UseImageSpacing ? "true" : "false") << "\n";
+  os << indent << "Spacing: " << this->Spacing[0] << ", " << this->Spacing[1] << ", " << this->Spacing[2] << "\n";
+  os << indent << "EvaluationOffset: " << this->EvaluationOffset[0] << ", " << this->EvaluationOffset[1] << ", " << this->EvaluationOffset[2] << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+}
+
+//----------------------------------------------------------------------------
+bool vtkEuclideanDistanceTransform::Update()
+{
+  if (!this->InputImageData || !this->InputImageData->GetPointData()->GetScalars())
+  {
+    vtkErrorMacro("Update: Invalid input image!");
+    return false;
+  }
+  if (this->InputImageData->GetNumberOfScalarComponents() != 1)
+  {
+    vtkErrorMacro("Update: Input image needs to have a single component!");
+    return false;
+  }
+
+  if (this->UseImageSpacing)
+  {
+    this->InputImageData->GetSpacing(this->CurrentSpacing);
+  }
+  else
+  {
+    std::copy(this->Spacing, this->Spacing + 3, this->CurrentSpacing);
+  }
+  for (int axis=0; axis<3; ++axis)
+  {
+    this->CurrentSpacing[axis] = fabs(this->CurrentSpacing[axis]);
+    if (this->CurrentSpacing[axis] == 0.0)
+    {
+      vtkErrorMacro("Update: Zero spacing along axis " << axis << "!");
+      return false;
+    }
+  }
+
+  this->OutputImageData->SetExtent(this->InputImageData->GetExtent());
+  this->OutputImageData->SetOrigin(this->InputImageData->GetOrigin());
+  this->OutputImageData->SetSpacing(this->InputImageData->GetSpacing());
+  this->OutputImageData->AllocateScalars(VTK_FLOAT, 1);
+
+  int dimensions[3] = {0, 0, 0};
+  this->InputImageData->GetDimensions(dimensions);
+  float* distancePtr = static_cast<float*>(this->OutputImageData->GetScalarPointer());
+  switch (this->InputImageData->GetScalarType())
+  {
+    vtkTemplateMacro( InitializeDistances(static_cast<VTK_TT*>(this->InputImageData->GetScalarPointer()),
+      dimensions, this->FeatureMode, distancePtr) );
+    default:
+      vtkErrorMacro("Update: Unsupported input image scalar type!");
+      return false;
+  }
+
+  // Process the axes one after the other, the lines of each axis in parallel
+  this->Threader->SetNumberOfThreads(this->NumberOfThreads);
+  this->Threader->SetSingleMethod(TransformLinesThreadFunction, this);
+  for (this->CurrentAxis=0; this->CurrentAxis<3; ++this->CurrentAxis)
+  {
+    if (dimensions[this->CurrentAxis] > 1)
+    {
+      this->Threader->SingleMethodExecute();
+    }
+  }
+
+  this->OutputImageData->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkEuclideanDistanceTransform::GetNumberOfLinesInCurrentPass()
+{
+  int dimensions[3] = {0, 0, 0};
+  this->OutputImageData->GetDimensions(dimensions);
+  return (vtkIdType)dimensions[0] * dimensions[1] * dimensions[2] / std::max(dimensions[this->CurrentAxis], 1);
+}
+
+//----------------------------------------------------------------------------
+void vtkEuclideanDistanceTransform::ThreadedTransformLines(vtkIdType startLine, vtkIdType endLine)
+{
+  int dimensions[3] = {0, 0, 0};
+  this->OutputImageData->GetDimensions(dimensions);
+  float* distancePtr = static_cast<float*>(this->OutputImageData->GetScalarPointer());
+
+  int axis = this->CurrentAxis;
+  int length = dimensions[axis];
+  vtkIdType stride = (axis == 0 ? 1 : (axis == 1 ? dimensions[0] : (vtkIdType)dimensions[0] * dimensions[1]));
+  double squaredSpacing = this->CurrentSpacing[axis] * this->CurrentSpacing[axis];
+  double evaluationOffset = this->EvaluationOffset[axis];
+
+  // Scratch buffers: squared distances of the line in voxel units, and the lower envelope of parabolas
+  std::vector<double> values(length, 0.0);
+  std::vector<int> parabolaVertices(length, 0);
+  std::vector<double> parabolaBoundaries(length + 1, 0.0);
+
+  for (vtkIdType line=startLine; line<endLine; ++line)
+  {
+    vtkIdType lineStart = 0;
+    if (axis == 0)
+    {
+      lineStart = line * dimensions[0];
+    }
+    else if (axis == 1)
+    {
+      lineStart = (line % dimensions[0]) + (line / dimensions[0]) * dimensions[0] * dimensions[1];
+    }
+    else
+    {
+      lineStart = line;
+    }
+    float* linePtr = distancePtr + lineStart;
+
+    // Build the lower envelope of the parabolas rooted at the voxels that have a finite distance
+    int numberOfParabolas = 0;
+    for (int q=0; q<length; ++q)
+    {
+      float distance = linePtr[q * stride];
+      if (distance == NO_FEATURE_DISTANCE)
+      {
+        values[q] = -1.0;
+        continue;
+      }
+      values[q] = distance / squaredSpacing;
+      if (numberOfParabolas == 0)
+      {
+        parabolaVertices[0] = q;
+        parabolaBoundaries[0] = -VTK_DOUBLE_MAX;
+        parabolaBoundaries[1] = VTK_DOUBLE_MAX;
+        numberOfParabolas = 1;
+        continue;
+      }
+      double intersection = 0.0;
+      while (true)
+      {
+        int v = parabolaVertices[numberOfParabolas-1];
+        intersection = ((values[q] + (double)q*q) - (values[v] + (double)v*v)) / (2.0 * (q - v));
+        if (intersection <= parabolaBoundaries[numberOfParabolas-1] && numberOfParabolas > 1)
+        {
+          --numberOfParabolas; // Parabola of v is hidden (the first one never is, as its boundary is minus infinity)
+        }
+        else
+        {
+          break;
+        }
+      }
+      parabolaVertices[numberOfParabolas] = q;
+      parabolaBoundaries[numberOfParabolas] = intersection;
+      parabolaBoundaries[numberOfParabolas+1] = VTK_DOUBLE_MAX;
+      ++numberOfParabolas;
+    }
+    if (numberOfParabolas == 0)
+    {
+      continue; // No feature along the line
+    }
+
+    // Evaluate the lower envelope
+    int parabolaIndex = 0;
+    for (int q=0; q<length; ++q)
+    {
+      double position = q + evaluationOffset;
+      while (parabolaBoundaries[parabolaIndex+1] < position)
+      {
+        ++parabolaIndex;
+      }
+      int v = parabolaVertices[parabolaIndex];
+      linePtr[q * stride] = static_cast<float>( squaredSpacing * ((position - v) * (position - v) + values[v]) );
+    }
+  }
+}
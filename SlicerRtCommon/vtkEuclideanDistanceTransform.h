@@ -0,0 +1,141 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#ifndef __vtkEuclideanDistanceTransform_h
+#define __vtkEuclideanDistanceTransform_h
+
+#include "vtkSlicerRtCommonWin32Header.h"
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkMultiThreader.h>
+
+// STD includes
+#include <vector>
+
+class vtkImageData;
+
+/// \ingroup SlicerRt_SlicerRtCommon
+/// \class vtkEuclideanDistanceTransform
+/// \brief Exact Euclidean distance transform of a binary labelmap in linear time.
+///
+/// Computes for every voxel the squared Euclidean distance (in mm^2, using the voxel spacing) to the
+/// nearest feature voxel. The feature voxels are the object (non-zero) voxels, the background voxels,
+/// or the boundary voxels of the object, see \sa FeatureMode.
+///
+/// The transform is separable: the lower envelope of parabolas is computed along each axis in turn
+/// (Felzenszwalb and Huttenlocher, Distance Transforms of Sampled Functions, 2012), which costs linear
+/// time in the number of voxels independent of the distances. The lines of each axis are processed in parallel.
+/// Only voxels of the input image are considered as features, so the input needs to be padded if distances
+/// beyond the object are needed outside the extent of the input.
+class VTK_SLICERRTCOMMON_EXPORT vtkEuclideanDistanceTransform : public vtkObject
+{
+public:
+  enum
+  {
+    /// Distance to the nearest object (non-zero) voxel. Zero inside the object
+    DistanceToObject = 0,
+    /// Distance to the nearest background (zero) voxel. Zero outside the object
+    DistanceToBackground,
+    /// Distance to the nearest boundary voxel of the object. Boundary voxels are object voxels
+    /// with a background face neighbor, or on the border of the image
+    DistanceToObjectBoundary
+  };
+
+public:
+  static vtkEuclideanDistanceTransform *New();
+  vtkTypeMacro(vtkEuclideanDistanceTransform, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Set input binary labelmap (single component, any scalar type)
+  void SetInputImageData(vtkImageData* imageData);
+  vtkGetObjectMacro(InputImageData, vtkImageData);
+
+  /// Get output image (float, squared distance in mm^2, same geometry as the input).
+  /// Voxels that have no feature voxel get VTK_FLOAT_MAX
+  vtkGetObjectMacro(OutputImageData, vtkImageData);
+
+  /// Set what the distances are measured to. Default is DistanceToObject
+  vtkSetClampMacro(FeatureMode, int, DistanceToObject, DistanceToObjectBoundary);
+  vtkGetMacro(FeatureMode, int);
+
+  /// Use the spacing of the input image (default). If off, \sa Spacing is used instead,
+  /// which allows anisotropic scaling of the distances (e.g. spacing divided by margin along each axis)
+  vtkSetMacro(UseImageSpacing, bool);
+  vtkGetMacro(UseImageSpacing, bool);
+  vtkBooleanMacro(UseImageSpacing, bool);
+
+  /// Spacing used if \sa UseImageSpacing is off
+  vtkSetVector3Macro(Spacing, double);
+  vtkGetVector3Macro(Spacing, double);
+
+  /// Offset (in voxels) of the positions the distances are measured from, relative to the voxel centers.
+  /// Zero by default. Allows reproducing kernels centered between voxels (e.g. morphology kernels of even size)
+  vtkSetVector3Macro(EvaluationOffset, double);
+  vtkGetVector3Macro(EvaluationOffset, double);
+
+  /// Number of threads used for the computation. By default the number of processors is used
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_MAX_THREADS);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Compute the distance transform
+  /// \return Success flag
+  bool Update();
+
+  /// Get the number of lines along the axis currently processed
+  vtkIdType GetNumberOfLinesInCurrentPass();
+
+  /// Transform a range of lines along the axis currently processed. Called from the worker threads
+  void ThreadedTransformLines(vtkIdType startLine, vtkIdType endLine);
+
+protected:
+  vtkEuclideanDistanceTransform();
+  virtual ~vtkEuclideanDistanceTransform();
+
+protected:
+  /// Input labelmap
+  vtkImageData* InputImageData;
+  /// Output squared distance image
+  vtkImageData* OutputImageData;
+  /// What the distances are measured to
+  int FeatureMode;
+  /// Flag whether the spacing of the input image is used
+  bool UseImageSpacing;
+  /// Spacing used instead of the image spacing
+  double Spacing[3];
+  /// Offset of the evaluation positions in voxels
+  double EvaluationOffset[3];
+  /// Number of threads
+  int NumberOfThreads;
+
+  /// Axis processed by the current pass
+  int CurrentAxis;
+  /// Spacing used in the current computation
+  double CurrentSpacing[3];
+
+  /// Multithreader processing the lines
+  vtkMultiThreader* Threader;
+
+private:
+  vtkEuclideanDistanceTransform(const vtkEuclideanDistanceTransform&); // Not implemented
+  void operator=(const vtkEuclideanDistanceTransform&);                // Not implemented
+};
+
+#endif